@@ -0,0 +1,116 @@
+/**
+ * @file archive_grep.h
+ * @author Zuhaitz (original)
+ * @brief Defines the background job that searches every entry of an archive.
+ *
+ * A pool of threads claims entries one at a time and streams each through
+ * the plugin's `plugin_read_entry`, counting the occurrences of a term as the
+ * chunks arrive, so nothing is written to disk and no entry is held in
+ * memory whole. When the plugin exports an ArchiveSession, each worker opens
+ * the archive once and reads its entries by position, in the order it
+ * claims them, which is the order of the archive. Plugins without a
+ * streaming reader fall back to extracting each entry to a temporary file
+ * that is removed once it has been read.
+ *
+ * Entries are reported in the order they finish, so the ones with hits show
+ * up while the larger ones are still being decompressed.
+ */
+#ifndef ARCHIVE_GREP_H
+#define ARCHIVE_GREP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+#include "core/error.h"
+#include "core/string_list.h"
+#include "plugins/plugin_api.h"
+
+/** @brief The maximum number of threads searching one archive. */
+#define ARCHIVE_GREP_MAX_THREADS 8
+
+/** @brief The longest term, in bytes; matches the search input. */
+#define ARCHIVE_GREP_MAX_TERM_LEN 255
+
+/**
+ * @struct ArchiveGrepHit
+ * @brief An entry that contains the term.
+ */
+typedef struct {
+    size_t entry;               /**< The index of the entry in the archive listing. */
+    size_t hits;                /**< The number of occurrences of the term. */
+    char* row;                  /**< The entry name followed by its hit count, as shown. */
+} ArchiveGrepHit;
+
+/**
+ * @struct ArchiveGrep
+ * @brief A term and the entries of an archive that contain it.
+ */
+typedef struct {
+    char* term;                 /**< The term searched for. */
+    size_t term_len;            /**< The length of `term`. */
+    char* archive_path;         /**< The archive being searched. */
+    const ArchivePlugin* plugin; /**< The plugin that handles the archive. */
+    ArchiveEntryReader reader;  /**< The plugin's streaming reader, or NULL to extract instead. */
+    ArchiveSession session;     /**< The plugin's functions to read entries of an open archive; zeroed if it has none. */
+    StringList entries;         /**< A private copy of the entry names. */
+
+    // **Shared with the workers (protected by `lock`)**
+    pthread_mutex_t lock;
+    size_t next_entry;          /**< The next entry a worker will claim. */
+    size_t* entry_hits;         /**< The hit count of each finished entry. */
+    size_t* finished;           /**< The finished entries, in the order they finished. */
+    size_t finished_count;      /**< The number of entries in `finished`. */
+    size_t failed_count;        /**< The number of entries that could not be read. */
+    bool cancel;                /**< Set to ask the workers to stop. */
+
+    // **UI thread only**
+    ArchiveGrepHit* hits;       /**< The entries with hits adopted so far, in arrival order. */
+    size_t count;               /**< The number of entries in `hits`. */
+    size_t capacity;            /**< The allocated capacity of `hits`. */
+    size_t adopted;             /**< The number of finished entries looked at by `archive_grep_poll`. */
+    size_t total_hits;          /**< The sum of the hit counts adopted so far. */
+    bool failed;                /**< Set if the results could not be stored; the search is shown as far as it got. */
+
+    pthread_t threads[ARCHIVE_GREP_MAX_THREADS]; /**< The workers. */
+    int thread_count;           /**< The number of started workers. */
+} ArchiveGrep;
+
+/**
+ * @brief Starts searching every entry of an archive for a term in the background.
+ *
+ * Occurrences are counted like the search does, overlapping ones included,
+ * and are found across chunk boundaries.
+ *
+ * @param grep Pointer to the ArchiveGrep to initialize.
+ * @param archive_path The path to the archive.
+ * @param plugin The plugin that handles the archive.
+ * @param reader The plugin's streaming reader, or NULL to extract each entry instead.
+ * @param session The plugin's functions to read entries of an open archive, or NULL if it has none.
+ * @param entries The entry names, in the order the plugin lists them. They are copied.
+ * @param term The term, at most ARCHIVE_GREP_MAX_TERM_LEN bytes.
+ * @return FAT_SUCCESS, FAT_ERROR_INVALID_ARGUMENT for an empty or overlong term, or FAT_ERROR_MEMORY.
+ */
+FatResult archive_grep_start(ArchiveGrep* grep, const char* archive_path, const ArchivePlugin* plugin,
+                             ArchiveEntryReader reader, const ArchiveSession* session,
+                             const StringList* entries, const char* term);
+
+/**
+ * @brief Adopts the entries finished since the last call.
+ * @param grep Pointer to a started ArchiveGrep.
+ * @return True if entries with hits were added.
+ */
+bool archive_grep_poll(ArchiveGrep* grep);
+
+/**
+ * @brief Returns true until every entry has been searched and adopted.
+ * @param grep Pointer to a started ArchiveGrep.
+ */
+bool archive_grep_is_running(const ArchiveGrep* grep);
+
+/**
+ * @brief Stops the workers and frees the search.
+ * @param grep Pointer to the ArchiveGrep to free. It is left in an empty state.
+ */
+void archive_grep_free(ArchiveGrep* grep);
+
+#endif // ARCHIVE_GREP_H
@@ -0,0 +1,154 @@
+/**
+ * @file byte_map.h
+ * @author Zuhaitz (original)
+ * @brief Defines the byte map of a binary file: the entropy and byte classes of each block.
+ *
+ * The file is split into at most BYTE_MAP_MAX_BLOCKS blocks, their size a
+ * power of two chosen from the size of the file, and a background thread
+ * builds the byte histogram of each in turn. From it come the block's
+ * Shannon entropy and how many of its bytes are zero, printable ASCII or
+ * have the high bit set. Together they tell padding (a single repeated
+ * byte), text, code and data, and compressed or encrypted regions (close
+ * to eight bits per byte) apart at a glance.
+ */
+#ifndef BYTE_MAP_H
+#define BYTE_MAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "core/error.h"
+#include "core/line_index.h"
+
+/** @brief The most blocks a file is split into; larger files get larger blocks. */
+#define BYTE_MAP_MAX_BLOCKS 4096
+
+/** @brief The smallest block, in bytes; fewer bytes are too few to tell random data by its entropy. */
+#define BYTE_MAP_MIN_BLOCK_SIZE 1024
+
+/** @brief The entropy, in bits per byte, below which a region counts as padding. */
+#define BYTE_MAP_PADDING_ENTROPY 1.0f
+
+/** @brief The entropy, in bits per byte, from which a region counts as compressed or encrypted. */
+#define BYTE_MAP_RANDOM_ENTROPY 7.2f
+
+/**
+ * @struct ByteBlock
+ * @brief The statistics of one block, or of several added up.
+ */
+typedef struct {
+    float entropy;              /**< The Shannon entropy, from 0 to 8 bits per byte; averaged over added blocks. */
+    uint64_t bytes;             /**< The number of bytes. */
+    uint64_t zero;              /**< The bytes that are 0x00. */
+    uint64_t text;              /**< The printable ASCII bytes, tabs and line breaks included. */
+    uint64_t high;              /**< The bytes from 0x80 up. */
+} ByteBlock;
+
+/**
+ * @enum ByteRegion
+ * @brief What a stretch of a file most likely holds.
+ */
+typedef enum {
+    BYTE_REGION_UNKNOWN,        /**< Not scanned yet. */
+    BYTE_REGION_PADDING,        /**< One byte repeated, such as zeros or erased flash. */
+    BYTE_REGION_TEXT,           /**< Mostly printable ASCII. */
+    BYTE_REGION_DATA,           /**< Code, tables and other structured data. */
+    BYTE_REGION_RANDOM          /**< Compressed or encrypted data. */
+} ByteRegion;
+
+/**
+ * @struct ByteMap
+ * @brief The blocks of a mapped file and the background scan that fills them in.
+ */
+typedef struct {
+    const unsigned char* data;  /**< The mapped file; owned by the hex view. */
+    size_t size;                /**< The size of the file. */
+    const FileHole* holes;      /**< The holes of the file, counted as zeros without being read; owned by the hex view. */
+    size_t hole_count;          /**< The number of holes. */
+    size_t block_size;          /**< The size of every block but the last. */
+    size_t block_count;         /**< The number of blocks. */
+    ByteBlock* blocks;          /**< The blocks; each is written once, before `ready` passes it. */
+
+    // **Shared with the background scan (protected by `lock`)**
+    pthread_mutex_t lock;
+    size_t ready;               /**< The number of blocks scanned so far. */
+    bool cancel;                /**< Set to ask the scan to stop. */
+
+    // **UI thread only**
+    size_t count;               /**< The value of `ready` at the last poll; blocks before it can be read. */
+
+    pthread_t thread;
+    bool has_thread;            /**< True if the background scan was started. */
+} ByteMap;
+
+/**
+ * @brief Starts scanning the blocks of a mapped file in the background.
+ *
+ * @param map Pointer to the ByteMap to initialize.
+ * @param data The bytes of the file. They must outlive the ByteMap.
+ * @param size The size of the file.
+ * @param holes The holes of the file, in file order, or NULL. They must outlive the ByteMap.
+ * @param hole_count The number of holes.
+ * @return FAT_SUCCESS, or FAT_ERROR_MEMORY.
+ */
+FatResult byte_map_start(ByteMap* map, const char* data, size_t size, const FileHole* holes, size_t hole_count);
+
+/**
+ * @brief Adopts the blocks scanned since the last call.
+ * @param map Pointer to a started ByteMap.
+ * @return True if blocks were added.
+ */
+bool byte_map_poll(ByteMap* map);
+
+/**
+ * @brief Returns true until every block has been scanned and adopted.
+ * @param map Pointer to a started ByteMap.
+ */
+bool byte_map_is_running(const ByteMap* map);
+
+/**
+ * @brief Adds up the adopted blocks that overlap a range of bytes.
+ *
+ * @param map Pointer to a started ByteMap.
+ * @param start The first byte of the range.
+ * @param end The byte past the range.
+ * @param out Receives the statistics; `bytes` is 0 if none of the blocks has been scanned.
+ */
+void byte_map_summarize(const ByteMap* map, size_t start, size_t end, ByteBlock* out);
+
+/**
+ * @brief Returns the first byte of a row when the map is drawn in a number of rows.
+ *
+ * Rows split the file as evenly as whole blocks allow.
+ *
+ * @param map Pointer to a started ByteMap.
+ * @param row The row, from 0 to `rows`; row `rows` starts at the end of the file.
+ * @param rows The number of rows, at least 1.
+ */
+size_t byte_map_row_start(const ByteMap* map, size_t row, size_t rows);
+
+/**
+ * @brief Returns the row holding a byte when the map is drawn in a number of rows.
+ */
+size_t byte_map_row_of(const ByteMap* map, size_t offset, size_t rows);
+
+/**
+ * @brief Tells what a stretch of a file most likely holds from its statistics.
+ */
+ByteRegion byte_map_classify(const ByteBlock* block);
+
+/**
+ * @brief Returns the heap memory held by the blocks.
+ * @param map Pointer to the ByteMap.
+ * @return The approximate heap usage in bytes.
+ */
+size_t byte_map_memory_usage(const ByteMap* map);
+
+/**
+ * @brief Stops the background scan and frees the map.
+ * @param map Pointer to the ByteMap to free. It is left in an empty state.
+ */
+void byte_map_free(ByteMap* map);
+
+#endif // BYTE_MAP_H
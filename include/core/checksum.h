@@ -0,0 +1,178 @@
+/**
+ * @file checksum.h
+ * @author Zuhaitz (original)
+ * @brief Defines the checksums of a file and the background job that computes them.
+ *
+ * Four kinds are offered: CRC-32 as zip and gzip store it, CRC-32C
+ * (Castagnoli) as storage and network protocols use it, XXH64 for a fast
+ * non-cryptographic fingerprint, and SHA-256. Every selected kind is fed
+ * from the same pass over the file, read through the shared read pipeline
+ * by a background thread, so asking for three costs one read of the file.
+ *
+ * CRC-32C is computed with the SSE4.2 crc32 instruction and SHA-256 with
+ * the SHA extensions when the processor has them; both are checked for at
+ * run time, and portable table and scalar versions are used otherwise.
+ */
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "core/error.h"
+
+/** @brief The longest digest, as hex digits, plus the terminator. */
+#define CHECKSUM_HEX_SIZE 65
+
+/**
+ * @enum ChecksumKind
+ * @brief The checksums that can be computed.
+ */
+typedef enum {
+    CHECKSUM_CRC32,             /**< CRC-32 (IEEE 802.3), as stored by zip and gzip. */
+    CHECKSUM_CRC32C,            /**< CRC-32C (Castagnoli). */
+    CHECKSUM_XXH64,             /**< XXH64 with a seed of 0. */
+    CHECKSUM_SHA256,            /**< SHA-256. */
+    CHECKSUM_KIND_COUNT
+} ChecksumKind;
+
+/**
+ * @struct ChecksumState
+ * @brief The running state of one checksum over a stream of bytes.
+ */
+typedef struct {
+    ChecksumKind kind;
+    uint64_t length;            /**< The number of bytes fed so far. */
+    union {
+        uint32_t crc;           /**< The running CRC, inverted. */
+        struct {
+            uint64_t acc[4];    /**< The four XXH64 lanes. */
+            unsigned char buffer[32];
+        } xxh;
+        struct {
+            uint32_t h[8];      /**< The SHA-256 chaining value. */
+            unsigned char buffer[64];
+        } sha;
+    } u;
+} ChecksumState;
+
+/**
+ * @struct Checksums
+ * @brief The checksums of a file, computed by a background job.
+ *
+ * Checksums read from an archive's own records instead of the data are
+ * `stored`; they are complete from the start and have no job.
+ */
+typedef struct {
+    char* path;                 /**< The file being hashed, or NULL for stored checksums. */
+    char* subject;              /**< What the checksums are of, if not the viewed file (an archive entry), or NULL. */
+    ChecksumKind kinds[CHECKSUM_KIND_COUNT]; /**< The selected kinds, in display order. */
+    size_t kind_count;          /**< The number of selected kinds. */
+    uint64_t size;              /**< The number of bytes to hash. */
+    bool stored;                /**< True if the values come from the archive rather than from hashing. */
+
+    // **Shared with the background job (protected by `lock`)**
+    pthread_mutex_t lock;
+    uint64_t hashed;            /**< The number of bytes hashed so far. */
+    bool finished;              /**< True once the job has ended. */
+    bool cancel;                /**< Set to ask the job to stop. */
+    FatResult error;            /**< How the job ended. */
+    char digests[CHECKSUM_KIND_COUNT][CHECKSUM_HEX_SIZE]; /**< The digests, written before `finished` is set. */
+
+    // **UI thread only**
+    uint64_t progress;          /**< The value of `hashed` at the last poll. */
+    bool done;                  /**< True once the finished job has been adopted. */
+    FatResult result;           /**< How the job ended, once done. */
+    char values[CHECKSUM_KIND_COUNT][CHECKSUM_HEX_SIZE]; /**< The adopted digests, once done. */
+
+    pthread_t thread;
+    bool has_thread;            /**< True if the background job was started. */
+} Checksums;
+
+/**
+ * @brief Starts a checksum.
+ * @param state Pointer to the ChecksumState to initialize.
+ * @param kind The kind of checksum.
+ */
+void checksum_init(ChecksumState* state, ChecksumKind kind);
+
+/**
+ * @brief Feeds bytes to a checksum.
+ * @param state Pointer to a started ChecksumState.
+ * @param data The bytes.
+ * @param len The number of bytes.
+ */
+void checksum_update(ChecksumState* state, const void* data, size_t len);
+
+/**
+ * @brief Finishes a checksum and writes its digest as lowercase hex.
+ *
+ * @param state Pointer to a started ChecksumState. It cannot be fed afterwards.
+ * @param hex Receives the digest; CHECKSUM_HEX_SIZE bytes are enough for any kind.
+ */
+void checksum_final(ChecksumState* state, char hex[CHECKSUM_HEX_SIZE]);
+
+/**
+ * @brief Returns the display name of a kind (e.g., "SHA-256").
+ */
+const char* checksum_kind_name(ChecksumKind kind);
+
+/**
+ * @brief Parses the name of a kind, as written in the configuration.
+ *
+ * Case and dashes are ignored, so "SHA-256" and "sha256" both parse.
+ *
+ * @param name The name.
+ * @param kind Set to the kind.
+ * @return True if the name is known.
+ */
+bool checksum_kind_from_name(const char* name, ChecksumKind* kind);
+
+/**
+ * @brief Returns a note on how a kind is computed on this machine (e.g., "SSE4.2"), or NULL for the portable code.
+ */
+const char* checksum_kind_acceleration(ChecksumKind kind);
+
+/**
+ * @brief Starts computing checksums of a file in the background.
+ *
+ * @param sums Pointer to the Checksums to initialize.
+ * @param path The path of a regular file or block device.
+ * @param size The size of the file, for the progress.
+ * @param kinds The kinds to compute.
+ * @param kind_count The number of kinds, at least 1.
+ * @return FAT_SUCCESS, or FAT_ERROR_MEMORY.
+ */
+FatResult checksums_start(Checksums* sums, const char* path, uint64_t size, const ChecksumKind* kinds, size_t kind_count);
+
+/**
+ * @brief Sets up checksums whose values are already known, such as the CRC-32 an archive stores for an entry.
+ *
+ * @param sums Pointer to the Checksums to initialize.
+ * @param subject What the values are of. It is copied.
+ * @param kind The kind of the value.
+ * @param value The value, as hex.
+ * @return FAT_SUCCESS, or FAT_ERROR_MEMORY.
+ */
+FatResult checksums_set_stored(Checksums* sums, const char* subject, ChecksumKind kind, const char* value);
+
+/**
+ * @brief Adopts the progress and, once the job ends, the digests.
+ * @param sums Pointer to started Checksums.
+ * @return True if anything changed.
+ */
+bool checksums_poll(Checksums* sums);
+
+/**
+ * @brief Returns true until the job has ended and been adopted.
+ */
+bool checksums_is_running(const Checksums* sums);
+
+/**
+ * @brief Stops the job and frees the checksums.
+ * @param sums Pointer to the Checksums to free. It is left in an empty state.
+ */
+void checksums_free(Checksums* sums);
+
+#endif // CHECKSUM_H
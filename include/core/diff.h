@@ -0,0 +1,149 @@
+/**
+ * @file diff.h
+ * @author Zuhaitz (original)
+ * @brief Defines the line diff engine used by the side-by-side diff view.
+ *
+ * Both files are opened through a LineIndex and every line is hashed once.
+ * The alignment is computed with patience diff: lines that occur exactly once
+ * in both files anchor the alignment, and the regions between anchors are
+ * resolved recursively, falling back to Myers' O(ND) algorithm where no
+ * unique lines remain.
+ *
+ * The diff runs on a background thread. Runs are published in file order as
+ * soon as they are known, so the top of the diff can be shown and scrolled
+ * while the rest is still being computed.
+ */
+#ifndef DIFF_H
+#define DIFF_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "core/line_index.h"
+#include "core/error.h"
+
+/**
+ * @struct DiffRun
+ * @brief A block of consecutive lines that are either equal or changed.
+ *
+ * An equal run has `a_len == b_len`. A changed run replaces `a_len` lines of
+ * the left file with `b_len` lines of the right file (either may be zero)
+ * and takes `max(a_len, b_len)` display rows.
+ */
+typedef struct {
+    size_t a_start;     /**< The first line of the run in the left file. */
+    size_t a_len;       /**< The number of left file lines in the run. */
+    size_t b_start;     /**< The first line of the run in the right file. */
+    size_t b_len;       /**< The number of right file lines in the run. */
+    size_t row;         /**< The first display row of the run. */
+    size_t hunk;        /**< The zero-based hunk number of a changed run. */
+    bool is_change;     /**< True for a hunk, false for lines both files share. */
+} DiffRun;
+
+/**
+ * @struct DiffRow
+ * @brief What to show on one display row of the side-by-side view.
+ */
+typedef struct {
+    size_t a_line;      /**< The left file line, valid if `has_a`. */
+    size_t b_line;      /**< The right file line, valid if `has_b`. */
+    bool has_a;         /**< False if the row has no left file line. */
+    bool has_b;         /**< False if the row has no right file line. */
+    bool is_change;     /**< True if the row belongs to a hunk. */
+} DiffRow;
+
+/**
+ * @struct DiffProgress
+ * @brief A consistent snapshot of how far the background diff has got.
+ */
+typedef struct {
+    size_t row_count;       /**< The number of display rows known so far. */
+    size_t hunk_count;      /**< The number of hunks found so far. */
+    size_t lines_removed;   /**< Left file lines in hunks so far. */
+    size_t lines_added;     /**< Right file lines in hunks so far. */
+    bool is_done;           /**< True once the whole diff has been computed. */
+} DiffProgress;
+
+/**
+ * @struct DiffView
+ * @brief Two indexed files and the alignment computed between them.
+ *
+ * `a` and `b` are immutable once `diff_start` returns and may be read
+ * without locking. Everything else is shared with the worker thread and is
+ * only accessed through the functions below.
+ */
+typedef struct {
+    char* path_a;               /**< The path of the left file. */
+    char* path_b;               /**< The path of the right file. */
+    LineIndex a;                /**< The left (old) file. */
+    LineIndex b;                /**< The right (new) file. */
+    uint64_t* hash_a;           /**< One hash per left file line. */
+    uint64_t* hash_b;           /**< One hash per right file line. */
+
+    DiffRun* runs;              /**< The runs published so far, in file order. */
+    size_t run_count;           /**< The number of published runs. */
+    size_t run_capacity;        /**< The allocated capacity of `runs`. */
+    DiffProgress progress;      /**< Counters matching the published runs. */
+    bool cancel;                /**< Set to ask the worker to stop early. */
+
+    pthread_mutex_t lock;       /**< Protects `runs`, `progress` and `cancel`. */
+    pthread_t thread;           /**< The worker thread. */
+    bool has_thread;            /**< True if `thread` must be joined. */
+} DiffView;
+
+/**
+ * @brief Opens two files and starts diffing them in the background.
+ *
+ * @param view Pointer to the DiffView to initialize.
+ * @param path_a The path of the left (old) file.
+ * @param path_b The path of the right (new) file.
+ * @return FAT_SUCCESS on success, or an error code if either file cannot be opened.
+ */
+FatResult diff_start(DiffView* view, const char* path_a, const char* path_b);
+
+/**
+ * @brief Returns a snapshot of the diff's progress.
+ * @param view Pointer to a started DiffView.
+ * @param out Set to the current progress.
+ */
+void diff_get_progress(DiffView* view, DiffProgress* out);
+
+/**
+ * @brief Copies the description of consecutive display rows.
+ *
+ * @param view Pointer to a started DiffView.
+ * @param first The first display row to copy.
+ * @param count The maximum number of rows to copy.
+ * @param out Array of at least `count` rows.
+ * @return The number of rows copied, which is lower than `count` near the end
+ * of the rows known so far.
+ */
+size_t diff_get_rows(DiffView* view, size_t first, size_t count, DiffRow* out);
+
+/**
+ * @brief Finds the start of the next or previous hunk.
+ *
+ * @param view Pointer to a started DiffView.
+ * @param row The display row to search from.
+ * @param forward True to search below `row`, false to search above it.
+ * @param out_row Set to the first display row of the hunk found.
+ * @param out_index Set to the zero-based index of the hunk found. May be NULL.
+ * @return True if a hunk was found.
+ */
+bool diff_find_hunk(DiffView* view, size_t row, bool forward, size_t* out_row, size_t* out_index);
+
+/**
+ * @brief Returns the heap memory held by both files, their line hashes and the runs.
+ * @param view Pointer to the DiffView.
+ * @return The approximate heap usage in bytes.
+ */
+size_t diff_memory_usage(DiffView* view);
+
+/**
+ * @brief Stops the worker thread and frees everything owned by the view.
+ * @param view Pointer to the DiffView to free. It is left in an empty state.
+ */
+void diff_free(DiffView* view);
+
+#endif // DIFF_H
@@ -0,0 +1,149 @@
+/**
+ * @file dir_listing.h
+ * @author Zuhaitz (original)
+ * @brief Defines the directory listing used by the directory view.
+ *
+ * Opening a directory only reads its entry names and types, which the kernel
+ * returns in bulk. Everything that needs one system call per entry is
+ * deferred: sizes and timestamps are fetched when a row is first drawn, and
+ * MIME sniffing and plugin probing run on a small pool of background threads
+ * that start with the rows on screen.
+ */
+#ifndef DIR_LISTING_H
+#define DIR_LISTING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include "core/error.h"
+
+/** @brief The maximum number of threads probing MIME types for one listing. */
+#define DIR_PROBE_MAX_THREADS 4
+
+/**
+ * @enum DirEntryType
+ * @brief The kind of a directory entry, as far as it is known.
+ */
+typedef enum {
+    DIR_ENTRY_UNKNOWN,  /**< The file system did not report a type. */
+    DIR_ENTRY_FILE,     /**< A regular file. */
+    DIR_ENTRY_DIR,      /**< A directory. */
+    DIR_ENTRY_LINK,     /**< A symbolic link. */
+    DIR_ENTRY_OTHER     /**< A device, socket or pipe. */
+} DirEntryType;
+
+/**
+ * @enum DirProbeState
+ * @brief How far the background probe of an entry has got.
+ */
+typedef enum {
+    DIR_PROBE_PENDING,  /**< Not picked up by a worker yet. */
+    DIR_PROBE_RUNNING,  /**< A worker is probing the entry. */
+    DIR_PROBE_DONE      /**< `mime` and `handler_name` are final. */
+} DirProbeState;
+
+/**
+ * @struct DirEntry
+ * @brief One entry of a directory.
+ */
+typedef struct {
+    char* name;                 /**< The entry name, without the directory path. */
+    DirEntryType type;          /**< The entry type reported when listing. */
+
+    // Filled lazily on the UI thread by dir_listing_stat.
+    bool is_stat_done;          /**< True once the fields below have been fetched. */
+    bool stat_failed;           /**< True if the entry could not be stat'ed. */
+    uint64_t size;              /**< The size in bytes. */
+    time_t mtime;               /**< The modification time. */
+
+    // Filled by the probe pool, protected by the listing lock.
+    DirProbeState probe_state;  /**< The progress of the background probe. */
+    char* mime;                 /**< The MIME type, or NULL if unknown. */
+    const char* handler_name;   /**< The archive plugin that can open the entry, or NULL. */
+} DirEntry;
+
+/**
+ * @struct DirListing
+ * @brief The sorted entries of a directory and the pool probing them.
+ */
+typedef struct {
+    char* path;                 /**< The directory path. */
+    DirEntry* entries;          /**< Directories first, then files, each sorted by name. */
+    size_t count;               /**< The number of entries. The array never changes size after opening. */
+
+    pthread_mutex_t lock;       /**< Protects the probe fields of the entries and the fields below. */
+    size_t next_probe;          /**< Entries before this index have been picked up. */
+    size_t priority_start;      /**< The first row on screen, probed before anything else. */
+    size_t probes_left;         /**< Entries whose probe has not finished. */
+    bool cancel;                /**< Set to ask the workers to stop. */
+    pthread_t threads[DIR_PROBE_MAX_THREADS]; /**< The probe workers. */
+    int thread_count;           /**< The number of started workers. */
+} DirListing;
+
+/**
+ * @brief Lists a directory and starts probing its entries in the background.
+ *
+ * On Linux the entries are read with `getdents64`, elsewhere with `readdir`.
+ * A ".." entry is added unless the directory is the root.
+ *
+ * @param listing Pointer to the DirListing to initialize.
+ * @param path The path of the directory.
+ * @return FAT_SUCCESS on success, or an error code if the directory cannot be read.
+ */
+FatResult dir_listing_open(DirListing* listing, const char* path);
+
+/**
+ * @brief Fetches the size and modification time of an entry if not done yet.
+ *
+ * Must only be called from the UI thread.
+ *
+ * @param listing Pointer to an open DirListing.
+ * @param idx The index of the entry.
+ */
+void dir_listing_stat(DirListing* listing, size_t idx);
+
+/**
+ * @brief Makes the pool probe the entries starting at `first` next.
+ * @param listing Pointer to an open DirListing.
+ * @param first The first entry currently on screen.
+ */
+void dir_listing_prioritize(DirListing* listing, size_t first);
+
+/**
+ * @brief Copies the probe result of an entry.
+ *
+ * @param listing Pointer to an open DirListing.
+ * @param idx The index of the entry.
+ * @param mime Buffer receiving the MIME type, or an empty string if unknown.
+ * @param mime_size The size of `mime`.
+ * @param handler_name Set to the name of the plugin that can open the entry, or NULL.
+ * @return True if the probe has finished, false if it is still pending.
+ */
+bool dir_listing_get_probe(DirListing* listing, size_t idx, char* mime, size_t mime_size, const char** handler_name);
+
+/**
+ * @brief Returns true while entries are still being probed.
+ * @param listing Pointer to an open DirListing.
+ */
+bool dir_listing_is_probing(DirListing* listing);
+
+/**
+ * @brief Builds the full path of an entry.
+ *
+ * @param listing Pointer to an open DirListing.
+ * @param idx The index of the entry.
+ * @param out Buffer receiving the path.
+ * @param out_size The size of `out`.
+ * @return FAT_SUCCESS, or FAT_ERROR_INVALID_ARGUMENT if the path does not fit.
+ */
+FatResult dir_listing_entry_path(const DirListing* listing, size_t idx, char* out, size_t out_size);
+
+/**
+ * @brief Stops the probe pool and frees the listing.
+ * @param listing Pointer to the DirListing to free. It is left in an empty state.
+ */
+void dir_listing_free(DirListing* listing);
+
+#endif // DIR_LISTING_H
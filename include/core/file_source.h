@@ -0,0 +1,138 @@
+/**
+ * @file file_source.h
+ * @author Zuhaitz (original)
+ * @brief Defines how a path is read, whatever kind of file it names.
+ *
+ * A path is one of three kinds of source. Regular files have a size and are
+ * memory-mapped. Block devices report a size of zero, so theirs is asked of
+ * the kernel (BLKGETSIZE64); they are mapped too, and can be read with
+ * pread in whole logical blocks, through O_DIRECT if the page cache should
+ * be left alone. Everything else (FIFOs, character devices, and the files of
+ * /proc, which claim to be empty) is a stream: it has no size and can only
+ * be read front to back, in chunks, until it ends.
+ */
+#ifndef FILE_SOURCE_H
+#define FILE_SOURCE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "core/error.h"
+
+/** @brief The size of each read of a stream. */
+#define FILE_SOURCE_CHUNK_SIZE (64 * 1024)
+
+/** @brief The most bytes read from a source that cannot be mapped; the rest is left out. */
+#define FILE_SOURCE_READ_LIMIT ((size_t)256 * 1024 * 1024)
+
+/** @brief The most bytes read from a settings file (a theme, the key bindings). */
+#define FILE_SOURCE_SETTINGS_LIMIT ((size_t)4 * 1024 * 1024)
+
+/**
+ * @enum FileSourceKind
+ * @brief How the bytes behind a path can be reached.
+ */
+typedef enum {
+    FILE_SOURCE_REGULAR,        /**< A file with a size, read through a mapping. */
+    FILE_SOURCE_BLOCK_DEVICE,   /**< A disk or partition: sized by the kernel, mapped or read block by block. */
+    FILE_SOURCE_STREAM          /**< A FIFO, character device or /proc file: no size, read front to back. */
+} FileSourceKind;
+
+/**
+ * @struct FileSource
+ * @brief An open source and what is known of it.
+ */
+typedef struct {
+    int fd;                     /**< The open descriptor, or -1. */
+    FileSourceKind kind;        /**< How the source is read. */
+    uint64_t size;              /**< The size in bytes; 0 for a stream. */
+    size_t block_size;          /**< The alignment of direct reads (the logical block size), or 1. */
+    bool direct;                /**< True if the descriptor was opened with O_DIRECT. */
+} FileSource;
+
+/**
+ * @brief Finds out how a path would be read, without reading it.
+ *
+ * FIFOs are not opened, since that blocks until a writer turns up.
+ *
+ * @param path The path to inspect.
+ * @param kind Set to the kind of source.
+ * @param size Set to the size in bytes, or 0 for a stream. May be NULL.
+ * @return FAT_SUCCESS, or FAT_ERROR_FILE_NOT_FOUND if the path cannot be inspected.
+ */
+FatResult file_source_probe(const char* path, FileSourceKind* kind, uint64_t* size);
+
+/**
+ * @brief Opens a path for reading and finds out its kind and size.
+ *
+ * @param source Pointer to the FileSource to initialize.
+ * @param path The path to open.
+ * @param direct True to bypass the page cache (O_DIRECT) when reading a block device.
+ *               It is ignored for other sources, and if the device refuses it.
+ * @return FAT_SUCCESS, or FAT_ERROR_FILE_READ if the path cannot be opened.
+ */
+FatResult file_source_open(FileSource* source, const char* path, bool direct);
+
+/**
+ * @brief Reads bytes at an offset of a regular file or block device.
+ *
+ * Direct reads go through a buffer aligned to the block size, so any offset
+ * and length may be asked for.
+ *
+ * @param source Pointer to an open FileSource that is not a stream.
+ * @param buffer Where to store the bytes.
+ * @param length The number of bytes wanted.
+ * @param offset Where to start reading.
+ * @param read_count Set to the number of bytes stored; fewer than asked at the end of the source.
+ * @return FAT_SUCCESS, or FAT_ERROR_FILE_READ on a read error.
+ */
+FatResult file_source_read_at(FileSource* source, void* buffer, size_t length, uint64_t offset, size_t* read_count);
+
+/**
+ * @brief Reads a source into a heap buffer, up to a limit.
+ *
+ * Sources with a size are read from their start, streams from wherever
+ * they are. The buffer is null-terminated, one byte past `size`.
+ *
+ * @param source Pointer to an open FileSource.
+ * @param limit The most bytes to read.
+ * @param data Set to the heap buffer. The caller must free it.
+ * @param size Set to the number of bytes read.
+ * @param truncated Set to true if the source had more than `limit` bytes. May be NULL.
+ * @return FAT_SUCCESS, or an error code (e.g., FAT_ERROR_MEMORY) on failure.
+ */
+FatResult file_source_read_all(FileSource* source, size_t limit, char** data, size_t* size, bool* truncated);
+
+/**
+ * @brief Opens a path, reads it whole up to a limit, and closes it.
+ *
+ * This is for small files read once, such as settings, which may well be
+ * pipes or process substitutions.
+ *
+ * @param path The path to read.
+ * @param limit The most bytes to read.
+ * @param data Set to the null-terminated heap buffer. The caller must free it.
+ * @param size Set to the number of bytes read. May be NULL.
+ * @return FAT_SUCCESS, or an error code (e.g., FAT_ERROR_FILE_READ) on failure.
+ */
+FatResult file_source_read_file(const char* path, size_t limit, char** data, size_t* size);
+
+/**
+ * @brief Hands the descriptor over to the caller, who becomes responsible for closing it.
+ * @param source Pointer to an open FileSource. It is left closed.
+ * @return The descriptor.
+ */
+int file_source_release(FileSource* source);
+
+/**
+ * @brief Closes the source.
+ * @param source Pointer to the FileSource to close. It is left in a closed state.
+ */
+void file_source_close(FileSource* source);
+
+/**
+ * @brief Returns a short name for a kind of source, for the metadata pane.
+ */
+const char* file_source_kind_name(FileSourceKind kind);
+
+#endif // FILE_SOURCE_H
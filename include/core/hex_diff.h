@@ -0,0 +1,151 @@
+/**
+ * @file hex_diff.h
+ * @author Zuhaitz (original)
+ * @brief Defines the binary diff shown as two hex dumps side by side.
+ *
+ * Both files are mapped through a HexView, so rows are formatted only as
+ * they are drawn, however large the images are. A background thread
+ * compares the mappings 64 bytes at a time, sixteen bytes per SSE2
+ * comparison, into a bitmask of the bytes that differ. Identical blocks
+ * cost a single test, and the differing bytes of a block are walked as runs
+ * of set bits. Runs a few bytes apart are merged into one range, so the
+ * next and previous difference land on changes rather than on every byte.
+ */
+#ifndef HEX_DIFF_H
+#define HEX_DIFF_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "plugins/hex_viewer_api.h"
+#include "core/error.h"
+
+/** @brief The most ranges kept; the comparison stops once it has found this many. */
+#define HEX_DIFF_MAX_RANGES 1000000
+
+/** @brief Differing bytes at most this many equal bytes apart belong to the same range. */
+#define HEX_DIFF_MERGE_GAP 16
+
+/** @brief How many bytes the background comparison covers between two updates of the shared ranges. */
+#define HEX_DIFF_PUBLISH_BYTES (4 * 1024 * 1024)
+
+/**
+ * @struct HexDiffRange
+ * @brief A stretch of the files holding differing bytes, and the few equal bytes between them.
+ */
+typedef struct {
+    uint64_t offset;            /**< The offset of the first differing byte. */
+    uint64_t length;            /**< The bytes up to and including the last differing one. */
+} HexDiffRange;
+
+/**
+ * @struct HexDiff
+ * @brief Two mapped files and the ranges where their bytes differ.
+ *
+ * The bytes of `a` and `b` are immutable once `hex_diff_start` returns and
+ * are read by the worker without locking; their layout belongs to the UI
+ * thread.
+ */
+typedef struct {
+    char* path_a;               /**< The path of the left file. */
+    char* path_b;               /**< The path of the right file. */
+    HexView a;                  /**< The left (old) file. */
+    HexView b;                  /**< The right (new) file. */
+    size_t row_count;           /**< The rows of the longer file. */
+
+    // **Shared with the background comparison (protected by `lock`)**
+    pthread_mutex_t lock;
+    HexDiffRange* found;        /**< The ranges found since the last poll, in file order. */
+    size_t found_count;         /**< The number of ranges in `found`. */
+    size_t found_capacity;      /**< The allocated capacity of `found`. */
+    uint64_t compared;          /**< The number of bytes compared so far. */
+    uint64_t differing;         /**< The number of differing bytes so far, the tail of the longer file included. */
+    bool finished;              /**< Set once both files have been compared to the end. */
+    bool truncated;             /**< Set if the comparison stopped at HEX_DIFF_MAX_RANGES. */
+    bool cancel;                /**< Set to ask the comparison to stop. */
+
+    // **UI thread only**
+    HexDiffRange* ranges;       /**< The ranges adopted so far, in file order. */
+    size_t count;               /**< The number of ranges in `ranges`. */
+    size_t capacity;            /**< The allocated capacity of `ranges`. */
+    uint64_t compared_done;     /**< The value of `compared` at the last poll. */
+    uint64_t differing_done;    /**< The value of `differing` at the last poll. */
+    bool done;                  /**< Set once the last range has been adopted. */
+    bool failed;                /**< Set if the ranges could not be stored; they are shown as far as they got. */
+
+    pthread_t thread;
+    bool has_thread;            /**< True if the background comparison was started. */
+} HexDiff;
+
+/**
+ * @brief Maps two files and starts comparing them in the background.
+ *
+ * Rows adapt to the width of the pane whatever the configured bytes per
+ * row, and the integer column is left out, so that two rows fit side by
+ * side.
+ *
+ * @param diff Pointer to the HexDiff to initialize.
+ * @param path_a The path of the left file.
+ * @param path_b The path of the right file.
+ * @param layout The configured hex layout.
+ * @return FAT_SUCCESS, or an error code (e.g., FAT_ERROR_FILE_READ) on failure.
+ */
+FatResult hex_diff_start(HexDiff* diff, const char* path_a, const char* path_b, const HexLayout* layout);
+
+/**
+ * @brief Picks the widest row that fits each side of the pane.
+ *
+ * Both sides always show the same bytes per row, so equal offsets line up.
+ *
+ * @param diff Pointer to a started HexDiff.
+ * @param width The number of columns available for a row on each side.
+ * @return True if the number of bytes per row changed.
+ */
+bool hex_diff_fit(HexDiff* diff, int width);
+
+/**
+ * @brief Adopts the ranges found since the last call.
+ * @param diff Pointer to a started HexDiff.
+ * @return True if ranges were added or the comparison moved on.
+ */
+bool hex_diff_poll(HexDiff* diff);
+
+/**
+ * @brief Returns true until both files have been compared and every range adopted.
+ * @param diff Pointer to a started HexDiff.
+ */
+bool hex_diff_is_running(const HexDiff* diff);
+
+/**
+ * @brief Finds the nearest range that starts past, or before, a file offset.
+ *
+ * @param diff Pointer to a started HexDiff.
+ * @param offset A file offset.
+ * @param forward True for the first range starting at or after `offset`, false for the last one starting before it.
+ * @param range_offset Set to the offset of the range found.
+ * @return True if such a range has been found.
+ */
+bool hex_diff_find(const HexDiff* diff, uint64_t offset, bool forward, uint64_t* range_offset);
+
+/**
+ * @brief Returns true if the byte at an offset differs, or is only in one of the files.
+ * @param diff Pointer to a started HexDiff.
+ * @param offset A file offset.
+ */
+bool hex_diff_byte_differs(const HexDiff* diff, uint64_t offset);
+
+/**
+ * @brief Returns the heap memory held by both files and the ranges, those not yet adopted included.
+ * @param diff Pointer to the HexDiff.
+ * @return The approximate heap usage in bytes.
+ */
+size_t hex_diff_memory_usage(HexDiff* diff);
+
+/**
+ * @brief Stops the background comparison, unmaps both files and frees the ranges.
+ * @param diff Pointer to the HexDiff to free. It is left in an empty state.
+ */
+void hex_diff_free(HexDiff* diff);
+
+#endif // HEX_DIFF_H
@@ -0,0 +1,123 @@
+/**
+ * @file json_view.h
+ * @author Zuhaitz (original)
+ * @brief Defines the collapsible tree view of JSON and NDJSON files.
+ *
+ * Opening a file only builds a structural index: one bit per byte marking
+ * the `{ } [ ] : ,` characters that are not inside strings, computed 64
+ * bytes at a time like the first stage of simdjson. Nothing is parsed into
+ * a DOM. The tree is a list of rows covering only the containers the user
+ * has expanded; expanding one walks the index between its brackets to find
+ * its children, and every row is pretty-printed from the file bytes when it
+ * is drawn. Memory is one bit per file byte plus one row per visible value.
+ *
+ * A file holding several top-level values, such as NDJSON, shows one row
+ * per value.
+ */
+#ifndef JSON_VIEW_H
+#define JSON_VIEW_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "core/line_index.h"
+#include "core/error.h"
+
+/** @brief The longest row rendered, in bytes. Longer values are cut with an ellipsis. */
+#define JSON_ROW_MAX_BYTES 4096
+
+/**
+ * @enum JsonRowFlags
+ * @brief Flags describing a row of the tree.
+ */
+typedef enum {
+    JSON_ROW_MEMBER    = 1 << 0,    /**< The row is an object member and starts with its key. */
+    JSON_ROW_CONTAINER = 1 << 1,    /**< The value is an object or an array. */
+    JSON_ROW_EXPANDED  = 1 << 2,    /**< The container's children follow the row. */
+    JSON_ROW_CLOSE     = 1 << 3     /**< The row is the closing bracket of an expanded container. */
+} JsonRowFlags;
+
+/**
+ * @struct JsonRow
+ * @brief One row of the tree.
+ */
+typedef struct {
+    uint64_t offset;    /**< The key of a member, else the value; the bracket of a CLOSE row. */
+    uint32_t items;     /**< The number of children of a container. */
+    uint32_t span;      /**< The length of a container value in bytes, capped at UINT32_MAX. */
+    uint16_t depth;     /**< The nesting level, 0 for top-level values. */
+    uint8_t flags;      /**< A combination of JsonRowFlags. */
+} JsonRow;
+
+/**
+ * @struct JsonView
+ * @brief A JSON file, its structural index and the rows currently shown.
+ */
+typedef struct {
+    LineIndex text;         /**< The file bytes. */
+    uint64_t* structural;   /**< One bit per byte, set on structural characters outside strings. */
+    size_t word_count;      /**< The number of 64-bit words in `structural`. */
+    JsonRow* rows;          /**< The rows of the tree, in display order. */
+    size_t row_count;       /**< The number of rows. */
+    size_t row_capacity;    /**< The allocated capacity of `rows`. */
+    size_t value_count;     /**< The number of top-level values. */
+    char* scratch;          /**< The buffer rows are rendered into. */
+} JsonView;
+
+/**
+ * @brief Returns true if a file should be shown as JSON.
+ *
+ * @param path The path of the file.
+ * @param mime The MIME type reported by libmagic, or NULL if unknown.
+ * @return True for JSON MIME types and the .json, .jsonl, .ndjson and .geojson extensions.
+ */
+bool json_view_detect(const char* path, const char* mime);
+
+/**
+ * @brief Opens a file and builds its structural index.
+ *
+ * A file with a single top-level container opens with that container expanded.
+ *
+ * @param view Pointer to the JsonView to initialize.
+ * @param path The path of the file.
+ * @return FAT_SUCCESS on success, or an error code if the file cannot be read.
+ */
+FatResult json_view_open(JsonView* view, const char* path);
+
+/**
+ * @brief Renders a row of the tree.
+ *
+ * The returned pointer is NOT null-terminated and stays valid until the next call.
+ *
+ * @param view Pointer to an open JsonView.
+ * @param row The index of the row.
+ * @param len Set to the length of the rendered row in bytes.
+ * @return The rendered row, or NULL if `row` is out of range.
+ */
+const char* json_view_get_row(const JsonView* view, size_t row, size_t* len);
+
+/**
+ * @brief Expands a collapsed container or collapses an expanded one.
+ *
+ * On a closing bracket, the container it closes is collapsed.
+ *
+ * @param view Pointer to an open JsonView.
+ * @param row The index of the row. Set to the row of the toggled container.
+ * @return FAT_SUCCESS, FAT_ERROR_UNSUPPORTED if the row is not a container, or FAT_ERROR_MEMORY.
+ */
+FatResult json_view_toggle(JsonView* view, size_t* row);
+
+/**
+ * @brief Returns the heap memory held by the view: the text, the structural bitmap and the rows.
+ * @param view Pointer to the JsonView.
+ * @return The approximate heap usage in bytes.
+ */
+size_t json_view_memory_usage(const JsonView* view);
+
+/**
+ * @brief Frees the view.
+ * @param view Pointer to the JsonView to free. It is left in an empty state.
+ */
+void json_view_free(JsonView* view);
+
+#endif // JSON_VIEW_H
@@ -0,0 +1,53 @@
+/**
+ * @file line_cache.h
+ * @author Zuhaitz (original)
+ * @brief Defines the on-disk cache of line indexes for huge text files.
+ *
+ * Indexing a multi-gigabyte file means reading every byte of it. For files
+ * above LINE_CACHE_MIN_SIZE the line offsets are saved in a sidecar under
+ * the configuration directory, delta and varint encoded, and keyed by the
+ * file's device and inode. The sidecar also records the size and
+ * modification time, so an unchanged file is recognised without reading it,
+ * and hashes of the first and last bytes it covered, so a file that has only
+ * been appended to reuses the cached offsets and indexes just the new tail.
+ */
+#ifndef LINE_CACHE_H
+#define LINE_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "core/line_index.h"
+
+/** @brief Files smaller than this are indexed faster than their sidecar can be read. */
+#define LINE_CACHE_MIN_SIZE ((size_t)64 * 1024 * 1024)
+
+/** @brief The most sidecars kept; the least recently written are removed beyond it. */
+#define LINE_CACHE_MAX_FILES 64
+
+/**
+ * @brief Restores the line offsets of a loaded file from its sidecar.
+ *
+ * On success the index holds the offsets, count and longest line length the
+ * sidecar describes. If the file has grown since, the last cached line is
+ * dropped, as it may have been extended, and `resume` is where indexing
+ * must continue; otherwise it is the size of the file.
+ *
+ * @param index A LineIndex loaded with `line_index_load` and not yet built.
+ * @param path The path the file was loaded from.
+ * @param resume Set to the byte offset from which the remaining lines must be indexed.
+ * @return True if offsets were restored, false if there is no valid sidecar.
+ */
+bool line_cache_restore(LineIndex* index, const char* path, size_t* resume);
+
+/**
+ * @brief Saves the line offsets of a file to its sidecar, if the file is large enough.
+ *
+ * The sidecar is written to a temporary file and renamed into place, so a
+ * crash never leaves a truncated one behind. Failures are only logged.
+ *
+ * @param index A built LineIndex.
+ * @param path The path the file was loaded from.
+ */
+void line_cache_save(const LineIndex* index, const char* path);
+
+#endif // LINE_CACHE_H
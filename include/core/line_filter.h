@@ -0,0 +1,167 @@
+/**
+ * @file line_filter.h
+ * @author Zuhaitz (original)
+ * @brief Defines filter expressions and the background job that applies them.
+ *
+ * A filter keeps the line numbers of the lines that match an expression, so
+ * the filtered view costs one number per matching line and never copies
+ * text. Expressions combine terms with AND, OR and NOT:
+ *
+ *     level=error !healthcheck
+ *     (timeout | "connection reset") & service=api
+ *
+ * A bare or quoted word matches anywhere in the line, case-sensitively.
+ * `key=value` matches a logfmt field (`key=value`, `key="value"`) or a JSON
+ * member (`"key": "value"`) whose value equals `value`, ignoring case.
+ * Terms next to each other are ANDed; `&`, `&&` and `AND` say so explicitly,
+ * `|`, `||` and `OR` combine alternatives and `!` or `NOT` negates.
+ *
+ * The lines are split into fixed-size chunks that a pool of threads
+ * evaluates in parallel. Results are adopted in line order, so the filtered
+ * view grows from the top while the rest of the file is still being scanned.
+ */
+#ifndef LINE_FILTER_H
+#define LINE_FILTER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+#include "core/error.h"
+
+/** @brief The maximum number of threads evaluating one filter. */
+#define FILTER_MAX_THREADS 8
+
+/**
+ * @enum FilterNodeKind
+ * @brief The kind of a node in a parsed filter expression.
+ */
+typedef enum {
+    FILTER_NODE_TEXT,   /**< Matches lines containing `text`. */
+    FILTER_NODE_FIELD,  /**< Matches lines with a field `key` whose value is `text`. */
+    FILTER_NODE_AND,    /**< Matches if both children match. */
+    FILTER_NODE_OR,     /**< Matches if either child matches. */
+    FILTER_NODE_NOT     /**< Matches if the left child does not. */
+} FilterNodeKind;
+
+/**
+ * @struct FilterNode
+ * @brief A node of a parsed filter expression.
+ */
+typedef struct FilterNode {
+    FilterNodeKind kind;        /**< What the node tests. */
+    char* key;                  /**< The field name of a FIELD node. */
+    size_t key_len;             /**< The length of `key`. */
+    char* text;                 /**< The text or field value to look for. */
+    size_t text_len;            /**< The length of `text`. */
+    struct FilterNode* left;    /**< The first operand of AND/OR, or the operand of NOT. */
+    struct FilterNode* right;   /**< The second operand of AND/OR. */
+} FilterNode;
+
+/**
+ * @brief Returns a line of the filtered source. The line does not need to be null-terminated.
+ */
+typedef const char* (*FilterLineGetter)(const void* source, size_t idx, size_t* len);
+
+/**
+ * @struct LineFilter
+ * @brief A filter expression and the line numbers that match it.
+ */
+typedef struct {
+    char* text;                 /**< The expression as typed. */
+    FilterNode* expr;           /**< The parsed expression. Read-only once started. */
+    FilterLineGetter get_line;  /**< Reads a line of the source. */
+    void* source;               /**< A private copy of the source descriptor given to `line_filter_start`. */
+    size_t source_count;        /**< The number of lines in the source. */
+
+    // **Shared with the workers (protected by `lock`)**
+    pthread_mutex_t lock;
+    size_t chunk_count;         /**< The number of chunks the source is split into. */
+    size_t next_chunk;          /**< The next chunk a worker will claim. */
+    size_t** chunk_lines;       /**< The matching line numbers of each finished chunk. */
+    size_t* chunk_matches;      /**< The number of entries in each `chunk_lines` array. */
+    bool* chunk_done;           /**< True once a chunk has been evaluated. */
+    bool cancel;                /**< Set to ask the workers to stop. */
+    bool failed;                /**< Set if a worker ran out of memory. */
+
+    // **UI thread only**
+    size_t* lines;              /**< The matching line numbers adopted so far, in order. */
+    size_t count;               /**< The number of entries in `lines`. */
+    size_t capacity;            /**< The allocated capacity of `lines`. */
+    size_t adopted_chunks;      /**< The number of leading chunks merged into `lines`. */
+
+    pthread_t threads[FILTER_MAX_THREADS]; /**< The workers. */
+    int thread_count;           /**< The number of started workers. */
+} LineFilter;
+
+/**
+ * @brief Parses a filter expression.
+ *
+ * @param text The expression.
+ * @param out Set to the root of the parsed expression on success.
+ * @param error Buffer receiving a description of the problem on failure.
+ * @param error_size The size of `error`.
+ * @return FAT_SUCCESS, FAT_ERROR_INVALID_ARGUMENT for a syntax error, or FAT_ERROR_MEMORY.
+ */
+FatResult filter_parse(const char* text, FilterNode** out, char* error, size_t error_size);
+
+/**
+ * @brief Evaluates a parsed expression against one line.
+ * @param node The root of a parsed expression.
+ * @param line The line, which does not need to be null-terminated.
+ * @param len The length of the line in bytes.
+ * @return True if the line matches.
+ */
+bool filter_matches(const FilterNode* node, const char* line, size_t len);
+
+/**
+ * @brief Frees a parsed expression.
+ * @param node The root of the expression, or NULL.
+ */
+void filter_node_free(FilterNode* node);
+
+/**
+ * @brief Parses an expression and starts applying it to a source in the background.
+ *
+ * The source descriptor is copied, so it may live in a struct that is later
+ * moved. The data it refers to must stay valid until `line_filter_free`.
+ *
+ * @param filter Pointer to the LineFilter to initialize.
+ * @param text The filter expression.
+ * @param get_line Reads a line of the source; called concurrently from several threads.
+ * @param source The source descriptor handed to `get_line`.
+ * @param source_size The size in bytes of the source descriptor.
+ * @param line_count The number of lines in the source.
+ * @param error Buffer receiving a description of a syntax error.
+ * @param error_size The size of `error`.
+ * @return FAT_SUCCESS, FAT_ERROR_INVALID_ARGUMENT for a syntax error, or another error code.
+ */
+FatResult line_filter_start(LineFilter* filter, const char* text, FilterLineGetter get_line,
+                            const void* source, size_t source_size, size_t line_count,
+                            char* error, size_t error_size);
+
+/**
+ * @brief Adopts the results of the chunks finished since the last call.
+ * @param filter Pointer to a started LineFilter.
+ * @return True if matching lines were added.
+ */
+bool line_filter_poll(LineFilter* filter);
+
+/**
+ * @brief Returns true until every chunk has been adopted.
+ * @param filter Pointer to a started LineFilter.
+ */
+bool line_filter_is_running(const LineFilter* filter);
+
+/**
+ * @brief Returns how many source lines have been scanned and adopted.
+ * @param filter Pointer to a started LineFilter.
+ */
+size_t line_filter_scanned(const LineFilter* filter);
+
+/**
+ * @brief Stops the workers and frees the filter.
+ * @param filter Pointer to the LineFilter to free. It is left in an empty state.
+ */
+void line_filter_free(LineFilter* filter);
+
+#endif // LINE_FILTER_H
@@ -0,0 +1,211 @@
+/**
+ * @file line_index.h
+ * @author Zuhaitz (original)
+ * @brief Defines the line index used to display text files without copying them.
+ *
+ * A LineIndex keeps the raw bytes of a file (memory-mapped where possible)
+ * together with the byte offset at which every line starts. Lines are
+ * returned as pointers into the file data, so opening a file costs one
+ * offset per line instead of one heap string per line.
+ *
+ * The holes of a sparse file, which the file system reports through
+ * SEEK_HOLE and SEEK_DATA, are recorded too. They read as zeros without
+ * touching the disk, and whatever walks the bytes can skip them.
+ *
+ * A mapped regular file is guarded against being truncated while open (see
+ * map_guard.h): pages past its new end read as zeros instead of raising
+ * SIGBUS, and `line_index_recheck` cuts the index down to the new size.
+ *
+ * Text in an encoding other than UTF-8 (see text_encoding.h) is converted
+ * as it is opened, so `data` always holds UTF-8. The original bytes are
+ * kept alongside, which lets the encoding be switched without reading the
+ * file again.
+ */
+#ifndef LINE_INDEX_H
+#define LINE_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "core/error.h"
+#include "core/text_encoding.h"
+
+/** @brief The smallest hole recorded; smaller ones are walked like any other bytes. */
+#define LINE_INDEX_MIN_HOLE (64 * 1024)
+
+/** @brief The most holes recorded; the rest of a file this fragmented is walked like data. */
+#define LINE_INDEX_MAX_HOLES 65536
+
+/** @brief The size of converted text kept on the heap; larger text is written to a temporary file and mapped. */
+#define LINE_INDEX_TRANSCODE_HEAP_LIMIT ((size_t)16 * 1024 * 1024)
+
+/** @brief The largest file converted from another encoding; larger ones are shown as they are. */
+#define LINE_INDEX_MAX_TRANSCODE ((size_t)1024 * 1024 * 1024)
+
+/**
+ * @struct FileHole
+ * @brief A range of a sparse file with no data on disk, which reads as zeros.
+ */
+typedef struct {
+    size_t offset;          /**< The first byte of the hole. */
+    size_t length;          /**< The number of bytes in the hole. */
+} FileHole;
+
+/**
+ * @struct LineIndex
+ * @brief The bytes of a text file and the start offset of each of its lines.
+ */
+typedef struct {
+    char* data;             /**< The file bytes, mapped read-only or held on the heap. */
+    size_t size;            /**< The number of bytes in `data`. */
+    bool is_mapped;         /**< True if `data` is a memory mapping rather than a heap buffer. */
+    size_t map_size;        /**< The length of the file mapping, which a truncation does not change; 0 if the file was read. */
+    bool is_built;          /**< True if `offsets` describes the current `data`. */
+    size_t* offsets;        /**< The byte offset at which each line starts. */
+    size_t count;           /**< The number of lines. */
+    size_t capacity;        /**< The number of entries allocated in `offsets`. */
+    size_t max_line_len;    /**< The length in bytes of the longest line. */
+    FileHole* holes;        /**< The holes of a mapped sparse file, in file order. */
+    size_t hole_count;      /**< The number of entries in `holes`. */
+    TextEncoding encoding;  /**< The encoding the file is read in. */
+    char* raw;              /**< The file bytes, while `data` holds them converted to UTF-8; otherwise NULL. */
+    size_t raw_size;        /**< The number of bytes in `raw`. */
+    bool raw_is_mapped;     /**< True if `raw` is a memory mapping rather than a heap buffer. */
+} LineIndex;
+
+/**
+ * @brief Initializes a LineIndex to a safe, empty state.
+ * @param index Pointer to the LineIndex to initialize.
+ */
+void line_index_init(LineIndex* index);
+
+/**
+ * @brief Opens a file and indexes its lines.
+ *
+ * Regular files are memory-mapped and their holes recorded, and so are block
+ * devices, sized through file_source.h. Sources that cannot be mapped
+ * (pipes, files that report a size of zero) are read into a heap buffer
+ * instead, up to FILE_SOURCE_READ_LIMIT bytes. Large files that are not in
+ * the page cache yet are indexed through the read pipeline (see
+ * read_pipeline.h). The offsets of very large files are restored from, and
+ * saved to, the line cache (see line_cache.h).
+ *
+ * The encoding of the file is detected, and text in another encoding than
+ * UTF-8 is converted in chunks. Converted text larger than
+ * LINE_INDEX_TRANSCODE_HEAP_LIMIT goes to an unlinked temporary file that
+ * is mapped back, so it costs no more heap than the limit.
+ *
+ * @param index Pointer to the LineIndex to populate. Any previous content is not freed.
+ * @param path The path of the file to open.
+ * @return FAT_SUCCESS on success, or an error code (e.g., FAT_ERROR_FILE_READ) on failure.
+ */
+FatResult line_index_open(LineIndex* index, const char* path);
+
+/**
+ * @brief Maps or reads a file without indexing its lines.
+ *
+ * This is for callers that walk the bytes themselves. `line_index_build` can
+ * index the lines later. The bytes are left in whatever encoding they are.
+ *
+ * @param index Pointer to the LineIndex to populate. Any previous content is not freed.
+ * @param path The path of the file to open.
+ * @return FAT_SUCCESS on success, or an error code (e.g., FAT_ERROR_FILE_READ) on failure.
+ */
+FatResult line_index_load(LineIndex* index, const char* path);
+
+/**
+ * @brief (Re)builds the line offsets over the data already held by the index.
+ *
+ * This is used after `line_index_evict` and never touches the disk.
+ *
+ * @param index Pointer to the LineIndex.
+ * @return FAT_SUCCESS on success, or FAT_ERROR_MEMORY on an allocation failure.
+ */
+FatResult line_index_build(LineIndex* index);
+
+/**
+ * @brief Reads the file in another encoding, converting the bytes already held rather than reopening it.
+ *
+ * The lines are indexed again, so line numbers and offsets taken before
+ * no longer apply.
+ *
+ * @param index Pointer to a LineIndex opened with `line_index_open`.
+ * @param encoding The encoding to read the file in.
+ * @return FAT_SUCCESS, FAT_ERROR_UNSUPPORTED if the file is too large to convert or the
+ *         system cannot convert from the encoding, or another error code on failure.
+ *         If the conversion fails, the index is left as it was.
+ */
+FatResult line_index_set_encoding(LineIndex* index, TextEncoding encoding);
+
+/**
+ * @brief Returns a line of the indexed file.
+ *
+ * The returned pointer points into the file data and is NOT null-terminated.
+ * The trailing newline is not included in the line.
+ *
+ * @param index Pointer to a built LineIndex.
+ * @param line The zero-based line number.
+ * @param len Set to the length of the line in bytes.
+ * @return A pointer to the first byte of the line, or NULL if `line` is out of range.
+ */
+const char* line_index_get(const LineIndex* index, size_t line, size_t* len);
+
+/**
+ * @brief Finds the first hole that ends past an offset.
+ *
+ * @param holes The holes of a file, in file order.
+ * @param hole_count The number of holes.
+ * @param offset A file offset.
+ * @return The index of the hole, which may start past `offset`, or `hole_count` if there is none.
+ */
+size_t line_index_find_hole(const FileHole* holes, size_t hole_count, size_t offset);
+
+/**
+ * @brief Returns the number of heap bytes owned by the index.
+ *
+ * Mapped file data is not counted, as the kernel can reclaim those pages at any time.
+ * Neither is converted text spilled to a temporary file, which is mapped too.
+ *
+ * @param index Pointer to the LineIndex.
+ * @return The approximate heap usage in bytes.
+ */
+size_t line_index_memory_usage(const LineIndex* index);
+
+/**
+ * @brief Returns true, once, if a page of the file mapping was touched past the end of the file.
+ *
+ * The file was truncated after it was mapped. Whatever reads the lines
+ * should be stopped before `line_index_recheck` cuts them down.
+ *
+ * @param index Pointer to the LineIndex.
+ */
+bool line_index_take_fault(LineIndex* index);
+
+/**
+ * @brief Cuts the index down to the current size of its file.
+ *
+ * Lines that start past the new end are dropped; the bytes past it already
+ * read as zeros. Converted text (see `line_index_set_encoding`) is left as
+ * it is until it is converted again.
+ *
+ * @param index Pointer to a LineIndex holding a file mapping.
+ * @param path The path of the file.
+ * @return True if the index was cut down.
+ */
+bool line_index_recheck(LineIndex* index, const char* path);
+
+/**
+ * @brief Frees the line offsets but keeps the file data.
+ *
+ * The index can be brought back with `line_index_build` without reopening the file.
+ *
+ * @param index Pointer to the LineIndex.
+ */
+void line_index_evict(LineIndex* index);
+
+/**
+ * @brief Frees the line offsets and unmaps or frees the file data, converted or not.
+ * @param index Pointer to the LineIndex to free. It is left in an empty state.
+ */
+void line_index_free(LineIndex* index);
+
+#endif // LINE_INDEX_H
@@ -0,0 +1,44 @@
+/**
+ * @file map_guard.h
+ * @author Zuhaitz (original)
+ * @brief Defines the guard that keeps a file truncated under its mapping from killing the process.
+ *
+ * Touching a page of a mapping past the end of the file it maps raises
+ * SIGBUS, which happens when a log is truncated (or rotated by
+ * copy-truncate) while it is open. Mappings registered here are covered by
+ * a SIGBUS handler that maps zeros over the pages from the faulting one to
+ * the end of the mapping, so the access that faulted, on whatever thread,
+ * reads zeros and goes on. The mapping is marked, and the owner checks the
+ * size of the file again when it next polls (see `line_index_recheck`).
+ */
+#ifndef MAP_GUARD_H
+#define MAP_GUARD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/** @brief The most mappings guarded at once; others are left unguarded. */
+#define MAP_GUARD_SLOTS 64
+
+/**
+ * @brief Guards a file mapping, installing the SIGBUS handler the first time.
+ *
+ * @param start The start of the mapping, as returned by mmap.
+ * @param length The length of the mapping.
+ * @return True if the mapping is guarded, false if every slot is taken.
+ */
+bool map_guard_add(const void* start, size_t length);
+
+/**
+ * @brief Stops guarding a mapping, before it is unmapped. Unguarded addresses are ignored.
+ * @param start The start of the mapping.
+ */
+void map_guard_remove(const void* start);
+
+/**
+ * @brief Returns true, once, if a page of the mapping faulted since the last call.
+ * @param start The start of the mapping.
+ */
+bool map_guard_take_fault(const void* start);
+
+#endif // MAP_GUARD_H
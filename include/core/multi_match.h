@@ -0,0 +1,78 @@
+/**
+ * @file multi_match.h
+ * @author Zuhaitz (original)
+ * @brief Defines a matcher that finds several terms in one pass.
+ *
+ * The terms are compiled once into an Aho-Corasick automaton, expanded into
+ * a full transition table, so a scan costs one table lookup per byte however
+ * many terms there are. It is used both to index the lines that contain a
+ * pinned term and to colour the pinned terms on screen.
+ */
+#ifndef MULTI_MATCH_H
+#define MULTI_MATCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "core/error.h"
+
+/** @brief The most terms a matcher holds; each one is a bit of a 32-bit mask. */
+#define MULTI_MATCH_MAX_TERMS 16
+
+/** @brief The longest term, in bytes. */
+#define MULTI_MATCH_MAX_TERM_LEN 255
+
+/**
+ * @struct MultiMatcher
+ * @brief A compiled set of terms.
+ */
+typedef struct {
+    uint16_t (*next)[256];      /**< The state reached from each state on each byte. */
+    uint32_t* output;           /**< The terms that end in each state, as a bit mask. */
+    size_t state_count;         /**< The number of states. */
+    size_t term_count;          /**< The number of terms. */
+    size_t term_len[MULTI_MATCH_MAX_TERMS]; /**< The length of each term. */
+    unsigned char by_length[MULTI_MATCH_MAX_TERMS]; /**< The term indexes, shortest first. */
+} MultiMatcher;
+
+/**
+ * @brief Compiles a set of terms.
+ *
+ * @param matcher Pointer to the MultiMatcher to initialize.
+ * @param terms The terms, none empty nor longer than MULTI_MATCH_MAX_TERM_LEN.
+ * @param count The number of terms, at most MULTI_MATCH_MAX_TERMS.
+ * @return FAT_SUCCESS, FAT_ERROR_INVALID_ARGUMENT for a bad term, or FAT_ERROR_MEMORY.
+ */
+FatResult multi_match_compile(MultiMatcher* matcher, char* const* terms, size_t count);
+
+/**
+ * @brief Finds which terms occur in a text.
+ *
+ * @param matcher Pointer to a compiled MultiMatcher.
+ * @param text The text to scan.
+ * @param len The length of the text.
+ * @return A mask with bit `i` set if term `i` occurs, 0 if none does.
+ */
+uint32_t multi_match_find(const MultiMatcher* matcher, const char* text, size_t len);
+
+/**
+ * @brief Marks the bytes of a text covered by each term.
+ *
+ * Where occurrences overlap, the one that ends last wins, and among those
+ * the longest.
+ *
+ * @param matcher Pointer to a compiled MultiMatcher.
+ * @param text The text to scan.
+ * @param len The length of the text.
+ * @param marks Receives, for each byte, 1 + the index of the term covering it, or 0.
+ * @return True if any byte was marked.
+ */
+bool multi_match_mark(const MultiMatcher* matcher, const char* text, size_t len, unsigned char* marks);
+
+/**
+ * @brief Frees a matcher.
+ * @param matcher Pointer to the MultiMatcher to free. It is left in an empty state.
+ */
+void multi_match_free(MultiMatcher* matcher);
+
+#endif // MULTI_MATCH_H
@@ -0,0 +1,77 @@
+/**
+ * @file read_pipeline.h
+ * @author Zuhaitz (original)
+ * @brief Defines the shared read pipeline for sequential scans of large files.
+ *
+ * A scan reads a file front to back in READ_PIPELINE_BLOCK_SIZE blocks and
+ * keeps READ_PIPELINE_DEPTH of them in flight, so the disk is never left
+ * waiting on the CPU and the CPU never waits on one read at a time. Reads
+ * go through io_uring, set up with raw system calls, and through a small
+ * pool of threads calling pread where io_uring is missing or forbidden.
+ * Either way, blocks are handed to the consumers in file order.
+ *
+ * Scans of the same file from the same offset are shared: a caller that
+ * asks for one while another is still waiting for its first block joins
+ * it, and both consumers see every block of a single pass of I/O. Joining
+ * is only possible until then, since consumers need the blocks in order;
+ * a cold file, where sharing matters most, is also where the wait for the
+ * first block is longest.
+ */
+#ifndef READ_PIPELINE_H
+#define READ_PIPELINE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "core/error.h"
+
+/** @brief The size of each read. */
+#define READ_PIPELINE_BLOCK_SIZE (1024 * 1024)
+
+/** @brief The number of reads kept in flight. */
+#define READ_PIPELINE_DEPTH 8
+
+/** @brief The number of threads reading when io_uring is unavailable. */
+#define READ_PIPELINE_THREADS 4
+
+/** @brief The size from which a scan is worth the pipeline rather than walking a mapping. */
+#define READ_PIPELINE_MIN_SIZE ((uint64_t)64 * 1024 * 1024)
+
+/**
+ * @brief Receives the next block of a scan.
+ *
+ * @param ctx The consumer's context.
+ * @param data The bytes of the block, valid only during the call.
+ * @param size The number of bytes.
+ * @param offset The file offset of the first byte.
+ * @return True to go on, false to see no more of the scan.
+ */
+typedef bool (*ReadConsumeFn)(void* ctx, const char* data, size_t size, uint64_t offset);
+
+/**
+ * @struct ReadConsumer
+ * @brief One of the parties a scan hands its blocks to.
+ */
+typedef struct {
+    ReadConsumeFn consume;      /**< Called with each block, in file order. */
+    void* ctx;                  /**< Passed to `consume`. */
+    bool stopped;               /**< Set once `consume` has returned false. */
+} ReadConsumer;
+
+/**
+ * @brief Scans a file from an offset to its end, handing every block to each consumer.
+ *
+ * The call returns once the consumers have seen the whole file or have all
+ * stopped. Consumers run on the thread of whichever caller started the
+ * scan, one after the other for each block, so a consumer that joins
+ * another thread's scan must not rely on running on its own.
+ *
+ * @param path The path of a regular file or block device.
+ * @param start The offset to start at.
+ * @param consumers The consumers. They must stay valid until the call returns.
+ * @param count The number of consumers.
+ * @return FAT_SUCCESS, FAT_ERROR_UNSUPPORTED for a stream, or an error code (e.g., FAT_ERROR_FILE_READ) on failure.
+ */
+FatResult read_pipeline_scan(const char* path, uint64_t start, ReadConsumer* consumers, size_t count);
+
+#endif // READ_PIPELINE_H
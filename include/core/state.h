@@ -10,6 +10,24 @@
 #include <limits.h>
 #include <stdbool.h>
 #include "string_list.h"
+#include "core/line_index.h"
+#include "core/diff.h"
+#include "core/dir_listing.h"
+#include "core/stream_input.h"
+#include "core/line_filter.h"
+#include "core/archive_grep.h"
+#include "core/tree_grep.h"
+#include "core/time_index.h"
+#include "core/time_histogram.h"
+#include "core/byte_map.h"
+#include "core/checksum.h"
+#include "core/strings_view.h"
+#include "core/hex_diff.h"
+#include "core/json_view.h"
+#include "core/table_view.h"
+#include "core/multi_match.h"
+#include "plugins/binary_format.h"
+#include "plugins/hex_viewer_api.h"
 #include "ui/theme.h"
 #include "core/error.h"
 
@@ -41,6 +59,27 @@ typedef enum {
     ACTION_GO_BACK,
     ACTION_SELECT_THEME,
     ACTION_TOGGLE_HELP,
+    ACTION_NEXT_BUFFER,
+    ACTION_PREV_BUFFER,
+    ACTION_LIST_BUFFERS,
+    ACTION_NEXT_HUNK,
+    ACTION_PREV_HUNK,
+    ACTION_FILTER,
+    ACTION_JUMP_TO_COLUMN,
+    ACTION_SORT_COLUMN,
+    ACTION_LIST_SECTIONS,
+    ACTION_FIND_SYMBOL,
+    ACTION_PIN_TERM,
+    ACTION_CLEAR_PINS,
+    ACTION_NEXT_PINNED,
+    ACTION_PREV_PINNED,
+    ACTION_JUMP_TO_TIME,
+    ACTION_TOGGLE_TIMELINE,
+    ACTION_NEXT_BUCKET,
+    ACTION_PREV_BUCKET,
+    ACTION_TOGGLE_STRINGS,
+    ACTION_CHECKSUMS,
+    ACTION_SWITCH_ENCODING,
     ACTION_CONFIRM,
     ACTION_COUNT
 } Action;
@@ -84,6 +123,11 @@ typedef struct {
     MimeCommand* mime_commands; /**< Array of MIME type to command mappings. */
     size_t mime_commands_count; /**< Number of mime_commands. */
     char* default_command;      /**< The default command for all file types. */
+    size_t buffer_memory_budget; /**< Bytes of line index memory background buffers may use (0 = unlimited). */
+    size_t stdin_memory_limit;  /**< Bytes of piped input kept in memory before spilling to disk (0 = unlimited). */
+    HexLayout hex_layout;       /**< Bytes per row, grouping and integer column of the hex view. */
+    ChecksumKind checksum_kinds[CHECKSUM_KIND_COUNT]; /**< The checksums computed on request, in display order. */
+    size_t checksum_kind_count; /**< The number of checksums selected. */
 } AppConfig;
 
 
@@ -94,7 +138,8 @@ typedef struct {
 typedef enum {
     MODE_NORMAL,        /**< Default mode for navigation and viewing. */
     MODE_SEARCH_INPUT,  /**< Mode for when the user is typing in the search bar. */
-    MODE_COMMAND_INPUT  /**< Mode for when the user is typing in the command bar. */
+    MODE_COMMAND_INPUT, /**< Mode for when the user is typing in the command bar. */
+    MODE_FILTER_INPUT   /**< Mode for when the user is typing a filter expression. */
 } AppMode;
 
 /**
@@ -104,7 +149,14 @@ typedef enum {
 typedef enum {
     VIEW_MODE_NORMAL,       /**< Displaying a regular text file. */
     VIEW_MODE_ARCHIVE,      /**< Displaying the list of entries in an archive. */
-    VIEW_MODE_BINARY_HEX    /**< Displaying a hex dump of a binary file. */
+    VIEW_MODE_BINARY_HEX,   /**< Displaying a hex dump of a binary file. */
+    VIEW_MODE_DIFF,         /**< Displaying two text files side by side with their differences. */
+    VIEW_MODE_DIRECTORY,    /**< Displaying the entries of a directory. */
+    VIEW_MODE_GREP,         /**< Displaying the lines under a directory that contain a term. */
+    VIEW_MODE_JSON,         /**< Displaying a JSON file as a collapsible tree. */
+    VIEW_MODE_TABLE,        /**< Displaying a CSV or TSV file as aligned columns. */
+    VIEW_MODE_STRINGS,      /**< Displaying the runs of printable text in a binary file. */
+    VIEW_MODE_HEX_DIFF      /**< Displaying two binary files as hex dumps side by side with their differing bytes. */
 } ViewMode;
 
 /**
@@ -128,15 +180,116 @@ typedef struct {
 
 /**
  * @struct SearchMatchList
- * @brief A dynamic array of SearchMatch structs.
+ * @brief A dynamic array of SearchMatch structs, and how far the scan for them has got.
+ *
+ * Lines are scanned a time slice at a stretch. A scan first goes through the
+ * candidate lines, the lines that matched a shorter term the current one
+ * contains, then through every line from `next_line` on. Matches are kept in
+ * line order either way.
  */
 typedef struct {
     SearchMatch* matches;       /**< The array of matches. */
     size_t count;               /**< The number of matches found. */
     size_t capacity;            /**< The allocated capacity of the array. */
     size_t current_match_idx;   /**< The index of the currently active match. */
+
+    size_t* candidates;         /**< Lines that matched the shorter term, in order. */
+    size_t candidate_count;     /**< The number of candidate lines. */
+    size_t candidate_pos;       /**< The next candidate line to scan. */
+    size_t next_line;           /**< The first line not covered by the candidates nor scanned yet. */
+    bool is_scanning;           /**< True until every line has been scanned. */
+    size_t origin_line;         /**< The line the search started from; the nearest match after it becomes current. */
+    bool has_current;           /**< True once a match has been made current. */
 } SearchMatchList;
 
+/**
+ * @struct PinnedTerms
+ * @brief Terms highlighted in their own colors, and the lines that contain them.
+ *
+ * The terms are compiled into one matcher, which indexes the lines a time
+ * slice at a stretch while the view is idle and colors the lines on screen.
+ */
+typedef struct {
+    StringList terms;           /**< The pinned terms, in the order they were pinned. */
+    MultiMatcher matcher;       /**< The terms compiled together. */
+    size_t* lines;              /**< The lines containing any pinned term, in order. */
+    size_t line_count;          /**< The number of entries in `lines`. */
+    size_t line_capacity;       /**< The allocated capacity of `lines`. */
+    size_t term_lines[MULTI_MATCH_MAX_TERMS]; /**< The number of lines containing each term. */
+    size_t next_line;           /**< The first line not indexed yet. */
+} PinnedTerms;
+
+/** @brief The maximum number of parent views kept in memory for instant back navigation. */
+#define VIEW_CACHE_SIZE 8
+
+/**
+ * @struct ViewSnapshot
+ * @brief A detached copy of everything that makes up a loaded view.
+ *
+ * A snapshot owns its lists and strings. Views are moved into and out of
+ * snapshots, so saving or restoring one never copies the content itself.
+ */
+typedef struct {
+    char *filepath;                 /**< The path of the file the view was loaded from. */
+    StringList metadata;            /**< Metadata shown in the left pane. */
+    StringList content;             /**< Content shown in the right pane. */
+    LineIndex line_index;           /**< Lines of the file when viewed as text. */
+    DiffView *diff;                 /**< The diff against another file, in diff mode. */
+    HexDiff *hex_diff;              /**< The binary diff against another file, in hex diff mode. */
+    DirListing *dir;                /**< The directory entries, in directory mode. */
+    StreamInput *stream;            /**< The stream, when the view shows standard input, a FIFO or a device. */
+    LineFilter *filter;             /**< The filter narrowing the view, or NULL. */
+    ArchiveGrep *archive_grep;      /**< The archive entries containing a term, or NULL. */
+    TreeGrep *tree_grep;            /**< The lines under a directory containing a term, in grep mode. */
+    TimeIndex *time_index;          /**< The timestamp format and checkpoints of the lines, or NULL. */
+    TimeHistogram *histogram;       /**< The timeline of the lines, or NULL. */
+    JsonView *json;                 /**< The JSON tree, in JSON mode. */
+    TableView *table;               /**< The table, in table mode. */
+    HexView *hex;                   /**< The hex dump, in hex mode. */
+    BinaryFormat *binary;           /**< The executable headers, in hex mode on a recognised binary. */
+    ByteMap *byte_map;              /**< The entropy and byte classes of the blocks, in hex mode, or NULL. */
+    Checksums *checksums;           /**< The checksums of the file, or of an archive entry, or NULL. */
+    StringsView *strings;           /**< The runs of printable text, in strings mode, or NULL. */
+    size_t max_line_len;            /**< The length of the longest content line. */
+    ViewMode view_mode;             /**< The view mode the content was loaded in. */
+    int top_line;                   /**< The saved vertical scroll position. */
+    int left_char;                  /**< The saved horizontal scroll position. */
+    bool line_wrap_enabled;         /**< The saved line wrap flag. */
+    char search_term[256];          /**< The saved search term. */
+    bool search_term_active;        /**< Whether the saved search term was active. */
+    SearchMatchList search_results; /**< The saved search matches. */
+    PinnedTerms pins;               /**< The saved pinned terms. */
+} ViewSnapshot;
+
+/**
+ * @struct ViewCache
+ * @brief A bounded LRU cache of the views above the current breadcrumb.
+ */
+typedef struct {
+    ViewSnapshot entries[VIEW_CACHE_SIZE];      /**< The cached views. */
+    unsigned long last_used[VIEW_CACHE_SIZE];   /**< LRU stamp of each entry, 0 marks a free slot. */
+    unsigned long clock;                        /**< The last stamp handed out. */
+} ViewCache;
+
+/**
+ * @struct Buffer
+ * @brief A file opened from the command line, with its own view and navigation history.
+ *
+ * The active buffer lives directly in the AppState fields; its slot only
+ * keeps bookkeeping. Background buffers keep their view in `view`.
+ */
+typedef struct {
+    ViewSnapshot view;          /**< The buffer's view while it is in the background. */
+    StringList breadcrumbs;     /**< The buffer's navigation history while it is in the background. */
+    bool is_loaded;             /**< False until the buffer has been shown once; `view.filepath` holds the path to open. */
+    bool is_evicted;            /**< True if the view's content was freed to stay within the memory budget. */
+    size_t memory_usage;        /**< Heap bytes held by the background view's content. */
+    uint64_t evicted_offset;    /**< The file offset an evicted strings view reopens at. */
+    int evicted_sort_column;    /**< The column an evicted table was sorted by, or -1. */
+    bool evicted_sort_descending; /**< True if that sort was descending. */
+    unsigned long last_used;    /**< LRU stamp used when enforcing the memory budget. */
+} Buffer;
+
 /**
  * @struct AppState
  * @brief The central data structure holding the entire application state.
@@ -149,7 +302,24 @@ typedef struct {
 
     // **View-Specific Data (managed by state.c)**
     StringList metadata;    /**< Metadata for the current file (for left pane). */
-    StringList content;     /**< Content of the current file/archive (for right pane). */
+    StringList content;     /**< Content of the current archive listing or hex dump (for right pane). */
+    LineIndex line_index;   /**< Lines of the current file in text mode (for right pane). */
+    DiffView *diff;         /**< The two files being compared in diff mode (for right pane). */
+    HexDiff *hex_diff;      /**< The two binary files and their differing ranges, compared in the background, in hex diff mode (for right pane). */
+    DirListing *dir;        /**< The entries of the directory in directory mode (for right pane). */
+    StreamInput *stream;    /**< Lines of standard input or another stream, read in the background (for right pane). */
+    LineFilter *filter;     /**< When set, only the lines it matches are shown, evaluated in the background. */
+    ArchiveGrep *archive_grep; /**< When set in archive mode, only the entries containing its term are shown, with hit counts. */
+    TreeGrep *tree_grep;    /**< The lines under a directory that contain a term, found in the background, in grep mode (for right pane). */
+    TimeIndex *time_index;  /**< The timestamp format and time checkpoints of the text, built on the first jump to a time, or NULL. */
+    TimeHistogram *histogram; /**< The lines (or search matches) per stretch of time, built while the timeline is shown, or NULL. */
+    JsonView *json;         /**< The structural index and visible rows of a JSON file in JSON mode (for right pane). */
+    TableView *table;       /**< The rows and column layout of a CSV or TSV file in table mode (for right pane). */
+    HexView *hex;           /**< The mapped bytes and row layout of a file in hex mode (for right pane). */
+    BinaryFormat *binary;   /**< The sections and symbols of an executable in hex mode (for left pane), or NULL. */
+    ByteMap *byte_map;      /**< The entropy and byte classes of each block of the file in hex mode, scanned in the background (for left pane), or NULL. */
+    Checksums *checksums;   /**< The checksums of the file computed in the background, or the recorded CRC-32 of an archive entry, once asked for (for left pane), or NULL. */
+    StringsView *strings;   /**< The runs of printable text in the mapped file, found in the background, in strings mode (for right pane). */
     char *filepath;         /**< The path to the currently loaded file. */
     size_t max_line_len;    /**< The length of the longest line in the current content. */
 
@@ -163,22 +333,36 @@ typedef struct {
 
     // **App-Lifetime Data**
     ForceViewMode force_view_mode;      /**< A flag to force a view mode, set at startup. */
+    int stdin_fd;                       /**< The piped standard input until it is opened as "-", else -1. */
     StringList theme_paths;             /**< A list of full paths to all discovered themes. */
     char themes_dir_path[PATH_MAX];     /**< The path to the themes directory. */
     StringList breadcrumbs;             /**< Navigation history (a stack of file paths). */
+    ViewCache view_cache;               /**< Loaded views of the parent breadcrumbs. */
+    Buffer *buffers;                    /**< All open buffers, one per file given on the command line. */
+    size_t buffer_count;                /**< The number of open buffers. */
+    size_t active_buffer;               /**< The index of the buffer shown on screen. */
+    unsigned long buffer_clock;         /**< The last LRU stamp handed out to a buffer. */
+    bool resources_loaded;              /**< True once config, themes and plugins have been loaded. */
+    bool show_timeline;                 /**< True if the timeline of a log is drawn in the left pane. */
+    bool hide_byte_map;                 /**< True if the byte map of a file in hex mode is not drawn in the left pane. */
     AppConfig config;                   /**< Holds user-defined configuration settings. */
 
     // **Search State**
     char search_term[256];              /**< The current search term entered by the user. */
     bool search_term_active;            /**< True if a search term is currently active. */
     SearchMatchList search_results;     /**< A list of all found matches for the current term. */
+    PinnedTerms pins;                   /**< Terms highlighted in their own colors. */
 
 } AppState;
 
 /**
  * @brief Initializes or re-initializes the application state for a given file.
+ *
+ * A directory opens as a listing, and "-" opens the piped standard input
+ * held in `stdin_fd`, which can only be opened once.
+ *
  * @param state A pointer to the application state to modify.
- * @param filepath The path to the new file to load.
+ * @param filepath The path to the new file to load, or "-" for standard input.
  * @return FAT_SUCCESS on success, or an error code on failure.
  */
 FatResult state_init(AppState *state, const char *filepath);
@@ -191,6 +375,329 @@ FatResult state_init(AppState *state, const char *filepath);
  */
 FatResult state_reload_content(AppState *state, ViewMode new_mode);
 
+/**
+ * @brief Returns the number of lines in the current view.
+ * @param state A read-only pointer to the application state.
+ * @return The number of content lines (or archive entries).
+ */
+size_t state_line_count(const AppState *state);
+
+/**
+ * @brief Returns the line number in the unfiltered content of a line of the current view.
+ * @param state A read-only pointer to the application state.
+ * @param idx The zero-based line index in the current view.
+ * @return The zero-based line number that `idx` shows, which equals `idx` unless a filter is active.
+ */
+size_t state_line_number(const AppState *state, size_t idx);
+
+/**
+ * @brief Finds the first line of the current view at or after a line of the unfiltered content.
+ * @param state A read-only pointer to the application state.
+ * @param line_number The zero-based line number in the unfiltered content.
+ * @return The index in the current view, or the line count if no shown line follows it.
+ */
+size_t state_find_line_number(const AppState *state, size_t line_number);
+
+/**
+ * @brief Scrolls the hex view to the line holding a file offset.
+ *
+ * @param state A pointer to the application state, in hex mode.
+ * @param offset The file offset; offsets past the end go to the last line.
+ */
+void state_jump_to_offset(AppState *state, uint64_t offset);
+
+/**
+ * @brief Re-fits the hex view to the width of the pane when its layout adapts to it.
+ *
+ * If the number of bytes per row changes, the byte at the top of the screen
+ * stays there, and any filter or search is cleared as its rows no longer exist.
+ *
+ * @param state A pointer to the application state.
+ */
+void state_fit_hex_view(AppState *state);
+
+/**
+ * @brief Reads the current text file in the next encoding (see text_encoding.h).
+ *
+ * The bytes already held are converted again, without reloading the file.
+ * Encodings this system cannot convert from are skipped. Any filter, time
+ * index or search is cleared, as its lines no longer exist.
+ *
+ * @param state A pointer to the application state, in normal mode.
+ * @return FAT_SUCCESS, FAT_ERROR_UNSUPPORTED in any other mode, for a stream,
+ * or for a file too large to convert, or an error code (e.g., FAT_ERROR_MEMORY) on failure.
+ */
+FatResult state_cycle_encoding(AppState *state);
+
+/**
+ * @brief Returns the number of lines in the current view before filtering.
+ * @param state A read-only pointer to the application state.
+ */
+size_t state_total_line_count(const AppState *state);
+
+/**
+ * @brief Returns a line of the current view.
+ *
+ * The returned pointer is NOT guaranteed to be null-terminated, as text lines
+ * point straight into the mapped file. Always use `len`.
+ *
+ * @param state A read-only pointer to the application state.
+ * @param idx The zero-based line index.
+ * @param len Set to the length of the line in bytes.
+ * @return A pointer to the line, or NULL if `idx` is out of range.
+ */
+const char *state_get_line(const AppState *state, size_t idx, size_t *len);
+
+/**
+ * @brief Replaces the current view with a side-by-side diff against another file.
+ *
+ * The current file is shown on the left and `other_path` on the right. The
+ * diff is computed in the background; `state_has_pending_work` reports when
+ * the screen should keep being refreshed. A file shown in hex is compared
+ * byte by byte, as two hex dumps, rather than line by line.
+ *
+ * @param state A pointer to the application state. A file must already be loaded.
+ * @param other_path The path of the file to compare against.
+ * @return FAT_SUCCESS on success, or an error code if either file cannot be read.
+ */
+FatResult state_open_diff(AppState *state, const char *other_path);
+
+/**
+ * @brief Narrows the current view to the lines matching a filter expression.
+ *
+ * The expression syntax is described in line_filter.h. Matching runs in the
+ * background; the view shows the matches found so far, in order, and
+ * `state_has_pending_work` reports when more may appear. Any active search
+ * is cleared, as its matches refer to the old lines.
+ *
+ * @param state A pointer to the application state.
+ * @param expression The filter expression. An empty expression clears the filter.
+ * @param error Buffer receiving a message explaining a failure.
+ * @param error_size The size of `error`.
+ * @return FAT_SUCCESS, FAT_ERROR_INVALID_ARGUMENT for a syntax error, or
+ * FAT_ERROR_UNSUPPORTED if the view cannot be filtered yet.
+ */
+FatResult state_apply_filter(AppState *state, const char *expression, char *error, size_t error_size);
+
+/**
+ * @brief Lists the entries of the current archive that contain a term.
+ *
+ * Every entry is searched in the background, several at a time. The view
+ * shows the entries with hits, with their hit counts, in the order they are
+ * found, and `state_has_pending_work` reports when more may appear. Any
+ * filter is removed.
+ *
+ * @param state A pointer to the application state, in archive mode.
+ * @param term The term. An empty term clears the search.
+ * @return FAT_SUCCESS, FAT_ERROR_UNSUPPORTED outside archive mode, or another error code.
+ */
+FatResult state_grep_archive(AppState *state, const char *term);
+
+/**
+ * @brief Shows all the entries of the archive again, keeping the entry at the top of the screen.
+ * @param state A pointer to the application state.
+ */
+void state_clear_archive_grep(AppState *state);
+
+/**
+ * @brief Replaces the current view with the lines under it that contain a term.
+ *
+ * Every file under the current directory is searched in the background,
+ * archives included, and each matching line is listed with its path and
+ * line number in the order it is found; `state_has_pending_work` reports
+ * when more may appear. A single file is searched on its own. The view
+ * searched is cached and the hits get a `grep:<term>` breadcrumb, so going
+ * back from them restores it.
+ *
+ * @param state A pointer to the application state. A directory or file must already be loaded.
+ * @param term The term, at most TREE_GREP_MAX_TERM_LEN bytes.
+ * @return FAT_SUCCESS, FAT_ERROR_INVALID_ARGUMENT for an empty or overlong term, or another error code.
+ */
+FatResult state_open_grep(AppState *state, const char *term);
+
+/**
+ * @brief Opens the file of the hit at the top of the screen, at its line.
+ *
+ * The grep view is kept so going back returns to it. A hit inside an
+ * archive opens the archive first, then the extracted entry, so going back
+ * passes through the archive listing. The term is searched for in the
+ * opened file, starting at the hit's line.
+ *
+ * @param state A pointer to the application state, in grep mode.
+ * @return FAT_SUCCESS, FAT_ERROR_UNSUPPORTED outside grep mode, or an error code if the file cannot be opened.
+ */
+FatResult state_open_grep_hit(AppState *state);
+
+/**
+ * @brief Scrolls to the first line at or after a time.
+ *
+ * The timestamp format is detected from the first lines of the text on the
+ * first jump, which also starts sampling the time checkpoints in the
+ * background. The line is found by binary search, so only a few dozen lines
+ * are parsed whatever the size of the file. A time of day alone refers to
+ * the day of the line at the top of the screen.
+ *
+ * @param state A pointer to the application state, in text mode.
+ * @param text The time, in any form `time_parse_target` accepts.
+ * @return FAT_SUCCESS, FAT_ERROR_UNSUPPORTED if the lines have no timestamps,
+ * FAT_ERROR_INVALID_ARGUMENT if the time cannot be read, or
+ * FAT_ERROR_FILE_NOT_FOUND if every line is earlier.
+ */
+FatResult state_jump_to_time(AppState *state, const char *text);
+
+/**
+ * @brief Scrolls to the next or previous column of the timeline that holds any line.
+ *
+ * While a search is active the timeline counts its matching lines, and the
+ * view moves to the first match in the column instead. Going back first
+ * returns to the start of the column at the top of the screen.
+ *
+ * @param state A pointer to the application state, in text mode with the timeline shown.
+ * @param forward True to move to a later column, false to an earlier one.
+ * @param columns The number of columns the timeline is drawn in.
+ * @return FAT_SUCCESS, FAT_ERROR_UNSUPPORTED if there is no timeline, or
+ * FAT_ERROR_FILE_NOT_FOUND if no column in that direction holds a line.
+ */
+FatResult state_timeline_step(AppState *state, bool forward, size_t columns);
+
+/**
+ * @brief Scrolls the hex view to the next or previous region of the byte map.
+ *
+ * A region is a run of blocks that hold the same kind of bytes (padding,
+ * text, data, or compressed and encrypted data); blocks not scanned yet are
+ * not part of any. Going back first returns to the start of the region at
+ * the top of the screen.
+ *
+ * @param state A pointer to the application state, in hex mode with the byte map shown.
+ * @param forward True to move to a later region, false to an earlier one.
+ * @return FAT_SUCCESS, FAT_ERROR_UNSUPPORTED if there is no byte map, or
+ * FAT_ERROR_FILE_NOT_FOUND if no region starts in that direction.
+ */
+FatResult state_byte_map_step(AppState *state, bool forward);
+
+/**
+ * @brief Switches a binary file between its hex dump and the list of its strings.
+ *
+ * The strings are found in the background, in the bytes the hex view has
+ * mapped, and the list opens on the first one at or after the top of the
+ * hex dump. Switching back scrolls the hex dump to the string on the top
+ * line. The list is kept while the file stays open, so switching again is
+ * instant.
+ *
+ * @param state A pointer to the application state, in hex or strings mode.
+ * @return FAT_SUCCESS, FAT_ERROR_UNSUPPORTED in any other mode, or FAT_ERROR_MEMORY.
+ */
+FatResult state_toggle_strings(AppState *state);
+
+/**
+ * @brief Starts computing the checksums of the current file, as selected in the config file.
+ *
+ * Every selected checksum is computed in the same background pass over the
+ * file; the left pane shows the progress, then the digests. Asking again
+ * while they are computed, or once they are, changes nothing. In archive
+ * mode, the CRC-32 the archive records for the selected entry is shown
+ * instead, read without decompressing the entry.
+ *
+ * @param state A pointer to the application state.
+ * @return FAT_SUCCESS, FAT_ERROR_UNSUPPORTED for a stream or an archive that
+ * records no CRC-32, FAT_ERROR_INVALID_ARGUMENT if no checksum is selected,
+ * or an error code (e.g., FAT_ERROR_MEMORY) on failure.
+ */
+FatResult state_start_checksums(AppState *state);
+
+/**
+ * @brief Expands or collapses the JSON container on the top line.
+ *
+ * Any active search is cleared, as its matches refer to the old rows.
+ *
+ * @param state A pointer to the application state, in JSON mode.
+ * @return FAT_SUCCESS, FAT_ERROR_UNSUPPORTED if the top line is not a container, or FAT_ERROR_MEMORY.
+ */
+FatResult state_toggle_json_node(AppState *state);
+
+/**
+ * @brief Sorts the table by a column, or reverses or removes the sort.
+ *
+ * Sorting by the column already sorted ascending sorts it descending, and
+ * once more restores the file order. The sort runs in the background.
+ *
+ * @param state A pointer to the application state, in table mode.
+ * @param column The zero-based column.
+ * @return FAT_SUCCESS, or an error code if the sort cannot be started.
+ */
+FatResult state_sort_table(AppState *state, size_t column);
+
+/**
+ * @brief Removes the filter from the current view, keeping the line at the top of the screen.
+ * @param state A pointer to the application state.
+ */
+void state_clear_filter(AppState *state);
+
+/**
+ * @brief Returns true while background work is still changing what is on screen.
+ *
+ * When standard input is being viewed or a filter or archive search is
+ * running, this also makes the lines found since the last call visible, so
+ * it should be called before drawing.
+ *
+ * @param state A pointer to the application state.
+ * @return True if the UI should poll for updates instead of blocking on input.
+ */
+bool state_has_pending_work(AppState *state);
+
+/**
+ * @brief Registers another file as a background buffer.
+ *
+ * The file is not opened until the buffer is first switched to.
+ *
+ * @param state A pointer to the application state. `state_init` must have been called.
+ * @param filepath The path of the file to add.
+ * @return FAT_SUCCESS on success, or FAT_ERROR_MEMORY on an allocation failure.
+ */
+FatResult state_add_buffer(AppState *state, const char *filepath);
+
+/**
+ * @brief Makes another buffer the active one.
+ *
+ * The current view is kept in memory, subject to the configured memory budget,
+ * so switching back restores it exactly.
+ *
+ * @param state A pointer to the application state.
+ * @param index The index of the buffer to show.
+ * @return FAT_SUCCESS on success, or an error code if the buffer could not be loaded.
+ * On failure the previously active buffer stays on screen.
+ */
+FatResult state_switch_buffer(AppState *state, size_t index);
+
+/**
+ * @brief Returns the path of the file a buffer was opened with.
+ * @param state A read-only pointer to the application state.
+ * @param index The index of the buffer.
+ * @return A read-only path string, or NULL if the index is out of range.
+ */
+const char *state_buffer_path(const AppState *state, size_t index);
+
+/**
+ * @brief Moves the current view into the view cache before navigating deeper.
+ *
+ * After this call the state holds no view; the caller is expected to load a
+ * new one with `state_init`.
+ *
+ * @param state A pointer to the application state.
+ */
+void state_cache_view(AppState *state);
+
+/**
+ * @brief Pops the current breadcrumb and returns to the parent view.
+ *
+ * The parent view is restored from the view cache when available, including
+ * its scroll position and search state. Otherwise it is loaded from disk.
+ *
+ * @param state A pointer to the application state.
+ * @return FAT_SUCCESS on success, or an error code on failure.
+ */
+FatResult state_go_back(AppState *state);
+
 /**
  * @brief Frees resources associated with the current view only.
  * @param state The application state.
@@ -204,10 +711,65 @@ void state_destroy_view(AppState *state);
 void full_app_reset(AppState* state);
 
 /**
- * @brief Performs a search for the current search term and populates the search_results list.
+ * @brief Starts searching for a term, refining the current results if possible.
+ *
+ * When the new term contains the current one, only the lines that matched the
+ * current one are scanned again, along with any lines the current search had
+ * not reached yet. Any other term starts a scan of every line. Nothing is
+ * scanned here; see `state_search_step`.
+ *
+ * @param state A pointer to the application state.
+ * @param term The term to search for. An empty term clears the search.
+ * @param origin_line The line the nearest match is looked for from.
+ */
+void state_search_update(AppState *state, const char *term, size_t origin_line);
+
+/**
+ * @brief Scans lines for the current search term for up to a time budget.
+ *
+ * The first match at or after the origin line, or the first match once the
+ * whole view has been scanned, becomes the current match and is scrolled to.
+ *
+ * @param state A pointer to the application state.
+ * @param budget_ms The time to scan for, or a negative value to scan until done.
+ * @return FAT_SUCCESS, or FAT_ERROR_MEMORY if the matches could not be stored.
+ */
+FatResult state_search_step(AppState *state, int budget_ms);
+
+/**
+ * @brief Pins a term, or unpins it if it is already pinned.
+ *
+ * Pinned terms are highlighted in their own colors, and the lines that
+ * contain them are indexed in the background for `state_jump_to_pinned`.
+ *
+ * @param state A pointer to the application state.
+ * @param term The term, at most MULTI_MATCH_MAX_TERM_LEN bytes.
+ * @return FAT_SUCCESS, FAT_ERROR_INVALID_ARGUMENT if the term is empty, too
+ *         long or MULTI_MATCH_MAX_TERMS are already pinned, or FAT_ERROR_MEMORY.
+ */
+FatResult state_toggle_pin(AppState *state, const char *term);
+
+/**
+ * @brief Unpins every term.
+ * @param state A pointer to the application state.
+ */
+void state_clear_pins(AppState *state);
+
+/**
+ * @brief Scrolls to the next or previous line containing a pinned term, wrapping around.
+ *
+ * Lines not indexed yet are indexed first, as far as needed.
+ *
+ * @param state A pointer to the application state.
+ * @param forward True for the next line, false for the previous one.
+ * @return FAT_SUCCESS, or FAT_ERROR_FILE_NOT_FOUND if no line contains a pinned term.
+ */
+FatResult state_jump_to_pinned(AppState *state, bool forward);
+
+/**
+ * @brief Clears the search term and frees its matches.
  * @param state A pointer to the application state.
- * @return FAT_SUCCESS if matches are found, FAT_ERROR_FILE_NOT_FOUND if no matches are found.
  */
-FatResult state_perform_search(AppState *state);
+void state_clear_search(AppState *state);
 
 #endif //STATE_H
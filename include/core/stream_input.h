@@ -0,0 +1,131 @@
+/**
+ * @file stream_input.h
+ * @author Zuhaitz (original)
+ * @brief Defines the line store used to view data piped in on standard input.
+ *
+ * FIFOs, character devices and the files of /proc, which have no size
+ * either, are viewed through it too.
+ *
+ * A background thread reads the pipe and publishes the data in chunks that
+ * end on a line boundary, each with the offsets of its lines. A line longer
+ * than a chunk is split into lines of a chunk each, so a stream with no line
+ * breaks is held in bounded memory too. Once the data kept in memory reaches
+ * a limit, further chunks are written to an unlinked temporary file and read
+ * back through a memory mapping, so piping in more data than fits in memory
+ * only costs disk space.
+ *
+ * The UI thread never sees a chunk until `stream_input_poll` adopts it, so
+ * everything it reads is immutable and needs no locking.
+ */
+#ifndef STREAM_INPUT_H
+#define STREAM_INPUT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "core/error.h"
+
+/**
+ * @struct StreamChunk
+ * @brief A block of complete lines read from the stream.
+ */
+typedef struct {
+    char* data;             /**< The chunk bytes, or NULL if the chunk was spilled to disk. */
+    uint64_t offset;        /**< The position of the chunk's first byte in the stream. */
+    size_t size;            /**< The number of bytes in the chunk. */
+    size_t first_line;      /**< The stream line number of the chunk's first line. */
+    size_t line_count;      /**< The number of lines in the chunk. */
+    size_t* line_offsets;   /**< The start of each line, relative to the chunk. */
+    size_t max_line_len;    /**< The length in bytes of the longest line in the chunk. */
+} StreamChunk;
+
+/**
+ * @struct StreamInput
+ * @brief A stream being read in the background and the lines read so far.
+ */
+typedef struct {
+    int fd;                     /**< The stream being read. Owned by the StreamInput. */
+    size_t memory_limit;        /**< Bytes kept in memory before spilling (0 = never spill). */
+    uint64_t max_size;          /**< Bytes read before the reader stops (0 = read to the end). */
+
+    // **Shared with the reader thread (protected by `lock`)**
+    pthread_mutex_t lock;
+    StreamChunk* chunks;        /**< Every chunk published so far. */
+    size_t chunk_count;         /**< The number of published chunks. */
+    size_t chunk_capacity;      /**< The allocated capacity of `chunks`. */
+    uint64_t spill_size;        /**< Bytes written to the spill file so far. */
+    bool is_eof;                /**< True once the reader has hit the end of the stream. */
+    bool is_truncated;          /**< True if the reader stopped at `max_size` rather than the end. */
+    FatResult error;            /**< The read error that stopped the reader, if any. */
+    bool cancel;                /**< Set to ask the reader to stop. */
+
+    int spill_fd;               /**< The unlinked spill file, or -1 before the first spill. Set once by the reader. */
+    uint64_t spill_start;       /**< The stream offset at which spilled data begins. Set once by the reader. */
+
+    // **Reader thread only**
+    size_t memory_used;         /**< Bytes of chunk data held in memory. */
+
+    // **UI thread only**
+    StreamChunk* view;          /**< Copies of the chunks adopted by `stream_input_poll`. */
+    size_t view_count;          /**< The number of adopted chunks. */
+    size_t view_capacity;       /**< The allocated capacity of `view`. */
+    size_t line_count;          /**< The number of lines in the adopted chunks. */
+    uint64_t size;              /**< The number of bytes in the adopted chunks. */
+    size_t max_line_len;        /**< The length of the longest adopted line. */
+    char* map;                  /**< The spill file mapped read-only, or NULL. */
+    size_t map_size;            /**< The number of bytes mapped at `map`. */
+    uint64_t map_start;         /**< The stream offset of the first mapped byte. */
+    bool view_is_eof;           /**< True once the last chunk has been adopted. */
+    bool view_is_truncated;     /**< The value of `is_truncated` once the last chunk has been adopted. */
+
+    pthread_t thread;           /**< The reader thread. */
+    bool has_thread;            /**< True if `thread` must be joined. */
+} StreamInput;
+
+/**
+ * @brief Starts reading a stream in the background.
+ *
+ * @param stream Pointer to the StreamInput to initialize.
+ * @param fd The descriptor to read. The StreamInput takes ownership and closes it.
+ * @param memory_limit Bytes kept in memory before spilling to a temporary file (0 = never spill).
+ * @param max_size Bytes read before the stream is taken to have ended, for devices that never end (0 = no limit).
+ * @return FAT_SUCCESS on success, or an error code if the reader cannot be started.
+ */
+FatResult stream_input_open(StreamInput* stream, int fd, size_t memory_limit, uint64_t max_size);
+
+/**
+ * @brief Adopts the chunks published since the last call.
+ *
+ * Pointers returned by `stream_input_get_line` stay valid until the next call.
+ *
+ * @param stream Pointer to an open StreamInput.
+ * @return True if new lines became visible.
+ */
+bool stream_input_poll(StreamInput* stream);
+
+/**
+ * @brief Returns a line of the stream.
+ *
+ * The returned pointer is NOT null-terminated and excludes the newline.
+ *
+ * @param stream Pointer to an open StreamInput.
+ * @param line The zero-based line number.
+ * @param len Set to the length of the line in bytes.
+ * @return A pointer to the first byte of the line, or NULL if `line` has not been adopted yet.
+ */
+const char* stream_input_get_line(const StreamInput* stream, size_t line, size_t* len);
+
+/**
+ * @brief Returns true while the reader may still publish more data.
+ * @param stream Pointer to an open StreamInput.
+ */
+bool stream_input_is_reading(const StreamInput* stream);
+
+/**
+ * @brief Stops the reader and frees the stream, including its spill file.
+ * @param stream Pointer to the StreamInput to free. It is left in an empty state.
+ */
+void stream_input_free(StreamInput* stream);
+
+#endif // STREAM_INPUT_H
@@ -0,0 +1,143 @@
+/**
+ * @file strings_view.h
+ * @author Zuhaitz (original)
+ * @brief Defines the strings view of a binary file: its runs of printable text, with their offsets.
+ *
+ * Like strings(1), the view lists every run of at least STRINGS_VIEW_MIN_LEN
+ * printable ASCII characters, and every run as long of the same characters
+ * stored as UTF-16LE, as Windows binaries keep theirs. A background thread
+ * classifies the mapped bytes 64 at a time into bitmasks of printable and
+ * zero bytes, sixteen per SSE2 comparison, and finds where runs start and
+ * end from the transitions in those masks, so stretches with no text are
+ * skipped a whole mask at once.
+ */
+#ifndef STRINGS_VIEW_H
+#define STRINGS_VIEW_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "core/error.h"
+#include "core/line_index.h"
+
+/** @brief The fewest characters a run needs to be listed, as in strings(1). */
+#define STRINGS_VIEW_MIN_LEN 4
+
+/** @brief The most runs kept; the scan stops once it has found this many. */
+#define STRINGS_VIEW_MAX_RUNS 1000000
+
+/** @brief The most characters of a run shown in its row. */
+#define STRINGS_VIEW_TEXT_LEN 200
+
+/** @brief The size of a buffer that can hold any formatted row, terminator included. */
+#define STRINGS_ROW_MAX_BYTES 256
+
+/** @brief How many bytes the background scan classifies between two updates of the shared runs. */
+#define STRINGS_VIEW_PUBLISH_BYTES (1024 * 1024)
+
+/**
+ * @struct StringRun
+ * @brief A run of printable characters.
+ */
+typedef struct {
+    uint64_t offset;            /**< The offset of the first byte of the run. */
+    uint32_t length;            /**< The number of characters. */
+    bool wide;                  /**< True if the characters are stored as UTF-16LE, two bytes each. */
+} StringRun;
+
+/**
+ * @struct StringsView
+ * @brief The runs of a mapped file and the background scan that finds them.
+ */
+typedef struct {
+    const unsigned char* data;  /**< The mapped file; owned by the hex view. */
+    size_t size;                /**< The size of the file. */
+    const FileHole* holes;      /**< The holes of the file, skipped by the scan; owned by the hex view. */
+    size_t hole_count;          /**< The number of holes. */
+    int offset_digits;          /**< Hex digits in the offset column, as in the hex view. */
+
+    // **Shared with the background scan (protected by `lock`)**
+    pthread_mutex_t lock;
+    StringRun* found;           /**< The runs found since the last poll, in file order. */
+    size_t found_count;         /**< The number of runs in `found`. */
+    size_t found_capacity;      /**< The allocated capacity of `found`. */
+    size_t scanned;             /**< The number of bytes classified so far. */
+    bool finished;              /**< Set once the whole file has been scanned. */
+    bool truncated;             /**< Set if the scan stopped at STRINGS_VIEW_MAX_RUNS. */
+    bool cancel;                /**< Set to ask the scan to stop. */
+
+    // **UI thread only**
+    StringRun* runs;            /**< The runs adopted so far, in file order. */
+    size_t count;               /**< The number of runs in `runs`. */
+    size_t capacity;            /**< The allocated capacity of `runs`. */
+    size_t scanned_done;        /**< The value of `scanned` at the last poll. */
+    bool done;                  /**< Set once the last run has been adopted. */
+    bool failed;                /**< Set if the runs could not be stored; the view is shown as far as it got. */
+    uint64_t anchor;            /**< The offset the list is to open at, once the scan has got past it. */
+    bool has_anchor;            /**< True until the list has been scrolled to `anchor`. */
+    char row[STRINGS_ROW_MAX_BYTES]; /**< Scratch for `strings_view_get_row`. */
+
+    pthread_t thread;
+    bool has_thread;            /**< True if the background scan was started. */
+} StringsView;
+
+/**
+ * @brief Starts finding the runs of printable text in a mapped file.
+ *
+ * @param view Pointer to the StringsView to initialize.
+ * @param data The bytes of the file. They must outlive the StringsView.
+ * @param size The size of the file.
+ * @param holes The holes of the file, in file order, or NULL. They must outlive the StringsView.
+ * @param hole_count The number of holes.
+ * @param offset_digits The number of hex digits to print offsets with.
+ * @return FAT_SUCCESS.
+ */
+FatResult strings_view_start(StringsView* view, const char* data, size_t size, const FileHole* holes,
+                             size_t hole_count, int offset_digits);
+
+/**
+ * @brief Adopts the runs found since the last call.
+ * @param view Pointer to a started StringsView.
+ * @return True if runs were added or the scan moved on.
+ */
+bool strings_view_poll(StringsView* view);
+
+/**
+ * @brief Returns true until the whole file has been scanned and every run adopted.
+ * @param view Pointer to a started StringsView.
+ */
+bool strings_view_is_running(const StringsView* view);
+
+/**
+ * @brief Formats the row of a run: its offset, `A` or `W` for ASCII or UTF-16LE, and its text.
+ *
+ * @param view Pointer to a started StringsView.
+ * @param idx The index of the run.
+ * @param len Set to the length of the row.
+ * @return The null-terminated row, valid until the next call, or NULL if the run does not exist.
+ */
+const char* strings_view_get_row(StringsView* view, size_t idx, size_t* len);
+
+/**
+ * @brief Finds the first run that ends after a file offset.
+ * @param view Pointer to a started StringsView.
+ * @param offset A file offset.
+ * @return The index of the run, or `count` if none has been found past the offset.
+ */
+size_t strings_view_find_offset(const StringsView* view, uint64_t offset);
+
+/**
+ * @brief Returns the heap memory held by the runs, those not yet adopted included.
+ * @param view Pointer to the StringsView.
+ * @return The approximate heap usage in bytes.
+ */
+size_t strings_view_memory_usage(StringsView* view);
+
+/**
+ * @brief Stops the background scan and frees the runs.
+ * @param view Pointer to the StringsView to free. It is left in an empty state.
+ */
+void strings_view_free(StringsView* view);
+
+#endif // STRINGS_VIEW_H
@@ -0,0 +1,193 @@
+/**
+ * @file table_view.h
+ * @author Zuhaitz (original)
+ * @brief Defines the table view of CSV and TSV files.
+ *
+ * The file is indexed by line like any text file; the delimiter is guessed
+ * from a sample of lines, and the fields of a line are only located when the
+ * line is drawn, through a small cache of field offsets. Column widths are
+ * sampled from the start and from evenly spaced lines across the file, so
+ * opening a table never reads every row.
+ *
+ * The first line is taken as the header. Sorting by a column runs in a
+ * background thread as an external merge sort: sorted runs of row numbers
+ * are spilled to an unlinked temporary file and merged into the final order,
+ * so memory stays at one run plus one number per row.
+ */
+#ifndef TABLE_VIEW_H
+#define TABLE_VIEW_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "core/line_index.h"
+#include "core/error.h"
+
+/** @brief The widest a column is drawn, in screen cells. */
+#define TABLE_MAX_COLUMN_WIDTH 40
+
+/** @brief The number of lines whose field offsets are cached. */
+#define TABLE_CACHE_LINES 256
+
+/**
+ * @struct TableField
+ * @brief The position of a field within its line.
+ */
+typedef struct {
+    uint32_t start;     /**< The offset of the field from the start of the line, quotes included. */
+    uint32_t len;       /**< The length of the field in bytes, quotes included. */
+} TableField;
+
+/**
+ * @struct TableFieldCache
+ * @brief The fields of one recently drawn line.
+ */
+typedef struct {
+    size_t line;            /**< The cached line, or SIZE_MAX if the slot is empty. */
+    TableField* fields;     /**< The fields of the line. */
+    size_t count;           /**< The number of fields. */
+    size_t capacity;        /**< The allocated capacity of `fields`. */
+} TableFieldCache;
+
+/**
+ * @struct TableSort
+ * @brief A sort running in the background.
+ */
+typedef struct TableSort TableSort;
+
+/**
+ * @struct TableView
+ * @brief A delimited text file, its column layout and the current row order.
+ */
+typedef struct {
+    LineIndex text;                 /**< The file bytes and the start of each line. */
+    char delimiter;                 /**< The field separator. */
+    size_t row_count;               /**< The number of data rows, excluding the header. */
+    size_t column_count;            /**< The number of columns in the header. */
+    uint16_t* widths;               /**< The sampled display width of each column. */
+    TableFieldCache cache[TABLE_CACHE_LINES]; /**< Field offsets of recently drawn lines, by line number. */
+
+    size_t* order;                  /**< The line shown on each row when sorted, or NULL for file order. */
+    int sort_column;                /**< The column `order` is sorted by, or -1. */
+    bool sort_descending;           /**< True if `order` is in descending order. */
+    TableSort* pending;             /**< The sort being computed, or NULL. */
+} TableView;
+
+/**
+ * @brief Returns true if a file should be shown as a table.
+ *
+ * @param path The path of the file.
+ * @param mime The MIME type reported by libmagic, or NULL if unknown.
+ * @return True for CSV and TSV MIME types and the .csv, .tsv and .tab extensions.
+ */
+bool table_view_detect(const char* path, const char* mime);
+
+/**
+ * @brief Opens a file, guesses its delimiter and samples its column widths.
+ *
+ * @param view Pointer to the TableView to initialize.
+ * @param path The path of the file.
+ * @return FAT_SUCCESS, FAT_ERROR_UNSUPPORTED if no delimiter splits the header of a
+ *         file without a .tsv or .tab extension into two fields, or an error code if
+ *         the file cannot be read.
+ */
+FatResult table_view_open(TableView* view, const char* path);
+
+/**
+ * @brief Returns the line of the file shown on a row, taking the sort order into account.
+ * @param view Pointer to an open TableView.
+ * @param row The zero-based data row.
+ * @return The zero-based line number; the header is line 0.
+ */
+size_t table_view_line(const TableView* view, size_t row);
+
+/**
+ * @brief Returns the fields of a line, parsing it if it is not cached.
+ *
+ * Delimiters inside double-quoted fields are skipped. The returned array
+ * stays valid until the next call.
+ *
+ * @param view Pointer to an open TableView.
+ * @param line The zero-based line number.
+ * @param count Set to the number of fields.
+ * @return The fields of the line, or NULL if the line does not exist or memory ran out.
+ */
+const TableField* table_view_fields(TableView* view, size_t line, size_t* count);
+
+/**
+ * @brief Writes the displayable text of a cell.
+ *
+ * Surrounding quotes are removed, doubled quotes are collapsed and control
+ * characters become spaces.
+ *
+ * @param view Pointer to an open TableView.
+ * @param line The zero-based line number.
+ * @param column The zero-based column.
+ * @param out The buffer receiving the null-terminated text.
+ * @param size The size of `out`.
+ * @return The length of the text written, 0 for a missing cell.
+ */
+size_t table_view_cell(TableView* view, size_t line, size_t column, char* out, size_t size);
+
+/**
+ * @brief Finds a column by 1-based number or by header name.
+ *
+ * Names match case-insensitively, exactly first and then by prefix.
+ *
+ * @param view Pointer to an open TableView.
+ * @param text The number or name typed by the user.
+ * @return The zero-based column, or -1 if nothing matches.
+ */
+int table_view_find_column(TableView* view, const char* text);
+
+/**
+ * @brief Starts sorting the rows by a column in the background.
+ *
+ * Numbers compare numerically and sort before text, which compares byte by
+ * byte. Rows with equal keys keep their file order. A sort already running
+ * is cancelled.
+ *
+ * @param view Pointer to an open TableView.
+ * @param column The zero-based column to sort by.
+ * @param descending True to sort from the largest key down.
+ * @return FAT_SUCCESS, or an error code if the thread cannot be started.
+ */
+FatResult table_view_sort_start(TableView* view, size_t column, bool descending);
+
+/**
+ * @brief Adopts the result of a finished sort.
+ * @param view Pointer to an open TableView.
+ * @return True if the row order changed.
+ */
+bool table_view_sort_poll(TableView* view);
+
+/**
+ * @brief Returns true while a sort is running.
+ * @param view Pointer to an open TableView.
+ */
+bool table_view_sort_is_running(const TableView* view);
+
+/**
+ * @brief Cancels any running sort and restores the file order.
+ * @param view Pointer to an open TableView.
+ */
+void table_view_clear_sort(TableView* view);
+
+/**
+ * @brief Returns the heap memory held by the view: the text, the column widths, the field caches and the sort order.
+ *
+ * A sort still running counts for the order it is filling.
+ *
+ * @param view Pointer to an open TableView.
+ * @return The approximate heap usage in bytes.
+ */
+size_t table_view_memory_usage(const TableView* view);
+
+/**
+ * @brief Stops any running sort and frees the view.
+ * @param view Pointer to the TableView to free. It is left in an empty state.
+ */
+void table_view_free(TableView* view);
+
+#endif // TABLE_VIEW_H
@@ -0,0 +1,125 @@
+/**
+ * @file text_encoding.h
+ * @author Zuhaitz (original)
+ * @brief Defines the detection of text encodings and the streaming conversion to UTF-8.
+ *
+ * Everything past the loader works on UTF-8, so a file in another encoding
+ * is converted once as it is opened, chunk by chunk. The encoding is told
+ * from a byte order mark where there is one, and otherwise guessed from a
+ * sample of the head of the file: the zero bytes of ASCII text in UTF-16,
+ * whether the bytes are mostly valid UTF-8, and whether the high bytes pair
+ * up as Shift-JIS does. What is left is taken for Latin-1. UTF-8 with a few
+ * invalid bytes stays UTF-8, and the bytes are drawn as U+FFFD.
+ *
+ * UTF-16 and Latin-1 are converted here; Shift-JIS goes through iconv.
+ */
+#ifndef TEXT_ENCODING_H
+#define TEXT_ENCODING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "core/error.h"
+
+/** @brief The number of bytes at the head of a file the detection looks at. */
+#define TEXT_ENCODING_SAMPLE_SIZE (64 * 1024)
+
+/** @brief The most UTF-8 bytes one input byte can become, in any supported encoding. */
+#define TEXT_ENCODING_MAX_GROWTH 3
+
+/**
+ * @enum TextEncoding
+ * @brief The encodings text files can be read in.
+ */
+typedef enum {
+    TEXT_ENCODING_UTF8,         /**< UTF-8, or plain ASCII; read as is. */
+    TEXT_ENCODING_UTF16LE,      /**< UTF-16, little-endian, as Windows writes it. */
+    TEXT_ENCODING_UTF16BE,      /**< UTF-16, big-endian. */
+    TEXT_ENCODING_LATIN1,       /**< ISO-8859-1, with the Windows-1252 characters in 0x80-0x9F. */
+    TEXT_ENCODING_SHIFT_JIS,    /**< Shift-JIS, with the Windows (CP932) extensions. */
+    TEXT_ENCODING_COUNT
+} TextEncoding;
+
+/**
+ * @struct TextTranscoder
+ * @brief The state of a conversion to UTF-8 that is fed one chunk at a time.
+ *
+ * A character split between two chunks is held back and finished with the
+ * next one, so chunks can be cut anywhere.
+ */
+typedef struct {
+    TextEncoding encoding;
+    unsigned char pending[4];   /**< The bytes of a character cut off at the end of the last chunk. */
+    size_t pending_len;         /**< The number of bytes in `pending`. */
+    unsigned int high_surrogate; /**< A UTF-16 high surrogate waiting for its pair, or 0. */
+    void* iconv;                /**< The iconv descriptor, for the encodings converted through iconv. */
+    char* scratch;              /**< The pending bytes followed by the chunk, for iconv. */
+    size_t scratch_size;        /**< The number of bytes allocated for `scratch`. */
+} TextTranscoder;
+
+/**
+ * @brief Returns the display name of an encoding (e.g., "UTF-16LE").
+ */
+const char* text_encoding_name(TextEncoding encoding);
+
+/**
+ * @brief Guesses the encoding of text from a sample of its head.
+ *
+ * @param data The first bytes of the text; at most TEXT_ENCODING_SAMPLE_SIZE are looked at.
+ * @param size The number of bytes.
+ * @param bom_length Set to the length of the byte order mark the text starts with, or 0. May be NULL.
+ * @return The encoding. Text with no telling bytes (ASCII) is UTF-8, and so is text with
+ *         no more invalid UTF-8 bytes than valid multibyte characters.
+ */
+TextEncoding text_encoding_detect(const char* data, size_t size, size_t* bom_length);
+
+/**
+ * @brief Guesses the encoding of a file from a sample of its head.
+ *
+ * @param path The path of the file.
+ * @param encoding Set to the encoding.
+ * @return FAT_SUCCESS, or an error code (e.g., FAT_ERROR_FILE_READ) if the file cannot be read.
+ */
+FatResult text_encoding_detect_file(const char* path, TextEncoding* encoding);
+
+/**
+ * @brief Returns the length of the byte order mark of an encoding that text starts with, or 0.
+ */
+size_t text_encoding_bom_length(TextEncoding encoding, const char* data, size_t size);
+
+/**
+ * @brief Starts a conversion to UTF-8.
+ *
+ * @param transcoder Pointer to the TextTranscoder to initialize.
+ * @param encoding The encoding of the input. It must not be TEXT_ENCODING_UTF8.
+ * @return FAT_SUCCESS, or FAT_ERROR_UNSUPPORTED if the system cannot convert from the encoding.
+ */
+FatResult text_transcoder_init(TextTranscoder* transcoder, TextEncoding encoding);
+
+/**
+ * @brief Converts the next chunk of input to UTF-8.
+ *
+ * Bytes that are not valid in the encoding become U+FFFD.
+ *
+ * @param transcoder Pointer to a started TextTranscoder.
+ * @param input The chunk.
+ * @param size The number of bytes in the chunk.
+ * @param last True for the last chunk, so that a character left unfinished is flushed.
+ * @param output Receives the UTF-8; it must hold text_transcoder_bound(size) bytes.
+ * @param written Set to the number of bytes written.
+ * @return FAT_SUCCESS, or FAT_ERROR_MEMORY.
+ */
+FatResult text_transcoder_convert(TextTranscoder* transcoder, const char* input, size_t size, bool last,
+                                  char* output, size_t* written);
+
+/**
+ * @brief Returns the most UTF-8 bytes a chunk of `size` bytes can be converted to.
+ */
+size_t text_transcoder_bound(size_t size);
+
+/**
+ * @brief Frees a conversion.
+ * @param transcoder Pointer to the TextTranscoder to free.
+ */
+void text_transcoder_free(TextTranscoder* transcoder);
+
+#endif // TEXT_ENCODING_H
@@ -0,0 +1,164 @@
+/**
+ * @file time_histogram.h
+ * @author Zuhaitz (original)
+ * @brief Defines the timeline of a log: how many lines, or lines matching a term, fall in each stretch of time.
+ *
+ * Lines are sorted into buckets by the timestamp at their start, parsed with
+ * the time index's parser; lines without one belong to the stamped line
+ * above them. Buckets start a minute wide and double in width whenever the
+ * log spans more than TIME_HISTOGRAM_MAX_BUCKETS of them, so a timeline
+ * over years costs no more memory than one over an hour.
+ *
+ * A memory-mapped file is scanned by a background thread that publishes its
+ * counts every TIME_HISTOGRAM_PUBLISH_LINES lines. Standard input, which is
+ * still growing, is fed to the timeline as its lines arrive instead.
+ */
+#ifndef TIME_HISTOGRAM_H
+#define TIME_HISTOGRAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "core/error.h"
+#include "core/line_index.h"
+#include "core/time_index.h"
+
+/** @brief The most buckets kept; the bucket width doubles rather than exceed it. */
+#define TIME_HISTOGRAM_MAX_BUCKETS 1024
+
+/** @brief The width of a bucket, in seconds, before any doubling. */
+#define TIME_HISTOGRAM_MIN_WIDTH 60
+
+/** @brief How many lines the background scan counts between two updates of the shared counts. */
+#define TIME_HISTOGRAM_PUBLISH_LINES 65536
+
+/** @brief The longest term counted, in bytes; matches the search input. */
+#define TIME_HISTOGRAM_MAX_TERM_LEN 255
+
+/**
+ * @struct TimeBucket
+ * @brief The lines that fall in one stretch of time.
+ */
+typedef struct {
+    size_t lines;               /**< The number of lines in the bucket. */
+    size_t matches;             /**< The number of those lines that contain the term. */
+    size_t first_line;          /**< The first line in the bucket, if `lines` is not zero. */
+    size_t first_match;         /**< The first line containing the term, if `matches` is not zero. */
+} TimeBucket;
+
+/**
+ * @struct TimeHistogramCounts
+ * @brief The buckets of a timeline, and where the scan that fills them has got.
+ */
+typedef struct {
+    int64_t start;              /**< The time the first bucket starts at, on a whole minute. */
+    int64_t width;              /**< The width of a bucket, in seconds. */
+    TimeBucket buckets[TIME_HISTOGRAM_MAX_BUCKETS];
+    size_t count;               /**< The number of buckets from the first to the last with lines. */
+    size_t current;             /**< The bucket of the last stamped line counted. */
+    size_t line_count;          /**< The number of lines counted. */
+    bool has_time;              /**< True once a stamped line has been counted and `start` is set. */
+} TimeHistogramCounts;
+
+/**
+ * @struct TimeHistogram
+ * @brief The timeline of a log, as built so far.
+ */
+typedef struct {
+    TimeFormat format;          /**< The format the lines are parsed with. */
+    char term[TIME_HISTOGRAM_MAX_TERM_LEN + 1]; /**< The term whose matching lines are counted, or empty. */
+    size_t term_len;            /**< The length of `term`. */
+
+    // **Read by the background scan; owned by the view's line index**
+    const char* data;
+    size_t size;
+    const size_t* offsets;
+    size_t source_lines;        /**< The number of lines in the line index, or 0 when lines are fed. */
+
+    // **Shared with the background scan (protected by `lock`)**
+    pthread_mutex_t lock;
+    TimeHistogramCounts* shared; /**< The counts published so far. */
+    unsigned version;           /**< Incremented on every publication. */
+    bool finished;              /**< Set once every line has been counted. */
+    bool cancel;                /**< Set to ask the scan to stop. */
+
+    // **UI thread only**
+    TimeHistogramCounts* counts; /**< The counts adopted at the last poll, or fed directly. */
+    unsigned seen_version;      /**< The value of `version` at the last poll. */
+    bool done;                  /**< Set once the last counts have been adopted. */
+
+    pthread_t thread;
+    bool has_thread;            /**< True if the background scan was started. */
+} TimeHistogram;
+
+/**
+ * @brief Starts building the timeline of a log.
+ *
+ * @param hist Pointer to the TimeHistogram to initialize.
+ * @param format The format detected with `time_detect_format`.
+ * @param term The term whose matching lines are counted as well, or NULL.
+ * @param lines The line index to scan in the background, or NULL to feed
+ * the lines with `time_histogram_feed`. It must outlive the TimeHistogram
+ * and not be rebuilt while it runs.
+ * @return FAT_SUCCESS, FAT_ERROR_INVALID_ARGUMENT without a format, or FAT_ERROR_MEMORY.
+ */
+FatResult time_histogram_start(TimeHistogram* hist, TimeFormat format, const char* term, const LineIndex* lines);
+
+/**
+ * @brief Counts the next lines of content that is fed rather than scanned.
+ *
+ * @param hist Pointer to a TimeHistogram started without a line index.
+ * @param get Returns the lines of the content.
+ * @param ctx Passed to `get`.
+ * @param line_count The number of lines received so far.
+ * @param max_lines The most lines to count in this call.
+ * @return True if lines remain to be counted.
+ */
+bool time_histogram_feed(TimeHistogram* hist, TimeLineGetter get, const void* ctx, size_t line_count, size_t max_lines);
+
+/**
+ * @brief Adopts the counts published by the background scan since the last call.
+ * @param hist Pointer to a started TimeHistogram.
+ * @return True if the counts changed.
+ */
+bool time_histogram_poll(TimeHistogram* hist);
+
+/**
+ * @brief Returns true until the background scan has counted every line and its counts have been adopted.
+ * @param hist Pointer to a started TimeHistogram.
+ */
+bool time_histogram_is_running(const TimeHistogram* hist);
+
+/**
+ * @brief Returns how many buckets each of a number of columns shows, so the timeline fits in them.
+ * @param counts The counts to lay out.
+ * @param columns The number of columns available, at least 1.
+ */
+size_t time_histogram_span(const TimeHistogramCounts* counts, size_t columns);
+
+/**
+ * @brief Adds up the buckets one column shows.
+ * @param counts The counts to look in.
+ * @param column The column.
+ * @param span The number of buckets per column, from `time_histogram_span`.
+ * @param out Receives the lines and matches of the column and the first of each.
+ * @return True if the column holds any line.
+ */
+bool time_histogram_column(const TimeHistogramCounts* counts, size_t column, size_t span, TimeBucket* out);
+
+/**
+ * @brief Returns the bucket a line was counted in.
+ * @param counts The counts to look in.
+ * @param line A line of the content.
+ * @return The last bucket whose first line is at or before `line`, or 0.
+ */
+size_t time_histogram_bucket_of(const TimeHistogramCounts* counts, size_t line);
+
+/**
+ * @brief Stops the background scan and frees the timeline.
+ * @param hist Pointer to the TimeHistogram to free. It is left in an empty state.
+ */
+void time_histogram_free(TimeHistogram* hist);
+
+#endif // TIME_HISTOGRAM_H
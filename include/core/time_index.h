@@ -0,0 +1,169 @@
+/**
+ * @file time_index.h
+ * @author Zuhaitz (original)
+ * @brief Defines the timestamp parser and the time-to-line index of a log.
+ *
+ * Lines are recognised by a timestamp at their start: ISO-8601
+ * (`2024-05-01T14:32:10.123Z`, `2024-05-01 14:32:10`), syslog
+ * (`May  1 14:32:10`) or a Unix epoch in seconds or milliseconds, optionally
+ * inside a leading `[`. Times are compared as written: zone offsets are
+ * ignored and syslog times, which have no year, all fall in 1970.
+ *
+ * As logs are written in time order, the line at a given time is found by
+ * binary search over the line index, parsing O(log n) lines. Lines without
+ * a timestamp (stack traces, wrapped messages) belong to the stamped line
+ * above them. A background pass samples a timestamp every
+ * TIME_INDEX_STRIDE lines into a checkpoint table, which narrows later
+ * searches to a single stride.
+ */
+#ifndef TIME_INDEX_H
+#define TIME_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "core/error.h"
+#include "core/line_index.h"
+
+/** @brief The number of lines between two checkpoints. */
+#define TIME_INDEX_STRIDE 4096
+
+/** @brief How many lines at the start of a file are looked at to detect its timestamp format. */
+#define TIME_DETECT_LINES 64
+
+/**
+ * @enum TimeFormat
+ * @brief The timestamp formats recognised at the start of a line.
+ */
+typedef enum {
+    TIME_FORMAT_NONE,           /**< No timestamp, or try every format. */
+    TIME_FORMAT_ISO8601,        /**< `YYYY-MM-DD[T ]HH:MM[:SS]`, with any fraction or zone ignored. */
+    TIME_FORMAT_SYSLOG,         /**< `Mmm dd HH:MM:SS`. */
+    TIME_FORMAT_EPOCH           /**< Seconds (10 digits) or milliseconds (13 digits) since 1970. */
+} TimeFormat;
+
+/**
+ * @brief Returns a line of the content being searched, which is not null-terminated.
+ */
+typedef const char* (*TimeLineGetter)(const void* ctx, size_t line, size_t* len);
+
+/**
+ * @struct TimeCheckpoint
+ * @brief A stamped line and its time.
+ */
+typedef struct {
+    size_t line;
+    int64_t time;
+} TimeCheckpoint;
+
+/**
+ * @struct TimeIndex
+ * @brief The timestamp format of a file and its checkpoint table.
+ */
+typedef struct {
+    TimeFormat format;          /**< The format the file's lines are parsed with. */
+
+    // **Read by the background pass; owned by the view's line index**
+    const char* data;
+    size_t size;
+    const size_t* offsets;
+    size_t line_count;
+
+    // **Shared with the background pass (protected by `lock`)**
+    pthread_mutex_t lock;
+    TimeCheckpoint* checkpoints; /**< One stamped line per stride, in line order. */
+    size_t count;               /**< The number of checkpoints. */
+    size_t capacity;            /**< The allocated capacity of `checkpoints`. */
+    bool done;                  /**< Set once every stride has been sampled. */
+    bool cancel;                /**< Set to ask the pass to stop. */
+
+    pthread_t thread;
+    bool has_thread;            /**< True if the background pass was started. */
+} TimeIndex;
+
+/**
+ * @brief Parses the timestamp at the start of a line.
+ *
+ * @param text The line, which need not be null-terminated.
+ * @param len The length of the line.
+ * @param format The format to expect, or TIME_FORMAT_NONE to try each.
+ * @param out_time Receives the time in seconds since 1970, as written.
+ * @return The format that matched, or TIME_FORMAT_NONE if the line has no timestamp.
+ */
+TimeFormat time_parse(const char* text, size_t len, TimeFormat format, int64_t* out_time);
+
+/**
+ * @brief Parses a time typed by the user.
+ *
+ * Accepts a full date and time (`2024-05-01 14:32:10`, seconds optional), a
+ * date alone, a syslog date and time, an epoch, or a time of day alone
+ * (`14:32:10`), which is taken on the day of `reference`.
+ *
+ * @param text The null-terminated text.
+ * @param reference A time on the day a time of day refers to.
+ * @param out_time Receives the time in seconds since 1970.
+ * @return True if the text was understood.
+ */
+bool time_parse_target(const char* text, int64_t reference, int64_t* out_time);
+
+/**
+ * @brief Formats a time as `YYYY-MM-DD HH:MM:SS`.
+ */
+void time_format(int64_t time, char* buffer, size_t size);
+
+/**
+ * @brief Detects the timestamp format from the first lines of the content.
+ * @return The format of the first stamped line, or TIME_FORMAT_NONE.
+ */
+TimeFormat time_detect_format(TimeLineGetter get, const void* ctx, size_t line_count);
+
+/**
+ * @brief Starts sampling the checkpoints of a line index in the background.
+ *
+ * @param index Pointer to the TimeIndex to initialize.
+ * @param format The format detected with `time_detect_format`.
+ * @param lines The line index to sample, or NULL for content that is still
+ * growing, which gets no checkpoints. It must outlive the TimeIndex and
+ * not be rebuilt while it runs.
+ * @return FAT_SUCCESS, or FAT_ERROR_INVALID_ARGUMENT without a format.
+ */
+FatResult time_index_start(TimeIndex* index, TimeFormat format, const LineIndex* lines);
+
+/**
+ * @brief Finds the first stamped line at or after a time.
+ *
+ * The search is narrowed to a single stride by the checkpoints sampled so
+ * far, then binary-searches the lines.
+ *
+ * @param index Pointer to a started TimeIndex.
+ * @param get Returns the lines of the content.
+ * @param ctx Passed to `get`.
+ * @param line_count The number of lines in the content.
+ * @param target The time, in seconds since 1970.
+ * @param out_line Receives the line.
+ * @param out_parsed Receives the number of lines parsed, or NULL.
+ * @return True if a line was found; false if every line is earlier.
+ */
+bool time_index_find(TimeIndex* index, TimeLineGetter get, const void* ctx, size_t line_count,
+                     int64_t target, size_t* out_line, size_t* out_parsed);
+
+/**
+ * @brief Returns the time of a line, or of the nearest stamped line above or, failing that, below it.
+ *
+ * @param index Pointer to a started TimeIndex.
+ * @param get Returns the lines of the content.
+ * @param ctx Passed to `get`.
+ * @param line The line.
+ * @param out_time Receives the time.
+ * @return True if a stamped line was found within TIME_INDEX_STRIDE lines.
+ */
+bool time_index_line_time(const TimeIndex* index, TimeLineGetter get, const void* ctx, size_t line, int64_t* out_time);
+
+/**
+ * @brief Stops the background pass and frees the index.
+ * @param index Pointer to the TimeIndex to free. It is left in an empty state.
+ */
+void time_index_free(TimeIndex* index);
+
+#endif // TIME_INDEX_H
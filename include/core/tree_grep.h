@@ -0,0 +1,181 @@
+/**
+ * @file tree_grep.h
+ * @author Zuhaitz (original)
+ * @brief Defines the background job that searches every file under a directory.
+ *
+ * The tree is walked by a pool of threads with a work-stealing scheduler:
+ * each worker owns a deque of tasks (directories to list, files to search,
+ * archive entries to stream), pushes the tasks it discovers onto its own
+ * tail and takes its next one from there, so it keeps working depth-first
+ * on the part of the tree it is already in. A worker whose deque runs dry
+ * steals from the head of another's, which holds the oldest, and so the
+ * largest, pieces of work left.
+ *
+ * Plain files are opened through the line index, memory-mapped, and
+ * searched line by line. Files a plugin claims are listed and each entry is
+ * streamed through the plugin's `plugin_read_entry`, or extracted to a
+ * temporary file when it has none. When the plugin exports an
+ * ArchiveSession, a worker keeps the last archive it read from open and
+ * reads entries by position, so an archive is not reopened and searched
+ * for every entry; the entries are queued so the worker that lists an
+ * archive takes them in its order. Files and entries that look binary are
+ * skipped.
+ *
+ * Hits are reported in the order they are found, one per matching line.
+ */
+#ifndef TREE_GREP_H
+#define TREE_GREP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+#include "core/error.h"
+#include "plugins/plugin_api.h"
+
+/** @brief The maximum number of threads walking one tree. */
+#define TREE_GREP_MAX_THREADS 8
+
+/** @brief The longest term, in bytes; matches the search input. */
+#define TREE_GREP_MAX_TERM_LEN 255
+
+/** @brief The most hits kept; the search stops once it has found this many. */
+#define TREE_GREP_MAX_HITS 100000
+
+/** @brief The most bytes of a matching line shown in its row. */
+#define TREE_GREP_SNIPPET_LEN 200
+
+/** @brief The longest line searched in a streamed entry; longer ones mark the entry as binary. */
+#define TREE_GREP_MAX_LINE_LEN (1024 * 1024)
+
+/**
+ * @enum TreeGrepTaskKind
+ * @brief What a task asks a worker to do.
+ */
+typedef enum {
+    TREE_GREP_TASK_DIR,         /**< List a directory and queue what is in it. */
+    TREE_GREP_TASK_FILE,        /**< Search a file, or list it if it is an archive. */
+    TREE_GREP_TASK_ENTRY        /**< Search one entry of an archive. */
+} TreeGrepTaskKind;
+
+/**
+ * @struct TreeGrepTask
+ * @brief A unit of work in a worker's deque.
+ */
+typedef struct {
+    TreeGrepTaskKind kind;
+    char* path;                 /**< The directory, file or archive. */
+    char* entry;                /**< The archive entry, for TREE_GREP_TASK_ENTRY. */
+    const ArchivePlugin* plugin; /**< The plugin that handles the archive, for TREE_GREP_TASK_ENTRY. */
+    size_t entry_index;         /**< The position of `entry` in the plugin's listing, for TREE_GREP_TASK_ENTRY. */
+} TreeGrepTask;
+
+/**
+ * @struct TreeGrepDeque
+ * @brief The tasks owned by one worker, as a growable ring.
+ *
+ * The owner pushes and pops at the tail; thieves take from the head.
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    TreeGrepTask* tasks;
+    size_t head;                /**< The index of the oldest task. */
+    size_t count;               /**< The number of tasks queued. */
+    size_t capacity;            /**< The allocated capacity of `tasks`. */
+} TreeGrepDeque;
+
+/**
+ * @struct TreeGrepHit
+ * @brief A line that contains the term.
+ */
+typedef struct {
+    char* path;                 /**< The file, or the archive that holds `entry`. */
+    char* entry;                /**< The archive entry, or NULL for a plain file. */
+    size_t line;                /**< The one-based line number. */
+    char* row;                  /**< The location and text of the line, as shown. */
+} TreeGrepHit;
+
+struct TreeGrep;
+
+/**
+ * @struct TreeGrepWorker
+ * @brief What a worker thread is started with.
+ */
+typedef struct {
+    struct TreeGrep* grep;
+    int id;                     /**< The index of the worker's own deque. */
+    char* archive_path;         /**< The archive the worker last read entries from, or NULL. */
+    void* archive;              /**< That archive, still open, or NULL if it could not be opened. */
+    ArchiveSession session;     /**< The functions `archive` was opened with. */
+} TreeGrepWorker;
+
+/**
+ * @struct TreeGrep
+ * @brief A term and the lines under a directory that contain it.
+ */
+typedef struct TreeGrep {
+    char* term;                 /**< The term searched for. */
+    size_t term_len;            /**< The length of `term`. */
+    char* root;                 /**< The directory or file searched. */
+    size_t root_len;            /**< The length of the prefix stripped from the rows. */
+    TreeGrepDeque deques[TREE_GREP_MAX_THREADS]; /**< One deque per worker. */
+    int deque_count;            /**< The number of deques in use. */
+
+    // **Shared with the workers (protected by `lock`)**
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;  /**< Signalled when a task is queued or the last one finishes. */
+    size_t pending;             /**< The tasks queued or being worked on. */
+    TreeGrepHit* found;         /**< The hits found since the last poll. */
+    size_t found_count;         /**< The number of hits in `found`. */
+    size_t found_capacity;      /**< The allocated capacity of `found`. */
+    size_t found_total;         /**< The number of hits found in all. */
+    size_t files_searched;      /**< The number of files and entries searched. */
+    bool finished;              /**< Set once no task is left. */
+    bool truncated;             /**< Set if the search stopped at TREE_GREP_MAX_HITS. */
+    bool cancel;                /**< Set to ask the workers to stop. */
+
+    // **UI thread only**
+    TreeGrepHit* hits;          /**< The hits adopted so far, in arrival order. */
+    size_t count;               /**< The number of hits in `hits`. */
+    size_t capacity;            /**< The allocated capacity of `hits`. */
+    size_t files_done;          /**< The value of `files_searched` at the last poll. */
+    bool done;                  /**< Set once the last hit has been adopted. */
+    bool failed;                /**< Set if the results could not be stored; the search is shown as far as it got. */
+
+    TreeGrepWorker workers[TREE_GREP_MAX_THREADS];
+    pthread_t threads[TREE_GREP_MAX_THREADS]; /**< The workers. */
+    int thread_count;           /**< The number of started workers. */
+} TreeGrep;
+
+/**
+ * @brief Starts searching every file under a directory for a term in the background.
+ *
+ * Symbolic links to files are followed; symbolic links to directories are
+ * not, so a loop in the tree cannot keep the search going forever.
+ *
+ * @param grep Pointer to the TreeGrep to initialize.
+ * @param root The directory to search, or a single file.
+ * @param term The term, at most TREE_GREP_MAX_TERM_LEN bytes.
+ * @return FAT_SUCCESS, FAT_ERROR_INVALID_ARGUMENT for an empty or overlong term, or FAT_ERROR_MEMORY.
+ */
+FatResult tree_grep_start(TreeGrep* grep, const char* root, const char* term);
+
+/**
+ * @brief Adopts the hits found since the last call.
+ * @param grep Pointer to a started TreeGrep.
+ * @return True if hits were added or the progress changed.
+ */
+bool tree_grep_poll(TreeGrep* grep);
+
+/**
+ * @brief Returns true until every file has been searched and every hit adopted.
+ * @param grep Pointer to a started TreeGrep.
+ */
+bool tree_grep_is_running(const TreeGrep* grep);
+
+/**
+ * @brief Stops the workers and frees the search.
+ * @param grep Pointer to the TreeGrep to free. It is left in an empty state.
+ */
+void tree_grep_free(TreeGrep* grep);
+
+#endif // TREE_GREP_H
@@ -0,0 +1,120 @@
+/**
+ * @file binary_format.h
+ * @author Zuhaitz (original)
+ * @brief Defines the executable format layer shown alongside the hex view.
+ *
+ * ELF, PE and Mach-O files are recognised from their headers. Opening one
+ * reads only the headers and the section and segment tables, with positioned
+ * reads, so even very large binaries open instantly. The symbol tables are
+ * read the first time a symbol is looked up, and the names are put into a
+ * hash index so that every later lookup costs one probe.
+ */
+#ifndef BINARY_FORMAT_H
+#define BINARY_FORMAT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "core/error.h"
+
+/**
+ * @enum BinaryKind
+ * @brief The executable formats that are understood.
+ */
+typedef enum {
+    BINARY_KIND_ELF,    /**< ELF, 32 or 64-bit, either byte order. */
+    BINARY_KIND_PE,     /**< PE/COFF, PE32 or PE32+. */
+    BINARY_KIND_MACHO   /**< Mach-O, 32 or 64-bit, either byte order (not universal files). */
+} BinaryKind;
+
+/**
+ * @struct BinarySection
+ * @brief A section or segment of the file.
+ */
+typedef struct {
+    char name[32];      /**< The section name, or the segment type for ELF program headers. */
+    bool is_segment;    /**< True for segments (ELF program headers, Mach-O segments). */
+    uint64_t offset;    /**< The offset of the contents in the file. */
+    uint64_t size;      /**< The size of the contents in the file, 0 if it occupies none. */
+    uint64_t address;   /**< The virtual address the contents are loaded at. */
+} BinarySection;
+
+/**
+ * @struct BinarySymbol
+ * @brief A named location in the file.
+ */
+typedef struct {
+    uint32_t name;      /**< The offset of the name in `BinaryFormat.names`. */
+    uint64_t address;   /**< The virtual address of the symbol. */
+    uint64_t offset;    /**< The file offset of the symbol, or UINT64_MAX if it has no contents in the file. */
+} BinarySymbol;
+
+/**
+ * @struct BinaryFormat
+ * @brief The parsed headers of an executable and its lazily loaded symbols.
+ */
+typedef struct {
+    char* path;                 /**< The path of the file, to read the symbols on demand. */
+    BinaryKind kind;            /**< The format of the file. */
+    char description[64];       /**< A short description, e.g. "ELF64 x86-64 executable". */
+    BinarySection* sections;    /**< Sections first, then segments, each in file order. */
+    size_t section_count;       /**< The number of entries in `sections`. */
+
+    bool symbols_loaded;        /**< True once the symbol tables have been read. */
+    BinarySymbol* symbols;      /**< The named symbols with an address. */
+    size_t symbol_count;        /**< The number of entries in `symbols`. */
+    char* names;                /**< The null-terminated symbol names, back to back. */
+    size_t names_size;          /**< The number of bytes allocated for `names`. */
+    uint32_t* buckets;          /**< The hash index: symbol index + 1 per slot, 0 for empty. */
+    size_t bucket_count;        /**< The number of slots in `buckets`, a power of two. */
+} BinaryFormat;
+
+/**
+ * @brief Recognises an executable and reads its section and segment tables.
+ *
+ * @param format Pointer to the BinaryFormat to initialize.
+ * @param path The path of the file.
+ * @return FAT_SUCCESS, FAT_ERROR_UNSUPPORTED if the file is not an executable
+ *         of a known format, or another error code.
+ */
+FatResult binary_format_open(BinaryFormat* format, const char* path);
+
+/**
+ * @brief Finds the section or segment containing a file offset.
+ *
+ * Sections are preferred over the segments that hold them.
+ *
+ * @param format Pointer to an open BinaryFormat.
+ * @param offset The file offset.
+ * @return The index of the entry in `sections`, or -1 if none contains the offset.
+ */
+int binary_format_section_at(const BinaryFormat* format, uint64_t offset);
+
+/**
+ * @brief Looks up a symbol by name, reading the symbol tables on first use.
+ *
+ * An exact name is found through the hash index; otherwise the first symbol
+ * whose name contains `name` is returned.
+ *
+ * @param format Pointer to an open BinaryFormat.
+ * @param name The name to look for.
+ * @param symbol Set to the symbol found.
+ * @return FAT_SUCCESS, FAT_ERROR_FILE_NOT_FOUND if there is no such symbol,
+ *         or another error code if the tables cannot be read.
+ */
+FatResult binary_format_find_symbol(BinaryFormat* format, const char* name, const BinarySymbol** symbol);
+
+/**
+ * @brief Returns the heap memory held by the sections, the symbols, their names and the hash index.
+ * @param format Pointer to the BinaryFormat.
+ * @return The approximate heap usage in bytes.
+ */
+size_t binary_format_memory_usage(const BinaryFormat* format);
+
+/**
+ * @brief Frees the format.
+ * @param format Pointer to the BinaryFormat to free. It is left in an empty state.
+ */
+void binary_format_free(BinaryFormat* format);
+
+#endif // BINARY_FORMAT_H
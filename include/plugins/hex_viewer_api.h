@@ -3,28 +3,152 @@
  * @author Zuhaitz (original)
  * @brief Defines the interface for the binary file hex viewer.
  *
- * This module is responsible for taking a binary file and converting its
- * content into a traditional hex dump format (offset, hex bytes, ASCII representation)
- * for display in the UI.
+ * This module shows a binary file as a traditional hex dump (offset, hex
+ * bytes, ASCII representation). The file is mapped once and rows are
+ * formatted only when they are needed, through lookup tables rather than
+ * printf-style formatting, so opening a file costs nothing per byte and a
+ * full screen of rows formats in microseconds.
+ *
+ * The holes of a sparse file can be collapsed, each into a single row, so a
+ * mostly empty disk image or core dump scrolls and searches over its data
+ * alone. Rows then no longer map to offsets by a plain multiplication;
+ * `hex_view_row_offset` and `hex_view_offset_row` convert between them.
  */
 #ifndef HEX_VIEWER_API_H
 #define HEX_VIEWER_API_H
 
-#include "core/string_list.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "core/line_index.h"
 #include "core/error.h"
 
+/** @brief The size of a buffer that can hold any formatted row, terminator included. */
+#define HEX_ROW_MAX_BYTES 256
+
+/**
+ * @enum HexEndian
+ * @brief The byte order of the integer column, if it is shown.
+ */
+typedef enum {
+    HEX_ENDIAN_NONE,    /**< No integer column. */
+    HEX_ENDIAN_LITTLE,  /**< Words are decoded least significant byte first. */
+    HEX_ENDIAN_BIG      /**< Words are decoded most significant byte first. */
+} HexEndian;
+
+/**
+ * @struct HexLayout
+ * @brief The configured shape of a hex dump row.
+ */
+typedef struct {
+    int bytes_per_row;  /**< 8, 16 or 32 bytes per row, or 0 to fit the width of the pane. */
+    int group_size;     /**< Bytes printed together without spaces: 1, 2, 4 or 8. */
+    HexEndian endian;   /**< The byte order of the integer column. */
+    bool collapse_holes; /**< Show each hole of a sparse file as a single row. */
+} HexLayout;
+
+/**
+ * @struct HexHoleRow
+ * @brief A hole of a sparse file shown as a single row.
+ */
+typedef struct {
+    size_t row;                 /**< The row that stands for the hole. */
+    uint64_t first_row;         /**< The row its first byte would be on if no hole were collapsed. */
+    uint64_t rows;              /**< The whole rows of zeros it stands for. */
+} HexHoleRow;
+
+/**
+ * @struct HexView
+ * @brief A mapped file and the resolved layout of its hex dump.
+ */
+typedef struct {
+    LineIndex bytes;            /**< The file bytes; the lines are never indexed. */
+    HexLayout layout;           /**< The layout as configured. */
+    int bytes_per_row;          /**< The bytes shown on each row, once resolved. */
+    int offset_digits;          /**< Hex digits in the offset column: 8, or more past 4 GB. */
+    size_t row_count;           /**< The number of rows, a collapsed hole counting as one. */
+    size_t row_len;             /**< The length of a full row. */
+    HexHoleRow* hole_rows;      /**< The collapsed holes, in file order. */
+    size_t hole_row_count;      /**< The number of entries in `hole_rows`. */
+    char row[HEX_ROW_MAX_BYTES]; /**< Scratch for `hex_view_get_row`. */
+} HexView;
+
+/**
+ * @brief Maps a file for hex viewing.
+ *
+ * @param view Pointer to the HexView to initialize.
+ * @param filepath The path of the file.
+ * @param layout The layout to use. A bytes_per_row of 0 starts at 16 until `hex_view_fit` is called.
+ * @return FAT_SUCCESS, or an error code (e.g., FAT_ERROR_FILE_READ) on failure.
+ */
+FatResult hex_view_open(HexView* view, const char* filepath, const HexLayout* layout);
+
+/**
+ * @brief Picks the widest row that fits when the layout adapts to the pane.
+ *
+ * @param view Pointer to an open HexView.
+ * @param width The number of columns available for a row.
+ * @return True if the number of bytes per row changed.
+ */
+bool hex_view_fit(HexView* view, int width);
+
 /**
- * @brief Generates a hex dump of a given file's content.
+ * @brief Formats a row of the dump.
+ *
+ * Safe to call from several threads at once, each with its own buffer.
  *
- * Reads the file in 16-byte chunks and formats each chunk into a single
- * string line, which is then added to the output StringList.
+ * @param view Pointer to an open HexView.
+ * @param row The zero-based row.
+ * @param out A buffer of at least HEX_ROW_MAX_BYTES bytes receiving the null-terminated row.
+ * @return The length of the row, or 0 if it does not exist.
+ */
+size_t hex_view_format_row(const HexView* view, size_t row, char* out);
+
+/**
+ * @brief Returns the offset of the first byte shown on a row.
+ * @param view Pointer to an open HexView.
+ * @param row The zero-based row; a collapsed hole gives the offset of its first whole row.
+ */
+uint64_t hex_view_row_offset(const HexView* view, size_t row);
+
+/**
+ * @brief Returns the row showing the byte at an offset.
+ * @param view Pointer to an open HexView.
+ * @param offset A file offset; one inside a collapsed hole gives the row of the hole.
+ */
+size_t hex_view_offset_row(const HexView* view, uint64_t offset);
+
+/**
+ * @brief Returns the column of a byte within a formatted row.
  *
- * @param filepath The path to the binary file to dump.
- * @param dump_list A pointer to a StringList that will be populated with the
- * hex dump lines. The list should be initialized before calling.
- * @return FAT_SUCCESS on success, or an error code (e.g., FAT_ERROR_FILE_READ)
- * on failure.
+ * @param view Pointer to an open HexView.
+ * @param index The position of the byte in its row, from 0 to `bytes_per_row - 1`.
+ * @param ascii True for its character in the ASCII column, false for its first hex digit.
+ * @return The zero-based column.
+ */
+int hex_view_byte_column(const HexView* view, int index, bool ascii);
+
+/**
+ * @brief Formats a row into the view's scratch buffer.
+ *
+ * @param view Pointer to an open HexView.
+ * @param row The zero-based row.
+ * @param len Set to the length of the row.
+ * @return The null-terminated row, valid until the next call, or NULL if it does not exist.
+ */
+const char* hex_view_get_row(HexView* view, size_t row, size_t* len);
+
+/**
+ * @brief Returns the heap memory held by the view: the bytes, if they were read, and the collapsed holes.
+ * @param view Pointer to the HexView.
+ * @return The approximate heap usage in bytes.
+ */
+size_t hex_view_memory_usage(const HexView* view);
+
+/**
+ * @brief Unmaps the file.
+ * @param view Pointer to the HexView to free. It is left in an empty state.
  */
-FatResult hex_viewer_generate_dump(const char* filepath, StringList* dump_list);
+void hex_view_free(HexView* view);
 
 #endif // HEX_VIEWER_API_H
@@ -7,6 +7,14 @@
  * The plugin manager uses the ArchivePlugin struct to interact with loaded
  * plugins in a standardized way, without needing to know the specifics of
  * how each archive format (ZIP, TAR, etc.) is handled.
+ *
+ * A plugin may also export `plugin_read_entry`, an ArchiveEntryReader that
+ * streams an entry without writing it to disk, and `plugin_entry_crc32`, an
+ * ArchiveEntryCrc that reports the CRC-32 the archive records for an entry.
+ * To read many entries, a plugin may also export `plugin_open_archive`,
+ * `plugin_read_entry_at` and `plugin_close_archive` (an ArchiveSession),
+ * which keep the archive open between entries. They are looked up
+ * separately so plugins built before they existed keep loading unchanged.
  */
 #ifndef PLUGIN_API_H
 #define PLUGIN_API_H
@@ -14,6 +22,8 @@
 #include "core/string_list.h"
 #include "core/error.h"
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 /**
  * @struct ArchivePlugin
@@ -62,4 +72,88 @@ typedef struct {
 
 } ArchivePlugin;
 
+/**
+ * @brief Receives the next chunk of an entry read by an ArchiveEntryReader.
+ *
+ * @param data The decompressed bytes. They are only valid during the call.
+ * @param len The number of bytes in `data`.
+ * @param ctx The context given to the reader.
+ * @return `true` to keep reading, `false` to stop early.
+ */
+typedef bool (*ArchiveChunkCallback)(const char* data, size_t len, void* ctx);
+
+/**
+ * @brief Streams the decompressed content of a single entry, chunk by chunk.
+ *
+ * Plugins may export a function of this type named `plugin_read_entry`. It
+ * may be called from several threads at once, for different entries of the
+ * same archive, so it must not keep state between calls.
+ *
+ * @param archive_path The path to the archive file.
+ * @param entry_name The name of the entry, as returned by `list_contents`.
+ * @param on_chunk Called with each chunk, in order.
+ * @param ctx Passed through to `on_chunk`.
+ * @return FAT_SUCCESS once the entry has been read or `on_chunk` asked to stop,
+ * or an appropriate error code on failure.
+ */
+typedef FatResult (*ArchiveEntryReader)(const char* archive_path, const char* entry_name,
+                                        ArchiveChunkCallback on_chunk, void* ctx);
+
+/**
+ * @brief Reports the CRC-32 an archive records for an entry, without decompressing it.
+ *
+ * Plugins may export a function of this type named `plugin_entry_crc32`
+ * for formats that keep a CRC-32 of each entry's content, such as the
+ * central directory of a zip file or the trailer of a gzip member.
+ *
+ * @param archive_path The path to the archive file.
+ * @param entry_name The name of the entry, as returned by `list_contents`.
+ * @param crc Set to the recorded CRC-32 of the decompressed content.
+ * @return FAT_SUCCESS, FAT_ERROR_UNSUPPORTED if the archive records none for
+ * the entry, or an appropriate error code on failure.
+ */
+typedef FatResult (*ArchiveEntryCrc)(const char* archive_path, const char* entry_name, uint32_t* crc);
+
+/**
+ * @brief Opens an archive to read many of its entries through one handle.
+ *
+ * @param archive_path The path to the archive file.
+ * @param handle Set to the open archive, for `ArchiveIndexedReader` and `ArchiveCloser`.
+ * @return FAT_SUCCESS, or an appropriate error code on failure.
+ */
+typedef FatResult (*ArchiveOpener)(const char* archive_path, void** handle);
+
+/**
+ * @brief Streams the decompressed content of an entry of an open archive, chunk by chunk.
+ *
+ * Entries are named by their position in the list returned by
+ * `list_contents`, so no name has to be looked up. Reading them in that
+ * order is the cheapest, but any order works. A handle must only be used
+ * by one thread at a time; threads reading the same archive open their own.
+ *
+ * @param handle An archive opened by the plugin's `ArchiveOpener`.
+ * @param index The position of the entry in the list returned by `list_contents`.
+ * @param on_chunk Called with each chunk, in order.
+ * @param ctx Passed through to `on_chunk`.
+ * @return FAT_SUCCESS once the entry has been read or `on_chunk` asked to stop,
+ * or an appropriate error code on failure.
+ */
+typedef FatResult (*ArchiveIndexedReader)(void* handle, size_t index, ArchiveChunkCallback on_chunk, void* ctx);
+
+/**
+ * @brief Closes an archive opened by an `ArchiveOpener`.
+ * @param handle The open archive.
+ */
+typedef void (*ArchiveCloser)(void* handle);
+
+/**
+ * @struct ArchiveSession
+ * @brief The functions a plugin exports to read many entries of one archive.
+ */
+typedef struct {
+    ArchiveOpener open;         /**< The plugin's `plugin_open_archive`. */
+    ArchiveIndexedReader read;  /**< The plugin's `plugin_read_entry_at`. */
+    ArchiveCloser close;        /**< The plugin's `plugin_close_archive`. */
+} ArchiveSession;
+
 #endif // PLUGIN_API_H
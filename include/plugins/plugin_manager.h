@@ -16,7 +16,8 @@
  *
  * This function scans a directory for shared library files (.so), opens them,
  * finds the `plugin_register` symbol, and stores the returned ArchivePlugin
- * interface. This should be called once at application startup.
+ * interface, along with the optional `plugin_read_entry`, `plugin_entry_crc32` and
+ * ArchiveSession symbols. This should be called once at application startup.
  *
  * @param plugin_dir_path The path to the directory containing plugin .so files.
  */
@@ -34,4 +35,31 @@ void pm_load_plugins(const char* plugin_dir_path);
  */
 const ArchivePlugin* pm_get_handler(const char* filepath);
 
+/**
+ * @brief Returns the streaming reader a plugin exports, if any.
+ *
+ * @param plugin A plugin returned by `pm_get_handler`.
+ * @return The plugin's `plugin_read_entry` function, or NULL if it only
+ * supports extracting entries to temporary files.
+ */
+ArchiveEntryReader pm_get_entry_reader(const ArchivePlugin* plugin);
+
+/**
+ * @brief Returns the function a plugin exports to report the CRC-32 recorded for an entry, if any.
+ *
+ * @param plugin A plugin returned by `pm_get_handler`.
+ * @return The plugin's `plugin_entry_crc32` function, or NULL if the format
+ * records none or the plugin does not read it.
+ */
+ArchiveEntryCrc pm_get_entry_crc(const ArchivePlugin* plugin);
+
+/**
+ * @brief Returns the functions a plugin exports to read many entries through one open archive, if any.
+ *
+ * @param plugin A plugin returned by `pm_get_handler`.
+ * @param session Set to the plugin's functions. Left zeroed if it exports none.
+ * @return True if the plugin exports all three functions.
+ */
+bool pm_get_archive_session(const ArchivePlugin* plugin, ArchiveSession* session);
+
 #endif // PLUGIN_MANAGER_H
@@ -31,6 +31,12 @@ typedef enum {
     THEME_ELEMENT_SEARCH_HIGHLIGHT,
     THEME_ELEMENT_HELP_BORDER,
     THEME_ELEMENT_HELP_KEY,
+    THEME_ELEMENT_DIFF_REMOVED,
+    THEME_ELEMENT_DIFF_ADDED,
+    THEME_ELEMENT_PIN_1,    // Pinned terms cycle through these four.
+    THEME_ELEMENT_PIN_2,
+    THEME_ELEMENT_PIN_3,
+    THEME_ELEMENT_PIN_4,
     THEME_ELEMENT_COUNT // Keep this last for easy iteration and array sizing.
 } ThemeElement;
 
@@ -98,6 +98,18 @@ void ui_get_search_input(AppState *state);
  */
 void ui_get_command_input(AppState *state, char* buffer, size_t buffer_size);
 
+/**
+ * @brief Gets a filter expression from the user via the status bar.
+ *
+ * The prompt is pre-filled with the active filter, if any.
+ *
+ * @param state A pointer to the application state.
+ * @param buffer A character buffer to store the expression.
+ * @param buffer_size The size of the buffer.
+ * @return True if the input was confirmed with Enter, false if it was cancelled.
+ */
+bool ui_get_filter_input(AppState *state, char* buffer, size_t buffer_size);
+
 /**
  * @brief Gets a line number from the user via the status bar.
  *
@@ -109,6 +121,66 @@ void ui_get_command_input(AppState *state, char* buffer, size_t buffer_size);
  */
 int ui_get_line_input(AppState *state);
 
+/**
+ * @brief Gets a column number or header name from the user via the status bar.
+ *
+ * @param state A pointer to the application state.
+ * @param buffer A character buffer to store the input.
+ * @param buffer_size The size of the buffer.
+ * @return True if something was entered and confirmed with Enter, false if cancelled.
+ */
+bool ui_get_column_input(AppState *state, char* buffer, size_t buffer_size);
+
+/**
+ * @brief Gets a symbol name from the user via the status bar.
+ *
+ * @param state A pointer to the application state.
+ * @param buffer A character buffer to store the input.
+ * @param buffer_size The size of the buffer.
+ * @return True if something was entered and confirmed with Enter, false if cancelled.
+ */
+bool ui_get_symbol_input(AppState *state, char* buffer, size_t buffer_size);
+
+/**
+ * @brief Gets a time to jump to from the user via the status bar.
+ *
+ * @param state A pointer to the application state.
+ * @param buffer A character buffer to store the input.
+ * @param buffer_size The size of the buffer.
+ * @return True if something was entered and confirmed with Enter, false if cancelled.
+ */
+bool ui_get_time_input(AppState *state, char* buffer, size_t buffer_size);
+
+/**
+ * @brief Returns the number of columns the timeline is drawn in, one per stretch of time.
+ * @param state A read-only pointer to the application state.
+ */
+int ui_timeline_columns(const AppState *state);
+
+/**
+ * @brief Gets a term to pin or unpin from the user via the status bar.
+ *
+ * The input starts out as the active search term, if any.
+ *
+ * @param state A pointer to the application state.
+ * @param buffer A character buffer to store the input.
+ * @param buffer_size The size of the buffer.
+ * @return True if something was entered and confirmed with Enter, false if cancelled.
+ */
+bool ui_get_pin_input(AppState *state, char* buffer, size_t buffer_size);
+
+/**
+ * @brief Gets a term to search every entry of an archive for from the user via the status bar.
+ *
+ * The input starts out as the term of the current archive search, if any.
+ *
+ * @param state A pointer to the application state.
+ * @param buffer A character buffer to store the input.
+ * @param buffer_size The size of the buffer.
+ * @return True if something was entered and confirmed with Enter, false if cancelled.
+ */
+bool ui_get_grep_input(AppState *state, char* buffer, size_t buffer_size);
+
 
 /**
  * @brief Displays a message to the user in the status bar.
@@ -134,4 +206,29 @@ void ui_show_message(const AppState *state, const char *message);
  */
 int ui_show_theme_selector(const AppState* state);
 
+/**
+ * @brief Displays a modal list of the open buffers and lets the user pick one.
+ *
+ * Each entry shows the file path and whether the buffer is active, indexed,
+ * evicted to save memory, or not loaded yet. The user navigates with the
+ * Up/Down arrow keys, selects with Enter, and cancels with 'q' or Escape.
+ *
+ * @param state A read-only pointer to the current application state.
+ * @return The index of the selected buffer, or -1 if cancelled or only one file is open.
+ */
+int ui_show_buffer_list(const AppState* state);
+
+/**
+ * @brief Displays a modal list of the sections and segments of an executable and lets the user pick one.
+ *
+ * Each entry shows the name, file offset, size and load address; segments
+ * are marked with '*'. The entry holding the top of the hex view is selected
+ * first. The user navigates with the Up/Down arrow keys, selects with Enter,
+ * and cancels with 'q' or Escape.
+ *
+ * @param state A read-only pointer to the current application state.
+ * @return The index of the selected entry in `state->binary->sections`, or -1 if cancelled or there are none.
+ */
+int ui_show_section_list(const AppState* state);
+
 #endif //UI_H
@@ -11,6 +11,7 @@
 #define UTF8_UTILS_H
 
 #include <stdlib.h>
+#include <stdbool.h>
 
 /**
  * @brief Calculates the byte length of a single UTF-8 character.
@@ -19,7 +20,8 @@
  * how many bytes (from 1 to 4) make up that single character.
  *
  * @param s A pointer to the null-terminated string starting with the character to measure.
- * @return The number of bytes in the character, or 0 if the string is null or empty.
+ * @return The number of bytes in the character, cut short at the first byte that does not
+ *         continue it, or 0 if the string is null or empty.
  */
 int utf8_char_len(const char *s);
 
@@ -36,4 +38,17 @@ int utf8_char_len(const char *s);
  */
 int utf8_prev_char_start(const char *s, int current_pos);
 
+/**
+ * @brief Checks that a single UTF-8 character is well formed.
+ *
+ * The character spans the utf8_char_len(s) bytes at `s`, which stop at
+ * the first byte that does not continue it. A stray lead byte is thus a
+ * character of its own, drawn as one U+FFFD, and the valid characters
+ * after it are left whole.
+ *
+ * @param s A pointer to the null-terminated string starting with the character to check.
+ * @return true if the bytes are a valid, shortest encoding of a code point; false otherwise.
+ */
+bool utf8_char_is_valid(const char *s);
+
 #endif // UTF8_UTILS_H
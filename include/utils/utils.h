@@ -47,5 +47,20 @@ int get_executable_dir(char* buffer, size_t size);
  */
 void cleanup_temp_file_if_exists(const char* path);
 
+/**
+ * @brief Finds the first occurrence of a byte string in a buffer that may not be null-terminated.
+ *
+ * memchr skips to each candidate first byte and memcmp checks the rest, so
+ * the bytes that cannot start a match cost a vectorized scan and nothing
+ * more. Every substring search over file data goes through it.
+ *
+ * @param haystack The bytes to search.
+ * @param haystack_len The number of bytes in `haystack`.
+ * @param needle The bytes to find.
+ * @param needle_len The number of bytes in `needle`.
+ * @return A pointer to the first match in `haystack`, or NULL if there is none or `needle_len` is 0.
+ */
+const char* find_bytes(const char* haystack, size_t haystack_len, const char* needle, size_t needle_len);
+
 
 #endif // UTILS_H
@@ -127,6 +127,56 @@ FatResult gz_extract_entry(const char* archive_path, const char* entry_name, cha
     return FAT_SUCCESS;
 }
 
+/**
+ * @brief Streams the decompressed GZIP data without writing it to disk.
+ */
+FatResult plugin_read_entry(const char* archive_path, const char* entry_name, ArchiveChunkCallback on_chunk, void* ctx) {
+    (void)entry_name; // Unused, since there's only one "entry"
+
+    gzFile gz_file = gzopen(archive_path, "rb");
+    if (!gz_file) {
+        LOG_INFO("gzopen failed for '%s'", archive_path);
+        return FAT_ERROR_ARCHIVE_ERROR;
+    }
+
+    char buffer[CHUNK_SIZE];
+    int bytes_read;
+    while ((bytes_read = gzread(gz_file, buffer, CHUNK_SIZE)) > 0) {
+        if (!on_chunk(buffer, (size_t)bytes_read, ctx)) break;
+    }
+
+    FatResult result = FAT_SUCCESS;
+    if (bytes_read < 0) {
+        int err_no = 0;
+        const char *err_str = gzerror(gz_file, &err_no);
+        if (err_no != Z_OK) {
+            LOG_INFO("gzread error while decompressing '%s': %s", archive_path, err_str);
+            result = FAT_ERROR_FILE_READ;
+        }
+    }
+    gzclose(gz_file);
+    return result;
+}
+
+/**
+ * @brief Reports the CRC-32 recorded in the GZIP trailer, without decompressing anything.
+ *
+ * The trailer ends the file with the CRC-32 and the size of the original
+ * data, both little-endian. Like `gzip -l`, this reads the last member's
+ * trailer, which covers the whole content of an ordinary single-member file.
+ */
+FatResult plugin_entry_crc32(const char* archive_path, const char* entry_name, uint32_t* crc) {
+    (void)entry_name; // Unused, since there's only one "entry"
+
+    FILE* f = fopen(archive_path, "rb");
+    if (!f) return FAT_ERROR_FILE_READ;
+    unsigned char trailer[8];
+    bool ok = fseek(f, -8, SEEK_END) == 0 && fread(trailer, 1, sizeof(trailer), f) == sizeof(trailer);
+    fclose(f);
+    if (!ok) return FAT_ERROR_ARCHIVE_ERROR;
+    *crc = (uint32_t)trailer[0] | (uint32_t)trailer[1] << 8 | (uint32_t)trailer[2] << 16 | (uint32_t)trailer[3] << 24;
+    return FAT_SUCCESS;
+}
 
 // **Plugin Registration**
 
@@ -166,6 +166,155 @@ cleanup:
     return result;
 }
 
+/**
+ * @brief Streams the content of a TAR entry, block by block, without writing it to disk.
+ */
+FatResult plugin_read_entry(const char* archive_path, const char* entry_name, ArchiveChunkCallback on_chunk, void* ctx) {
+    TAR* t = NULL;
+    if (tar_open(&t, (char*)archive_path, NULL, O_RDONLY, 0, 0) == -1) {
+        LOG_INFO("tar_open failed for '%s'", archive_path);
+        return FAT_ERROR_ARCHIVE_ERROR;
+    }
+
+    FatResult result = FAT_ERROR_ARCHIVE_ERROR;
+    while (th_read(t) == 0) {
+        if (strcmp(th_get_pathname(t), entry_name) != 0) {
+            if (TH_ISREG(t) && tar_skip_regfile(t) != 0) break;
+            continue;
+        }
+        if (!TH_ISREG(t)) {
+            LOG_INFO("Entry '%s' in '%s' is not a regular file.", entry_name, archive_path);
+            result = FAT_ERROR_UNSUPPORTED;
+            break;
+        }
+
+        // The data follows the header in whole blocks; the last one is padded.
+        char block[T_BLOCKSIZE];
+        size_t remaining = (size_t)th_get_size(t);
+        result = FAT_SUCCESS;
+        while (remaining > 0) {
+            if (tar_block_read(t, block) != T_BLOCKSIZE) {
+                LOG_INFO("Short read of entry '%s' in '%s'", entry_name, archive_path);
+                result = FAT_ERROR_FILE_READ;
+                break;
+            }
+            size_t len = remaining < T_BLOCKSIZE ? remaining : T_BLOCKSIZE;
+            remaining -= len;
+            if (!on_chunk(block, len, ctx)) break;
+        }
+        break;
+    }
+
+    tar_close(t);
+    return result;
+}
+
+/**
+ * @struct TarSession
+ * @brief An archive opened once to read many of its entries.
+ *
+ * A tar file has no index, so the offset of each listed entry's header is
+ * recorded the first time the scan passes it. Reaching an entry already
+ * passed is one seek, and the data of the entries skipped on the way is
+ * seeked over rather than read.
+ */
+typedef struct {
+    TAR* t;
+    off_t* headers;             /**< The offset of the header of each entry found, in listing order. */
+    size_t known;               /**< The number of offsets in `headers`. */
+    size_t capacity;
+    off_t scan_pos;             /**< The offset of the first header the scan has not looked at. */
+} TarSession;
+
+/**
+ * @brief Opens a TAR archive to read many entries.
+ */
+FatResult plugin_open_archive(const char* archive_path, void** handle) {
+    *handle = NULL;
+    TarSession* session = calloc(1, sizeof(TarSession));
+    if (!session) return FAT_ERROR_MEMORY;
+    if (tar_open(&session->t, (char*)archive_path, NULL, O_RDONLY, 0, 0) == -1) {
+        LOG_INFO("tar_open failed for '%s'", archive_path);
+        free(session);
+        return FAT_ERROR_ARCHIVE_ERROR;
+    }
+    *handle = session;
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Scans forward from the last header looked at to the header of a listed entry.
+ *
+ * The header is read, so the file is left at the start of the entry's data.
+ */
+static FatResult scan_to_entry(TarSession* session, size_t index) {
+    int fd = tar_fd(session->t);
+    if (lseek(fd, session->scan_pos, SEEK_SET) == (off_t)-1) return FAT_ERROR_FILE_READ;
+    while (true) {
+        off_t header = lseek(fd, 0, SEEK_CUR);
+        if (header == (off_t)-1) return FAT_ERROR_FILE_READ;
+        if (th_read(session->t) != 0) return FAT_ERROR_ARCHIVE_ERROR; // Past the last entry
+        off_t data = lseek(fd, 0, SEEK_CUR);
+        if (data == (off_t)-1) return FAT_ERROR_FILE_READ;
+        // Only regular files are listed, and only their data is skipped, as the listing does.
+        off_t size = TH_ISREG(session->t) ? (off_t)th_get_size(session->t) : 0;
+        session->scan_pos = data + (size + T_BLOCKSIZE - 1) / T_BLOCKSIZE * T_BLOCKSIZE;
+        if (!TH_ISREG(session->t)) continue;
+
+        if (session->known == session->capacity) {
+            size_t new_capacity = session->capacity ? session->capacity * 2 : 256;
+            off_t* new_headers = realloc(session->headers, new_capacity * sizeof(off_t));
+            if (!new_headers) return FAT_ERROR_MEMORY;
+            session->headers = new_headers;
+            session->capacity = new_capacity;
+        }
+        session->headers[session->known++] = header;
+        if (session->known - 1 == index) return FAT_SUCCESS;
+        if (lseek(fd, session->scan_pos, SEEK_SET) == (off_t)-1) return FAT_ERROR_FILE_READ;
+    }
+}
+
+/**
+ * @brief Streams the content of an entry of an open TAR archive, block by block.
+ */
+FatResult plugin_read_entry_at(void* handle, size_t index, ArchiveChunkCallback on_chunk, void* ctx) {
+    TarSession* session = handle;
+    FatResult result = FAT_SUCCESS;
+    if (index < session->known) {
+        if (lseek(tar_fd(session->t), session->headers[index], SEEK_SET) == (off_t)-1) return FAT_ERROR_FILE_READ;
+        if (th_read(session->t) != 0) return FAT_ERROR_ARCHIVE_ERROR;
+    } else {
+        result = scan_to_entry(session, index);
+        if (result != FAT_SUCCESS) return result;
+    }
+
+    // The data follows the header in whole blocks; the last one is padded.
+    char block[T_BLOCKSIZE];
+    size_t remaining = (size_t)th_get_size(session->t);
+    while (remaining > 0) {
+        if (tar_block_read(session->t, block) != T_BLOCKSIZE) {
+            LOG_INFO("Short read of entry %zu of a tar archive", index);
+            result = FAT_ERROR_FILE_READ;
+            break;
+        }
+        size_t len = remaining < T_BLOCKSIZE ? remaining : T_BLOCKSIZE;
+        remaining -= len;
+        if (!on_chunk(block, len, ctx)) break;
+    }
+    return result;
+}
+
+/**
+ * @brief Closes a TAR archive opened by `plugin_open_archive`.
+ */
+void plugin_close_archive(void* handle) {
+    TarSession* session = handle;
+    if (!session) return;
+    tar_close(session->t);
+    free(session->headers);
+    free(session);
+}
+
 // **Plugin Registration**
 
 /**
@@ -180,6 +180,148 @@ cleanup:
     return result;
 }
 
+/**
+ * @brief Streams the decompressed content of a ZIP entry without writing it to disk.
+ */
+FatResult plugin_read_entry(const char* archive_path, const char* entry_name, ArchiveChunkCallback on_chunk, void* ctx) {
+    int err = 0;
+    zip_t* za = zip_open(archive_path, ZIP_RDONLY, &err);
+    if (!za) {
+        LOG_INFO("zip_open failed for '%s'. Libzip error: %d", archive_path, err);
+        return FAT_ERROR_ARCHIVE_ERROR;
+    }
+
+    zip_file_t* zf = zip_fopen(za, entry_name, 0);
+    if (!zf) {
+        LOG_INFO("zip_fopen failed for entry '%s' in '%s'", entry_name, archive_path);
+        zip_close(za);
+        return FAT_ERROR_ARCHIVE_ERROR;
+    }
+
+    FatResult result = FAT_SUCCESS;
+    char buffer[65536];
+    zip_int64_t bytes_read;
+    while ((bytes_read = zip_fread(zf, buffer, sizeof(buffer))) > 0) {
+        if (!on_chunk(buffer, (size_t)bytes_read, ctx)) break;
+    }
+    if (bytes_read < 0) {
+        LOG_INFO("zip_fread failed for entry '%s' in '%s'", entry_name, archive_path);
+        result = FAT_ERROR_FILE_READ;
+    }
+
+    zip_fclose(zf);
+    zip_close(za);
+    return result;
+}
+
+/**
+ * @struct ZipSession
+ * @brief An archive opened once to read many of its entries.
+ */
+typedef struct {
+    zip_t* za;
+    zip_uint64_t* indexes;      /**< The zip index of each entry, in the order `zip_list_contents` lists them. */
+    size_t count;
+} ZipSession;
+
+/**
+ * @brief Opens a ZIP archive to read many entries, parsing its central directory once.
+ */
+FatResult plugin_open_archive(const char* archive_path, void** handle) {
+    *handle = NULL;
+    ZipSession* session = calloc(1, sizeof(ZipSession));
+    if (!session) return FAT_ERROR_MEMORY;
+    int err = 0;
+    session->za = zip_open(archive_path, ZIP_RDONLY, &err);
+    if (!session->za) {
+        LOG_INFO("zip_open failed for '%s'. Libzip error: %d", archive_path, err);
+        free(session);
+        return FAT_ERROR_ARCHIVE_ERROR;
+    }
+
+    // The same entries as the listing, so a position in it maps straight to a zip index.
+    zip_int64_t num_entries = zip_get_num_entries(session->za, 0);
+    session->indexes = malloc((num_entries > 0 ? (size_t)num_entries : 1) * sizeof(zip_uint64_t));
+    if (!session->indexes) {
+        zip_close(session->za);
+        free(session);
+        return FAT_ERROR_MEMORY;
+    }
+    for (zip_int64_t i = 0; i < num_entries; i++) {
+        struct zip_stat sb;
+        if (zip_stat_index(session->za, i, 0, &sb) == 0) {
+            bool is_dir = (sb.name[strlen(sb.name) - 1] == '/') || (sb.size == 0);
+            if (!is_dir) session->indexes[session->count++] = (zip_uint64_t)i;
+        }
+    }
+    *handle = session;
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Streams the decompressed content of an entry of an open ZIP archive.
+ */
+FatResult plugin_read_entry_at(void* handle, size_t index, ArchiveChunkCallback on_chunk, void* ctx) {
+    ZipSession* session = handle;
+    if (index >= session->count) return FAT_ERROR_INVALID_ARGUMENT;
+    zip_file_t* zf = zip_fopen_index(session->za, session->indexes[index], 0);
+    if (!zf) {
+        LOG_INFO("zip_fopen_index failed for entry %zu", index);
+        return FAT_ERROR_ARCHIVE_ERROR;
+    }
+
+    FatResult result = FAT_SUCCESS;
+    char buffer[65536];
+    zip_int64_t bytes_read;
+    while ((bytes_read = zip_fread(zf, buffer, sizeof(buffer))) > 0) {
+        if (!on_chunk(buffer, (size_t)bytes_read, ctx)) break;
+    }
+    if (bytes_read < 0) {
+        LOG_INFO("zip_fread failed for entry %zu", index);
+        result = FAT_ERROR_FILE_READ;
+    }
+    zip_fclose(zf);
+    return result;
+}
+
+/**
+ * @brief Closes a ZIP archive opened by `plugin_open_archive`.
+ */
+void plugin_close_archive(void* handle) {
+    ZipSession* session = handle;
+    if (!session) return;
+    zip_close(session->za);
+    free(session->indexes);
+    free(session);
+}
+
+/**
+ * @brief Reports the CRC-32 the central directory records for an entry, without decompressing it.
+ */
+FatResult plugin_entry_crc32(const char* archive_path, const char* entry_name, uint32_t* crc) {
+    int err = 0;
+    zip_t* za = zip_open(archive_path, ZIP_RDONLY, &err);
+    if (!za) {
+        LOG_INFO("zip_open failed for '%s'. Libzip error: %d", archive_path, err);
+        return FAT_ERROR_ARCHIVE_ERROR;
+    }
+
+    // zip_stat only reads the central directory, which zip_open has already loaded.
+    zip_stat_t st;
+    zip_stat_init(&st);
+    FatResult result = FAT_SUCCESS;
+    if (zip_stat(za, entry_name, 0, &st) != 0) {
+        LOG_INFO("zip_stat failed for entry '%s' in '%s'", entry_name, archive_path);
+        result = FAT_ERROR_ARCHIVE_ERROR;
+    } else if (!(st.valid & ZIP_STAT_CRC)) {
+        result = FAT_ERROR_UNSUPPORTED;
+    } else {
+        *crc = st.crc;
+    }
+    zip_close(za);
+    return result;
+}
+
 // **Plugin Registration**
 
 /**
@@ -0,0 +1,282 @@
+/**
+ * @file archive_grep.c
+ * @author Zuhaitz (original)
+ * @brief Implements the worker pool that searches every entry of an archive.
+ */
+#include "core/archive_grep.h"
+#include "utils/logger.h"
+#include "utils/utils.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+
+/** @brief The size of the reads from an extracted entry, for plugins without a streaming reader. */
+#define ARCHIVE_GREP_READ_SIZE 65536
+
+/**
+ * @struct HitCounter
+ * @brief Counts the occurrences of the term in the chunks of one entry.
+ */
+typedef struct {
+    ArchiveGrep* grep;
+    char tail[ARCHIVE_GREP_MAX_TERM_LEN];   /**< The last bytes seen, shorter than the term. */
+    size_t tail_len;
+    size_t hits;
+    bool cancelled;
+} HitCounter;
+
+/**
+ * @brief Counts the occurrences of the term that start in the first `starts` bytes of a range.
+ */
+static size_t count_in_range(const ArchiveGrep* grep, const char* data, size_t len, size_t starts) {
+    size_t hits = 0;
+    const char* ptr = data;
+    const char* end = data + len;
+    while ((ptr = find_bytes(ptr, (size_t)(end - ptr), grep->term, grep->term_len)) != NULL) {
+        if ((size_t)(ptr - data) >= starts) break;
+        hits++;
+        ptr++; // Overlapping occurrences count, as in the search
+    }
+    return hits;
+}
+
+/**
+ * @brief Returns true once the search is being freed.
+ */
+static bool is_cancelled(ArchiveGrep* grep) {
+    pthread_mutex_lock(&grep->lock);
+    bool cancel = grep->cancel;
+    pthread_mutex_unlock(&grep->lock);
+    return cancel;
+}
+
+/**
+ * @brief Counts the occurrences in the next chunk of an entry.
+ *
+ * An occurrence split between two chunks starts in the saved tail of the
+ * previous one, which is shorter than the term, so it is counted once here
+ * and can never be counted again.
+ */
+static bool count_chunk(const char* data, size_t len, void* ctx) {
+    HitCounter* counter = ctx;
+    ArchiveGrep* grep = counter->grep;
+    if (is_cancelled(grep)) {
+        counter->cancelled = true;
+        return false;
+    }
+    size_t keep = grep->term_len - 1;
+
+    if (counter->tail_len > 0) {
+        char window[2 * ARCHIVE_GREP_MAX_TERM_LEN];
+        size_t head = len < keep ? len : keep;
+        memcpy(window, counter->tail, counter->tail_len);
+        memcpy(window + counter->tail_len, data, head);
+        counter->hits += count_in_range(grep, window, counter->tail_len + head, counter->tail_len);
+    }
+    counter->hits += count_in_range(grep, data, len, len);
+
+    if (keep == 0) return true;
+    if (len >= keep) {
+        memcpy(counter->tail, data + len - keep, keep);
+        counter->tail_len = keep;
+    } else {
+        size_t old = counter->tail_len + len > keep ? keep - len : counter->tail_len;
+        memmove(counter->tail, counter->tail + counter->tail_len - old, old);
+        memcpy(counter->tail + old, data, len);
+        counter->tail_len = old + len;
+    }
+    return true;
+}
+
+/**
+ * @brief Extracts an entry to a temporary file and counts the occurrences in it.
+ */
+static FatResult count_extracted(ArchiveGrep* grep, const char* entry_name, HitCounter* counter) {
+    char* temp_path = NULL;
+    FatResult res = grep->plugin->extract_entry(grep->archive_path, entry_name, &temp_path);
+    if (res != FAT_SUCCESS || !temp_path) return res != FAT_SUCCESS ? res : FAT_ERROR_ARCHIVE_ERROR;
+
+    FILE* file = fopen(temp_path, "rb");
+    if (!file) {
+        remove(temp_path);
+        free(temp_path);
+        return FAT_ERROR_FILE_READ;
+    }
+    char* buffer = malloc(ARCHIVE_GREP_READ_SIZE);
+    if (!buffer) res = FAT_ERROR_MEMORY;
+    size_t bytes_read;
+    while (buffer && (bytes_read = fread(buffer, 1, ARCHIVE_GREP_READ_SIZE, file)) > 0) {
+        if (!count_chunk(buffer, bytes_read, counter)) break;
+    }
+    free(buffer);
+    fclose(file);
+    remove(temp_path);
+    free(temp_path);
+    return res;
+}
+
+/**
+ * @brief Claims entries and counts the occurrences of the term in each.
+ *
+ * Entries are claimed in listing order, so a worker reading through an open
+ * archive only ever moves forward in it.
+ */
+static void* grep_worker(void* arg) {
+    ArchiveGrep* grep = arg;
+    void* archive = NULL;
+    bool open_failed = false;
+    while (true) {
+        pthread_mutex_lock(&grep->lock);
+        if (grep->cancel || grep->next_entry >= grep->entries.count) {
+            pthread_mutex_unlock(&grep->lock);
+            break;
+        }
+        size_t entry = grep->next_entry++;
+        pthread_mutex_unlock(&grep->lock);
+
+        const char* name = grep->entries.lines[entry];
+        HitCounter counter = { .grep = grep };
+        if (grep->session.open && !archive && !open_failed &&
+            grep->session.open(grep->archive_path, &archive) != FAT_SUCCESS) {
+            LOG_INFO("Could not open '%s' once for searching; reading its entries one by one", grep->archive_path);
+            archive = NULL;
+            open_failed = true;
+        }
+        FatResult res = archive ? grep->session.read(archive, entry, count_chunk, &counter)
+                      : grep->reader ? grep->reader(grep->archive_path, name, count_chunk, &counter)
+                                     : count_extracted(grep, name, &counter);
+        if (res != FAT_SUCCESS) {
+            LOG_INFO("Could not search entry '%s' of '%s' (error %d)", name, grep->archive_path, res);
+        }
+        if (counter.cancelled) break;
+
+        pthread_mutex_lock(&grep->lock);
+        grep->entry_hits[entry] = res == FAT_SUCCESS ? counter.hits : 0;
+        grep->finished[grep->finished_count++] = entry;
+        if (res != FAT_SUCCESS) grep->failed_count++;
+        pthread_mutex_unlock(&grep->lock);
+    }
+    if (archive) grep->session.close(archive);
+    return NULL;
+}
+
+FatResult archive_grep_start(ArchiveGrep* grep, const char* archive_path, const ArchivePlugin* plugin,
+                             ArchiveEntryReader reader, const ArchiveSession* session,
+                             const StringList* entries, const char* term) {
+    if (!grep || !archive_path || !plugin || !entries || !term) return FAT_ERROR_INVALID_ARGUMENT;
+    memset(grep, 0, sizeof(*grep));
+    size_t term_len = strlen(term);
+    if (term_len == 0 || term_len > ARCHIVE_GREP_MAX_TERM_LEN) return FAT_ERROR_INVALID_ARGUMENT;
+
+    grep->term = strdup(term);
+    grep->term_len = term_len;
+    grep->archive_path = strdup(archive_path);
+    grep->plugin = plugin;
+    grep->reader = reader;
+    if (session) grep->session = *session;
+    StringList_init(&grep->entries);
+    size_t slots = entries->count ? entries->count : 1;
+    grep->entry_hits = calloc(slots, sizeof(size_t));
+    grep->finished = calloc(slots, sizeof(size_t));
+    bool ok = grep->term && grep->archive_path && grep->entry_hits && grep->finished;
+    for (size_t i = 0; ok && i < entries->count; i++) {
+        ok = StringList_add(&grep->entries, entries->lines[i]) == FAT_SUCCESS;
+    }
+    if (!ok) {
+        StringList_free(&grep->entries);
+        free(grep->term);
+        free(grep->archive_path);
+        free(grep->entry_hits);
+        free(grep->finished);
+        memset(grep, 0, sizeof(*grep));
+        return FAT_ERROR_MEMORY;
+    }
+    pthread_mutex_init(&grep->lock, NULL);
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int wanted = cpus > 0 ? (int)cpus : 1;
+    if (wanted > ARCHIVE_GREP_MAX_THREADS) wanted = ARCHIVE_GREP_MAX_THREADS;
+    if ((size_t)wanted > grep->entries.count) wanted = (int)grep->entries.count;
+
+    for (int i = 0; i < wanted; i++) {
+        if (pthread_create(&grep->threads[grep->thread_count], NULL, grep_worker, grep) != 0) {
+            LOG_INFO("Could not start archive search thread %d.", i);
+            break;
+        }
+        grep->thread_count++;
+    }
+    if (grep->thread_count == 0 && grep->entries.count > 0) {
+        // No thread to hand the work to; search everything now.
+        grep_worker(grep);
+    }
+    return FAT_SUCCESS;
+}
+
+bool archive_grep_poll(ArchiveGrep* grep) {
+    if (!grep || !grep->term || grep->failed) return false;
+    size_t old_count = grep->count;
+
+    pthread_mutex_lock(&grep->lock);
+    while (grep->adopted < grep->finished_count) {
+        size_t entry = grep->finished[grep->adopted];
+        size_t hits = grep->entry_hits[entry];
+        if (hits > 0) {
+            if (grep->count == grep->capacity) {
+                size_t new_capacity = grep->capacity ? grep->capacity * 2 : 64;
+                ArchiveGrepHit* new_hits = realloc(grep->hits, new_capacity * sizeof(ArchiveGrepHit));
+                if (!new_hits) {
+                    grep->failed = true;
+                    break;
+                }
+                grep->hits = new_hits;
+                grep->capacity = new_capacity;
+            }
+            const char* name = grep->entries.lines[entry];
+            size_t row_size = strlen(name) + 48;
+            char* row = malloc(row_size);
+            if (!row) {
+                grep->failed = true;
+                break;
+            }
+            snprintf(row, row_size, "%s  (%zu hit%s)", name, hits, hits == 1 ? "" : "s");
+            grep->hits[grep->count].entry = entry;
+            grep->hits[grep->count].hits = hits;
+            grep->hits[grep->count].row = row;
+            grep->count++;
+            grep->total_hits += hits;
+        }
+        grep->adopted++;
+    }
+    if (grep->failed) grep->cancel = true;
+    pthread_mutex_unlock(&grep->lock);
+
+    return grep->count != old_count;
+}
+
+bool archive_grep_is_running(const ArchiveGrep* grep) {
+    return grep && grep->term && !grep->failed && grep->adopted < grep->entries.count;
+}
+
+void archive_grep_free(ArchiveGrep* grep) {
+    if (!grep || !grep->term) return;
+    if (grep->thread_count > 0) {
+        pthread_mutex_lock(&grep->lock);
+        grep->cancel = true;
+        pthread_mutex_unlock(&grep->lock);
+        for (int i = 0; i < grep->thread_count; i++) {
+            pthread_join(grep->threads[i], NULL);
+        }
+    }
+    pthread_mutex_destroy(&grep->lock);
+    for (size_t i = 0; i < grep->count; i++) {
+        free(grep->hits[i].row);
+    }
+    free(grep->hits);
+    free(grep->entry_hits);
+    free(grep->finished);
+    StringList_free(&grep->entries);
+    free(grep->archive_path);
+    free(grep->term);
+    memset(grep, 0, sizeof(*grep));
+}
@@ -0,0 +1,260 @@
+/**
+ * @file byte_map.c
+ * @author Zuhaitz (original)
+ * @brief Implements the byte map, scanned block by block in the background.
+ */
+#include "core/byte_map.h"
+#include "utils/logger.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// **Histogram Kernel**
+
+/**
+ * @brief Counts how many times each byte value occurs in a block.
+ *
+ * Bytes are spread over four tables, so consecutive equal bytes do not
+ * wait on each other's increment, and the tables are added up at the end.
+ * With SSE2, sixteen bytes of a single repeated value, as padding is made
+ * of, are recognised with one comparison and counted at once.
+ */
+static void histogram_block(const unsigned char* data, size_t len, uint64_t counts[256]) {
+    uint32_t tables[4][256];
+    memset(tables, 0, sizeof(tables));
+    size_t i = 0;
+#ifdef __SSE2__
+    for (; i + 16 <= len; i += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(data + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8((char)data[i]))) == 0xFFFF) {
+            tables[0][data[i]] += 16;
+            continue;
+        }
+        for (size_t k = i; k < i + 16; k += 4) {
+            tables[0][data[k]]++;
+            tables[1][data[k + 1]]++;
+            tables[2][data[k + 2]]++;
+            tables[3][data[k + 3]]++;
+        }
+    }
+#else
+    for (; i + 4 <= len; i += 4) {
+        tables[0][data[i]]++;
+        tables[1][data[i + 1]]++;
+        tables[2][data[i + 2]]++;
+        tables[3][data[i + 3]]++;
+    }
+#endif
+    for (; i < len; i++) tables[0][data[i]]++;
+    for (int value = 0; value < 256; value++) {
+        counts[value] = (uint64_t)tables[0][value] + tables[1][value] + tables[2][value] + tables[3][value];
+    }
+}
+
+/**
+ * @brief Works out the entropy and byte classes of a block from its histogram.
+ */
+static void describe_block(const uint64_t counts[256], size_t len, ByteBlock* block) {
+    memset(block, 0, sizeof(*block));
+    block->bytes = len;
+    if (len == 0) return;
+    double entropy = 0.0;
+    for (int value = 0; value < 256; value++) {
+        if (counts[value] == 0) continue;
+        double p = (double)counts[value] / (double)len;
+        entropy -= p * log2(p);
+        if (value == 0) {
+            block->zero += counts[value];
+        } else if ((value >= 0x20 && value < 0x7F) || value == '\t' || value == '\n' || value == '\r') {
+            block->text += counts[value];
+        } else if (value >= 0x80) {
+            block->high += counts[value];
+        }
+    }
+    block->entropy = (float)entropy;
+}
+
+/**
+ * @brief Builds the byte histogram of a block, counting the parts of it in holes as zeros without reading them.
+ *
+ * @param hole The first hole that might overlap the block; moved on as blocks pass holes.
+ */
+static void histogram_range(const ByteMap* map, size_t start, size_t len, size_t* hole, uint64_t counts[256]) {
+    const FileHole* holes = map->holes;
+    size_t end = start + len;
+    while (*hole < map->hole_count && holes[*hole].offset + holes[*hole].length <= start) (*hole)++;
+    if (*hole >= map->hole_count || holes[*hole].offset >= end) {
+        histogram_block(map->data + start, len, counts);
+        return;
+    }
+
+    uint64_t piece[256];
+    memset(counts, 0, 256 * sizeof(uint64_t));
+    size_t pos = start;
+    for (size_t h = *hole; pos < end; h++) {
+        bool in_block = h < map->hole_count && holes[h].offset < end;
+        size_t data_end = in_block ? holes[h].offset : end;
+        if (data_end > pos) {
+            histogram_block(map->data + pos, data_end - pos, piece);
+            for (int value = 0; value < 256; value++) counts[value] += piece[value];
+            pos = data_end;
+        }
+        if (!in_block) break;
+        size_t hole_end = holes[h].offset + holes[h].length < end ? holes[h].offset + holes[h].length : end;
+        counts[0] += hole_end - pos;
+        pos = hole_end;
+    }
+}
+
+// **Background Scan**
+
+/**
+ * @brief Scans every block in file order.
+ */
+static void* byte_map_worker(void* arg) {
+    ByteMap* map = arg;
+    uint64_t counts[256];
+    size_t hole = 0;
+    for (size_t i = 0; i < map->block_count; i++) {
+        size_t start = i * map->block_size;
+        size_t len = start + map->block_size <= map->size ? map->block_size : map->size - start;
+        histogram_range(map, start, len, &hole, counts);
+        describe_block(counts, len, &map->blocks[i]);
+
+        pthread_mutex_lock(&map->lock);
+        bool cancel = map->cancel;
+        map->ready = i + 1;
+        pthread_mutex_unlock(&map->lock);
+        if (cancel) return NULL;
+    }
+    LOG_INFO("Mapped %zu blocks of %zu bytes.", map->block_count, map->block_size);
+    return NULL;
+}
+
+// **Public API**
+
+/**
+ * @brief Starts scanning the blocks of a mapped file in the background.
+ */
+FatResult byte_map_start(ByteMap* map, const char* data, size_t size, const FileHole* holes, size_t hole_count) {
+    memset(map, 0, sizeof(*map));
+    map->data = (const unsigned char*)data;
+    map->size = size;
+    map->holes = holes;
+    map->hole_count = hole_count;
+    map->block_size = BYTE_MAP_MIN_BLOCK_SIZE;
+    while ((size + map->block_size - 1) / map->block_size > BYTE_MAP_MAX_BLOCKS) map->block_size *= 2;
+    map->block_count = (size + map->block_size - 1) / map->block_size;
+    map->blocks = calloc(map->block_count ? map->block_count : 1, sizeof(ByteBlock));
+    if (!map->blocks) return FAT_ERROR_MEMORY;
+    pthread_mutex_init(&map->lock, NULL);
+    if (map->block_count == 0) return FAT_SUCCESS;
+
+    if (pthread_create(&map->thread, NULL, byte_map_worker, map) == 0) {
+        map->has_thread = true;
+    } else {
+        LOG_INFO("Could not start the byte map thread; scanning on this one.");
+        byte_map_worker(map);
+        map->count = map->ready;
+    }
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Adopts the blocks scanned since the last call.
+ */
+bool byte_map_poll(ByteMap* map) {
+    if (map->count == map->block_count) return false;
+    pthread_mutex_lock(&map->lock);
+    size_t ready = map->ready;
+    pthread_mutex_unlock(&map->lock);
+    bool changed = ready != map->count;
+    map->count = ready;
+    return changed;
+}
+
+/**
+ * @brief Returns true until every block has been scanned and adopted.
+ */
+bool byte_map_is_running(const ByteMap* map) {
+    return map->count < map->block_count;
+}
+
+/**
+ * @brief Adds up the adopted blocks that overlap a range of bytes.
+ */
+void byte_map_summarize(const ByteMap* map, size_t start, size_t end, ByteBlock* out) {
+    memset(out, 0, sizeof(*out));
+    if (map->block_size == 0 || end <= start) return;
+    size_t first = start / map->block_size;
+    size_t last = (end + map->block_size - 1) / map->block_size;
+    if (last > map->count) last = map->count;
+    double entropy = 0.0;
+    size_t blocks = 0;
+    for (size_t i = first; i < last; i++) {
+        const ByteBlock* block = &map->blocks[i];
+        entropy += block->entropy;
+        out->bytes += block->bytes;
+        out->zero += block->zero;
+        out->text += block->text;
+        out->high += block->high;
+        blocks++;
+    }
+    if (blocks > 0) out->entropy = (float)(entropy / (double)blocks);
+}
+
+/**
+ * @brief Returns the first byte of a row when the map is drawn in a number of rows.
+ */
+size_t byte_map_row_start(const ByteMap* map, size_t row, size_t rows) {
+    if (row >= rows) return map->size;
+    size_t block = (size_t)((uint64_t)map->block_count * row / rows);
+    return block * map->block_size;
+}
+
+/**
+ * @brief Returns the row holding a byte when the map is drawn in a number of rows.
+ */
+size_t byte_map_row_of(const ByteMap* map, size_t offset, size_t rows) {
+    size_t row = 0;
+    while (row + 1 < rows && byte_map_row_start(map, row + 1, rows) <= offset) row++;
+    return row;
+}
+
+/**
+ * @brief Tells what a stretch of a file most likely holds from its statistics.
+ */
+ByteRegion byte_map_classify(const ByteBlock* block) {
+    if (block->bytes == 0) return BYTE_REGION_UNKNOWN;
+    if (block->entropy < BYTE_MAP_PADDING_ENTROPY) return BYTE_REGION_PADDING;
+    if (block->entropy >= BYTE_MAP_RANDOM_ENTROPY) return BYTE_REGION_RANDOM;
+    if (block->text * 10 >= block->bytes * 9) return BYTE_REGION_TEXT;
+    return BYTE_REGION_DATA;
+}
+
+/**
+ * @brief Returns the heap memory held by the blocks.
+ */
+size_t byte_map_memory_usage(const ByteMap* map) {
+    return map->blocks ? map->block_count * sizeof(ByteBlock) : 0;
+}
+
+/**
+ * @brief Stops the background scan and frees the map.
+ */
+void byte_map_free(ByteMap* map) {
+    if (!map || !map->blocks) return;
+    if (map->has_thread) {
+        pthread_mutex_lock(&map->lock);
+        map->cancel = true;
+        pthread_mutex_unlock(&map->lock);
+        pthread_join(map->thread, NULL);
+    }
+    pthread_mutex_destroy(&map->lock);
+    free(map->blocks);
+    memset(map, 0, sizeof(*map));
+}
@@ -0,0 +1,698 @@
+/**
+ * @file checksum.c
+ * @author Zuhaitz (original)
+ * @brief Implements the checksum kernels and the background job that runs them over a file.
+ */
+#define _GNU_SOURCE // For SEEK_DATA and SEEK_HOLE
+#include "core/checksum.h"
+#include "core/read_pipeline.h"
+#include "utils/logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CHECKSUM_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+// **Byte Order**
+
+static uint32_t load_le32(const unsigned char* p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t load_le64(const unsigned char* p) {
+    return (uint64_t)load_le32(p) | (uint64_t)load_le32(p + 4) << 32;
+}
+
+static uint32_t load_be32(const unsigned char* p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | (uint32_t)p[3];
+}
+
+// **Processor Features**
+
+static bool has_sse42;
+static bool has_sha;
+static pthread_once_t setup_once = PTHREAD_ONCE_INIT;
+
+// **CRC-32 and CRC-32C**
+
+/** @brief The slicing-by-8 tables of each polynomial, built on first use. */
+static uint32_t crc32_tables[8][256];
+static uint32_t crc32c_tables[8][256];
+
+/**
+ * @brief Builds the slicing-by-8 tables of a reflected CRC polynomial.
+ */
+static void build_crc_tables(uint32_t tables[8][256], uint32_t polynomial) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) crc = crc & 1 ? (crc >> 1) ^ polynomial : crc >> 1;
+        tables[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int t = 1; t < 8; t++) tables[t][i] = (tables[t - 1][i] >> 8) ^ tables[0][tables[t - 1][i] & 0xFF];
+    }
+}
+
+/**
+ * @brief Checks the processor and builds the tables, once.
+ */
+static void checksum_setup(void) {
+    build_crc_tables(crc32_tables, 0xEDB88320u);
+    build_crc_tables(crc32c_tables, 0x82F63B78u);
+#ifdef CHECKSUM_X86
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        has_sse42 = (ecx & bit_SSE4_2) != 0;
+        bool sse41 = (ecx & bit_SSE4_1) != 0;
+        if (sse41 && __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) has_sha = (ebx & (1u << 29)) != 0;
+    }
+#endif
+}
+
+/**
+ * @brief Advances a CRC eight bytes at a time with the slicing-by-8 tables.
+ */
+static uint32_t crc_update_tables(uint32_t tables[8][256], uint32_t crc, const unsigned char* p, size_t len) {
+    while (len >= 8) {
+        uint32_t low = load_le32(p) ^ crc;
+        uint32_t high = load_le32(p + 4);
+        crc = tables[7][low & 0xFF] ^ tables[6][(low >> 8) & 0xFF] ^ tables[5][(low >> 16) & 0xFF] ^ tables[4][low >> 24] ^
+              tables[3][high & 0xFF] ^ tables[2][(high >> 8) & 0xFF] ^ tables[1][(high >> 16) & 0xFF] ^ tables[0][high >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len--) crc = (crc >> 8) ^ tables[0][(crc ^ *p++) & 0xFF];
+    return crc;
+}
+
+#ifdef CHECKSUM_X86
+/**
+ * @brief Advances a CRC-32C with the SSE4.2 crc32 instruction, eight bytes at a time.
+ */
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_update_sse42(uint32_t crc, const unsigned char* p, size_t len) {
+    uint64_t crc64 = crc;
+    while (len >= 8) {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+        p += 8;
+        len -= 8;
+    }
+    crc = (uint32_t)crc64;
+    while (len--) crc = _mm_crc32_u8(crc, *p++);
+    return crc;
+}
+#endif
+
+// **XXH64**
+
+#define XXH_PRIME1 0x9E3779B185EBCA87ull
+#define XXH_PRIME2 0xC2B2AE3D27D4EB4Full
+#define XXH_PRIME3 0x165667B19E3779F9ull
+#define XXH_PRIME4 0x85EBCA77C2B2AE63ull
+#define XXH_PRIME5 0x27D4EB2F165667C5ull
+
+static uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static uint64_t xxh_round(uint64_t acc, uint64_t input) {
+    acc += input * XXH_PRIME2;
+    return rotl64(acc, 31) * XXH_PRIME1;
+}
+
+static uint64_t xxh_merge(uint64_t acc, uint64_t lane) {
+    acc ^= xxh_round(0, lane);
+    return acc * XXH_PRIME1 + XXH_PRIME4;
+}
+
+/**
+ * @brief Folds 32-byte stripes into the four lanes.
+ */
+static void xxh64_stripes(uint64_t acc[4], const unsigned char* p, size_t stripes) {
+    uint64_t a = acc[0], b = acc[1], c = acc[2], d = acc[3];
+    for (size_t i = 0; i < stripes; i++, p += 32) {
+        a = xxh_round(a, load_le64(p));
+        b = xxh_round(b, load_le64(p + 8));
+        c = xxh_round(c, load_le64(p + 16));
+        d = xxh_round(d, load_le64(p + 24));
+    }
+    acc[0] = a;
+    acc[1] = b;
+    acc[2] = c;
+    acc[3] = d;
+}
+
+static void xxh64_update(ChecksumState* state, const unsigned char* p, size_t len) {
+    size_t pending = (size_t)(state->length % 32);
+    if (pending > 0) {
+        size_t take = 32 - pending < len ? 32 - pending : len;
+        memcpy(state->u.xxh.buffer + pending, p, take);
+        p += take;
+        len -= take;
+        if (pending + take < 32) return;
+        xxh64_stripes(state->u.xxh.acc, state->u.xxh.buffer, 1);
+    }
+    xxh64_stripes(state->u.xxh.acc, p, len / 32);
+    memcpy(state->u.xxh.buffer, p + len / 32 * 32, len % 32);
+}
+
+static uint64_t xxh64_final(const ChecksumState* state) {
+    const uint64_t* acc = state->u.xxh.acc;
+    uint64_t h;
+    if (state->length >= 32) {
+        h = rotl64(acc[0], 1) + rotl64(acc[1], 7) + rotl64(acc[2], 12) + rotl64(acc[3], 18);
+        for (int lane = 0; lane < 4; lane++) h = xxh_merge(h, acc[lane]);
+    } else {
+        h = XXH_PRIME5; // The seed is 0
+    }
+    h += state->length;
+
+    const unsigned char* p = state->u.xxh.buffer;
+    size_t len = (size_t)(state->length % 32);
+    for (; len >= 8; p += 8, len -= 8) {
+        h ^= xxh_round(0, load_le64(p));
+        h = rotl64(h, 27) * XXH_PRIME1 + XXH_PRIME4;
+    }
+    if (len >= 4) {
+        h ^= (uint64_t)load_le32(p) * XXH_PRIME1;
+        h = rotl64(h, 23) * XXH_PRIME2 + XXH_PRIME3;
+        p += 4;
+        len -= 4;
+    }
+    for (; len > 0; p++, len--) {
+        h ^= *p * XXH_PRIME5;
+        h = rotl64(h, 11) * XXH_PRIME1;
+    }
+    h ^= h >> 33;
+    h *= XXH_PRIME2;
+    h ^= h >> 29;
+    h *= XXH_PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+// **SHA-256**
+
+static const uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static uint32_t rotr32(uint32_t x, int r) {
+    return (x >> r) | (x << (32 - r));
+}
+
+/**
+ * @brief Compresses 64-byte blocks into the chaining value, in portable C.
+ */
+static void sha256_blocks_scalar(uint32_t h[8], const unsigned char* p, size_t blocks) {
+    uint32_t w[64];
+    for (; blocks > 0; blocks--, p += 64) {
+        for (int t = 0; t < 16; t++) w[t] = load_be32(p + 4 * t);
+        for (int t = 16; t < 64; t++) {
+            uint32_t s0 = rotr32(w[t - 15], 7) ^ rotr32(w[t - 15], 18) ^ (w[t - 15] >> 3);
+            uint32_t s1 = rotr32(w[t - 2], 17) ^ rotr32(w[t - 2], 19) ^ (w[t - 2] >> 10);
+            w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+        }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], k = h[7];
+        for (int t = 0; t < 64; t++) {
+            uint32_t t1 = k + (rotr32(e, 6) ^ rotr32(e, 11) ^ rotr32(e, 25)) + ((e & f) ^ (~e & g)) + SHA256_K[t] + w[t];
+            uint32_t t2 = (rotr32(a, 2) ^ rotr32(a, 13) ^ rotr32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            k = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+        h[5] += f;
+        h[6] += g;
+        h[7] += k;
+    }
+}
+
+#ifdef CHECKSUM_X86
+/**
+ * @brief Compresses 64-byte blocks into the chaining value with the SHA extensions.
+ *
+ * The instructions keep the state as the ABEF and CDGH halves and run two
+ * rounds at a time; the message schedule is extended four words at a time
+ * with sha256msg1 and sha256msg2.
+ */
+__attribute__((target("sha,sse4.1,ssse3")))
+static void sha256_blocks_shani(uint32_t h[8], const unsigned char* p, size_t blocks) {
+    const __m128i byte_swap = _mm_set_epi64x(0x0c0d0e0f08090a0bll, 0x0405060700010203ll);
+    __m128i dcba = _mm_loadu_si128((const __m128i*)&h[0]);
+    __m128i hgfe = _mm_loadu_si128((const __m128i*)&h[4]);
+    __m128i cdab = _mm_shuffle_epi32(dcba, 0xB1);
+    __m128i efgh = _mm_shuffle_epi32(hgfe, 0x1B);
+    __m128i abef = _mm_alignr_epi8(cdab, efgh, 8);
+    __m128i cdgh = _mm_blend_epi16(efgh, cdab, 0xF0);
+
+    for (; blocks > 0; blocks--, p += 64) {
+        __m128i abef_start = abef;
+        __m128i cdgh_start = cdgh;
+        __m128i w[16];
+        for (int g = 0; g < 16; g++) {
+            if (g < 4) {
+                w[g] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(p + 16 * g)), byte_swap);
+            } else {
+                __m128i sum = _mm_add_epi32(_mm_sha256msg1_epu32(w[g - 4], w[g - 3]), _mm_alignr_epi8(w[g - 1], w[g - 2], 4));
+                w[g] = _mm_sha256msg2_epu32(sum, w[g - 1]);
+            }
+            __m128i msg = _mm_add_epi32(w[g], _mm_loadu_si128((const __m128i*)&SHA256_K[4 * g]));
+            cdgh = _mm_sha256rnds2_epu32(cdgh, abef, msg);
+            abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(msg, 0x0E));
+        }
+        abef = _mm_add_epi32(abef, abef_start);
+        cdgh = _mm_add_epi32(cdgh, cdgh_start);
+    }
+
+    __m128i feba = _mm_shuffle_epi32(abef, 0x1B);
+    __m128i dchg = _mm_shuffle_epi32(cdgh, 0xB1);
+    _mm_storeu_si128((__m128i*)&h[0], _mm_blend_epi16(feba, dchg, 0xF0));
+    _mm_storeu_si128((__m128i*)&h[4], _mm_alignr_epi8(dchg, feba, 8));
+}
+#endif
+
+static void sha256_blocks(uint32_t h[8], const unsigned char* p, size_t blocks) {
+#ifdef CHECKSUM_X86
+    if (has_sha) {
+        sha256_blocks_shani(h, p, blocks);
+        return;
+    }
+#endif
+    sha256_blocks_scalar(h, p, blocks);
+}
+
+static void sha256_update(ChecksumState* state, const unsigned char* p, size_t len) {
+    size_t pending = (size_t)(state->length % 64);
+    if (pending > 0) {
+        size_t take = 64 - pending < len ? 64 - pending : len;
+        memcpy(state->u.sha.buffer + pending, p, take);
+        p += take;
+        len -= take;
+        if (pending + take < 64) return;
+        sha256_blocks(state->u.sha.h, state->u.sha.buffer, 1);
+    }
+    sha256_blocks(state->u.sha.h, p, len / 64);
+    memcpy(state->u.sha.buffer, p + len / 64 * 64, len % 64);
+}
+
+static void sha256_final(ChecksumState* state, unsigned char digest[32]) {
+    unsigned char* buffer = state->u.sha.buffer;
+    size_t pending = (size_t)(state->length % 64);
+    uint64_t bits = state->length * 8;
+    buffer[pending++] = 0x80;
+    if (pending > 56) {
+        memset(buffer + pending, 0, 64 - pending);
+        sha256_blocks(state->u.sha.h, buffer, 1);
+        pending = 0;
+    }
+    memset(buffer + pending, 0, 56 - pending);
+    for (int i = 0; i < 8; i++) buffer[56 + i] = (unsigned char)(bits >> (56 - 8 * i));
+    sha256_blocks(state->u.sha.h, buffer, 1);
+    for (int i = 0; i < 8; i++) {
+        uint32_t word = state->u.sha.h[i];
+        digest[4 * i] = (unsigned char)(word >> 24);
+        digest[4 * i + 1] = (unsigned char)(word >> 16);
+        digest[4 * i + 2] = (unsigned char)(word >> 8);
+        digest[4 * i + 3] = (unsigned char)word;
+    }
+}
+
+// **Checksums**
+
+/**
+ * @brief Starts a checksum.
+ */
+void checksum_init(ChecksumState* state, ChecksumKind kind) {
+    static const uint32_t sha256_iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    pthread_once(&setup_once, checksum_setup);
+    memset(state, 0, sizeof(*state));
+    state->kind = kind;
+    switch (kind) {
+        case CHECKSUM_CRC32:
+        case CHECKSUM_CRC32C:
+            state->u.crc = 0xFFFFFFFFu;
+            break;
+        case CHECKSUM_XXH64:
+            state->u.xxh.acc[0] = XXH_PRIME1 + XXH_PRIME2;
+            state->u.xxh.acc[1] = XXH_PRIME2;
+            state->u.xxh.acc[2] = 0;
+            state->u.xxh.acc[3] = 0 - XXH_PRIME1;
+            break;
+        case CHECKSUM_SHA256:
+            memcpy(state->u.sha.h, sha256_iv, sizeof(sha256_iv));
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Feeds bytes to a checksum.
+ */
+void checksum_update(ChecksumState* state, const void* data, size_t len) {
+    const unsigned char* p = data;
+    if (len == 0) return;
+    switch (state->kind) {
+        case CHECKSUM_CRC32:
+            state->u.crc = crc_update_tables(crc32_tables, state->u.crc, p, len);
+            break;
+        case CHECKSUM_CRC32C:
+#ifdef CHECKSUM_X86
+            if (has_sse42) {
+                state->u.crc = crc32c_update_sse42(state->u.crc, p, len);
+                break;
+            }
+#endif
+            state->u.crc = crc_update_tables(crc32c_tables, state->u.crc, p, len);
+            break;
+        case CHECKSUM_XXH64:
+            xxh64_update(state, p, len);
+            break;
+        case CHECKSUM_SHA256:
+            sha256_update(state, p, len);
+            break;
+        default:
+            break;
+    }
+    state->length += len;
+}
+
+/**
+ * @brief Finishes a checksum and writes its digest as lowercase hex.
+ */
+void checksum_final(ChecksumState* state, char hex[CHECKSUM_HEX_SIZE]) {
+    switch (state->kind) {
+        case CHECKSUM_CRC32:
+        case CHECKSUM_CRC32C:
+            snprintf(hex, CHECKSUM_HEX_SIZE, "%08x", state->u.crc ^ 0xFFFFFFFFu);
+            break;
+        case CHECKSUM_XXH64:
+            snprintf(hex, CHECKSUM_HEX_SIZE, "%016llx", (unsigned long long)xxh64_final(state));
+            break;
+        case CHECKSUM_SHA256: {
+            unsigned char digest[32];
+            sha256_final(state, digest);
+            for (int i = 0; i < 32; i++) snprintf(hex + 2 * i, 3, "%02x", digest[i]);
+            break;
+        }
+        default:
+            hex[0] = '\0';
+            break;
+    }
+}
+
+static const char* const KIND_NAMES[CHECKSUM_KIND_COUNT] = { "CRC-32", "CRC-32C", "XXH64", "SHA-256" };
+
+/**
+ * @brief Returns the display name of a kind.
+ */
+const char* checksum_kind_name(ChecksumKind kind) {
+    return kind < CHECKSUM_KIND_COUNT ? KIND_NAMES[kind] : "?";
+}
+
+/**
+ * @brief Parses the name of a kind, ignoring case and dashes.
+ */
+bool checksum_kind_from_name(const char* name, ChecksumKind* kind) {
+    for (int k = 0; k < CHECKSUM_KIND_COUNT; k++) {
+        const char* a = name;
+        const char* b = KIND_NAMES[k];
+        while (1) {
+            while (*a == '-') a++;
+            while (*b == '-') b++;
+            if (!*a || !*b || tolower((unsigned char)*a) != tolower((unsigned char)*b)) break;
+            a++;
+            b++;
+        }
+        if (!*a && !*b) {
+            *kind = (ChecksumKind)k;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Returns a note on how a kind is computed on this machine, or NULL for the portable code.
+ */
+const char* checksum_kind_acceleration(ChecksumKind kind) {
+    pthread_once(&setup_once, checksum_setup);
+    if (kind == CHECKSUM_CRC32C && has_sse42) return "SSE4.2";
+    if (kind == CHECKSUM_SHA256 && has_sha) return "SHA-NI";
+    return NULL;
+}
+
+// **Background Job**
+
+/**
+ * @brief The smallest hole hashed without being read. Smaller ones are read like data,
+ * since the scan would have most of one in flight before it could stop.
+ */
+#define CHECKSUM_MIN_HOLE ((uint64_t)READ_PIPELINE_BLOCK_SIZE * READ_PIPELINE_DEPTH)
+
+/** @brief The zeros holes are hashed from. */
+static const char zero_page[64 * 1024];
+
+/**
+ * @struct ChecksumConsumer
+ * @brief One selected kind, fed by the read pipeline.
+ */
+typedef struct {
+    Checksums* sums;
+    ChecksumState state;
+    bool reports_progress;      /**< True for the first kind, which keeps `hashed` up to date. */
+    uint64_t limit;             /**< The offset the current scan stops at: the next hole, or the end of the file. */
+} ChecksumConsumer;
+
+/**
+ * @brief Feeds a block of the file to one checksum, up to the next hole.
+ */
+static bool consume_block(void* ctx, const char* data, size_t size, uint64_t offset) {
+    ChecksumConsumer* consumer = ctx;
+    Checksums* sums = consumer->sums;
+    if (offset >= consumer->limit) return false;
+    bool at_limit = offset + size >= consumer->limit;
+    if (at_limit) size = (size_t)(consumer->limit - offset);
+    checksum_update(&consumer->state, data, size);
+
+    pthread_mutex_lock(&sums->lock);
+    bool cancel = sums->cancel;
+    if (consumer->reports_progress) sums->hashed = offset + size;
+    pthread_mutex_unlock(&sums->lock);
+    return !cancel && !at_limit;
+}
+
+/**
+ * @brief Finds the next hole of at least CHECKSUM_MIN_HOLE bytes from an offset.
+ *
+ * Sets `hole` to the size of the file if there is none, or if the file
+ * system cannot tell.
+ */
+static void next_hole(int fd, uint64_t from, uint64_t size, uint64_t* hole, uint64_t* hole_end) {
+    *hole = *hole_end = size;
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+    uint64_t pos = from;
+    while (fd >= 0 && pos < size) {
+        off_t start = lseek(fd, (off_t)pos, SEEK_HOLE);
+        if (start < 0 || (uint64_t)start >= size) return;
+        off_t end = lseek(fd, start, SEEK_DATA);
+        uint64_t data = end < 0 || (uint64_t)end > size ? size : (uint64_t)end; // The hole runs to the end
+        if (data - (uint64_t)start >= CHECKSUM_MIN_HOLE) {
+            *hole = (uint64_t)start;
+            *hole_end = data;
+            return;
+        }
+        pos = data;
+    }
+#else
+    (void)fd;
+    (void)from;
+#endif
+}
+
+/**
+ * @brief Feeds a hole to every selected kind from the zero page, without reading it.
+ * @return False if the job was cancelled.
+ */
+static bool consume_hole(ChecksumConsumer* consumers, size_t count, uint64_t offset, uint64_t length) {
+    Checksums* sums = consumers[0].sums;
+    for (size_t steps = 1; length > 0; steps++) {
+        size_t step = length < sizeof(zero_page) ? (size_t)length : sizeof(zero_page);
+        for (size_t i = 0; i < count; i++) checksum_update(&consumers[i].state, zero_page, step);
+        offset += step;
+        length -= step;
+        if (steps % (READ_PIPELINE_BLOCK_SIZE / sizeof(zero_page)) == 0 || length == 0) {
+            pthread_mutex_lock(&sums->lock);
+            bool cancel = sums->cancel;
+            sums->hashed = offset;
+            pthread_mutex_unlock(&sums->lock);
+            if (cancel) return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Reads the file once, feeding every selected kind, and publishes the digests.
+ *
+ * The data is read through the pipeline, one scan per stretch of data. Large
+ * holes of a sparse file are hashed as the zeros they read as, but not read.
+ */
+static void* checksums_worker(void* arg) {
+    Checksums* sums = arg;
+    ChecksumConsumer consumers[CHECKSUM_KIND_COUNT];
+    ReadConsumer readers[CHECKSUM_KIND_COUNT];
+    for (size_t i = 0; i < sums->kind_count; i++) {
+        consumers[i].sums = sums;
+        consumers[i].reports_progress = i == 0;
+        checksum_init(&consumers[i].state, sums->kinds[i]);
+    }
+
+    // An empty file has nothing to read, and the pipeline would take it for a stream.
+    FatResult res = FAT_SUCCESS;
+    int fd = sums->size > 0 ? open(sums->path, O_RDONLY) : -1;
+    uint64_t pos = 0;
+    while (res == FAT_SUCCESS && pos < sums->size) {
+        uint64_t hole, hole_end;
+        next_hole(fd, pos, sums->size, &hole, &hole_end);
+        if (hole > pos) {
+            for (size_t i = 0; i < sums->kind_count; i++) {
+                consumers[i].limit = hole;
+                readers[i] = (ReadConsumer){ .consume = consume_block, .ctx = &consumers[i] };
+            }
+            res = read_pipeline_scan(sums->path, pos, readers, sums->kind_count);
+            // A file that shrank under the scan ends where the data did.
+            if (res != FAT_SUCCESS || consumers[0].state.length < hole) break;
+        }
+        if (hole_end > hole && !consume_hole(consumers, sums->kind_count, hole, hole_end - hole)) break;
+        pos = hole_end;
+    }
+    if (fd >= 0) close(fd);
+
+    char digests[CHECKSUM_KIND_COUNT][CHECKSUM_HEX_SIZE];
+    for (size_t i = 0; i < sums->kind_count; i++) checksum_final(&consumers[i].state, digests[i]);
+
+    pthread_mutex_lock(&sums->lock);
+    if (res == FAT_SUCCESS && sums->cancel) res = FAT_ERROR_GENERIC;
+    if (res == FAT_SUCCESS) {
+        memcpy(sums->digests, digests, sizeof(digests));
+        sums->hashed = consumers[0].state.length;
+    }
+    sums->error = res;
+    sums->finished = true;
+    pthread_mutex_unlock(&sums->lock);
+    if (res == FAT_SUCCESS) LOG_INFO("Hashed %llu bytes of '%s'.", (unsigned long long)consumers[0].state.length, sums->path);
+    return NULL;
+}
+
+/**
+ * @brief Starts computing checksums of a file in the background.
+ */
+FatResult checksums_start(Checksums* sums, const char* path, uint64_t size, const ChecksumKind* kinds, size_t kind_count) {
+    memset(sums, 0, sizeof(*sums));
+    if (kind_count == 0 || kind_count > CHECKSUM_KIND_COUNT) return FAT_ERROR_INVALID_ARGUMENT;
+    sums->path = strdup(path);
+    if (!sums->path) return FAT_ERROR_MEMORY;
+    memcpy(sums->kinds, kinds, kind_count * sizeof(ChecksumKind));
+    sums->kind_count = kind_count;
+    sums->size = size;
+    pthread_mutex_init(&sums->lock, NULL);
+    pthread_once(&setup_once, checksum_setup);
+
+    if (pthread_create(&sums->thread, NULL, checksums_worker, sums) == 0) {
+        sums->has_thread = true;
+    } else {
+        LOG_INFO("Could not start the checksum thread; hashing on this one.");
+        checksums_worker(sums);
+        checksums_poll(sums);
+    }
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Sets up checksums whose values are already known.
+ */
+FatResult checksums_set_stored(Checksums* sums, const char* subject, ChecksumKind kind, const char* value) {
+    memset(sums, 0, sizeof(*sums));
+    sums->subject = strdup(subject);
+    if (!sums->subject) return FAT_ERROR_MEMORY;
+    sums->kinds[0] = kind;
+    sums->kind_count = 1;
+    sums->stored = true;
+    sums->done = true;
+    sums->result = FAT_SUCCESS;
+    snprintf(sums->values[0], CHECKSUM_HEX_SIZE, "%s", value);
+    pthread_mutex_init(&sums->lock, NULL);
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Adopts the progress and, once the job ends, the digests.
+ */
+bool checksums_poll(Checksums* sums) {
+    if (sums->done) return false;
+    pthread_mutex_lock(&sums->lock);
+    uint64_t hashed = sums->hashed;
+    bool finished = sums->finished;
+    if (finished) {
+        sums->result = sums->error;
+        memcpy(sums->values, sums->digests, sizeof(sums->values));
+    }
+    pthread_mutex_unlock(&sums->lock);
+    bool changed = finished || hashed != sums->progress;
+    sums->progress = hashed;
+    sums->done = finished;
+    return changed;
+}
+
+/**
+ * @brief Returns true until the job has ended and been adopted.
+ */
+bool checksums_is_running(const Checksums* sums) {
+    return !sums->done;
+}
+
+/**
+ * @brief Stops the job and frees the checksums.
+ */
+void checksums_free(Checksums* sums) {
+    if (!sums || sums->kind_count == 0) return;
+    if (sums->has_thread) {
+        pthread_mutex_lock(&sums->lock);
+        sums->cancel = true;
+        pthread_mutex_unlock(&sums->lock);
+        pthread_join(sums->thread, NULL);
+    }
+    pthread_mutex_destroy(&sums->lock);
+    free(sums->path);
+    free(sums->subject);
+    memset(sums, 0, sizeof(*sums));
+}
@@ -5,6 +5,7 @@
  */
 #include "core/config.h"
 #include "core/state.h"
+#include "core/file_source.h"
 #include "utils/logger.h"
 #include "utils/utils.h"
 #include "utils/cJSON.h"
@@ -240,6 +241,27 @@ static void parse_csv_to_stringlist(const char* value, StringList* list) {
     free(value_copy);
 }
 
+/**
+ * @brief Parses the comma-separated checksum names of the config file, skipping unknown and repeated ones.
+ */
+static void parse_checksum_kinds(const char* value, AppConfig* config) {
+    StringList names;
+    StringList_init(&names);
+    parse_csv_to_stringlist(value, &names);
+    config->checksum_kind_count = 0;
+    for (size_t i = 0; i < names.count; i++) {
+        ChecksumKind kind;
+        if (!checksum_kind_from_name(names.lines[i], &kind)) {
+            LOG_INFO("Unknown checksum '%s' in the config file; it is ignored.", names.lines[i]);
+            continue;
+        }
+        bool repeated = false;
+        for (size_t k = 0; k < config->checksum_kind_count; k++) repeated |= config->checksum_kinds[k] == kind;
+        if (!repeated) config->checksum_kinds[config->checksum_kind_count++] = kind;
+    }
+    StringList_free(&names);
+}
+
 /**
  * @brief Loads user settings, creating defaults and copying themes on first run.
  */
@@ -251,6 +273,16 @@ void config_load(AppState* state) {
     state->config.mime_commands = NULL;
     state->config.mime_commands_count = 0;
     state->config.default_command = NULL;
+    state->config.buffer_memory_budget = (size_t)256 * 1024 * 1024;
+    state->config.stdin_memory_limit = (size_t)64 * 1024 * 1024;
+    state->config.hex_layout.bytes_per_row = 16;
+    state->config.hex_layout.group_size = 1;
+    state->config.hex_layout.endian = HEX_ENDIAN_NONE;
+    state->config.hex_layout.collapse_holes = true;
+    state->config.checksum_kinds[0] = CHECKSUM_CRC32C;
+    state->config.checksum_kinds[1] = CHECKSUM_XXH64;
+    state->config.checksum_kinds[2] = CHECKSUM_SHA256;
+    state->config.checksum_kind_count = 3;
     StringList_init(&state->config.text_mimes);
     StringList_init(&state->config.binary_mimes);
 
@@ -285,6 +317,25 @@ void config_load(AppState* state) {
             fprintf(create_file, "# Default is 80x20 if not specified.\n");
             fprintf(create_file, "min_term_width = 80\n");
             fprintf(create_file, "min_term_height = 20\n\n");
+            fprintf(create_file, "# --- Buffer Configuration ---\n");
+            fprintf(create_file, "# Memory (in MB) that files open in the background may keep.\n");
+            fprintf(create_file, "# The least recently viewed files are evicted first. 0 means no limit.\n");
+            fprintf(create_file, "buffer_memory_budget_mb = 256\n\n");
+            fprintf(create_file, "# Memory (in MB) kept for data piped in with 'fat -'.\n");
+            fprintf(create_file, "# Anything beyond it is spilled to a temporary file. 0 means no limit.\n");
+            fprintf(create_file, "stdin_memory_limit_mb = 64\n\n");
+            fprintf(create_file, "# --- Hex View Configuration ---\n");
+            fprintf(create_file, "# Bytes per row: 8, 16, 32, or auto to fit the width of the pane.\n");
+            fprintf(create_file, "hex_bytes_per_row = 16\n");
+            fprintf(create_file, "# Bytes printed together without spaces: 1, 2, 4 or 8.\n");
+            fprintf(create_file, "hex_group_size = 1\n");
+            fprintf(create_file, "# Show each group as an unsigned integer: none, little or big (endian).\n");
+            fprintf(create_file, "hex_endian = none\n");
+            fprintf(create_file, "# Show each hole of a sparse file as a single row: true or false.\n");
+            fprintf(create_file, "hex_collapse_holes = true\n\n");
+            fprintf(create_file, "# --- Checksum Configuration ---\n");
+            fprintf(create_file, "# Checksums computed with '#', comma-separated: crc32, crc32c, xxh64, sha256.\n");
+            fprintf(create_file, "checksums = crc32c, xxh64, sha256\n\n");
             fprintf(create_file, "# --- MIME Type Configuration ---\n");
             fprintf(create_file, "# Force files with these MIME types to be treated as text or binary.\n");
             fprintf(create_file, "# Values are comma-separated.\n");
@@ -351,6 +402,40 @@ void config_load(AppState* state) {
                 if (height > 0) {
                     state->config.min_term_height = height;
                 }
+            } else if (strcmp(key, "buffer_memory_budget_mb") == 0) {
+                long megabytes = atol(value);
+                if (megabytes >= 0) {
+                    state->config.buffer_memory_budget = (size_t)megabytes * 1024 * 1024;
+                }
+            } else if (strcmp(key, "stdin_memory_limit_mb") == 0) {
+                long megabytes = atol(value);
+                if (megabytes >= 0) {
+                    state->config.stdin_memory_limit = (size_t)megabytes * 1024 * 1024;
+                }
+            } else if (strcmp(key, "hex_bytes_per_row") == 0) {
+                int bytes = atoi(value);
+                if (strcmp(value, "auto") == 0) {
+                    state->config.hex_layout.bytes_per_row = 0;
+                } else if (bytes == 8 || bytes == 16 || bytes == 32) {
+                    state->config.hex_layout.bytes_per_row = bytes;
+                }
+            } else if (strcmp(key, "hex_group_size") == 0) {
+                int size = atoi(value);
+                if (size == 1 || size == 2 || size == 4 || size == 8) {
+                    state->config.hex_layout.group_size = size;
+                }
+            } else if (strcmp(key, "hex_endian") == 0) {
+                if (strcmp(value, "little") == 0) {
+                    state->config.hex_layout.endian = HEX_ENDIAN_LITTLE;
+                } else if (strcmp(value, "big") == 0) {
+                    state->config.hex_layout.endian = HEX_ENDIAN_BIG;
+                } else {
+                    state->config.hex_layout.endian = HEX_ENDIAN_NONE;
+                }
+            } else if (strcmp(key, "hex_collapse_holes") == 0) {
+                state->config.hex_layout.collapse_holes = strcmp(value, "false") != 0;
+            } else if (strcmp(key, "checksums") == 0) {
+                parse_checksum_kinds(value, &state->config);
             } else if (strcmp(key, "default_command") == 0) {
                 state->config.default_command = strdup(value);
             } else if (strncmp(key, "mime.", 5) == 0) {
@@ -454,6 +539,27 @@ static Action action_name_to_enum(const char* name) {
     if (strcmp(name, "go_back") == 0) return ACTION_GO_BACK;
     if (strcmp(name, "select_theme") == 0) return ACTION_SELECT_THEME;
     if (strcmp(name, "toggle_help") == 0) return ACTION_TOGGLE_HELP;
+    if (strcmp(name, "next_buffer") == 0) return ACTION_NEXT_BUFFER;
+    if (strcmp(name, "prev_buffer") == 0) return ACTION_PREV_BUFFER;
+    if (strcmp(name, "list_buffers") == 0) return ACTION_LIST_BUFFERS;
+    if (strcmp(name, "next_hunk") == 0) return ACTION_NEXT_HUNK;
+    if (strcmp(name, "prev_hunk") == 0) return ACTION_PREV_HUNK;
+    if (strcmp(name, "filter") == 0) return ACTION_FILTER;
+    if (strcmp(name, "jump_to_column") == 0) return ACTION_JUMP_TO_COLUMN;
+    if (strcmp(name, "sort_column") == 0) return ACTION_SORT_COLUMN;
+    if (strcmp(name, "list_sections") == 0) return ACTION_LIST_SECTIONS;
+    if (strcmp(name, "find_symbol") == 0) return ACTION_FIND_SYMBOL;
+    if (strcmp(name, "pin_term") == 0) return ACTION_PIN_TERM;
+    if (strcmp(name, "clear_pins") == 0) return ACTION_CLEAR_PINS;
+    if (strcmp(name, "next_pinned") == 0) return ACTION_NEXT_PINNED;
+    if (strcmp(name, "prev_pinned") == 0) return ACTION_PREV_PINNED;
+    if (strcmp(name, "jump_to_time") == 0) return ACTION_JUMP_TO_TIME;
+    if (strcmp(name, "toggle_timeline") == 0) return ACTION_TOGGLE_TIMELINE;
+    if (strcmp(name, "next_bucket") == 0) return ACTION_NEXT_BUCKET;
+    if (strcmp(name, "prev_bucket") == 0) return ACTION_PREV_BUCKET;
+    if (strcmp(name, "toggle_strings") == 0) return ACTION_TOGGLE_STRINGS;
+    if (strcmp(name, "checksums") == 0) return ACTION_CHECKSUMS;
+    if (strcmp(name, "switch_encoding") == 0) return ACTION_SWITCH_ENCODING;
     if (strcmp(name, "confirm") == 0) return ACTION_CONFIRM;
     return ACTION_NONE;
 }
@@ -495,26 +601,12 @@ static void populate_key_map(AppConfig* config) {
  * @brief Parses a keybindings.json file and updates the AppConfig.
  */
 static void parse_keybindings_json(const char* filepath, AppConfig* config) {
-    FILE* f = fopen(filepath, "rb");
-    if (!f) {
-        LOG_INFO("Failed to open keybindings file at path: %s", filepath);
+    char* buffer = NULL;
+    if (file_source_read_file(filepath, FILE_SOURCE_SETTINGS_LIMIT, &buffer, NULL) != FAT_SUCCESS) {
+        LOG_INFO("Failed to read keybindings file at path: %s", filepath);
         return;
     }
 
-    fseek(f, 0, SEEK_END);
-    long length = ftell(f);
-    fseek(f, 0, SEEK_SET);
-    char* buffer = malloc(length + 1);
-    if (!buffer) {
-        fclose(f);
-        return;
-    }
-    if (fread(buffer, 1, length, f) != (size_t)length) {
-        // Handle read error if necessary
-    }
-    fclose(f);
-    buffer[length] = '\0';
-
     cJSON* json = cJSON_Parse(buffer);
     free(buffer);
     if (!json) {
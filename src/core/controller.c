@@ -12,6 +12,8 @@
 #include "utils/utf8_utils.h"
 #include <string.h>
 #include <stdlib.h>
+#include <limits.h>
+#include <sys/stat.h>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -40,6 +42,57 @@ static const char* find_command_for_file(AppState* state) {
     return state->config.default_command;
 }
 
+/**
+ * @brief Opens the selected entry of a directory listing.
+ *
+ * The listing is cached so going back is instant. Entering ".." when the
+ * parent is the previous breadcrumb simply goes back. If the entry cannot be
+ * opened, the listing is restored and the error is returned.
+ *
+ * @param state A pointer to the application state in directory mode.
+ * @return FAT_SUCCESS, or the error that prevented the entry from opening.
+ */
+static FatResult open_directory_entry(AppState* state) {
+    if (!state->dir || state->dir->count == 0) return FAT_SUCCESS;
+    size_t idx = (size_t)state->top_line;
+    char entry_path[PATH_MAX];
+    FatResult res = dir_listing_entry_path(state->dir, idx, entry_path, sizeof(entry_path));
+    if (res != FAT_SUCCESS) return res;
+
+    struct stat st;
+    if (stat(entry_path, &st) != 0) return FAT_ERROR_FILE_NOT_FOUND;
+    if (!S_ISDIR(st.st_mode) && !S_ISREG(st.st_mode)) {
+        // Reading a FIFO or a device would block or never end.
+        ui_show_message(state, "Special files cannot be opened.");
+        return FAT_SUCCESS;
+    }
+
+    if (strcmp(state->dir->entries[idx].name, "..") == 0 && state->breadcrumbs.count > 1) {
+        char parent[PATH_MAX];
+        if (realpath(entry_path, parent) &&
+            strcmp(state->breadcrumbs.lines[state->breadcrumbs.count - 2], parent) == 0) {
+            return state_go_back(state);
+        }
+    }
+
+    char* listing_path = strdup(state->filepath);
+    if (!listing_path) return FAT_ERROR_MEMORY;
+    size_t depth = state->breadcrumbs.count;
+    state->search_term_active = false;
+    state_cache_view(state);
+    res = state_init(state, entry_path);
+    if (res != FAT_SUCCESS) {
+        // Return to the listing rather than leaving an empty view behind.
+        if (state->breadcrumbs.count > depth) {
+            state_go_back(state);
+        } else {
+            state_init(state, listing_path);
+        }
+    }
+    free(listing_path);
+    return res;
+}
+
 /**
  * @brief Processes a single character of user input and updates the state.
  */
@@ -55,9 +108,10 @@ FatResult process_input(AppState *state, int ch) {
             // "gt" sequence for ACTION_JUMP_TO_LINE
             int target_line = ui_get_line_input(state);
             if (target_line > 0) {
-                state->top_line = target_line - 1;
-                if (state->top_line >= (int)state->content.count) {
-                    state->top_line = state->content.count > 0 ? (int)state->content.count - 1 : 0;
+                // Line numbers on screen always refer to the unfiltered content.
+                state->top_line = (int)state_find_line_number(state, (size_t)target_line - 1);
+                if (state->top_line >= (int)state_line_count(state)) {
+                    state->top_line = state_line_count(state) > 0 ? (int)state_line_count(state) - 1 : 0;
                 }
             }
         } else if (next_ch == 'g') {
@@ -88,13 +142,73 @@ FatResult process_input(AppState *state, int ch) {
         ui_show_help(state);
         return FAT_SUCCESS;
     }
+    if (action == ACTION_NEXT_BUFFER || action == ACTION_PREV_BUFFER) {
+        if (state->buffer_count < 2) return FAT_SUCCESS;
+        size_t step = action == ACTION_NEXT_BUFFER ? 1 : state->buffer_count - 1;
+        res = state_switch_buffer(state, (state->active_buffer + step) % state->buffer_count);
+        if (res != FAT_SUCCESS) {
+            ui_show_message(state, "Could not open that file.");
+            res = FAT_SUCCESS;
+        }
+        return res;
+    }
+    if (action == ACTION_LIST_BUFFERS) {
+        int selected_idx = ui_show_buffer_list(state);
+        if (selected_idx != -1) {
+            res = state_switch_buffer(state, (size_t)selected_idx);
+            if (res != FAT_SUCCESS) {
+                ui_show_message(state, "Could not open that file.");
+                res = FAT_SUCCESS;
+            }
+        }
+        return res;
+    }
+    if (action == ACTION_FILTER) {
+        if (state->view_mode == VIEW_MODE_DIFF || state->view_mode == VIEW_MODE_HEX_DIFF || state->view_mode == VIEW_MODE_DIRECTORY ||
+            state->view_mode == VIEW_MODE_GREP || state->view_mode == VIEW_MODE_STRINGS) return FAT_SUCCESS;
+        char expression[256];
+        if (ui_get_filter_input(state, expression, sizeof(expression))) {
+            char error[128];
+            if (state_apply_filter(state, expression, error, sizeof(error)) != FAT_SUCCESS) {
+                ui_show_message(state, error[0] ? error : "Could not apply the filter.");
+            }
+        }
+        return FAT_SUCCESS;
+    }
+    if (action == ACTION_CHECKSUMS) {
+        if (state->view_mode == VIEW_MODE_DIFF || state->view_mode == VIEW_MODE_HEX_DIFF || state->view_mode == VIEW_MODE_DIRECTORY ||
+            state->view_mode == VIEW_MODE_GREP) return FAT_SUCCESS;
+        FatResult sums = state_start_checksums(state);
+        if (sums == FAT_ERROR_UNSUPPORTED) {
+            ui_show_message(state, state->view_mode == VIEW_MODE_ARCHIVE ? "This archive records no CRC-32 for that entry." :
+                                                                           "A stream cannot be read again to hash it.");
+        } else if (sums == FAT_ERROR_INVALID_ARGUMENT) {
+            ui_show_message(state, state->view_mode == VIEW_MODE_ARCHIVE ? "No entry is selected." :
+                                                                           "No checksums are selected in the config file.");
+        } else if (sums != FAT_SUCCESS) {
+            ui_show_message(state, "Could not compute the checksums.");
+        }
+        return FAT_SUCCESS;
+    }
+    if (action == ACTION_SWITCH_ENCODING) {
+        FatResult switched = state_cycle_encoding(state);
+        if (switched == FAT_ERROR_UNSUPPORTED) {
+            ui_show_message(state, state->stream ? "A stream is shown as it arrives, without conversion." :
+                                                   "This file cannot be read in another encoding.");
+        } else if (switched != FAT_SUCCESS) {
+            ui_show_message(state, "Could not convert the file to the next encoding.");
+        }
+        return FAT_SUCCESS;
+    }
     if (action == ACTION_JUMP_TO_END) {
-        state->top_line = state->content.count > 0 ? (int)state->content.count - 1 : 0;
+        size_t line_count = state_line_count(state);
+        state->top_line = line_count > 0 ? (int)line_count - 1 : 0;
         state->left_char = 0;
         return FAT_SUCCESS;
     }
     
     if (action == ACTION_OPEN_EXTERNAL || action == ACTION_OPEN_EXTERNAL_DEFAULT) {
+        if (state->view_mode == VIEW_MODE_GREP) return FAT_SUCCESS; // The hits are no file
         const char* command_to_run = NULL;
         char command_buffer[512] = {0};
 
@@ -132,7 +246,7 @@ FatResult process_input(AppState *state, int ch) {
         case VIEW_MODE_ARCHIVE:
             switch (action) {
                 case ACTION_SCROLL_DOWN:
-                    if (state->top_line + 1 < (int)state->content.count) {
+                    if (state->top_line + 1 < (int)state_line_count(state)) {
                         state->top_line++;
                     }
                     break;
@@ -143,8 +257,8 @@ FatResult process_input(AppState *state, int ch) {
                     break;
                 case ACTION_PAGE_DOWN:
                     state->top_line += page_size;
-                    if (state->top_line >= (int)state->content.count) {
-                        state->top_line = state->content.count > 0 ? (int)state->content.count - 1 : 0;
+                    if (state->top_line >= (int)state_line_count(state)) {
+                        state->top_line = state_line_count(state) > 0 ? (int)state_line_count(state) - 1 : 0;
                     }
                     break;
                 case ACTION_PAGE_UP:
@@ -153,26 +267,88 @@ FatResult process_input(AppState *state, int ch) {
                         state->top_line = 0;
                     }
                     break;
+                case ACTION_SEARCH: {
+                    char term[ARCHIVE_GREP_MAX_TERM_LEN + 1];
+                    if (ui_get_grep_input(state, term, sizeof(term)) &&
+                        state_grep_archive(state, term) != FAT_SUCCESS) {
+                        ui_show_message(state, "Could not search the archive.");
+                    }
+                    break;
+                }
                 case ACTION_CONFIRM: {
-                    if (state->content.count == 0) break;
+                    if ((size_t)state->top_line >= state_line_count(state)) break;
                     state->search_term_active = false;
-                    const char* entry_name = state->content.lines[state->top_line];
+                    const char* entry_name = state->content.lines[state_line_number(state, (size_t)state->top_line)];
+                    // An entry picked from the search results opens on its first hit.
+                    char grep_term[ARCHIVE_GREP_MAX_TERM_LEN + 1] = "";
+                    if (state->archive_grep) snprintf(grep_term, sizeof(grep_term), "%s", state->archive_grep->term);
                     const ArchivePlugin* handler = pm_get_handler(state->filepath);
                     char* temp_file_path = NULL;
                     if (handler) {
                         res = handler->extract_entry(state->filepath, entry_name, &temp_file_path);
                         if (res == FAT_SUCCESS && temp_file_path) {
+                            // Keep the archive listing around so going back is instant.
+                            state_cache_view(state);
                             res = state_init(state, temp_file_path);
                             free(temp_file_path);
+                            if (res == FAT_SUCCESS && grep_term[0] != '\0') {
+                                state_search_update(state, grep_term, 0);
+                            }
                         }
                     }
                     return res;
                 }
+                case ACTION_GO_BACK:
+                    if (state->archive_grep) {
+                        state_clear_archive_grep(state);
+                    } else if (state->breadcrumbs.count > 1) {
+                        return state_go_back(state);
+                    } else if (state->filter) {
+                        state_clear_filter(state);
+                    }
+                    break;
+                default:
+                    break;
+            }
+            break;
+
+        case VIEW_MODE_DIRECTORY:
+            switch (action) {
+                case ACTION_SCROLL_DOWN:
+                    if (state->top_line + 1 < (int)state_line_count(state)) {
+                        state->top_line++;
+                    }
+                    break;
+                case ACTION_SCROLL_UP:
+                    if (state->top_line > 0) {
+                        state->top_line--;
+                    }
+                    break;
+                case ACTION_PAGE_DOWN:
+                    state->top_line += page_size;
+                    if (state->top_line >= (int)state_line_count(state)) {
+                        state->top_line = state_line_count(state) > 0 ? (int)state_line_count(state) - 1 : 0;
+                    }
+                    break;
+                case ACTION_PAGE_UP:
+                    state->top_line -= page_size;
+                    if (state->top_line < 0) {
+                        state->top_line = 0;
+                    }
+                    break;
+                case ACTION_SEARCH: {
+                    char term[TREE_GREP_MAX_TERM_LEN + 1];
+                    if (ui_get_grep_input(state, term, sizeof(term)) && term[0] != '\0' &&
+                        state_open_grep(state, term) != FAT_SUCCESS) {
+                        ui_show_message(state, "Could not search the directory.");
+                    }
+                    break;
+                }
+                case ACTION_CONFIRM:
+                    return open_directory_entry(state);
                 case ACTION_GO_BACK:
                     if (state->breadcrumbs.count > 1) {
-                        cleanup_temp_file_if_exists(state->breadcrumbs.lines[state->breadcrumbs.count - 1]);
-                        state->breadcrumbs.count--;
-                        return state_init(state, state->breadcrumbs.lines[state->breadcrumbs.count - 1]);
+                        return state_go_back(state);
                     }
                     break;
                 default:
@@ -180,8 +356,172 @@ FatResult process_input(AppState *state, int ch) {
             }
             break;
 
+        case VIEW_MODE_GREP:
+            switch (action) {
+                case ACTION_SCROLL_DOWN:
+                    if (state->top_line + 1 < (int)state_line_count(state)) {
+                        state->top_line++;
+                    }
+                    break;
+                case ACTION_SCROLL_UP:
+                    if (state->top_line > 0) {
+                        state->top_line--;
+                    }
+                    break;
+                case ACTION_PAGE_DOWN:
+                    state->top_line += page_size;
+                    if (state->top_line >= (int)state_line_count(state)) {
+                        state->top_line = state_line_count(state) > 0 ? (int)state_line_count(state) - 1 : 0;
+                    }
+                    break;
+                case ACTION_PAGE_UP:
+                    state->top_line -= page_size;
+                    if (state->top_line < 0) {
+                        state->top_line = 0;
+                    }
+                    break;
+                case ACTION_CONFIRM:
+                    res = state_open_grep_hit(state);
+                    if (res != FAT_SUCCESS) {
+                        ui_show_message(state, "Could not open that file.");
+                        res = FAT_SUCCESS;
+                    }
+                    return res;
+                case ACTION_GO_BACK:
+                    // Leave the hits and return to the view that was searched.
+                    return state_go_back(state);
+                default:
+                    break;
+            }
+            break;
+
+        case VIEW_MODE_DIFF:
+            {
+                size_t row_count = state_line_count(state);
+                int pane_text_width = (getmaxx(state->right_pane) - 3) / 2 - 7;
+                int max_scroll_limit = (int)state->max_line_len - pane_text_width;
+                if (max_scroll_limit < 0) max_scroll_limit = 0;
+                size_t hunk_row;
+
+                switch (action) {
+                    case ACTION_SCROLL_DOWN:
+                        if (state->top_line + 1 < (int)row_count) state->top_line++;
+                        break;
+                    case ACTION_SCROLL_UP:
+                        if (state->top_line > 0) state->top_line--;
+                        break;
+                    case ACTION_SCROLL_RIGHT:
+                        if (state->left_char < max_scroll_limit) state->left_char++;
+                        break;
+                    case ACTION_SCROLL_LEFT:
+                        if (state->left_char > 0) state->left_char--;
+                        break;
+                    case ACTION_PAGE_DOWN:
+                        state->top_line += page_size;
+                        if (state->top_line >= (int)row_count) {
+                            state->top_line = row_count > 0 ? (int)row_count - 1 : 0;
+                        }
+                        break;
+                    case ACTION_PAGE_UP:
+                        state->top_line -= page_size;
+                        if (state->top_line < 0) state->top_line = 0;
+                        break;
+                    case ACTION_NEXT_HUNK:
+                        if (diff_find_hunk(state->diff, (size_t)state->top_line, true, &hunk_row, NULL)) {
+                            state->top_line = (int)hunk_row;
+                        } else {
+                            ui_show_message(state, "No more differences below.");
+                        }
+                        break;
+                    case ACTION_PREV_HUNK:
+                        if (diff_find_hunk(state->diff, (size_t)state->top_line, false, &hunk_row, NULL)) {
+                            state->top_line = (int)hunk_row;
+                        } else {
+                            ui_show_message(state, "No more differences above.");
+                        }
+                        break;
+                    case ACTION_GO_BACK: {
+                        // Leave the diff and show the left file on its own.
+                        char *path = strdup(state->filepath);
+                        if (!path) return FAT_ERROR_MEMORY;
+                        res = state_init(state, path);
+                        free(path);
+                        return res;
+                    }
+                    default:
+                        break;
+                }
+            }
+            break;
+
+        case VIEW_MODE_HEX_DIFF:
+            {
+                HexDiff *diff = state->hex_diff;
+                size_t row_count = state_line_count(state);
+                int side_width = (getmaxx(state->right_pane) - 3) / 2;
+                int max_scroll_limit = (int)state->max_line_len - side_width;
+                if (max_scroll_limit < 0) max_scroll_limit = 0;
+                uint64_t bytes_per_row = (uint64_t)diff->a.bytes_per_row;
+                uint64_t range_offset;
+
+                switch (action) {
+                    case ACTION_SCROLL_DOWN:
+                        if (state->top_line + 1 < (int)row_count) state->top_line++;
+                        break;
+                    case ACTION_SCROLL_UP:
+                        if (state->top_line > 0) state->top_line--;
+                        break;
+                    case ACTION_SCROLL_RIGHT:
+                        if (state->left_char < max_scroll_limit) state->left_char++;
+                        break;
+                    case ACTION_SCROLL_LEFT:
+                        if (state->left_char > 0) state->left_char--;
+                        break;
+                    case ACTION_PAGE_DOWN:
+                        state->top_line += page_size;
+                        if (state->top_line >= (int)row_count) {
+                            state->top_line = row_count > 0 ? (int)row_count - 1 : 0;
+                        }
+                        break;
+                    case ACTION_PAGE_UP:
+                        state->top_line -= page_size;
+                        if (state->top_line < 0) state->top_line = 0;
+                        break;
+                    case ACTION_NEXT_HUNK:
+                        // Ranges starting on the top row are already in view.
+                        if (hex_diff_find(diff, ((uint64_t)state->top_line + 1) * bytes_per_row, true, &range_offset)) {
+                            state->top_line = (int)(range_offset / bytes_per_row);
+                        } else {
+                            ui_show_message(state, hex_diff_is_running(diff) ? "Still comparing; no more differences below yet." :
+                                            "No more differences below.");
+                        }
+                        break;
+                    case ACTION_PREV_HUNK:
+                        if (hex_diff_find(diff, (uint64_t)state->top_line * bytes_per_row, false, &range_offset)) {
+                            state->top_line = (int)(range_offset / bytes_per_row);
+                        } else {
+                            ui_show_message(state, "No more differences above.");
+                        }
+                        break;
+                    case ACTION_GO_BACK: {
+                        // Leave the diff and show the left file on its own.
+                        char *path = strdup(state->filepath);
+                        if (!path) return FAT_ERROR_MEMORY;
+                        res = state_init(state, path);
+                        free(path);
+                        return res;
+                    }
+                    default:
+                        break;
+                }
+            }
+            break;
+
         case VIEW_MODE_BINARY_HEX:
+        case VIEW_MODE_STRINGS:
         case VIEW_MODE_NORMAL:
+        case VIEW_MODE_JSON:
+        case VIEW_MODE_TABLE:
             {
                 int visible_content_width = getmaxy(state->right_pane) - 7 - 1;
                 int max_scroll_limit = (int)state->max_line_len - visible_content_width;
@@ -192,33 +532,170 @@ FatResult process_input(AppState *state, int ch) {
                         if (state->view_mode == VIEW_MODE_NORMAL) {
                             return state_reload_content(state, VIEW_MODE_BINARY_HEX);
                         } else if (state->view_mode == VIEW_MODE_BINARY_HEX) {
+                            // JSON and CSV files cycle through text, hex and their structured view.
+                            ViewMode next_mode = json_view_detect(state->filepath, NULL) ? VIEW_MODE_JSON :
+                                                 table_view_detect(state->filepath, NULL) ? VIEW_MODE_TABLE :
+                                                 VIEW_MODE_NORMAL;
+                            return state_reload_content(state, next_mode);
+                        } else if (state->view_mode == VIEW_MODE_JSON || state->view_mode == VIEW_MODE_TABLE) {
                             return state_reload_content(state, VIEW_MODE_NORMAL);
                         }
                         break;
+                    case ACTION_JUMP_TO_COLUMN:
+                        if (state->view_mode == VIEW_MODE_TABLE) {
+                            char column_text[64];
+                            if (ui_get_column_input(state, column_text, sizeof(column_text))) {
+                                int column = table_view_find_column(state->table, column_text);
+                                if (column < 0) {
+                                    ui_show_message(state, "No such column.");
+                                } else {
+                                    state->left_char = column;
+                                }
+                            }
+                        }
+                        break;
+                    case ACTION_SORT_COLUMN:
+                        if (state->view_mode == VIEW_MODE_TABLE) {
+                            res = state_sort_table(state, (size_t)state->left_char);
+                            if (res != FAT_SUCCESS) {
+                                ui_show_message(state, "Could not sort the table.");
+                                res = FAT_SUCCESS;
+                            }
+                        }
+                        break;
+                    case ACTION_TOGGLE_STRINGS:
+                        if (state->view_mode == VIEW_MODE_BINARY_HEX || state->view_mode == VIEW_MODE_STRINGS) {
+                            res = state_toggle_strings(state);
+                        }
+                        break;
+                    case ACTION_LIST_SECTIONS:
+                        if (state->view_mode == VIEW_MODE_BINARY_HEX) {
+                            int section = ui_show_section_list(state);
+                            if (section >= 0) state_jump_to_offset(state, state->binary->sections[section].offset);
+                        }
+                        break;
+                    case ACTION_FIND_SYMBOL:
+                        if (state->view_mode == VIEW_MODE_BINARY_HEX) {
+                            if (!state->binary) {
+                                ui_show_message(state, "Not an ELF, PE or Mach-O file.");
+                                break;
+                            }
+                            char name[256];
+                            if (ui_get_symbol_input(state, name, sizeof(name))) {
+                                const BinarySymbol *symbol;
+                                FatResult found = binary_format_find_symbol(state->binary, name, &symbol);
+                                if (found != FAT_SUCCESS) {
+                                    ui_show_message(state, found == FAT_ERROR_FILE_NOT_FOUND ? "Symbol not found." :
+                                                                                                "Could not read the symbol table.");
+                                } else if (symbol->offset == UINT64_MAX) {
+                                    ui_show_message(state, "That symbol has no contents in the file.");
+                                } else {
+                                    state_jump_to_offset(state, symbol->offset);
+                                }
+                            }
+                        }
+                        break;
+                    case ACTION_PIN_TERM: {
+                        char term[MULTI_MATCH_MAX_TERM_LEN + 1];
+                        if (ui_get_pin_input(state, term, sizeof(term))) {
+                            res = state_toggle_pin(state, term);
+                            if (res == FAT_ERROR_INVALID_ARGUMENT) {
+                                // Only a new term is refused when the table is full.
+                                ui_show_message(state, state->pins.terms.count >= MULTI_MATCH_MAX_TERMS ?
+                                                       "At most 16 terms can be pinned." :
+                                                       "A pinned term must be 1 to 255 bytes long.");
+                                res = FAT_SUCCESS;
+                            }
+                        }
+                        break;
+                    }
+                    case ACTION_CLEAR_PINS:
+                        state_clear_pins(state);
+                        break;
+                    case ACTION_JUMP_TO_TIME:
+                        if (state->view_mode == VIEW_MODE_NORMAL) {
+                            char time_text[64];
+                            if (ui_get_time_input(state, time_text, sizeof(time_text))) {
+                                FatResult found = state_jump_to_time(state, time_text);
+                                if (found == FAT_ERROR_UNSUPPORTED) {
+                                    ui_show_message(state, "No timestamps at the start of the lines.");
+                                } else if (found == FAT_ERROR_INVALID_ARGUMENT) {
+                                    ui_show_message(state, "Could not read that time.");
+                                } else if (found == FAT_ERROR_FILE_NOT_FOUND) {
+                                    ui_show_message(state, "No line is at or after that time.");
+                                }
+                            }
+                        }
+                        break;
+                    case ACTION_TOGGLE_TIMELINE:
+                        if (state->view_mode == VIEW_MODE_NORMAL) state->show_timeline = !state->show_timeline;
+                        if (state->view_mode == VIEW_MODE_BINARY_HEX) state->hide_byte_map = !state->hide_byte_map;
+                        break;
+                    case ACTION_NEXT_BUCKET:
+                    case ACTION_PREV_BUCKET:
+                        if (state->view_mode == VIEW_MODE_BINARY_HEX && !state->hide_byte_map) {
+                            if (state_byte_map_step(state, action == ACTION_NEXT_BUCKET) == FAT_ERROR_FILE_NOT_FOUND) {
+                                ui_show_message(state, action == ACTION_NEXT_BUCKET ? "No later region in the byte map." :
+                                                                                      "No earlier region in the byte map.");
+                            }
+                        } else if (state->view_mode == VIEW_MODE_NORMAL && state->show_timeline) {
+                            FatResult found = state_timeline_step(state, action == ACTION_NEXT_BUCKET,
+                                                                  (size_t)ui_timeline_columns(state));
+                            if (found == FAT_ERROR_UNSUPPORTED) {
+                                ui_show_message(state, "No timestamps at the start of the lines.");
+                            } else if (found == FAT_ERROR_FILE_NOT_FOUND) {
+                                ui_show_message(state, action == ACTION_NEXT_BUCKET ? "No later lines on the timeline." :
+                                                                                      "No earlier lines on the timeline.");
+                            }
+                        }
+                        break;
+                    case ACTION_NEXT_PINNED:
+                    case ACTION_PREV_PINNED:
+                        if (state->pins.terms.count == 0) {
+                            ui_show_message(state, "No terms are pinned.");
+                        } else if (state_jump_to_pinned(state, action == ACTION_NEXT_PINNED) != FAT_SUCCESS) {
+                            ui_show_message(state, "No line contains a pinned term.");
+                        }
+                        break;
+                    case ACTION_CONFIRM:
+                        if (state->view_mode == VIEW_MODE_JSON) {
+                            res = state_toggle_json_node(state);
+                            if (res == FAT_ERROR_UNSUPPORTED) res = FAT_SUCCESS; // Scalars have nothing to expand
+                        } else if (state->view_mode == VIEW_MODE_STRINGS) {
+                            res = state_toggle_strings(state); // Shows the string in the hex dump
+                        }
+                        break;
                     case ACTION_SCROLL_DOWN:
-                        if (state->top_line + 1 < (int)state->content.count) state->top_line++;
+                        if (state->top_line + 1 < (int)state_line_count(state)) state->top_line++;
                         break;
                     case ACTION_SCROLL_UP:
                         if (state->top_line > 0) state->top_line--;
                         break;
                     case ACTION_SCROLL_RIGHT:
-                        if (!state->line_wrap_enabled && state->left_char < max_scroll_limit) {
-                            const char *line = state->content.lines[state->top_line];
-                            if (state->left_char < (int)strlen(line)) {
+                        if (state->view_mode == VIEW_MODE_TABLE) {
+                            // Tables scroll horizontally by whole columns.
+                            if ((size_t)state->left_char + 1 < state->table->column_count) state->left_char++;
+                        } else if (!state->line_wrap_enabled && state->left_char < max_scroll_limit) {
+                            size_t line_len;
+                            const char *line = state_get_line(state, (size_t)state->top_line, &line_len);
+                            if (line && state->left_char < (int)line_len) {
                                 state->left_char += utf8_char_len(&line[state->left_char]);
                             }
                         }
                         break;
                     case ACTION_SCROLL_LEFT:
-                        if (!state->line_wrap_enabled && state->left_char > 0) {
-                            const char *line = state->content.lines[state->top_line];
-                            state->left_char = utf8_prev_char_start(line, state->left_char);
+                        if (state->view_mode == VIEW_MODE_TABLE) {
+                            if (state->left_char > 0) state->left_char--;
+                        } else if (!state->line_wrap_enabled && state->left_char > 0) {
+                            size_t line_len;
+                            const char *line = state_get_line(state, (size_t)state->top_line, &line_len);
+                            if (line) state->left_char = utf8_prev_char_start(line, state->left_char);
                         }
                         break;
                     case ACTION_PAGE_DOWN:
                         state->top_line += page_size;
-                        if ((size_t)(state->top_line) >= state->content.count) {
-                             state->top_line = state->content.count > 0 ? (int)state->content.count - 1 : 0;
+                        if ((size_t)(state->top_line) >= state_line_count(state)) {
+                             state->top_line = state_line_count(state) > 0 ? (int)state_line_count(state) - 1 : 0;
                         }
                         break;
                     case ACTION_PAGE_UP:
@@ -227,14 +704,11 @@ FatResult process_input(AppState *state, int ch) {
                         break;
                     
                     case ACTION_SEARCH:
-                        ui_get_search_input(state); // This function now handles everything
-                        if (state->search_term_active) {
-                           res = state_perform_search(state);
-                           if (res == FAT_ERROR_FILE_NOT_FOUND) {
-                               ui_show_message(state, "No matches found.");
-                               state->search_term_active = false;
-                               res = FAT_SUCCESS;
-                           }
+                        ui_get_search_input(state); // Searches as the term is typed
+                        if (state->search_term_active && !state->search_results.is_scanning &&
+                            state->search_results.count == 0) {
+                            ui_show_message(state, "No matches found.");
+                            state_clear_search(state);
                         }
                         break;
 
@@ -268,18 +742,24 @@ FatResult process_input(AppState *state, int ch) {
                         }
                         break;
                     case ACTION_GO_BACK:
-                        if (state->breadcrumbs.count > 1) {
-                            cleanup_temp_file_if_exists(state->breadcrumbs.lines[state->breadcrumbs.count - 1]);
-                            state->breadcrumbs.count--;
-                            return state_init(state, state->breadcrumbs.lines[state->breadcrumbs.count - 1]);
+                        if (state->view_mode == VIEW_MODE_STRINGS) {
+                            // Back to the hex dump first, as the strings are a view of the same file.
+                            if (state->search_term_active) {
+                                state_clear_search(state);
+                            } else {
+                                res = state_toggle_strings(state);
+                            }
+                        } else if (state->breadcrumbs.count > 1) {
+                            return state_go_back(state);
                         } else if (state->search_term_active) {
-                            state->search_term[0] = '\0';
-                            state->search_term_active = false;
-                            free(state->search_results.matches);
-                            state->search_results.matches = NULL;
-                            state->search_results.count = 0;
-                            state->search_results.capacity = 0;
+                            state_clear_search(state);
                             return FAT_SUCCESS;
+                        } else if (state->filter) {
+                            state_clear_filter(state);
+                        } else if (state->view_mode == VIEW_MODE_TABLE &&
+                                   (state->table->order || table_view_sort_is_running(state->table))) {
+                            table_view_clear_sort(state->table);
+                            state->top_line = 0;
                         }
                         break;
                     default:
@@ -0,0 +1,590 @@
+/**
+ * @file diff.c
+ * @author Zuhaitz (original)
+ * @brief Implements the background patience/Myers line diff.
+ */
+#include "core/diff.h"
+#include "utils/logger.h"
+#include <stdlib.h>
+#include <string.h>
+
+/** @brief Regions with more lines than this are not handed to Myers. */
+#define MYERS_MAX_LINES 20000
+/** @brief The largest edit distance Myers searches before giving up on a region. */
+#define MYERS_MAX_COST 2048
+/** @brief How deep patience diff may recurse before falling back to Myers. */
+#define PATIENCE_MAX_DEPTH 48
+
+// **Hashing and Comparison**
+
+/**
+ * @brief Hashes a line with 64-bit FNV-1a.
+ */
+static uint64_t hash_line(const char* line, size_t len) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)line[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * @brief Hashes every line of an index into a newly allocated array.
+ */
+static uint64_t* hash_lines(const LineIndex* index) {
+    uint64_t* hashes = malloc((index->count ? index->count : 1) * sizeof(uint64_t));
+    if (!hashes) return NULL;
+    for (size_t i = 0; i < index->count; i++) {
+        size_t len;
+        const char* line = line_index_get(index, i, &len);
+        hashes[i] = hash_line(line, len);
+    }
+    return hashes;
+}
+
+/**
+ * @brief Compares line `i` of the left file with line `j` of the right file.
+ */
+static bool lines_equal(const DiffView* view, size_t i, size_t j) {
+    if (view->hash_a[i] != view->hash_b[j]) return false;
+    size_t len_a, len_b;
+    const char* line_a = line_index_get(&view->a, i, &len_a);
+    const char* line_b = line_index_get(&view->b, j, &len_b);
+    return len_a == len_b && memcmp(line_a, line_b, len_a) == 0;
+}
+
+/**
+ * @brief Returns true if the view is being torn down.
+ */
+static bool is_cancelled(DiffView* view) {
+    pthread_mutex_lock(&view->lock);
+    bool cancel = view->cancel;
+    pthread_mutex_unlock(&view->lock);
+    return cancel;
+}
+
+// **Publishing Runs**
+
+/**
+ * @brief Returns the number of display rows a run takes.
+ */
+static size_t run_rows(const DiffRun* run) {
+    if (!run->is_change) return run->a_len;
+    return run->a_len > run->b_len ? run->a_len : run->b_len;
+}
+
+/**
+ * @brief Appends a run, merging it into the previous one when they are of the same kind.
+ */
+static FatResult emit_run(DiffView* view, bool is_change, size_t a_start, size_t a_len, size_t b_start, size_t b_len) {
+    if (a_len == 0 && b_len == 0) return FAT_SUCCESS;
+
+    FatResult res = FAT_SUCCESS;
+    pthread_mutex_lock(&view->lock);
+    DiffRun* last = view->run_count > 0 ? &view->runs[view->run_count - 1] : NULL;
+    if (last && last->is_change == is_change) {
+        size_t old_rows = run_rows(last);
+        last->a_len += a_len;
+        last->b_len += b_len;
+        view->progress.row_count += run_rows(last) - old_rows;
+    } else {
+        if (view->run_count >= view->run_capacity) {
+            size_t new_capacity = (view->run_capacity == 0) ? 256 : view->run_capacity * 2;
+            DiffRun* new_runs = realloc(view->runs, new_capacity * sizeof(DiffRun));
+            if (!new_runs) {
+                res = FAT_ERROR_MEMORY;
+                goto unlock;
+            }
+            view->runs = new_runs;
+            view->run_capacity = new_capacity;
+        }
+        DiffRun* run = &view->runs[view->run_count++];
+        run->a_start = a_start;
+        run->a_len = a_len;
+        run->b_start = b_start;
+        run->b_len = b_len;
+        run->row = view->progress.row_count;
+        run->is_change = is_change;
+        run->hunk = is_change ? view->progress.hunk_count++ : 0;
+        view->progress.row_count += run_rows(run);
+    }
+    if (is_change) {
+        view->progress.lines_removed += a_len;
+        view->progress.lines_added += b_len;
+    }
+
+unlock:
+    pthread_mutex_unlock(&view->lock);
+    return res;
+}
+
+// **Myers**
+
+/**
+ * @brief Diffs a region with Myers' greedy O(ND) algorithm and emits the result.
+ *
+ * The furthest reaching x of every diagonal is kept for every edit distance
+ * so the path can be walked back. Only diagonals `-d..d` are stored for
+ * distance `d`, which keeps the trace at O(D^2).
+ *
+ * @return FAT_SUCCESS if the region was emitted, FAT_ERROR_UNSUPPORTED if it is
+ * too large or too different, in which case nothing was emitted.
+ */
+static FatResult myers_region(DiffView* view, size_t a_lo, size_t n, size_t b_lo, size_t m) {
+    if (n + m > MYERS_MAX_LINES) return FAT_ERROR_UNSUPPORTED;
+
+    int max_d = (int)(n + m);
+    if (max_d > MYERS_MAX_COST) max_d = MYERS_MAX_COST;
+    int** trace = calloc((size_t)max_d + 1, sizeof(int*));
+    char* ops = malloc(n + m + 1);
+    if (!trace || !ops) {
+        free(trace);
+        free(ops);
+        return FAT_ERROR_MEMORY;
+    }
+
+    FatResult res = FAT_ERROR_UNSUPPORTED;
+    int found_d = -1;
+    for (int d = 0; d <= max_d && found_d < 0; d++) {
+        if ((d & 63) == 63 && is_cancelled(view)) break;
+        int* v = malloc((size_t)(2 * d + 1) * sizeof(int));
+        if (!v) {
+            res = FAT_ERROR_MEMORY;
+            break;
+        }
+        trace[d] = v;
+        int* prev = d > 0 ? trace[d - 1] + (d - 1) : NULL; // Indexed by diagonal
+
+        for (int k = -d; k <= d; k += 2) {
+            int x;
+            if (d == 0) {
+                x = 0;
+            } else if (k == -d || (k != d && prev[k - 1] < prev[k + 1])) {
+                x = prev[k + 1];         // Move down: insert from the right file
+            } else {
+                x = prev[k - 1] + 1;     // Move right: delete from the left file
+            }
+            int y = x - k;
+            while (x < (int)n && y < (int)m && lines_equal(view, a_lo + (size_t)x, b_lo + (size_t)y)) {
+                x++;
+                y++;
+            }
+            v[k + d] = x;
+            if (x >= (int)n && y >= (int)m) {
+                found_d = d;
+                break;
+            }
+        }
+    }
+
+    if (found_d >= 0) {
+        // Walk the trace back from (n, m), recording the script in reverse.
+        size_t op_count = 0;
+        int x = (int)n, y = (int)m;
+        for (int d = found_d; d > 0; d--) {
+            int* prev = trace[d - 1] + (d - 1);
+            int k = x - y;
+            int prev_k = (k == -d || (k != d && prev[k - 1] < prev[k + 1])) ? k + 1 : k - 1;
+            int prev_x = prev[prev_k];
+            int prev_y = prev_x - prev_k;
+            while (x > prev_x && y > prev_y) {
+                ops[op_count++] = '=';
+                x--;
+                y--;
+            }
+            if (x == prev_x) {
+                ops[op_count++] = '+';
+                y--;
+            } else {
+                ops[op_count++] = '-';
+                x--;
+            }
+        }
+        while (x > 0 && y > 0) {
+            ops[op_count++] = '=';
+            x--;
+            y--;
+        }
+
+        // Replay it forwards, grouping consecutive operations into runs.
+        res = FAT_SUCCESS;
+        size_t ai = a_lo, bi = b_lo;
+        size_t i = op_count;
+        while (i > 0 && res == FAT_SUCCESS) {
+            size_t a_start = ai, b_start = bi;
+            if (ops[i - 1] == '=') {
+                while (i > 0 && ops[i - 1] == '=') { ai++; bi++; i--; }
+                res = emit_run(view, false, a_start, ai - a_start, b_start, bi - b_start);
+            } else {
+                while (i > 0 && ops[i - 1] != '=') {
+                    if (ops[i - 1] == '-') ai++; else bi++;
+                    i--;
+                }
+                res = emit_run(view, true, a_start, ai - a_start, b_start, bi - b_start);
+            }
+        }
+    }
+
+    for (int d = 0; d <= max_d; d++) free(trace[d]);
+    free(trace);
+    free(ops);
+    return res;
+}
+
+// **Patience**
+
+/**
+ * @struct UniqueSlot
+ * @brief An open addressing hash table slot counting a line's occurrences.
+ */
+typedef struct {
+    uint64_t hash;
+    size_t a_idx;
+    size_t b_idx;
+    unsigned a_count;
+    unsigned b_count;
+    bool used;
+} UniqueSlot;
+
+/**
+ * @brief Finds the slot for a hash, claiming an empty one if it is not present.
+ */
+static UniqueSlot* slot_for(UniqueSlot* slots, size_t mask, uint64_t hash) {
+    size_t i = (size_t)hash & mask;
+    while (slots[i].used && slots[i].hash != hash) i = (i + 1) & mask;
+    slots[i].used = true;
+    slots[i].hash = hash;
+    return &slots[i];
+}
+
+/**
+ * @brief Finds the longest increasing run of lines that are unique in both halves of a region.
+ *
+ * @param out_a Set to a newly allocated array of left file anchor lines.
+ * @param out_b Set to a newly allocated array of the matching right file lines.
+ * @param out_count Set to the number of anchors, which may be zero.
+ */
+static FatResult find_anchors(DiffView* view, size_t a_lo, size_t a_hi, size_t b_lo, size_t b_hi,
+                              size_t** out_a, size_t** out_b, size_t* out_count) {
+    *out_a = NULL;
+    *out_b = NULL;
+    *out_count = 0;
+
+    size_t lines = (a_hi - a_lo) + (b_hi - b_lo);
+    size_t capacity = 16;
+    while (capacity < lines * 2) capacity *= 2;
+    size_t mask = capacity - 1;
+
+    UniqueSlot* slots = calloc(capacity, sizeof(UniqueSlot));
+    size_t* cand_a = malloc((a_hi - a_lo) * sizeof(size_t));
+    size_t* cand_b = malloc((a_hi - a_lo) * sizeof(size_t));
+    if (!slots || !cand_a || !cand_b) goto oom;
+
+    for (size_t i = a_lo; i < a_hi; i++) {
+        UniqueSlot* slot = slot_for(slots, mask, view->hash_a[i]);
+        slot->a_count++;
+        slot->a_idx = i;
+    }
+    for (size_t j = b_lo; j < b_hi; j++) {
+        UniqueSlot* slot = slot_for(slots, mask, view->hash_b[j]);
+        slot->b_count++;
+        slot->b_idx = j;
+    }
+
+    size_t k = 0;
+    for (size_t i = a_lo; i < a_hi; i++) {
+        UniqueSlot* slot = slot_for(slots, mask, view->hash_a[i]);
+        if (slot->a_count == 1 && slot->b_count == 1 && lines_equal(view, i, slot->b_idx)) {
+            cand_a[k] = i;
+            cand_b[k] = slot->b_idx;
+            k++;
+        }
+    }
+    free(slots);
+    slots = NULL;
+
+    if (k == 0) {
+        free(cand_a);
+        free(cand_b);
+        return FAT_SUCCESS;
+    }
+
+    // Patience sorting: tails[p] is the candidate ending the best run of length p + 1.
+    size_t* tails = malloc(k * sizeof(size_t));
+    size_t* back = malloc(k * sizeof(size_t));
+    if (!tails || !back) {
+        free(tails);
+        free(back);
+        goto oom;
+    }
+    size_t piles = 0;
+    for (size_t c = 0; c < k; c++) {
+        size_t lo = 0, hi = piles;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (cand_b[tails[mid]] < cand_b[c]) lo = mid + 1; else hi = mid;
+        }
+        back[c] = lo > 0 ? tails[lo - 1] : (size_t)-1;
+        tails[lo] = c;
+        if (lo == piles) piles++;
+    }
+
+    size_t* anchors_a = malloc(piles * sizeof(size_t));
+    size_t* anchors_b = malloc(piles * sizeof(size_t));
+    if (!anchors_a || !anchors_b) {
+        free(anchors_a);
+        free(anchors_b);
+        free(tails);
+        free(back);
+        goto oom;
+    }
+    size_t c = tails[piles - 1];
+    for (size_t p = piles; p > 0; p--) {
+        anchors_a[p - 1] = cand_a[c];
+        anchors_b[p - 1] = cand_b[c];
+        c = back[c];
+    }
+
+    free(tails);
+    free(back);
+    free(cand_a);
+    free(cand_b);
+    *out_a = anchors_a;
+    *out_b = anchors_b;
+    *out_count = piles;
+    return FAT_SUCCESS;
+
+oom:
+    free(slots);
+    free(cand_a);
+    free(cand_b);
+    return FAT_ERROR_MEMORY;
+}
+
+/**
+ * @brief Diffs a region of both files and emits its runs in order.
+ */
+static FatResult diff_region(DiffView* view, size_t a_lo, size_t a_hi, size_t b_lo, size_t b_hi, int depth) {
+    if (is_cancelled(view)) return FAT_ERROR_UNSUPPORTED;
+
+    // Lines shared at the start and end of the region need no further work.
+    size_t prefix = 0;
+    while (a_lo + prefix < a_hi && b_lo + prefix < b_hi && lines_equal(view, a_lo + prefix, b_lo + prefix)) {
+        prefix++;
+    }
+    FatResult res = emit_run(view, false, a_lo, prefix, b_lo, prefix);
+    if (res != FAT_SUCCESS) return res;
+    a_lo += prefix;
+    b_lo += prefix;
+
+    size_t suffix = 0;
+    while (a_hi - suffix > a_lo && b_hi - suffix > b_lo && lines_equal(view, a_hi - suffix - 1, b_hi - suffix - 1)) {
+        suffix++;
+    }
+    a_hi -= suffix;
+    b_hi -= suffix;
+
+    if (a_lo == a_hi || b_lo == b_hi) {
+        res = emit_run(view, true, a_lo, a_hi - a_lo, b_lo, b_hi - b_lo);
+    } else {
+        size_t *anchors_a = NULL, *anchors_b = NULL, anchor_count = 0;
+        if (depth < PATIENCE_MAX_DEPTH) {
+            res = find_anchors(view, a_lo, a_hi, b_lo, b_hi, &anchors_a, &anchors_b, &anchor_count);
+            if (res != FAT_SUCCESS) return res;
+        }
+
+        if (anchor_count > 0) {
+            size_t a_pos = a_lo, b_pos = b_lo;
+            for (size_t i = 0; i < anchor_count && res == FAT_SUCCESS; i++) {
+                res = diff_region(view, a_pos, anchors_a[i], b_pos, anchors_b[i], depth + 1);
+                if (res == FAT_SUCCESS) res = emit_run(view, false, anchors_a[i], 1, anchors_b[i], 1);
+                a_pos = anchors_a[i] + 1;
+                b_pos = anchors_b[i] + 1;
+            }
+            if (res == FAT_SUCCESS) res = diff_region(view, a_pos, a_hi, b_pos, b_hi, depth + 1);
+        } else {
+            // No unique lines to anchor on: align the region exactly if that is
+            // affordable, otherwise show it as a single hunk.
+            res = myers_region(view, a_lo, a_hi - a_lo, b_lo, b_hi - b_lo);
+            if (res == FAT_ERROR_UNSUPPORTED && !is_cancelled(view)) {
+                res = emit_run(view, true, a_lo, a_hi - a_lo, b_lo, b_hi - b_lo);
+            }
+        }
+        free(anchors_a);
+        free(anchors_b);
+    }
+    if (res != FAT_SUCCESS) return res;
+
+    return emit_run(view, false, a_hi, suffix, b_hi, suffix);
+}
+
+/**
+ * @brief The worker thread: hashes both files and diffs them.
+ */
+static void* diff_worker(void* arg) {
+    DiffView* view = arg;
+    FatResult res = FAT_ERROR_MEMORY;
+
+    view->hash_a = hash_lines(&view->a);
+    view->hash_b = hash_lines(&view->b);
+    if (view->hash_a && view->hash_b) {
+        res = diff_region(view, 0, view->a.count, 0, view->b.count, 0);
+    }
+    if (res != FAT_SUCCESS && !is_cancelled(view)) {
+        LOG_INFO("Diff failed with code %d", res);
+    }
+
+    pthread_mutex_lock(&view->lock);
+    view->progress.is_done = true;
+    pthread_mutex_unlock(&view->lock);
+    return NULL;
+}
+
+// **Public API**
+
+/**
+ * @brief Opens two files and starts diffing them in the background.
+ */
+FatResult diff_start(DiffView* view, const char* path_a, const char* path_b) {
+    memset(view, 0, sizeof(*view));
+
+    FatResult res = line_index_open(&view->a, path_a);
+    if (res != FAT_SUCCESS) return res;
+    res = line_index_open(&view->b, path_b);
+    if (res != FAT_SUCCESS) {
+        line_index_free(&view->a);
+        return res;
+    }
+    view->path_a = strdup(path_a);
+    view->path_b = strdup(path_b);
+    if (!view->path_a || !view->path_b) {
+        free(view->path_a);
+        free(view->path_b);
+        line_index_free(&view->a);
+        line_index_free(&view->b);
+        memset(view, 0, sizeof(*view));
+        return FAT_ERROR_MEMORY;
+    }
+
+    pthread_mutex_init(&view->lock, NULL);
+    if (pthread_create(&view->thread, NULL, diff_worker, view) == 0) {
+        view->has_thread = true;
+    } else {
+        LOG_INFO("Could not start the diff thread, diffing in the foreground");
+        diff_worker(view);
+    }
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Returns a snapshot of the diff's progress.
+ */
+void diff_get_progress(DiffView* view, DiffProgress* out) {
+    pthread_mutex_lock(&view->lock);
+    *out = view->progress;
+    pthread_mutex_unlock(&view->lock);
+}
+
+/**
+ * @brief Returns the index of the run containing a display row. Must be called with the lock held.
+ */
+static size_t find_run(const DiffView* view, size_t row) {
+    size_t lo = 0, hi = view->run_count;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (view->runs[mid].row <= row) lo = mid; else hi = mid;
+    }
+    return lo;
+}
+
+/**
+ * @brief Copies the description of consecutive display rows.
+ */
+size_t diff_get_rows(DiffView* view, size_t first, size_t count, DiffRow* out) {
+    size_t copied = 0;
+    pthread_mutex_lock(&view->lock);
+    if (first < view->progress.row_count) {
+        for (size_t i = find_run(view, first); i < view->run_count && copied < count; i++) {
+            const DiffRun* run = &view->runs[i];
+            size_t rows = run_rows(run);
+            for (size_t offset = first + copied - run->row; offset < rows && copied < count; offset++) {
+                DiffRow* row = &out[copied++];
+                row->is_change = run->is_change;
+                row->has_a = offset < run->a_len;
+                row->has_b = offset < run->b_len;
+                row->a_line = run->a_start + offset;
+                row->b_line = run->b_start + offset;
+            }
+        }
+    }
+    pthread_mutex_unlock(&view->lock);
+    return copied;
+}
+
+/**
+ * @brief Finds the start of the next or previous hunk.
+ */
+bool diff_find_hunk(DiffView* view, size_t row, bool forward, size_t* out_row, size_t* out_index) {
+    bool found = false;
+    pthread_mutex_lock(&view->lock);
+    if (view->run_count > 0) {
+        size_t i = find_run(view, row);
+        if (forward) {
+            for (; i < view->run_count && !found; i++) {
+                if (view->runs[i].is_change && view->runs[i].row > row) {
+                    *out_row = view->runs[i].row;
+                    if (out_index) *out_index = view->runs[i].hunk;
+                    found = true;
+                }
+            }
+        } else {
+            for (size_t j = i + 1; j > 0 && !found; j--) {
+                if (view->runs[j - 1].is_change && view->runs[j - 1].row < row) {
+                    *out_row = view->runs[j - 1].row;
+                    if (out_index) *out_index = view->runs[j - 1].hunk;
+                    found = true;
+                }
+            }
+        }
+    }
+    pthread_mutex_unlock(&view->lock);
+    return found;
+}
+
+/**
+ * @brief Returns the heap memory held by the view.
+ *
+ * The hashes are counted whether or not the worker has got to them, since
+ * it writes the pointers without the lock.
+ */
+size_t diff_memory_usage(DiffView* view) {
+    size_t usage = line_index_memory_usage(&view->a) + line_index_memory_usage(&view->b);
+    usage += (view->a.count + view->b.count) * sizeof(uint64_t);
+    pthread_mutex_lock(&view->lock);
+    usage += view->run_capacity * sizeof(DiffRun);
+    pthread_mutex_unlock(&view->lock);
+    return usage;
+}
+
+/**
+ * @brief Stops the worker thread and frees everything owned by the view.
+ */
+void diff_free(DiffView* view) {
+    if (!view) return;
+    if (view->has_thread) {
+        pthread_mutex_lock(&view->lock);
+        view->cancel = true;
+        pthread_mutex_unlock(&view->lock);
+        pthread_join(view->thread, NULL);
+    }
+    pthread_mutex_destroy(&view->lock);
+    free(view->hash_a);
+    free(view->hash_b);
+    free(view->runs);
+    free(view->path_a);
+    free(view->path_b);
+    line_index_free(&view->a);
+    line_index_free(&view->b);
+    memset(view, 0, sizeof(*view));
+}
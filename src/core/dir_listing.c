@@ -0,0 +1,378 @@
+/**
+ * @file dir_listing.c
+ * @author Zuhaitz (original)
+ * @brief Implements directory listing, lazy stat and the MIME probe pool.
+ */
+#include "core/dir_listing.h"
+#include "plugins/plugin_manager.h"
+#include "utils/logger.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <magic.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+/** @brief How many rows after `priority_start` are probed before the rest. */
+#define DIR_PROBE_PRIORITY_WINDOW 256
+
+// **Listing**
+
+/**
+ * @brief Appends an entry, growing the array as needed.
+ */
+static FatResult add_entry(DirListing* listing, size_t* capacity, const char* name, DirEntryType type) {
+    if (listing->count == *capacity) {
+        size_t new_capacity = *capacity ? *capacity * 2 : 64;
+        DirEntry* new_entries = realloc(listing->entries, new_capacity * sizeof(DirEntry));
+        if (!new_entries) return FAT_ERROR_MEMORY;
+        listing->entries = new_entries;
+        *capacity = new_capacity;
+    }
+    DirEntry* entry = &listing->entries[listing->count];
+    memset(entry, 0, sizeof(*entry));
+    entry->name = strdup(name);
+    if (!entry->name) return FAT_ERROR_MEMORY;
+    entry->type = type;
+    listing->count++;
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Maps a `d_type` value to a DirEntryType.
+ */
+static DirEntryType entry_type_from_dtype(unsigned char d_type) {
+    switch (d_type) {
+        case DT_REG: return DIR_ENTRY_FILE;
+        case DT_DIR: return DIR_ENTRY_DIR;
+        case DT_LNK: return DIR_ENTRY_LINK;
+        case DT_UNKNOWN: return DIR_ENTRY_UNKNOWN;
+        default: return DIR_ENTRY_OTHER;
+    }
+}
+
+/**
+ * @brief Returns true for the "." and ".." entries, which are not listed as read.
+ */
+static bool is_dot_entry(const char* name) {
+    return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+
+#ifdef __linux__
+/** @brief The record layout returned by the getdents64 system call. */
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+/**
+ * @brief Reads all entries with getdents64, which returns many per system call.
+ */
+static FatResult read_entries(DirListing* listing, size_t* capacity) {
+    int fd = open(listing->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return FAT_ERROR_FILE_NOT_FOUND;
+
+    FatResult res = FAT_SUCCESS;
+    size_t buffer_size = 64 * 1024;
+    char* buffer = malloc(buffer_size);
+    if (!buffer) {
+        close(fd);
+        return FAT_ERROR_MEMORY;
+    }
+
+    while (res == FAT_SUCCESS) {
+        long bytes = syscall(SYS_getdents64, fd, buffer, buffer_size);
+        if (bytes < 0) {
+            res = FAT_ERROR_FILE_READ;
+            break;
+        }
+        if (bytes == 0) break;
+        for (long offset = 0; offset < bytes && res == FAT_SUCCESS;) {
+            struct linux_dirent64* dirent = (struct linux_dirent64*)(buffer + offset);
+            if (!is_dot_entry(dirent->d_name)) {
+                res = add_entry(listing, capacity, dirent->d_name, entry_type_from_dtype(dirent->d_type));
+            }
+            offset += dirent->d_reclen;
+        }
+    }
+
+    free(buffer);
+    close(fd);
+    return res;
+}
+#else
+/**
+ * @brief Reads all entries with readdir.
+ */
+static FatResult read_entries(DirListing* listing, size_t* capacity) {
+    DIR* dir = opendir(listing->path);
+    if (!dir) return FAT_ERROR_FILE_NOT_FOUND;
+
+    FatResult res = FAT_SUCCESS;
+    struct dirent* dirent;
+    while (res == FAT_SUCCESS && (dirent = readdir(dir)) != NULL) {
+        if (!is_dot_entry(dirent->d_name)) {
+            res = add_entry(listing, capacity, dirent->d_name, entry_type_from_dtype(dirent->d_type));
+        }
+    }
+    closedir(dir);
+    return res;
+}
+#endif
+
+/**
+ * @brief Orders ".." first, then directories, then everything else, each by name.
+ */
+static int compare_entries(const void* a, const void* b) {
+    const DirEntry* entry_a = a;
+    const DirEntry* entry_b = b;
+    bool parent_a = strcmp(entry_a->name, "..") == 0;
+    bool parent_b = strcmp(entry_b->name, "..") == 0;
+    if (parent_a != parent_b) return parent_a ? -1 : 1;
+    bool dir_a = entry_a->type == DIR_ENTRY_DIR;
+    bool dir_b = entry_b->type == DIR_ENTRY_DIR;
+    if (dir_a != dir_b) return dir_a ? -1 : 1;
+    return strcmp(entry_a->name, entry_b->name);
+}
+
+// **Probe Pool**
+
+/**
+ * @brief Picks the next entry to probe, preferring the rows on screen.
+ * @return The entry index, or `count` if nothing is left. Called with the lock held.
+ */
+static size_t pick_entry(DirListing* listing) {
+    size_t end = listing->priority_start + DIR_PROBE_PRIORITY_WINDOW;
+    if (end > listing->count) end = listing->count;
+    for (size_t i = listing->priority_start; i < end; i++) {
+        if (listing->entries[i].probe_state == DIR_PROBE_PENDING) return i;
+    }
+    while (listing->next_probe < listing->count &&
+           listing->entries[listing->next_probe].probe_state != DIR_PROBE_PENDING) {
+        listing->next_probe++;
+    }
+    return listing->next_probe;
+}
+
+/**
+ * @brief Worker thread: sniffs MIME types and asks the plugins about each entry.
+ */
+static void* probe_worker(void* arg) {
+    DirListing* listing = arg;
+
+    // libmagic cookies are not thread-safe, so every worker has its own.
+    magic_t magic_cookie = magic_open(MAGIC_MIME_TYPE);
+    if (magic_cookie && magic_load(magic_cookie, NULL) != 0) {
+        magic_close(magic_cookie);
+        magic_cookie = NULL;
+    }
+
+    char path[4096];
+    pthread_mutex_lock(&listing->lock);
+    while (!listing->cancel) {
+        size_t idx = pick_entry(listing);
+        if (idx >= listing->count) break;
+        DirEntry* entry = &listing->entries[idx];
+        entry->probe_state = DIR_PROBE_RUNNING;
+        pthread_mutex_unlock(&listing->lock);
+
+        char* mime = NULL;
+        const ArchivePlugin* handler = NULL;
+        if (dir_listing_entry_path(listing, idx, path, sizeof(path)) == FAT_SUCCESS) {
+            struct stat st;
+            bool exists = stat(path, &st) == 0;
+            // Only regular files are handed to libmagic and the plugins;
+            // opening a FIFO or device could block or have side effects.
+            if (exists && S_ISREG(st.st_mode)) {
+                handler = pm_get_handler(path);
+                const char* magic_result = magic_cookie ? magic_file(magic_cookie, path) : NULL;
+                if (magic_result) mime = strdup(magic_result);
+            } else if (exists && S_ISDIR(st.st_mode)) {
+                mime = strdup("inode/directory");
+            }
+        }
+
+        pthread_mutex_lock(&listing->lock);
+        entry->mime = mime;
+        entry->handler_name = handler ? handler->plugin_name : NULL;
+        entry->probe_state = DIR_PROBE_DONE;
+        listing->probes_left--;
+    }
+    pthread_mutex_unlock(&listing->lock);
+
+    if (magic_cookie) magic_close(magic_cookie);
+    return NULL;
+}
+
+/**
+ * @brief Starts up to DIR_PROBE_MAX_THREADS workers, one per online CPU.
+ */
+static void start_probe_pool(DirListing* listing) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int wanted = cpus > 0 ? (int)cpus : 1;
+    if (wanted > DIR_PROBE_MAX_THREADS) wanted = DIR_PROBE_MAX_THREADS;
+    if ((size_t)wanted > listing->probes_left) wanted = (int)listing->probes_left;
+
+    for (int i = 0; i < wanted; i++) {
+        if (pthread_create(&listing->threads[listing->thread_count], NULL, probe_worker, listing) != 0) {
+            LOG_INFO("Could not start directory probe thread %d.", i);
+            break;
+        }
+        listing->thread_count++;
+    }
+    if (listing->thread_count == 0) {
+        // Without workers nothing would ever finish; show every entry as unknown.
+        for (size_t i = 0; i < listing->count; i++) {
+            listing->entries[i].probe_state = DIR_PROBE_DONE;
+        }
+        listing->probes_left = 0;
+    }
+}
+
+// **Public API**
+
+/**
+ * @brief Lists a directory and starts probing its entries in the background.
+ */
+FatResult dir_listing_open(DirListing* listing, const char* path) {
+    memset(listing, 0, sizeof(*listing));
+    listing->path = strdup(path);
+    if (!listing->path) return FAT_ERROR_MEMORY;
+    pthread_mutex_init(&listing->lock, NULL);
+
+    size_t capacity = 0;
+    FatResult res = FAT_SUCCESS;
+    if (strcmp(path, "/") != 0) {
+        res = add_entry(listing, &capacity, "..", DIR_ENTRY_DIR);
+    }
+    if (res == FAT_SUCCESS) res = read_entries(listing, &capacity);
+    if (res != FAT_SUCCESS) {
+        dir_listing_free(listing);
+        return res;
+    }
+
+    qsort(listing->entries, listing->count, sizeof(DirEntry), compare_entries);
+
+    // Directories are already known; only the rest needs a worker.
+    for (size_t i = 0; i < listing->count; i++) {
+        if (listing->entries[i].type == DIR_ENTRY_DIR) {
+            listing->entries[i].mime = strdup("inode/directory");
+            listing->entries[i].probe_state = DIR_PROBE_DONE;
+        } else {
+            listing->probes_left++;
+        }
+    }
+
+    start_probe_pool(listing);
+    LOG_INFO("Listed %zu entries in '%s'; probing %zu with %d threads.",
+             listing->count, path, listing->probes_left, listing->thread_count);
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Fetches the size and modification time of an entry if not done yet.
+ */
+void dir_listing_stat(DirListing* listing, size_t idx) {
+    if (idx >= listing->count) return;
+    DirEntry* entry = &listing->entries[idx];
+    if (entry->is_stat_done) return;
+    entry->is_stat_done = true;
+
+    char path[4096];
+    struct stat st;
+    if (dir_listing_entry_path(listing, idx, path, sizeof(path)) != FAT_SUCCESS || stat(path, &st) != 0) {
+        entry->stat_failed = true;
+        return;
+    }
+    entry->size = (uint64_t)st.st_size;
+    entry->mtime = st.st_mtime;
+    // Resolve types the file system did not report, and follow symlinks to directories.
+    if (S_ISDIR(st.st_mode) && entry->type != DIR_ENTRY_DIR && entry->type != DIR_ENTRY_LINK) {
+        entry->type = DIR_ENTRY_DIR;
+    } else if (entry->type == DIR_ENTRY_UNKNOWN) {
+        entry->type = S_ISREG(st.st_mode) ? DIR_ENTRY_FILE : DIR_ENTRY_OTHER;
+    }
+}
+
+/**
+ * @brief Makes the pool probe the entries starting at `first` next.
+ */
+void dir_listing_prioritize(DirListing* listing, size_t first) {
+    pthread_mutex_lock(&listing->lock);
+    listing->priority_start = first < listing->count ? first : 0;
+    pthread_mutex_unlock(&listing->lock);
+}
+
+/**
+ * @brief Copies the probe result of an entry.
+ */
+bool dir_listing_get_probe(DirListing* listing, size_t idx, char* mime, size_t mime_size, const char** handler_name) {
+    bool done = false;
+    mime[0] = '\0';
+    *handler_name = NULL;
+    pthread_mutex_lock(&listing->lock);
+    if (idx < listing->count && listing->entries[idx].probe_state == DIR_PROBE_DONE) {
+        done = true;
+        if (listing->entries[idx].mime) {
+            snprintf(mime, mime_size, "%s", listing->entries[idx].mime);
+        }
+        *handler_name = listing->entries[idx].handler_name;
+    }
+    pthread_mutex_unlock(&listing->lock);
+    return done;
+}
+
+/**
+ * @brief Returns true while entries are still being probed.
+ */
+bool dir_listing_is_probing(DirListing* listing) {
+    pthread_mutex_lock(&listing->lock);
+    bool probing = listing->probes_left > 0 && !listing->cancel;
+    pthread_mutex_unlock(&listing->lock);
+    return probing;
+}
+
+/**
+ * @brief Builds the full path of an entry.
+ */
+FatResult dir_listing_entry_path(const DirListing* listing, size_t idx, char* out, size_t out_size) {
+    if (idx >= listing->count) return FAT_ERROR_INVALID_ARGUMENT;
+    size_t dir_len = strlen(listing->path);
+    bool needs_slash = dir_len > 0 && listing->path[dir_len - 1] != '/';
+    int written = snprintf(out, out_size, "%s%s%s", listing->path, needs_slash ? "/" : "",
+                           listing->entries[idx].name);
+    if (written < 0 || (size_t)written >= out_size) return FAT_ERROR_INVALID_ARGUMENT;
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Stops the probe pool and frees the listing.
+ */
+void dir_listing_free(DirListing* listing) {
+    if (!listing || !listing->path) return;
+    if (listing->thread_count > 0) {
+        pthread_mutex_lock(&listing->lock);
+        listing->cancel = true;
+        pthread_mutex_unlock(&listing->lock);
+        for (int i = 0; i < listing->thread_count; i++) {
+            pthread_join(listing->threads[i], NULL);
+        }
+    }
+    pthread_mutex_destroy(&listing->lock);
+    for (size_t i = 0; i < listing->count; i++) {
+        free(listing->entries[i].name);
+        free(listing->entries[i].mime);
+    }
+    free(listing->entries);
+    free(listing->path);
+    memset(listing, 0, sizeof(*listing));
+}
@@ -8,6 +8,7 @@
  * functions (stat), and libmagic for MIME type detection.
  */
 #include "core/file.h"
+#include "core/file_source.h"
 #include "utils/logger.h"
 #include <sys/stat.h>
 #include <magic.h>
@@ -76,8 +77,16 @@ FatResult get_file_info(const char* path, StringList* info) {
     }
     free(mime_type);
     
-    // Size
-    snprintf(buffer, sizeof(buffer), "Size: %ld bytes", (long)st.st_size);
+    // Size (block devices report none; the kernel is asked for theirs)
+    FileSourceKind kind = FILE_SOURCE_REGULAR;
+    uint64_t size = (uint64_t)st.st_size;
+    if (!S_ISDIR(st.st_mode)) file_source_probe(path, &kind, &size);
+    if (kind == FILE_SOURCE_STREAM) {
+        snprintf(buffer, sizeof(buffer), "Size: unknown (stream)");
+    } else {
+        snprintf(buffer, sizeof(buffer), "Size: %llu bytes%s", (unsigned long long)size,
+                 kind == FILE_SOURCE_BLOCK_DEVICE ? " (block device)" : "");
+    }
     if (StringList_add(info, buffer) != FAT_SUCCESS) return FAT_ERROR_MEMORY;
 
     // Modified Time
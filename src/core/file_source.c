@@ -0,0 +1,306 @@
+/**
+ * @file file_source.c
+ * @author Zuhaitz (original)
+ * @brief Implements the regular, block device and stream file sources.
+ */
+#define _GNU_SOURCE // For O_DIRECT
+#include "core/file_source.h"
+#include "utils/logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
+
+#ifndef O_DIRECT
+#define O_DIRECT 0
+#endif
+
+/** @brief The most bytes a direct read bounces through at a time. */
+#define DIRECT_READ_SIZE (1024 * 1024)
+
+// **Kinds of Source**
+
+/**
+ * @brief Picks the kind of source a file is from its mode and reported size.
+ */
+static FileSourceKind kind_from_stat(const struct stat* st) {
+    if (S_ISBLK(st->st_mode)) return FILE_SOURCE_BLOCK_DEVICE;
+    // The files of /proc and the like claim to be empty, and have whatever they generate.
+    if (S_ISREG(st->st_mode) && st->st_size > 0) return FILE_SOURCE_REGULAR;
+    return FILE_SOURCE_STREAM;
+}
+
+/**
+ * @brief Asks the kernel for the size and logical block size of an open block device.
+ */
+static void block_device_geometry(int fd, uint64_t* size, size_t* block_size) {
+    *size = 0;
+    *block_size = 1;
+#if defined(__linux__) && defined(BLKGETSIZE64)
+    uint64_t bytes = 0;
+    if (ioctl(fd, BLKGETSIZE64, &bytes) == 0) *size = bytes;
+    int sector = 0;
+    if (ioctl(fd, BLKSSZGET, &sector) == 0 && sector > 0) *block_size = (size_t)sector;
+#else
+    // Elsewhere the end of a device is found by seeking to it.
+    off_t end = lseek(fd, 0, SEEK_END);
+    if (end > 0) *size = (uint64_t)end;
+    lseek(fd, 0, SEEK_SET);
+#endif
+}
+
+/**
+ * @brief Finds out how a path would be read, without reading it.
+ */
+FatResult file_source_probe(const char* path, FileSourceKind* kind, uint64_t* size) {
+    struct stat st;
+    if (stat(path, &st) != 0) return FAT_ERROR_FILE_NOT_FOUND;
+    *kind = kind_from_stat(&st);
+    if (!size) return FAT_SUCCESS;
+
+    *size = *kind == FILE_SOURCE_REGULAR ? (uint64_t)st.st_size : 0;
+    if (*kind == FILE_SOURCE_BLOCK_DEVICE) {
+        int fd = open(path, O_RDONLY);
+        if (fd >= 0) {
+            size_t block_size;
+            block_device_geometry(fd, size, &block_size);
+            close(fd);
+        }
+    }
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Returns a short name for a kind of source, for the metadata pane.
+ */
+const char* file_source_kind_name(FileSourceKind kind) {
+    switch (kind) {
+        case FILE_SOURCE_REGULAR: return "file";
+        case FILE_SOURCE_BLOCK_DEVICE: return "block device";
+        case FILE_SOURCE_STREAM: return "stream";
+    }
+    return "file";
+}
+
+// **Opening and Closing**
+
+/**
+ * @brief Opens a path for reading and finds out its kind and size.
+ */
+FatResult file_source_open(FileSource* source, const char* path, bool direct) {
+    memset(source, 0, sizeof(*source));
+    source->fd = -1;
+    source->block_size = 1;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        LOG_INFO("Could not open file '%s': %s", path, strerror(errno));
+        return FAT_ERROR_FILE_READ;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        LOG_INFO("Cannot stat file '%s': %s", path, strerror(errno));
+        close(fd);
+        return FAT_ERROR_FILE_READ;
+    }
+    source->fd = fd;
+    source->kind = kind_from_stat(&st);
+
+    if (source->kind == FILE_SOURCE_REGULAR) {
+        source->size = (uint64_t)st.st_size;
+    } else if (source->kind == FILE_SOURCE_BLOCK_DEVICE) {
+        block_device_geometry(fd, &source->size, &source->block_size);
+        if (direct && O_DIRECT != 0) {
+            // Some devices (and most file systems under a loop device) refuse O_DIRECT; buffered reads still work.
+            int direct_fd = open(path, O_RDONLY | O_DIRECT);
+            if (direct_fd >= 0) {
+                close(fd);
+                source->fd = direct_fd;
+                source->direct = true;
+            } else {
+                LOG_INFO("O_DIRECT refused for '%s' (%s), reading it through the page cache", path, strerror(errno));
+            }
+        }
+    }
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Hands the descriptor over to the caller, who becomes responsible for closing it.
+ */
+int file_source_release(FileSource* source) {
+    int fd = source->fd;
+    source->fd = -1;
+    return fd;
+}
+
+/**
+ * @brief Closes the source.
+ */
+void file_source_close(FileSource* source) {
+    if (source->fd >= 0) close(source->fd);
+    source->fd = -1;
+}
+
+// **Reading**
+
+/**
+ * @brief Reads with pread until the length is reached, the source ends, or a read fails.
+ */
+static FatResult pread_full(int fd, char* buffer, size_t length, uint64_t offset, size_t* read_count) {
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = pread(fd, buffer + done, length - done, (off_t)(offset + done));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            *read_count = done;
+            return FAT_ERROR_FILE_READ;
+        }
+        if (n == 0) break;
+        done += (size_t)n;
+    }
+    *read_count = done;
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Reads bytes at an offset of a regular file or block device.
+ */
+FatResult file_source_read_at(FileSource* source, void* buffer, size_t length, uint64_t offset, size_t* read_count) {
+    *read_count = 0;
+    if (source->kind == FILE_SOURCE_STREAM) return FAT_ERROR_UNSUPPORTED;
+    if (!source->direct) return pread_full(source->fd, buffer, length, offset, read_count);
+
+    // O_DIRECT wants the offset, the length and the buffer all aligned to the block size.
+    size_t block = source->block_size;
+    size_t span_limit = DIRECT_READ_SIZE < block ? block : DIRECT_READ_SIZE - DIRECT_READ_SIZE % block;
+    void* bounce = NULL;
+    if (posix_memalign(&bounce, block < sizeof(void*) ? sizeof(void*) : block, span_limit) != 0) {
+        return FAT_ERROR_MEMORY;
+    }
+
+    FatResult res = FAT_SUCCESS;
+    size_t done = 0;
+    while (done < length) {
+        uint64_t position = offset + done;
+        uint64_t aligned = position - position % block;
+        size_t skip = (size_t)(position - aligned);
+        size_t want = skip + (length - done);
+        size_t span = want > span_limit ? span_limit : (want + block - 1) / block * block;
+
+        size_t got = 0;
+        res = pread_full(source->fd, bounce, span, aligned, &got);
+        if (res != FAT_SUCCESS || got <= skip) break;
+        size_t useful = got - skip;
+        if (useful > length - done) useful = length - done;
+        memcpy((char*)buffer + done, (char*)bounce + skip, useful);
+        done += useful;
+        if (got < span) break;
+    }
+    free(bounce);
+    *read_count = done;
+    return res;
+}
+
+/**
+ * @brief Reads a source with a known size at once, up to a limit.
+ */
+static FatResult read_sized(FileSource* source, size_t limit, char** data, size_t* size, bool* truncated) {
+    size_t wanted = source->size > limit ? limit : (size_t)source->size;
+    char* buffer = malloc(wanted + 1);
+    if (!buffer) return FAT_ERROR_MEMORY;
+    size_t got = 0;
+    FatResult res = file_source_read_at(source, buffer, wanted, 0, &got);
+    if (res != FAT_SUCCESS && got == 0) {
+        free(buffer);
+        return res;
+    }
+    buffer[got] = '\0';
+    *data = buffer;
+    *size = got;
+    *truncated = source->size > limit;
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Reads a source into a heap buffer, up to a limit.
+ */
+FatResult file_source_read_all(FileSource* source, size_t limit, char** data, size_t* size, bool* truncated) {
+    bool more = false;
+    if (source->kind != FILE_SOURCE_STREAM && source->size > 0) {
+        FatResult res = read_sized(source, limit, data, size, &more);
+        if (res == FAT_SUCCESS && more) LOG_INFO("Read the first %zu bytes of a larger source; the rest is left out", *size);
+        if (truncated) *truncated = more;
+        return res;
+    }
+
+    char* buffer = NULL;
+    size_t used = 0;
+    size_t capacity = 0;
+    while (1) {
+        if (used == limit) {
+            // One more byte tells a source of exactly `limit` bytes from a longer one.
+            char probe;
+            ssize_t n = read(source->fd, &probe, 1);
+            if (n < 0 && errno == EINTR) continue;
+            more = n > 0;
+            break;
+        }
+        if (capacity - used < FILE_SOURCE_CHUNK_SIZE + 1) {
+            size_t new_capacity = capacity == 0 ? FILE_SOURCE_CHUNK_SIZE + 1 : capacity * 2;
+            if (new_capacity > limit + 1) new_capacity = limit + 1;
+            if (new_capacity > capacity) {
+                char* grown = realloc(buffer, new_capacity);
+                if (!grown) {
+                    free(buffer);
+                    return FAT_ERROR_MEMORY;
+                }
+                buffer = grown;
+                capacity = new_capacity;
+            }
+        }
+        size_t want = capacity - 1 - used;
+        if (want > FILE_SOURCE_CHUNK_SIZE) want = FILE_SOURCE_CHUNK_SIZE;
+        ssize_t n = read(source->fd, buffer + used, want);
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN) continue;
+            free(buffer);
+            return FAT_ERROR_FILE_READ;
+        }
+        if (n == 0) break;
+        used += (size_t)n;
+    }
+
+    if (!buffer) {
+        buffer = malloc(1);
+        if (!buffer) return FAT_ERROR_MEMORY;
+    }
+    if (more) LOG_INFO("Read the first %zu bytes of a stream that has more; the rest is left out", used);
+    buffer[used] = '\0';
+    *data = buffer;
+    *size = used;
+    if (truncated) *truncated = more;
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Opens a path, reads it whole up to a limit, and closes it.
+ */
+FatResult file_source_read_file(const char* path, size_t limit, char** data, size_t* size) {
+    FileSource source;
+    FatResult res = file_source_open(&source, path, false);
+    if (res != FAT_SUCCESS) return res;
+    size_t read_size = 0;
+    res = file_source_read_all(&source, limit, data, &read_size, NULL);
+    file_source_close(&source);
+    if (res == FAT_SUCCESS && size) *size = read_size;
+    return res;
+}
@@ -0,0 +1,347 @@
+/**
+ * @file hex_diff.c
+ * @author Zuhaitz (original)
+ * @brief Implements the binary diff, found by comparing the mapped files in the background.
+ */
+#include "core/hex_diff.h"
+#include "utils/logger.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// **Comparator**
+
+/**
+ * @brief Sets a bit for each byte of two 64-byte blocks that differs.
+ */
+static uint64_t compare_block(const unsigned char* a, const unsigned char* b) {
+#ifdef __SSE2__
+    uint64_t equal = 0;
+    for (int i = 0; i < 4; i++) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(a + 16 * i));
+        __m128i y = _mm_loadu_si128((const __m128i*)(b + 16 * i));
+        equal |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) << (16 * i);
+    }
+    return ~equal;
+#else
+    uint64_t differ = 0;
+    for (int i = 0; i < 64; i++) {
+        if (a[i] != b[i]) differ |= (uint64_t)1 << i;
+    }
+    return differ;
+#endif
+}
+
+// **Background Comparison**
+
+/**
+ * @struct RangeBatch
+ * @brief The ranges closed since the last publication, and the one still open.
+ */
+typedef struct {
+    HexDiffRange* ranges;
+    size_t count;
+    size_t capacity;
+    uint64_t start;             /**< Where the open range starts. */
+    uint64_t end;               /**< Just past the last differing byte of the open range. */
+    bool open;                  /**< True while a range is open. */
+    uint64_t differing;         /**< The differing bytes seen so far. */
+    bool failed;                /**< Set if a range could not be stored. */
+} RangeBatch;
+
+/**
+ * @brief Closes the open range into the batch.
+ */
+static void batch_close(RangeBatch* batch) {
+    if (!batch->open) return;
+    batch->open = false;
+    if (batch->count == batch->capacity) {
+        size_t new_capacity = batch->capacity ? batch->capacity * 2 : 256;
+        HexDiffRange* new_ranges = realloc(batch->ranges, new_capacity * sizeof(HexDiffRange));
+        if (!new_ranges) {
+            batch->failed = true;
+            return;
+        }
+        batch->ranges = new_ranges;
+        batch->capacity = new_capacity;
+    }
+    batch->ranges[batch->count].offset = batch->start;
+    batch->ranges[batch->count].length = batch->end - batch->start;
+    batch->count++;
+}
+
+/**
+ * @brief Adds a run of differing bytes, extending the open range if it is close enough.
+ */
+static void batch_add(RangeBatch* batch, uint64_t start, uint64_t end) {
+    batch->differing += end - start;
+    if (batch->open && start - batch->end <= HEX_DIFF_MERGE_GAP) {
+        batch->end = end;
+        return;
+    }
+    batch_close(batch);
+    batch->start = start;
+    batch->end = end;
+    batch->open = true;
+}
+
+/**
+ * @brief Adds the runs of set bits of a block's mask.
+ */
+static void track_block(RangeBatch* batch, uint64_t mask, uint64_t base) {
+    while (mask) {
+        int first = __builtin_ctzll(mask);
+        // The bits above the run are clear after the shift, unless the run reaches the top.
+        uint64_t rest = ~(mask >> first);
+        int length = rest ? __builtin_ctzll(rest) : 64;
+        batch_add(batch, base + (uint64_t)first, base + (uint64_t)first + (uint64_t)length);
+        if (first + length >= 64) break;
+        mask &= ~0ULL << (first + length);
+    }
+}
+
+/**
+ * @brief Hands the ranges closed so far to the UI thread.
+ * @return False if the comparison should stop.
+ */
+static bool publish(HexDiff* diff, RangeBatch* batch, uint64_t compared, size_t* total) {
+    size_t wanted = batch->count;
+    if (*total + wanted > HEX_DIFF_MAX_RANGES) wanted = HEX_DIFF_MAX_RANGES - *total;
+
+    pthread_mutex_lock(&diff->lock);
+    if (wanted > 0 && diff->found_count + wanted > diff->found_capacity) {
+        size_t new_capacity = diff->found_capacity ? diff->found_capacity : 256;
+        while (new_capacity < diff->found_count + wanted) new_capacity *= 2;
+        HexDiffRange* new_found = realloc(diff->found, new_capacity * sizeof(HexDiffRange));
+        if (new_found) {
+            diff->found = new_found;
+            diff->found_capacity = new_capacity;
+        } else {
+            batch->failed = true;
+        }
+    }
+    if (!batch->failed) {
+        memcpy(diff->found + diff->found_count, batch->ranges, wanted * sizeof(HexDiffRange));
+        diff->found_count += wanted;
+        *total += wanted;
+    }
+    diff->compared = compared;
+    diff->differing = batch->differing;
+    if (*total >= HEX_DIFF_MAX_RANGES) diff->truncated = true;
+    bool keep_going = !diff->cancel && !diff->truncated && !batch->failed;
+    pthread_mutex_unlock(&diff->lock);
+    batch->count = 0;
+    return keep_going;
+}
+
+/**
+ * @brief Compares the files 64 bytes at a time and collects the ranges where they differ.
+ *
+ * Past the end of the shorter file, the rest of the longer one is a single range.
+ */
+static void* hex_diff_worker(void* arg) {
+    HexDiff* diff = arg;
+    const unsigned char* a = (const unsigned char*)diff->a.bytes.data;
+    const unsigned char* b = (const unsigned char*)diff->b.bytes.data;
+    uint64_t size_a = diff->a.bytes.size;
+    uint64_t size_b = diff->b.bytes.size;
+    uint64_t common = size_a < size_b ? size_a : size_b;
+    uint64_t longest = size_a > size_b ? size_a : size_b;
+    RangeBatch batch = {0};
+    size_t total = 0;
+    bool keep_going = true;
+
+    uint64_t base = 0;
+    for (; base + 64 <= common && keep_going; base += 64) {
+        uint64_t mask = compare_block(a + base, b + base);
+        if (mask) track_block(&batch, mask, base);
+        if ((base + 64) % HEX_DIFF_PUBLISH_BYTES == 0) keep_going = publish(diff, &batch, base + 64, &total);
+    }
+    if (keep_going) {
+        for (; base < common; base++) {
+            if (a[base] != b[base]) batch_add(&batch, base, base + 1);
+        }
+        if (longest > common) batch_add(&batch, common, longest);
+        batch_close(&batch);
+        publish(diff, &batch, longest, &total);
+    }
+    free(batch.ranges);
+
+    pthread_mutex_lock(&diff->lock);
+    diff->finished = true;
+    pthread_mutex_unlock(&diff->lock);
+    LOG_INFO("Found %zu differing ranges in %llu bytes.", total, (unsigned long long)longest);
+    return NULL;
+}
+
+// **Public API**
+
+/**
+ * @brief Maps two files and starts comparing them in the background.
+ */
+FatResult hex_diff_start(HexDiff* diff, const char* path_a, const char* path_b, const HexLayout* layout) {
+    memset(diff, 0, sizeof(*diff));
+    // Two rows share the pane, so they always adapt to its width, and leave out the integer column.
+    // Holes stay in full, so that both sides keep showing the same offsets.
+    HexLayout side_layout = *layout;
+    side_layout.bytes_per_row = 0;
+    side_layout.endian = HEX_ENDIAN_NONE;
+    side_layout.collapse_holes = false;
+
+    diff->path_a = strdup(path_a);
+    diff->path_b = strdup(path_b);
+    if (!diff->path_a || !diff->path_b) {
+        free(diff->path_a);
+        free(diff->path_b);
+        return FAT_ERROR_MEMORY;
+    }
+    FatResult res = hex_view_open(&diff->a, path_a, &side_layout);
+    if (res == FAT_SUCCESS) {
+        res = hex_view_open(&diff->b, path_b, &side_layout);
+        if (res != FAT_SUCCESS) hex_view_free(&diff->a);
+    }
+    if (res != FAT_SUCCESS) {
+        free(diff->path_a);
+        free(diff->path_b);
+        memset(diff, 0, sizeof(*diff));
+        return res;
+    }
+
+    // Equal offsets print the same on both sides, so both rows are as wide.
+    int digits = diff->a.offset_digits > diff->b.offset_digits ? diff->a.offset_digits : diff->b.offset_digits;
+    diff->a.offset_digits = digits;
+    diff->b.offset_digits = digits;
+    diff->row_count = diff->a.row_count > diff->b.row_count ? diff->a.row_count : diff->b.row_count;
+
+    pthread_mutex_init(&diff->lock, NULL);
+    if (pthread_create(&diff->thread, NULL, hex_diff_worker, diff) == 0) {
+        diff->has_thread = true;
+    } else {
+        LOG_INFO("Could not start the binary diff thread; comparing on this one.");
+        hex_diff_worker(diff);
+        hex_diff_poll(diff);
+    }
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Picks the widest row that fits each side of the pane.
+ */
+bool hex_diff_fit(HexDiff* diff, int width) {
+    // Both views share their layout and offset digits, so they pick the same width.
+    bool changed = hex_view_fit(&diff->a, width);
+    hex_view_fit(&diff->b, width);
+    diff->row_count = diff->a.row_count > diff->b.row_count ? diff->a.row_count : diff->b.row_count;
+    return changed;
+}
+
+/**
+ * @brief Adopts the ranges found since the last call.
+ */
+bool hex_diff_poll(HexDiff* diff) {
+    if (diff->done) return false;
+    size_t old_count = diff->count;
+    uint64_t old_compared = diff->compared_done;
+
+    pthread_mutex_lock(&diff->lock);
+    if (diff->found_count > 0 && !diff->failed) {
+        if (diff->count + diff->found_count > diff->capacity) {
+            size_t new_capacity = diff->capacity ? diff->capacity : 256;
+            while (new_capacity < diff->count + diff->found_count) new_capacity *= 2;
+            HexDiffRange* new_ranges = realloc(diff->ranges, new_capacity * sizeof(HexDiffRange));
+            if (new_ranges) {
+                diff->ranges = new_ranges;
+                diff->capacity = new_capacity;
+            } else {
+                diff->failed = true;
+                diff->cancel = true;
+            }
+        }
+        if (!diff->failed) {
+            memcpy(diff->ranges + diff->count, diff->found, diff->found_count * sizeof(HexDiffRange));
+            diff->count += diff->found_count;
+            diff->found_count = 0;
+        }
+    }
+    diff->compared_done = diff->compared;
+    diff->differing_done = diff->differing;
+    diff->done = diff->failed || diff->finished;
+    pthread_mutex_unlock(&diff->lock);
+
+    return diff->count != old_count || diff->compared_done != old_compared || diff->done;
+}
+
+/**
+ * @brief Returns true until both files have been compared and every range adopted.
+ */
+bool hex_diff_is_running(const HexDiff* diff) {
+    return !diff->done;
+}
+
+/**
+ * @brief Finds the nearest range that starts past, or before, a file offset.
+ */
+bool hex_diff_find(const HexDiff* diff, uint64_t offset, bool forward, uint64_t* range_offset) {
+    // The first range starting at or after the offset.
+    size_t low = 0, high = diff->count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (diff->ranges[mid].offset < offset) low = mid + 1; else high = mid;
+    }
+    if (forward) {
+        if (low >= diff->count) return false;
+        *range_offset = diff->ranges[low].offset;
+    } else {
+        if (low == 0) return false;
+        *range_offset = diff->ranges[low - 1].offset;
+    }
+    return true;
+}
+
+/**
+ * @brief Returns true if the byte at an offset differs, or is only in one of the files.
+ */
+bool hex_diff_byte_differs(const HexDiff* diff, uint64_t offset) {
+    bool in_a = offset < diff->a.bytes.size;
+    bool in_b = offset < diff->b.bytes.size;
+    if (in_a != in_b) return true;
+    return in_a && diff->a.bytes.data[offset] != diff->b.bytes.data[offset];
+}
+
+/**
+ * @brief Returns the heap memory held by both files and the ranges.
+ */
+size_t hex_diff_memory_usage(HexDiff* diff) {
+    size_t usage = hex_view_memory_usage(&diff->a) + hex_view_memory_usage(&diff->b);
+    usage += diff->capacity * sizeof(HexDiffRange);
+    if (diff->path_a) {
+        pthread_mutex_lock(&diff->lock);
+        usage += diff->found_capacity * sizeof(HexDiffRange);
+        pthread_mutex_unlock(&diff->lock);
+    }
+    return usage;
+}
+
+/**
+ * @brief Stops the background comparison, unmaps both files and frees the ranges.
+ */
+void hex_diff_free(HexDiff* diff) {
+    if (!diff) return;
+    if (diff->has_thread) {
+        pthread_mutex_lock(&diff->lock);
+        diff->cancel = true;
+        pthread_mutex_unlock(&diff->lock);
+        pthread_join(diff->thread, NULL);
+    }
+    if (diff->path_a) pthread_mutex_destroy(&diff->lock);
+    free(diff->found);
+    free(diff->ranges);
+    hex_view_free(&diff->a);
+    hex_view_free(&diff->b);
+    free(diff->path_a);
+    free(diff->path_b);
+    memset(diff, 0, sizeof(*diff));
+}
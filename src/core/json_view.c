@@ -0,0 +1,528 @@
+/**
+ * @file json_view.c
+ * @author Zuhaitz (original)
+ * @brief Implements the structural index and the lazily expanded JSON tree.
+ */
+#include "core/json_view.h"
+#include "utils/logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/** @brief The deepest indentation drawn, in nesting levels. */
+#define JSON_MAX_INDENT_LEVELS 64
+
+/** @brief How much of a collapsed container is previewed, in source bytes. */
+#define JSON_PREVIEW_BYTES 160
+
+/** @brief The size of the render buffer: indentation, the row and room for a short suffix. */
+#define JSON_SCRATCH_SIZE (JSON_MAX_INDENT_LEVELS * 2 + JSON_ROW_MAX_BYTES + 64)
+
+/** @brief The UTF-8 ellipsis appended to cut rows. */
+#define JSON_ELLIPSIS "\xe2\x80\xa6"
+
+// **Detection**
+
+/**
+ * @brief Returns true if a file should be shown as JSON.
+ */
+bool json_view_detect(const char* path, const char* mime) {
+    if (mime && (strcmp(mime, "application/json") == 0 || strcmp(mime, "application/x-ndjson") == 0 ||
+                 strcmp(mime, "application/geo+json") == 0)) {
+        return true;
+    }
+    const char* dot = path ? strrchr(path, '.') : NULL;
+    if (!dot || strchr(dot, '/')) return false;
+    return strcasecmp(dot, ".json") == 0 || strcasecmp(dot, ".jsonl") == 0 ||
+           strcasecmp(dot, ".ndjson") == 0 || strcasecmp(dot, ".geojson") == 0;
+}
+
+// **Stage 1: Structural Index**
+
+/**
+ * @struct BlockMasks
+ * @brief Per-byte classification of one 64-byte block, one bit per byte.
+ */
+typedef struct {
+    uint64_t backslash;
+    uint64_t quote;
+    uint64_t structural;
+} BlockMasks;
+
+/**
+ * @brief Classifies the bytes of a 64-byte block.
+ */
+static void classify_block(const unsigned char* block, BlockMasks* masks) {
+#ifdef __SSE2__
+    masks->backslash = masks->quote = masks->structural = 0;
+    for (int i = 0; i < 64; i += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(block + i));
+        uint64_t backslash = (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\\')));
+        uint64_t quote = (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('"')));
+        __m128i brackets = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('{')), _mm_cmpeq_epi8(bytes, _mm_set1_epi8('}'))),
+            _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('[')), _mm_cmpeq_epi8(bytes, _mm_set1_epi8(']'))));
+        __m128i structural = _mm_or_si128(brackets,
+            _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(':')), _mm_cmpeq_epi8(bytes, _mm_set1_epi8(','))));
+        masks->backslash |= backslash << i;
+        masks->quote |= quote << i;
+        masks->structural |= (uint64_t)(uint16_t)_mm_movemask_epi8(structural) << i;
+    }
+#else
+    uint64_t backslash = 0, quote = 0, structural = 0;
+    for (int i = 0; i < 64; i++) {
+        unsigned char c = block[i];
+        backslash |= (uint64_t)(c == '\\') << i;
+        quote |= (uint64_t)(c == '"') << i;
+        structural |= (uint64_t)(c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',') << i;
+    }
+    masks->backslash = backslash;
+    masks->quote = quote;
+    masks->structural = structural;
+#endif
+}
+
+/**
+ * @brief Returns the bytes preceded by an odd number of backslashes, i.e. the escaped ones.
+ *
+ * `carry` is 1 if the previous block ended in an odd-length run of backslashes.
+ */
+static uint64_t find_escaped(uint64_t backslash, uint64_t* carry) {
+    const uint64_t even_bits = 0x5555555555555555ULL;
+    const uint64_t odd_bits = ~even_bits;
+
+    uint64_t starts = backslash & ~(backslash << 1);
+    uint64_t even_start_mask = even_bits ^ *carry;
+    uint64_t even_starts = starts & even_start_mask;
+    uint64_t odd_starts = starts & ~even_start_mask;
+
+    uint64_t even_carries = backslash + even_starts;
+    uint64_t odd_carries = backslash + odd_starts;
+    bool overflow = odd_carries < backslash;
+    odd_carries |= *carry;
+    *carry = overflow ? 1 : 0;
+
+    uint64_t even_carry_ends = even_carries & ~backslash;
+    uint64_t odd_carry_ends = odd_carries & ~backslash;
+    return (even_carry_ends & odd_bits) | (odd_carry_ends & even_bits);
+}
+
+/**
+ * @brief Returns a mask with every bit set from an odd-numbered quote up to the next one.
+ */
+static uint64_t prefix_xor(uint64_t bits) {
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+/**
+ * @brief Marks the structural characters outside strings, 64 bytes at a time.
+ */
+static FatResult build_structural_index(JsonView* view) {
+    const unsigned char* data = (const unsigned char*)view->text.data;
+    size_t size = view->text.size;
+    view->word_count = (size + 63) / 64;
+    view->structural = calloc(view->word_count ? view->word_count : 1, sizeof(uint64_t));
+    if (!view->structural) return FAT_ERROR_MEMORY;
+
+    uint64_t escape_carry = 0;
+    uint64_t in_string_carry = 0;
+    unsigned char tail[64];
+    for (size_t word = 0; word < view->word_count; word++) {
+        const unsigned char* block = data + word * 64;
+        if (size - word * 64 < 64) {
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, block, size - word * 64);
+            block = tail;
+        }
+        BlockMasks masks;
+        classify_block(block, &masks);
+        uint64_t quotes = masks.quote & ~find_escaped(masks.backslash, &escape_carry);
+        uint64_t in_string = prefix_xor(quotes) ^ in_string_carry;
+        in_string_carry = (uint64_t)((int64_t)in_string >> 63);
+        view->structural[word] = masks.structural & ~in_string;
+    }
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Returns the first structural character at or after `pos`, or the file size if none.
+ */
+static uint64_t next_structural(const JsonView* view, uint64_t pos) {
+    size_t size = view->text.size;
+    if (pos >= size) return size;
+    size_t word = (size_t)(pos / 64);
+    uint64_t bits = view->structural[word] & (~0ULL << (pos % 64));
+    while (bits == 0) {
+        if (++word >= view->word_count) return size;
+        bits = view->structural[word];
+    }
+    uint64_t found = (uint64_t)word * 64 + (uint64_t)__builtin_ctzll(bits);
+    return found < size ? found : size;
+}
+
+/**
+ * @brief Returns the first byte at or after `pos` that is not JSON whitespace.
+ */
+static uint64_t skip_whitespace(const JsonView* view, uint64_t pos) {
+    const char* data = view->text.data;
+    while (pos < view->text.size && (data[pos] == ' ' || data[pos] == '\n' || data[pos] == '\r' || data[pos] == '\t')) pos++;
+    return pos;
+}
+
+/**
+ * @brief Finds the bracket closing a container and counts its children.
+ * @return The position of the closing bracket, or the file size if the container is not closed.
+ */
+static uint64_t find_close(const JsonView* view, uint64_t open, uint32_t* items) {
+    const char* data = view->text.data;
+    uint64_t first = skip_whitespace(view, open + 1);
+    uint32_t count = (first < view->text.size && data[first] != '}' && data[first] != ']') ? 1 : 0;
+    size_t depth = 0;
+    uint64_t pos = open;
+    while ((pos = next_structural(view, pos + 1)) < view->text.size) {
+        char c = data[pos];
+        if (c == '{' || c == '[') {
+            depth++;
+        } else if (c == '}' || c == ']') {
+            if (depth == 0) break;
+            depth--;
+        } else if (c == ',' && depth == 0 && count < UINT32_MAX) {
+            count++;
+        }
+    }
+    *items = count;
+    return pos;
+}
+
+/**
+ * @brief Returns where the value of a row starts: after the colon for members, else the row itself.
+ */
+static uint64_t value_offset(const JsonView* view, const JsonRow* row) {
+    if (!(row->flags & JSON_ROW_MEMBER)) return row->offset;
+    uint64_t colon = next_structural(view, row->offset);
+    return skip_whitespace(view, colon + 1);
+}
+
+/**
+ * @brief Returns the end of a top-level scalar: past a string's closing quote, else at the next delimiter.
+ */
+static uint64_t scalar_end(const JsonView* view, uint64_t pos) {
+    const char* data = view->text.data;
+    size_t size = view->text.size;
+    if (pos < size && data[pos] == '"') {
+        for (pos++; pos < size && data[pos] != '"'; pos++) {
+            if (data[pos] == '\\') pos++;
+        }
+        return pos < size ? pos + 1 : size;
+    }
+    while (pos < size && data[pos] != ' ' && data[pos] != '\n' && data[pos] != '\r' && data[pos] != '\t' &&
+           data[pos] != '{' && data[pos] != '[' && data[pos] != '"') {
+        pos++;
+    }
+    return pos;
+}
+
+// **Rows**
+
+/**
+ * @brief Appends a row to a row array, growing it as needed.
+ */
+static FatResult push_row(JsonRow** rows, size_t* count, size_t* capacity, JsonRow row) {
+    if (*count == *capacity) {
+        size_t new_capacity = *capacity ? *capacity * 2 : 64;
+        JsonRow* new_rows = realloc(*rows, new_capacity * sizeof(JsonRow));
+        if (!new_rows) return FAT_ERROR_MEMORY;
+        *rows = new_rows;
+        *capacity = new_capacity;
+    }
+    (*rows)[(*count)++] = row;
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Fills in the container fields of a row whose value starts at `value`.
+ * @return The position just after the value's closing bracket.
+ */
+static uint64_t describe_container(const JsonView* view, JsonRow* row, uint64_t value) {
+    uint64_t close = find_close(view, value, &row->items);
+    uint64_t span = close < view->text.size ? close - value + 1 : close - value;
+    row->flags |= JSON_ROW_CONTAINER;
+    row->span = span > UINT32_MAX ? UINT32_MAX : (uint32_t)span;
+    return close < view->text.size ? close + 1 : close;
+}
+
+/**
+ * @brief Lists the children of the container opened at `open`, followed by its closing row.
+ */
+static FatResult list_children(const JsonView* view, uint64_t open, uint16_t depth,
+                               JsonRow** rows, size_t* count, size_t* capacity) {
+    const char* data = view->text.data;
+    size_t size = view->text.size;
+    bool is_object = data[open] == '{';
+    uint16_t child_depth = depth < UINT16_MAX ? depth + 1 : depth;
+
+    uint64_t pos = skip_whitespace(view, open + 1);
+    while (pos < size && data[pos] != '}' && data[pos] != ']') {
+        JsonRow row = { .offset = pos, .depth = child_depth, .flags = is_object ? JSON_ROW_MEMBER : 0 };
+        uint64_t value = value_offset(view, &row);
+        if (value >= size) break;
+
+        uint64_t after = value;
+        if (data[value] == '{' || data[value] == '[') after = describe_container(view, &row, value);
+        if (push_row(rows, count, capacity, row) != FAT_SUCCESS) return FAT_ERROR_MEMORY;
+
+        uint64_t separator = next_structural(view, after);
+        if (separator >= size || data[separator] != ',') {
+            pos = separator;
+            break;
+        }
+        pos = skip_whitespace(view, separator + 1);
+    }
+
+    // Unterminated containers are closed at the end of the file.
+    uint64_t close = pos < size ? pos : (size > 0 ? size - 1 : 0);
+    JsonRow close_row = { .offset = close, .depth = depth, .flags = JSON_ROW_CLOSE };
+    return push_row(rows, count, capacity, close_row);
+}
+
+/**
+ * @brief Inserts rows after `index`.
+ */
+static FatResult insert_rows(JsonView* view, size_t index, const JsonRow* rows, size_t count) {
+    if (view->row_count + count > view->row_capacity) {
+        size_t new_capacity = view->row_capacity ? view->row_capacity : 64;
+        while (new_capacity < view->row_count + count) new_capacity *= 2;
+        JsonRow* new_rows = realloc(view->rows, new_capacity * sizeof(JsonRow));
+        if (!new_rows) return FAT_ERROR_MEMORY;
+        view->rows = new_rows;
+        view->row_capacity = new_capacity;
+    }
+    memmove(view->rows + index + 1 + count, view->rows + index + 1, (view->row_count - index - 1) * sizeof(JsonRow));
+    memcpy(view->rows + index + 1, rows, count * sizeof(JsonRow));
+    view->row_count += count;
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Lists the top-level values. There is usually one, but NDJSON has one per line.
+ */
+static FatResult list_top_level(JsonView* view) {
+    const char* data = view->text.data;
+    size_t size = view->text.size;
+    uint64_t pos = skip_whitespace(view, 0);
+    while (pos < size) {
+        JsonRow row = { .offset = pos };
+        uint64_t next;
+        if (data[pos] == '{' || data[pos] == '[') {
+            next = describe_container(view, &row, pos);
+        } else {
+            next = scalar_end(view, pos);
+            if (next == pos) next = pos + 1; // A stray bracket or separator
+        }
+        if (push_row(&view->rows, &view->row_count, &view->row_capacity, row) != FAT_SUCCESS) return FAT_ERROR_MEMORY;
+        pos = skip_whitespace(view, next);
+        if (pos < size && data[pos] == ',') pos = skip_whitespace(view, pos + 1);
+    }
+    view->value_count = view->row_count;
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Opens a file and builds its structural index.
+ */
+FatResult json_view_open(JsonView* view, const char* path) {
+    memset(view, 0, sizeof(*view));
+    FatResult res = line_index_load(&view->text, path);
+    if (res != FAT_SUCCESS) return res;
+
+    view->scratch = malloc(JSON_SCRATCH_SIZE);
+    if (!view->scratch) res = FAT_ERROR_MEMORY;
+    if (res == FAT_SUCCESS) res = build_structural_index(view);
+    if (res == FAT_SUCCESS) res = list_top_level(view);
+    if (res == FAT_SUCCESS && view->row_count == 1 && (view->rows[0].flags & JSON_ROW_CONTAINER)) {
+        size_t row = 0;
+        res = json_view_toggle(view, &row);
+    }
+    if (res != FAT_SUCCESS) {
+        json_view_free(view);
+        return res;
+    }
+    LOG_INFO("Indexed JSON '%s': %zu top-level values", path, view->value_count);
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Expands a collapsed container or collapses an expanded one.
+ */
+FatResult json_view_toggle(JsonView* view, size_t* row) {
+    if (*row >= view->row_count) return FAT_ERROR_UNSUPPORTED;
+    size_t index = *row;
+
+    if (view->rows[index].flags & JSON_ROW_CLOSE) {
+        uint16_t depth = view->rows[index].depth;
+        while (index > 0) {
+            index--;
+            if (view->rows[index].depth == depth && !(view->rows[index].flags & JSON_ROW_CLOSE)) break;
+        }
+    }
+    JsonRow* target = &view->rows[index];
+    if (!(target->flags & JSON_ROW_CONTAINER)) return FAT_ERROR_UNSUPPORTED;
+    *row = index;
+
+    if (target->flags & JSON_ROW_EXPANDED) {
+        size_t end = index + 1;
+        while (end < view->row_count &&
+               !(view->rows[end].depth == target->depth && (view->rows[end].flags & JSON_ROW_CLOSE))) {
+            end++;
+        }
+        if (end < view->row_count) end++;
+        memmove(view->rows + index + 1, view->rows + end, (view->row_count - end) * sizeof(JsonRow));
+        view->row_count -= end - index - 1;
+        target->flags &= (uint8_t)~JSON_ROW_EXPANDED;
+        return FAT_SUCCESS;
+    }
+
+    JsonRow* children = NULL;
+    size_t count = 0, capacity = 0;
+    FatResult res = list_children(view, value_offset(view, target), target->depth, &children, &count, &capacity);
+    if (res == FAT_SUCCESS) res = insert_rows(view, index, children, count);
+    free(children);
+    if (res == FAT_SUCCESS) view->rows[index].flags |= JSON_ROW_EXPANDED;
+    return res;
+}
+
+// **Rendering**
+
+/**
+ * @brief Appends JSON source bytes with the whitespace outside strings removed.
+ * @return The number of source bytes consumed.
+ */
+static size_t append_compact(char* out, size_t* len, size_t limit, const char* src, size_t src_len) {
+    bool in_string = false;
+    size_t i = 0;
+    for (; i < src_len && *len < limit; i++) {
+        char c = src[i];
+        if (in_string) {
+            if (c == '\\' && i + 1 < src_len && *len + 1 < limit) {
+                out[(*len)++] = c;
+                c = src[++i];
+            } else if (c == '"') {
+                in_string = false;
+            }
+        } else if (c == '"') {
+            in_string = true;
+        } else if (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+            continue;
+        }
+        out[(*len)++] = (c == '\n' || c == '\r' || c == '\t') ? ' ' : c;
+    }
+    return i;
+}
+
+/**
+ * @brief Renders a row of the tree.
+ */
+const char* json_view_get_row(const JsonView* view, size_t row, size_t* len) {
+    *len = 0;
+    if (row >= view->row_count) return NULL;
+    const JsonRow* r = &view->rows[row];
+    const char* data = view->text.data;
+    char* out = view->scratch;
+    size_t n = 0;
+
+    size_t indent = (r->depth < JSON_MAX_INDENT_LEVELS ? r->depth : JSON_MAX_INDENT_LEVELS) * 2;
+    memset(out, ' ', indent);
+    n = indent;
+    size_t limit = indent + JSON_ROW_MAX_BYTES;
+
+    if (r->flags & JSON_ROW_CLOSE) {
+        out[n++] = data[r->offset];
+        *len = n;
+        return out;
+    }
+
+    uint64_t value = value_offset(view, r);
+    if (r->flags & JSON_ROW_MEMBER) {
+        // The key runs up to the colon, minus any whitespace before it.
+        uint64_t key_end = next_structural(view, r->offset);
+        while (key_end > r->offset && (data[key_end - 1] == ' ' || data[key_end - 1] == '\t' ||
+                                       data[key_end - 1] == '\n' || data[key_end - 1] == '\r')) {
+            key_end--;
+        }
+        size_t key_len = (size_t)(key_end - r->offset);
+        if (key_len > JSON_ROW_MAX_BYTES / 2) key_len = JSON_ROW_MAX_BYTES / 2;
+        memcpy(out + n, data + r->offset, key_len);
+        n += key_len;
+        out[n++] = ':';
+        out[n++] = ' ';
+    }
+    if (value >= view->text.size) {
+        *len = n;
+        return out;
+    }
+
+    if (r->flags & JSON_ROW_EXPANDED) {
+        out[n++] = data[value];
+    } else if (r->flags & JSON_ROW_CONTAINER) {
+        // A collapsed container is previewed in compact form, cut short if it is long.
+        size_t preview = r->span < JSON_PREVIEW_BYTES ? r->span : JSON_PREVIEW_BYTES;
+        size_t consumed = append_compact(out, &n, limit, data + value, preview);
+        if (consumed < r->span) {
+            const char* unit = data[value] == '{' ? "keys" : "items";
+            int written = snprintf(out + n, JSON_SCRATCH_SIZE - n, JSON_ELLIPSIS "%c  (%u %s)",
+                                   data[value] == '{' ? '}' : ']', r->items, unit);
+            if (written > 0) n += (size_t)written < JSON_SCRATCH_SIZE - n ? (size_t)written : JSON_SCRATCH_SIZE - n - 1;
+        }
+    } else {
+        // Top-level scalars are delimited by whitespace, nested ones by the next structural character.
+        uint64_t end = r->depth == 0 ? scalar_end(view, value) : next_structural(view, value);
+        while (end > value && (data[end - 1] == ' ' || data[end - 1] == '\t' || data[end - 1] == '\n' || data[end - 1] == '\r')) {
+            end--;
+        }
+        size_t value_len = (size_t)(end - value);
+        bool cut = value_len > limit - n;
+        if (cut) value_len = limit - n;
+        memcpy(out + n, data + value, value_len);
+        n += value_len;
+        if (cut) {
+            memcpy(out + n, JSON_ELLIPSIS, 3);
+            n += 3;
+        }
+    }
+    *len = n;
+    return out;
+}
+
+/**
+ * @brief Returns the heap memory held by the view.
+ */
+size_t json_view_memory_usage(const JsonView* view) {
+    size_t usage = line_index_memory_usage(&view->text);
+    usage += view->word_count * sizeof(uint64_t);
+    usage += view->row_capacity * sizeof(JsonRow);
+    if (view->scratch) usage += JSON_SCRATCH_SIZE;
+    return usage;
+}
+
+/**
+ * @brief Frees the view.
+ */
+void json_view_free(JsonView* view) {
+    if (!view) return;
+    line_index_free(&view->text);
+    free(view->structural);
+    free(view->rows);
+    free(view->scratch);
+    memset(view, 0, sizeof(*view));
+}
@@ -0,0 +1,339 @@
+/**
+ * @file line_cache.c
+ * @author Zuhaitz (original)
+ * @brief Implements the on-disk cache of line indexes for huge text files.
+ *
+ * A sidecar is a fixed header of little-endian 64-bit fields followed by
+ * the distance from each line start to the next, as LEB128 varints. Lines
+ * are rarely longer than 127 bytes, so most offsets take a single byte.
+ */
+#include "core/line_cache.h"
+#include "core/config.h"
+#include "utils/logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
+#ifndef _WIN32
+
+/** @brief Identifies a sidecar and the version of its layout. */
+#define SIDECAR_MAGIC "FATLIDX1"
+
+/** @brief The number of 64-bit fields after the magic. */
+#define HEADER_FIELDS 10
+
+/** @brief The size of the sidecar header in bytes. */
+#define HEADER_SIZE (8 + HEADER_FIELDS * 8)
+
+/** @brief The number of bytes hashed at each end of the covered data. */
+#define HASH_BYTES 4096
+
+/** @brief The size of the buffer varints are written through. */
+#define WRITE_BUFFER_SIZE (64 * 1024)
+
+/** @brief The longest sidecar path: the configuration directory and "/cache/lines/<dev>-<ino>.lidx". */
+#define SIDECAR_PATH_MAX (PATH_MAX + 64)
+
+/**
+ * @struct SidecarHeader
+ * @brief The identity of the indexed file and the shape of the payload.
+ */
+typedef struct {
+    uint64_t dev, ino;          /**< The file the sidecar belongs to. */
+    uint64_t size;              /**< The file size when it was indexed. */
+    int64_t mtime_sec;          /**< The modification time when it was indexed. */
+    int64_t mtime_nsec;
+    uint64_t count;             /**< The number of line offsets. */
+    uint64_t max_line_len;      /**< The longest line when it was indexed. */
+    uint64_t head_hash;         /**< FNV-1a of the first HASH_BYTES bytes. */
+    uint64_t tail_hash;         /**< FNV-1a of the last HASH_BYTES bytes up to `size`. */
+    uint64_t payload_len;       /**< The number of varint bytes that follow. */
+} SidecarHeader;
+
+/**
+ * @brief Hashes a byte range with 64-bit FNV-1a.
+ */
+static uint64_t hash_bytes(const char* data, size_t len) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+/** @brief Hashes the start of the first `size` bytes of the data. */
+static uint64_t head_hash(const char* data, size_t size) {
+    return hash_bytes(data, size < HASH_BYTES ? size : HASH_BYTES);
+}
+
+/** @brief Hashes the end of the first `size` bytes of the data. */
+static uint64_t tail_hash(const char* data, size_t size) {
+    size_t len = size < HASH_BYTES ? size : HASH_BYTES;
+    return hash_bytes(data + size - len, len);
+}
+
+/**
+ * @brief Builds the path of the sidecar of a file, creating the cache directory.
+ * @return False if there is no configuration directory or the path does not fit, in which case nothing is cached.
+ */
+static bool sidecar_path(const struct stat* st, char* out, size_t size, bool create) {
+    char config_dir[PATH_MAX];
+    if (get_config_dir(config_dir, sizeof(config_dir)) != 0) return false;
+    if (create) {
+        int n = snprintf(out, size, "%s/cache", config_dir);
+        if (n < 0 || (size_t)n >= size) return false;
+        mkdir(out, S_IRWXU);
+        n = snprintf(out, size, "%s/cache/lines", config_dir);
+        if (n < 0 || (size_t)n >= size) return false;
+        mkdir(out, S_IRWXU);
+    }
+    int n = snprintf(out, size, "%s/cache/lines/%llx-%llx.lidx", config_dir,
+                     (unsigned long long)st->st_dev, (unsigned long long)st->st_ino);
+    return n > 0 && (size_t)n < size;
+}
+
+/** @brief Writes a 64-bit field in little-endian order. */
+static void put_u64(unsigned char* p, uint64_t value) {
+    for (int i = 0; i < 8; i++) p[i] = (unsigned char)(value >> (i * 8));
+}
+
+/** @brief Reads a 64-bit little-endian field. */
+static uint64_t get_u64(const unsigned char* p) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) value = value << 8 | p[i];
+    return value;
+}
+
+/**
+ * @brief Reads and decodes a sidecar header.
+ */
+static bool read_header(FILE* file, SidecarHeader* h) {
+    unsigned char buf[HEADER_SIZE];
+    if (fread(buf, 1, sizeof(buf), file) != sizeof(buf) || memcmp(buf, SIDECAR_MAGIC, 8) != 0) return false;
+    uint64_t fields[HEADER_FIELDS];
+    for (int i = 0; i < HEADER_FIELDS; i++) fields[i] = get_u64(buf + 8 + i * 8);
+    h->dev = fields[0];
+    h->ino = fields[1];
+    h->size = fields[2];
+    h->mtime_sec = (int64_t)fields[3];
+    h->mtime_nsec = (int64_t)fields[4];
+    h->count = fields[5];
+    h->max_line_len = fields[6];
+    h->head_hash = fields[7];
+    h->tail_hash = fields[8];
+    h->payload_len = fields[9];
+    return true;
+}
+
+/**
+ * @brief Returns the nanoseconds of a file's modification time, where the platform has them.
+ */
+static int64_t mtime_nsec(const struct stat* st) {
+#if defined(__APPLE__)
+    return (int64_t)st->st_mtimespec.tv_nsec;
+#else
+    return (int64_t)st->st_mtim.tv_nsec;
+#endif
+}
+
+/**
+ * @brief Restores the line offsets of a loaded file from its sidecar.
+ */
+bool line_cache_restore(LineIndex* index, const char* path, size_t* resume) {
+    if (!index->is_mapped || index->size < LINE_CACHE_MIN_SIZE) return false;
+    struct stat st;
+    char sidecar[SIDECAR_PATH_MAX];
+    if (stat(path, &st) != 0 || (uint64_t)st.st_size != index->size || !sidecar_path(&st, sidecar, sizeof(sidecar), false)) {
+        return false;
+    }
+    FILE* file = fopen(sidecar, "rb");
+    if (!file) return false;
+
+    SidecarHeader h;
+    bool ok = read_header(file, &h) && h.dev == (uint64_t)st.st_dev && h.ino == (uint64_t)st.st_ino &&
+              h.size > 0 && h.size <= index->size && h.count > 0 && h.count <= h.size &&
+              h.payload_len >= h.count && h.payload_len <= h.count * 10;
+    bool unchanged = ok && h.size == index->size && h.mtime_sec == (int64_t)st.st_mtime && h.mtime_nsec == mtime_nsec(&st);
+    // A grown file is only trusted if the bytes the sidecar covered are still there.
+    if (ok && !unchanged) {
+        ok = h.size < index->size && h.head_hash == head_hash(index->data, (size_t)h.size) &&
+             h.tail_hash == tail_hash(index->data, (size_t)h.size);
+    }
+
+    unsigned char* payload = NULL;
+    size_t* offsets = NULL;
+    if (ok) {
+        payload = malloc((size_t)h.payload_len);
+        offsets = malloc((size_t)h.count * sizeof(size_t));
+        ok = payload && offsets && fread(payload, 1, (size_t)h.payload_len, file) == h.payload_len;
+    }
+    fclose(file);
+
+    // Decode the deltas, checking that every offset stays inside the covered bytes.
+    size_t pos = 0, count = 0;
+    uint64_t offset = 0;
+    while (ok && count < h.count) {
+        uint64_t delta = 0;
+        int shift = 0;
+        while (pos < h.payload_len && shift < 64) {
+            unsigned char b = payload[pos++];
+            delta |= (uint64_t)(b & 0x7f) << shift;
+            shift += 7;
+            if (!(b & 0x80)) break;
+        }
+        offset += delta;
+        if ((count == 0 && offset != 0) || (count > 0 && delta == 0) || offset >= h.size) {
+            ok = false;
+            break;
+        }
+        offsets[count++] = (size_t)offset;
+    }
+    free(payload);
+    if (!ok) {
+        free(offsets);
+        return false;
+    }
+
+    free(index->offsets);
+    index->offsets = offsets;
+    index->count = count;
+    index->capacity = count;
+    index->max_line_len = (size_t)h.max_line_len;
+    if (unchanged) {
+        *resume = index->size;
+    } else {
+        // The last cached line may have been extended by the append.
+        index->count--;
+        *resume = offsets[index->count];
+    }
+    LOG_INFO("Restored %zu line offsets of '%s' from its index cache%s", index->count, path,
+             unchanged ? "" : ", indexing the appended data");
+    return true;
+}
+
+/**
+ * @brief Removes the least recently written sidecars beyond LINE_CACHE_MAX_FILES.
+ */
+static void prune_sidecars(const char* dir_path) {
+    while (1) {
+        DIR* dir = opendir(dir_path);
+        if (!dir) return;
+        size_t count = 0;
+        char oldest[SIDECAR_PATH_MAX + NAME_MAX + 2] = "";
+        time_t oldest_time = 0;
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != NULL) {
+            size_t len = strlen(entry->d_name);
+            if (len < 5 || strcmp(entry->d_name + len - 5, ".lidx") != 0) continue;
+            char entry_path[SIDECAR_PATH_MAX + NAME_MAX + 2];
+            struct stat st;
+            int n = snprintf(entry_path, sizeof(entry_path), "%s/%s", dir_path, entry->d_name);
+            if (n < 0 || (size_t)n >= sizeof(entry_path) || stat(entry_path, &st) != 0) continue;
+            count++;
+            if (oldest[0] == '\0' || st.st_mtime < oldest_time) {
+                memcpy(oldest, entry_path, (size_t)n + 1);
+                oldest_time = st.st_mtime;
+            }
+        }
+        closedir(dir);
+        if (count <= LINE_CACHE_MAX_FILES || unlink(oldest) != 0) return;
+    }
+}
+
+/**
+ * @brief Saves the line offsets of a file to its sidecar, if the file is large enough.
+ */
+void line_cache_save(const LineIndex* index, const char* path) {
+    if (!index->is_built || !index->is_mapped || index->size < LINE_CACHE_MIN_SIZE || index->count == 0) return;
+    struct stat st;
+    char sidecar[SIDECAR_PATH_MAX], temp_path[SIDECAR_PATH_MAX + 32];
+    if (stat(path, &st) != 0 || (uint64_t)st.st_size != index->size || !sidecar_path(&st, sidecar, sizeof(sidecar), true)) {
+        return;
+    }
+    int n = snprintf(temp_path, sizeof(temp_path), "%s.%ld.tmp", sidecar, (long)getpid());
+    if (n < 0 || (size_t)n >= sizeof(temp_path)) return;
+
+    FILE* file = fopen(temp_path, "wb");
+    if (!file) {
+        LOG_INFO("Could not write the index cache of '%s'", path);
+        return;
+    }
+    unsigned char* buffer = malloc(WRITE_BUFFER_SIZE);
+    bool ok = buffer != NULL;
+
+    // Reserve the header; its payload length is only known at the end.
+    unsigned char header[HEADER_SIZE] = {0};
+    ok = ok && fwrite(header, 1, sizeof(header), file) == sizeof(header);
+
+    uint64_t payload_len = 0;
+    size_t used = 0;
+    size_t previous = 0;
+    for (size_t i = 0; ok && i < index->count; i++) {
+        uint64_t delta = index->offsets[i] - previous;
+        previous = index->offsets[i];
+        do {
+            unsigned char b = delta & 0x7f;
+            delta >>= 7;
+            buffer[used++] = b | (delta ? 0x80 : 0);
+        } while (delta);
+        if (used > WRITE_BUFFER_SIZE - 10) {
+            ok = fwrite(buffer, 1, used, file) == used;
+            payload_len += used;
+            used = 0;
+        }
+    }
+    if (ok && used > 0) {
+        ok = fwrite(buffer, 1, used, file) == used;
+        payload_len += used;
+    }
+    free(buffer);
+
+    if (ok) {
+        uint64_t fields[HEADER_FIELDS] = {
+            (uint64_t)st.st_dev, (uint64_t)st.st_ino, (uint64_t)index->size,
+            (uint64_t)st.st_mtime, (uint64_t)mtime_nsec(&st), (uint64_t)index->count,
+            (uint64_t)index->max_line_len, head_hash(index->data, index->size),
+            tail_hash(index->data, index->size), payload_len
+        };
+        memcpy(header, SIDECAR_MAGIC, 8);
+        for (int i = 0; i < HEADER_FIELDS; i++) put_u64(header + 8 + i * 8, fields[i]);
+        ok = fseek(file, 0, SEEK_SET) == 0 && fwrite(header, 1, sizeof(header), file) == sizeof(header);
+    }
+    ok = fclose(file) == 0 && ok;
+    if (!ok || rename(temp_path, sidecar) != 0) {
+        LOG_INFO("Could not write the index cache of '%s'", path);
+        unlink(temp_path);
+        return;
+    }
+
+    char* slash = strrchr(sidecar, '/');
+    if (slash) *slash = '\0';
+    prune_sidecars(sidecar);
+}
+
+#else
+
+// Windows has no stable inode numbers to key sidecars by, so nothing is cached.
+
+bool line_cache_restore(LineIndex* index, const char* path, size_t* resume) {
+    (void)index;
+    (void)path;
+    (void)resume;
+    return false;
+}
+
+void line_cache_save(const LineIndex* index, const char* path) {
+    (void)index;
+    (void)path;
+}
+
+#endif
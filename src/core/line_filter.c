@@ -0,0 +1,595 @@
+/**
+ * @file line_filter.c
+ * @author Zuhaitz (original)
+ * @brief Implements the filter expression parser, matcher and worker pool.
+ */
+#include "core/line_filter.h"
+#include "utils/logger.h"
+#include "utils/utils.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <unistd.h>
+
+/** @brief The number of lines a worker evaluates per claim. */
+#define FILTER_CHUNK_LINES 65536
+
+// **Parsing**
+
+/**
+ * @enum TokenKind
+ * @brief The tokens of the filter language.
+ */
+typedef enum {
+    TOKEN_END,
+    TOKEN_TERM,
+    TOKEN_AND,
+    TOKEN_OR,
+    TOKEN_NOT,
+    TOKEN_LPAREN,
+    TOKEN_RPAREN
+} TokenKind;
+
+/**
+ * @struct Parser
+ * @brief The state of a recursive-descent parse.
+ */
+typedef struct {
+    const char* p;          /**< The next unread character. */
+    TokenKind token;        /**< The current token. */
+    FilterNode* term;       /**< The node built for a TOKEN_TERM. */
+    char* error;
+    size_t error_size;
+    FatResult status;       /**< The first failure, if any. */
+} Parser;
+
+/**
+ * @brief Records the first failure of a parse.
+ */
+static void parse_fail(Parser* parser, FatResult status, const char* message) {
+    if (parser->status != FAT_SUCCESS) return;
+    parser->status = status;
+    if (parser->error && parser->error_size > 0) {
+        snprintf(parser->error, parser->error_size, "%s", message);
+    }
+}
+
+/**
+ * @brief Allocates a node of the given kind.
+ */
+static FilterNode* new_node(Parser* parser, FilterNodeKind kind, FilterNode* left, FilterNode* right) {
+    FilterNode* node = calloc(1, sizeof(FilterNode));
+    if (!node) {
+        parse_fail(parser, FAT_ERROR_MEMORY, "Out of memory.");
+        filter_node_free(left);
+        filter_node_free(right);
+        return NULL;
+    }
+    node->kind = kind;
+    node->left = left;
+    node->right = right;
+    return node;
+}
+
+/**
+ * @brief Returns true for characters that end a bare word.
+ */
+static bool is_word_end(char c) {
+    return c == '\0' || isspace((unsigned char)c) || c == '(' || c == ')' || c == '&' || c == '|';
+}
+
+/**
+ * @brief Reads a double-quoted string starting at the opening quote. `\"` and `\\` are unescaped.
+ * @return The length of the unescaped text written to `out`, or (size_t)-1 if the quote is not closed.
+ */
+static size_t read_quoted(Parser* parser, char* out) {
+    size_t len = 0;
+    parser->p++; // Opening quote
+    while (*parser->p && *parser->p != '"') {
+        if (*parser->p == '\\' && (parser->p[1] == '"' || parser->p[1] == '\\')) parser->p++;
+        out[len++] = *parser->p++;
+    }
+    if (*parser->p != '"') return (size_t)-1;
+    parser->p++; // Closing quote
+    return len;
+}
+
+/**
+ * @brief Returns the length of a field name at the start of a word, or 0 if the word is not `key=value`.
+ */
+static size_t field_key_length(const char* word, size_t len) {
+    size_t i = 0;
+    while (i < len && (isalnum((unsigned char)word[i]) || word[i] == '_' || word[i] == '.' || word[i] == '-')) i++;
+    return (i > 0 && i < len && word[i] == '=') ? i : 0;
+}
+
+/**
+ * @brief Reads a quoted or bare word and builds its TEXT or FIELD node.
+ */
+static void read_term(Parser* parser) {
+    // Unescaping never makes a word longer than its source.
+    char* buffer = malloc(strlen(parser->p) + 1);
+    if (!buffer) {
+        parse_fail(parser, FAT_ERROR_MEMORY, "Out of memory.");
+        return;
+    }
+
+    size_t len = 0;
+    bool quoted = *parser->p == '"';
+    if (quoted) {
+        len = read_quoted(parser, buffer);
+        if (len == (size_t)-1) {
+            free(buffer);
+            parse_fail(parser, FAT_ERROR_INVALID_ARGUMENT, "Missing closing quote.");
+            return;
+        }
+    } else {
+        while (!is_word_end(*parser->p)) {
+            // `key="quoted value"` keeps the value in one word.
+            if (*parser->p == '"' && len > 0 && buffer[len - 1] == '=') {
+                size_t value_len = read_quoted(parser, buffer + len);
+                if (value_len == (size_t)-1) {
+                    free(buffer);
+                    parse_fail(parser, FAT_ERROR_INVALID_ARGUMENT, "Missing closing quote.");
+                    return;
+                }
+                len += value_len;
+                continue;
+            }
+            buffer[len++] = *parser->p++;
+        }
+    }
+    buffer[len] = '\0';
+
+    if (!quoted && len > 0) {
+        const char* keywords[] = { "AND", "OR", "NOT" };
+        const TokenKind kinds[] = { TOKEN_AND, TOKEN_OR, TOKEN_NOT };
+        for (size_t i = 0; i < 3; i++) {
+            if (strcmp(buffer, keywords[i]) == 0) {
+                free(buffer);
+                parser->token = kinds[i];
+                return;
+            }
+        }
+    }
+
+    FilterNode* node = new_node(parser, FILTER_NODE_TEXT, NULL, NULL);
+    if (!node) {
+        free(buffer);
+        return;
+    }
+    size_t key_len = quoted ? 0 : field_key_length(buffer, len);
+    if (key_len > 0) {
+        node->kind = FILTER_NODE_FIELD;
+        node->key = strndup(buffer, key_len);
+        node->key_len = key_len;
+        node->text = strdup(buffer + key_len + 1);
+        node->text_len = len - key_len - 1;
+        free(buffer);
+    } else {
+        node->text = buffer;
+        node->text_len = len;
+    }
+    if (!node->text || (key_len > 0 && !node->key)) {
+        filter_node_free(node);
+        parse_fail(parser, FAT_ERROR_MEMORY, "Out of memory.");
+        return;
+    }
+    if (node->kind == FILTER_NODE_TEXT && node->text_len == 0) {
+        filter_node_free(node);
+        parse_fail(parser, FAT_ERROR_INVALID_ARGUMENT, "Empty search term.");
+        return;
+    }
+    parser->term = node;
+    parser->token = TOKEN_TERM;
+}
+
+/**
+ * @brief Advances to the next token.
+ */
+static void next_token(Parser* parser) {
+    while (isspace((unsigned char)*parser->p)) parser->p++;
+    char c = *parser->p;
+    switch (c) {
+        case '\0': parser->token = TOKEN_END; return;
+        case '(': parser->p++; parser->token = TOKEN_LPAREN; return;
+        case ')': parser->p++; parser->token = TOKEN_RPAREN; return;
+        case '!': parser->p++; parser->token = TOKEN_NOT; return;
+        case '&':
+        case '|':
+            parser->p++;
+            if (*parser->p == c) parser->p++;
+            parser->token = c == '&' ? TOKEN_AND : TOKEN_OR;
+            return;
+        default:
+            parser->token = TOKEN_END;
+            read_term(parser);
+            return;
+    }
+}
+
+static FilterNode* parse_or(Parser* parser);
+
+/**
+ * @brief unary := ("!" | "NOT") unary | "(" or ")" | term
+ */
+static FilterNode* parse_unary(Parser* parser) {
+    if (parser->status != FAT_SUCCESS) return NULL;
+    switch (parser->token) {
+        case TOKEN_NOT: {
+            next_token(parser);
+            FilterNode* operand = parse_unary(parser);
+            if (!operand) return NULL;
+            return new_node(parser, FILTER_NODE_NOT, operand, NULL);
+        }
+        case TOKEN_LPAREN: {
+            next_token(parser);
+            FilterNode* inner = parse_or(parser);
+            if (!inner) return NULL;
+            if (parser->token != TOKEN_RPAREN) {
+                filter_node_free(inner);
+                parse_fail(parser, FAT_ERROR_INVALID_ARGUMENT, "Missing closing parenthesis.");
+                return NULL;
+            }
+            next_token(parser);
+            return inner;
+        }
+        case TOKEN_TERM: {
+            FilterNode* term = parser->term;
+            parser->term = NULL;
+            next_token(parser);
+            return term;
+        }
+        case TOKEN_END:
+            parse_fail(parser, FAT_ERROR_INVALID_ARGUMENT, "Expression ends too early.");
+            return NULL;
+        default:
+            parse_fail(parser, FAT_ERROR_INVALID_ARGUMENT, "Expected a term.");
+            return NULL;
+    }
+}
+
+/**
+ * @brief and := unary (["&" | "AND"] unary)*
+ */
+static FilterNode* parse_and(Parser* parser) {
+    FilterNode* left = parse_unary(parser);
+    while (left && parser->status == FAT_SUCCESS) {
+        if (parser->token == TOKEN_AND) {
+            next_token(parser);
+        } else if (parser->token != TOKEN_TERM && parser->token != TOKEN_NOT && parser->token != TOKEN_LPAREN) {
+            break;
+        }
+        FilterNode* right = parse_unary(parser);
+        if (!right) {
+            filter_node_free(left);
+            return NULL;
+        }
+        left = new_node(parser, FILTER_NODE_AND, left, right);
+    }
+    return left;
+}
+
+/**
+ * @brief or := and (("|" | "OR") and)*
+ */
+static FilterNode* parse_or(Parser* parser) {
+    FilterNode* left = parse_and(parser);
+    while (left && parser->status == FAT_SUCCESS && parser->token == TOKEN_OR) {
+        next_token(parser);
+        FilterNode* right = parse_and(parser);
+        if (!right) {
+            filter_node_free(left);
+            return NULL;
+        }
+        left = new_node(parser, FILTER_NODE_OR, left, right);
+    }
+    return left;
+}
+
+FatResult filter_parse(const char* text, FilterNode** out, char* error, size_t error_size) {
+    if (!text || !out) return FAT_ERROR_INVALID_ARGUMENT;
+    *out = NULL;
+    if (error && error_size > 0) error[0] = '\0';
+
+    Parser parser = { .p = text, .error = error, .error_size = error_size, .status = FAT_SUCCESS };
+    next_token(&parser);
+    FilterNode* root = parse_or(&parser);
+    if (root && parser.status == FAT_SUCCESS && parser.token != TOKEN_END) {
+        parse_fail(&parser, FAT_ERROR_INVALID_ARGUMENT,
+                   parser.token == TOKEN_RPAREN ? "Unexpected closing parenthesis." : "Unexpected operator.");
+    }
+    filter_node_free(parser.term);
+    if (parser.status != FAT_SUCCESS) {
+        filter_node_free(root);
+        return parser.status;
+    }
+    *out = root;
+    return FAT_SUCCESS;
+}
+
+void filter_node_free(FilterNode* node) {
+    if (!node) return;
+    filter_node_free(node->left);
+    filter_node_free(node->right);
+    free(node->key);
+    free(node->text);
+    free(node);
+}
+
+// **Matching**
+
+/**
+ * @brief Compares two byte ranges, ignoring ASCII case.
+ */
+static bool equals_ignore_case(const char* a, size_t a_len, const char* b, size_t b_len) {
+    if (a_len != b_len) return false;
+    for (size_t i = 0; i < a_len; i++) {
+        if (tolower((unsigned char)a[i]) != tolower((unsigned char)b[i])) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Tests one occurrence of a field name: `key=value`, `key="value"`, `"key": value` or `"key": "value"`.
+ */
+static bool field_value_matches(const FilterNode* node, const char* line, size_t len, size_t key_start) {
+    size_t pos = key_start + node->key_len;
+    bool json = key_start > 0 && line[key_start - 1] == '"';
+
+    // The name must start at a word boundary.
+    size_t before = json ? key_start - 1 : key_start;
+    if (before > 0) {
+        char c = line[before - 1];
+        if (isalnum((unsigned char)c) || c == '_' || c == '.' || c == '-') return false;
+    }
+
+    if (json) {
+        if (pos >= len || line[pos] != '"') return false;
+        pos++;
+        while (pos < len && line[pos] == ' ') pos++;
+        if (pos >= len || line[pos] != ':') return false;
+        pos++;
+        while (pos < len && line[pos] == ' ') pos++;
+    } else {
+        if (pos >= len || line[pos] != '=') return false;
+        pos++;
+    }
+
+    size_t value_start = pos;
+    size_t value_end;
+    if (pos < len && line[pos] == '"') {
+        value_start = ++pos;
+        while (pos < len && line[pos] != '"') {
+            if (line[pos] == '\\' && pos + 1 < len) pos++;
+            pos++;
+        }
+        value_end = pos;
+    } else {
+        while (pos < len && !isspace((unsigned char)line[pos]) && line[pos] != ',' && line[pos] != '}') pos++;
+        value_end = pos;
+    }
+    return equals_ignore_case(line + value_start, value_end - value_start, node->text, node->text_len);
+}
+
+/**
+ * @brief Returns true if any occurrence of the field name carries the wanted value.
+ */
+static bool field_matches(const FilterNode* node, const char* line, size_t len) {
+    size_t offset = 0;
+    while (offset < len) {
+        const char* found = find_bytes(line + offset, len - offset, node->key, node->key_len);
+        if (!found) return false;
+        size_t key_start = (size_t)(found - line);
+        if (field_value_matches(node, line, len, key_start)) return true;
+        offset = key_start + 1;
+    }
+    return false;
+}
+
+bool filter_matches(const FilterNode* node, const char* line, size_t len) {
+    if (!node) return true;
+    if (!line) len = 0;
+    switch (node->kind) {
+        case FILTER_NODE_TEXT:
+            return find_bytes(line, len, node->text, node->text_len) != NULL;
+        case FILTER_NODE_FIELD:
+            return field_matches(node, line, len);
+        case FILTER_NODE_AND:
+            return filter_matches(node->left, line, len) && filter_matches(node->right, line, len);
+        case FILTER_NODE_OR:
+            return filter_matches(node->left, line, len) || filter_matches(node->right, line, len);
+        case FILTER_NODE_NOT:
+            return !filter_matches(node->left, line, len);
+    }
+    return false;
+}
+
+// **Worker Pool**
+
+/**
+ * @brief Returns true once the filter is being freed or has failed.
+ */
+static bool is_cancelled(LineFilter* filter) {
+    pthread_mutex_lock(&filter->lock);
+    bool cancel = filter->cancel;
+    pthread_mutex_unlock(&filter->lock);
+    return cancel;
+}
+
+/**
+ * @brief Claims chunks and records the matching line numbers of each.
+ */
+static void* filter_worker(void* arg) {
+    LineFilter* filter = arg;
+    while (true) {
+        pthread_mutex_lock(&filter->lock);
+        if (filter->cancel || filter->next_chunk >= filter->chunk_count) {
+            pthread_mutex_unlock(&filter->lock);
+            break;
+        }
+        size_t chunk = filter->next_chunk++;
+        pthread_mutex_unlock(&filter->lock);
+
+        size_t first = chunk * FILTER_CHUNK_LINES;
+        size_t last = first + FILTER_CHUNK_LINES;
+        if (last > filter->source_count) last = filter->source_count;
+
+        size_t* matches = NULL;
+        size_t count = 0;
+        size_t capacity = 0;
+        bool failed = false;
+        for (size_t i = first; i < last; i++) {
+            // Cancellation is checked between lines so freeing a huge filter stays quick.
+            if ((i & 4095) == 0 && is_cancelled(filter)) break;
+            size_t len = 0;
+            const char* line = filter->get_line(filter->source, i, &len);
+            if (!filter_matches(filter->expr, line, len)) continue;
+            if (count == capacity) {
+                size_t new_capacity = capacity ? capacity * 2 : 256;
+                size_t* new_matches = realloc(matches, new_capacity * sizeof(size_t));
+                if (!new_matches) {
+                    failed = true;
+                    break;
+                }
+                matches = new_matches;
+                capacity = new_capacity;
+            }
+            matches[count++] = i;
+        }
+
+        pthread_mutex_lock(&filter->lock);
+        filter->chunk_lines[chunk] = matches;
+        filter->chunk_matches[chunk] = count;
+        filter->chunk_done[chunk] = true;
+        if (failed) {
+            filter->failed = true;
+            filter->cancel = true;
+        }
+        pthread_mutex_unlock(&filter->lock);
+    }
+    return NULL;
+}
+
+FatResult line_filter_start(LineFilter* filter, const char* text, FilterLineGetter get_line,
+                            const void* source, size_t source_size, size_t line_count,
+                            char* error, size_t error_size) {
+    if (!filter || !text || !get_line) return FAT_ERROR_INVALID_ARGUMENT;
+    memset(filter, 0, sizeof(*filter));
+
+    FatResult res = filter_parse(text, &filter->expr, error, error_size);
+    if (res != FAT_SUCCESS) return res;
+
+    filter->text = strdup(text);
+    filter->source = malloc(source_size ? source_size : 1);
+    filter->chunk_count = (line_count + FILTER_CHUNK_LINES - 1) / FILTER_CHUNK_LINES;
+    size_t slots = filter->chunk_count ? filter->chunk_count : 1;
+    filter->chunk_lines = calloc(slots, sizeof(size_t*));
+    filter->chunk_matches = calloc(slots, sizeof(size_t));
+    filter->chunk_done = calloc(slots, sizeof(bool));
+    if (!filter->text || !filter->source || !filter->chunk_lines || !filter->chunk_matches || !filter->chunk_done) {
+        filter_node_free(filter->expr);
+        free(filter->text);
+        free(filter->source);
+        free(filter->chunk_lines);
+        free(filter->chunk_matches);
+        free(filter->chunk_done);
+        memset(filter, 0, sizeof(*filter));
+        return FAT_ERROR_MEMORY;
+    }
+    memcpy(filter->source, source, source_size);
+    filter->get_line = get_line;
+    filter->source_count = line_count;
+    pthread_mutex_init(&filter->lock, NULL);
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int wanted = cpus > 0 ? (int)cpus : 1;
+    if (wanted > FILTER_MAX_THREADS) wanted = FILTER_MAX_THREADS;
+    if ((size_t)wanted > filter->chunk_count) wanted = (int)filter->chunk_count;
+
+    for (int i = 0; i < wanted; i++) {
+        if (pthread_create(&filter->threads[filter->thread_count], NULL, filter_worker, filter) != 0) {
+            LOG_INFO("Could not start filter thread %d.", i);
+            break;
+        }
+        filter->thread_count++;
+    }
+    if (filter->thread_count == 0 && filter->chunk_count > 0) {
+        // No thread to hand the work to; evaluate everything now.
+        filter_worker(filter);
+    }
+    return FAT_SUCCESS;
+}
+
+bool line_filter_poll(LineFilter* filter) {
+    if (!filter || !filter->text) return false;
+    size_t old_count = filter->count;
+
+    pthread_mutex_lock(&filter->lock);
+    while (filter->adopted_chunks < filter->chunk_count && filter->chunk_done[filter->adopted_chunks]) {
+        size_t chunk = filter->adopted_chunks;
+        size_t matches = filter->chunk_matches[chunk];
+        if (filter->count + matches > filter->capacity) {
+            size_t new_capacity = filter->capacity ? filter->capacity : 1024;
+            while (new_capacity < filter->count + matches) new_capacity *= 2;
+            size_t* new_lines = realloc(filter->lines, new_capacity * sizeof(size_t));
+            if (!new_lines) {
+                filter->failed = true;
+                filter->cancel = true;
+                break;
+            }
+            filter->lines = new_lines;
+            filter->capacity = new_capacity;
+        }
+        if (matches > 0) {
+            memcpy(filter->lines + filter->count, filter->chunk_lines[chunk], matches * sizeof(size_t));
+        }
+        filter->count += matches;
+        free(filter->chunk_lines[chunk]);
+        filter->chunk_lines[chunk] = NULL;
+        filter->adopted_chunks++;
+    }
+    if (filter->cancel && filter->adopted_chunks < filter->chunk_count) {
+        // A failed filter is shown as far as it got.
+        filter->chunk_count = filter->adopted_chunks;
+    }
+    pthread_mutex_unlock(&filter->lock);
+
+    return filter->count != old_count;
+}
+
+bool line_filter_is_running(const LineFilter* filter) {
+    return filter && filter->text && filter->adopted_chunks < filter->chunk_count;
+}
+
+size_t line_filter_scanned(const LineFilter* filter) {
+    if (!filter || !filter->text) return 0;
+    if (filter->adopted_chunks >= filter->chunk_count) return filter->source_count;
+    return filter->adopted_chunks * FILTER_CHUNK_LINES;
+}
+
+void line_filter_free(LineFilter* filter) {
+    if (!filter || !filter->text) return;
+    if (filter->thread_count > 0) {
+        pthread_mutex_lock(&filter->lock);
+        filter->cancel = true;
+        pthread_mutex_unlock(&filter->lock);
+        for (int i = 0; i < filter->thread_count; i++) {
+            pthread_join(filter->threads[i], NULL);
+        }
+    }
+    pthread_mutex_destroy(&filter->lock);
+    // `chunk_count` may have been cut short by a failure, so free every slot that was allocated.
+    for (size_t i = 0; i < filter->next_chunk; i++) {
+        free(filter->chunk_lines[i]);
+    }
+    free(filter->chunk_lines);
+    free(filter->chunk_matches);
+    free(filter->chunk_done);
+    free(filter->lines);
+    filter_node_free(filter->expr);
+    free(filter->source);
+    free(filter->text);
+    memset(filter, 0, sizeof(*filter));
+}
@@ -0,0 +1,626 @@
+/**
+ * @file line_index.c
+ * @author Zuhaitz (original)
+ * @brief Implements the memory-mapped line index for text files.
+ */
+#define _GNU_SOURCE // For SEEK_DATA and SEEK_HOLE
+#include "core/line_index.h"
+#include "core/line_cache.h"
+#include "core/file_source.h"
+#include "core/read_pipeline.h"
+#include "core/map_guard.h"
+#include "utils/logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+/** @brief The pages sampled to tell whether a file is already in the page cache. */
+#define RESIDENCY_SAMPLES 256
+
+/** @brief The number of file bytes converted to UTF-8 at a time. */
+#define TRANSCODE_CHUNK_SIZE (1024 * 1024)
+
+/**
+ * @brief Initializes a LineIndex to a safe, empty state.
+ */
+void line_index_init(LineIndex* index) {
+    memset(index, 0, sizeof(*index));
+}
+
+/**
+ * @brief Records the holes of a mapped file, as the file system reports them.
+ *
+ * File systems without holes report the whole file as data, and those that
+ * cannot tell at all fail the first seek; either way no hole is recorded.
+ */
+static void find_holes(LineIndex* index, int fd) {
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+    off_t size = (off_t)index->size;
+    off_t pos = 0;
+    size_t capacity = 0;
+    while (pos < size && index->hole_count < LINE_INDEX_MAX_HOLES) {
+        off_t hole = lseek(fd, pos, SEEK_HOLE);
+        if (hole < 0 || hole >= size) break;
+        off_t data = lseek(fd, hole, SEEK_DATA);
+        if (data < 0 || data > size) data = size; // The hole runs to the end of the file
+        if (data - hole >= LINE_INDEX_MIN_HOLE) {
+            if (index->hole_count == capacity) {
+                size_t new_capacity = capacity ? capacity * 2 : 16;
+                FileHole* new_holes = realloc(index->holes, new_capacity * sizeof(FileHole));
+                if (!new_holes) break;
+                index->holes = new_holes;
+                capacity = new_capacity;
+            }
+            index->holes[index->hole_count].offset = (size_t)hole;
+            index->holes[index->hole_count].length = (size_t)(data - hole);
+            index->hole_count++;
+        }
+        pos = data;
+    }
+    if (index->hole_count > 0) LOG_INFO("Found %zu holes in a sparse file.", index->hole_count);
+#else
+    (void)index;
+    (void)fd;
+#endif
+}
+
+/**
+ * @brief Maps or reads a file without indexing its lines.
+ */
+FatResult line_index_load(LineIndex* index, const char* path) {
+    line_index_init(index);
+
+    FileSource source;
+    FatResult res = file_source_open(&source, path, false);
+    if (res != FAT_SUCCESS) return res;
+
+#ifndef _WIN32
+    // Block devices map like files once the kernel has told their size.
+    if (source.kind != FILE_SOURCE_STREAM && source.size > 0 && source.size <= SIZE_MAX) {
+        void* map = mmap(NULL, (size_t)source.size, PROT_READ, MAP_PRIVATE, source.fd, 0);
+        if (map != MAP_FAILED) {
+            index->data = map;
+            index->size = (size_t)source.size;
+            index->is_mapped = true;
+            index->map_size = index->size;
+            if (source.kind == FILE_SOURCE_REGULAR) {
+                // A regular file can be cut short under the mapping, by a log rotation for one.
+                map_guard_add(map, index->map_size);
+                find_holes(index, source.fd);
+            }
+        } else {
+            LOG_INFO("mmap failed for '%s' (%s), reading it instead", path, strerror(errno));
+        }
+    }
+#endif
+
+    if (!index->is_mapped) {
+        if (source.kind == FILE_SOURCE_BLOCK_DEVICE) {
+            // A long read of a whole device should not push everything else out of the page cache.
+            file_source_close(&source);
+            res = file_source_open(&source, path, true);
+            if (res != FAT_SUCCESS) return res;
+        }
+        res = file_source_read_all(&source, FILE_SOURCE_READ_LIMIT, &index->data, &index->size, NULL);
+        if (res != FAT_SUCCESS) {
+            LOG_INFO("Error reading from file '%s': %s", path, strerror(errno));
+            file_source_close(&source);
+            return res;
+        }
+    }
+    file_source_close(&source);
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Appends the offset of a line.
+ */
+static bool add_line(LineIndex* index, size_t pos) {
+    if (index->count >= index->capacity) {
+        size_t new_capacity = (index->capacity == 0) ? 1024 : index->capacity * 2;
+        size_t* new_offsets = realloc(index->offsets, new_capacity * sizeof(size_t));
+        if (!new_offsets) {
+            LOG_INFO("realloc failed in line_index_build");
+            return false;
+        }
+        index->offsets = new_offsets;
+        index->capacity = new_capacity;
+    }
+    index->offsets[index->count++] = pos;
+    return true;
+}
+
+/**
+ * @brief Appends the offsets of the lines starting at or after `pos`.
+ */
+static FatResult scan_lines(LineIndex* index, size_t pos) {
+    const char* data = index->data;
+    // The holes are those of the file, not of the text converted from it.
+    size_t hole_count = index->raw ? 0 : index->hole_count;
+    size_t hole = line_index_find_hole(index->holes, hole_count, pos);
+    while (pos < index->size) {
+        if (!add_line(index, pos)) return FAT_ERROR_MEMORY;
+
+        // Holes hold no line breaks, so the search jumps over them rather than faulting in their zeros.
+        const char* newline = NULL;
+        size_t from = pos;
+        while (!newline && from < index->size) {
+            while (hole < hole_count && index->holes[hole].offset + index->holes[hole].length <= from) hole++;
+            if (hole < hole_count && index->holes[hole].offset <= from) {
+                from = index->holes[hole].offset + index->holes[hole].length;
+                continue;
+            }
+            size_t until = hole < hole_count ? index->holes[hole].offset : index->size;
+            newline = memchr(data + from, '\n', until - from);
+            from = until;
+        }
+        size_t end = newline ? (size_t)(newline - data) : index->size;
+        if (end - pos > index->max_line_len) index->max_line_len = end - pos;
+        pos = end + 1;
+    }
+    return FAT_SUCCESS;
+}
+
+/**
+ * @struct LineScan
+ * @brief A line index being extended from the blocks of a read pipeline scan.
+ */
+typedef struct {
+    LineIndex* index;
+    size_t line_start;      /**< Where the line being read started. */
+    bool failed;            /**< Set if an offset could not be stored. */
+} LineScan;
+
+/**
+ * @brief Read pipeline consumer: records the lines that start in a block.
+ */
+static bool index_block(void* ctx, const char* data, size_t size, uint64_t offset) {
+    LineScan* scan = ctx;
+    LineIndex* index = scan->index;
+    // Bytes the file gained after it was mapped are not part of the index.
+    if (offset >= index->size) return false;
+    if (size > index->size - offset) size = index->size - (size_t)offset;
+
+    const char* end = data + size;
+    for (const char* p = data; p < end;) {
+        const char* newline = memchr(p, '\n', (size_t)(end - p));
+        if (!newline) break;
+        size_t at = (size_t)offset + (size_t)(newline - data);
+        if (at - scan->line_start > index->max_line_len) index->max_line_len = at - scan->line_start;
+        scan->line_start = at + 1;
+        if (scan->line_start < index->size && !add_line(index, scan->line_start)) {
+            scan->failed = true;
+            return false;
+        }
+        p = newline + 1;
+    }
+    return true;
+}
+
+/**
+ * @brief Returns true if nearly all of a mapped file past `pos` is already in the page cache.
+ *
+ * A sample of pages is asked of mincore(); reading such a file again would
+ * only copy it.
+ */
+static bool mostly_cached(const LineIndex* index, size_t pos) {
+#ifndef _WIN32
+    long page = sysconf(_SC_PAGESIZE);
+    if (page <= 0) return false;
+    size_t step = (index->size - pos) / RESIDENCY_SAMPLES;
+    size_t resident = 0;
+    for (size_t i = 0; i < RESIDENCY_SAMPLES; i++) {
+        size_t at = pos + i * step;
+        unsigned char vec = 0;
+        if (mincore(index->data + at - at % (size_t)page, 1, &vec) == 0 && (vec & 1)) resident++;
+    }
+    return resident * 10 >= RESIDENCY_SAMPLES * 9;
+#else
+    (void)index;
+    (void)pos;
+    return false;
+#endif
+}
+
+/**
+ * @brief Appends the offsets of the lines starting at or after `pos`, reading large files through the read pipeline.
+ *
+ * The pipeline keeps several large reads in flight where walking the
+ * mapping would fault the pages in one readahead window at a time, and
+ * lets other scans of the file share the pass. Files with holes are walked
+ * through the mapping, which skips them, and so are files already cached.
+ */
+static FatResult index_lines(LineIndex* index, const char* path, size_t pos) {
+    if (!index->is_mapped || index->hole_count > 0 || index->size - pos < READ_PIPELINE_MIN_SIZE ||
+        mostly_cached(index, pos)) {
+        return scan_lines(index, pos);
+    }
+
+    size_t count = index->count;
+    size_t max_line_len = index->max_line_len;
+    LineScan scan = { index, pos, false };
+    if (!add_line(index, pos)) return FAT_ERROR_MEMORY;
+    ReadConsumer consumer = { index_block, &scan, false };
+    FatResult res = read_pipeline_scan(path, pos, &consumer, 1);
+    if (res == FAT_SUCCESS && !scan.failed && scan.line_start <= index->size) {
+        if (scan.line_start < index->size && index->size - scan.line_start > index->max_line_len) {
+            index->max_line_len = index->size - scan.line_start;
+        }
+        return FAT_SUCCESS;
+    }
+    if (scan.failed) return FAT_ERROR_MEMORY;
+
+    LOG_INFO("Could not read '%s' through the read pipeline (%s); walking its mapping", path, fat_result_to_string(res));
+    index->count = count;
+    index->max_line_len = max_line_len;
+    return scan_lines(index, pos);
+}
+
+// **Conversion to UTF-8**
+
+/**
+ * @struct TranscodeSink
+ * @brief Where converted text is collected: the heap up to a limit, then a temporary file.
+ */
+typedef struct {
+    char* heap;             /**< The text so far, while it fits under the limit. */
+    size_t used;            /**< The number of bytes of text. */
+    size_t capacity;        /**< The number of bytes allocated for `heap`. */
+    int spill_fd;           /**< The temporary file the text went to, or -1. */
+} TranscodeSink;
+
+/**
+ * @brief Writes a whole buffer to a file descriptor.
+ */
+static FatResult write_all(int fd, const char* data, size_t size) {
+    size_t written = 0;
+    while (written < size) {
+        ssize_t n = write(fd, data + written, size - written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            LOG_INFO("Could not write converted text to the spill file: %s", strerror(errno));
+            return FAT_ERROR_FILE_WRITE;
+        }
+        written += (size_t)n;
+    }
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Moves the text gathered on the heap to a new temporary file.
+ */
+static FatResult sink_spill(TranscodeSink* sink) {
+    const char* tmp_dir = getenv("TMPDIR");
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/fat-text-XXXXXX", tmp_dir && *tmp_dir ? tmp_dir : "/tmp");
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        LOG_INFO("Could not create a spill file for converted text: %s", strerror(errno));
+        return FAT_ERROR_FILE_WRITE;
+    }
+    // The file lives on only through its descriptor and then its mapping, so nothing is left behind.
+    unlink(path);
+    FatResult res = write_all(fd, sink->heap, sink->used);
+    if (res != FAT_SUCCESS) {
+        close(fd);
+        return res;
+    }
+    free(sink->heap);
+    sink->heap = NULL;
+    sink->capacity = 0;
+    sink->spill_fd = fd;
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Appends converted text to the sink.
+ */
+static FatResult sink_append(TranscodeSink* sink, const char* data, size_t size) {
+#ifndef _WIN32
+    if (sink->spill_fd < 0 && sink->used + size > LINE_INDEX_TRANSCODE_HEAP_LIMIT) {
+        FatResult res = sink_spill(sink);
+        if (res != FAT_SUCCESS) return res;
+    }
+#endif
+    if (sink->spill_fd >= 0) {
+        FatResult res = write_all(sink->spill_fd, data, size);
+        if (res == FAT_SUCCESS) sink->used += size;
+        return res;
+    }
+
+    if (sink->capacity - sink->used < size + 1) {
+        size_t new_capacity = sink->capacity ? sink->capacity : TRANSCODE_CHUNK_SIZE;
+        while (new_capacity - sink->used < size + 1) new_capacity *= 2;
+        char* grown = realloc(sink->heap, new_capacity);
+        if (!grown) return FAT_ERROR_MEMORY;
+        sink->heap = grown;
+        sink->capacity = new_capacity;
+    }
+    memcpy(sink->heap + sink->used, data, size);
+    sink->used += size;
+    sink->heap[sink->used] = '\0';
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Hands the collected text over, mapping it back if it was spilled.
+ */
+static FatResult sink_finish(TranscodeSink* sink, char** data, size_t* size, bool* is_mapped) {
+    *size = sink->used;
+    *is_mapped = false;
+#ifndef _WIN32
+    if (sink->spill_fd >= 0) {
+        void* map = mmap(NULL, sink->used, PROT_READ, MAP_PRIVATE, sink->spill_fd, 0);
+        close(sink->spill_fd);
+        sink->spill_fd = -1;
+        if (map == MAP_FAILED) {
+            LOG_INFO("Could not map the converted text: %s", strerror(errno));
+            return FAT_ERROR_MEMORY;
+        }
+        *data = map;
+        *is_mapped = true;
+        return FAT_SUCCESS;
+    }
+#endif
+    if (!sink->heap) {
+        sink->heap = malloc(1);
+        if (!sink->heap) return FAT_ERROR_MEMORY;
+        sink->heap[0] = '\0';
+    }
+    *data = sink->heap;
+    sink->heap = NULL;
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Converts the bytes of a file to UTF-8, a chunk at a time.
+ */
+static FatResult transcode(const char* raw, size_t raw_size, TextEncoding encoding,
+                           char** data, size_t* size, bool* is_mapped) {
+    TextTranscoder transcoder;
+    FatResult res = text_transcoder_init(&transcoder, encoding);
+    if (res != FAT_SUCCESS) return res;
+    char* chunk = malloc(text_transcoder_bound(TRANSCODE_CHUNK_SIZE));
+    if (!chunk) {
+        text_transcoder_free(&transcoder);
+        return FAT_ERROR_MEMORY;
+    }
+
+    TranscodeSink sink = { NULL, 0, 0, -1 };
+    size_t pos = text_encoding_bom_length(encoding, raw, raw_size);
+    while (res == FAT_SUCCESS && pos < raw_size) {
+        size_t len = raw_size - pos < TRANSCODE_CHUNK_SIZE ? raw_size - pos : TRANSCODE_CHUNK_SIZE;
+        size_t written = 0;
+        res = text_transcoder_convert(&transcoder, raw + pos, len, pos + len == raw_size, chunk, &written);
+        if (res == FAT_SUCCESS) res = sink_append(&sink, chunk, written);
+        pos += len;
+    }
+    free(chunk);
+    text_transcoder_free(&transcoder);
+
+    if (res == FAT_SUCCESS) res = sink_finish(&sink, data, size, is_mapped);
+    if (res != FAT_SUCCESS) {
+        free(sink.heap);
+        if (sink.spill_fd >= 0) close(sink.spill_fd);
+        return res;
+    }
+    LOG_INFO("Converted %zu bytes of %s to %zu bytes of UTF-8%s", raw_size, text_encoding_name(encoding), *size,
+             *is_mapped ? ", spilled to disk" : "");
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Unmaps or frees file bytes.
+ */
+static void release_bytes(char* data, size_t size, bool is_mapped) {
+#ifndef _WIN32
+    if (is_mapped) {
+        map_guard_remove(data);
+        munmap(data, size);
+        return;
+    }
+#else
+    (void)size;
+    (void)is_mapped;
+#endif
+    free(data);
+}
+
+/**
+ * @brief Reads the file in another encoding, converting the bytes already held rather than reopening it.
+ */
+FatResult line_index_set_encoding(LineIndex* index, TextEncoding encoding) {
+    if (encoding >= TEXT_ENCODING_COUNT) return FAT_ERROR_INVALID_ARGUMENT;
+    if (encoding == index->encoding) return FAT_SUCCESS;
+
+    char* raw = index->raw ? index->raw : index->data;
+    size_t raw_size = index->raw ? index->raw_size : index->size;
+    bool raw_is_mapped = index->raw ? index->raw_is_mapped : index->is_mapped;
+
+    char* data = raw;
+    size_t size = raw_size;
+    bool is_mapped = raw_is_mapped;
+    if (encoding != TEXT_ENCODING_UTF8) {
+        if (raw_size > LINE_INDEX_MAX_TRANSCODE) {
+            LOG_INFO("Not converting %zu bytes from %s; that is over the limit", raw_size, text_encoding_name(encoding));
+            return FAT_ERROR_UNSUPPORTED;
+        }
+        FatResult res = transcode(raw, raw_size, encoding, &data, &size, &is_mapped);
+        if (res != FAT_SUCCESS) return res;
+    }
+
+    if (index->raw) release_bytes(index->data, index->size, index->is_mapped);
+    index->data = data;
+    index->size = size;
+    index->is_mapped = is_mapped;
+    index->raw = encoding == TEXT_ENCODING_UTF8 ? NULL : raw;
+    index->raw_size = encoding == TEXT_ENCODING_UTF8 ? 0 : raw_size;
+    index->raw_is_mapped = encoding == TEXT_ENCODING_UTF8 ? false : raw_is_mapped;
+    index->encoding = encoding;
+    return line_index_build(index);
+}
+
+// **Opening**
+
+/**
+ * @brief Opens a file and indexes its lines, reusing a cached index when there is one.
+ */
+FatResult line_index_open(LineIndex* index, const char* path) {
+    FatResult res = line_index_load(index, path);
+    if (res != FAT_SUCCESS) return res;
+
+    // Converted text has offsets of its own, which the line cache does not keep.
+    TextEncoding encoding = text_encoding_detect(index->data, index->size, NULL);
+    if (encoding != TEXT_ENCODING_UTF8) {
+        res = line_index_set_encoding(index, encoding);
+        if (res == FAT_SUCCESS) return FAT_SUCCESS;
+        if (res == FAT_ERROR_MEMORY) {
+            line_index_free(index);
+            return res;
+        }
+        LOG_INFO("Could not read '%s' as %s (%s), showing it as UTF-8", path, text_encoding_name(encoding),
+                 fat_result_to_string(res));
+    }
+
+    size_t resume = 0;
+    bool cached = line_cache_restore(index, path, &resume);
+    res = index_lines(index, path, cached ? resume : 0);
+    index->is_built = res == FAT_SUCCESS;
+    if (res != FAT_SUCCESS) {
+        line_index_free(index);
+        return res;
+    }
+
+    // A sidecar that matched exactly is already up to date.
+    if (!cached || resume < index->size) line_cache_save(index, path);
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief (Re)builds the line offsets over the data already held by the index.
+ */
+FatResult line_index_build(LineIndex* index) {
+    free(index->offsets);
+    index->offsets = NULL;
+    index->count = 0;
+    index->capacity = 0;
+    index->max_line_len = 0;
+    index->is_built = false;
+
+    FatResult res = scan_lines(index, 0);
+    if (res != FAT_SUCCESS) return res;
+    index->is_built = true;
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Returns a line of the indexed file.
+ */
+const char* line_index_get(const LineIndex* index, size_t line, size_t* len) {
+    if (!index->is_built || line >= index->count) {
+        *len = 0;
+        return NULL;
+    }
+    size_t start = index->offsets[line];
+    size_t end;
+    if (line + 1 < index->count) {
+        end = index->offsets[line + 1] - 1; // Position of the '\n'
+    } else {
+        end = index->size;
+        if (end > start && index->data[end - 1] == '\n') end--;
+    }
+    *len = end - start;
+    return index->data + start;
+}
+
+/**
+ * @brief Finds the first hole that ends past an offset.
+ */
+size_t line_index_find_hole(const FileHole* holes, size_t hole_count, size_t offset) {
+    size_t low = 0, high = hole_count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (holes[mid].offset + holes[mid].length <= offset) low = mid + 1; else high = mid;
+    }
+    return low;
+}
+
+/**
+ * @brief Returns the number of heap bytes owned by the index.
+ */
+size_t line_index_memory_usage(const LineIndex* index) {
+    size_t usage = index->capacity * sizeof(size_t) + index->hole_count * sizeof(FileHole);
+    if (!index->is_mapped) usage += index->size;
+    if (index->raw && !index->raw_is_mapped) usage += index->raw_size;
+    return usage;
+}
+
+/**
+ * @brief Returns true, once, if the file was found cut short under its mapping.
+ */
+bool line_index_take_fault(LineIndex* index) {
+    return index->map_size > 0 && map_guard_take_fault(index->raw ? index->raw : index->data);
+}
+
+/**
+ * @brief Cuts the index down to the current size of its file.
+ */
+bool line_index_recheck(LineIndex* index, const char* path) {
+    struct stat st;
+    if (index->map_size == 0 || stat(path, &st) != 0 || !S_ISREG(st.st_mode)) return false;
+    size_t size = (size_t)st.st_size;
+    if (index->raw) {
+        // Converted text was made from the bytes there were; it is only cut down when converted again.
+        if (size >= index->raw_size) return false;
+        index->raw_size = size;
+        return true;
+    }
+    if (size >= index->size) return false;
+
+    LOG_INFO("'%s' shrank from %zu to %zu bytes while open; cutting its lines down", path, index->size, size);
+    index->size = size;
+    while (index->count > 0 && index->offsets[index->count - 1] >= size) index->count--;
+    while (index->hole_count > 0 && index->holes[index->hole_count - 1].offset >= size) index->hole_count--;
+    if (index->hole_count > 0) {
+        FileHole* last = &index->holes[index->hole_count - 1];
+        if (last->offset + last->length > size) last->length = size - last->offset;
+    }
+    return true;
+}
+
+/**
+ * @brief Frees the line offsets but keeps the file data.
+ */
+void line_index_evict(LineIndex* index) {
+    free(index->offsets);
+    index->offsets = NULL;
+    index->count = 0;
+    index->capacity = 0;
+    index->is_built = false;
+}
+
+/**
+ * @brief Frees the line offsets and unmaps or frees the file data, converted or not.
+ */
+void line_index_free(LineIndex* index) {
+    if (!index) return;
+    free(index->offsets);
+    free(index->holes);
+    // The file mapping is unmapped whole, however far a truncation cut `size` down.
+    if (index->raw) {
+        release_bytes(index->data, index->size, index->is_mapped);
+        release_bytes(index->raw, index->map_size ? index->map_size : index->raw_size, index->raw_is_mapped);
+    } else {
+        release_bytes(index->data, index->map_size ? index->map_size : index->size, index->is_mapped);
+    }
+    line_index_init(index);
+}
@@ -0,0 +1,139 @@
+/**
+ * @file map_guard.c
+ * @author Zuhaitz (original)
+ * @brief Implements the SIGBUS guard over file mappings.
+ */
+#define _GNU_SOURCE // For MAP_ANONYMOUS
+#include "core/map_guard.h"
+#include "utils/logger.h"
+#include <stdint.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+/**
+ * @struct GuardSlot
+ * @brief A guarded mapping. The fields are read by the signal handler, so they are only accessed atomically.
+ */
+typedef struct {
+    uintptr_t start;            /**< The start of the mapping, or 0 for a free slot. */
+    size_t length;              /**< The length of the mapping. */
+    int faulted;                /**< Set by the handler when a page past the end of the file was touched. */
+} GuardSlot;
+
+static GuardSlot slots[MAP_GUARD_SLOTS];
+
+/** @brief Serializes the threads taking and freeing slots; the handler does without. */
+static pthread_mutex_t slots_lock = PTHREAD_MUTEX_INITIALIZER;
+
+#if !defined(_WIN32) && defined(SIGBUS)
+
+static pthread_once_t install_once = PTHREAD_ONCE_INIT;
+static struct sigaction previous_action;
+static uintptr_t page_mask;
+
+/**
+ * @brief Maps zeros over the rest of a guarded mapping that faulted, or hands the signal on.
+ *
+ * Only async-signal-safe calls are made: the slots are read with atomic
+ * loads, and mmap is a plain system call.
+ */
+static void on_sigbus(int sig, siginfo_t* info, void* context) {
+    (void)context;
+    uintptr_t addr = (uintptr_t)info->si_addr;
+    for (size_t i = 0; i < MAP_GUARD_SLOTS; i++) {
+        uintptr_t start = __atomic_load_n(&slots[i].start, __ATOMIC_ACQUIRE);
+        size_t length = __atomic_load_n(&slots[i].length, __ATOMIC_ACQUIRE);
+        if (start == 0 || addr < start || addr - start >= length) continue;
+
+        // Every page from the faulting one on is past the end of the file, which only ever shrank.
+        uintptr_t from = addr & page_mask;
+        uintptr_t end = (start + length + ~page_mask) & page_mask;
+        void* zeros = mmap((void*)from, end - from, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+        if (zeros != MAP_FAILED) {
+            __atomic_store_n(&slots[i].faulted, 1, __ATOMIC_RELEASE);
+            return;
+        }
+        break;
+    }
+
+    // Not a guarded mapping: put the previous handler back and let the access fault again under it.
+    sigaction(sig, &previous_action, NULL);
+}
+
+/**
+ * @brief Installs the SIGBUS handler.
+ */
+static void install_handler(void) {
+    long page = sysconf(_SC_PAGESIZE);
+    page_mask = ~(uintptr_t)((page > 0 ? page : 4096) - 1);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = on_sigbus;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGBUS, &action, &previous_action) != 0) {
+        LOG_INFO("Could not install the SIGBUS handler; a file truncated while open may crash the viewer");
+    }
+}
+
+#endif
+
+/**
+ * @brief Guards a file mapping, installing the SIGBUS handler the first time.
+ */
+bool map_guard_add(const void* start, size_t length) {
+#if !defined(_WIN32) && defined(SIGBUS)
+    pthread_once(&install_once, install_handler);
+    pthread_mutex_lock(&slots_lock);
+    for (size_t i = 0; i < MAP_GUARD_SLOTS; i++) {
+        if (__atomic_load_n(&slots[i].start, __ATOMIC_ACQUIRE) != 0) continue;
+        // The length goes in first, so the handler never sees a slot with a start and a stale length.
+        __atomic_store_n(&slots[i].length, length, __ATOMIC_RELEASE);
+        __atomic_store_n(&slots[i].faulted, 0, __ATOMIC_RELEASE);
+        __atomic_store_n(&slots[i].start, (uintptr_t)start, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&slots_lock);
+        return true;
+    }
+    pthread_mutex_unlock(&slots_lock);
+    LOG_INFO("All %d mapping guards are taken; a mapping of %zu bytes is left unguarded", MAP_GUARD_SLOTS, length);
+#else
+    (void)start;
+    (void)length;
+#endif
+    return false;
+}
+
+/**
+ * @brief Stops guarding a mapping, before it is unmapped.
+ */
+void map_guard_remove(const void* start) {
+    if (!start) return;
+    pthread_mutex_lock(&slots_lock);
+    for (size_t i = 0; i < MAP_GUARD_SLOTS; i++) {
+        if (__atomic_load_n(&slots[i].start, __ATOMIC_ACQUIRE) == (uintptr_t)start) {
+            __atomic_store_n(&slots[i].start, 0, __ATOMIC_RELEASE);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&slots_lock);
+}
+
+/**
+ * @brief Returns true, once, if a page of the mapping faulted since the last call.
+ */
+bool map_guard_take_fault(const void* start) {
+    if (!start) return false;
+    for (size_t i = 0; i < MAP_GUARD_SLOTS; i++) {
+        if (__atomic_load_n(&slots[i].start, __ATOMIC_ACQUIRE) == (uintptr_t)start) {
+            return __atomic_exchange_n(&slots[i].faulted, 0, __ATOMIC_ACQ_REL) != 0;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,135 @@
+/**
+ * @file multi_match.c
+ * @author Zuhaitz (original)
+ * @brief Implements the Aho-Corasick matcher for several terms.
+ */
+#include "core/multi_match.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Compiles a set of terms.
+ *
+ * The terms are first laid out as a trie. A breadth-first walk then gives
+ * every state its failure state and fills in the missing transitions from
+ * it, turning the trie into a DFA.
+ */
+FatResult multi_match_compile(MultiMatcher* matcher, char* const* terms, size_t count) {
+    memset(matcher, 0, sizeof(*matcher));
+    if (count == 0 || count > MULTI_MATCH_MAX_TERMS) return FAT_ERROR_INVALID_ARGUMENT;
+
+    size_t max_states = 1;
+    for (size_t i = 0; i < count; i++) {
+        size_t len = strlen(terms[i]);
+        if (len == 0 || len > MULTI_MATCH_MAX_TERM_LEN) return FAT_ERROR_INVALID_ARGUMENT;
+        matcher->term_len[i] = len;
+        max_states += len;
+    }
+    matcher->term_count = count;
+
+    // 1 - Order the terms by length, for `multi_match_mark`.
+    for (size_t i = 0; i < count; i++) {
+        size_t j = i;
+        while (j > 0 && matcher->term_len[matcher->by_length[j - 1]] > matcher->term_len[i]) {
+            matcher->by_length[j] = matcher->by_length[j - 1];
+            j--;
+        }
+        matcher->by_length[j] = (unsigned char)i;
+    }
+
+    matcher->next = calloc(max_states, sizeof(*matcher->next));
+    matcher->output = calloc(max_states, sizeof(uint32_t));
+    uint16_t* fail = calloc(max_states, sizeof(uint16_t));
+    uint16_t* queue = malloc(max_states * sizeof(uint16_t));
+    if (!matcher->next || !matcher->output || !fail || !queue) {
+        free(fail);
+        free(queue);
+        multi_match_free(matcher);
+        return FAT_ERROR_MEMORY;
+    }
+
+    // 2 - The trie. State 0 is the root, so a transition to 0 means there is no edge yet.
+    matcher->state_count = 1;
+    for (size_t i = 0; i < count; i++) {
+        uint16_t state = 0;
+        for (const unsigned char* p = (const unsigned char*)terms[i]; *p; p++) {
+            if (matcher->next[state][*p] == 0) matcher->next[state][*p] = (uint16_t)matcher->state_count++;
+            state = matcher->next[state][*p];
+        }
+        matcher->output[state] |= 1u << i;
+    }
+
+    // 3 - Failure states, in breadth-first order so a state's failure is done before it.
+    size_t head = 0, tail = 0;
+    for (int c = 0; c < 256; c++) {
+        if (matcher->next[0][c] != 0) queue[tail++] = matcher->next[0][c];
+    }
+    while (head < tail) {
+        uint16_t state = queue[head++];
+        matcher->output[state] |= matcher->output[fail[state]];
+        for (int c = 0; c < 256; c++) {
+            uint16_t child = matcher->next[state][c];
+            if (child != 0) {
+                fail[child] = matcher->next[fail[state]][c];
+                queue[tail++] = child;
+            } else {
+                matcher->next[state][c] = matcher->next[fail[state]][c];
+            }
+        }
+    }
+
+    free(fail);
+    free(queue);
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Finds which terms occur in a text.
+ */
+uint32_t multi_match_find(const MultiMatcher* matcher, const char* text, size_t len) {
+    if (!matcher->next) return 0;
+    uint32_t all = (1u << matcher->term_count) - 1;
+    uint32_t found = 0;
+    uint16_t state = 0;
+    const unsigned char* p = (const unsigned char*)text;
+    for (size_t i = 0; i < len; i++) {
+        state = matcher->next[state][p[i]];
+        if (matcher->output[state]) {
+            found |= matcher->output[state];
+            if (found == all) break;
+        }
+    }
+    return found;
+}
+
+/**
+ * @brief Marks the bytes of a text covered by each term.
+ */
+bool multi_match_mark(const MultiMatcher* matcher, const char* text, size_t len, unsigned char* marks) {
+    memset(marks, 0, len);
+    if (!matcher->next) return false;
+    bool any = false;
+    uint16_t state = 0;
+    const unsigned char* p = (const unsigned char*)text;
+    for (size_t i = 0; i < len; i++) {
+        state = matcher->next[state][p[i]];
+        uint32_t output = matcher->output[state];
+        if (!output) continue;
+        any = true;
+        for (size_t k = 0; k < matcher->term_count; k++) {
+            unsigned char term = matcher->by_length[k];
+            if (!(output & (1u << term))) continue;
+            memset(marks + i + 1 - matcher->term_len[term], term + 1, matcher->term_len[term]);
+        }
+    }
+    return any;
+}
+
+/**
+ * @brief Frees a matcher.
+ */
+void multi_match_free(MultiMatcher* matcher) {
+    free(matcher->next);
+    free(matcher->output);
+    memset(matcher, 0, sizeof(*matcher));
+}
@@ -0,0 +1,607 @@
+/**
+ * @file read_pipeline.c
+ * @author Zuhaitz (original)
+ * @brief Implements the shared read pipeline, over io_uring or a pread thread pool.
+ */
+#include "core/read_pipeline.h"
+#include "core/file_source.h"
+#include "utils/logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define READ_PIPELINE_URING 1
+#endif
+#endif
+#endif
+
+/** @brief How many times a drain waits on a ring that refuses to wait before giving its reads up. */
+#define URING_DRAIN_RETRIES 100
+/** @brief The pause between those waits, in microseconds. */
+#define URING_DRAIN_PAUSE_US 10000
+
+/**
+ * @enum SlotState
+ * @brief Where the block of a slot stands.
+ */
+typedef enum {
+    SLOT_IDLE,                  /**< No block assigned. */
+    SLOT_READING,               /**< A read is on its way into the buffer. */
+    SLOT_READY                  /**< The block has been read (or failed), and waits to be delivered. */
+} SlotState;
+
+/**
+ * @struct ReadSlot
+ * @brief A buffer and the block being read into it.
+ */
+typedef struct {
+    char* buffer;
+    uint64_t offset;            /**< The file offset of the block. */
+    size_t length;              /**< The bytes asked for. */
+    size_t filled;              /**< The bytes read. */
+    bool failed;                /**< Set if the read failed. */
+    SlotState state;
+    bool claimed;               /**< Set once a pool thread has taken the read. */
+} ReadSlot;
+
+/**
+ * @struct ReadScan
+ * @brief A pass over a file, its consumers and the reads in flight.
+ */
+typedef struct ReadScan {
+    dev_t dev;                  /**< The device of the file, to recognize scans of the same file. */
+    ino_t ino;                  /**< The inode of the file. */
+    uint64_t start;             /**< The offset the scan starts at. */
+    FileSource source;
+    uint64_t end;               /**< The size of the file when the scan started. */
+
+    // **Protected by `registry_lock`**
+    ReadConsumer** consumers;   /**< Every consumer, the starter's first. Frozen once delivery begins. */
+    size_t consumer_count;
+    size_t consumer_capacity;
+    bool delivering;            /**< Set once the first block is delivered; no one can join after. */
+    bool finished;              /**< Set once the scan is over. */
+    FatResult result;           /**< How the scan ended. */
+    int refs;                   /**< The callers still inside `read_pipeline_scan`. */
+    pthread_cond_t done_cond;   /**< Signalled when `finished` is set. */
+    struct ReadScan* next;      /**< The next scan in the registry. */
+
+    // **Starter thread, and pool threads under `pool_lock`**
+    ReadSlot slots[READ_PIPELINE_DEPTH];
+    bool use_uring;
+    bool buffers_busy;          /**< Set if the ring died with reads in flight; the buffers are then never freed. */
+#ifdef READ_PIPELINE_URING
+    int ring_fd;
+    void* sq_ring;
+    size_t sq_ring_size;
+    void* cq_ring;
+    size_t cq_ring_size;
+    struct io_uring_sqe* sqes;
+    size_t sqes_size;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    struct io_uring_cqe* cqes;
+    struct iovec iovecs[READ_PIPELINE_DEPTH];
+    unsigned to_submit;         /**< Queued submissions not yet passed to the kernel. */
+    unsigned in_flight;         /**< Reads the kernel has not completed yet. */
+#endif
+    pthread_mutex_t pool_lock;
+    pthread_cond_t pool_work;   /**< Signalled when a read is queued or the pool should stop. */
+    pthread_cond_t pool_ready;  /**< Signalled when a read is done. */
+    pthread_t threads[READ_PIPELINE_THREADS];
+    size_t thread_count;
+    bool pool_stop;
+} ReadScan;
+
+/** @brief Guards the registry and the shared part of every scan. */
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/** @brief The scans that can still be joined. */
+static ReadScan* registry = NULL;
+
+/**
+ * @brief Reads a block with pread, going on after short reads until it is full or the file ends.
+ */
+static void read_slot_blocking(ReadScan* scan, ReadSlot* slot, size_t from) {
+    size_t got = 0;
+    if (file_source_read_at(&scan->source, slot->buffer + from, slot->length - from, slot->offset + from, &got) != FAT_SUCCESS) {
+        slot->failed = true;
+    }
+    slot->filled = from + got;
+}
+
+// **io_uring Backend**
+
+#ifdef READ_PIPELINE_URING
+
+/**
+ * @brief Sets up a ring as deep as the pipeline, mapping its queues.
+ * @return False if io_uring is not available, in which case nothing is left to undo.
+ */
+static bool uring_open(ReadScan* scan) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    long fd = syscall(__NR_io_uring_setup, READ_PIPELINE_DEPTH, &params);
+    if (fd < 0) return false;
+    scan->ring_fd = (int)fd;
+
+    scan->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    scan->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single) {
+        if (scan->cq_ring_size > scan->sq_ring_size) scan->sq_ring_size = scan->cq_ring_size;
+        scan->cq_ring_size = scan->sq_ring_size;
+    }
+    scan->sq_ring = mmap(NULL, scan->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         scan->ring_fd, IORING_OFF_SQ_RING);
+    if (scan->sq_ring == MAP_FAILED) {
+        close(scan->ring_fd);
+        return false;
+    }
+    scan->cq_ring = single ? scan->sq_ring
+                           : mmap(NULL, scan->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                  scan->ring_fd, IORING_OFF_CQ_RING);
+    scan->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    scan->sqes = scan->cq_ring == MAP_FAILED ? MAP_FAILED
+                                             : mmap(NULL, scan->sqes_size, PROT_READ | PROT_WRITE,
+                                                    MAP_SHARED | MAP_POPULATE, scan->ring_fd, IORING_OFF_SQES);
+    if (scan->cq_ring == MAP_FAILED || scan->sqes == MAP_FAILED) {
+        if (scan->cq_ring != MAP_FAILED && !single) munmap(scan->cq_ring, scan->cq_ring_size);
+        munmap(scan->sq_ring, scan->sq_ring_size);
+        close(scan->ring_fd);
+        return false;
+    }
+
+    char* sq = scan->sq_ring;
+    char* cq = scan->cq_ring;
+    scan->sq_head = (unsigned*)(sq + params.sq_off.head);
+    scan->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    scan->sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+    scan->sq_array = (unsigned*)(sq + params.sq_off.array);
+    scan->cq_head = (unsigned*)(cq + params.cq_off.head);
+    scan->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    scan->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+    scan->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+    return true;
+}
+
+/**
+ * @brief Unmaps the queues and closes the ring.
+ */
+static void uring_close(ReadScan* scan) {
+    munmap(scan->sqes, scan->sqes_size);
+    if (scan->cq_ring != scan->sq_ring) munmap(scan->cq_ring, scan->cq_ring_size);
+    munmap(scan->sq_ring, scan->sq_ring_size);
+    close(scan->ring_fd);
+}
+
+/**
+ * @brief Queues the read of a slot; it reaches the kernel with the next wait.
+ */
+static void uring_queue(ReadScan* scan, size_t index) {
+    ReadSlot* slot = &scan->slots[index];
+    scan->iovecs[index].iov_base = slot->buffer;
+    scan->iovecs[index].iov_len = slot->length;
+
+    unsigned tail = *scan->sq_tail;
+    unsigned sqe_index = tail & *scan->sq_mask;
+    struct io_uring_sqe* sqe = &scan->sqes[sqe_index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = scan->source.fd;
+    sqe->addr = (uint64_t)(uintptr_t)&scan->iovecs[index];
+    sqe->len = 1;
+    sqe->off = slot->offset;
+    sqe->user_data = index;
+    scan->sq_array[sqe_index] = sqe_index;
+    // The kernel must see the entry before the tail that publishes it.
+    __atomic_store_n(scan->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    scan->to_submit++;
+}
+
+/**
+ * @brief Submits what is queued, waits for at least one read, and marks the completed slots ready.
+ * @return False if the ring failed, leaving the remaining reads to pread.
+ */
+static bool uring_wait(ReadScan* scan) {
+    unsigned head = *scan->cq_head;
+    if (head == __atomic_load_n(scan->cq_tail, __ATOMIC_ACQUIRE) || scan->to_submit > 0) {
+        long n = syscall(__NR_io_uring_enter, scan->ring_fd, scan->to_submit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY) return true;
+            LOG_INFO("io_uring_enter failed (%s); reading with pread", strerror(errno));
+            return false;
+        }
+        scan->in_flight += (unsigned)n;
+        scan->to_submit -= (unsigned)n;
+    }
+
+    unsigned tail = __atomic_load_n(scan->cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++) {
+        struct io_uring_cqe* cqe = &scan->cqes[head & *scan->cq_mask];
+        ReadSlot* slot = &scan->slots[cqe->user_data];
+        if (cqe->res >= 0) {
+            slot->filled = (size_t)cqe->res;
+            // A short read before the end of the file is finished with pread.
+            if (slot->filled > 0 && slot->filled < slot->length) read_slot_blocking(scan, slot, slot->filled);
+        } else if (cqe->res == -EAGAIN || cqe->res == -EINTR) {
+            read_slot_blocking(scan, slot, 0);
+        } else {
+            slot->failed = true;
+        }
+        slot->state = SLOT_READY;
+        scan->in_flight--;
+    }
+    __atomic_store_n(scan->cq_head, head, __ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * @brief Waits for every read the kernel still has, so that no buffer is freed or reused under it.
+ *
+ * If io_uring_enter fails, the completions are still posted to the shared
+ * queue, so it is polled for a while without the system call.
+ *
+ * @return False if reads were still in flight when it gave up. Their buffers then belong to the kernel for good.
+ */
+static bool uring_drain(ReadScan* scan) {
+    // Queued entries that never reached the kernel are simply dropped with the ring.
+    scan->to_submit = 0;
+    int failures = 0;
+    while (scan->in_flight > 0) {
+        long n = syscall(__NR_io_uring_enter, scan->ring_fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (n < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            if (++failures > URING_DRAIN_RETRIES) {
+                LOG_INFO("io_uring_enter failed (%s) with %u reads in flight; leaking their buffers",
+                         strerror(errno), scan->in_flight);
+                return false;
+            }
+            usleep(URING_DRAIN_PAUSE_US);
+        }
+        unsigned head = *scan->cq_head;
+        unsigned tail = __atomic_load_n(scan->cq_tail, __ATOMIC_ACQUIRE);
+        scan->in_flight -= tail - head;
+        __atomic_store_n(scan->cq_head, tail, __ATOMIC_RELEASE);
+    }
+    return true;
+}
+
+#endif // READ_PIPELINE_URING
+
+// **Thread Pool Backend**
+
+/**
+ * @brief Pool thread: takes queued reads one at a time and does them with pread.
+ */
+static void* pool_worker(void* arg) {
+    ReadScan* scan = arg;
+    pthread_mutex_lock(&scan->pool_lock);
+    while (!scan->pool_stop) {
+        ReadSlot* slot = NULL;
+        for (size_t i = 0; i < READ_PIPELINE_DEPTH && !slot; i++) {
+            if (scan->slots[i].state == SLOT_READING && !scan->slots[i].claimed) slot = &scan->slots[i];
+        }
+        if (!slot) {
+            pthread_cond_wait(&scan->pool_work, &scan->pool_lock);
+            continue;
+        }
+        slot->claimed = true;
+        pthread_mutex_unlock(&scan->pool_lock);
+        read_slot_blocking(scan, slot, 0);
+        pthread_mutex_lock(&scan->pool_lock);
+        slot->state = SLOT_READY;
+        pthread_cond_broadcast(&scan->pool_ready);
+    }
+    pthread_mutex_unlock(&scan->pool_lock);
+    return NULL;
+}
+
+/**
+ * @brief Starts the pool threads. With none, reads happen on the starter's thread as they are waited for.
+ */
+static void pool_open(ReadScan* scan) {
+    pthread_mutex_init(&scan->pool_lock, NULL);
+    pthread_cond_init(&scan->pool_work, NULL);
+    pthread_cond_init(&scan->pool_ready, NULL);
+    for (size_t i = 0; i < READ_PIPELINE_THREADS; i++) {
+        if (pthread_create(&scan->threads[scan->thread_count], NULL, pool_worker, scan) != 0) break;
+        scan->thread_count++;
+    }
+}
+
+/**
+ * @brief Stops and joins the pool threads, after the reads they have taken.
+ */
+static void pool_close(ReadScan* scan) {
+    pthread_mutex_lock(&scan->pool_lock);
+    scan->pool_stop = true;
+    pthread_cond_broadcast(&scan->pool_work);
+    pthread_mutex_unlock(&scan->pool_lock);
+    for (size_t i = 0; i < scan->thread_count; i++) pthread_join(scan->threads[i], NULL);
+    pthread_cond_destroy(&scan->pool_ready);
+    pthread_cond_destroy(&scan->pool_work);
+    pthread_mutex_destroy(&scan->pool_lock);
+}
+
+// **Scanning**
+
+/**
+ * @brief Assigns the next block to a slot and starts reading it.
+ */
+static void start_read(ReadScan* scan, size_t index, uint64_t offset) {
+    ReadSlot* slot = &scan->slots[index];
+    uint64_t left = scan->end - offset;
+    slot->offset = offset;
+    slot->length = left < READ_PIPELINE_BLOCK_SIZE ? (size_t)left : READ_PIPELINE_BLOCK_SIZE;
+    slot->filled = 0;
+    slot->failed = false;
+    slot->claimed = false;
+#ifdef READ_PIPELINE_URING
+    if (scan->use_uring) {
+        slot->state = SLOT_READING;
+        uring_queue(scan, index);
+        return;
+    }
+#endif
+    pthread_mutex_lock(&scan->pool_lock);
+    slot->state = SLOT_READING;
+    pthread_cond_signal(&scan->pool_work);
+    pthread_mutex_unlock(&scan->pool_lock);
+}
+
+/**
+ * @brief Waits until a slot's block has been read.
+ */
+static void wait_ready(ReadScan* scan, size_t index) {
+    ReadSlot* slot = &scan->slots[index];
+#ifdef READ_PIPELINE_URING
+    if (scan->use_uring) {
+        while (slot->state != SLOT_READY) {
+            if (uring_wait(scan)) continue;
+            // The ring broke: whatever it still owes is read here instead, once the kernel is done
+            // with the buffers. If it never is, those reads fail and their slots are not used again.
+            if (!uring_drain(scan)) scan->buffers_busy = true;
+            for (size_t i = 0; i < READ_PIPELINE_DEPTH; i++) {
+                if (scan->slots[i].state == SLOT_READING) {
+                    if (scan->buffers_busy) {
+                        scan->slots[i].failed = true;
+                    } else {
+                        read_slot_blocking(scan, &scan->slots[i], 0);
+                    }
+                    scan->slots[i].state = SLOT_READY;
+                }
+            }
+            uring_close(scan);
+            scan->use_uring = false;
+            pool_open(scan);
+        }
+        return;
+    }
+#endif
+    pthread_mutex_lock(&scan->pool_lock);
+    if (scan->thread_count == 0 && slot->state == SLOT_READING) {
+        read_slot_blocking(scan, slot, 0);
+        slot->state = SLOT_READY;
+    }
+    while (slot->state != SLOT_READY) pthread_cond_wait(&scan->pool_ready, &scan->pool_lock);
+    pthread_mutex_unlock(&scan->pool_lock);
+}
+
+/**
+ * @brief Hands a block to every consumer still listening.
+ * @return False once none is.
+ */
+static bool deliver(ReadScan* scan, const ReadSlot* slot) {
+    bool any = false;
+    for (size_t i = 0; i < scan->consumer_count; i++) {
+        ReadConsumer* consumer = scan->consumers[i];
+        if (consumer->stopped) continue;
+        if (!consumer->consume(consumer->ctx, slot->buffer, slot->filled, slot->offset)) consumer->stopped = true;
+        any = any || !consumer->stopped;
+    }
+    return any;
+}
+
+/**
+ * @brief Reads the file through the slots, keeping them all busy, and delivers the blocks in order.
+ */
+static FatResult run_scan(ReadScan* scan) {
+    uint64_t next_read = scan->start;
+    size_t started = 0;
+    for (; started < READ_PIPELINE_DEPTH && next_read < scan->end; started++) {
+        start_read(scan, started, next_read);
+        next_read += scan->slots[started].length;
+    }
+
+    FatResult res = FAT_SUCCESS;
+    for (size_t index = 0; started > 0; index = (index + 1) % READ_PIPELINE_DEPTH, started--) {
+        wait_ready(scan, index);
+        ReadSlot* slot = &scan->slots[index];
+
+        if (!scan->delivering) {
+            pthread_mutex_lock(&registry_lock);
+            scan->delivering = true;
+            for (ReadScan** link = &registry; *link; link = &(*link)->next) {
+                if (*link == scan) {
+                    *link = scan->next;
+                    break;
+                }
+            }
+            pthread_mutex_unlock(&registry_lock);
+            if (scan->consumer_count > 1) LOG_INFO("%zu consumers share one pass over the file.", scan->consumer_count);
+        }
+
+        if (slot->failed) {
+            res = FAT_ERROR_FILE_READ;
+            break;
+        }
+        if (slot->filled > 0 && !deliver(scan, slot)) break;
+        // The file shrank under the scan: there is nothing more to read.
+        if (slot->filled < slot->length) break;
+
+        slot->state = SLOT_IDLE;
+        if (next_read < scan->end) {
+            start_read(scan, index, next_read);
+            next_read += slot->length;
+            started++;
+        }
+    }
+
+#ifdef READ_PIPELINE_URING
+    if (scan->use_uring) {
+        if (!uring_drain(scan)) scan->buffers_busy = true;
+        uring_close(scan);
+        return res;
+    }
+#endif
+    pool_close(scan);
+    return res;
+}
+
+/**
+ * @brief Drops a caller's hold on a scan, freeing it with the last one. Called with `registry_lock` held.
+ */
+static void release_scan(ReadScan* scan) {
+    if (--scan->refs > 0) return;
+    // Buffers the kernel may still write to are leaked rather than handed back to malloc.
+    if (!scan->buffers_busy) {
+        for (size_t i = 0; i < READ_PIPELINE_DEPTH; i++) free(scan->slots[i].buffer);
+    }
+    pthread_cond_destroy(&scan->done_cond);
+    file_source_close(&scan->source);
+    free(scan->consumers);
+    free(scan);
+}
+
+/**
+ * @brief Adds consumers to a scan that has not delivered anything yet. Called with `registry_lock` held.
+ */
+static bool add_consumers(ReadScan* scan, ReadConsumer* consumers, size_t count) {
+    if (scan->consumer_count + count > scan->consumer_capacity) {
+        size_t new_capacity = scan->consumer_capacity ? scan->consumer_capacity : 4;
+        while (new_capacity < scan->consumer_count + count) new_capacity *= 2;
+        ReadConsumer** grown = realloc(scan->consumers, new_capacity * sizeof(ReadConsumer*));
+        if (!grown) return false;
+        scan->consumers = grown;
+        scan->consumer_capacity = new_capacity;
+    }
+    for (size_t i = 0; i < count; i++) {
+        consumers[i].stopped = false;
+        scan->consumers[scan->consumer_count++] = &consumers[i];
+    }
+    return true;
+}
+
+// **Public API**
+
+/**
+ * @brief Scans a file from an offset to its end, handing every block to each consumer.
+ */
+FatResult read_pipeline_scan(const char* path, uint64_t start, ReadConsumer* consumers, size_t count) {
+    struct stat st;
+    if (stat(path, &st) != 0) return FAT_ERROR_FILE_NOT_FOUND;
+
+    // Join a scan of the same file that has not started delivering.
+    pthread_mutex_lock(&registry_lock);
+    for (ReadScan* scan = registry; scan; scan = scan->next) {
+        if (scan->dev != st.st_dev || scan->ino != st.st_ino || scan->start != start) continue;
+        if (!add_consumers(scan, consumers, count)) break;
+        scan->refs++;
+        while (!scan->finished) pthread_cond_wait(&scan->done_cond, &registry_lock);
+        FatResult res = scan->result;
+        release_scan(scan);
+        pthread_mutex_unlock(&registry_lock);
+        return res;
+    }
+    pthread_mutex_unlock(&registry_lock);
+
+    ReadScan* scan = calloc(1, sizeof(ReadScan));
+    if (!scan) return FAT_ERROR_MEMORY;
+    FatResult res = file_source_open(&scan->source, path, false);
+    if (res != FAT_SUCCESS) {
+        free(scan);
+        return res;
+    }
+    if (scan->source.kind == FILE_SOURCE_STREAM) {
+        file_source_close(&scan->source);
+        free(scan);
+        return FAT_ERROR_UNSUPPORTED;
+    }
+    scan->dev = st.st_dev;
+    scan->ino = st.st_ino;
+    scan->start = start;
+    scan->end = scan->source.size;
+    scan->refs = 1;
+    pthread_cond_init(&scan->done_cond, NULL);
+    if (start >= scan->end) {
+        pthread_mutex_lock(&registry_lock);
+        release_scan(scan);
+        pthread_mutex_unlock(&registry_lock);
+        return FAT_SUCCESS;
+    }
+    for (size_t i = 0; i < READ_PIPELINE_DEPTH; i++) {
+        // Page-aligned, so the buffers would also do for O_DIRECT.
+        void* buffer = NULL;
+        if (posix_memalign(&buffer, 4096, READ_PIPELINE_BLOCK_SIZE) != 0) {
+            pthread_mutex_lock(&registry_lock);
+            release_scan(scan);
+            pthread_mutex_unlock(&registry_lock);
+            return FAT_ERROR_MEMORY;
+        }
+        scan->slots[i].buffer = buffer;
+    }
+
+#ifdef READ_PIPELINE_URING
+    scan->use_uring = uring_open(scan);
+#endif
+    if (!scan->use_uring) pool_open(scan);
+
+    pthread_mutex_lock(&registry_lock);
+    bool added = add_consumers(scan, consumers, count);
+    if (added) {
+        scan->next = registry;
+        registry = scan;
+    }
+    pthread_mutex_unlock(&registry_lock);
+
+    if (added) {
+        res = run_scan(scan);
+    } else {
+        res = FAT_ERROR_MEMORY;
+#ifdef READ_PIPELINE_URING
+        if (scan->use_uring) uring_close(scan);
+#endif
+        if (!scan->use_uring) pool_close(scan);
+    }
+
+    pthread_mutex_lock(&registry_lock);
+    // A scan that ended before its first delivery may still be listed.
+    for (ReadScan** link = &registry; *link; link = &(*link)->next) {
+        if (*link == scan) {
+            *link = scan->next;
+            break;
+        }
+    }
+    scan->finished = true;
+    scan->result = res;
+    pthread_cond_broadcast(&scan->done_cond);
+    release_scan(scan);
+    pthread_mutex_unlock(&registry_lock);
+    return res;
+}
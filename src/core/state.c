@@ -5,6 +5,8 @@
  */
 #include "core/state.h"
 #include "core/file.h"
+#include "core/file_source.h"
+#include "core/text_encoding.h"
 #include "plugins/plugin_manager.h"
 #include "plugins/hex_viewer_api.h"
 #include "utils/logger.h"
@@ -19,6 +21,7 @@
 #include <errno.h>
 #include <magic.h>
 #include <sys/stat.h>
+#include <time.h>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -26,6 +29,210 @@
 #include <mach-o/dyld.h>
 #endif
 
+/** @brief The time a search scans for each time pending work is polled. */
+#define SEARCH_POLL_BUDGET_MS 50
+
+/** @brief The lines of standard input added to the timeline each time pending work is polled. */
+#define TIMELINE_FEED_LINES 65536
+
+/** @brief Starts the breadcrumb of a grep view, which names no file. */
+#define GREP_CRUMB_PREFIX "grep:"
+
+// **Forward Declarations**
+static FatResult open_stream_view(AppState *state, int fd, const char *name, uint64_t max_size);
+static void update_stream_metadata(AppState *state);
+static void free_filter(LineFilter **filter);
+static void free_archive_grep(ArchiveGrep **grep);
+static void free_tree_grep(TreeGrep **grep);
+static void free_time_index(TimeIndex **index);
+static void free_histogram(TimeHistogram **hist);
+static bool timeline_step(AppState *state);
+static void free_byte_map(ByteMap **map);
+static void free_checksums(Checksums **sums);
+static bool checksums_step(AppState *state);
+static bool byte_map_step(AppState *state);
+static void free_strings(StringsView **strings);
+static FatResult start_strings(AppState *state, uint64_t anchor);
+static bool strings_step(AppState *state);
+static void free_hex_diff(HexDiff **diff);
+static void search_results_free(SearchMatchList *results);
+static void pins_reset_index(PinnedTerms *pins);
+static void pins_free(PinnedTerms *pins);
+static bool pins_step(AppState *state, int budget_ms);
+
+/**
+ * @brief Recognises an executable shown in hex mode, so its sections can be listed.
+ *
+ * Files of no known format simply have no section list.
+ */
+static void open_binary_format(AppState *state) {
+    BinaryFormat *binary = malloc(sizeof(BinaryFormat));
+    if (!binary) return;
+    if (binary_format_open(binary, state->filepath) != FAT_SUCCESS) {
+        free(binary);
+        return;
+    }
+    state->binary = binary;
+}
+
+/**
+ * @brief Returns the columns available to a hex row, past the line number gutter.
+ */
+static int hex_content_width(const AppState *state) {
+    // The gutter widens past 99999 rows; size it for the narrowest layout.
+    int gutter = 7;
+    for (size_t rows = state->hex->bytes.size / 8; rows >= 100000; rows /= 10) gutter++;
+    return getmaxx(state->right_pane) - gutter - 1;
+}
+
+/**
+ * @brief Returns the columns available to a hex row on each side of a binary diff.
+ */
+static int hex_diff_side_width(const AppState *state) {
+    return (getmaxx(state->right_pane) - 3) / 2;
+}
+
+/**
+ * @brief Loads the content of the current file in the given view mode.
+ *
+ * Text is indexed in place, hex dumps are formatted from the mapped file as
+ * they are drawn, archive listings are generated into `state->content`, directories are listed into `state->dir`, and JSON and
+ * tables are indexed into `state->json` and `state->table`. Executables shown
+ * in hex have their headers parsed into `state->binary`. The longest line
+ * length is updated in all cases.
+ */
+static FatResult load_view_content(AppState *state, ViewMode mode, const ArchivePlugin *handler) {
+    FatResult res = FAT_SUCCESS;
+
+    if (mode == VIEW_MODE_DIRECTORY) {
+        DirListing *dir = malloc(sizeof(DirListing));
+        if (!dir) return FAT_ERROR_MEMORY;
+        res = dir_listing_open(dir, state->filepath);
+        if (res != FAT_SUCCESS) {
+            free(dir);
+            return res;
+        }
+        state->dir = dir;
+        state->max_line_len = 0;
+        for (size_t i = 0; i < dir->count; i++) {
+            size_t len = strlen(dir->entries[i].name);
+            if (len > state->max_line_len) state->max_line_len = len;
+        }
+        return FAT_SUCCESS;
+    }
+
+    if (mode == VIEW_MODE_JSON) {
+        JsonView *json = malloc(sizeof(JsonView));
+        if (!json) return FAT_ERROR_MEMORY;
+        res = json_view_open(json, state->filepath);
+        if (res != FAT_SUCCESS) {
+            free(json);
+            return res;
+        }
+        state->json = json;
+        state->max_line_len = JSON_ROW_MAX_BYTES;
+        return FAT_SUCCESS;
+    }
+
+    if (mode == VIEW_MODE_TABLE) {
+        TableView *table = malloc(sizeof(TableView));
+        if (!table) return FAT_ERROR_MEMORY;
+        res = table_view_open(table, state->filepath);
+        if (res != FAT_SUCCESS) {
+            free(table);
+            return res;
+        }
+        state->table = table;
+        state->max_line_len = table->text.max_line_len;
+        return FAT_SUCCESS;
+    }
+
+    if (mode == VIEW_MODE_NORMAL) {
+        res = line_index_open(&state->line_index, state->filepath);
+        if (res != FAT_SUCCESS) return res;
+        state->max_line_len = state->line_index.max_line_len;
+        return FAT_SUCCESS;
+    }
+
+    if (mode == VIEW_MODE_BINARY_HEX || mode == VIEW_MODE_STRINGS) {
+        HexView *hex = malloc(sizeof(HexView));
+        if (!hex) return FAT_ERROR_MEMORY;
+        res = hex_view_open(hex, state->filepath, &state->config.hex_layout);
+        if (res != FAT_SUCCESS) {
+            free(hex);
+            return res;
+        }
+        state->hex = hex;
+        if (state->right_pane) hex_view_fit(hex, hex_content_width(state));
+        state->max_line_len = hex->row_len;
+        open_binary_format(state);
+        if (mode == VIEW_MODE_STRINGS) return start_strings(state, 0);
+        return FAT_SUCCESS;
+    }
+
+    if (mode == VIEW_MODE_ARCHIVE) {
+        if (!handler) handler = pm_get_handler(state->filepath);
+        res = handler ? handler->list_contents(state->filepath, &state->content) : FAT_ERROR_UNSUPPORTED;
+    }
+    if (res != FAT_SUCCESS) return res;
+
+    state->max_line_len = 0;
+    for (size_t i = 0; i < state->content.count; i++) {
+        size_t len = strlen(state->content.lines[i]);
+        if (len > state->max_line_len) state->max_line_len = len;
+    }
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Formats the metadata line counting what the current view shows.
+ */
+static void format_count(const AppState *state, char *buffer, size_t size) {
+    if (state->view_mode == VIEW_MODE_JSON) {
+        snprintf(buffer, size, "Values: %zu", state->json->value_count);
+    } else if (state->view_mode == VIEW_MODE_TABLE) {
+        snprintf(buffer, size, "Rows: %zu x %zu", state->table->row_count, state->table->column_count);
+    } else if (state->view_mode == VIEW_MODE_STRINGS) {
+        const StringsView *strings = state->strings;
+        snprintf(buffer, size, "Strings: %zu%s", state_line_count(state),
+                 !strings ? "" : strings_view_is_running(strings) ? "..." :
+                 strings->truncated ? " (limit)" : "");
+    } else if (state->view_mode == VIEW_MODE_HEX_DIFF) {
+        const HexDiff *diff = state->hex_diff;
+        snprintf(buffer, size, "Differences: %zu (%llu bytes)%s", diff->count, (unsigned long long)diff->differing_done,
+                 hex_diff_is_running(diff) ? "..." : diff->truncated ? " (limit)" : "");
+    } else if (state->view_mode == VIEW_MODE_ARCHIVE || state->view_mode == VIEW_MODE_DIRECTORY) {
+        snprintf(buffer, size, "Entries: %zu", state_line_count(state));
+    } else if (state->view_mode == VIEW_MODE_NORMAL && !state->stream &&
+               state->line_index.encoding != TEXT_ENCODING_UTF8) {
+        snprintf(buffer, size, "Lines: %zu (%s)", state_line_count(state),
+                 text_encoding_name(state->line_index.encoding));
+    } else {
+        snprintf(buffer, size, "Lines: %zu", state_line_count(state));
+    }
+}
+
+/**
+ * @brief Replaces the metadata line counting what the current view shows.
+ */
+static void update_count_metadata(AppState *state) {
+    if (state->metadata.count == 0) return;
+    char count_buffer[128];
+    format_count(state, count_buffer, sizeof(count_buffer));
+    free(state->metadata.lines[state->metadata.count - 1]);
+    state->metadata.count--;
+    StringList_add(&state->metadata, count_buffer);
+}
+
+/**
+ * @brief Returns true for UTF-16 text without a byte order mark, which libmagic takes for binary data.
+ */
+static bool is_unmarked_utf16(const char *filepath) {
+    TextEncoding encoding;
+    return text_encoding_detect_file(filepath, &encoding) == FAT_SUCCESS &&
+           (encoding == TEXT_ENCODING_UTF16LE || encoding == TEXT_ENCODING_UTF16BE);
+}
+
 /**
  * @brief Initializes or re-initializes the application state for a given file.
  */
@@ -34,9 +241,17 @@ FatResult state_init(AppState *state, const char *filepath) {
     Theme* current_theme = state->theme;
     state->theme = NULL;
 
+    // Directories are tracked by their canonical path, so ".." entries resolve cleanly.
+    char dir_path[PATH_MAX];
+    struct stat path_stat;
+    bool is_directory = strcmp(filepath, "-") != 0 && stat(filepath, &path_stat) == 0 && S_ISDIR(path_stat.st_mode) &&
+                        realpath(filepath, dir_path) != NULL;
+    if (is_directory) filepath = dir_path;
+
     state_destroy_view(state);
 
-    if (state->breadcrumbs.count == 0) {
+    if (!state->resources_loaded) {
+        state->resources_loaded = true;
         StringList_init(&state->breadcrumbs);
         StringList_init(&state->theme_paths);
 
@@ -118,6 +333,7 @@ FatResult state_init(AppState *state, const char *filepath) {
     state->search_results.count = 0;
     state->search_results.capacity = 0;
     state->search_results.current_match_idx = 0;
+    memset(&state->pins, 0, sizeof(state->pins));
 
 
     state->theme = current_theme;
@@ -166,6 +382,14 @@ FatResult state_init(AppState *state, const char *filepath) {
             state->theme->colors[THEME_ELEMENT_HELP_BORDER].bg = COLOR_WHITE;
             state->theme->colors[THEME_ELEMENT_HELP_KEY].fg = COLOR_BLACK;
             state->theme->colors[THEME_ELEMENT_HELP_KEY].bg = COLOR_WHITE;
+            state->theme->colors[THEME_ELEMENT_DIFF_REMOVED].fg = COLOR_WHITE;
+            state->theme->colors[THEME_ELEMENT_DIFF_REMOVED].bg = -1;
+            state->theme->colors[THEME_ELEMENT_DIFF_ADDED].fg = COLOR_WHITE;
+            state->theme->colors[THEME_ELEMENT_DIFF_ADDED].bg = -1;
+            for (int i = THEME_ELEMENT_PIN_1; i <= THEME_ELEMENT_PIN_4; i++) {
+                state->theme->colors[i].fg = COLOR_BLACK;
+                state->theme->colors[i].bg = COLOR_WHITE;
+            }
         }
     }
 
@@ -173,23 +397,55 @@ FatResult state_init(AppState *state, const char *filepath) {
         theme_apply(state->theme);
     }
 
-    res = get_file_info(filepath, &state->metadata);
+    // FIFOs, character devices and /proc files are read as they come, like piped input,
+    // unless the hex view is forced, which reads what it can hold of them.
+    FileSourceKind source_kind = FILE_SOURCE_REGULAR;
+    if (strcmp(filepath, "-") != 0 && !is_directory) file_source_probe(filepath, &source_kind, NULL);
+
+    if (strcmp(filepath, "-") == 0) {
+        res = FAT_ERROR_UNSUPPORTED;
+        if (state->stdin_fd >= 0) {
+            int fd = state->stdin_fd;
+            state->stdin_fd = -1; // Owned (and closed) by the stream from now on
+            res = open_stream_view(state, fd, "(standard input)", 0);
+        }
+    } else if (source_kind == FILE_SOURCE_STREAM && state->force_view_mode != FORCE_VIEW_HEX) {
+        FileSource source;
+        res = file_source_open(&source, filepath, false);
+        if (res == FAT_SUCCESS) {
+            const char *basename = strrchr(filepath, '/');
+            // Devices and /proc files may never end (/dev/zero, /dev/urandom); a FIFO is piped input, read to its end.
+            struct stat st;
+            uint64_t max_size = (fstat(source.fd, &st) == 0 && S_ISFIFO(st.st_mode)) ? 0 : FILE_SOURCE_READ_LIMIT;
+            res = open_stream_view(state, file_source_release(&source), basename ? basename + 1 : filepath, max_size);
+        }
+    } else {
+        res = get_file_info(filepath, &state->metadata);
+    }
     if (res != FAT_SUCCESS) goto cleanup;
 
-    if (state->force_view_mode == FORCE_VIEW_TEXT) {
+    if (state->stream) {
+        // Already loaded by open_stream_view.
+    } else if (is_directory) {
+        state->view_mode = VIEW_MODE_DIRECTORY;
+        res = load_view_content(state, VIEW_MODE_DIRECTORY, NULL);
+    } else if (state->force_view_mode == FORCE_VIEW_TEXT) {
         state->view_mode = VIEW_MODE_NORMAL;
-        res = read_file_content(filepath, &state->content);
-    } else if (state->force_view_mode == FORCE_VIEW_HEX) {
+        res = load_view_content(state, VIEW_MODE_NORMAL, NULL);
+    } else if (state->force_view_mode == FORCE_VIEW_HEX || source_kind == FILE_SOURCE_BLOCK_DEVICE) {
+        // A disk holds no lines worth indexing, so it opens as a hex dump unless text is forced.
         state->view_mode = VIEW_MODE_BINARY_HEX;
-        res = hex_viewer_generate_dump(filepath, &state->content);
+        res = load_view_content(state, VIEW_MODE_BINARY_HEX, NULL);
     } else {
         const ArchivePlugin* handler = pm_get_handler(filepath);
         if (handler) {
             state->view_mode = VIEW_MODE_ARCHIVE;
-            res = handler->list_contents(filepath, &state->content);
+            res = load_view_content(state, VIEW_MODE_ARCHIVE, handler);
         } else {
             magic_t magic_cookie = magic_open(MAGIC_MIME_TYPE);
             bool is_binary = false;
+            bool is_json = false;
+            bool is_table = false;
             if (magic_cookie && magic_load(magic_cookie, NULL) == 0) {
                 const char* magic_full = magic_file(magic_cookie, filepath);
                 if (magic_full) {
@@ -209,11 +465,15 @@ FatResult state_init(AppState *state, const char *filepath) {
                         }
                     }
 
+                    is_json = json_view_detect(filepath, magic_full);
+                    is_table = table_view_detect(filepath, magic_full);
                     if (is_forced_text) {
                         is_binary = false;
                     } else if (is_forced_binary) {
                         is_binary = true;
-                    } else if ((strncmp(magic_full, "application/", 12) == 0 && strcmp(magic_full, "application/json") != 0) ||
+                    } else if (strcmp(magic_full, "application/octet-stream") == 0 && is_unmarked_utf16(filepath)) {
+                        is_binary = false;
+                    } else if ((strncmp(magic_full, "application/", 12) == 0 && !is_json && !is_table) ||
                                strncmp(magic_full, "image/", 6) == 0 ||
                                strncmp(magic_full, "video/", 6) == 0) {
                         is_binary = true;
@@ -222,12 +482,17 @@ FatResult state_init(AppState *state, const char *filepath) {
             }
             if (magic_cookie) magic_close(magic_cookie);
 
-            if (is_binary) {
-                state->view_mode = VIEW_MODE_BINARY_HEX;
-                res = hex_viewer_generate_dump(filepath, &state->content);
+            state->view_mode = is_binary ? VIEW_MODE_BINARY_HEX : VIEW_MODE_NORMAL;
+            if (!is_binary && (is_json || is_table)) {
+                state->view_mode = is_json ? VIEW_MODE_JSON : VIEW_MODE_TABLE;
+                res = load_view_content(state, state->view_mode, NULL);
+                if (res != FAT_SUCCESS) {
+                    LOG_INFO("Could not index '%s' as %s, showing it as text", filepath, is_json ? "JSON" : "a table");
+                    state->view_mode = VIEW_MODE_NORMAL;
+                    res = load_view_content(state, VIEW_MODE_NORMAL, NULL);
+                }
             } else {
-                state->view_mode = VIEW_MODE_NORMAL;
-                res = read_file_content(filepath, &state->content);
+                res = load_view_content(state, state->view_mode, NULL);
             }
         }
     }
@@ -235,19 +500,13 @@ FatResult state_init(AppState *state, const char *filepath) {
     if (res != FAT_SUCCESS) goto cleanup;
 
     char count_buffer[128];
-    snprintf(count_buffer, sizeof(count_buffer), "%s: %zu",
-        state->view_mode == VIEW_MODE_ARCHIVE ? "Entries" : "Lines",
-        state->content.count);
+    format_count(state, count_buffer, sizeof(count_buffer));
     if (StringList_add(&state->metadata, count_buffer) != FAT_SUCCESS) {
         res = FAT_ERROR_MEMORY;
         goto cleanup;
     }
-
-    state->max_line_len = 0;
-    for (size_t i = 0; i < state->content.count; i++) {
-        size_t len = strlen(state->content.lines[i]);
-        if (len > state->max_line_len) state->max_line_len = len;
-    }
+    // A short stream may have been read whole while it was waited for.
+    if (state->stream) update_stream_metadata(state);
 
     return FAT_SUCCESS;
 
@@ -256,14 +515,57 @@ cleanup:
     return res;
 }
 
+/**
+ * @brief Frees the content of the current view, keeping its file and metadata.
+ */
+static void free_view_content(AppState *state) {
+    free_filter(&state->filter);
+    free_time_index(&state->time_index); // Reads the line index, so it goes first
+    free_histogram(&state->histogram);
+    free_archive_grep(&state->archive_grep);
+    free_tree_grep(&state->tree_grep);
+    StringList_free(&state->content);
+    line_index_free(&state->line_index);
+    if (state->dir) {
+        dir_listing_free(state->dir);
+        free(state->dir);
+        state->dir = NULL;
+    }
+    if (state->json) {
+        json_view_free(state->json);
+        free(state->json);
+        state->json = NULL;
+    }
+    if (state->table) {
+        table_view_free(state->table);
+        free(state->table);
+        state->table = NULL;
+    }
+    free_strings(&state->strings); // Reads the mapped bytes, so it goes first
+    free_byte_map(&state->byte_map);
+    if (state->hex) {
+        hex_view_free(state->hex);
+        free(state->hex);
+        state->hex = NULL;
+    }
+    if (state->binary) {
+        binary_format_free(state->binary);
+        free(state->binary);
+        state->binary = NULL;
+    }
+}
+
 /**
  * @brief Reloads the content for the current file in a new view mode.
  */
 FatResult state_reload_content(AppState *state, ViewMode new_mode) {
     FatResult res = FAT_SUCCESS;
 
+    // Streams cannot be read a second time.
+    if (state->stream) return FAT_ERROR_UNSUPPORTED;
+
     // Free the old content and metadata related to content size
-    StringList_free(&state->content);
+    free_view_content(state);
     if (state->metadata.count > 0) {
         free(state->metadata.lines[state->metadata.count - 1]);
         state->metadata.count--;
@@ -272,32 +574,25 @@ FatResult state_reload_content(AppState *state, ViewMode new_mode) {
     state->view_mode = new_mode;
 
     // Reload content based on the new mode
-    if (new_mode == VIEW_MODE_NORMAL) {
-        res = read_file_content(state->filepath, &state->content);
-    } else if (new_mode == VIEW_MODE_BINARY_HEX) {
-        res = hex_viewer_generate_dump(state->filepath, &state->content);
+    res = load_view_content(state, new_mode, NULL);
+    if (res != FAT_SUCCESS && (new_mode == VIEW_MODE_JSON || new_mode == VIEW_MODE_TABLE)) {
+        state->view_mode = VIEW_MODE_NORMAL;
+        res = load_view_content(state, VIEW_MODE_NORMAL, NULL);
     }
-
     if (res != FAT_SUCCESS) {
         return res;
     }
     
     // Update metadata with the new line count
     char count_buffer[128];
-    snprintf(count_buffer, sizeof(count_buffer), "Lines: %zu", state->content.count);
+    format_count(state, count_buffer, sizeof(count_buffer));
     StringList_add(&state->metadata, count_buffer);
-
-    // Recalculate max line length
-    state->max_line_len = 0;
-    for (size_t i = 0; i < state->content.count; i++) {
-        size_t len = strlen(state->content.lines[i]);
-        if (len > state->max_line_len) state->max_line_len = len;
-    }
     
     // Reset view state
     state->top_line = 0;
     state->left_char = 0;
     state->search_term_active = false;
+    pins_reset_index(&state->pins);
 
     return FAT_SUCCESS;
 }
@@ -309,12 +604,299 @@ FatResult state_reload_content(AppState *state, ViewMode new_mode) {
 void state_destroy_view(AppState *state) {
     if (!state) return;
     StringList_free(&state->metadata);
+    free_filter(&state->filter); // Reads the content, so it goes first
+    free_time_index(&state->time_index);
+    free_histogram(&state->histogram);
+    free_archive_grep(&state->archive_grep);
+    free_tree_grep(&state->tree_grep);
     StringList_free(&state->content);
+    line_index_free(&state->line_index);
+    if (state->diff) {
+        diff_free(state->diff);
+        free(state->diff);
+        state->diff = NULL;
+    }
+    free_hex_diff(&state->hex_diff);
+    if (state->dir) {
+        dir_listing_free(state->dir);
+        free(state->dir);
+        state->dir = NULL;
+    }
+    if (state->stream) {
+        stream_input_free(state->stream);
+        free(state->stream);
+        state->stream = NULL;
+    }
+    if (state->json) {
+        json_view_free(state->json);
+        free(state->json);
+        state->json = NULL;
+    }
+    if (state->table) {
+        table_view_free(state->table);
+        free(state->table);
+        state->table = NULL;
+    }
+    free_strings(&state->strings); // Reads the mapped bytes, so it goes first
+    free_byte_map(&state->byte_map);
+    free_checksums(&state->checksums);
+    if (state->hex) {
+        hex_view_free(state->hex);
+        free(state->hex);
+        state->hex = NULL;
+    }
+    if (state->binary) {
+        binary_format_free(state->binary);
+        free(state->binary);
+        state->binary = NULL;
+    }
     state->search_term_active = false;
     free(state->filepath);
     state->filepath = NULL;
-    free(state->search_results.matches);
-    state->search_results.matches = NULL;
+    search_results_free(&state->search_results);
+    pins_free(&state->pins);
+}
+
+/**
+ * @brief Moves the current view out of the state and into a snapshot.
+ */
+static void view_snapshot_take(AppState *state, ViewSnapshot *snap) {
+    snap->filepath = state->filepath;
+    snap->metadata = state->metadata;
+    snap->content = state->content;
+    snap->line_index = state->line_index;
+    snap->diff = state->diff;
+    snap->hex_diff = state->hex_diff;
+    snap->dir = state->dir;
+    snap->stream = state->stream;
+    snap->filter = state->filter;
+    snap->archive_grep = state->archive_grep;
+    snap->tree_grep = state->tree_grep;
+    snap->time_index = state->time_index;
+    snap->histogram = state->histogram;
+    snap->json = state->json;
+    snap->table = state->table;
+    snap->hex = state->hex;
+    snap->byte_map = state->byte_map;
+    snap->checksums = state->checksums;
+    snap->strings = state->strings;
+    snap->binary = state->binary;
+    snap->max_line_len = state->max_line_len;
+    snap->view_mode = state->view_mode;
+    snap->top_line = state->top_line;
+    snap->left_char = state->left_char;
+    snap->line_wrap_enabled = state->line_wrap_enabled;
+    memcpy(snap->search_term, state->search_term, sizeof(snap->search_term));
+    snap->search_term_active = state->search_term_active;
+    snap->search_results = state->search_results;
+    snap->pins = state->pins;
+
+    state->filepath = NULL;
+    StringList_init(&state->metadata);
+    StringList_init(&state->content);
+    line_index_init(&state->line_index);
+    state->diff = NULL;
+    state->hex_diff = NULL;
+    state->dir = NULL;
+    state->stream = NULL;
+    state->filter = NULL;
+    state->archive_grep = NULL;
+    state->tree_grep = NULL;
+    state->time_index = NULL;
+    state->histogram = NULL;
+    state->json = NULL;
+    state->table = NULL;
+    state->hex = NULL;
+    state->byte_map = NULL;
+    state->checksums = NULL;
+    state->strings = NULL;
+    state->binary = NULL;
+    state->search_term_active = false;
+    memset(&state->search_results, 0, sizeof(state->search_results));
+    memset(&state->pins, 0, sizeof(state->pins));
+}
+
+/**
+ * @brief Moves a snapshot back into the state. The state must hold no view.
+ */
+static void view_snapshot_restore(AppState *state, ViewSnapshot *snap) {
+    state->filepath = snap->filepath;
+    state->metadata = snap->metadata;
+    state->content = snap->content;
+    state->line_index = snap->line_index;
+    state->diff = snap->diff;
+    state->hex_diff = snap->hex_diff;
+    state->dir = snap->dir;
+    state->stream = snap->stream;
+    state->filter = snap->filter;
+    state->archive_grep = snap->archive_grep;
+    state->tree_grep = snap->tree_grep;
+    state->time_index = snap->time_index;
+    state->histogram = snap->histogram;
+    state->json = snap->json;
+    state->table = snap->table;
+    state->hex = snap->hex;
+    state->byte_map = snap->byte_map;
+    state->checksums = snap->checksums;
+    state->strings = snap->strings;
+    state->binary = snap->binary;
+    state->max_line_len = snap->max_line_len;
+    state->view_mode = snap->view_mode;
+    state->top_line = snap->top_line;
+    state->left_char = snap->left_char;
+    state->line_wrap_enabled = snap->line_wrap_enabled;
+    memcpy(state->search_term, snap->search_term, sizeof(state->search_term));
+    state->search_term_active = snap->search_term_active;
+    state->search_results = snap->search_results;
+    state->pins = snap->pins;
+    state->mode = MODE_NORMAL;
+
+    memset(snap, 0, sizeof(*snap));
+}
+
+/**
+ * @brief Frees everything owned by a snapshot.
+ */
+static void view_snapshot_free(ViewSnapshot *snap) {
+    free(snap->filepath);
+    free_filter(&snap->filter);
+    free_archive_grep(&snap->archive_grep);
+    free_tree_grep(&snap->tree_grep);
+    free_time_index(&snap->time_index);
+    free_histogram(&snap->histogram);
+    StringList_free(&snap->metadata);
+    StringList_free(&snap->content);
+    line_index_free(&snap->line_index);
+    if (snap->diff) {
+        diff_free(snap->diff);
+        free(snap->diff);
+    }
+    free_hex_diff(&snap->hex_diff);
+    if (snap->dir) {
+        dir_listing_free(snap->dir);
+        free(snap->dir);
+    }
+    if (snap->stream) {
+        stream_input_free(snap->stream);
+        free(snap->stream);
+    }
+    if (snap->json) {
+        json_view_free(snap->json);
+        free(snap->json);
+    }
+    if (snap->table) {
+        table_view_free(snap->table);
+        free(snap->table);
+    }
+    free_strings(&snap->strings);
+    free_byte_map(&snap->byte_map);
+    free_checksums(&snap->checksums);
+    if (snap->hex) {
+        hex_view_free(snap->hex);
+        free(snap->hex);
+    }
+    if (snap->binary) {
+        binary_format_free(snap->binary);
+        free(snap->binary);
+    }
+    search_results_free(&snap->search_results);
+    pins_free(&snap->pins);
+    memset(snap, 0, sizeof(*snap));
+}
+
+/**
+ * @brief Moves the current view into the view cache before navigating deeper.
+ */
+void state_cache_view(AppState *state) {
+    if (!state || !state->filepath) return;
+    ViewCache *cache = &state->view_cache;
+
+    // Replace an older view of the same file, else take a free slot,
+    // else evict the least recently used view.
+    size_t slot = 0;
+    bool found = false;
+    for (size_t i = 0; i < VIEW_CACHE_SIZE && !found; i++) {
+        if (cache->last_used[i] != 0 && strcmp(cache->entries[i].filepath, state->filepath) == 0) {
+            slot = i;
+            found = true;
+        }
+    }
+    for (size_t i = 0; i < VIEW_CACHE_SIZE && !found; i++) {
+        if (cache->last_used[i] == 0) {
+            slot = i;
+            break;
+        }
+        if (cache->last_used[i] < cache->last_used[slot]) slot = i;
+    }
+
+    if (cache->last_used[slot] != 0) {
+        LOG_INFO("Evicting cached view for '%s'", cache->entries[slot].filepath);
+        view_snapshot_free(&cache->entries[slot]);
+    }
+
+    view_snapshot_take(state, &cache->entries[slot]);
+    cache->last_used[slot] = ++cache->clock;
+}
+
+/**
+ * @brief Returns true for the breadcrumb of a grep view.
+ */
+static bool is_grep_crumb(const char *crumb) {
+    return strncmp(crumb, GREP_CRUMB_PREFIX, strlen(GREP_CRUMB_PREFIX)) == 0;
+}
+
+/**
+ * @brief Pops the current breadcrumb and returns to the parent view.
+ */
+FatResult state_go_back(AppState *state) {
+    if (state->breadcrumbs.count < 2) return FAT_ERROR_INVALID_ARGUMENT;
+
+    char *current = state->breadcrumbs.lines[--state->breadcrumbs.count];
+    const char *parent = state->breadcrumbs.lines[state->breadcrumbs.count - 1];
+
+    // Only files extracted from an archive are temporary. A file opened from a
+    // directory listing or a grep hit is the user's own, whatever its name.
+    struct stat parent_stat;
+    if (!is_grep_crumb(parent) && (stat(parent, &parent_stat) != 0 || !S_ISDIR(parent_stat.st_mode))) {
+        cleanup_temp_file_if_exists(current);
+    }
+    free(current);
+    ViewCache *cache = &state->view_cache;
+    for (size_t i = 0; i < VIEW_CACHE_SIZE; i++) {
+        if (cache->last_used[i] != 0 && strcmp(cache->entries[i].filepath, parent) == 0) {
+            LOG_INFO("Restoring cached view for '%s'", parent);
+            state_destroy_view(state);
+            view_snapshot_restore(state, &cache->entries[i]);
+            cache->last_used[i] = 0;
+            return FAT_SUCCESS;
+        }
+    }
+
+    if (is_grep_crumb(parent)) {
+        // The hits were evicted, so search the directory under them again.
+        char *crumb = state->breadcrumbs.lines[--state->breadcrumbs.count];
+        FatResult res = state_init(state, state->breadcrumbs.lines[state->breadcrumbs.count - 1]);
+        if (res == FAT_SUCCESS) res = state_open_grep(state, crumb + strlen(GREP_CRUMB_PREFIX));
+        free(crumb);
+        return res;
+    }
+    return state_init(state, parent);
+}
+
+/**
+ * @brief Removes the temporary files extracted from archives along a navigation history.
+ *
+ * The first breadcrumb was opened by the user and entries opened from a
+ * directory listing or a grep view are real files, so neither is touched.
+ */
+static void remove_extracted_files(const StringList *breadcrumbs, const char *temp_file_prefix) {
+    for (size_t i = 1; i < breadcrumbs->count; ++i) {
+        if (strncmp(breadcrumbs->lines[i], temp_file_prefix, strlen(temp_file_prefix)) != 0) continue;
+        struct stat parent_stat;
+        if (is_grep_crumb(breadcrumbs->lines[i - 1])) continue;
+        if (stat(breadcrumbs->lines[i - 1], &parent_stat) == 0 && S_ISDIR(parent_stat.st_mode)) continue;
+        remove(breadcrumbs->lines[i]);
+    }
 }
 
 /**
@@ -324,6 +906,16 @@ void full_app_reset(AppState* state) {
     if (!state) return;
 
     state_destroy_view(state);
+    if (state->stdin_fd >= 0) {
+        close(state->stdin_fd);
+        state->stdin_fd = -1;
+    }
+    for (size_t i = 0; i < VIEW_CACHE_SIZE; i++) {
+        if (state->view_cache.last_used[i] != 0) {
+            view_snapshot_free(&state->view_cache.entries[i]);
+            state->view_cache.last_used[i] = 0;
+        }
+    }
 
     if (state->left_pane) { delwin(state->left_pane); state->left_pane = NULL; }
     if (state->right_pane) { delwin(state->right_pane); state->right_pane = NULL; }
@@ -348,56 +940,1736 @@ void full_app_reset(AppState* state) {
         snprintf(temp_file_prefix, sizeof(temp_file_prefix), "%s/fat-", temp_dir_path);
     #endif
 
-    for(size_t i = 0; i < state->breadcrumbs.count; ++i) {
-        if (strncmp(state->breadcrumbs.lines[i], temp_file_prefix, strlen(temp_file_prefix)) == 0) {
-            remove(state->breadcrumbs.lines[i]);
+    remove_extracted_files(&state->breadcrumbs, temp_file_prefix);
+    StringList_free(&state->breadcrumbs);
+
+    for (size_t b = 0; b < state->buffer_count; b++) {
+        Buffer *buffer = &state->buffers[b];
+        remove_extracted_files(&buffer->breadcrumbs, temp_file_prefix);
+        StringList_free(&buffer->breadcrumbs);
+        view_snapshot_free(&buffer->view);
+    }
+    free(state->buffers);
+    state->buffers = NULL;
+    state->buffer_count = 0;
+}
+
+/**
+ * @brief Returns the number of lines in the current view before filtering.
+ */
+size_t state_total_line_count(const AppState *state) {
+    if (state->stream) return state->stream->line_count;
+    if (state->view_mode == VIEW_MODE_NORMAL) return state->line_index.count;
+    if (state->view_mode == VIEW_MODE_DIFF && state->diff) {
+        DiffProgress progress;
+        diff_get_progress(state->diff, &progress);
+        return progress.row_count;
+    }
+    if (state->view_mode == VIEW_MODE_DIRECTORY) return state->dir ? state->dir->count : 0;
+    if (state->view_mode == VIEW_MODE_GREP) return state->tree_grep ? state->tree_grep->count : 0;
+    if (state->view_mode == VIEW_MODE_JSON) return state->json ? state->json->row_count : 0;
+    if (state->view_mode == VIEW_MODE_TABLE) return state->table ? state->table->row_count : 0;
+    if (state->view_mode == VIEW_MODE_BINARY_HEX) return state->hex ? state->hex->row_count : 0;
+    if (state->view_mode == VIEW_MODE_STRINGS) return state->strings ? state->strings->count : 0;
+    if (state->view_mode == VIEW_MODE_HEX_DIFF) return state->hex_diff ? state->hex_diff->row_count : 0;
+    return state->content.count;
+}
+
+/**
+ * @brief Returns the number of lines in the current view.
+ */
+size_t state_line_count(const AppState *state) {
+    if (state->archive_grep) return state->archive_grep->count;
+    if (state->filter) return state->filter->count;
+    return state_total_line_count(state);
+}
+
+/**
+ * @brief Returns the line number in the unfiltered content of a line of the current view.
+ */
+size_t state_line_number(const AppState *state, size_t idx) {
+    if (state->archive_grep && idx < state->archive_grep->count) return state->archive_grep->hits[idx].entry;
+    if (state->filter && idx < state->filter->count) return state->filter->lines[idx];
+    // Table rows are numbered by their line in the file, header included.
+    if (state->view_mode == VIEW_MODE_TABLE && state->table && idx < state->table->row_count) {
+        return table_view_line(state->table, idx);
+    }
+    return idx;
+}
+
+/**
+ * @brief Finds the first line of the current view at or after a line of the unfiltered content.
+ */
+size_t state_find_line_number(const AppState *state, size_t line_number) {
+    if (state->view_mode == VIEW_MODE_TABLE && state->table) {
+        if (!state->table->order) return line_number > 0 ? line_number - 1 : 0;
+        for (size_t row = 0; row < state->table->row_count; row++) {
+            if (state->table->order[row] == line_number) return row;
+        }
+        return state->table->row_count;
+    }
+    if (state->archive_grep) {
+        // Entries are listed in the order they were found.
+        for (size_t i = 0; i < state->archive_grep->count; i++) {
+            if (state->archive_grep->hits[i].entry == line_number) return i;
         }
+        return state->archive_grep->count;
+    }
+    if (!state->filter) return line_number;
+    size_t low = 0, high = state->filter->count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (state->filter->lines[mid] < line_number) low = mid + 1; else high = mid;
     }
+    return low;
+}
 
-    StringList_free(&state->breadcrumbs);
+/**
+ * @brief Scrolls the hex view to the line holding a file offset.
+ */
+void state_jump_to_offset(AppState *state, uint64_t offset) {
+    if (!state->hex) return;
+    size_t count = state_line_count(state);
+    size_t row = state_find_line_number(state, hex_view_offset_row(state->hex, offset));
+    state->top_line = row < count ? (int)row : (count > 0 ? (int)count - 1 : 0);
+    state->left_char = 0;
 }
 
 /**
- * @brief Performs a search for the current search term and populates the search_results list.
+ * @brief Re-fits the hex view to the width of the pane when its layout adapts to it.
  */
-FatResult state_perform_search(AppState *state) {
-    // Clear previous results
-    free(state->search_results.matches);
-    state->search_results.matches = NULL;
+void state_fit_hex_view(AppState *state) {
+    if (state->view_mode == VIEW_MODE_HEX_DIFF && state->hex_diff && state->right_pane) {
+        HexDiff *diff = state->hex_diff;
+        uint64_t top_offset = (uint64_t)state->top_line * (uint64_t)diff->a.bytes_per_row;
+        if (!hex_diff_fit(diff, hex_diff_side_width(state))) return;
+        state->top_line = (int)(top_offset / (uint64_t)diff->a.bytes_per_row);
+        state->max_line_len = diff->a.row_len;
+        return;
+    }
+    if (state->view_mode != VIEW_MODE_BINARY_HEX || !state->hex || !state->right_pane) return;
+    size_t top_row = state_line_count(state) > 0 ? state_line_number(state, (size_t)state->top_line) : 0;
+    uint64_t top_offset = hex_view_row_offset(state->hex, top_row);
+    if (!hex_view_fit(state->hex, hex_content_width(state))) return;
+
+    // Rows now hold different bytes, so line-based results no longer apply.
+    free_filter(&state->filter);
+    state->search_term_active = false;
     state->search_results.count = 0;
-    state->search_results.capacity = 0;
-    state->search_results.current_match_idx = 0;
+    pins_reset_index(&state->pins);
+    state->max_line_len = state->hex->row_len;
+    state_jump_to_offset(state, top_offset);
+    update_count_metadata(state);
+}
 
-    if (!state->search_term_active || state->search_term[0] == '\0') {
-        return FAT_SUCCESS;
+/**
+ * @brief Stops and drops whatever was found in the lines of a text file, before the lines change.
+ */
+static void drop_line_results(AppState *state) {
+    free_filter(&state->filter);
+    free_time_index(&state->time_index);
+    free_histogram(&state->histogram);
+    state->search_term_active = false;
+    state->search_results.count = 0;
+    pins_reset_index(&state->pins);
+}
+
+/**
+ * @brief Cuts a text file that was truncated while open down to its new size.
+ * @return True if the view changed.
+ */
+static bool truncation_step(AppState *state) {
+    if (state->view_mode != VIEW_MODE_NORMAL || state->stream || !state->filepath) return false;
+    LineIndex *index = &state->line_index;
+    if (!line_index_take_fault(index)) return false;
+
+    // The pages past the new end already read as zeros; the lines there go, with whatever was found in them.
+    drop_line_results(state);
+    if (!line_index_recheck(index, state->filepath)) return true;
+    if ((size_t)state->top_line >= index->count) state->top_line = index->count > 0 ? (int)index->count - 1 : 0;
+    update_count_metadata(state);
+    return true;
+}
+
+/**
+ * @brief Reads the current text file in the next encoding the system can convert from.
+ */
+FatResult state_cycle_encoding(AppState *state) {
+    if (state->view_mode != VIEW_MODE_NORMAL || state->stream) return FAT_ERROR_UNSUPPORTED;
+
+    // The lines are about to be replaced, so whatever was found in them goes first.
+    drop_line_results(state);
+
+    LineIndex *index = &state->line_index;
+    TextEncoding current = index->encoding;
+    TextEncoding next = current;
+    FatResult res = FAT_ERROR_UNSUPPORTED;
+    while (res == FAT_ERROR_UNSUPPORTED) {
+        next = (TextEncoding)((next + 1) % TEXT_ENCODING_COUNT);
+        if (next == current) return FAT_ERROR_UNSUPPORTED;
+        res = line_index_set_encoding(index, next);
     }
+    if (res != FAT_SUCCESS) return res;
 
-    for (size_t i = 0; i < state->content.count; i++) {
-        const char* line = state->content.lines[i];
-        const char* ptr = line;
-        while ((ptr = strstr(ptr, state->search_term)) != NULL) {
-            if (state->search_results.count >= state->search_results.capacity) {
-                size_t new_capacity = (state->search_results.capacity == 0) ? 8 : state->search_results.capacity * 2;
-                SearchMatch* new_matches = realloc(state->search_results.matches, new_capacity * sizeof(SearchMatch));
-                if (!new_matches) {
-                    return FAT_ERROR_MEMORY;
-                }
-                state->search_results.matches = new_matches;
-                state->search_results.capacity = new_capacity;
-            }
+    LOG_INFO("Reading '%s' as %s", state->filepath, text_encoding_name(next));
+    state->max_line_len = index->max_line_len;
+    if ((size_t)state->top_line >= index->count) state->top_line = index->count > 0 ? (int)index->count - 1 : 0;
+    state->left_char = 0;
+    update_count_metadata(state);
+    return FAT_SUCCESS;
+}
 
-            state->search_results.matches[state->search_results.count].line_idx = i;
-            state->search_results.matches[state->search_results.count].char_idx = (size_t)(ptr - line);
-            state->search_results.count++;
-            ptr++; // Move past the beginning of the current match
+/**
+ * @brief Returns a line of the current view, which is not null-terminated.
+ */
+const char *state_get_line(const AppState *state, size_t idx, size_t *len) {
+    if (state->archive_grep) {
+        if (idx >= state->archive_grep->count) {
+            *len = 0;
+            return NULL;
+        }
+        *len = strlen(state->archive_grep->hits[idx].row);
+        return state->archive_grep->hits[idx].row;
+    }
+    if (state->filter) {
+        if (idx >= state->filter->count) {
+            *len = 0;
+            return NULL;
+        }
+        idx = state->filter->lines[idx];
+    }
+    if (state->stream) {
+        return stream_input_get_line(state->stream, idx, len);
+    }
+    if (state->view_mode == VIEW_MODE_NORMAL) {
+        return line_index_get(&state->line_index, idx, len);
+    }
+    if (state->view_mode == VIEW_MODE_JSON) {
+        if (!state->json) {
+            *len = 0;
+            return NULL;
+        }
+        return json_view_get_row(state->json, idx, len);
+    }
+    if (state->view_mode == VIEW_MODE_TABLE) {
+        if (!state->table || idx >= state->table->row_count) {
+            *len = 0;
+            return NULL;
         }
+        return line_index_get(&state->table->text, table_view_line(state->table, idx), len);
     }
+    if (state->view_mode == VIEW_MODE_BINARY_HEX) {
+        if (!state->hex) {
+            *len = 0;
+            return NULL;
+        }
+        return hex_view_get_row(state->hex, idx, len);
+    }
+    if (state->view_mode == VIEW_MODE_STRINGS) {
+        if (!state->strings) {
+            *len = 0;
+            return NULL;
+        }
+        return strings_view_get_row(state->strings, idx, len);
+    }
+    if (state->view_mode == VIEW_MODE_DIRECTORY) {
+        if (!state->dir || idx >= state->dir->count) {
+            *len = 0;
+            return NULL;
+        }
+        *len = strlen(state->dir->entries[idx].name);
+        return state->dir->entries[idx].name;
+    }
+    if (state->view_mode == VIEW_MODE_GREP) {
+        if (!state->tree_grep || idx >= state->tree_grep->count) {
+            *len = 0;
+            return NULL;
+        }
+        *len = strlen(state->tree_grep->hits[idx].row);
+        return state->tree_grep->hits[idx].row;
+    }
+    if (state->view_mode == VIEW_MODE_DIFF || state->view_mode == VIEW_MODE_HEX_DIFF || idx >= state->content.count) {
+        *len = 0;
+        return NULL;
+    }
+    *len = strlen(state->content.lines[idx]);
+    return state->content.lines[idx];
+}
 
-    if (state->search_results.count > 0) {
-        // Jump to the first match
-        state->top_line = (int)state->search_results.matches[0].line_idx;
-        return FAT_SUCCESS;
+// **Streams**
+
+/**
+ * @brief Rewrites the "Received" and "Lines" metadata of a stream view.
+ *
+ * Both are the last two metadata lines, as added by `open_stream_view` and `state_init`.
+ */
+static void update_stream_metadata(AppState *state) {
+    StreamInput *stream = state->stream;
+    state->max_line_len = stream->max_line_len;
+    if (state->metadata.count < 2) return;
+
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer), "Received: %llu bytes%s", (unsigned long long)stream->size,
+             stream_input_is_reading(stream) ? "..." : (stream->view_is_truncated ? " (capped)" : ""));
+    char *received = strdup(buffer);
+    snprintf(buffer, sizeof(buffer), "Lines: %zu", stream->line_count);
+    char *lines = strdup(buffer);
+    if (!received || !lines) {
+        free(received);
+        free(lines);
+        return;
     }
+    free(state->metadata.lines[state->metadata.count - 2]);
+    free(state->metadata.lines[state->metadata.count - 1]);
+    state->metadata.lines[state->metadata.count - 2] = received;
+    state->metadata.lines[state->metadata.count - 1] = lines;
+}
 
-    return FAT_ERROR_FILE_NOT_FOUND;
+/**
+ * @brief Starts reading a stream (piped standard input, a FIFO, a device) and fills in its metadata.
+ *
+ * The stream takes the descriptor over and reads at most `max_size` bytes
+ * (0 = to the end). The first chunk is waited for briefly so the first screen
+ * is not empty when the data is already there.
+ */
+static FatResult open_stream_view(AppState *state, int fd, const char *name, uint64_t max_size) {
+    StreamInput *stream = malloc(sizeof(StreamInput));
+    if (!stream) {
+        close(fd);
+        return FAT_ERROR_MEMORY;
+    }
+    FatResult res = stream_input_open(stream, fd, state->config.stdin_memory_limit, max_size);
+    if (res != FAT_SUCCESS) {
+        free(stream);
+        return res;
+    }
+    state->stream = stream;
+    state->view_mode = VIEW_MODE_NORMAL;
+
+    char buffer[512];
+    snprintf(buffer, sizeof(buffer), "File: %s", name);
+    if (StringList_add(&state->metadata, buffer) != FAT_SUCCESS ||
+        StringList_add(&state->metadata, "Type: stream") != FAT_SUCCESS ||
+        StringList_add(&state->metadata, "Received: 0 bytes") != FAT_SUCCESS) {
+        return FAT_ERROR_MEMORY;
+    }
+
+    for (int waited_ms = 0; waited_ms < 200 && stream->line_count == 0 && stream_input_is_reading(stream); waited_ms += 10) {
+        stream_input_poll(stream);
+        if (stream->line_count == 0) napms(10);
+    }
+    state->max_line_len = stream->max_line_len;
+    return FAT_SUCCESS;
+}
+
+// **Diff**
+
+/**
+ * @brief Stops and frees a binary diff, leaving the pointer NULL.
+ */
+static void free_hex_diff(HexDiff **diff) {
+    if (!*diff) return;
+    hex_diff_free(*diff);
+    free(*diff);
+    *diff = NULL;
+}
+
+/**
+ * @brief Replaces the hex view of the current file with a binary diff against another file.
+ */
+static FatResult open_hex_diff(AppState *state, const char *other_path) {
+    HexDiff *diff = malloc(sizeof(HexDiff));
+    if (!diff) return FAT_ERROR_MEMORY;
+
+    FatResult res = hex_diff_start(diff, state->filepath, other_path, &state->config.hex_layout);
+    if (res != FAT_SUCCESS) {
+        free(diff);
+        return res;
+    }
+
+    // The diff maps both files itself, and counts differences rather than rows.
+    free_view_content(state);
+    if (state->metadata.count > 0) {
+        free(state->metadata.lines[state->metadata.count - 1]);
+        state->metadata.count--;
+    }
+    state->hex_diff = diff;
+    state->view_mode = VIEW_MODE_HEX_DIFF;
+    state->top_line = 0;
+    state->left_char = 0;
+    state->search_term_active = false;
+    pins_reset_index(&state->pins);
+    state->max_line_len = diff->a.row_len;
+    state_fit_hex_view(state);
+
+    char buffer[PATH_MAX + 32];
+    snprintf(buffer, sizeof(buffer), "Compared to: %s", other_path);
+    StringList_add(&state->metadata, buffer);
+    snprintf(buffer, sizeof(buffer), "Size (right): %zu bytes", diff->b.bytes.size);
+    StringList_add(&state->metadata, buffer);
+    format_count(state, buffer, sizeof(buffer));
+    StringList_add(&state->metadata, buffer);
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Replaces the current view with a side-by-side diff against another file.
+ */
+FatResult state_open_diff(AppState *state, const char *other_path) {
+    if (state->view_mode == VIEW_MODE_BINARY_HEX) return open_hex_diff(state, other_path);
+
+    DiffView *diff = malloc(sizeof(DiffView));
+    if (!diff) return FAT_ERROR_MEMORY;
+
+    FatResult res = diff_start(diff, state->filepath, other_path);
+    if (res != FAT_SUCCESS) {
+        free(diff);
+        return res;
+    }
+
+    // The diff holds its own index of both files.
+    StringList_free(&state->content);
+    line_index_free(&state->line_index);
+    state->diff = diff;
+    state->view_mode = VIEW_MODE_DIFF;
+    state->top_line = 0;
+    state->left_char = 0;
+    state->search_term_active = false;
+    pins_reset_index(&state->pins);
+    state->max_line_len = diff->a.max_line_len > diff->b.max_line_len ? diff->a.max_line_len : diff->b.max_line_len;
+
+    char buffer[PATH_MAX + 32];
+    snprintf(buffer, sizeof(buffer), "Compared to: %s", other_path);
+    StringList_add(&state->metadata, buffer);
+    snprintf(buffer, sizeof(buffer), "Lines (right): %zu", diff->b.count);
+    StringList_add(&state->metadata, buffer);
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Returns true while background work is still changing what is on screen.
+ */
+bool state_has_pending_work(AppState *state) {
+    if (state->stream && stream_input_poll(state->stream)) update_stream_metadata(state);
+    // A truncated file is redrawn once more, without the lines it lost.
+    if (truncation_step(state)) return true;
+    // Counted first, as the checks below stop at the first one still busy.
+    bool counting = timeline_step(state);
+    if (byte_map_step(state)) counting = true;
+    if (checksums_step(state)) counting = true;
+    if (strings_step(state)) return true;
+    if (state->view_mode == VIEW_MODE_HEX_DIFF && state->hex_diff) {
+        if (hex_diff_poll(state->hex_diff)) update_count_metadata(state);
+        if (hex_diff_is_running(state->hex_diff)) return true;
+    }
+    if (state->stream && stream_input_is_reading(state->stream)) return true;
+    if (state->filter) {
+        line_filter_poll(state->filter);
+        if (line_filter_is_running(state->filter)) return true;
+    }
+    if (state->archive_grep) {
+        archive_grep_poll(state->archive_grep);
+        if (archive_grep_is_running(state->archive_grep)) return true;
+    }
+    if (state->tree_grep) {
+        tree_grep_poll(state->tree_grep);
+        if (tree_grep_is_running(state->tree_grep)) return true;
+    }
+    if (state->view_mode == VIEW_MODE_DIFF && state->diff) {
+        DiffProgress progress;
+        diff_get_progress(state->diff, &progress);
+        if (!progress.is_done) return true;
+    }
+    if (state->view_mode == VIEW_MODE_DIRECTORY && state->dir && dir_listing_is_probing(state->dir)) {
+        return true;
+    }
+    if (state->search_term_active && state->search_results.is_scanning) {
+        // The search runs on this thread, a slice per poll, between keystrokes.
+        state_search_step(state, SEARCH_POLL_BUDGET_MS);
+        if (state->search_results.is_scanning) return true;
+    }
+    if (pins_step(state, SEARCH_POLL_BUDGET_MS)) return true;
+    if (state->view_mode == VIEW_MODE_TABLE && state->table) {
+        if (table_view_sort_poll(state->table)) {
+            state->top_line = 0;
+            state->search_term_active = false; // Matches refer to the previous order
+            state->search_results.count = 0;
+            pins_reset_index(&state->pins);
+        }
+        if (table_view_sort_is_running(state->table)) return true;
+    }
+    return counting;
+}
+
+// **Filtering**
+
+/**
+ * @brief Stops and frees a filter, leaving the pointer NULL.
+ */
+static void free_filter(LineFilter **filter) {
+    if (!*filter) return;
+    line_filter_free(*filter);
+    free(*filter);
+    *filter = NULL;
+}
+
+/** @brief Reads a line of a text file for a filter. */
+static const char *filter_text_line(const void *source, size_t idx, size_t *len) {
+    return line_index_get(source, idx, len);
+}
+
+/** @brief Formats a row of a hex dump for a filter, into a buffer of the calling worker. */
+static const char *filter_hex_line(const void *source, size_t idx, size_t *len) {
+    static _Thread_local char row[HEX_ROW_MAX_BYTES];
+    *len = hex_view_format_row(*(HexView *const *)source, idx, row);
+    return row;
+}
+
+/** @brief Reads a line of an archive listing for a filter. */
+static const char *filter_list_line(const void *source, size_t idx, size_t *len) {
+    const StringList *list = source;
+    *len = strlen(list->lines[idx]);
+    return list->lines[idx];
+}
+
+/** @brief Reads a line of fully received standard input for a filter. */
+static const char *filter_stream_line(const void *source, size_t idx, size_t *len) {
+    return stream_input_get_line(*(StreamInput *const *)source, idx, len);
+}
+
+/**
+ * @brief Narrows the current view to the lines matching a filter expression.
+ */
+FatResult state_apply_filter(AppState *state, const char *expression, char *error, size_t error_size) {
+    if (error && error_size > 0) error[0] = '\0';
+    if (!expression || expression[0] == '\0') {
+        state_clear_filter(state);
+        return FAT_SUCCESS;
+    }
+
+    FilterLineGetter get_line;
+    const void *source;
+    size_t source_size;
+    if (state->stream) {
+        // The stream's chunk table grows while it is read, so workers could see it move.
+        if (stream_input_is_reading(state->stream)) {
+            snprintf(error, error_size, "Input is still arriving; filter once it has ended.");
+            return FAT_ERROR_UNSUPPORTED;
+        }
+        get_line = filter_stream_line;
+        source = &state->stream;
+        source_size = sizeof(state->stream);
+    } else if (state->view_mode == VIEW_MODE_NORMAL) {
+        get_line = filter_text_line;
+        source = &state->line_index;
+        source_size = sizeof(state->line_index);
+    } else if (state->view_mode == VIEW_MODE_BINARY_HEX && state->hex) {
+        get_line = filter_hex_line;
+        source = &state->hex;
+        source_size = sizeof(state->hex);
+    } else if (state->view_mode == VIEW_MODE_ARCHIVE) {
+        get_line = filter_list_line;
+        source = &state->content;
+        source_size = sizeof(state->content);
+    } else {
+        snprintf(error, error_size, "This view cannot be filtered.");
+        return FAT_ERROR_UNSUPPORTED;
+    }
+
+    LineFilter *filter = malloc(sizeof(LineFilter));
+    if (!filter) return FAT_ERROR_MEMORY;
+    FatResult res = line_filter_start(filter, expression, get_line, source, source_size,
+                                      state_total_line_count(state), error, error_size);
+    if (res != FAT_SUCCESS) {
+        free(filter);
+        return res;
+    }
+
+    free_filter(&state->filter);
+    free_archive_grep(&state->archive_grep);
+    state->filter = filter;
+    state->top_line = 0;
+    state->search_term_active = false;
+    state->search_results.count = 0;
+    pins_reset_index(&state->pins);
+    LOG_INFO("Filtering '%s' with '%s'", state->filepath ? state->filepath : "(input)", expression);
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Expands or collapses the JSON container on the top line.
+ */
+FatResult state_toggle_json_node(AppState *state) {
+    if (state->view_mode != VIEW_MODE_JSON || !state->json) return FAT_ERROR_UNSUPPORTED;
+    size_t row = (size_t)state->top_line;
+    FatResult res = json_view_toggle(state->json, &row);
+    if (res != FAT_SUCCESS) return res;
+    state->top_line = (int)row;
+    state->search_term_active = false;
+    state->search_results.count = 0;
+    pins_reset_index(&state->pins);
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Sorts the table by a column, or reverses or removes the sort.
+ */
+FatResult state_sort_table(AppState *state, size_t column) {
+    if (state->view_mode != VIEW_MODE_TABLE || !state->table) return FAT_ERROR_UNSUPPORTED;
+    TableView *table = state->table;
+    state->search_term_active = false;
+    state->search_results.count = 0;
+    pins_reset_index(&state->pins);
+    if (table->sort_column == (int)column && table->sort_descending && !table_view_sort_is_running(table)) {
+        table_view_clear_sort(table);
+        state->top_line = 0;
+        return FAT_SUCCESS;
+    }
+    bool descending = table->sort_column == (int)column && !table->sort_descending;
+    return table_view_sort_start(table, column, descending);
+}
+
+/**
+ * @brief Removes the filter from the current view, keeping the line at the top of the screen.
+ */
+void state_clear_filter(AppState *state) {
+    if (!state->filter) return;
+    state->top_line = (int)state_line_number(state, (size_t)state->top_line);
+    free_filter(&state->filter);
+    state->search_term_active = false;
+    state->search_results.count = 0;
+    pins_reset_index(&state->pins);
+}
+
+// **Archive Search**
+
+/**
+ * @brief Stops and frees an archive search, leaving the pointer NULL.
+ */
+static void free_archive_grep(ArchiveGrep **grep) {
+    if (!*grep) return;
+    archive_grep_free(*grep);
+    free(*grep);
+    *grep = NULL;
+}
+
+/**
+ * @brief Lists the entries of the current archive that contain a term.
+ */
+FatResult state_grep_archive(AppState *state, const char *term) {
+    if (state->view_mode != VIEW_MODE_ARCHIVE) return FAT_ERROR_UNSUPPORTED;
+    if (!term || term[0] == '\0') {
+        state_clear_archive_grep(state);
+        return FAT_SUCCESS;
+    }
+    const ArchivePlugin *handler = pm_get_handler(state->filepath);
+    if (!handler) return FAT_ERROR_UNSUPPORTED;
+
+    ArchiveSession session;
+    bool has_session = pm_get_archive_session(handler, &session);
+    ArchiveGrep *grep = malloc(sizeof(ArchiveGrep));
+    if (!grep) return FAT_ERROR_MEMORY;
+    FatResult res = archive_grep_start(grep, state->filepath, handler, pm_get_entry_reader(handler),
+                                       has_session ? &session : NULL, &state->content, term);
+    if (res != FAT_SUCCESS) {
+        free(grep);
+        return res;
+    }
+
+    free_filter(&state->filter);
+    free_archive_grep(&state->archive_grep);
+    state->archive_grep = grep;
+    state->top_line = 0;
+    state->left_char = 0;
+    state->search_term_active = false;
+    state->search_results.count = 0;
+    pins_reset_index(&state->pins);
+    LOG_INFO("Searching the entries of '%s' for '%s'%s", state->filepath, term,
+             grep->reader ? "" : " (extracting each entry)");
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Shows all the entries of the archive again, keeping the entry at the top of the screen.
+ */
+void state_clear_archive_grep(AppState *state) {
+    if (!state->archive_grep) return;
+    state->top_line = (int)state_line_number(state, (size_t)state->top_line);
+    free_archive_grep(&state->archive_grep);
+    state->search_term_active = false;
+    state->search_results.count = 0;
+    pins_reset_index(&state->pins);
+}
+
+// **Tree Search**
+
+/**
+ * @brief Stops and frees a tree search, leaving the pointer NULL.
+ */
+static void free_tree_grep(TreeGrep **grep) {
+    if (!*grep) return;
+    tree_grep_free(*grep);
+    free(*grep);
+    *grep = NULL;
+}
+
+/**
+ * @brief Replaces the current view with the lines under it that contain a term.
+ */
+FatResult state_open_grep(AppState *state, const char *term) {
+    if (!state->filepath || state->stream || state->view_mode == VIEW_MODE_DIFF ||
+        state->view_mode == VIEW_MODE_HEX_DIFF) return FAT_ERROR_UNSUPPORTED;
+    TreeGrep *grep = malloc(sizeof(TreeGrep));
+    if (!grep) return FAT_ERROR_MEMORY;
+    FatResult res = tree_grep_start(grep, state->filepath, term);
+    if (res != FAT_SUCCESS) {
+        free(grep);
+        return res;
+    }
+
+    // The hits get a breadcrumb of their own, so going back from a hit
+    // returns to them and going back from them restores the view searched.
+    char crumb[sizeof(GREP_CRUMB_PREFIX) + TREE_GREP_MAX_TERM_LEN];
+    snprintf(crumb, sizeof(crumb), GREP_CRUMB_PREFIX "%s", term);
+    char root[PATH_MAX + 16];
+    snprintf(root, sizeof(root), "Searched: %s", state->filepath);
+    char *filepath = strdup(crumb);
+    if (!filepath || StringList_add(&state->breadcrumbs, crumb) != FAT_SUCCESS) {
+        free(filepath);
+        tree_grep_free(grep);
+        free(grep);
+        return FAT_ERROR_MEMORY;
+    }
+    LOG_INFO("Searching the files under '%s' for '%s' with %d thread(s)", state->filepath, term, grep->thread_count);
+
+    state_cache_view(state);
+    state->filepath = filepath;
+    state->tree_grep = grep;
+    state->view_mode = VIEW_MODE_GREP;
+    state->top_line = 0;
+    state->left_char = 0;
+    state->max_line_len = 0;
+    state->line_wrap_enabled = false;
+
+    char buffer[TREE_GREP_MAX_TERM_LEN + 32];
+    snprintf(buffer, sizeof(buffer), "Searched for: %s", term);
+    StringList_add(&state->metadata, root);
+    StringList_add(&state->metadata, buffer);
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Opens the file of the hit at the top of the screen, at its line.
+ */
+FatResult state_open_grep_hit(AppState *state) {
+    if (state->view_mode != VIEW_MODE_GREP || !state->tree_grep) return FAT_ERROR_UNSUPPORTED;
+    if ((size_t)state->top_line >= state->tree_grep->count) return FAT_SUCCESS;
+
+    // Caching the view moves the hits out of the state, so copy what is needed first.
+    const TreeGrepHit *hit = &state->tree_grep->hits[state->top_line];
+    char term[TREE_GREP_MAX_TERM_LEN + 1];
+    snprintf(term, sizeof(term), "%s", state->tree_grep->term);
+    size_t line = hit->line;
+    char *path = strdup(hit->path);
+    char *entry = hit->entry ? strdup(hit->entry) : NULL;
+    if (!path || (hit->entry && !entry)) {
+        free(path);
+        free(entry);
+        return FAT_ERROR_MEMORY;
+    }
+
+    // Keep the hits around so going back is instant.
+    size_t depth = state->breadcrumbs.count;
+    state_cache_view(state);
+    FatResult res = state_init(state, path);
+    if (res == FAT_SUCCESS && entry) {
+        // Pass through the archive listing, as if the entry had been picked there.
+        const ArchivePlugin *handler = pm_get_handler(path);
+        char *temp_path = NULL;
+        res = handler ? handler->extract_entry(path, entry, &temp_path) : FAT_ERROR_UNSUPPORTED;
+        if (res == FAT_SUCCESS && temp_path) {
+            state_cache_view(state);
+            res = state_init(state, temp_path);
+        }
+        free(temp_path);
+    }
+    // Hits are numbered by the lines of the file, which only the text view shows one per row.
+    if (res == FAT_SUCCESS && (state->view_mode == VIEW_MODE_JSON || state->view_mode == VIEW_MODE_TABLE)) {
+        res = state_reload_content(state, VIEW_MODE_NORMAL);
+    }
+    if (res == FAT_SUCCESS && state->view_mode == VIEW_MODE_NORMAL) {
+        state_search_update(state, term, line - 1);
+    }
+    if (res != FAT_SUCCESS) {
+        // Return to the hits rather than leaving an empty view behind.
+        while (state->breadcrumbs.count > depth && state_go_back(state) == FAT_SUCCESS) {}
+    }
+    free(path);
+    free(entry);
+    return res;
+}
+
+// **Time Navigation**
+
+/**
+ * @brief Stops and frees a time index, leaving the pointer NULL.
+ */
+static void free_time_index(TimeIndex **index) {
+    if (!*index) return;
+    time_index_free(*index);
+    free(*index);
+    *index = NULL;
+}
+
+/** @brief Reads a line of the unfiltered text for the time index. */
+static const char *time_text_line(const void *ctx, size_t idx, size_t *len) {
+    const AppState *state = ctx;
+    if (state->stream) return stream_input_get_line(state->stream, idx, len);
+    return line_index_get(&state->line_index, idx, len);
+}
+
+/**
+ * @brief Scrolls to the first line at or after a time.
+ */
+FatResult state_jump_to_time(AppState *state, const char *text) {
+    if (state->view_mode != VIEW_MODE_NORMAL || state->archive_grep) return FAT_ERROR_UNSUPPORTED;
+    size_t line_count = state_total_line_count(state);
+    if (!state->time_index) {
+        TimeFormat format = time_detect_format(time_text_line, state, line_count);
+        if (format == TIME_FORMAT_NONE) return FAT_ERROR_UNSUPPORTED;
+        TimeIndex *index = malloc(sizeof(TimeIndex));
+        if (!index) return FAT_ERROR_MEMORY;
+        // Standard input keeps growing, so it is searched without checkpoints.
+        FatResult res = time_index_start(index, format, state->stream ? NULL : &state->line_index);
+        if (res != FAT_SUCCESS) {
+            free(index);
+            return res;
+        }
+        state->time_index = index;
+    }
+
+    int64_t reference = 0;
+    if (line_count > 0) {
+        size_t top = state_line_number(state, (size_t)state->top_line);
+        time_index_line_time(state->time_index, time_text_line, state, top < line_count ? top : line_count - 1, &reference);
+    }
+    int64_t target;
+    if (!time_parse_target(text, reference, &target)) return FAT_ERROR_INVALID_ARGUMENT;
+
+    size_t line, parsed;
+    if (!time_index_find(state->time_index, time_text_line, state, line_count, target, &line, &parsed)) {
+        return FAT_ERROR_FILE_NOT_FOUND;
+    }
+    char when[32];
+    time_format(target, when, sizeof(when));
+    LOG_INFO("Jumped to %s at line %zu, parsing %zu line(s)", when, line + 1, parsed);
+
+    // Under a filter, land on the first shown line at or after it.
+    size_t idx = state_find_line_number(state, line);
+    size_t count = state_line_count(state);
+    if (idx >= count) idx = count > 0 ? count - 1 : 0;
+    state->top_line = (int)idx;
+    state->left_char = 0;
+    return FAT_SUCCESS;
+}
+
+// **Timeline**
+
+/**
+ * @brief Stops and frees a timeline, leaving the pointer NULL.
+ */
+static void free_histogram(TimeHistogram **hist) {
+    if (!*hist) return;
+    time_histogram_free(*hist);
+    free(*hist);
+    *hist = NULL;
+}
+
+/**
+ * @brief Keeps the timeline of the current view up to date while it is shown.
+ *
+ * The timeline counts the lines matching the active search, so it is
+ * rebuilt whenever the term changes. Standard input is fed to it as its
+ * lines arrive; a file is counted in the background.
+ *
+ * @return True while lines remain to be counted.
+ */
+static bool timeline_step(AppState *state) {
+    if (!state->show_timeline || state->view_mode != VIEW_MODE_NORMAL || state->archive_grep) return false;
+    const char *term = state->search_term_active ? state->search_term : "";
+    if (state->histogram && strcmp(state->histogram->term, term) != 0) free_histogram(&state->histogram);
+
+    size_t line_count = state_total_line_count(state);
+    if (!state->histogram) {
+        // Standard input may not have sent a stamped line yet, so this is retried while it grows.
+        TimeFormat format = state->time_index ? state->time_index->format
+                                              : time_detect_format(time_text_line, state, line_count);
+        if (format == TIME_FORMAT_NONE) return false;
+        TimeHistogram *hist = malloc(sizeof(TimeHistogram));
+        if (!hist) return false;
+        if (time_histogram_start(hist, format, term, state->stream ? NULL : &state->line_index) != FAT_SUCCESS) {
+            free(hist);
+            return false;
+        }
+        state->histogram = hist;
+    }
+    if (state->stream) {
+        return time_histogram_feed(state->histogram, time_text_line, state, line_count, TIMELINE_FEED_LINES);
+    }
+    time_histogram_poll(state->histogram);
+    return time_histogram_is_running(state->histogram);
+}
+
+/**
+ * @brief Scrolls to the next or previous column of the timeline that holds any line.
+ */
+FatResult state_timeline_step(AppState *state, bool forward, size_t columns) {
+    if (!state->histogram || state->view_mode != VIEW_MODE_NORMAL) return FAT_ERROR_UNSUPPORTED;
+    const TimeHistogramCounts *counts = state->histogram->counts;
+    size_t count = state_line_count(state);
+    if (counts->count == 0 || count == 0) return FAT_ERROR_FILE_NOT_FOUND;
+
+    bool by_match = state->histogram->term_len > 0;
+    size_t span = time_histogram_span(counts, columns);
+    size_t column_count = (counts->count + span - 1) / span;
+    size_t top = state_line_number(state, (size_t)state->top_line);
+    size_t column = time_histogram_bucket_of(counts, top) / span;
+
+    TimeBucket bucket;
+    bool found = false;
+    if (forward) {
+        for (size_t c = column + 1; c < column_count && !found; c++) {
+            found = time_histogram_column(counts, c, span, &bucket) && (!by_match || bucket.matches > 0);
+        }
+    } else {
+        // Back to the start of this column first, then to the one before.
+        found = time_histogram_column(counts, column, span, &bucket) && (!by_match || bucket.matches > 0) &&
+                (by_match ? bucket.first_match : bucket.first_line) < top;
+        for (size_t c = column; c-- > 0 && !found;) {
+            found = time_histogram_column(counts, c, span, &bucket) && (!by_match || bucket.matches > 0);
+        }
+    }
+    if (!found) return FAT_ERROR_FILE_NOT_FOUND;
+    size_t target = by_match ? bucket.first_match : bucket.first_line;
+
+    size_t idx = state_find_line_number(state, target);
+    state->top_line = (int)(idx < count ? idx : count - 1);
+    state->left_char = 0;
+    return FAT_SUCCESS;
+}
+
+// **Byte Map**
+
+/**
+ * @brief Stops and frees a byte map, leaving the pointer NULL.
+ */
+static void free_byte_map(ByteMap **map) {
+    if (!*map) return;
+    byte_map_free(*map);
+    free(*map);
+    *map = NULL;
+}
+
+/**
+ * @brief Starts the byte map of a file in hex mode the first time it is shown, and adopts its blocks.
+ * @return True while blocks remain to be scanned.
+ */
+static bool byte_map_step(AppState *state) {
+    if (state->hide_byte_map || state->view_mode != VIEW_MODE_BINARY_HEX || !state->hex) return false;
+    if (!state->byte_map) {
+        ByteMap *map = malloc(sizeof(ByteMap));
+        if (!map) return false;
+        if (byte_map_start(map, state->hex->bytes.data, state->hex->bytes.size,
+                           state->hex->bytes.holes, state->hex->bytes.hole_count) != FAT_SUCCESS) {
+            free(map);
+            return false;
+        }
+        state->byte_map = map;
+    }
+    byte_map_poll(state->byte_map);
+    return byte_map_is_running(state->byte_map);
+}
+
+/**
+ * @brief Returns what a block of the byte map most likely holds.
+ */
+static ByteRegion byte_map_block_region(const ByteMap *map, size_t block) {
+    return block < map->count ? byte_map_classify(&map->blocks[block]) : BYTE_REGION_UNKNOWN;
+}
+
+/**
+ * @brief Scrolls the hex view to the next or previous region of the byte map.
+ */
+FatResult state_byte_map_step(AppState *state, bool forward) {
+    if (!state->byte_map || !state->hex || state->view_mode != VIEW_MODE_BINARY_HEX) return FAT_ERROR_UNSUPPORTED;
+    const ByteMap *map = state->byte_map;
+    if (map->count == 0 || state_line_count(state) == 0) return FAT_ERROR_FILE_NOT_FOUND;
+
+    size_t top_offset = (size_t)hex_view_row_offset(state->hex, state_line_number(state, (size_t)state->top_line));
+    size_t current = top_offset / map->block_size;
+    ByteRegion region = byte_map_block_region(map, current);
+
+    size_t target = map->block_count;
+    if (forward) {
+        for (size_t block = current + 1; block < map->count; block++) {
+            if (byte_map_block_region(map, block) != region) {
+                target = block;
+                break;
+            }
+        }
+    } else {
+        // The start of this region, unless the view is already there, else the start of the one before.
+        size_t start = current;
+        while (start > 0 && byte_map_block_region(map, start - 1) == region) start--;
+        if (start * map->block_size >= top_offset && start > 0) {
+            ByteRegion previous = byte_map_block_region(map, --start);
+            while (start > 0 && byte_map_block_region(map, start - 1) == previous) start--;
+        }
+        if (start * map->block_size < top_offset) target = start;
+    }
+    if (target == map->block_count) return FAT_ERROR_FILE_NOT_FOUND;
+    state_jump_to_offset(state, target * map->block_size);
+    return FAT_SUCCESS;
+}
+
+// **Checksums**
+
+/**
+ * @brief Stops and frees checksums, leaving the pointer NULL.
+ */
+static void free_checksums(Checksums **sums) {
+    if (!*sums) return;
+    checksums_free(*sums);
+    free(*sums);
+    *sums = NULL;
+}
+
+/**
+ * @brief Adopts the progress of the checksums of the current view.
+ * @return True while the file is being hashed.
+ */
+static bool checksums_step(AppState *state) {
+    if (!state->checksums) return false;
+    checksums_poll(state->checksums);
+    return checksums_is_running(state->checksums);
+}
+
+/**
+ * @brief Shows the CRC-32 the archive records for the selected entry.
+ */
+static FatResult show_entry_crc(AppState *state) {
+    if ((size_t)state->top_line >= state_line_count(state)) return FAT_ERROR_INVALID_ARGUMENT;
+    const char *entry_name = state->content.lines[state_line_number(state, (size_t)state->top_line)];
+    const ArchivePlugin *handler = pm_get_handler(state->filepath);
+    ArchiveEntryCrc entry_crc = handler ? pm_get_entry_crc(handler) : NULL;
+    if (!entry_crc) return FAT_ERROR_UNSUPPORTED;
+
+    uint32_t crc = 0;
+    FatResult res = entry_crc(state->filepath, entry_name, &crc);
+    if (res != FAT_SUCCESS) return res;
+    char value[CHECKSUM_HEX_SIZE];
+    snprintf(value, sizeof(value), "%08x", (unsigned int)crc);
+
+    Checksums *sums = malloc(sizeof(Checksums));
+    if (!sums) return FAT_ERROR_MEMORY;
+    res = checksums_set_stored(sums, entry_name, CHECKSUM_CRC32, value);
+    if (res != FAT_SUCCESS) {
+        free(sums);
+        return res;
+    }
+    free_checksums(&state->checksums);
+    state->checksums = sums;
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Starts hashing the current file, or shows the recorded CRC-32 of the selected archive entry.
+ */
+FatResult state_start_checksums(AppState *state) {
+    if (state->view_mode == VIEW_MODE_ARCHIVE) return show_entry_crc(state);
+    if (!state->filepath || state->stream) return FAT_ERROR_UNSUPPORTED;
+    if (state->config.checksum_kind_count == 0) return FAT_ERROR_INVALID_ARGUMENT;
+
+    Checksums *current = state->checksums;
+    if (current && !current->stored && (!current->done || current->result == FAT_SUCCESS)) {
+        return FAT_SUCCESS; // Already hashing, or hashed
+    }
+
+    FileSourceKind kind;
+    uint64_t size = 0;
+    FatResult res = file_source_probe(state->filepath, &kind, &size);
+    if (res != FAT_SUCCESS) return res;
+    if (kind == FILE_SOURCE_STREAM) return FAT_ERROR_UNSUPPORTED;
+
+    Checksums *sums = malloc(sizeof(Checksums));
+    if (!sums) return FAT_ERROR_MEMORY;
+    res = checksums_start(sums, state->filepath, size, state->config.checksum_kinds, state->config.checksum_kind_count);
+    if (res != FAT_SUCCESS) {
+        checksums_free(sums);
+        free(sums);
+        return res;
+    }
+    free_checksums(&state->checksums);
+    state->checksums = sums;
+    return FAT_SUCCESS;
+}
+
+// **Strings**
+
+/**
+ * @brief Stops and frees a strings view, leaving the pointer NULL.
+ */
+static void free_strings(StringsView **strings) {
+    if (!*strings) return;
+    strings_view_free(*strings);
+    free(*strings);
+    *strings = NULL;
+}
+
+/**
+ * @brief Starts finding the strings of the mapped file, to open at an offset.
+ */
+static FatResult start_strings(AppState *state, uint64_t anchor) {
+    if (!state->strings) {
+        StringsView *strings = malloc(sizeof(StringsView));
+        if (!strings) return FAT_ERROR_MEMORY;
+        strings_view_start(strings, state->hex->bytes.data, state->hex->bytes.size,
+                           state->hex->bytes.holes, state->hex->bytes.hole_count, state->hex->offset_digits);
+        state->strings = strings;
+    }
+    state->strings->anchor = anchor;
+    state->strings->has_anchor = true;
+    state->max_line_len = (size_t)state->hex->offset_digits + 5 + STRINGS_VIEW_TEXT_LEN;
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Adopts the strings found since the last poll, and opens the list at its anchor once it is found.
+ * @return True while the file is still being scanned.
+ */
+static bool strings_step(AppState *state) {
+    if (state->view_mode != VIEW_MODE_STRINGS || !state->strings) return false;
+    StringsView *strings = state->strings;
+    if (strings_view_poll(strings)) update_count_metadata(state);
+    if (strings->has_anchor) {
+        size_t idx = strings_view_find_offset(strings, strings->anchor);
+        if (idx < strings->count || !strings_view_is_running(strings)) {
+            state->top_line = idx < strings->count ? (int)idx : (strings->count > 0 ? (int)strings->count - 1 : 0);
+            strings->has_anchor = false;
+        }
+    }
+    return strings_view_is_running(strings);
+}
+
+/**
+ * @brief Switches a binary file between its hex dump and the list of its strings.
+ */
+FatResult state_toggle_strings(AppState *state) {
+    if (!state->hex) return FAT_ERROR_UNSUPPORTED;
+    uint64_t offset = 0;
+    if (state->view_mode == VIEW_MODE_STRINGS) {
+        if (state->strings && (size_t)state->top_line < state->strings->count) {
+            offset = state->strings->runs[state->top_line].offset;
+        }
+        state->view_mode = VIEW_MODE_BINARY_HEX;
+        state->max_line_len = state->hex->row_len;
+    } else if (state->view_mode == VIEW_MODE_BINARY_HEX) {
+        if (state_line_count(state) > 0) {
+            offset = hex_view_row_offset(state->hex, state_line_number(state, (size_t)state->top_line));
+        }
+        // The filter selects rows of the hex dump, so it does not carry over.
+        free_filter(&state->filter);
+        FatResult res = start_strings(state, offset);
+        if (res != FAT_SUCCESS) return res;
+        state->view_mode = VIEW_MODE_STRINGS;
+        state->top_line = 0;
+    } else {
+        return FAT_ERROR_UNSUPPORTED;
+    }
+
+    state->left_char = 0;
+    state_clear_search(state);
+    pins_reset_index(&state->pins);
+    update_count_metadata(state);
+    if (state->view_mode == VIEW_MODE_BINARY_HEX) {
+        // The pane may have been resized while the strings were shown.
+        state_fit_hex_view(state);
+        state_jump_to_offset(state, offset);
+    }
+    return FAT_SUCCESS;
+}
+
+// **Buffers**
+
+/**
+ * @brief Returns the heap memory held by a background view.
+ */
+static size_t view_snapshot_memory_usage(const ViewSnapshot *snap) {
+    size_t usage = line_index_memory_usage(&snap->line_index);
+    usage += snap->content.capacity * sizeof(char*);
+    for (size_t i = 0; i < snap->content.count; i++) {
+        usage += strlen(snap->content.lines[i]) + 1;
+    }
+    usage += snap->search_results.capacity * sizeof(SearchMatch);
+    usage += snap->search_results.candidate_count * sizeof(size_t);
+    usage += snap->pins.line_capacity * sizeof(size_t);
+    if (snap->filter) usage += snap->filter->capacity * sizeof(size_t);
+    if (snap->archive_grep) {
+        usage += snap->archive_grep->capacity * sizeof(ArchiveGrepHit);
+        for (size_t i = 0; i < snap->archive_grep->count; i++) {
+            usage += strlen(snap->archive_grep->hits[i].row) + 1;
+        }
+    }
+    if (snap->diff) usage += diff_memory_usage(snap->diff);
+    if (snap->hex_diff) usage += hex_diff_memory_usage(snap->hex_diff);
+    if (snap->json) usage += json_view_memory_usage(snap->json);
+    if (snap->table) usage += table_view_memory_usage(snap->table);
+    if (snap->hex) usage += hex_view_memory_usage(snap->hex);
+    if (snap->binary) usage += binary_format_memory_usage(snap->binary);
+    if (snap->byte_map) usage += byte_map_memory_usage(snap->byte_map);
+    if (snap->strings) usage += strings_view_memory_usage(snap->strings);
+    return usage;
+}
+
+/**
+ * @brief Drops the content of a background buffer, keeping its position and metadata.
+ *
+ * Mapped text keeps its mapping, so only the offsets have to be rebuilt.
+ * Everything else, the JSON tree, the table, the hex dump and the strings
+ * included, is regenerated from disk when the buffer is shown again.
+ */
+static void buffer_evict(Buffer *buffer) {
+    ViewSnapshot *snap = &buffer->view;
+    if (snap->filter) {
+        // The filter reads the content, so it is dropped with it.
+        if ((size_t)snap->top_line < snap->filter->count) snap->top_line = (int)snap->filter->lines[snap->top_line];
+        free_filter(&snap->filter);
+    }
+    if (snap->archive_grep) {
+        // The hits refer to entries of the listing, so they are dropped with it.
+        if ((size_t)snap->top_line < snap->archive_grep->count) {
+            snap->top_line = (int)snap->archive_grep->hits[snap->top_line].entry;
+        }
+        free_archive_grep(&snap->archive_grep);
+    }
+    free_time_index(&snap->time_index); // Its checkpoints point into the offsets
+    free_histogram(&snap->histogram); // Its scan reads them
+    if (snap->json) {
+        json_view_free(snap->json);
+        free(snap->json);
+        snap->json = NULL;
+    }
+    if (snap->table) {
+        // A finished sort is redone when the table is read back; one still running is dropped.
+        buffer->evicted_sort_column = snap->table->sort_column;
+        buffer->evicted_sort_descending = snap->table->sort_descending;
+        table_view_free(snap->table);
+        free(snap->table);
+        snap->table = NULL;
+    }
+    if (snap->strings) {
+        // The list is rebuilt from the start, so it is reopened at the string on top.
+        buffer->evicted_offset = 0;
+        if ((size_t)snap->top_line < snap->strings->count) {
+            buffer->evicted_offset = snap->strings->runs[snap->top_line].offset;
+        }
+        free_strings(&snap->strings); // Reads the mapped bytes, so it goes first
+    }
+    free_byte_map(&snap->byte_map);
+    if (snap->hex) {
+        hex_view_free(snap->hex);
+        free(snap->hex);
+        snap->hex = NULL;
+    }
+    if (snap->binary) {
+        binary_format_free(snap->binary);
+        free(snap->binary);
+        snap->binary = NULL;
+    }
+    if (snap->view_mode == VIEW_MODE_NORMAL && snap->line_index.is_mapped) {
+        line_index_evict(&snap->line_index);
+    } else {
+        line_index_free(&snap->line_index);
+    }
+    StringList_free(&snap->content);
+    search_results_free(&snap->search_results);
+    snap->search_term_active = false;
+    pins_reset_index(&snap->pins);
+    buffer->is_evicted = true;
+    buffer->memory_usage = 0;
+}
+
+/**
+ * @brief Evicts least recently used background buffers until the budget is met.
+ */
+static void enforce_buffer_budget(AppState *state) {
+    size_t budget = state->config.buffer_memory_budget;
+    if (budget == 0) return;
+
+    while (1) {
+        size_t total = 0;
+        Buffer *victim = NULL;
+        for (size_t i = 0; i < state->buffer_count; i++) {
+            Buffer *buffer = &state->buffers[i];
+            if (i == state->active_buffer || !buffer->is_loaded || buffer->is_evicted) continue;
+            total += buffer->memory_usage;
+            // Diffs, listings, grep results and streams cannot be read back cheaply, so they are only counted.
+            ViewMode mode = buffer->view.view_mode;
+            if (buffer->view.stream || (mode != VIEW_MODE_NORMAL && mode != VIEW_MODE_JSON && mode != VIEW_MODE_TABLE &&
+                                        mode != VIEW_MODE_BINARY_HEX && mode != VIEW_MODE_STRINGS)) continue;
+            if (!victim || buffer->last_used < victim->last_used) victim = buffer;
+        }
+        if (total <= budget || !victim) return;
+
+        LOG_INFO("Evicting buffer '%s' (%zu bytes) to stay within the memory budget",
+                 victim->view.filepath, victim->memory_usage);
+        buffer_evict(victim);
+    }
+}
+
+/**
+ * @brief Brings the content of an evicted view back.
+ */
+static FatResult buffer_reload(AppState *state) {
+    if (state->view_mode == VIEW_MODE_NORMAL && state->line_index.data) {
+        return line_index_build(&state->line_index);
+    }
+    int top_line = state->top_line;
+    int left_char = state->left_char;
+    FatResult res = state_reload_content(state, state->view_mode);
+    if (res != FAT_SUCCESS) return res;
+    const Buffer *buffer = &state->buffers[state->active_buffer];
+    if (state->view_mode == VIEW_MODE_STRINGS) {
+        res = start_strings(state, buffer->evicted_offset);
+        if (res != FAT_SUCCESS) return res;
+    }
+    if (state->view_mode == VIEW_MODE_TABLE && state->table && buffer->evicted_sort_column >= 0) {
+        res = table_view_sort_start(state->table, (size_t)buffer->evicted_sort_column, buffer->evicted_sort_descending);
+        if (res != FAT_SUCCESS) return res;
+    }
+
+    size_t count = state_line_count(state);
+    state->top_line = (size_t)top_line < count ? top_line : (count > 0 ? (int)count - 1 : 0);
+    state->left_char = left_char;
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Registers another file as a background buffer.
+ */
+FatResult state_add_buffer(AppState *state, const char *filepath) {
+    // The view on screen becomes the first buffer the first time one is added.
+    size_t needed = state->buffer_count == 0 ? 2 : state->buffer_count + 1;
+    Buffer *new_buffers = realloc(state->buffers, needed * sizeof(Buffer));
+    if (!new_buffers) return FAT_ERROR_MEMORY;
+    state->buffers = new_buffers;
+
+    if (state->buffer_count == 0) {
+        memset(&state->buffers[0], 0, sizeof(Buffer));
+        state->buffers[0].is_loaded = true;
+        state->buffers[0].last_used = ++state->buffer_clock;
+        state->buffer_count = 1;
+        state->active_buffer = 0;
+    }
+
+    Buffer *buffer = &state->buffers[state->buffer_count];
+    memset(buffer, 0, sizeof(Buffer));
+    buffer->view.filepath = strdup(filepath);
+    if (!buffer->view.filepath) return FAT_ERROR_MEMORY;
+    state->buffer_count++;
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Makes another buffer the active one.
+ */
+FatResult state_switch_buffer(AppState *state, size_t index) {
+    if (index >= state->buffer_count) return FAT_ERROR_INVALID_ARGUMENT;
+    if (index == state->active_buffer) return FAT_SUCCESS;
+
+    size_t previous = state->active_buffer;
+    Buffer *from = &state->buffers[previous];
+    Buffer *to = &state->buffers[index];
+
+    // Park the current view and its history in its slot.
+    view_snapshot_take(state, &from->view);
+    from->breadcrumbs = state->breadcrumbs;
+    StringList_init(&state->breadcrumbs);
+    from->memory_usage = view_snapshot_memory_usage(&from->view);
+    from->last_used = ++state->buffer_clock;
+    state->active_buffer = index;
+
+    FatResult res = FAT_SUCCESS;
+    if (!to->is_loaded) {
+        char *path = to->view.filepath;
+        to->view.filepath = NULL;
+        res = state_init(state, path);
+        if (res == FAT_SUCCESS) {
+            to->is_loaded = true;
+            free(path);
+        } else {
+            LOG_INFO("Could not open buffer '%s'", path);
+            to->view.filepath = path;
+            StringList_free(&state->breadcrumbs);
+        }
+    } else {
+        state->breadcrumbs = to->breadcrumbs;
+        StringList_init(&to->breadcrumbs);
+        view_snapshot_restore(state, &to->view);
+        if (to->is_evicted) {
+            res = buffer_reload(state);
+            if (res == FAT_SUCCESS) {
+                to->is_evicted = false;
+            } else {
+                // Park it again so the user can retry later.
+                view_snapshot_take(state, &to->view);
+                to->breadcrumbs = state->breadcrumbs;
+                StringList_init(&state->breadcrumbs);
+            }
+        }
+    }
+
+    if (res != FAT_SUCCESS) {
+        state->active_buffer = previous;
+        state->breadcrumbs = from->breadcrumbs;
+        StringList_init(&from->breadcrumbs);
+        view_snapshot_restore(state, &from->view);
+        return res;
+    }
+
+    to->last_used = ++state->buffer_clock;
+    to->memory_usage = 0;
+    state_fit_hex_view(state); // The terminal may have been resized while it was in the background
+    enforce_buffer_budget(state);
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Returns the path of the file a buffer was opened with.
+ */
+const char *state_buffer_path(const AppState *state, size_t index) {
+    if (index >= state->buffer_count) return NULL;
+    if (index == state->active_buffer) {
+        return state->breadcrumbs.count > 0 ? state->breadcrumbs.lines[0] : state->filepath;
+    }
+    const Buffer *buffer = &state->buffers[index];
+    if (buffer->breadcrumbs.count > 0) return buffer->breadcrumbs.lines[0];
+    return buffer->view.filepath;
+}
+
+// **Search**
+
+/** @brief The number of lines scanned between checks of the clock. */
+#define SEARCH_CLOCK_INTERVAL 256
+
+/**
+ * @brief Returns a monotonic time in milliseconds.
+ */
+static double search_clock_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1000.0 + (double)now.tv_nsec / 1e6;
+}
+
+/**
+ * @brief Frees the matches and scan progress of a search.
+ */
+static void search_results_free(SearchMatchList *results) {
+    free(results->matches);
+    free(results->candidates);
+    memset(results, 0, sizeof(*results));
+}
+
+/**
+ * @brief Clears the search term and frees its matches.
+ */
+void state_clear_search(AppState *state) {
+    state->search_term[0] = '\0';
+    state->search_term_active = false;
+    search_results_free(&state->search_results);
+}
+
+/**
+ * @brief Starts searching for a term, refining the current results if possible.
+ */
+void state_search_update(AppState *state, const char *term, size_t origin_line) {
+    SearchMatchList *results = &state->search_results;
+    bool was_active = state->search_term_active && state->search_term[0] != '\0';
+    if (was_active && strcmp(term, state->search_term) == 0 && results->origin_line == origin_line) return;
+
+    // Any line containing the new term contains the old one too.
+    bool refine = was_active && term[0] != '\0' && strstr(term, state->search_term) != NULL;
+    size_t *candidates = NULL;
+    size_t candidate_count = 0;
+    size_t next_line = 0;
+    if (refine) {
+        size_t remaining = results->candidate_count - results->candidate_pos;
+        candidates = malloc((results->count + remaining + 1) * sizeof(size_t));
+        if (candidates) {
+            // Lines that matched, then the candidates the old scan had not reached.
+            for (size_t i = 0; i < results->count; i++) {
+                size_t line = results->matches[i].line_idx;
+                if (candidate_count == 0 || candidates[candidate_count - 1] != line) candidates[candidate_count++] = line;
+            }
+            if (remaining > 0) {
+                memcpy(candidates + candidate_count, results->candidates + results->candidate_pos, remaining * sizeof(size_t));
+                candidate_count += remaining;
+            }
+            next_line = results->is_scanning ? results->next_line : SIZE_MAX;
+        } else {
+            refine = false;
+        }
+    }
+
+    size_t capacity = results->capacity;
+    SearchMatch *matches = results->matches;
+    free(results->candidates);
+    memset(results, 0, sizeof(*results));
+    results->matches = matches;
+    results->capacity = capacity;
+    results->candidates = candidates;
+    results->candidate_count = candidate_count;
+    results->next_line = next_line;
+    results->origin_line = origin_line;
+
+    strncpy(state->search_term, term, sizeof(state->search_term) - 1);
+    state->search_term[sizeof(state->search_term) - 1] = '\0';
+    state->search_term_active = state->search_term[0] != '\0';
+    results->is_scanning = state->search_term_active;
+}
+
+/**
+ * @brief Records a match, keeping the array in line order.
+ */
+static bool search_add_match(SearchMatchList *results, size_t line_idx, size_t char_idx) {
+    if (results->count >= results->capacity) {
+        size_t new_capacity = (results->capacity == 0) ? 8 : results->capacity * 2;
+        SearchMatch* new_matches = realloc(results->matches, new_capacity * sizeof(SearchMatch));
+        if (!new_matches) return false;
+        results->matches = new_matches;
+        results->capacity = new_capacity;
+    }
+    results->matches[results->count].line_idx = line_idx;
+    results->matches[results->count].char_idx = char_idx;
+    results->count++;
+    return true;
+}
+
+/**
+ * @brief Scans lines for the current search term for up to a time budget.
+ */
+FatResult state_search_step(AppState *state, int budget_ms) {
+    SearchMatchList *results = &state->search_results;
+    if (!state->search_term_active || !results->is_scanning) return FAT_SUCCESS;
+
+    size_t term_len = strlen(state->search_term);
+    size_t line_count = state_line_count(state);
+    size_t first_new = results->count;
+    double deadline = search_clock_ms() + budget_ms;
+    FatResult res = FAT_SUCCESS;
+
+    for (size_t scanned = 1; ; scanned++) {
+        size_t i;
+        if (results->candidate_pos < results->candidate_count) {
+            i = results->candidates[results->candidate_pos++];
+        } else if (results->next_line < line_count) {
+            i = results->next_line++;
+        } else {
+            results->is_scanning = false;
+            break;
+        }
+        if (i >= line_count) continue;
+
+        size_t line_len;
+        const char* line = state_get_line(state, i, &line_len);
+        const char* end = line + line_len;
+        const char* ptr = line;
+        while ((ptr = find_bytes(ptr, (size_t)(end - ptr), state->search_term, term_len)) != NULL) {
+            if (!search_add_match(results, i, (size_t)(ptr - line))) {
+                res = FAT_ERROR_MEMORY;
+                break;
+            }
+            ptr++; // Move past the beginning of the current match
+        }
+        if (res != FAT_SUCCESS) break;
+        if (budget_ms >= 0 && scanned % SEARCH_CLOCK_INTERVAL == 0 && search_clock_ms() >= deadline) break;
+    }
+    if (!results->is_scanning) {
+        free(results->candidates);
+        results->candidates = NULL;
+        results->candidate_count = results->candidate_pos = 0;
+    }
+
+    // Jump to the nearest match after the origin, wrapping around once nothing follows it.
+    if (!results->has_current) {
+        for (size_t m = first_new; m < results->count; m++) {
+            if (results->matches[m].line_idx >= results->origin_line) {
+                results->current_match_idx = m;
+                results->has_current = true;
+                break;
+            }
+        }
+        if (!results->has_current && !results->is_scanning && results->count > 0) {
+            results->current_match_idx = 0;
+            results->has_current = true;
+        }
+        if (results->has_current) state->top_line = (int)results->matches[results->current_match_idx].line_idx;
+    }
+    return res;
+}
+
+// **Pinned Terms**
+
+/**
+ * @brief Returns true if the view highlights pinned terms.
+ */
+static bool pins_apply(const AppState *state) {
+    return state->view_mode == VIEW_MODE_NORMAL || state->view_mode == VIEW_MODE_BINARY_HEX ||
+           state->view_mode == VIEW_MODE_JSON || state->view_mode == VIEW_MODE_STRINGS;
+}
+
+/**
+ * @brief Forgets which lines contain the pinned terms, so they are indexed again.
+ */
+static void pins_reset_index(PinnedTerms *pins) {
+    free(pins->lines);
+    pins->lines = NULL;
+    pins->line_count = 0;
+    pins->line_capacity = 0;
+    pins->next_line = 0;
+    memset(pins->term_lines, 0, sizeof(pins->term_lines));
+}
+
+/**
+ * @brief Frees the pinned terms, their matcher and their index.
+ */
+static void pins_free(PinnedTerms *pins) {
+    pins_reset_index(pins);
+    StringList_free(&pins->terms);
+    multi_match_free(&pins->matcher);
+}
+
+/**
+ * @brief Indexes lines for the pinned terms for up to a time budget.
+ *
+ * Lines added later, like those still arriving on standard input, are
+ * picked up by the next call.
+ *
+ * @return True if lines remain to be indexed.
+ */
+static bool pins_step(AppState *state, int budget_ms) {
+    PinnedTerms *pins = &state->pins;
+    if (pins->terms.count == 0 || !pins_apply(state)) return false;
+
+    size_t line_count = state_line_count(state);
+    double deadline = search_clock_ms() + budget_ms;
+    for (size_t scanned = 1; pins->next_line < line_count; scanned++) {
+        size_t i = pins->next_line;
+        size_t line_len;
+        const char *line = state_get_line(state, i, &line_len);
+        uint32_t found = line ? multi_match_find(&pins->matcher, line, line_len) : 0;
+        if (found) {
+            if (pins->line_count >= pins->line_capacity) {
+                size_t new_capacity = pins->line_capacity == 0 ? 64 : pins->line_capacity * 2;
+                size_t *new_lines = realloc(pins->lines, new_capacity * sizeof(size_t));
+                if (!new_lines) return false; // Retried on the next poll
+                pins->lines = new_lines;
+                pins->line_capacity = new_capacity;
+            }
+            pins->lines[pins->line_count++] = i;
+            for (size_t t = 0; t < pins->terms.count; t++) {
+                if (found & (1u << t)) pins->term_lines[t]++;
+            }
+        }
+        pins->next_line++;
+        if (budget_ms >= 0 && scanned % SEARCH_CLOCK_INTERVAL == 0 && search_clock_ms() >= deadline) break;
+    }
+    return pins->next_line < line_count;
+}
+
+/**
+ * @brief Recompiles the matcher after the terms changed, and starts indexing again.
+ */
+static FatResult pins_compile(PinnedTerms *pins) {
+    multi_match_free(&pins->matcher);
+    pins_reset_index(pins);
+    if (pins->terms.count == 0) return FAT_SUCCESS;
+    return multi_match_compile(&pins->matcher, pins->terms.lines, pins->terms.count);
+}
+
+/**
+ * @brief Pins a term, or unpins it if it is already pinned.
+ */
+FatResult state_toggle_pin(AppState *state, const char *term) {
+    PinnedTerms *pins = &state->pins;
+    size_t len = strlen(term);
+    if (len == 0 || len > MULTI_MATCH_MAX_TERM_LEN) return FAT_ERROR_INVALID_ARGUMENT;
+
+    StringList terms;
+    StringList_init(&terms);
+    bool removed = false;
+    for (size_t i = 0; i < pins->terms.count; i++) {
+        if (strcmp(pins->terms.lines[i], term) == 0) {
+            removed = true;
+        } else if (StringList_add(&terms, pins->terms.lines[i]) != FAT_SUCCESS) {
+            StringList_free(&terms);
+            return FAT_ERROR_MEMORY;
+        }
+    }
+    if (!removed) {
+        if (terms.count >= MULTI_MATCH_MAX_TERMS) {
+            StringList_free(&terms);
+            return FAT_ERROR_INVALID_ARGUMENT;
+        }
+        if (StringList_add(&terms, term) != FAT_SUCCESS) {
+            StringList_free(&terms);
+            return FAT_ERROR_MEMORY;
+        }
+    }
+
+    StringList_free(&pins->terms);
+    pins->terms = terms;
+    FatResult res = pins_compile(pins);
+    if (res != FAT_SUCCESS) StringList_free(&pins->terms);
+    return res;
+}
+
+/**
+ * @brief Unpins every term.
+ */
+void state_clear_pins(AppState *state) {
+    pins_free(&state->pins);
+}
+
+/**
+ * @brief Scrolls to the next or previous line containing a pinned term, wrapping around.
+ */
+FatResult state_jump_to_pinned(AppState *state, bool forward) {
+    PinnedTerms *pins = &state->pins;
+    if (pins->terms.count == 0 || !pins_apply(state)) return FAT_ERROR_FILE_NOT_FOUND;
+    size_t top = state->top_line > 0 ? (size_t)state->top_line : 0;
+
+    // Index past the top line, so the lines found before it are all there are.
+    while (pins->next_line <= top && pins_step(state, SEARCH_POLL_BUDGET_MS)) {}
+    size_t lo = 0, hi = pins->line_count; // The first indexed line after the top one
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (pins->lines[mid] <= top) lo = mid + 1; else hi = mid;
+    }
+    size_t before = lo > 0 && pins->lines[lo - 1] == top ? lo - 1 : lo; // Lines before the top one
+
+    size_t target;
+    if (forward) {
+        while (lo == pins->line_count && pins_step(state, SEARCH_POLL_BUDGET_MS)) {}
+        if (pins->line_count == 0) return FAT_ERROR_FILE_NOT_FOUND;
+        target = lo < pins->line_count ? pins->lines[lo] : pins->lines[0];
+    } else if (before > 0) {
+        target = pins->lines[before - 1];
+    } else {
+        while (pins_step(state, SEARCH_POLL_BUDGET_MS)) {}
+        if (pins->line_count == 0) return FAT_ERROR_FILE_NOT_FOUND;
+        target = pins->lines[pins->line_count - 1];
+    }
+    state->top_line = (int)target;
+    return FAT_SUCCESS;
 }
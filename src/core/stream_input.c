@@ -0,0 +1,359 @@
+/**
+ * @file stream_input.c
+ * @author Zuhaitz (original)
+ * @brief Implements background reading of piped input with spill-to-disk.
+ */
+#include "core/stream_input.h"
+#include "utils/logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/mman.h>
+
+/** @brief The size at which the reader publishes a chunk. */
+#define STREAM_CHUNK_SIZE (1024 * 1024)
+/** @brief How long the reader waits for more data before publishing what it has. */
+#define STREAM_IDLE_FLUSH_MS 50
+/** @brief How often the reader checks for cancellation while the pipe is silent. */
+#define STREAM_CANCEL_CHECK_MS 200
+
+// **Reader Thread**
+
+/**
+ * @brief Writes a buffer to the spill file, creating the file on first use.
+ */
+static FatResult spill_write(StreamInput* stream, const char* data, size_t size, uint64_t stream_offset) {
+    if (stream->spill_fd < 0) {
+        const char* tmp_dir = getenv("TMPDIR");
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/fat-stdin-XXXXXX", tmp_dir && *tmp_dir ? tmp_dir : "/tmp");
+        int spill_fd = mkstemp(path);
+        if (spill_fd < 0) {
+            LOG_INFO("Could not create a spill file for the stream: %s", strerror(errno));
+            return FAT_ERROR_FILE_WRITE;
+        }
+        // The file lives on only through its descriptor, so nothing is left behind.
+        unlink(path);
+        pthread_mutex_lock(&stream->lock);
+        stream->spill_fd = spill_fd;
+        stream->spill_start = stream_offset;
+        pthread_mutex_unlock(&stream->lock);
+        LOG_INFO("The stream exceeded %zu bytes in memory; spilling to disk", stream->memory_limit);
+    }
+
+    size_t written = 0;
+    while (written < size) {
+        ssize_t n = write(stream->spill_fd, data + written, size - written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            LOG_INFO("Could not write to the spill file: %s", strerror(errno));
+            return FAT_ERROR_FILE_WRITE;
+        }
+        written += (size_t)n;
+    }
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Turns the first `size` bytes of the staging buffer into a published chunk.
+ */
+static FatResult publish_chunk(StreamInput* stream, const char* staging, size_t size,
+                               uint64_t offset, size_t first_line, size_t* out_lines) {
+    StreamChunk chunk = {0};
+    chunk.offset = offset;
+    chunk.size = size;
+    chunk.first_line = first_line;
+
+    size_t capacity = 0;
+    for (size_t pos = 0; pos < size;) {
+        if (chunk.line_count == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            size_t* offsets = realloc(chunk.line_offsets, capacity * sizeof(size_t));
+            if (!offsets) {
+                free(chunk.line_offsets);
+                return FAT_ERROR_MEMORY;
+            }
+            chunk.line_offsets = offsets;
+        }
+        chunk.line_offsets[chunk.line_count++] = pos;
+        const char* newline = memchr(staging + pos, '\n', size - pos);
+        size_t end = newline ? (size_t)(newline - staging) : size;
+        if (end - pos > chunk.max_line_len) chunk.max_line_len = end - pos;
+        pos = end + 1;
+    }
+
+    bool spill = stream->spill_fd >= 0 ||
+                 (stream->memory_limit > 0 && stream->memory_used + size > stream->memory_limit);
+    uint64_t spill_size = 0;
+    if (spill) {
+        FatResult res = spill_write(stream, staging, size, offset);
+        if (res != FAT_SUCCESS) {
+            free(chunk.line_offsets);
+            return res;
+        }
+        spill_size = offset + size - stream->spill_start;
+    } else {
+        chunk.data = malloc(size);
+        if (!chunk.data) {
+            free(chunk.line_offsets);
+            return FAT_ERROR_MEMORY;
+        }
+        memcpy(chunk.data, staging, size);
+        stream->memory_used += size;
+    }
+
+    pthread_mutex_lock(&stream->lock);
+    if (stream->chunk_count == stream->chunk_capacity) {
+        size_t new_capacity = stream->chunk_capacity ? stream->chunk_capacity * 2 : 64;
+        StreamChunk* chunks = realloc(stream->chunks, new_capacity * sizeof(StreamChunk));
+        if (!chunks) {
+            pthread_mutex_unlock(&stream->lock);
+            free(chunk.data);
+            free(chunk.line_offsets);
+            return FAT_ERROR_MEMORY;
+        }
+        stream->chunks = chunks;
+        stream->chunk_capacity = new_capacity;
+    }
+    stream->chunks[stream->chunk_count++] = chunk;
+    if (spill) stream->spill_size = spill_size;
+    pthread_mutex_unlock(&stream->lock);
+    *out_lines = chunk.line_count;
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Returns the length of the prefix of `data` that ends with a newline.
+ */
+static size_t complete_lines_length(const char* data, size_t size) {
+    for (size_t i = size; i > 0; i--) {
+        if (data[i - 1] == '\n') return i;
+    }
+    return 0;
+}
+
+/**
+ * @brief Reader thread: reads the stream and publishes it chunk by chunk.
+ *
+ * A chunk is published when the staging buffer is full, when the stream has
+ * been idle for STREAM_IDLE_FLUSH_MS, or at the end of the stream. Only whole
+ * lines are published until the end, so every line lies inside one chunk.
+ * Reading stops at `max_size`, if there is one. A line longer than STREAM_CHUNK_SIZE is split into lines of that length,
+ * so the staging buffer never grows, whatever is piped in.
+ */
+static void* stream_reader(void* arg) {
+    StreamInput* stream = arg;
+    const size_t capacity = STREAM_CHUNK_SIZE;
+    size_t used = 0;
+    uint64_t offset = 0;
+    size_t lines = 0;
+    bool truncated = false;
+    FatResult res = FAT_SUCCESS;
+    char* staging = malloc(capacity);
+    if (!staging) res = FAT_ERROR_MEMORY;
+
+    while (res == FAT_SUCCESS) {
+        pthread_mutex_lock(&stream->lock);
+        bool cancel = stream->cancel;
+        pthread_mutex_unlock(&stream->lock);
+        if (cancel) break;
+
+        size_t room = capacity - used;
+        if (stream->max_size > 0 && stream->max_size - (offset + used) < room) {
+            room = (size_t)(stream->max_size - (offset + used));
+        }
+
+        struct pollfd pfd = { .fd = stream->fd, .events = POLLIN };
+        int ready = room > 0 ? poll(&pfd, 1, used > 0 ? STREAM_IDLE_FLUSH_MS : STREAM_CANCEL_CHECK_MS) : 0;
+        if (ready < 0 && errno != EINTR) {
+            res = FAT_ERROR_FILE_READ;
+            break;
+        }
+
+        size_t flush = 0;
+        bool at_eof = false;
+        if (room == 0) {
+            // A device that never ends, such as /dev/zero, stops at the limit as if it had ended there.
+            truncated = true;
+            at_eof = true;
+            flush = used;
+        } else if (ready > 0) {
+            ssize_t n = read(stream->fd, staging + used, room);
+            if (n < 0) {
+                if (errno == EINTR || errno == EAGAIN) continue;
+                res = FAT_ERROR_FILE_READ;
+                break;
+            }
+            if (n == 0) {
+                at_eof = true;
+                flush = used;
+            } else {
+                used += (size_t)n;
+                if (used == capacity) {
+                    flush = complete_lines_length(staging, used);
+                    // A line that fills the whole buffer is cut there and goes on as the next line.
+                    if (flush == 0) flush = used;
+                }
+            }
+        } else if (ready == 0 && used > 0) {
+            flush = complete_lines_length(staging, used);
+        }
+
+        if (flush > 0) {
+            size_t chunk_lines = 0;
+            res = publish_chunk(stream, staging, flush, offset, lines, &chunk_lines);
+            if (res != FAT_SUCCESS) break;
+            lines += chunk_lines;
+            offset += flush;
+            memmove(staging, staging + flush, used - flush);
+            used -= flush;
+        }
+        if (at_eof) break;
+    }
+
+    free(staging);
+    pthread_mutex_lock(&stream->lock);
+    stream->is_eof = true;
+    stream->is_truncated = truncated;
+    stream->error = res;
+    pthread_mutex_unlock(&stream->lock);
+    LOG_INFO("Finished reading the stream: %zu lines, %llu bytes%s (%s)", lines, (unsigned long long)offset,
+             truncated ? ", stopped at the limit" : "", fat_result_to_string(res));
+    return NULL;
+}
+
+// **Public API**
+
+/**
+ * @brief Starts reading a stream in the background.
+ */
+FatResult stream_input_open(StreamInput* stream, int fd, size_t memory_limit, uint64_t max_size) {
+    memset(stream, 0, sizeof(*stream));
+    stream->fd = fd;
+    stream->memory_limit = memory_limit;
+    stream->max_size = max_size;
+    stream->spill_fd = -1;
+    pthread_mutex_init(&stream->lock, NULL);
+
+    if (pthread_create(&stream->thread, NULL, stream_reader, stream) != 0) {
+        pthread_mutex_destroy(&stream->lock);
+        close(fd);
+        stream->fd = -1;
+        return FAT_ERROR_GENERIC;
+    }
+    stream->has_thread = true;
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Adopts the chunks published since the last call.
+ */
+bool stream_input_poll(StreamInput* stream) {
+    if (stream->view_is_eof) return false;
+
+    pthread_mutex_lock(&stream->lock);
+    size_t count = stream->chunk_count;
+    uint64_t spill_size = stream->spill_size;
+    bool is_eof = stream->is_eof;
+    bool is_truncated = stream->is_truncated;
+    int spill_fd = stream->spill_fd;
+    stream->map_start = stream->spill_start;
+    if (count > stream->view_capacity) {
+        StreamChunk* view = realloc(stream->view, stream->chunk_capacity * sizeof(StreamChunk));
+        if (!view) {
+            pthread_mutex_unlock(&stream->lock);
+            return false;
+        }
+        stream->view = view;
+        stream->view_capacity = stream->chunk_capacity;
+    }
+    if (count > stream->view_count) {
+        memcpy(stream->view + stream->view_count, stream->chunks + stream->view_count,
+               (count - stream->view_count) * sizeof(StreamChunk));
+    }
+    pthread_mutex_unlock(&stream->lock);
+
+    // Grow the spill mapping before exposing chunks that live in it.
+    if (spill_size > stream->map_size) {
+        char* map = mmap(NULL, (size_t)spill_size, PROT_READ, MAP_SHARED, spill_fd, 0);
+        if (map == MAP_FAILED) {
+            LOG_INFO("Could not map the spill file: %s", strerror(errno));
+            return false;
+        }
+        if (stream->map) munmap(stream->map, stream->map_size);
+        stream->map = map;
+        stream->map_size = (size_t)spill_size;
+    }
+
+    bool changed = count > stream->view_count;
+    for (size_t i = stream->view_count; i < count; i++) {
+        const StreamChunk* chunk = &stream->view[i];
+        stream->line_count += chunk->line_count;
+        stream->size += chunk->size;
+        if (chunk->max_line_len > stream->max_line_len) stream->max_line_len = chunk->max_line_len;
+    }
+    stream->view_count = count;
+    stream->view_is_eof = is_eof;
+    stream->view_is_truncated = is_truncated;
+    return changed || is_eof;
+}
+
+/**
+ * @brief Returns a line of the stream.
+ */
+const char* stream_input_get_line(const StreamInput* stream, size_t line, size_t* len) {
+    *len = 0;
+    if (line >= stream->line_count) return NULL;
+
+    // Binary search for the chunk holding the line.
+    size_t low = 0, high = stream->view_count;
+    while (high - low > 1) {
+        size_t mid = low + (high - low) / 2;
+        if (stream->view[mid].first_line <= line) low = mid; else high = mid;
+    }
+    const StreamChunk* chunk = &stream->view[low];
+    const char* base = chunk->data ? chunk->data : stream->map + (chunk->offset - stream->map_start);
+
+    size_t idx = line - chunk->first_line;
+    size_t start = chunk->line_offsets[idx];
+    size_t end = (idx + 1 < chunk->line_count) ? chunk->line_offsets[idx + 1] - 1 : chunk->size;
+    if (idx + 1 == chunk->line_count && end > start && base[end - 1] == '\n') end--;
+    *len = end - start;
+    return base + start;
+}
+
+/**
+ * @brief Returns true while the reader may still publish more data.
+ */
+bool stream_input_is_reading(const StreamInput* stream) {
+    return !stream->view_is_eof;
+}
+
+/**
+ * @brief Stops the reader and frees the stream, including its spill file.
+ */
+void stream_input_free(StreamInput* stream) {
+    if (!stream) return;
+    if (stream->has_thread) {
+        pthread_mutex_lock(&stream->lock);
+        stream->cancel = true;
+        pthread_mutex_unlock(&stream->lock);
+        pthread_join(stream->thread, NULL);
+        pthread_mutex_destroy(&stream->lock);
+    }
+    for (size_t i = 0; i < stream->chunk_count; i++) {
+        free(stream->chunks[i].data);
+        free(stream->chunks[i].line_offsets);
+    }
+    free(stream->chunks);
+    free(stream->view);
+    if (stream->map) munmap(stream->map, stream->map_size);
+    if (stream->spill_fd >= 0) close(stream->spill_fd);
+    if (stream->fd >= 0) close(stream->fd);
+    memset(stream, 0, sizeof(*stream));
+    stream->fd = -1;
+    stream->spill_fd = -1;
+}
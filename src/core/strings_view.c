@@ -0,0 +1,365 @@
+/**
+ * @file strings_view.c
+ * @author Zuhaitz (original)
+ * @brief Implements the strings view, found by classifying the mapped bytes in the background.
+ */
+#include "core/strings_view.h"
+#include "utils/logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/** @brief Odd bytes are never printable, so a padded block gains no character. */
+#define PADDING_BYTE 0x01
+
+// **Classifier**
+
+/**
+ * @brief Sets a bit for each printable byte of a 64-byte block, and one for each zero byte.
+ *
+ * Printable means from 0x20 to 0x7E, or a tab, as in strings(1).
+ */
+static void classify_block(const unsigned char* block, uint64_t* printable, uint64_t* zero) {
+#ifdef __SSE2__
+    const __m128i space = _mm_set1_epi8(0x1F);
+    const __m128i tilde = _mm_set1_epi8(0x7F);
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i nul = _mm_setzero_si128();
+    uint64_t p = 0, z = 0;
+    for (int i = 0; i < 4; i++) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(block + 16 * i));
+        // Bytes from 0x80 are negative as signed, so they fail the first comparison.
+        __m128i text = _mm_and_si128(_mm_cmpgt_epi8(bytes, space), _mm_cmplt_epi8(bytes, tilde));
+        text = _mm_or_si128(text, _mm_cmpeq_epi8(bytes, tab));
+        p |= (uint64_t)(uint16_t)_mm_movemask_epi8(text) << (16 * i);
+        z |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, nul)) << (16 * i);
+    }
+    *printable = p;
+    *zero = z;
+#else
+    uint64_t p = 0, z = 0;
+    for (int i = 0; i < 64; i++) {
+        unsigned char c = block[i];
+        if ((c >= 0x20 && c < 0x7F) || c == '\t') p |= (uint64_t)1 << i;
+        if (c == 0) z |= (uint64_t)1 << i;
+    }
+    *printable = p;
+    *zero = z;
+#endif
+}
+
+// **Background Scan**
+
+/**
+ * @struct RunTracker
+ * @brief Follows one kind of run across the bitmasks of consecutive blocks.
+ */
+typedef struct {
+    uint64_t last_mask;         /**< The mask of the previous block, for the bit carried into this one. */
+    uint64_t start;             /**< Where the open run started. */
+    bool open;                  /**< True while a run is open. */
+    bool wide;                  /**< True if the masks cover UTF-16LE characters, two bits each. */
+} RunTracker;
+
+/**
+ * @struct ScanBatch
+ * @brief The runs found since the last publication.
+ */
+typedef struct {
+    StringRun* runs;
+    size_t count;
+    size_t capacity;
+    bool failed;                /**< Set if a run could not be stored. */
+} ScanBatch;
+
+/**
+ * @brief Records a run that has ended, if it is long enough.
+ */
+static void batch_add(ScanBatch* batch, const RunTracker* tracker, uint64_t end) {
+    uint64_t length = (end - tracker->start) / (tracker->wide ? 2 : 1);
+    if (length < STRINGS_VIEW_MIN_LEN) return;
+    if (batch->count == batch->capacity) {
+        size_t new_capacity = batch->capacity ? batch->capacity * 2 : 256;
+        StringRun* new_runs = realloc(batch->runs, new_capacity * sizeof(StringRun));
+        if (!new_runs) {
+            batch->failed = true;
+            return;
+        }
+        batch->runs = new_runs;
+        batch->capacity = new_capacity;
+    }
+    StringRun* run = &batch->runs[batch->count++];
+    run->offset = tracker->start;
+    run->length = length > UINT32_MAX ? UINT32_MAX : (uint32_t)length;
+    run->wide = tracker->wide;
+}
+
+/**
+ * @brief Opens and closes runs where the mask of a block changes from the bit before.
+ *
+ * A block that is all in or all out of the current state has no transition
+ * and costs a single comparison.
+ */
+static void track_runs(RunTracker* tracker, uint64_t mask, uint64_t base, ScanBatch* batch) {
+    uint64_t transitions = mask ^ ((mask << 1) | (tracker->last_mask >> 63));
+    tracker->last_mask = mask;
+    while (transitions) {
+        int bit = __builtin_ctzll(transitions);
+        transitions &= transitions - 1;
+        if ((mask >> bit) & 1) {
+            tracker->start = base + (uint64_t)bit;
+            tracker->open = true;
+        } else {
+            batch_add(batch, tracker, base + (uint64_t)bit);
+            tracker->open = false;
+        }
+    }
+}
+
+/** @brief Orders runs by offset. */
+static int compare_runs(const void* a, const void* b) {
+    const StringRun* x = a;
+    const StringRun* y = b;
+    return (x->offset > y->offset) - (x->offset < y->offset);
+}
+
+/**
+ * @brief Hands the runs found so far to the UI thread.
+ * @return False if the scan should stop.
+ */
+static bool publish(StringsView* view, ScanBatch* batch, size_t scanned, size_t* total) {
+    // Runs are found where they end; in file order they are sorted by where they start.
+    qsort(batch->runs, batch->count, sizeof(StringRun), compare_runs);
+    size_t wanted = batch->count;
+    if (*total + wanted > STRINGS_VIEW_MAX_RUNS) wanted = STRINGS_VIEW_MAX_RUNS - *total;
+
+    pthread_mutex_lock(&view->lock);
+    if (wanted > 0 && view->found_count + wanted > view->found_capacity) {
+        size_t new_capacity = view->found_capacity ? view->found_capacity : 256;
+        while (new_capacity < view->found_count + wanted) new_capacity *= 2;
+        StringRun* new_found = realloc(view->found, new_capacity * sizeof(StringRun));
+        if (new_found) {
+            view->found = new_found;
+            view->found_capacity = new_capacity;
+        } else {
+            batch->failed = true;
+        }
+    }
+    if (!batch->failed) {
+        memcpy(view->found + view->found_count, batch->runs, wanted * sizeof(StringRun));
+        view->found_count += wanted;
+        *total += wanted;
+    }
+    view->scanned = scanned;
+    if (*total >= STRINGS_VIEW_MAX_RUNS) view->truncated = true;
+    bool keep_going = !view->cancel && !view->truncated && !batch->failed;
+    pthread_mutex_unlock(&view->lock);
+    batch->count = 0;
+    return keep_going;
+}
+
+/**
+ * @brief Classifies the file 64 bytes at a time and collects its runs.
+ *
+ * Each block gives three masks to follow: printable bytes for ASCII runs,
+ * and printable bytes followed by a zero byte, at even and at odd offsets,
+ * for UTF-16LE runs of either alignment. A UTF-16LE character sets both of
+ * its bits, so its runs are contiguous like ASCII ones.
+ *
+ * Holes are zeros: the first whole block of one closes every run, and the
+ * blocks after it are skipped up to the last one before the data resumes.
+ */
+static void* strings_worker(void* arg) {
+    StringsView* view = arg;
+    const uint64_t even = 0x5555555555555555ULL;
+    RunTracker ascii = {0};
+    RunTracker wide_even = { .wide = true };
+    RunTracker wide_odd = { .wide = true };
+    ScanBatch batch = {0};
+    size_t total = 0;
+    bool keep_going = true;
+    uint64_t last_odd = 0;
+    size_t hole = 0;
+
+    size_t base = 0;
+    for (; base < view->size && keep_going; base += 64) {
+        while (hole < view->hole_count && view->holes[hole].offset + view->holes[hole].length <= base) hole++;
+        if (hole < view->hole_count) {
+            size_t first_zero_block = (view->holes[hole].offset + 63) & ~(size_t)63;
+            size_t data_block = (view->holes[hole].offset + view->holes[hole].length) & ~(size_t)63;
+            if (base > first_zero_block && data_block > base) {
+                base = data_block;
+                if (base >= view->size) break;
+            }
+        }
+
+        unsigned char tail[64];
+        const unsigned char* block = view->data + base;
+        if (view->size - base < 64) {
+            memset(tail, PADDING_BYTE, sizeof(tail));
+            memcpy(tail, block, view->size - base);
+            block = tail;
+        }
+        uint64_t printable, zero;
+        classify_block(block, &printable, &zero);
+        uint64_t next_zero = base + 64 < view->size && view->data[base + 64] == 0;
+        uint64_t chars = printable & ((zero >> 1) | (next_zero << 63));
+
+        track_runs(&ascii, printable, base, &batch);
+        uint64_t even_chars = chars & even;
+        track_runs(&wide_even, even_chars | (even_chars << 1), base, &batch);
+        uint64_t odd_chars = chars & ~even;
+        track_runs(&wide_odd, odd_chars | (odd_chars << 1) | (last_odd >> 63), base, &batch);
+        last_odd = odd_chars;
+
+        if ((base + 64) % STRINGS_VIEW_PUBLISH_BYTES == 0) keep_going = publish(view, &batch, base + 64, &total);
+    }
+    if (keep_going) {
+        // The padding closes runs in a partial last block; a full one leaves them open.
+        if (ascii.open) batch_add(&batch, &ascii, view->size);
+        if (wide_even.open) batch_add(&batch, &wide_even, view->size);
+        if (wide_odd.open) batch_add(&batch, &wide_odd, view->size);
+        publish(view, &batch, view->size, &total);
+    }
+    free(batch.runs);
+
+    pthread_mutex_lock(&view->lock);
+    view->finished = true;
+    pthread_mutex_unlock(&view->lock);
+    LOG_INFO("Found %zu strings in %zu bytes.", total, view->size);
+    return NULL;
+}
+
+// **Public API**
+
+/**
+ * @brief Starts finding the runs of printable text in a mapped file.
+ */
+FatResult strings_view_start(StringsView* view, const char* data, size_t size, const FileHole* holes,
+                             size_t hole_count, int offset_digits) {
+    memset(view, 0, sizeof(*view));
+    view->data = (const unsigned char*)data;
+    view->size = size;
+    view->holes = holes;
+    view->hole_count = hole_count;
+    view->offset_digits = offset_digits;
+    pthread_mutex_init(&view->lock, NULL);
+    if (pthread_create(&view->thread, NULL, strings_worker, view) == 0) {
+        view->has_thread = true;
+    } else {
+        LOG_INFO("Could not start the strings thread; scanning on this one.");
+        strings_worker(view);
+        strings_view_poll(view);
+    }
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Adopts the runs found since the last call.
+ */
+bool strings_view_poll(StringsView* view) {
+    if (view->done) return false;
+    size_t old_count = view->count;
+    size_t old_scanned = view->scanned_done;
+
+    pthread_mutex_lock(&view->lock);
+    if (view->found_count > 0 && !view->failed) {
+        if (view->count + view->found_count > view->capacity) {
+            size_t new_capacity = view->capacity ? view->capacity : 256;
+            while (new_capacity < view->count + view->found_count) new_capacity *= 2;
+            StringRun* new_runs = realloc(view->runs, new_capacity * sizeof(StringRun));
+            if (new_runs) {
+                view->runs = new_runs;
+                view->capacity = new_capacity;
+            } else {
+                view->failed = true;
+                view->cancel = true;
+            }
+        }
+        if (!view->failed) {
+            memcpy(view->runs + view->count, view->found, view->found_count * sizeof(StringRun));
+            view->count += view->found_count;
+            view->found_count = 0;
+        }
+    }
+    view->scanned_done = view->scanned;
+    view->done = view->failed || view->finished;
+    pthread_mutex_unlock(&view->lock);
+
+    return view->count != old_count || view->scanned_done != old_scanned || view->done;
+}
+
+/**
+ * @brief Returns true until the whole file has been scanned and every run adopted.
+ */
+bool strings_view_is_running(const StringsView* view) {
+    return !view->done;
+}
+
+/**
+ * @brief Formats the row of a run.
+ */
+const char* strings_view_get_row(StringsView* view, size_t idx, size_t* len) {
+    if (idx >= view->count) {
+        *len = 0;
+        return NULL;
+    }
+    const StringRun* run = &view->runs[idx];
+    int pos = snprintf(view->row, sizeof(view->row), "%0*llX  %c  ", view->offset_digits,
+                       (unsigned long long)run->offset, run->wide ? 'W' : 'A');
+    size_t shown = run->length < STRINGS_VIEW_TEXT_LEN ? run->length : STRINGS_VIEW_TEXT_LEN;
+    const unsigned char* text = view->data + run->offset;
+    for (size_t i = 0; i < shown && pos < STRINGS_ROW_MAX_BYTES - 1; i++) {
+        unsigned char c = run->wide ? text[2 * i] : text[i];
+        view->row[pos++] = c == '\t' ? ' ' : (char)c;
+    }
+    view->row[pos] = '\0';
+    *len = (size_t)pos;
+    return view->row;
+}
+
+/**
+ * @brief Finds the first run that ends after a file offset.
+ */
+size_t strings_view_find_offset(const StringsView* view, uint64_t offset) {
+    size_t low = 0, high = view->count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        const StringRun* run = &view->runs[mid];
+        uint64_t end = run->offset + (uint64_t)run->length * (run->wide ? 2 : 1);
+        if (end <= offset) low = mid + 1; else high = mid;
+    }
+    return low;
+}
+
+/**
+ * @brief Returns the heap memory held by the runs.
+ */
+size_t strings_view_memory_usage(StringsView* view) {
+    size_t usage = view->capacity * sizeof(StringRun);
+    pthread_mutex_lock(&view->lock);
+    usage += view->found_capacity * sizeof(StringRun);
+    pthread_mutex_unlock(&view->lock);
+    return usage;
+}
+
+/**
+ * @brief Stops the background scan and frees the runs.
+ */
+void strings_view_free(StringsView* view) {
+    if (!view) return;
+    if (view->has_thread) {
+        pthread_mutex_lock(&view->lock);
+        view->cancel = true;
+        pthread_mutex_unlock(&view->lock);
+        pthread_join(view->thread, NULL);
+    }
+    pthread_mutex_destroy(&view->lock);
+    free(view->found);
+    free(view->runs);
+    memset(view, 0, sizeof(*view));
+}
@@ -0,0 +1,723 @@
+/**
+ * @file table_view.c
+ * @author Zuhaitz (original)
+ * @brief Implements delimiter detection, lazy field parsing and background sorting of tables.
+ */
+#include "core/table_view.h"
+#include "utils/logger.h"
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+/** @brief The number of lines examined to guess the delimiter. */
+#define TABLE_DELIMITER_SAMPLE_LINES 64
+
+/** @brief The number of lines sampled from the start, and again across the file, for column widths. */
+#define TABLE_WIDTH_SAMPLE_LINES 500
+
+/** @brief The number of rows sorted in memory before a run is spilled to disk. */
+#define TABLE_SORT_RUN_ROWS (1 << 18)
+
+/** @brief The number of row numbers read at a time from each run while merging. */
+#define TABLE_SORT_READ_ROWS 4096
+
+/** @brief The longest field parsed as a number when sorting. */
+#define TABLE_SORT_NUMBER_BYTES 64
+
+// **Detection**
+
+/**
+ * @brief Returns true if a file should be shown as a table.
+ */
+bool table_view_detect(const char* path, const char* mime) {
+    if (mime && (strcmp(mime, "text/csv") == 0 || strcmp(mime, "application/csv") == 0 ||
+                 strcmp(mime, "text/tab-separated-values") == 0)) {
+        return true;
+    }
+    const char* dot = path ? strrchr(path, '.') : NULL;
+    if (!dot || strchr(dot, '/')) return false;
+    return strcasecmp(dot, ".csv") == 0 || strcasecmp(dot, ".tsv") == 0 || strcasecmp(dot, ".tab") == 0;
+}
+
+// **Field Parsing**
+
+/**
+ * @brief Returns a line without its trailing carriage return.
+ */
+static const char* get_line(const LineIndex* text, size_t line, size_t* len) {
+    const char* data = line_index_get(text, line, len);
+    if (data && *len > 0 && data[*len - 1] == '\r') (*len)--;
+    return data;
+}
+
+/**
+ * @brief Returns the offset just past the field starting at `pos`.
+ *
+ * A field opening with a double quote runs to its closing quote, skipping
+ * delimiters and doubled quotes on the way.
+ */
+static size_t field_end(const char* line, size_t len, size_t pos, char delimiter) {
+    size_t i = pos;
+    if (i < len && line[i] == '"') {
+        i++;
+        while (i < len) {
+            if (line[i] == '"') {
+                if (i + 1 < len && line[i + 1] == '"') {
+                    i += 2;
+                    continue;
+                }
+                i++;
+                break;
+            }
+            i++;
+        }
+    }
+    while (i < len && line[i] != delimiter) i++;
+    return i;
+}
+
+/**
+ * @brief Counts the fields of a line.
+ */
+static size_t count_fields(const char* line, size_t len, char delimiter) {
+    size_t count = 1;
+    for (size_t pos = field_end(line, len, 0, delimiter); pos < len; pos = field_end(line, len, pos + 1, delimiter)) {
+        count++;
+    }
+    return count;
+}
+
+/**
+ * @brief Locates one field of a line.
+ * @return False if the line has fewer fields.
+ */
+static bool find_field(const char* line, size_t len, char delimiter, size_t column, size_t* start, size_t* field_len) {
+    size_t pos = 0;
+    for (size_t i = 0; i < column; i++) {
+        pos = field_end(line, len, pos, delimiter);
+        if (pos >= len) return false;
+        pos++;
+    }
+    *start = pos;
+    *field_len = field_end(line, len, pos, delimiter) - pos;
+    return true;
+}
+
+/**
+ * @brief Strips the surrounding quotes of a field, if it has them.
+ */
+static void unquote(const char** field, size_t* len) {
+    if (*len >= 2 && (*field)[0] == '"' && (*field)[*len - 1] == '"') {
+        (*field)++;
+        *len -= 2;
+    }
+}
+
+/**
+ * @brief Returns the fields of a line, parsing it if it is not cached.
+ */
+const TableField* table_view_fields(TableView* view, size_t line, size_t* count) {
+    *count = 0;
+    size_t len;
+    const char* data = get_line(&view->text, line, &len);
+    if (!data) return NULL;
+
+    TableFieldCache* slot = &view->cache[line % TABLE_CACHE_LINES];
+    if (slot->line == line) {
+        *count = slot->count;
+        return slot->fields;
+    }
+
+    slot->line = SIZE_MAX;
+    slot->count = 0;
+    size_t pos = 0;
+    while (1) {
+        if (slot->count == slot->capacity) {
+            size_t new_capacity = slot->capacity ? slot->capacity * 2 : 16;
+            TableField* new_fields = realloc(slot->fields, new_capacity * sizeof(TableField));
+            if (!new_fields) return NULL;
+            slot->fields = new_fields;
+            slot->capacity = new_capacity;
+        }
+        size_t end = field_end(data, len, pos, view->delimiter);
+        // Lines are capped well below 4 GiB by the renderer, but offsets past that are clamped.
+        slot->fields[slot->count].start = pos > UINT32_MAX ? UINT32_MAX : (uint32_t)pos;
+        slot->fields[slot->count].len = end - pos > UINT32_MAX ? UINT32_MAX : (uint32_t)(end - pos);
+        slot->count++;
+        if (end >= len) break;
+        pos = end + 1;
+    }
+    slot->line = line;
+    *count = slot->count;
+    return slot->fields;
+}
+
+/**
+ * @brief Writes the displayable text of a cell.
+ */
+size_t table_view_cell(TableView* view, size_t line, size_t column, char* out, size_t size) {
+    if (size == 0) return 0;
+    out[0] = '\0';
+    size_t count;
+    const TableField* fields = table_view_fields(view, line, &count);
+    if (!fields || column >= count) return 0;
+
+    size_t line_len;
+    const char* field = get_line(&view->text, line, &line_len) + fields[column].start;
+    size_t len = fields[column].len;
+    bool quoted = len >= 2 && field[0] == '"' && field[len - 1] == '"';
+    unquote(&field, &len);
+
+    size_t written = 0;
+    for (size_t i = 0; i < len; ) {
+        unsigned char c = (unsigned char)field[i];
+        size_t char_len = c < 0x80 ? 1 : (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xE ? 3 : (c >> 3) == 0x1E ? 4 : 1;
+        if (i + char_len > len) char_len = len - i;
+        if (written + char_len >= size) break; // Never split a character
+        if (quoted && c == '"' && i + 1 < len && field[i + 1] == '"') {
+            out[written++] = '"';
+            i += 2;
+            continue;
+        }
+        if (c < 0x20 || c == 0x7F) {
+            out[written++] = ' ';
+        } else {
+            memcpy(out + written, field + i, char_len);
+            written += char_len;
+        }
+        i += char_len;
+    }
+    out[written] = '\0';
+    return written;
+}
+
+// **Layout**
+
+/**
+ * @brief Guesses the delimiter from the first lines of the file.
+ *
+ * The candidate splitting the most sampled lines into the same number of
+ * fields as the header wins, with ties going to the one producing more fields.
+ * Returns '\0' if no candidate splits the header into at least two fields.
+ */
+static char detect_delimiter(const LineIndex* text) {
+    static const char candidates[] = { ',', '\t', ';', '|' };
+    char best = '\0';
+    size_t best_consistent = 0;
+    size_t best_fields = 1;
+    size_t sample = text->count < TABLE_DELIMITER_SAMPLE_LINES ? text->count : TABLE_DELIMITER_SAMPLE_LINES;
+
+    for (size_t c = 0; c < sizeof(candidates); c++) {
+        size_t len;
+        const char* header = get_line(text, 0, &len);
+        if (!header) break;
+        size_t fields = count_fields(header, len, candidates[c]);
+        if (fields < 2) continue;
+        size_t consistent = 0;
+        for (size_t i = 1; i < sample; i++) {
+            const char* line = get_line(text, i, &len);
+            if (line && count_fields(line, len, candidates[c]) == fields) consistent++;
+        }
+        if (consistent > best_consistent || (consistent == best_consistent && fields > best_fields)) {
+            best = candidates[c];
+            best_consistent = consistent;
+            best_fields = fields;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Returns the number of screen cells taken by UTF-8 text, one per character.
+ */
+static size_t display_width(const char* text) {
+    size_t width = 0;
+    for (; *text; text++) {
+        if (((unsigned char)*text & 0xC0) != 0x80) width++;
+    }
+    return width;
+}
+
+/**
+ * @brief Widens the columns to fit a sampled line.
+ */
+static FatResult sample_line(TableView* view, size_t line) {
+    size_t count;
+    if (!table_view_fields(view, line, &count)) return FAT_SUCCESS;
+    if (count > view->column_count) {
+        uint16_t* new_widths = realloc(view->widths, count * sizeof(uint16_t));
+        if (!new_widths) return FAT_ERROR_MEMORY;
+        memset(new_widths + view->column_count, 0, (count - view->column_count) * sizeof(uint16_t));
+        view->widths = new_widths;
+        view->column_count = count;
+    }
+    char cell[TABLE_MAX_COLUMN_WIDTH * 4 + 1];
+    for (size_t c = 0; c < count; c++) {
+        table_view_cell(view, line, c, cell, sizeof(cell));
+        size_t width = display_width(cell);
+        if (width > TABLE_MAX_COLUMN_WIDTH) width = TABLE_MAX_COLUMN_WIDTH;
+        if (width > view->widths[c]) view->widths[c] = (uint16_t)width;
+    }
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Opens a file, guesses its delimiter and samples its column widths.
+ */
+FatResult table_view_open(TableView* view, const char* path) {
+    memset(view, 0, sizeof(*view));
+    line_index_init(&view->text);
+    for (size_t i = 0; i < TABLE_CACHE_LINES; i++) view->cache[i].line = SIZE_MAX;
+    view->sort_column = -1;
+
+    FatResult res = line_index_open(&view->text, path);
+    if (res != FAT_SUCCESS) return res;
+
+    const char* dot = strrchr(path, '.');
+    if (dot && (strcasecmp(dot, ".tsv") == 0 || strcasecmp(dot, ".tab") == 0)) {
+        view->delimiter = '\t';
+    } else {
+        view->delimiter = detect_delimiter(&view->text);
+        if (view->delimiter == '\0') {
+            // Taken for a table by its MIME type alone (e.g. a UTF-16 log), but it has one column.
+            LOG_INFO("'%s' has no delimiter splitting its header, so it is not a table", path);
+            table_view_free(view);
+            return FAT_ERROR_UNSUPPORTED;
+        }
+    }
+    view->row_count = view->text.count > 0 ? view->text.count - 1 : 0;
+
+    // The header, the first rows and rows spread evenly over the rest of the file.
+    res = sample_line(view, 0);
+    for (size_t i = 1; res == FAT_SUCCESS && i <= view->row_count && i <= TABLE_WIDTH_SAMPLE_LINES; i++) {
+        res = sample_line(view, i);
+    }
+    if (view->row_count > TABLE_WIDTH_SAMPLE_LINES) {
+        size_t step = view->row_count / TABLE_WIDTH_SAMPLE_LINES;
+        for (size_t i = TABLE_WIDTH_SAMPLE_LINES + step; res == FAT_SUCCESS && i <= view->row_count; i += step) {
+            res = sample_line(view, i);
+        }
+    }
+    if (res != FAT_SUCCESS) {
+        table_view_free(view);
+        return res;
+    }
+
+    LOG_INFO("Opened '%s' as a table: %zu rows, %zu columns, delimiter 0x%02x",
+             path, view->row_count, view->column_count, (unsigned char)view->delimiter);
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Returns the line of the file shown on a row.
+ */
+size_t table_view_line(const TableView* view, size_t row) {
+    return view->order ? view->order[row] : row + 1;
+}
+
+/**
+ * @brief Finds a column by 1-based number or by header name.
+ */
+int table_view_find_column(TableView* view, const char* text) {
+    while (isspace((unsigned char)*text)) text++;
+    if (*text == '\0') return -1;
+
+    char* end;
+    unsigned long number = strtoul(text, &end, 10);
+    if (*end == '\0' && isdigit((unsigned char)*text)) {
+        return number >= 1 && number <= view->column_count ? (int)(number - 1) : -1;
+    }
+
+    size_t text_len = strlen(text);
+    char name[256];
+    int prefix_match = -1;
+    for (size_t c = 0; c < view->column_count && c <= INT32_MAX; c++) {
+        table_view_cell(view, 0, c, name, sizeof(name));
+        if (strcasecmp(name, text) == 0) return (int)c;
+        if (prefix_match < 0 && strncasecmp(name, text, text_len) == 0) prefix_match = (int)c;
+    }
+    return prefix_match;
+}
+
+// **Sorting**
+
+/**
+ * @struct TableSort
+ * @brief The state shared between the UI and a sorting thread.
+ */
+struct TableSort {
+    LineIndex text;         /**< A copy of the view's index. The thread only reads through it. */
+    char delimiter;         /**< The field separator. */
+    size_t column;          /**< The column to sort by. */
+    bool descending;        /**< The direction of the sort. */
+    size_t row_count;       /**< The number of rows to sort. */
+    size_t* order;          /**< The sorted lines, owned by the job until adopted. */
+    pthread_t thread;       /**< The sorting thread. */
+
+    // **Shared (protected by `lock`)**
+    pthread_mutex_t lock;
+    bool cancel;            /**< Set to ask the thread to stop. */
+    bool done;              /**< Set when the thread has finished. */
+    bool failed;            /**< Set if the sort could not be completed. */
+};
+
+/**
+ * @struct SortKey
+ * @brief The sort key of one row.
+ */
+typedef struct {
+    const char* text;   /**< The unquoted field, pointing into the file. */
+    size_t len;         /**< The length of `text`. */
+    double number;      /**< The value of the field if it is numeric. */
+    bool numeric;       /**< True if the whole field is a number. */
+    size_t line;        /**< The line the key was read from. */
+} SortKey;
+
+/**
+ * @brief Reads the sort key of a line.
+ */
+static void make_key(const TableSort* job, size_t line, SortKey* key) {
+    size_t len;
+    const char* data = get_line(&job->text, line, &len);
+    size_t start, field_len;
+    key->line = line;
+    key->numeric = false;
+    if (!data || !find_field(data, len, job->delimiter, job->column, &start, &field_len)) {
+        key->text = "";
+        key->len = 0;
+        return;
+    }
+    key->text = data + start;
+    key->len = field_len;
+    unquote(&key->text, &key->len);
+
+    if (key->len > 0 && key->len < TABLE_SORT_NUMBER_BYTES) {
+        char number[TABLE_SORT_NUMBER_BYTES];
+        memcpy(number, key->text, key->len);
+        number[key->len] = '\0';
+        char* end;
+        double value = strtod(number, &end);
+        while (isspace((unsigned char)*end)) end++;
+        if (end != number && *end == '\0' && isfinite(value)) {
+            key->number = value;
+            key->numeric = true;
+        }
+    }
+}
+
+/**
+ * @brief Orders two keys in ascending order, ignoring their lines.
+ */
+static int compare_values(const SortKey* a, const SortKey* b) {
+    if (a->numeric != b->numeric) return a->numeric ? -1 : 1;
+    if (a->numeric) return (a->number > b->number) - (a->number < b->number);
+    size_t len = a->len < b->len ? a->len : b->len;
+    int cmp = memcmp(a->text, b->text, len);
+    if (cmp != 0) return cmp;
+    return (a->len > b->len) - (a->len < b->len);
+}
+
+/**
+ * @brief Orders two keys, keeping equal keys in file order.
+ */
+static int compare_keys(const SortKey* a, const SortKey* b, bool descending) {
+    int cmp = compare_values(a, b);
+    if (cmp != 0) return descending ? -cmp : cmp;
+    return (a->line > b->line) - (a->line < b->line);
+}
+
+/** @brief qsort comparator for ascending runs. */
+static int compare_ascending(const void* a, const void* b) {
+    return compare_keys(a, b, false);
+}
+
+/** @brief qsort comparator for descending runs. */
+static int compare_descending(const void* a, const void* b) {
+    return compare_keys(a, b, true);
+}
+
+/**
+ * @brief Returns true if the job has been asked to stop.
+ */
+static bool is_cancelled(TableSort* job) {
+    pthread_mutex_lock(&job->lock);
+    bool cancel = job->cancel;
+    pthread_mutex_unlock(&job->lock);
+    return cancel;
+}
+
+/**
+ * @struct RunReader
+ * @brief The read position within one spilled run while merging.
+ */
+typedef struct {
+    off_t offset;                       /**< The file offset of the next unread row. */
+    size_t remaining;                   /**< The rows not yet read from the file. */
+    size_t buffer[TABLE_SORT_READ_ROWS];/**< Rows read ahead. */
+    size_t buffer_len;                  /**< The number of rows in `buffer`. */
+    size_t buffer_pos;                  /**< The next row of `buffer` to merge. */
+    SortKey head;                       /**< The key of the run's smallest unmerged row. */
+} RunReader;
+
+/**
+ * @brief Advances a run to its next row.
+ * @return False when the run is exhausted or cannot be read.
+ */
+static bool run_next(const TableSort* job, int fd, RunReader* run) {
+    if (run->buffer_pos == run->buffer_len) {
+        if (run->remaining == 0) return false;
+        size_t rows = run->remaining < TABLE_SORT_READ_ROWS ? run->remaining : TABLE_SORT_READ_ROWS;
+        ssize_t n = pread(fd, run->buffer, rows * sizeof(size_t), run->offset);
+        if (n != (ssize_t)(rows * sizeof(size_t))) return false;
+        run->offset += n;
+        run->remaining -= rows;
+        run->buffer_len = rows;
+        run->buffer_pos = 0;
+    }
+    make_key(job, run->buffer[run->buffer_pos++], &run->head);
+    return true;
+}
+
+/**
+ * @brief Restores the heap property below `i` in a heap of runs ordered by head key.
+ */
+static void heap_sift_down(RunReader** heap, size_t count, size_t i, bool descending) {
+    while (1) {
+        size_t smallest = i;
+        size_t left = 2 * i + 1, right = left + 1;
+        if (left < count && compare_keys(&heap[left]->head, &heap[smallest]->head, descending) < 0) smallest = left;
+        if (right < count && compare_keys(&heap[right]->head, &heap[smallest]->head, descending) < 0) smallest = right;
+        if (smallest == i) return;
+        RunReader* tmp = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = tmp;
+        i = smallest;
+    }
+}
+
+/**
+ * @brief Merges the spilled runs into `job->order`.
+ */
+static bool merge_runs(TableSort* job, int fd, size_t run_count) {
+    RunReader* runs = malloc(run_count * sizeof(RunReader));
+    RunReader** heap = malloc(run_count * sizeof(RunReader*));
+    if (!runs || !heap) {
+        free(runs);
+        free(heap);
+        return false;
+    }
+
+    size_t heap_count = 0;
+    bool ok = true;
+    for (size_t r = 0; r < run_count; r++) {
+        size_t first = r * TABLE_SORT_RUN_ROWS;
+        size_t rows = job->row_count - first < TABLE_SORT_RUN_ROWS ? job->row_count - first : TABLE_SORT_RUN_ROWS;
+        runs[r].offset = (off_t)(first * sizeof(size_t));
+        runs[r].remaining = rows;
+        runs[r].buffer_len = runs[r].buffer_pos = 0;
+        if (run_next(job, fd, &runs[r])) heap[heap_count++] = &runs[r];
+    }
+    for (size_t i = heap_count; i-- > 0; ) heap_sift_down(heap, heap_count, i, job->descending);
+
+    size_t out = 0;
+    while (heap_count > 0) {
+        if ((out & 65535) == 0 && is_cancelled(job)) {
+            ok = false;
+            break;
+        }
+        job->order[out++] = heap[0]->head.line;
+        if (!run_next(job, fd, heap[0])) heap[0] = heap[--heap_count];
+        heap_sift_down(heap, heap_count, 0, job->descending);
+    }
+    if (ok && out != job->row_count) ok = false; // A run could not be read back
+
+    free(runs);
+    free(heap);
+    return ok;
+}
+
+/**
+ * @brief Sorts runs of rows in memory, spills them to a temporary file and merges them.
+ */
+static void* sort_worker(void* arg) {
+    TableSort* job = arg;
+    bool ok = true;
+    int fd = -1;
+    size_t run_count = (job->row_count + TABLE_SORT_RUN_ROWS - 1) / TABLE_SORT_RUN_ROWS;
+    size_t run_capacity = job->row_count < TABLE_SORT_RUN_ROWS ? job->row_count : TABLE_SORT_RUN_ROWS;
+    SortKey* keys = malloc((run_capacity ? run_capacity : 1) * sizeof(SortKey));
+    size_t* lines = malloc((run_capacity ? run_capacity : 1) * sizeof(size_t));
+    if (!keys || !lines) ok = false;
+
+    if (ok && run_count > 1) {
+        const char* tmp_dir = getenv("TMPDIR");
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/fat-sort-XXXXXX", tmp_dir && *tmp_dir ? tmp_dir : "/tmp");
+        fd = mkstemp(path);
+        if (fd < 0) {
+            LOG_INFO("Could not create a file for sorting: %s", strerror(errno));
+            ok = false;
+        } else {
+            unlink(path);
+        }
+    }
+
+    for (size_t r = 0; ok && r < run_count; r++) {
+        if (is_cancelled(job)) {
+            ok = false;
+            break;
+        }
+        size_t first = r * TABLE_SORT_RUN_ROWS;
+        size_t rows = job->row_count - first < TABLE_SORT_RUN_ROWS ? job->row_count - first : TABLE_SORT_RUN_ROWS;
+        for (size_t i = 0; i < rows; i++) make_key(job, first + i + 1, &keys[i]);
+        qsort(keys, rows, sizeof(SortKey), job->descending ? compare_descending : compare_ascending);
+
+        if (run_count == 1) {
+            for (size_t i = 0; i < rows; i++) job->order[i] = keys[i].line;
+            break;
+        }
+        for (size_t i = 0; i < rows; i++) lines[i] = keys[i].line;
+        size_t bytes = rows * sizeof(size_t);
+        if (pwrite(fd, lines, bytes, (off_t)(first * sizeof(size_t))) != (ssize_t)bytes) {
+            LOG_INFO("Could not write a sorted run: %s", strerror(errno));
+            ok = false;
+        }
+    }
+    free(keys);
+    free(lines);
+
+    if (ok && run_count > 1) ok = merge_runs(job, fd, run_count);
+    if (fd >= 0) close(fd);
+
+    pthread_mutex_lock(&job->lock);
+    job->failed = !ok;
+    job->done = true;
+    pthread_mutex_unlock(&job->lock);
+    return NULL;
+}
+
+/**
+ * @brief Stops a sort and frees it.
+ */
+static void sort_free(TableSort* job) {
+    if (!job) return;
+    pthread_mutex_lock(&job->lock);
+    job->cancel = true;
+    pthread_mutex_unlock(&job->lock);
+    pthread_join(job->thread, NULL);
+    pthread_mutex_destroy(&job->lock);
+    free(job->order);
+    free(job);
+}
+
+/**
+ * @brief Starts sorting the rows by a column in the background.
+ */
+FatResult table_view_sort_start(TableView* view, size_t column, bool descending) {
+    sort_free(view->pending);
+    view->pending = NULL;
+    if (view->row_count == 0) return FAT_SUCCESS;
+
+    TableSort* job = calloc(1, sizeof(TableSort));
+    if (!job) return FAT_ERROR_MEMORY;
+    job->order = malloc(view->row_count * sizeof(size_t));
+    if (!job->order) {
+        free(job);
+        return FAT_ERROR_MEMORY;
+    }
+    job->text = view->text;
+    job->delimiter = view->delimiter;
+    job->column = column;
+    job->descending = descending;
+    job->row_count = view->row_count;
+    pthread_mutex_init(&job->lock, NULL);
+    if (pthread_create(&job->thread, NULL, sort_worker, job) != 0) {
+        pthread_mutex_destroy(&job->lock);
+        free(job->order);
+        free(job);
+        return FAT_ERROR_GENERIC;
+    }
+    view->pending = job;
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Adopts the result of a finished sort.
+ */
+bool table_view_sort_poll(TableView* view) {
+    TableSort* job = view->pending;
+    if (!job) return false;
+    pthread_mutex_lock(&job->lock);
+    bool done = job->done;
+    bool failed = job->failed;
+    pthread_mutex_unlock(&job->lock);
+    if (!done) return false;
+
+    view->pending = NULL;
+    if (failed) {
+        LOG_INFO("Sorting by column %zu failed", job->column + 1);
+        sort_free(job);
+        return false;
+    }
+    free(view->order);
+    view->order = job->order;
+    view->sort_column = (int)job->column;
+    view->sort_descending = job->descending;
+    job->order = NULL;
+    sort_free(job);
+    return true;
+}
+
+/**
+ * @brief Returns true while a sort is running.
+ */
+bool table_view_sort_is_running(const TableView* view) {
+    return view->pending != NULL;
+}
+
+/**
+ * @brief Cancels any running sort and restores the file order.
+ */
+void table_view_clear_sort(TableView* view) {
+    sort_free(view->pending);
+    view->pending = NULL;
+    free(view->order);
+    view->order = NULL;
+    view->sort_column = -1;
+    view->sort_descending = false;
+}
+
+/**
+ * @brief Returns the heap memory held by the view.
+ */
+size_t table_view_memory_usage(const TableView* view) {
+    size_t usage = line_index_memory_usage(&view->text);
+    usage += view->column_count * sizeof(uint16_t);
+    for (size_t i = 0; i < TABLE_CACHE_LINES; i++) usage += view->cache[i].capacity * sizeof(TableField);
+    if (view->order) usage += view->row_count * sizeof(size_t);
+    if (view->pending) usage += view->row_count * sizeof(size_t);
+    return usage;
+}
+
+/**
+ * @brief Stops any running sort and frees the view.
+ */
+void table_view_free(TableView* view) {
+    table_view_clear_sort(view);
+    for (size_t i = 0; i < TABLE_CACHE_LINES; i++) {
+        free(view->cache[i].fields);
+        view->cache[i].fields = NULL;
+        view->cache[i].count = view->cache[i].capacity = 0;
+        view->cache[i].line = SIZE_MAX;
+    }
+    free(view->widths);
+    view->widths = NULL;
+    view->column_count = 0;
+    view->row_count = 0;
+    line_index_free(&view->text);
+}
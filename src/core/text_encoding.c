@@ -0,0 +1,427 @@
+/**
+ * @file text_encoding.c
+ * @author Zuhaitz (original)
+ * @brief Implements the detection of text encodings and the streaming conversion to UTF-8.
+ */
+#include "core/text_encoding.h"
+#include "core/file_source.h"
+#include "utils/logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <iconv.h>
+
+/** @brief The UTF-8 of U+FFFD, which stands in for bytes that are not valid in the encoding. */
+static const char REPLACEMENT[] = "\xEF\xBF\xBD";
+
+/** @brief What Windows-1252 puts in 0x80-0x9F, where Latin-1 has control characters; 0 where it has nothing. */
+static const uint16_t WINDOWS_1252_HIGH[32] = {
+    0x20AC, 0,      0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+    0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0,      0x017D, 0,
+    0,      0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+    0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0,      0x017E, 0x0178
+};
+
+// **Names**
+
+/**
+ * @brief Returns the display name of an encoding.
+ */
+const char* text_encoding_name(TextEncoding encoding) {
+    switch (encoding) {
+        case TEXT_ENCODING_UTF8: return "UTF-8";
+        case TEXT_ENCODING_UTF16LE: return "UTF-16LE";
+        case TEXT_ENCODING_UTF16BE: return "UTF-16BE";
+        case TEXT_ENCODING_LATIN1: return "Latin-1";
+        case TEXT_ENCODING_SHIFT_JIS: return "Shift-JIS";
+        case TEXT_ENCODING_COUNT: break;
+    }
+    return "UTF-8";
+}
+
+// **Detection**
+
+/**
+ * @brief Returns true for the control characters of Latin-1, which text has no use for.
+ */
+static bool is_control_byte(unsigned char c) {
+    return (c < 0x20 && c != '\t' && c != '\n' && c != '\r') || (c >= 0x7F && c < 0xA0);
+}
+
+/**
+ * @brief Returns the length of the byte order mark of an encoding that text starts with, or 0.
+ */
+size_t text_encoding_bom_length(TextEncoding encoding, const char* data, size_t size) {
+    const unsigned char* p = (const unsigned char*)data;
+    switch (encoding) {
+        case TEXT_ENCODING_UTF8:
+            return size >= 3 && p[0] == 0xEF && p[1] == 0xBB && p[2] == 0xBF ? 3 : 0;
+        case TEXT_ENCODING_UTF16LE:
+            return size >= 2 && p[0] == 0xFF && p[1] == 0xFE ? 2 : 0;
+        case TEXT_ENCODING_UTF16BE:
+            return size >= 2 && p[0] == 0xFE && p[1] == 0xFF ? 2 : 0;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Counts the valid multibyte UTF-8 sequences and the invalid bytes, allowing a sequence cut off by the end of the sample.
+ */
+static void count_utf8(const unsigned char* p, size_t size, size_t* multibyte, size_t* invalid) {
+    *multibyte = 0;
+    *invalid = 0;
+    size_t i = 0;
+    while (i < size) {
+        unsigned char c = p[i];
+        size_t extra;
+        uint32_t min;
+        if (c < 0x80) {
+            i++;
+            continue;
+        } else if (c >= 0xC2 && c <= 0xDF) {
+            extra = 1;
+            min = 0x80;
+        } else if (c >= 0xE0 && c <= 0xEF) {
+            extra = 2;
+            min = 0x800;
+        } else if (c >= 0xF0 && c <= 0xF4) {
+            extra = 3;
+            min = 0x10000;
+        } else {
+            (*invalid)++;
+            i++;
+            continue;
+        }
+        uint32_t cp = c & (0x3F >> extra);
+        bool valid = true;
+        for (size_t k = 1; k <= extra && valid; k++) {
+            if (i + k >= size) return;
+            if ((p[i + k] & 0xC0) != 0x80) valid = false;
+            cp = (cp << 6) | (p[i + k] & 0x3F);
+        }
+        if (!valid || cp < min || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+            // Resynchronize on the next byte, which may start a character.
+            (*invalid)++;
+            i++;
+            continue;
+        }
+        (*multibyte)++;
+        i += extra + 1;
+    }
+}
+
+/**
+ * @brief Returns true if the high bytes pair up as Shift-JIS does.
+ *
+ * Latin-1 text makes pairs too, by accident, of an accented lowercase
+ * letter and the ASCII letter after it. Japanese text leads mostly with
+ * 0x81-0x9F (kana and the common kanji) and trails mostly with high bytes,
+ * which Latin-1 letters seldom do, and is required to.
+ */
+static bool looks_like_shift_jis(const unsigned char* p, size_t size) {
+    size_t pairs = 0, typical = 0, invalid = 0;
+    size_t i = 0;
+    while (i < size) {
+        unsigned char c = p[i];
+        if (c < 0x80 || (c >= 0xA1 && c <= 0xDF)) {
+            i++; // ASCII, or a half-width katakana
+            continue;
+        }
+        bool lead = (c >= 0x81 && c <= 0x9F) || (c >= 0xE0 && c <= 0xFC);
+        if (!lead) {
+            invalid++;
+            i++;
+            continue;
+        }
+        if (i + 1 >= size) break;
+        unsigned char trail = p[i + 1];
+        if (trail < 0x40 || trail == 0x7F || trail > 0xFC) {
+            invalid++;
+            i++;
+            continue;
+        }
+        pairs++;
+        if (c <= 0x9F || trail >= 0x80) typical++;
+        i += 2;
+    }
+    return pairs > 0 && invalid * 50 <= pairs && typical * 2 > pairs;
+}
+
+/**
+ * @brief Guesses the encoding of text from a sample of its head.
+ */
+TextEncoding text_encoding_detect(const char* data, size_t size, size_t* bom_length) {
+    if (bom_length) *bom_length = 0;
+    if (size > TEXT_ENCODING_SAMPLE_SIZE) size = TEXT_ENCODING_SAMPLE_SIZE;
+    const unsigned char* p = (const unsigned char*)data;
+
+    for (TextEncoding e = TEXT_ENCODING_UTF8; e <= TEXT_ENCODING_UTF16BE; e++) {
+        size_t bom = text_encoding_bom_length(e, data, size);
+        if (bom > 0) {
+            if (bom_length) *bom_length = bom;
+            return e;
+        }
+    }
+
+    // Without a mark, UTF-16 shows itself in its ASCII and Latin-1 characters, whose other byte is
+    // zero. Binary data has zeros in the same places, but also the control characters text has none of.
+    size_t units = size / 2;
+    if (units >= 4) {
+        size_t little = 0, big = 0, little_control = 0, big_control = 0;
+        for (size_t i = 0; i + 1 < size; i += 2) {
+            if (p[i + 1] == 0) {
+                if (is_control_byte(p[i])) little_control++; else little++;
+            }
+            if (p[i] == 0) {
+                if (is_control_byte(p[i + 1])) big_control++; else big++;
+            }
+        }
+        if (little * 4 >= units && little_control * 100 <= units) return TEXT_ENCODING_UTF16LE;
+        if (big * 4 >= units && big_control * 100 <= units) return TEXT_ENCODING_UTF16BE;
+    }
+
+    // Other zero bytes mean binary data, which is better left as it is.
+    if (memchr(p, 0, size)) return TEXT_ENCODING_UTF8;
+
+    // A stray byte in UTF-8 text is no reason to mangle every character around it. Latin-1 and
+    // Shift-JIS seldom pair up as UTF-8 does, so their invalid bytes outnumber their valid characters.
+    size_t multibyte, invalid;
+    count_utf8(p, size, &multibyte, &invalid);
+    if (invalid == 0 || (multibyte > 0 && invalid <= multibyte)) return TEXT_ENCODING_UTF8;
+    if (looks_like_shift_jis(p, size)) return TEXT_ENCODING_SHIFT_JIS;
+    return TEXT_ENCODING_LATIN1;
+}
+
+/**
+ * @brief Guesses the encoding of a file from a sample of its head.
+ */
+FatResult text_encoding_detect_file(const char* path, TextEncoding* encoding) {
+    *encoding = TEXT_ENCODING_UTF8;
+    FileSource source;
+    FatResult res = file_source_open(&source, path, false);
+    if (res != FAT_SUCCESS) return res;
+    if (source.kind == FILE_SOURCE_STREAM) {
+        // Reading a sample would take it from whoever reads the stream next.
+        file_source_close(&source);
+        return FAT_ERROR_UNSUPPORTED;
+    }
+
+    char* sample = malloc(TEXT_ENCODING_SAMPLE_SIZE);
+    if (!sample) {
+        file_source_close(&source);
+        return FAT_ERROR_MEMORY;
+    }
+    size_t got = 0;
+    res = file_source_read_at(&source, sample, TEXT_ENCODING_SAMPLE_SIZE, 0, &got);
+    file_source_close(&source);
+    if (res == FAT_SUCCESS) *encoding = text_encoding_detect(sample, got, NULL);
+    free(sample);
+    return res;
+}
+
+// **Conversion**
+
+/**
+ * @brief Writes a code point as UTF-8 and returns the number of bytes written.
+ */
+static size_t put_utf8(char* out, uint32_t cp) {
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (char)(0xC0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = (char)(0xE0 | (cp >> 12));
+        out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (cp >> 18));
+    out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+/**
+ * @brief Writes U+FFFD and returns the number of bytes written.
+ */
+static size_t put_replacement(char* out) {
+    memcpy(out, REPLACEMENT, 3);
+    return 3;
+}
+
+/**
+ * @brief Starts a conversion to UTF-8.
+ */
+FatResult text_transcoder_init(TextTranscoder* transcoder, TextEncoding encoding) {
+    memset(transcoder, 0, sizeof(*transcoder));
+    transcoder->encoding = encoding;
+    if (encoding == TEXT_ENCODING_UTF8 || encoding >= TEXT_ENCODING_COUNT) return FAT_ERROR_INVALID_ARGUMENT;
+    if (encoding != TEXT_ENCODING_SHIFT_JIS) return FAT_SUCCESS;
+
+    // CP932 is the Shift-JIS files are actually written in; not every iconv knows it by that name.
+    iconv_t cd = iconv_open("UTF-8", "CP932");
+    if (cd == (iconv_t)-1) cd = iconv_open("UTF-8", "SHIFT_JIS");
+    if (cd == (iconv_t)-1) {
+        LOG_INFO("iconv cannot convert from Shift-JIS: %s", strerror(errno));
+        return FAT_ERROR_UNSUPPORTED;
+    }
+    transcoder->iconv = cd;
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Returns the most UTF-8 bytes a chunk of `size` bytes can be converted to.
+ */
+size_t text_transcoder_bound(size_t size) {
+    // The held back bytes of the last chunk come first, and an unfinished character last.
+    return (size + sizeof(((TextTranscoder*)0)->pending)) * TEXT_ENCODING_MAX_GROWTH + 8;
+}
+
+/**
+ * @brief Converts Latin-1, reading 0x80-0x9F as Windows-1252.
+ */
+static size_t convert_latin1(const unsigned char* in, size_t size, char* out) {
+    size_t n = 0;
+    for (size_t i = 0; i < size; i++) {
+        unsigned char c = in[i];
+        if (c < 0x80) {
+            out[n++] = (char)c;
+        } else if (c < 0xA0) {
+            uint16_t cp = WINDOWS_1252_HIGH[c - 0x80];
+            n += cp ? put_utf8(out + n, cp) : put_replacement(out + n);
+        } else {
+            n += put_utf8(out + n, c);
+        }
+    }
+    return n;
+}
+
+/**
+ * @brief Writes one UTF-16 code unit, pairing surrogates.
+ */
+static size_t put_utf16_unit(TextTranscoder* t, uint32_t unit, char* out) {
+    size_t n = 0;
+    if (unit >= 0xD800 && unit <= 0xDBFF) {
+        if (t->high_surrogate) n += put_replacement(out);
+        t->high_surrogate = unit;
+        return n;
+    }
+    if (unit >= 0xDC00 && unit <= 0xDFFF) {
+        if (!t->high_surrogate) return put_replacement(out);
+        uint32_t cp = 0x10000 + ((t->high_surrogate - 0xD800) << 10) + (unit - 0xDC00);
+        t->high_surrogate = 0;
+        return put_utf8(out, cp);
+    }
+    if (t->high_surrogate) {
+        n += put_replacement(out);
+        t->high_surrogate = 0;
+    }
+    return n + put_utf8(out + n, unit);
+}
+
+/**
+ * @brief Converts UTF-16 of either byte order.
+ */
+static size_t convert_utf16(TextTranscoder* t, const unsigned char* in, size_t size, bool last, char* out) {
+    bool little = t->encoding == TEXT_ENCODING_UTF16LE;
+    size_t n = 0;
+    size_t i = 0;
+    if (t->pending_len == 1 && size > 0) {
+        unsigned char a = t->pending[0], b = in[0];
+        n += put_utf16_unit(t, little ? (uint32_t)(a | (b << 8)) : (uint32_t)((a << 8) | b), out + n);
+        t->pending_len = 0;
+        i = 1;
+    }
+    for (; i + 1 < size; i += 2) {
+        uint32_t unit = little ? (uint32_t)(in[i] | (in[i + 1] << 8)) : (uint32_t)((in[i] << 8) | in[i + 1]);
+        n += put_utf16_unit(t, unit, out + n);
+    }
+    if (i < size) t->pending[t->pending_len++] = in[i];
+
+    if (last) {
+        if (t->high_surrogate) n += put_replacement(out + n);
+        if (t->pending_len) n += put_replacement(out + n);
+        t->high_surrogate = 0;
+        t->pending_len = 0;
+    }
+    return n;
+}
+
+/**
+ * @brief Converts through iconv, carrying a character cut off at the end of the chunk over to the next.
+ */
+static FatResult convert_iconv(TextTranscoder* t, const char* input, size_t size, bool last, char* out, size_t* written) {
+    size_t total = t->pending_len + size;
+    if (t->scratch_size < total) {
+        char* grown = realloc(t->scratch, total);
+        if (!grown && total > 0) return FAT_ERROR_MEMORY;
+        t->scratch = grown;
+        t->scratch_size = total;
+    }
+    if (t->pending_len) memcpy(t->scratch, t->pending, t->pending_len);
+    if (size) memcpy(t->scratch + t->pending_len, input, size);
+    t->pending_len = 0;
+
+    iconv_t cd = (iconv_t)t->iconv;
+    char* in = t->scratch;
+    size_t in_left = total;
+    char* dst = out;
+    size_t out_left = text_transcoder_bound(size);
+    while (in_left > 0) {
+        if (iconv(cd, &in, &in_left, &dst, &out_left) != (size_t)-1) break;
+        if (errno == EINVAL && !last && in_left <= sizeof(t->pending)) {
+            memcpy(t->pending, in, in_left);
+            t->pending_len = in_left;
+            break;
+        }
+        // An invalid byte, or a character the input ends in the middle of.
+        if (out_left < 3) break;
+        dst += put_replacement(dst);
+        out_left -= 3;
+        in++;
+        in_left--;
+    }
+    if (last) iconv(cd, NULL, NULL, &dst, &out_left);
+    *written = (size_t)(dst - out);
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Converts the next chunk of input to UTF-8.
+ */
+FatResult text_transcoder_convert(TextTranscoder* transcoder, const char* input, size_t size, bool last,
+                                  char* output, size_t* written) {
+    *written = 0;
+    const unsigned char* in = (const unsigned char*)input;
+    switch (transcoder->encoding) {
+        case TEXT_ENCODING_LATIN1:
+            *written = convert_latin1(in, size, output);
+            return FAT_SUCCESS;
+        case TEXT_ENCODING_UTF16LE:
+        case TEXT_ENCODING_UTF16BE:
+            *written = convert_utf16(transcoder, in, size, last, output);
+            return FAT_SUCCESS;
+        case TEXT_ENCODING_SHIFT_JIS:
+            return convert_iconv(transcoder, input, size, last, output, written);
+        default:
+            return FAT_ERROR_INVALID_ARGUMENT;
+    }
+}
+
+/**
+ * @brief Frees a conversion.
+ */
+void text_transcoder_free(TextTranscoder* transcoder) {
+    if (transcoder->iconv) iconv_close((iconv_t)transcoder->iconv);
+    free(transcoder->scratch);
+    memset(transcoder, 0, sizeof(*transcoder));
+}
@@ -0,0 +1,261 @@
+/**
+ * @file time_histogram.c
+ * @author Zuhaitz (original)
+ * @brief Implements the timeline of a log, counted in the background or as lines arrive.
+ */
+#include "core/time_histogram.h"
+#include "utils/logger.h"
+#include "utils/utils.h"
+#include <stdlib.h>
+#include <string.h>
+
+// **Counting**
+
+/**
+ * @brief Resets the counts to an empty timeline of minute-wide buckets.
+ */
+static void counts_reset(TimeHistogramCounts* counts) {
+    memset(counts, 0, sizeof(*counts));
+    counts->width = TIME_HISTOGRAM_MIN_WIDTH;
+}
+
+/**
+ * @brief Doubles the width of the buckets, merging them in pairs.
+ */
+static void counts_merge(TimeHistogramCounts* counts) {
+    for (size_t i = 0; i < TIME_HISTOGRAM_MAX_BUCKETS / 2; i++) {
+        const TimeBucket a = counts->buckets[2 * i];
+        const TimeBucket b = counts->buckets[2 * i + 1];
+        TimeBucket* merged = &counts->buckets[i];
+        merged->lines = a.lines + b.lines;
+        merged->matches = a.matches + b.matches;
+        merged->first_line = a.lines ? a.first_line : b.first_line;
+        merged->first_match = a.matches ? a.first_match : b.first_match;
+    }
+    memset(&counts->buckets[TIME_HISTOGRAM_MAX_BUCKETS / 2], 0,
+           TIME_HISTOGRAM_MAX_BUCKETS / 2 * sizeof(TimeBucket));
+    counts->width *= 2;
+    counts->current /= 2;
+    counts->count = (counts->count + 1) / 2;
+}
+
+/**
+ * @brief Makes the bucket holding a time the current one.
+ *
+ * The first stamped line sets where the timeline starts; a line stamped
+ * earlier than that, as happens in a log that is not quite in order, is
+ * counted in the first bucket.
+ */
+static void counts_place(TimeHistogramCounts* counts, int64_t time) {
+    if (!counts->has_time) {
+        int64_t rem = ((time % counts->width) + counts->width) % counts->width;
+        counts->start = time - rem;
+        counts->has_time = true;
+    }
+    if (time < counts->start) {
+        counts->current = 0;
+        return;
+    }
+    while ((uint64_t)(time - counts->start) / (uint64_t)counts->width >= TIME_HISTOGRAM_MAX_BUCKETS) {
+        counts_merge(counts);
+    }
+    counts->current = (size_t)((time - counts->start) / counts->width);
+}
+
+/**
+ * @brief Counts one line in the bucket of its timestamp, or of the stamped line above it.
+ */
+static void count_line(const TimeHistogram* hist, TimeHistogramCounts* counts, size_t line, const char* text, size_t len) {
+    int64_t time;
+    if (time_parse(text, len, hist->format, &time) != TIME_FORMAT_NONE) counts_place(counts, time);
+    TimeBucket* bucket = &counts->buckets[counts->current];
+    if (bucket->lines++ == 0) bucket->first_line = line;
+    if (hist->term_len > 0 && find_bytes(text, len, hist->term, hist->term_len)) {
+        if (bucket->matches++ == 0) bucket->first_match = line;
+    }
+    if (counts->current >= counts->count) counts->count = counts->current + 1;
+    counts->line_count = line + 1;
+}
+
+// **Background Scan**
+
+/**
+ * @brief Copies the counts so far for the UI thread to adopt.
+ * @return False if the scan has been cancelled.
+ */
+static bool publish(TimeHistogram* hist, const TimeHistogramCounts* counts, bool finished) {
+    pthread_mutex_lock(&hist->lock);
+    bool cancelled = hist->cancel;
+    if (!cancelled) {
+        memcpy(hist->shared, counts, sizeof(*counts));
+        hist->version++;
+        hist->finished = finished;
+    }
+    pthread_mutex_unlock(&hist->lock);
+    return !cancelled;
+}
+
+/**
+ * @brief Counts every line of the line index, straight from the mapped data.
+ */
+static void* histogram_worker(void* arg) {
+    TimeHistogram* hist = arg;
+    TimeHistogramCounts* counts = malloc(sizeof(TimeHistogramCounts));
+    if (!counts) {
+        pthread_mutex_lock(&hist->lock);
+        hist->finished = true;
+        pthread_mutex_unlock(&hist->lock);
+        return NULL;
+    }
+    counts_reset(counts);
+    for (size_t line = 0; line < hist->source_lines; line++) {
+        size_t start = hist->offsets[line];
+        size_t end = line + 1 < hist->source_lines ? hist->offsets[line + 1] : hist->size;
+        if (end > start && hist->data[end - 1] == '\n') end--;
+        count_line(hist, counts, line, hist->data + start, end - start);
+        if ((line + 1) % TIME_HISTOGRAM_PUBLISH_LINES == 0 && !publish(hist, counts, false)) {
+            free(counts);
+            return NULL;
+        }
+    }
+    if (publish(hist, counts, true)) {
+        LOG_INFO("Counted %zu lines into %zu time buckets of %llds.", counts->line_count, counts->count,
+                 (long long)counts->width);
+    }
+    free(counts);
+    return NULL;
+}
+
+// **Public API**
+
+/**
+ * @brief Starts building the timeline of a log.
+ */
+FatResult time_histogram_start(TimeHistogram* hist, TimeFormat format, const char* term, const LineIndex* lines) {
+    memset(hist, 0, sizeof(*hist));
+    if (format == TIME_FORMAT_NONE) return FAT_ERROR_INVALID_ARGUMENT;
+    hist->counts = malloc(sizeof(TimeHistogramCounts));
+    hist->shared = lines ? malloc(sizeof(TimeHistogramCounts)) : NULL;
+    if (!hist->counts || (lines && !hist->shared)) {
+        free(hist->counts);
+        free(hist->shared);
+        memset(hist, 0, sizeof(*hist));
+        return FAT_ERROR_MEMORY;
+    }
+    hist->format = format;
+    if (term) {
+        hist->term_len = strlen(term);
+        if (hist->term_len > TIME_HISTOGRAM_MAX_TERM_LEN) hist->term_len = TIME_HISTOGRAM_MAX_TERM_LEN;
+        memcpy(hist->term, term, hist->term_len);
+    }
+    counts_reset(hist->counts);
+    pthread_mutex_init(&hist->lock, NULL);
+    hist->done = true;
+    if (!lines) return FAT_SUCCESS;
+
+    counts_reset(hist->shared);
+    hist->data = lines->data;
+    hist->size = lines->size;
+    hist->offsets = lines->offsets;
+    hist->source_lines = lines->count;
+    if (pthread_create(&hist->thread, NULL, histogram_worker, hist) == 0) {
+        hist->has_thread = true;
+        hist->done = false;
+    } else {
+        LOG_INFO("Could not start the timeline thread; counting on this one.");
+        hist->done = false;
+        histogram_worker(hist);
+        time_histogram_poll(hist);
+    }
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Counts the next lines of content that is fed rather than scanned.
+ */
+bool time_histogram_feed(TimeHistogram* hist, TimeLineGetter get, const void* ctx, size_t line_count, size_t max_lines) {
+    TimeHistogramCounts* counts = hist->counts;
+    for (size_t fed = 0; counts->line_count < line_count && fed < max_lines; fed++) {
+        size_t line = counts->line_count;
+        size_t len;
+        const char* text = get(ctx, line, &len);
+        if (!text) break;
+        count_line(hist, counts, line, text, len);
+    }
+    return counts->line_count < line_count;
+}
+
+/**
+ * @brief Adopts the counts published by the background scan since the last call.
+ */
+bool time_histogram_poll(TimeHistogram* hist) {
+    if (!hist->shared || hist->done) return false;
+    bool changed = false;
+    pthread_mutex_lock(&hist->lock);
+    if (hist->version != hist->seen_version) {
+        memcpy(hist->counts, hist->shared, sizeof(TimeHistogramCounts));
+        hist->seen_version = hist->version;
+        changed = true;
+    }
+    if (hist->finished) hist->done = true;
+    pthread_mutex_unlock(&hist->lock);
+    return changed;
+}
+
+/**
+ * @brief Returns true until every line has been counted and adopted.
+ */
+bool time_histogram_is_running(const TimeHistogram* hist) {
+    return !hist->done;
+}
+
+/**
+ * @brief Returns how many buckets each column shows.
+ */
+size_t time_histogram_span(const TimeHistogramCounts* counts, size_t columns) {
+    if (columns == 0 || counts->count <= columns) return 1;
+    return (counts->count + columns - 1) / columns;
+}
+
+/**
+ * @brief Adds up the buckets one column shows.
+ */
+bool time_histogram_column(const TimeHistogramCounts* counts, size_t column, size_t span, TimeBucket* out) {
+    memset(out, 0, sizeof(*out));
+    for (size_t i = column * span; i < (column + 1) * span && i < counts->count; i++) {
+        const TimeBucket* bucket = &counts->buckets[i];
+        if (bucket->lines > 0 && out->lines == 0) out->first_line = bucket->first_line;
+        if (bucket->matches > 0 && out->matches == 0) out->first_match = bucket->first_match;
+        out->lines += bucket->lines;
+        out->matches += bucket->matches;
+    }
+    return out->lines > 0;
+}
+
+/**
+ * @brief Returns the bucket a line was counted in.
+ */
+size_t time_histogram_bucket_of(const TimeHistogramCounts* counts, size_t line) {
+    size_t found = 0;
+    for (size_t i = 0; i < counts->count; i++) {
+        if (counts->buckets[i].lines > 0 && counts->buckets[i].first_line <= line) found = i;
+    }
+    return found;
+}
+
+/**
+ * @brief Stops the background scan and frees the timeline.
+ */
+void time_histogram_free(TimeHistogram* hist) {
+    if (!hist || hist->format == TIME_FORMAT_NONE) return;
+    if (hist->has_thread) {
+        pthread_mutex_lock(&hist->lock);
+        hist->cancel = true;
+        pthread_mutex_unlock(&hist->lock);
+        pthread_join(hist->thread, NULL);
+    }
+    pthread_mutex_destroy(&hist->lock);
+    free(hist->shared);
+    free(hist->counts);
+    memset(hist, 0, sizeof(*hist));
+}
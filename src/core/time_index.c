@@ -0,0 +1,385 @@
+/**
+ * @file time_index.c
+ * @author Zuhaitz (original)
+ * @brief Implements the timestamp parser and the time-to-line index.
+ */
+#include "core/time_index.h"
+#include "utils/logger.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+static const char* const MONTH_NAMES[12] = {
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+};
+
+// **Calendar**
+
+/**
+ * @brief Returns the number of days from 1970-01-01 to a date of the proleptic Gregorian calendar.
+ */
+static int64_t days_from_civil(int64_t y, int m, int d) {
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    int64_t yoe = y - era * 400;
+    int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+/**
+ * @brief Splits a day count from 1970-01-01 into a date.
+ */
+static void civil_from_days(int64_t z, int64_t* y, int* m, int* d) {
+    z += 719468;
+    int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    int64_t doe = z - era * 146097;
+    int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int64_t mp = (5 * doy + 2) / 153;
+    *d = (int)(doy - (153 * mp + 2) / 5 + 1);
+    *m = (int)(mp < 10 ? mp + 3 : mp - 9);
+    *y = yoe + era * 400 + (*m <= 2);
+}
+
+static int64_t floor_div(int64_t a, int64_t b) {
+    return a / b - (a % b != 0 && (a < 0) != (b < 0));
+}
+
+// **Parsing**
+
+/**
+ * @brief Reads exactly `digits` decimal digits.
+ */
+static bool read_fixed(const char** p, const char* end, int digits, int* out) {
+    if (end - *p < digits) return false;
+    int value = 0;
+    for (int i = 0; i < digits; i++) {
+        char c = (*p)[i];
+        if (c < '0' || c > '9') return false;
+        value = value * 10 + (c - '0');
+    }
+    *p += digits;
+    *out = value;
+    return true;
+}
+
+/**
+ * @brief Reads `HH:MM`, with `:SS` if present.
+ */
+static bool read_clock(const char** p, const char* end, int* out_seconds) {
+    int h, m, s = 0;
+    if (!read_fixed(p, end, 2, &h) || *p >= end || **p != ':') return false;
+    (*p)++;
+    if (!read_fixed(p, end, 2, &m)) return false;
+    if (*p < end && **p == ':') {
+        (*p)++;
+        if (!read_fixed(p, end, 2, &s)) return false;
+    }
+    if (h > 23 || m > 59 || s > 60) return false;
+    *out_seconds = h * 3600 + m * 60 + s;
+    return true;
+}
+
+/**
+ * @brief Reads `YYYY-MM-DD`, followed by `T` or a space and a clock unless `date_only` allows it to end there.
+ */
+static bool parse_iso(const char* p, const char* end, bool date_only, int64_t* out_time) {
+    int y, mo, d, clock = 0;
+    if (!read_fixed(&p, end, 4, &y) || p >= end || *p++ != '-') return false;
+    if (!read_fixed(&p, end, 2, &mo) || p >= end || *p++ != '-') return false;
+    if (!read_fixed(&p, end, 2, &d)) return false;
+    if (mo < 1 || mo > 12 || d < 1 || d > 31) return false;
+    if (p < end && (*p == 'T' || *p == ' ')) {
+        p++;
+        if (!read_clock(&p, end, &clock)) return false;
+    } else if (!date_only) {
+        return false;
+    }
+    *out_time = days_from_civil(y, mo, d) * 86400 + clock;
+    return true;
+}
+
+/**
+ * @brief Reads `Mmm dd HH:MM:SS`, where the day may be padded with a space.
+ */
+static bool parse_syslog(const char* p, const char* end, int64_t* out_time) {
+    if (end - p < 3) return false;
+    int month = -1;
+    for (int i = 0; i < 12; i++) {
+        if (memcmp(p, MONTH_NAMES[i], 3) == 0) {
+            month = i + 1;
+            break;
+        }
+    }
+    if (month < 0) return false;
+    p += 3;
+    if (p >= end || *p++ != ' ') return false;
+    if (p < end && *p == ' ') p++;
+    int d = 0, digits = 0;
+    while (p < end && *p >= '0' && *p <= '9' && digits < 2) {
+        d = d * 10 + (*p++ - '0');
+        digits++;
+    }
+    if (digits == 0 || d < 1 || d > 31 || p >= end || *p++ != ' ') return false;
+    int clock;
+    if (!read_clock(&p, end, &clock)) return false;
+    *out_time = days_from_civil(1970, month, d) * 86400 + clock;
+    return true;
+}
+
+/**
+ * @brief Reads 10 digits of seconds or 13 of milliseconds since 1970, not followed by another digit.
+ */
+static bool parse_epoch(const char* p, const char* end, int64_t* out_time) {
+    int64_t value = 0;
+    int digits = 0;
+    while (p < end && *p >= '0' && *p <= '9' && digits < 14) {
+        value = value * 10 + (*p++ - '0');
+        digits++;
+    }
+    if (digits == 10 && value >= 1000000000) {
+        *out_time = value;
+        return true;
+    }
+    if (digits == 13 && value >= 1000000000000LL) {
+        *out_time = value / 1000;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Parses the timestamp at the start of a line.
+ */
+TimeFormat time_parse(const char* text, size_t len, TimeFormat format, int64_t* out_time) {
+    const char* p = text;
+    const char* end = text + len;
+    if (p < end && *p == '[') p++;
+    if (p >= end) return TIME_FORMAT_NONE;
+
+    if ((format == TIME_FORMAT_NONE || format == TIME_FORMAT_ISO8601) && parse_iso(p, end, false, out_time)) {
+        return TIME_FORMAT_ISO8601;
+    }
+    if ((format == TIME_FORMAT_NONE || format == TIME_FORMAT_SYSLOG) && parse_syslog(p, end, out_time)) {
+        return TIME_FORMAT_SYSLOG;
+    }
+    if ((format == TIME_FORMAT_NONE || format == TIME_FORMAT_EPOCH) && parse_epoch(p, end, out_time)) {
+        return TIME_FORMAT_EPOCH;
+    }
+    return TIME_FORMAT_NONE;
+}
+
+/**
+ * @brief Parses a time typed by the user.
+ */
+bool time_parse_target(const char* text, int64_t reference, int64_t* out_time) {
+    while (*text == ' ') text++;
+    const char* end = text + strlen(text);
+    while (end > text && end[-1] == ' ') end--;
+    if (end == text) return false;
+
+    if (parse_iso(text, end, true, out_time)) return true;
+    if (parse_syslog(text, end, out_time)) return true;
+    const char* p = text;
+    int clock;
+    if (read_clock(&p, end, &clock) && p == end) {
+        *out_time = floor_div(reference, 86400) * 86400 + clock;
+        return true;
+    }
+    for (p = text; p < end && *p >= '0' && *p <= '9'; p++) {}
+    return p == end && parse_epoch(text, end, out_time);
+}
+
+/**
+ * @brief Formats a time as `YYYY-MM-DD HH:MM:SS`.
+ */
+void time_format(int64_t time, char* buffer, size_t size) {
+    int64_t days = floor_div(time, 86400);
+    int64_t clock = time - days * 86400;
+    int64_t y;
+    int m, d;
+    civil_from_days(days, &y, &m, &d);
+    snprintf(buffer, size, "%04lld-%02d-%02d %02d:%02d:%02d", (long long)y, m, d,
+             (int)(clock / 3600), (int)(clock / 60 % 60), (int)(clock % 60));
+}
+
+/**
+ * @brief Detects the timestamp format from the first lines of the content.
+ */
+TimeFormat time_detect_format(TimeLineGetter get, const void* ctx, size_t line_count) {
+    int64_t time;
+    for (size_t i = 0; i < line_count && i < TIME_DETECT_LINES; i++) {
+        size_t len;
+        const char* line = get(ctx, i, &len);
+        if (!line) break;
+        TimeFormat format = time_parse(line, len, TIME_FORMAT_NONE, &time);
+        if (format != TIME_FORMAT_NONE) return format;
+    }
+    return TIME_FORMAT_NONE;
+}
+
+// **Checkpoints**
+
+/**
+ * @brief Returns a line straight from the mapped data, for the background pass.
+ */
+static const char* get_indexed_line(const void* ctx, size_t line, size_t* len) {
+    const TimeIndex* index = ctx;
+    if (line >= index->line_count) {
+        *len = 0;
+        return NULL;
+    }
+    size_t start = index->offsets[line];
+    size_t end = line + 1 < index->line_count ? index->offsets[line + 1] : index->size;
+    if (end > start && index->data[end - 1] == '\n') end--;
+    *len = end - start;
+    return index->data + start;
+}
+
+/**
+ * @brief Finds the first stamped line in `[from, limit)`.
+ */
+static bool next_stamped(TimeFormat format, TimeLineGetter get, const void* ctx, size_t from, size_t limit,
+                         size_t* out_line, int64_t* out_time, size_t* parsed) {
+    for (size_t line = from; line < limit; line++) {
+        size_t len;
+        const char* text = get(ctx, line, &len);
+        if (!text) return false;
+        if (parsed) (*parsed)++;
+        if (time_parse(text, len, format, out_time) != TIME_FORMAT_NONE) {
+            *out_line = line;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Samples the first stamped line of every stride.
+ */
+static void* checkpoint_worker(void* arg) {
+    TimeIndex* index = arg;
+    for (size_t start = 0; start < index->line_count; start += TIME_INDEX_STRIDE) {
+        size_t limit = start + TIME_INDEX_STRIDE < index->line_count ? start + TIME_INDEX_STRIDE : index->line_count;
+        size_t line;
+        int64_t time;
+        bool found = next_stamped(index->format, get_indexed_line, index, start, limit, &line, &time, NULL);
+
+        pthread_mutex_lock(&index->lock);
+        if (index->cancel) {
+            pthread_mutex_unlock(&index->lock);
+            return NULL;
+        }
+        if (found && index->count == index->capacity) {
+            size_t new_capacity = index->capacity ? index->capacity * 2 : 256;
+            TimeCheckpoint* new_checkpoints = realloc(index->checkpoints, new_capacity * sizeof(TimeCheckpoint));
+            if (!new_checkpoints) {
+                pthread_mutex_unlock(&index->lock);
+                break;
+            }
+            index->checkpoints = new_checkpoints;
+            index->capacity = new_capacity;
+        }
+        if (found) index->checkpoints[index->count++] = (TimeCheckpoint){ line, time };
+        pthread_mutex_unlock(&index->lock);
+    }
+    pthread_mutex_lock(&index->lock);
+    index->done = true;
+    pthread_mutex_unlock(&index->lock);
+    LOG_INFO("Sampled %zu time checkpoints over %zu lines.", index->count, index->line_count);
+    return NULL;
+}
+
+FatResult time_index_start(TimeIndex* index, TimeFormat format, const LineIndex* lines) {
+    memset(index, 0, sizeof(*index));
+    if (format == TIME_FORMAT_NONE) return FAT_ERROR_INVALID_ARGUMENT;
+    index->format = format;
+    pthread_mutex_init(&index->lock, NULL);
+    if (!lines || lines->count <= TIME_INDEX_STRIDE) {
+        // Too short to need checkpoints, or still growing.
+        index->done = true;
+        return FAT_SUCCESS;
+    }
+    index->data = lines->data;
+    index->size = lines->size;
+    index->offsets = lines->offsets;
+    index->line_count = lines->count;
+    if (pthread_create(&index->thread, NULL, checkpoint_worker, index) == 0) {
+        index->has_thread = true;
+    } else {
+        LOG_INFO("Could not start the time checkpoint thread; searching without checkpoints.");
+        index->done = true;
+    }
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Finds the first stamped line at or after a time.
+ *
+ * The lines from `lo` on are split at the first stamped line at or after
+ * `mid`: if it is earlier than the target, the answer lies past it;
+ * otherwise it lies at or before it, and the unstamped lines between `mid`
+ * and it cannot be the answer, so `mid` becomes the new upper bound.
+ */
+bool time_index_find(TimeIndex* index, TimeLineGetter get, const void* ctx, size_t line_count,
+                     int64_t target, size_t* out_line, size_t* out_parsed) {
+    size_t lo = 0, hi = line_count;
+    size_t parsed = 0;
+
+    // Narrow the range to the stride holding the target.
+    pthread_mutex_lock(&index->lock);
+    size_t first = 0, last = index->count;
+    while (first < last) {
+        size_t mid = first + (last - first) / 2;
+        if (index->checkpoints[mid].time < target) first = mid + 1; else last = mid;
+    }
+    if (first > 0) lo = index->checkpoints[first - 1].line + 1;
+    if (first < index->count) hi = index->checkpoints[first].line + 1;
+    pthread_mutex_unlock(&index->lock);
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        size_t line;
+        int64_t time;
+        if (!next_stamped(index->format, get, ctx, mid, hi, &line, &time, &parsed)) {
+            hi = mid;
+        } else if (time < target) {
+            lo = line + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    size_t line;
+    int64_t time;
+    bool found = next_stamped(index->format, get, ctx, lo, line_count, &line, &time, &parsed) && time >= target;
+    if (found) *out_line = line;
+    if (out_parsed) *out_parsed = parsed;
+    return found;
+}
+
+/**
+ * @brief Returns the time of a line, or of the nearest stamped line above or, failing that, below it.
+ */
+bool time_index_line_time(const TimeIndex* index, TimeLineGetter get, const void* ctx, size_t line, int64_t* out_time) {
+    for (size_t i = line + 1; i-- > 0 && line - i < TIME_INDEX_STRIDE;) {
+        size_t len;
+        const char* text = get(ctx, i, &len);
+        if (text && time_parse(text, len, index->format, out_time) != TIME_FORMAT_NONE) return true;
+    }
+    size_t found;
+    return next_stamped(index->format, get, ctx, line + 1, line + 1 + TIME_INDEX_STRIDE, &found, out_time, NULL);
+}
+
+void time_index_free(TimeIndex* index) {
+    if (!index || index->format == TIME_FORMAT_NONE) return;
+    if (index->has_thread) {
+        pthread_mutex_lock(&index->lock);
+        index->cancel = true;
+        pthread_mutex_unlock(&index->lock);
+        pthread_join(index->thread, NULL);
+    }
+    pthread_mutex_destroy(&index->lock);
+    free(index->checkpoints);
+    memset(index, 0, sizeof(*index));
+}
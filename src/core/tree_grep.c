@@ -0,0 +1,707 @@
+/**
+ * @file tree_grep.c
+ * @author Zuhaitz (original)
+ * @brief Implements the work-stealing pool that searches every file under a directory.
+ */
+#include "core/tree_grep.h"
+#include "core/line_index.h"
+#include "core/string_list.h"
+#include "plugins/plugin_manager.h"
+#include "utils/logger.h"
+#include "utils/utils.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+/** @brief How many leading bytes are looked at to tell a binary file from a text one. */
+#define TREE_GREP_PROBE_SIZE 8192
+
+/** @brief How long an idle worker sleeps before looking for work to steal again. */
+#define TREE_GREP_IDLE_WAIT_NS 20000000L
+
+/**
+ * @struct HitBatch
+ * @brief The hits of one file or entry, published together once it is searched.
+ */
+typedef struct {
+    TreeGrepHit* hits;
+    size_t count;
+    size_t capacity;
+} HitBatch;
+
+/**
+ * @struct LineScanner
+ * @brief Splits the chunks of a streamed entry into lines.
+ */
+typedef struct {
+    TreeGrep* grep;
+    HitBatch* batch;
+    const char* path;
+    const char* entry;
+    char* carry;                /**< The start of a line split between chunks. */
+    size_t carry_len;
+    size_t carry_capacity;
+    size_t line;                /**< The one-based number of the line being read. */
+    bool probed;                /**< True once the first chunk was checked for binary content. */
+    bool stopped;
+} LineScanner;
+
+// **Helpers**
+
+/**
+ * @brief Returns true if the data has a NUL byte near its start, as binary files do.
+ */
+static bool looks_binary(const char* data, size_t len) {
+    return memchr(data, '\0', len < TREE_GREP_PROBE_SIZE ? len : TREE_GREP_PROBE_SIZE) != NULL;
+}
+
+/**
+ * @brief Returns true once the search is being freed or has found enough.
+ */
+static bool is_cancelled(TreeGrep* grep) {
+    pthread_mutex_lock(&grep->lock);
+    bool cancel = grep->cancel;
+    pthread_mutex_unlock(&grep->lock);
+    return cancel;
+}
+
+/**
+ * @brief Joins a directory and a name, without doubling the separator.
+ */
+static char* join_path(const char* dir, const char* name) {
+    size_t dir_len = strlen(dir);
+    bool has_sep = dir_len > 0 && dir[dir_len - 1] == '/';
+    size_t size = dir_len + strlen(name) + 2;
+    char* path = malloc(size);
+    if (path) snprintf(path, size, "%s%s%s", dir, has_sep ? "" : "/", name);
+    return path;
+}
+
+static void free_hit(TreeGrepHit* hit) {
+    free(hit->path);
+    free(hit->entry);
+    free(hit->row);
+}
+
+// **Hits**
+
+/**
+ * @brief Records a matching line in a batch.
+ *
+ * The row shows the path relative to the searched directory, the line
+ * number and the line itself with its indentation dropped, cut to
+ * TREE_GREP_SNIPPET_LEN bytes on a character boundary and with control
+ * characters blanked out.
+ */
+static void add_hit(TreeGrep* grep, HitBatch* batch, const char* path, const char* entry,
+                    size_t line, const char* text, size_t len) {
+    if (batch->count >= TREE_GREP_MAX_HITS) return;
+    if (batch->count == batch->capacity) {
+        size_t new_capacity = batch->capacity ? batch->capacity * 2 : 16;
+        TreeGrepHit* new_hits = realloc(batch->hits, new_capacity * sizeof(TreeGrepHit));
+        if (!new_hits) return;
+        batch->hits = new_hits;
+        batch->capacity = new_capacity;
+    }
+
+    while (len > 0 && (*text == ' ' || *text == '\t')) {
+        text++;
+        len--;
+    }
+    if (len > TREE_GREP_SNIPPET_LEN) {
+        len = TREE_GREP_SNIPPET_LEN;
+        while (len > 0 && ((unsigned char)text[len] & 0xC0) == 0x80) len--;
+    }
+    char snippet[TREE_GREP_SNIPPET_LEN + 1];
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)text[i];
+        snippet[i] = (c < 0x20 || c == 0x7f) ? ' ' : (char)c;
+    }
+    while (len > 0 && snippet[len - 1] == ' ') len--;
+    snippet[len] = '\0';
+
+    const char* shown = path;
+    if (grep->root_len > 0 && strncmp(path, grep->root, grep->root_len) == 0) {
+        shown = path + grep->root_len;
+        while (*shown == '/') shown++;
+    }
+
+    TreeGrepHit* hit = &batch->hits[batch->count];
+    hit->path = strdup(path);
+    hit->entry = entry ? strdup(entry) : NULL;
+    hit->line = line;
+    size_t row_size = strlen(shown) + (entry ? strlen(entry) + 2 : 0) + len + 32;
+    hit->row = malloc(row_size);
+    if (!hit->path || (entry && !hit->entry) || !hit->row) {
+        free_hit(hit);
+        return;
+    }
+    if (entry) {
+        snprintf(hit->row, row_size, "%s!/%s:%zu: %s", shown, entry, line, snippet);
+    } else {
+        snprintf(hit->row, row_size, "%s:%zu: %s", shown, line, snippet);
+    }
+    batch->count++;
+}
+
+/**
+ * @brief Hands the hits of a searched file or entry over to the UI thread.
+ *
+ * Once TREE_GREP_MAX_HITS hits have been found, the rest are dropped and the
+ * workers are told to stop.
+ */
+static void publish(TreeGrep* grep, HitBatch* batch) {
+    size_t taken = 0;
+    pthread_mutex_lock(&grep->lock);
+    grep->files_searched++;
+    size_t room = TREE_GREP_MAX_HITS - grep->found_total;
+    size_t wanted = batch->count < room ? batch->count : room;
+    if (wanted > 0 && grep->found_count + wanted > grep->found_capacity) {
+        size_t new_capacity = grep->found_capacity ? grep->found_capacity : 64;
+        while (new_capacity < grep->found_count + wanted) new_capacity *= 2;
+        TreeGrepHit* new_found = realloc(grep->found, new_capacity * sizeof(TreeGrepHit));
+        if (new_found) {
+            grep->found = new_found;
+            grep->found_capacity = new_capacity;
+        } else {
+            wanted = 0;
+        }
+    }
+    if (wanted > 0) {
+        memcpy(grep->found + grep->found_count, batch->hits, wanted * sizeof(TreeGrepHit));
+        grep->found_count += wanted;
+        grep->found_total += wanted;
+        taken = wanted;
+    }
+    if (grep->found_total >= TREE_GREP_MAX_HITS) {
+        grep->truncated = true;
+        grep->cancel = true;
+    }
+    pthread_mutex_unlock(&grep->lock);
+
+    for (size_t i = taken; i < batch->count; i++) {
+        free_hit(&batch->hits[i]);
+    }
+    free(batch->hits);
+    memset(batch, 0, sizeof(*batch));
+}
+
+// **Searching**
+
+/**
+ * @brief Searches a text file through its mapping.
+ *
+ * The whole mapping is scanned for the term rather than each line in turn,
+ * so the lines without a match cost a memchr pass and nothing else. The file
+ * is loaded without indexing its lines, which would build (and cache) the
+ * offsets of every line to number a few; the newlines up to each match are
+ * counted instead, and the scan resumes at the start of the next line.
+ *
+ * @param read_path The file to read.
+ * @param path The file, or the archive, recorded in the hits.
+ * @param entry The archive entry recorded in the hits, or NULL.
+ */
+static void search_file(TreeGrep* grep, const char* read_path, const char* path, const char* entry, HitBatch* batch) {
+    char probe[TREE_GREP_PROBE_SIZE];
+    FILE* file = fopen(read_path, "rb");
+    if (!file) return;
+    size_t probed = fread(probe, 1, sizeof(probe), file);
+    fclose(file);
+    if (probed == 0 || looks_binary(probe, probed)) return;
+
+    LineIndex index;
+    if (line_index_load(&index, read_path) != FAT_SUCCESS) return;
+
+    const char* data = index.data;
+    const char* end = data + index.size;
+    const char* ptr = data;
+    const char* line_start = data; // The newlines before it are counted in `line`
+    size_t line = 1;
+    size_t checks = 0;
+    while ((ptr = find_bytes(ptr, (size_t)(end - ptr), grep->term, grep->term_len)) != NULL) {
+        const char* newline;
+        while ((newline = memchr(line_start, '\n', (size_t)(ptr - line_start))) != NULL) {
+            line_start = newline + 1;
+            line++;
+        }
+        newline = memchr(ptr, '\n', (size_t)(end - ptr));
+        const char* stop = newline ? newline : end;
+        add_hit(grep, batch, path, entry, line, line_start, (size_t)(stop - line_start));
+
+        if (!newline || batch->count >= TREE_GREP_MAX_HITS) break;
+        if (++checks % 1024 == 0 && is_cancelled(grep)) break;
+        ptr = line_start = newline + 1;
+        line++;
+    }
+    line_index_free(&index);
+}
+
+/**
+ * @brief Searches one complete line of a streamed entry.
+ */
+static void scan_line(LineScanner* scanner, const char* text, size_t len) {
+    if (find_bytes(text, len, scanner->grep->term, scanner->grep->term_len)) {
+        add_hit(scanner->grep, scanner->batch, scanner->path, scanner->entry, scanner->line, text, len);
+    }
+    scanner->line++;
+}
+
+/**
+ * @brief Appends part of a line to the carry buffer.
+ * @return False if the line grew past TREE_GREP_MAX_LINE_LEN or memory ran out.
+ */
+static bool carry_append(LineScanner* scanner, const char* data, size_t len) {
+    if (scanner->carry_len + len > TREE_GREP_MAX_LINE_LEN) return false;
+    if (scanner->carry_len + len > scanner->carry_capacity) {
+        size_t new_capacity = scanner->carry_capacity ? scanner->carry_capacity : 4096;
+        while (new_capacity < scanner->carry_len + len) new_capacity *= 2;
+        char* new_carry = realloc(scanner->carry, new_capacity);
+        if (!new_carry) return false;
+        scanner->carry = new_carry;
+        scanner->carry_capacity = new_capacity;
+    }
+    memcpy(scanner->carry + scanner->carry_len, data, len);
+    scanner->carry_len += len;
+    return true;
+}
+
+/**
+ * @brief Splits the next chunk of an entry into lines and searches them.
+ *
+ * Lines that lie whole in the chunk are searched in place; only a line split
+ * between chunks is copied.
+ */
+static bool scan_chunk(const char* data, size_t len, void* ctx) {
+    LineScanner* scanner = ctx;
+    if (is_cancelled(scanner->grep) || scanner->batch->count >= TREE_GREP_MAX_HITS) {
+        scanner->stopped = true;
+        return false;
+    }
+    if (!scanner->probed) {
+        scanner->probed = true;
+        if (looks_binary(data, len)) {
+            scanner->stopped = true;
+            return false;
+        }
+    }
+
+    size_t pos = 0;
+    while (pos < len) {
+        const char* newline = memchr(data + pos, '\n', len - pos);
+        size_t line_end = newline ? (size_t)(newline - data) : len;
+        if (!newline) {
+            if (!carry_append(scanner, data + pos, len - pos)) {
+                scanner->stopped = true;
+                return false;
+            }
+            break;
+        }
+        if (scanner->carry_len > 0) {
+            if (!carry_append(scanner, data + pos, line_end - pos)) {
+                scanner->stopped = true;
+                return false;
+            }
+            scan_line(scanner, scanner->carry, scanner->carry_len);
+            scanner->carry_len = 0;
+        } else {
+            scan_line(scanner, data + pos, line_end - pos);
+        }
+        pos = line_end + 1;
+    }
+    return true;
+}
+
+/**
+ * @brief Closes the archive a worker kept open, if any.
+ */
+static void close_worker_archive(TreeGrepWorker* worker) {
+    if (worker->archive) worker->session.close(worker->archive);
+    free(worker->archive_path);
+    worker->archive = NULL;
+    worker->archive_path = NULL;
+}
+
+/**
+ * @brief Returns the worker's open handle on a task's archive, opening it if the worker has another one.
+ *
+ * Returns NULL if the plugin cannot read entries of an open archive or the archive cannot be opened.
+ */
+static void* worker_archive(TreeGrepWorker* worker, const TreeGrepTask* task) {
+    if (worker->archive_path && strcmp(worker->archive_path, task->path) == 0) return worker->archive;
+    close_worker_archive(worker);
+    ArchiveSession session;
+    if (!pm_get_archive_session(task->plugin, &session)) return NULL;
+    // A failed open is remembered too, so the entries fall back without trying again.
+    worker->archive_path = strdup(task->path);
+    if (worker->archive_path && session.open(task->path, &worker->archive) != FAT_SUCCESS) {
+        LOG_INFO("Could not open '%s' once for searching; reading its entries one by one", task->path);
+        worker->archive = NULL;
+    }
+    worker->session = session;
+    return worker->archive;
+}
+
+/**
+ * @brief Searches one entry of an archive.
+ *
+ * The entry is read through the archive the worker keeps open when the
+ * plugin allows it, streamed through the plugin's reader when it has one,
+ * and extracted to a temporary file otherwise.
+ */
+static void search_entry(TreeGrepWorker* worker, const TreeGrepTask* task, HitBatch* batch) {
+    TreeGrep* grep = worker->grep;
+    void* archive = worker_archive(worker, task);
+    ArchiveEntryReader reader = pm_get_entry_reader(task->plugin);
+    if (!archive && !reader) {
+        char* temp_path = NULL;
+        if (task->plugin->extract_entry(task->path, task->entry, &temp_path) == FAT_SUCCESS && temp_path) {
+            search_file(grep, temp_path, task->path, task->entry, batch);
+            remove(temp_path);
+        }
+        free(temp_path);
+        return;
+    }
+
+    LineScanner scanner = { .grep = grep, .batch = batch, .path = task->path, .entry = task->entry, .line = 1 };
+    FatResult res = archive ? worker->session.read(archive, task->entry_index, scan_chunk, &scanner)
+                            : reader(task->path, task->entry, scan_chunk, &scanner);
+    if (res != FAT_SUCCESS) {
+        LOG_INFO("Could not search entry '%s' of '%s' (error %d)", task->entry, task->path, res);
+    }
+    if (res == FAT_SUCCESS && !scanner.stopped && scanner.carry_len > 0) {
+        scan_line(&scanner, scanner.carry, scanner.carry_len);
+    }
+    free(scanner.carry);
+}
+
+// **Work-Stealing Pool**
+
+/**
+ * @brief Queues a task on a worker's own deque.
+ *
+ * The task is counted as pending before it becomes visible, so a thief that
+ * finishes it at once cannot bring the count to zero while its parent task
+ * is still running.
+ */
+static void push_task(TreeGrep* grep, int id, TreeGrepTask task) {
+    pthread_mutex_lock(&grep->lock);
+    grep->pending++;
+    pthread_mutex_unlock(&grep->lock);
+
+    TreeGrepDeque* deque = &grep->deques[id];
+    bool queued = true;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count == deque->capacity) {
+        size_t new_capacity = deque->capacity ? deque->capacity * 2 : 64;
+        TreeGrepTask* new_tasks = malloc(new_capacity * sizeof(TreeGrepTask));
+        if (new_tasks) {
+            for (size_t i = 0; i < deque->count; i++) {
+                new_tasks[i] = deque->tasks[(deque->head + i) % deque->capacity];
+            }
+            free(deque->tasks);
+            deque->tasks = new_tasks;
+            deque->head = 0;
+            deque->capacity = new_capacity;
+        } else {
+            queued = false;
+        }
+    }
+    if (queued) {
+        deque->tasks[(deque->head + deque->count) % deque->capacity] = task;
+        deque->count++;
+    }
+    pthread_mutex_unlock(&deque->lock);
+
+    pthread_mutex_lock(&grep->lock);
+    if (queued) {
+        pthread_cond_signal(&grep->work_ready);
+    } else if (--grep->pending == 0) {
+        grep->finished = true;
+        pthread_cond_broadcast(&grep->work_ready);
+    }
+    pthread_mutex_unlock(&grep->lock);
+    if (!queued) {
+        free(task.path);
+        free(task.entry);
+    }
+}
+
+/**
+ * @brief Takes the newest task from a worker's own deque, or steals the oldest from another.
+ */
+static bool take_task(TreeGrep* grep, int id, TreeGrepTask* out_task) {
+    TreeGrepDeque* own = &grep->deques[id];
+    pthread_mutex_lock(&own->lock);
+    if (own->count > 0) {
+        own->count--;
+        *out_task = own->tasks[(own->head + own->count) % own->capacity];
+        pthread_mutex_unlock(&own->lock);
+        return true;
+    }
+    pthread_mutex_unlock(&own->lock);
+
+    for (int i = 1; i < grep->deque_count; i++) {
+        TreeGrepDeque* victim = &grep->deques[(id + i) % grep->deque_count];
+        pthread_mutex_lock(&victim->lock);
+        if (victim->count > 0) {
+            *out_task = victim->tasks[victim->head];
+            victim->head = (victim->head + 1) % victim->capacity;
+            victim->count--;
+            pthread_mutex_unlock(&victim->lock);
+            return true;
+        }
+        pthread_mutex_unlock(&victim->lock);
+    }
+    return false;
+}
+
+/**
+ * @brief Lists a directory and queues a task for each file and subdirectory in it.
+ *
+ * Symbolic links are followed to files only; a link to a directory could
+ * lead back up the tree.
+ */
+static void run_dir(TreeGrep* grep, int id, const char* path) {
+    DIR* dir = opendir(path);
+    if (!dir) {
+        LOG_INFO("Could not open directory '%s' for searching.", path);
+        return;
+    }
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != NULL) {
+        const char* name = ent->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+
+        char* child = join_path(path, name);
+        if (!child) break;
+        bool is_dir = ent->d_type == DT_DIR;
+        bool is_file = ent->d_type == DT_REG;
+        if (ent->d_type == DT_LNK || ent->d_type == DT_UNKNOWN) {
+            struct stat st;
+            if (lstat(child, &st) == 0) {
+                is_dir = S_ISDIR(st.st_mode);
+                is_file = S_ISREG(st.st_mode) || (S_ISLNK(st.st_mode) && stat(child, &st) == 0 && S_ISREG(st.st_mode));
+            }
+        }
+        if (is_dir || is_file) {
+            TreeGrepTask task = { .kind = is_dir ? TREE_GREP_TASK_DIR : TREE_GREP_TASK_FILE, .path = child };
+            push_task(grep, id, task);
+        } else {
+            free(child);
+        }
+    }
+    closedir(dir);
+}
+
+/**
+ * @brief Searches a file, or queues a task for each entry if a plugin claims it.
+ */
+static void run_file(TreeGrep* grep, int id, const char* path) {
+    const ArchivePlugin* plugin = pm_get_handler(path);
+    if (!plugin) {
+        HitBatch batch = {0};
+        search_file(grep, path, path, NULL, &batch);
+        publish(grep, &batch);
+        return;
+    }
+
+    StringList entries;
+    StringList_init(&entries);
+    if (plugin->list_contents(path, &entries) != FAT_SUCCESS) {
+        LOG_INFO("Could not list archive '%s' for searching.", path);
+    }
+    // Queued last to first, so this worker takes them from its tail in the order of the archive.
+    for (size_t i = entries.count; i-- > 0;) {
+        const char* name = entries.lines[i];
+        size_t name_len = strlen(name);
+        if (name_len == 0 || name[name_len - 1] == '/') continue; // A directory entry
+        TreeGrepTask task = { .kind = TREE_GREP_TASK_ENTRY, .path = strdup(path), .entry = strdup(name), .plugin = plugin,
+                              .entry_index = i };
+        if (!task.path || !task.entry) {
+            free(task.path);
+            free(task.entry);
+            break;
+        }
+        push_task(grep, id, task);
+    }
+    StringList_free(&entries);
+}
+
+/**
+ * @brief Runs tasks until none is left anywhere or the search is cancelled.
+ */
+static void* tree_worker(void* arg) {
+    TreeGrepWorker* worker = arg;
+    TreeGrep* grep = worker->grep;
+    while (true) {
+        TreeGrepTask task;
+        if (!take_task(grep, worker->id, &task)) {
+            // Everything queued has been taken; wait for a running task to queue more, or for the last to finish.
+            pthread_mutex_lock(&grep->lock);
+            bool stop = grep->cancel || grep->pending == 0;
+            if (!stop) {
+                struct timespec deadline;
+                clock_gettime(CLOCK_REALTIME, &deadline);
+                deadline.tv_nsec += TREE_GREP_IDLE_WAIT_NS;
+                if (deadline.tv_nsec >= 1000000000L) {
+                    deadline.tv_sec++;
+                    deadline.tv_nsec -= 1000000000L;
+                }
+                pthread_cond_timedwait(&grep->work_ready, &grep->lock, &deadline);
+            }
+            pthread_mutex_unlock(&grep->lock);
+            if (stop) break;
+            continue;
+        }
+
+        if (!is_cancelled(grep)) {
+            if (task.kind == TREE_GREP_TASK_DIR) {
+                run_dir(grep, worker->id, task.path);
+            } else if (task.kind == TREE_GREP_TASK_FILE) {
+                run_file(grep, worker->id, task.path);
+            } else {
+                HitBatch batch = {0};
+                search_entry(worker, &task, &batch);
+                publish(grep, &batch);
+            }
+        }
+        free(task.path);
+        free(task.entry);
+
+        pthread_mutex_lock(&grep->lock);
+        if (--grep->pending == 0) {
+            grep->finished = true;
+            pthread_cond_broadcast(&grep->work_ready);
+        }
+        pthread_mutex_unlock(&grep->lock);
+    }
+    close_worker_archive(worker);
+    return NULL;
+}
+
+// **Lifecycle**
+
+FatResult tree_grep_start(TreeGrep* grep, const char* root, const char* term) {
+    if (!grep || !root || !term) return FAT_ERROR_INVALID_ARGUMENT;
+    memset(grep, 0, sizeof(*grep));
+    size_t term_len = strlen(term);
+    if (term_len == 0 || term_len > TREE_GREP_MAX_TERM_LEN) return FAT_ERROR_INVALID_ARGUMENT;
+    struct stat st;
+    if (stat(root, &st) != 0) return FAT_ERROR_FILE_NOT_FOUND;
+
+    TreeGrepTask first = { .kind = S_ISDIR(st.st_mode) ? TREE_GREP_TASK_DIR : TREE_GREP_TASK_FILE, .path = strdup(root) };
+    grep->term = strdup(term);
+    grep->root = strdup(root);
+    if (!first.path || !grep->term || !grep->root) {
+        free(first.path);
+        free(grep->term);
+        free(grep->root);
+        memset(grep, 0, sizeof(*grep));
+        return FAT_ERROR_MEMORY;
+    }
+    grep->term_len = term_len;
+    // Rows are shown relative to a searched directory; a single file keeps its path.
+    grep->root_len = S_ISDIR(st.st_mode) ? strlen(root) : 0;
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int wanted = cpus > 0 ? (int)cpus : 1;
+    if (wanted > TREE_GREP_MAX_THREADS) wanted = TREE_GREP_MAX_THREADS;
+    grep->deque_count = wanted;
+    for (int i = 0; i < wanted; i++) {
+        pthread_mutex_init(&grep->deques[i].lock, NULL);
+        grep->workers[i].grep = grep;
+        grep->workers[i].id = i;
+    }
+    pthread_mutex_init(&grep->lock, NULL);
+    pthread_cond_init(&grep->work_ready, NULL);
+    push_task(grep, 0, first);
+
+    for (int i = 0; i < wanted; i++) {
+        if (pthread_create(&grep->threads[grep->thread_count], NULL, tree_worker, &grep->workers[i]) != 0) {
+            LOG_INFO("Could not start tree search thread %d.", i);
+            break;
+        }
+        grep->thread_count++;
+    }
+    if (grep->thread_count == 0) {
+        // No thread to hand the work to; search everything now.
+        tree_worker(&grep->workers[0]);
+    }
+    return FAT_SUCCESS;
+}
+
+bool tree_grep_poll(TreeGrep* grep) {
+    if (!grep || !grep->term || grep->done) return false;
+    size_t old_count = grep->count;
+    size_t old_files = grep->files_done;
+
+    pthread_mutex_lock(&grep->lock);
+    if (grep->found_count > 0 && !grep->failed) {
+        if (grep->count + grep->found_count > grep->capacity) {
+            size_t new_capacity = grep->capacity ? grep->capacity : 256;
+            while (new_capacity < grep->count + grep->found_count) new_capacity *= 2;
+            TreeGrepHit* new_hits = realloc(grep->hits, new_capacity * sizeof(TreeGrepHit));
+            if (new_hits) {
+                grep->hits = new_hits;
+                grep->capacity = new_capacity;
+            } else {
+                grep->failed = true;
+                grep->cancel = true;
+            }
+        }
+        if (!grep->failed) {
+            memcpy(grep->hits + grep->count, grep->found, grep->found_count * sizeof(TreeGrepHit));
+            grep->count += grep->found_count;
+            grep->found_count = 0;
+        }
+    }
+    grep->files_done = grep->files_searched;
+    grep->done = grep->failed || grep->truncated || grep->finished;
+    pthread_mutex_unlock(&grep->lock);
+
+    return grep->count != old_count || grep->files_done != old_files || grep->done;
+}
+
+bool tree_grep_is_running(const TreeGrep* grep) {
+    return grep && grep->term && !grep->done;
+}
+
+void tree_grep_free(TreeGrep* grep) {
+    if (!grep || !grep->term) return;
+    if (grep->thread_count > 0) {
+        pthread_mutex_lock(&grep->lock);
+        grep->cancel = true;
+        pthread_cond_broadcast(&grep->work_ready);
+        pthread_mutex_unlock(&grep->lock);
+        for (int i = 0; i < grep->thread_count; i++) {
+            pthread_join(grep->threads[i], NULL);
+        }
+    }
+    for (int i = 0; i < grep->deque_count; i++) {
+        TreeGrepDeque* deque = &grep->deques[i];
+        for (size_t k = 0; k < deque->count; k++) {
+            TreeGrepTask* task = &deque->tasks[(deque->head + k) % deque->capacity];
+            free(task->path);
+            free(task->entry);
+        }
+        free(deque->tasks);
+        pthread_mutex_destroy(&deque->lock);
+    }
+    pthread_cond_destroy(&grep->work_ready);
+    pthread_mutex_destroy(&grep->lock);
+    for (size_t i = 0; i < grep->found_count; i++) {
+        free_hit(&grep->found[i]);
+    }
+    free(grep->found);
+    for (size_t i = 0; i < grep->count; i++) {
+        free_hit(&grep->hits[i]);
+    }
+    free(grep->hits);
+    free(grep->root);
+    free(grep->term);
+    memset(grep, 0, sizeof(*grep));
+}
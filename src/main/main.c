@@ -14,6 +14,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -29,11 +31,17 @@ static void print_help(const char* executable_name) {
     printf("FAT (File & Archive Tool) %s\n", FAT_VERSION);
     printf("A TUI file and archive viewer for your terminal.\n\n");
     printf("USAGE:\n");
-    printf("  %s [OPTIONS] <FILE>\n\n", executable_name);
+    printf("  %s [OPTIONS] <FILE>...\n", executable_name);
+    printf("  command | %s [OPTIONS] -\n\n", executable_name);
     printf("OPTIONS:\n");
     printf("  --force-text    Force the file to be opened in text mode.\n");
     printf("  --force-hex     Force the file to be opened in hex mode.\n");
-    printf("  -h, --help      Show this help message and exit.\n");
+    printf("  --diff          Compare two files side by side.\n");
+    printf("  --grep PATTERN  List the lines containing PATTERN in every file under a\n");
+    printf("                  directory (the current one by default), archives included.\n");
+    printf("  -h, --help      Show this help message and exit.\n\n");
+    printf("Opening several files shows them as buffers; use ] and [ to switch.\n");
+    printf("A directory opens as a listing; press Enter to open an entry.\n");
 }
 
 
@@ -42,7 +50,10 @@ static void print_help(const char* executable_name) {
  */
 int main(int argc, char *argv[]) {
     ForceViewMode force_mode = FORCE_VIEW_NONE;
-    char* filepath = NULL;
+    bool diff_mode = false;
+    const char* grep_term = NULL;
+    StringList files;
+    StringList_init(&files);
 
         // **Argument Parsing Logic**
     for (int i = 1; i < argc; i++) {
@@ -50,33 +61,82 @@ int main(int argc, char *argv[]) {
             force_mode = FORCE_VIEW_TEXT;
         } else if (strcmp(argv[i], "--force-hex") == 0) {
             force_mode = FORCE_VIEW_HEX;
+        } else if (strcmp(argv[i], "--diff") == 0) {
+            diff_mode = true;
+        } else if (strcmp(argv[i], "--grep") == 0) {
+            if (i + 1 >= argc || argv[i + 1][0] == '\0') {
+                fprintf(stderr, "Error: --grep needs a pattern.\n");
+                StringList_free(&files);
+                return 1;
+            }
+            grep_term = argv[++i];
         } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
             print_help(argv[0]);
             return 0;
-        } else if (argv[i][0] == '-') {
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
             fprintf(stderr, "Unknown option: %s\n", argv[i]);
             print_help(argv[0]);
+            StringList_free(&files);
+            return 1;
+        } else if (StringList_add(&files, argv[i]) != FAT_SUCCESS) {
+            fprintf(stderr, "Out of memory.\n");
+            StringList_free(&files);
             return 1;
-        } else {
-            if (filepath != NULL) {
-                fprintf(stderr, "Error: Multiple files specified. Only one file can be opened at a time.\n");
-                return 1;
-            }
-            filepath = argv[i];
         }
     }
 
-    if (filepath == NULL) {
-        fprintf(stderr, "Usage: %s [OPTIONS] <FILE>\n", argv[0]);
+    if (grep_term && files.count == 0 && StringList_add(&files, ".") != FAT_SUCCESS) {
+        fprintf(stderr, "Out of memory.\n");
+        StringList_free(&files);
+        return 1;
+    }
+    if (files.count == 0) {
+        fprintf(stderr, "Usage: %s [OPTIONS] <FILE>...\n", argv[0]);
+        return 1;
+    }
+    if (diff_mode && files.count != 2) {
+        fprintf(stderr, "Error: --diff needs exactly two files.\n");
+        StringList_free(&files);
+        return 1;
+    }
+    if (grep_term && (diff_mode || files.count != 1 || strcmp(files.lines[0], "-") == 0)) {
+        fprintf(stderr, "Error: --grep searches a single directory or file, and not with --diff.\n");
+        StringList_free(&files);
         return 1;
     }
 
+    // "-" reads the piped standard input. The terminal is reopened as the
+    // standard input so ncurses can still read the keyboard.
+    int stdin_fd = -1;
+    for (size_t i = 0; i < files.count; i++) {
+        if (strcmp(files.lines[i], "-") != 0) continue;
+        if (diff_mode) {
+            fprintf(stderr, "Error: --diff cannot read standard input.\n");
+            StringList_free(&files);
+            return 1;
+        }
+        if (stdin_fd >= 0 || isatty(STDIN_FILENO)) {
+            fprintf(stderr, "Error: '-' needs data piped to standard input, and can only be given once.\n");
+            StringList_free(&files);
+            return 1;
+        }
+        stdin_fd = dup(STDIN_FILENO);
+        int tty_fd = open("/dev/tty", O_RDONLY);
+        if (stdin_fd < 0 || tty_fd < 0 || dup2(tty_fd, STDIN_FILENO) < 0) {
+            fprintf(stderr, "Error: could not open the terminal for keyboard input.\n");
+            StringList_free(&files);
+            return 1;
+        }
+        close(tty_fd);
+    }
+
     setlocale(LC_ALL, "");
 
     ui_init();
     
     AppState state = {0};
     state.force_view_mode = force_mode; // Pass the forced mode to the state
+    state.stdin_fd = stdin_fd;
     
     // Load configuration to get terminal size requirements before checking
     config_load(&state);
@@ -117,7 +177,18 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
-    FatResult res = state_init(&state, filepath);
+    // Only the first file is opened now; the others load when first shown.
+    FatResult res = state_init(&state, files.lines[0]);
+    if (res == FAT_SUCCESS && diff_mode) {
+        res = state_open_diff(&state, files.lines[1]);
+    }
+    if (res == FAT_SUCCESS && grep_term) {
+        res = state_open_grep(&state, grep_term);
+    }
+    for (size_t i = 1; i < files.count && res == FAT_SUCCESS && !diff_mode; i++) {
+        res = state_add_buffer(&state, files.lines[i]);
+    }
+    StringList_free(&files);
     if (res != FAT_SUCCESS) {
         ui_destroy();
         LOG_INFO("FATAL: Initial state setup failed with code %d.", res);
@@ -131,10 +202,23 @@ int main(int argc, char *argv[]) {
     ui_draw(&state);
 
     int ch;
+    bool had_pending_work = true; // Work started by the initial view may finish within the first poll.
     while (true) {
+        // Poll while a background job is still producing results, and draw
+        // once more when it finishes so its last results are not left off screen.
+        bool has_pending_work = state_has_pending_work(&state);
+        if (had_pending_work && !has_pending_work) ui_draw(&state);
+        had_pending_work = has_pending_work;
+        timeout(has_pending_work ? 100 : -1);
         ch = getch();
-        
-        if (state.config.key_map[ch] == ACTION_QUIT) {
+        timeout(-1);
+
+        if (ch == ERR) {
+            ui_draw(&state);
+            continue;
+        }
+
+        if (ch >= 0 && ch < MAX_KEY_CODE && state.config.key_map[ch] == ACTION_QUIT) {
             break;
         }
 
@@ -144,6 +228,7 @@ int main(int argc, char *argv[]) {
 
         if (ch == KEY_RESIZE) {
             ui_handle_resize(&state);
+            state_fit_hex_view(&state);
             ui_draw(&state);
             continue;
         }
@@ -153,6 +238,8 @@ int main(int argc, char *argv[]) {
             ui_show_message(&state, fat_result_to_string(res));
         }
         ui_draw(&state);
+        // Work started by the key may finish within the first poll; draw its results then too.
+        had_pending_work = true;
     }
 
     full_app_reset(&state);
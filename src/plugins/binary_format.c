@@ -0,0 +1,932 @@
+/**
+ * @file binary_format.c
+ * @author Zuhaitz (original)
+ * @brief Implements header, section and symbol table parsing of ELF, PE and Mach-O files.
+ *
+ * Every field is read through bounds-checked positioned reads, so truncated or
+ * corrupt files are rejected or shown with fewer sections rather than crashing.
+ */
+#include "plugins/binary_format.h"
+#include "utils/logger.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/** @brief The most sections or segments listed, to bound the work on corrupt headers. */
+#define BINARY_MAX_SECTIONS 65536
+
+/** @brief The largest string table read, in bytes. */
+#define BINARY_MAX_STRTAB (256u * 1024 * 1024)
+
+/** @brief The number of symbol table entries read at a time. */
+#define BINARY_SYMBOL_CHUNK 4096
+
+/** @brief The largest symbol table entry read; tables claiming larger entries are skipped. */
+#define BINARY_MAX_SYMBOL_SIZE 64
+
+/** @brief The longest exported name read from a PE file. */
+#define BINARY_MAX_EXPORT_NAME 256
+
+// **Reading**
+
+/**
+ * @struct Reader
+ * @brief An open file and the byte order of its headers.
+ */
+typedef struct {
+    int fd;
+    uint64_t size;
+    bool big_endian;
+} Reader;
+
+/**
+ * @brief Reads `len` bytes at `offset`, failing if any of them is past the end of the file.
+ */
+static bool read_at(const Reader* r, uint64_t offset, void* buf, size_t len) {
+    if (offset > r->size || len > r->size - offset) return false;
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = pread(r->fd, (char*)buf + done, len - done, (off_t)(offset + done));
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            return false;
+        }
+        done += (size_t)n;
+    }
+    return true;
+}
+
+/**
+ * @brief Reads up to `count` entries of `entry_size` bytes at `offset` with a single read.
+ * @return The number of entries read: those that fit in the file, or 0 if the read failed.
+ */
+static size_t read_entries(const Reader* r, uint64_t offset, size_t entry_size, size_t count, void* buf) {
+    if (offset >= r->size) return 0;
+    uint64_t fit = (r->size - offset) / entry_size;
+    if (count > fit) count = (size_t)fit;
+    if (count == 0 || !read_at(r, offset, buf, count * entry_size)) return 0;
+    return count;
+}
+
+/** @brief Decodes a 16-bit field in the file's byte order. */
+static uint16_t u16(const Reader* r, const unsigned char* p) {
+    return r->big_endian ? (uint16_t)(p[0] << 8 | p[1]) : (uint16_t)(p[1] << 8 | p[0]);
+}
+
+/** @brief Decodes a 32-bit field in the file's byte order. */
+static uint32_t u32(const Reader* r, const unsigned char* p) {
+    return r->big_endian ? (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3]
+                         : (uint32_t)p[3] << 24 | (uint32_t)p[2] << 16 | (uint32_t)p[1] << 8 | p[0];
+}
+
+/** @brief Decodes a 64-bit field in the file's byte order. */
+static uint64_t u64(const Reader* r, const unsigned char* p) {
+    uint64_t hi = u32(r, r->big_endian ? p : p + 4);
+    uint64_t lo = u32(r, r->big_endian ? p + 4 : p);
+    return hi << 32 | lo;
+}
+
+/**
+ * @brief Copies a name that may not be null-terminated into a section entry.
+ */
+static void set_name(BinarySection* section, const char* name, size_t max_len) {
+    size_t len = strnlen(name, max_len);
+    if (len >= sizeof(section->name)) len = sizeof(section->name) - 1;
+    memcpy(section->name, name, len);
+    section->name[len] = '\0';
+}
+
+/**
+ * @brief Appends a section or segment to the list being built.
+ */
+static FatResult add_section(BinarySection** list, size_t* count, size_t* capacity, const BinarySection* section) {
+    if (*count >= BINARY_MAX_SECTIONS) return FAT_SUCCESS;
+    if (*count == *capacity) {
+        size_t new_capacity = *capacity ? *capacity * 2 : 32;
+        BinarySection* new_list = realloc(*list, new_capacity * sizeof(BinarySection));
+        if (!new_list) return FAT_ERROR_MEMORY;
+        *list = new_list;
+        *capacity = new_capacity;
+    }
+    (*list)[(*count)++] = *section;
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Sections and segments collected while parsing, listed sections first.
+ */
+typedef struct {
+    BinarySection* sections;
+    size_t section_count, section_capacity;
+    BinarySection* segments;
+    size_t segment_count, segment_capacity;
+} SectionLists;
+
+/**
+ * @brief Moves the collected entries into the format, sections first.
+ */
+static FatResult adopt_sections(BinaryFormat* format, SectionLists* lists) {
+    size_t total = lists->section_count + lists->segment_count;
+    if (total > 0) {
+        format->sections = malloc(total * sizeof(BinarySection));
+        if (!format->sections) return FAT_ERROR_MEMORY;
+        if (lists->section_count) memcpy(format->sections, lists->sections, lists->section_count * sizeof(BinarySection));
+        if (lists->segment_count) memcpy(format->sections + lists->section_count, lists->segments,
+                                         lists->segment_count * sizeof(BinarySection));
+    }
+    format->section_count = total;
+    return FAT_SUCCESS;
+}
+
+// **Symbol Index**
+
+/**
+ * @brief Hashes a name with 32-bit FNV-1a.
+ */
+static uint32_t hash_name(const char* name) {
+    uint32_t hash = 2166136261u;
+    for (; *name; name++) {
+        hash ^= (unsigned char)*name;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @struct SymbolBuilder
+ * @brief The symbols and names collected while reading the symbol tables.
+ */
+typedef struct {
+    BinarySymbol* symbols;
+    size_t count, capacity;
+    char* names;
+    size_t names_len, names_capacity;
+} SymbolBuilder;
+
+/**
+ * @brief Appends a symbol and a copy of its name.
+ */
+static FatResult add_symbol(SymbolBuilder* b, const char* name, size_t name_len, uint64_t address, uint64_t offset) {
+    if (name_len == 0 || b->names_len + name_len + 1 > UINT32_MAX) return FAT_SUCCESS;
+    if (b->count == b->capacity) {
+        size_t new_capacity = b->capacity ? b->capacity * 2 : 1024;
+        BinarySymbol* new_symbols = realloc(b->symbols, new_capacity * sizeof(BinarySymbol));
+        if (!new_symbols) return FAT_ERROR_MEMORY;
+        b->symbols = new_symbols;
+        b->capacity = new_capacity;
+    }
+    if (b->names_len + name_len + 1 > b->names_capacity) {
+        size_t new_capacity = b->names_capacity ? b->names_capacity : 16384;
+        while (new_capacity < b->names_len + name_len + 1) new_capacity *= 2;
+        char* new_names = realloc(b->names, new_capacity);
+        if (!new_names) return FAT_ERROR_MEMORY;
+        b->names = new_names;
+        b->names_capacity = new_capacity;
+    }
+    BinarySymbol* symbol = &b->symbols[b->count++];
+    symbol->name = (uint32_t)b->names_len;
+    symbol->address = address;
+    symbol->offset = offset;
+    memcpy(b->names + b->names_len, name, name_len);
+    b->names[b->names_len + name_len] = '\0';
+    b->names_len += name_len + 1;
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Hands the collected symbols to the format and builds the hash index over their names.
+ *
+ * The index is open-addressed with linear probing and at most half full.
+ * When a name appears more than once, the first symbol keeps it.
+ */
+static FatResult build_symbol_index(BinaryFormat* format, SymbolBuilder* b) {
+    format->symbols = b->symbols;
+    format->symbol_count = b->count;
+    format->names = b->names;
+    format->names_size = b->names_capacity;
+    b->symbols = NULL;
+    b->names = NULL;
+    if (format->symbol_count == 0) return FAT_SUCCESS;
+
+    size_t bucket_count = 16;
+    while (bucket_count < format->symbol_count * 2) bucket_count *= 2;
+    format->buckets = calloc(bucket_count, sizeof(uint32_t));
+    if (!format->buckets) return FAT_ERROR_MEMORY;
+    format->bucket_count = bucket_count;
+
+    for (size_t i = 0; i < format->symbol_count && i < UINT32_MAX - 1; i++) {
+        const char* name = format->names + format->symbols[i].name;
+        size_t slot = hash_name(name) & (bucket_count - 1);
+        while (format->buckets[slot] != 0) {
+            if (strcmp(format->names + format->symbols[format->buckets[slot] - 1].name, name) == 0) break;
+            slot = (slot + 1) & (bucket_count - 1);
+        }
+        if (format->buckets[slot] == 0) format->buckets[slot] = (uint32_t)i + 1;
+    }
+    return FAT_SUCCESS;
+}
+
+// **ELF**
+
+/**
+ * @brief Returns a short name for an ELF machine.
+ */
+static const char* elf_machine_name(uint16_t machine) {
+    switch (machine) {
+        case 2:   return "SPARC";
+        case 3:   return "x86";
+        case 8:   return "MIPS";
+        case 20:  return "PowerPC";
+        case 21:  return "PowerPC64";
+        case 22:  return "S390";
+        case 40:  return "ARM";
+        case 62:  return "x86-64";
+        case 183: return "AArch64";
+        case 243: return "RISC-V";
+        case 258: return "LoongArch";
+        default:  return "unknown machine";
+    }
+}
+
+/**
+ * @brief Returns the name of an ELF program header type.
+ */
+static const char* elf_segment_name(uint32_t type, char* buf, size_t size) {
+    switch (type) {
+        case 1:          return "LOAD";
+        case 2:          return "DYNAMIC";
+        case 3:          return "INTERP";
+        case 4:          return "NOTE";
+        case 6:          return "PHDR";
+        case 7:          return "TLS";
+        case 0x6474e550: return "GNU_EH_FRAME";
+        case 0x6474e551: return "GNU_STACK";
+        case 0x6474e552: return "GNU_RELRO";
+        case 0x6474e553: return "GNU_PROPERTY";
+        default:
+            snprintf(buf, size, "0x%x", type);
+            return buf;
+    }
+}
+
+/**
+ * @struct ElfHeader
+ * @brief The ELF header fields needed to find the tables.
+ */
+typedef struct {
+    bool is_64;
+    uint64_t shoff, phoff;
+    uint32_t shnum, phnum, shstrndx;
+    uint16_t shentsize, phentsize;
+} ElfHeader;
+
+/**
+ * @struct ElfSection
+ * @brief The fields of an ELF section header.
+ */
+typedef struct {
+    uint32_t name, type, link;
+    uint64_t address, offset, size, entsize;
+} ElfSection;
+
+/**
+ * @brief Reads section header `index`.
+ */
+static bool elf_read_section(const Reader* r, const ElfHeader* h, uint32_t index, ElfSection* s) {
+    unsigned char b[64];
+    size_t len = h->is_64 ? 64 : 40;
+    if (h->shentsize < len || !read_at(r, h->shoff + (uint64_t)index * h->shentsize, b, len)) return false;
+    s->name = u32(r, b);
+    s->type = u32(r, b + 4);
+    if (h->is_64) {
+        s->address = u64(r, b + 16);
+        s->offset = u64(r, b + 24);
+        s->size = u64(r, b + 32);
+        s->link = u32(r, b + 40);
+        s->entsize = u64(r, b + 56);
+    } else {
+        s->address = u32(r, b + 12);
+        s->offset = u32(r, b + 16);
+        s->size = u32(r, b + 20);
+        s->link = u32(r, b + 24);
+        s->entsize = u32(r, b + 36);
+    }
+    return true;
+}
+
+/**
+ * @brief Reads the ELF header, resolving the extended section counts.
+ */
+static bool elf_read_header(const Reader* r, const unsigned char* ident, ElfHeader* h, uint16_t* type, uint16_t* machine) {
+    unsigned char b[64];
+    h->is_64 = ident[4] == 2;
+    if (!read_at(r, 0, b, h->is_64 ? 64 : 52)) return false;
+    *type = u16(r, b + 16);
+    *machine = u16(r, b + 18);
+    if (h->is_64) {
+        h->phoff = u64(r, b + 32);
+        h->shoff = u64(r, b + 40);
+        h->phentsize = u16(r, b + 54);
+        h->phnum = u16(r, b + 56);
+        h->shentsize = u16(r, b + 58);
+        h->shnum = u16(r, b + 60);
+        h->shstrndx = u16(r, b + 62);
+    } else {
+        h->phoff = u32(r, b + 28);
+        h->shoff = u32(r, b + 32);
+        h->phentsize = u16(r, b + 42);
+        h->phnum = u16(r, b + 44);
+        h->shentsize = u16(r, b + 46);
+        h->shnum = u16(r, b + 48);
+        h->shstrndx = u16(r, b + 50);
+    }
+    if (h->shoff == 0) h->shnum = 0;
+    if (h->shoff != 0 && (h->shnum == 0 || h->shstrndx == 0xffff)) {
+        // Too many sections for the header: the real values live in section 0.
+        ElfSection first;
+        if (elf_read_section(r, h, 0, &first)) {
+            if (h->shnum == 0) h->shnum = first.size > BINARY_MAX_SECTIONS ? BINARY_MAX_SECTIONS : (uint32_t)first.size;
+            if (h->shstrndx == 0xffff) h->shstrndx = first.link;
+        }
+    }
+    if (h->shnum > BINARY_MAX_SECTIONS) h->shnum = BINARY_MAX_SECTIONS;
+    return true;
+}
+
+/**
+ * @brief Reads a whole string table section into memory, null-terminated.
+ */
+static char* read_strtab(const Reader* r, uint64_t offset, uint64_t size) {
+    if (size == 0 || size > BINARY_MAX_STRTAB) return NULL;
+    char* table = malloc((size_t)size + 1);
+    if (!table) return NULL;
+    if (!read_at(r, offset, table, (size_t)size)) {
+        free(table);
+        return NULL;
+    }
+    table[size] = '\0';
+    return table;
+}
+
+/**
+ * @brief Parses the section and program headers of an ELF file.
+ */
+static FatResult elf_open(BinaryFormat* format, const Reader* r, const unsigned char* ident) {
+    ElfHeader h;
+    uint16_t type, machine;
+    if (!elf_read_header(r, ident, &h, &type, &machine)) return FAT_ERROR_UNSUPPORTED;
+
+    static const char* const types[] = { "file", "relocatable", "executable", "shared object", "core dump" };
+    snprintf(format->description, sizeof(format->description), "ELF%s %s %s",
+             h.is_64 ? "64" : "32", elf_machine_name(machine), type < 5 ? types[type] : "file");
+
+    SectionLists lists = {0};
+    FatResult res = FAT_SUCCESS;
+    char* shstrtab = NULL;
+    uint64_t shstrtab_size = 0;
+    ElfSection s;
+    if (h.shstrndx < h.shnum && elf_read_section(r, &h, h.shstrndx, &s)) {
+        shstrtab = read_strtab(r, s.offset, s.size);
+        shstrtab_size = s.size;
+    }
+
+    for (uint32_t i = 1; res == FAT_SUCCESS && i < h.shnum; i++) {
+        if (!elf_read_section(r, &h, i, &s)) break;
+        if (s.type == 0) continue; // SHT_NULL
+        BinarySection entry = {0};
+        if (shstrtab && s.name < shstrtab_size && shstrtab[s.name]) {
+            set_name(&entry, shstrtab + s.name, shstrtab_size - s.name);
+        } else {
+            snprintf(entry.name, sizeof(entry.name), "[%u]", i);
+        }
+        entry.offset = s.offset;
+        entry.size = s.type == 8 ? 0 : s.size; // SHT_NOBITS occupies no file space
+        entry.address = s.address;
+        res = add_section(&lists.sections, &lists.section_count, &lists.section_capacity, &entry);
+    }
+    free(shstrtab);
+
+    size_t ph_len = h.is_64 ? 56 : 32;
+    for (uint32_t i = 0; res == FAT_SUCCESS && i < h.phnum && h.phentsize >= ph_len; i++) {
+        unsigned char b[56];
+        if (!read_at(r, h.phoff + (uint64_t)i * h.phentsize, b, ph_len)) break;
+        uint32_t ptype = u32(r, b);
+        if (ptype == 0) continue; // PT_NULL
+        uint32_t flags = h.is_64 ? u32(r, b + 4) : u32(r, b + 24);
+        BinarySection entry = {0};
+        entry.is_segment = true;
+        entry.offset = h.is_64 ? u64(r, b + 8) : u32(r, b + 4);
+        entry.address = h.is_64 ? u64(r, b + 16) : u32(r, b + 8);
+        entry.size = h.is_64 ? u64(r, b + 32) : u32(r, b + 16);
+        char type_buf[16];
+        snprintf(entry.name, sizeof(entry.name), "%s %c%c%c", elf_segment_name(ptype, type_buf, sizeof(type_buf)),
+                 flags & 4 ? 'r' : '-', flags & 2 ? 'w' : '-', flags & 1 ? 'x' : '-');
+        res = add_section(&lists.segments, &lists.segment_count, &lists.segment_capacity, &entry);
+    }
+
+    if (res == FAT_SUCCESS) res = adopt_sections(format, &lists);
+    free(lists.sections);
+    free(lists.segments);
+    return res;
+}
+
+/**
+ * @brief Reads the .symtab and .dynsym tables of an ELF file.
+ */
+static FatResult elf_load_symbols(BinaryFormat* format, const Reader* r, SymbolBuilder* b) {
+    unsigned char ident[16];
+    ElfHeader h;
+    uint16_t type, machine;
+    if (!read_at(r, 0, ident, sizeof(ident)) || !elf_read_header(r, ident, &h, &type, &machine)) {
+        return FAT_ERROR_FILE_READ;
+    }
+    (void)format;
+
+    // The headers are read once: every symbol looks up the section it lies in.
+    ElfSection* headers = malloc((h.shnum ? h.shnum : 1) * sizeof(ElfSection));
+    size_t sym_len = h.is_64 ? 24 : 16;
+    unsigned char* chunk = malloc((size_t)BINARY_SYMBOL_CHUNK * BINARY_MAX_SYMBOL_SIZE);
+    if (!headers || !chunk) {
+        free(headers);
+        free(chunk);
+        return FAT_ERROR_MEMORY;
+    }
+    uint32_t shnum = 0;
+    while (shnum < h.shnum && elf_read_section(r, &h, shnum, &headers[shnum])) shnum++;
+
+    FatResult res = FAT_SUCCESS;
+    for (uint32_t i = 1; res == FAT_SUCCESS && i < shnum; i++) {
+        const ElfSection* table = &headers[i];
+        if (table->type != 2 && table->type != 11) continue; // SHT_SYMTAB, SHT_DYNSYM
+        if (table->entsize < sym_len || table->entsize > BINARY_MAX_SYMBOL_SIZE || table->link >= shnum) continue;
+        const ElfSection* strings = &headers[table->link];
+        char* strtab = read_strtab(r, strings->offset, strings->size);
+        if (!strtab) continue;
+
+        uint64_t count = table->size / table->entsize;
+        for (uint64_t first = 0; res == FAT_SUCCESS && first < count; first += BINARY_SYMBOL_CHUNK) {
+            size_t want = count - first < BINARY_SYMBOL_CHUNK ? (size_t)(count - first) : BINARY_SYMBOL_CHUNK;
+            size_t n = read_entries(r, table->offset + first * table->entsize, (size_t)table->entsize, want, chunk);
+            for (size_t k = 0; res == FAT_SUCCESS && k < n; k++) {
+                const unsigned char* e = chunk + k * table->entsize;
+                uint32_t name = u32(r, e);
+                unsigned char info = h.is_64 ? e[4] : e[12];
+                uint16_t shndx = h.is_64 ? u16(r, e + 6) : u16(r, e + 14);
+                uint64_t value = h.is_64 ? u64(r, e + 8) : u32(r, e + 4);
+                unsigned char sym_type = info & 0xf;
+                if (name == 0 || name >= strings->size || shndx == 0 || sym_type == 3 || sym_type == 4) continue;
+
+                uint64_t offset = UINT64_MAX;
+                if (shndx < shnum && shndx < 0xff00) {
+                    const ElfSection* home = &headers[shndx];
+                    if (home->type != 8 && value >= home->address && value - home->address < home->size) {
+                        offset = home->offset + (value - home->address);
+                    }
+                }
+                const char* symbol_name = strtab + name;
+                res = add_symbol(b, symbol_name, strnlen(symbol_name, strings->size - name), value, offset);
+            }
+            if (n < want) break; // The table runs past the end of the file
+        }
+        free(strtab);
+    }
+    free(chunk);
+    free(headers);
+    return res;
+}
+
+// **PE**
+
+/**
+ * @struct PeInfo
+ * @brief The PE header fields needed to locate sections and exports.
+ */
+typedef struct {
+    uint64_t image_base;
+    uint64_t section_table;
+    uint16_t section_count;
+    uint32_t export_rva;
+    uint32_t export_size;
+} PeInfo;
+
+/**
+ * @brief Reads the PE headers, returning false if the file is not PE.
+ */
+static bool pe_read_info(const Reader* r, PeInfo* info, uint16_t* machine, uint16_t* characteristics, bool* is_plus) {
+    unsigned char b[4];
+    if (!read_at(r, 0x3c, b, 4)) return false;
+    uint32_t pe_offset = u32(r, b);
+    unsigned char coff[24];
+    if (!read_at(r, pe_offset, coff, sizeof(coff)) || memcmp(coff, "PE\0\0", 4) != 0) return false;
+    *machine = u16(r, coff + 4);
+    info->section_count = u16(r, coff + 6);
+    uint16_t optional_size = u16(r, coff + 20);
+    *characteristics = u16(r, coff + 22);
+
+    unsigned char opt[120] = {0};
+    uint64_t opt_offset = (uint64_t)pe_offset + 24;
+    size_t opt_len = optional_size < sizeof(opt) ? optional_size : sizeof(opt);
+    if (opt_len >= 2 && !read_at(r, opt_offset, opt, opt_len)) return false;
+    uint16_t magic = u16(r, opt);
+    *is_plus = magic == 0x20b;
+    info->image_base = *is_plus ? u64(r, opt + 24) : u32(r, opt + 28);
+    size_t dir_offset = *is_plus ? 112 : 96;
+    uint32_t dir_count = opt_len >= dir_offset ? u32(r, opt + dir_offset - 4) : 0;
+    info->export_rva = info->export_size = 0;
+    if (dir_count > 0 && opt_len >= dir_offset + 8) {
+        info->export_rva = u32(r, opt + dir_offset);
+        info->export_size = u32(r, opt + dir_offset + 4);
+    }
+    info->section_table = opt_offset + optional_size;
+    return true;
+}
+
+/**
+ * @brief Converts a relative virtual address to a file offset using the section table.
+ */
+static uint64_t pe_rva_to_offset(const BinaryFormat* format, const PeInfo* info, uint32_t rva) {
+    uint64_t address = info->image_base + rva;
+    for (size_t i = 0; i < format->section_count; i++) {
+        const BinarySection* s = &format->sections[i];
+        if (address >= s->address && address - s->address < s->size) return s->offset + (address - s->address);
+    }
+    return UINT64_MAX;
+}
+
+/**
+ * @brief Parses the section table of a PE file.
+ */
+static FatResult pe_open(BinaryFormat* format, const Reader* r) {
+    PeInfo info;
+    uint16_t machine, characteristics;
+    bool is_plus;
+    if (!pe_read_info(r, &info, &machine, &characteristics, &is_plus)) return FAT_ERROR_UNSUPPORTED;
+
+    const char* machine_name = machine == 0x14c ? "x86" : machine == 0x8664 ? "x86-64" : machine == 0xaa64 ? "ARM64" :
+                               machine == 0x1c0 || machine == 0x1c4 ? "ARM" : "unknown machine";
+    snprintf(format->description, sizeof(format->description), "PE32%s %s %s", is_plus ? "+" : "",
+             machine_name, characteristics & 0x2000 ? "DLL" : "executable");
+
+    SectionLists lists = {0};
+    FatResult res = FAT_SUCCESS;
+    for (uint16_t i = 0; res == FAT_SUCCESS && i < info.section_count; i++) {
+        unsigned char b[40];
+        if (!read_at(r, info.section_table + (uint64_t)i * 40, b, sizeof(b))) break;
+        BinarySection entry = {0};
+        set_name(&entry, (const char*)b, 8);
+        entry.address = info.image_base + u32(r, b + 12);
+        entry.size = u32(r, b + 16);
+        entry.offset = u32(r, b + 20);
+        res = add_section(&lists.sections, &lists.section_count, &lists.section_capacity, &entry);
+    }
+    if (res == FAT_SUCCESS) res = adopt_sections(format, &lists);
+    free(lists.sections);
+    return res;
+}
+
+/**
+ * @brief Reads the export directory of a PE file.
+ */
+static FatResult pe_load_symbols(BinaryFormat* format, const Reader* r, SymbolBuilder* b) {
+    PeInfo info;
+    uint16_t machine, characteristics;
+    bool is_plus;
+    if (!pe_read_info(r, &info, &machine, &characteristics, &is_plus)) return FAT_ERROR_FILE_READ;
+    if (info.export_rva == 0) return FAT_SUCCESS;
+
+    unsigned char dir[40];
+    uint64_t dir_offset = pe_rva_to_offset(format, &info, info.export_rva);
+    if (dir_offset == UINT64_MAX || !read_at(r, dir_offset, dir, sizeof(dir))) return FAT_SUCCESS;
+    uint32_t function_count = u32(r, dir + 20);
+    uint32_t name_count = u32(r, dir + 24);
+    uint64_t functions = pe_rva_to_offset(format, &info, u32(r, dir + 28));
+    uint64_t names = pe_rva_to_offset(format, &info, u32(r, dir + 32));
+    uint64_t ordinals = pe_rva_to_offset(format, &info, u32(r, dir + 36));
+    if (functions == UINT64_MAX || names == UINT64_MAX || ordinals == UINT64_MAX) return FAT_SUCCESS;
+
+    FatResult res = FAT_SUCCESS;
+    for (uint32_t i = 0; res == FAT_SUCCESS && i < name_count; i++) {
+        unsigned char name_rva[4], ordinal[2], function_rva[4];
+        if (!read_at(r, names + (uint64_t)i * 4, name_rva, 4) || !read_at(r, ordinals + (uint64_t)i * 2, ordinal, 2)) break;
+        uint16_t index = u16(r, ordinal);
+        if (index >= function_count || !read_at(r, functions + (uint64_t)index * 4, function_rva, 4)) continue;
+
+        char name[BINARY_MAX_EXPORT_NAME];
+        uint64_t name_offset = pe_rva_to_offset(format, &info, u32(r, name_rva));
+        if (name_offset == UINT64_MAX) continue;
+        size_t len = sizeof(name) - 1;
+        if (name_offset + len > r->size) len = (size_t)(r->size - name_offset);
+        if (!read_at(r, name_offset, name, len)) continue;
+        name[len] = '\0';
+
+        uint32_t rva = u32(r, function_rva);
+        res = add_symbol(b, name, strlen(name), info.image_base + rva, pe_rva_to_offset(format, &info, rva));
+    }
+    return res;
+}
+
+// **Mach-O**
+
+/**
+ * @brief Returns true if the first word is a thin Mach-O magic, setting the byte order and width.
+ */
+static bool macho_detect(Reader* r, const unsigned char* ident, bool* is_64) {
+    uint32_t le = (uint32_t)ident[3] << 24 | (uint32_t)ident[2] << 16 | (uint32_t)ident[1] << 8 | ident[0];
+    uint32_t be = (uint32_t)ident[0] << 24 | (uint32_t)ident[1] << 16 | (uint32_t)ident[2] << 8 | ident[3];
+    if (le == 0xfeedface || le == 0xfeedfacf) {
+        r->big_endian = false;
+        *is_64 = le == 0xfeedfacf;
+        return true;
+    }
+    if (be == 0xfeedface || be == 0xfeedfacf) {
+        r->big_endian = true;
+        *is_64 = be == 0xfeedfacf;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Parses the segments and sections of a Mach-O file.
+ */
+static FatResult macho_open(BinaryFormat* format, const Reader* r, bool is_64) {
+    unsigned char h[32];
+    if (!read_at(r, 0, h, is_64 ? 32 : 28)) return FAT_ERROR_UNSUPPORTED;
+    uint32_t cpu = u32(r, h + 4);
+    uint32_t filetype = u32(r, h + 12);
+    uint32_t ncmds = u32(r, h + 16);
+
+    const char* cpu_name = cpu == 7 ? "x86" : cpu == 0x01000007 ? "x86-64" : cpu == 12 ? "ARM" :
+                           cpu == 0x0100000c ? "ARM64" : cpu == 18 ? "PowerPC" : "unknown CPU";
+    const char* type_name = filetype == 1 ? "object" : filetype == 2 ? "executable" : filetype == 4 ? "core dump" :
+                            filetype == 6 ? "dylib" : filetype == 8 ? "bundle" : filetype == 10 ? "debug symbols" : "file";
+    snprintf(format->description, sizeof(format->description), "Mach-O %s %s %s", is_64 ? "64-bit" : "32-bit",
+             cpu_name, type_name);
+
+    SectionLists lists = {0};
+    FatResult res = FAT_SUCCESS;
+    uint64_t cmd_offset = is_64 ? 32 : 28;
+    for (uint32_t c = 0; res == FAT_SUCCESS && c < ncmds && c < BINARY_MAX_SECTIONS; c++) {
+        unsigned char lc[8];
+        if (!read_at(r, cmd_offset, lc, sizeof(lc))) break;
+        uint32_t cmd = u32(r, lc);
+        uint32_t cmd_size = u32(r, lc + 4);
+        if (cmd_size < 8) break;
+
+        if (cmd == (is_64 ? 0x19u : 0x1u)) { // LC_SEGMENT_64 / LC_SEGMENT
+            unsigned char seg[72];
+            size_t seg_len = is_64 ? 72 : 56;
+            if (!read_at(r, cmd_offset, seg, seg_len)) break;
+            BinarySection entry = {0};
+            entry.is_segment = true;
+            set_name(&entry, (const char*)seg + 8, 16);
+            entry.address = is_64 ? u64(r, seg + 24) : u32(r, seg + 24);
+            entry.offset = is_64 ? u64(r, seg + 40) : u32(r, seg + 32);
+            entry.size = is_64 ? u64(r, seg + 48) : u32(r, seg + 36);
+            uint32_t nsects = u32(r, seg + (is_64 ? 64 : 48));
+            res = add_section(&lists.segments, &lists.segment_count, &lists.segment_capacity, &entry);
+
+            size_t sect_len = is_64 ? 80 : 68;
+            for (uint32_t s = 0; res == FAT_SUCCESS && s < nsects; s++) {
+                unsigned char sect[80];
+                if (!read_at(r, cmd_offset + seg_len + (uint64_t)s * sect_len, sect, sect_len)) break;
+                char sect_name[17] = {0}, seg_name[17] = {0};
+                memcpy(sect_name, sect, 16);
+                memcpy(seg_name, sect + 16, 16);
+                BinarySection section = {0};
+                snprintf(section.name, sizeof(section.name), "%.14s,%.16s", seg_name, sect_name);
+                section.address = is_64 ? u64(r, sect + 32) : u32(r, sect + 32);
+                section.size = is_64 ? u64(r, sect + 40) : u32(r, sect + 36);
+                section.offset = u32(r, sect + (is_64 ? 48 : 40));
+                uint32_t flags = u32(r, sect + (is_64 ? 64 : 56));
+                uint8_t section_type = flags & 0xff;
+                if (section_type == 1 || section_type == 0x0c || section_type == 0x12) section.size = 0; // Zero-fill
+                res = add_section(&lists.sections, &lists.section_count, &lists.section_capacity, &section);
+            }
+        }
+        cmd_offset += cmd_size;
+    }
+
+    if (res == FAT_SUCCESS) res = adopt_sections(format, &lists);
+    free(lists.sections);
+    free(lists.segments);
+    return res;
+}
+
+/**
+ * @brief Reads the LC_SYMTAB symbols of a Mach-O file.
+ */
+static FatResult macho_load_symbols(BinaryFormat* format, const Reader* r, SymbolBuilder* b) {
+    unsigned char ident[4];
+    bool is_64;
+    Reader reader = *r;
+    if (!read_at(r, 0, ident, 4) || !macho_detect(&reader, ident, &is_64)) return FAT_ERROR_FILE_READ;
+    r = &reader;
+
+    unsigned char h[32];
+    if (!read_at(r, 0, h, is_64 ? 32 : 28)) return FAT_ERROR_FILE_READ;
+    uint32_t ncmds = u32(r, h + 16);
+    uint64_t cmd_offset = is_64 ? 32 : 28;
+    size_t nlist_len = is_64 ? 16 : 12;
+    FatResult res = FAT_SUCCESS;
+
+    for (uint32_t c = 0; res == FAT_SUCCESS && c < ncmds && c < BINARY_MAX_SECTIONS; c++) {
+        unsigned char lc[24];
+        if (!read_at(r, cmd_offset, lc, 8)) break;
+        uint32_t cmd = u32(r, lc);
+        uint32_t cmd_size = u32(r, lc + 4);
+        if (cmd_size < 8) break;
+        if (cmd == 0x2 && read_at(r, cmd_offset, lc, sizeof(lc))) { // LC_SYMTAB
+            uint32_t symoff = u32(r, lc + 8), nsyms = u32(r, lc + 12);
+            uint32_t stroff = u32(r, lc + 16), strsize = u32(r, lc + 20);
+            char* strtab = read_strtab(r, stroff, strsize);
+            if (!strtab) break;
+            unsigned char* chunk = malloc(BINARY_SYMBOL_CHUNK * nlist_len);
+            if (!chunk) {
+                free(strtab);
+                return FAT_ERROR_MEMORY;
+            }
+            for (uint32_t first = 0; res == FAT_SUCCESS && first < nsyms; first += BINARY_SYMBOL_CHUNK) {
+                size_t want = nsyms - first < BINARY_SYMBOL_CHUNK ? nsyms - first : BINARY_SYMBOL_CHUNK;
+                size_t n = read_entries(r, symoff + (uint64_t)first * nlist_len, nlist_len, want, chunk);
+                for (size_t k = 0; res == FAT_SUCCESS && k < n; k++) {
+                    const unsigned char* e = chunk + k * nlist_len;
+                    uint32_t name = u32(r, e);
+                    uint8_t type = e[4];
+                    if (name == 0 || name >= strsize || (type & 0xe0) || (type & 0x0e) != 0x0e) continue; // Named N_SECT only
+                    uint64_t value = is_64 ? u64(r, e + 8) : u32(r, e + 8);
+
+                    uint64_t offset = UINT64_MAX;
+                    for (size_t s = 0; s < format->section_count; s++) {
+                        const BinarySection* seg = &format->sections[s];
+                        if (seg->is_segment && value >= seg->address && value - seg->address < seg->size) {
+                            offset = seg->offset + (value - seg->address);
+                            break;
+                        }
+                    }
+                    const char* symbol_name = strtab + name;
+                    res = add_symbol(b, symbol_name, strnlen(symbol_name, strsize - name), value, offset);
+                }
+                if (n < want) break; // The table runs past the end of the file
+            }
+            free(chunk);
+            free(strtab);
+        }
+        cmd_offset += cmd_size;
+    }
+    return res;
+}
+
+// **Public API**
+
+/**
+ * @brief Recognises an executable and reads its section and segment tables.
+ */
+FatResult binary_format_open(BinaryFormat* format, const char* path) {
+    memset(format, 0, sizeof(*format));
+
+    Reader r = { .fd = open(path, O_RDONLY), .big_endian = false };
+    if (r.fd < 0) return FAT_ERROR_FILE_READ;
+    struct stat st;
+    if (fstat(r.fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(r.fd);
+        return FAT_ERROR_UNSUPPORTED;
+    }
+    r.size = (uint64_t)st.st_size;
+
+    unsigned char ident[16];
+    FatResult res = FAT_ERROR_UNSUPPORTED;
+    bool is_64;
+    if (read_at(&r, 0, ident, sizeof(ident))) {
+        if (memcmp(ident, "\x7f" "ELF", 4) == 0 && (ident[4] == 1 || ident[4] == 2) && (ident[5] == 1 || ident[5] == 2)) {
+            r.big_endian = ident[5] == 2;
+            format->kind = BINARY_KIND_ELF;
+            res = elf_open(format, &r, ident);
+        } else if (ident[0] == 'M' && ident[1] == 'Z') {
+            format->kind = BINARY_KIND_PE;
+            res = pe_open(format, &r);
+        } else if (macho_detect(&r, ident, &is_64)) {
+            format->kind = BINARY_KIND_MACHO;
+            res = macho_open(format, &r, is_64);
+        }
+    }
+    close(r.fd);
+
+    if (res == FAT_SUCCESS) {
+        format->path = strdup(path);
+        if (!format->path) res = FAT_ERROR_MEMORY;
+    }
+    if (res != FAT_SUCCESS) {
+        binary_format_free(format);
+        return res;
+    }
+    LOG_INFO("Recognised '%s' as %s with %zu sections and segments", path, format->description, format->section_count);
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Finds the section or segment containing a file offset.
+ */
+int binary_format_section_at(const BinaryFormat* format, uint64_t offset) {
+    int segment = -1;
+    for (size_t i = 0; i < format->section_count && i <= INT32_MAX; i++) {
+        const BinarySection* s = &format->sections[i];
+        if (offset < s->offset || offset - s->offset >= s->size) continue;
+        if (!s->is_segment) return (int)i;
+        if (segment < 0) segment = (int)i;
+    }
+    return segment;
+}
+
+/**
+ * @brief Reads the symbol tables and builds the hash index over their names.
+ */
+static FatResult load_symbols(BinaryFormat* format) {
+    Reader r = { .fd = open(format->path, O_RDONLY), .big_endian = false };
+    if (r.fd < 0) return FAT_ERROR_FILE_READ;
+    struct stat st;
+    if (fstat(r.fd, &st) != 0) {
+        close(r.fd);
+        return FAT_ERROR_FILE_READ;
+    }
+    r.size = (uint64_t)st.st_size;
+
+    SymbolBuilder b = {0};
+    FatResult res;
+    if (format->kind == BINARY_KIND_ELF) {
+        unsigned char ident[6];
+        res = read_at(&r, 0, ident, sizeof(ident)) ? FAT_SUCCESS : FAT_ERROR_FILE_READ;
+        if (res == FAT_SUCCESS) {
+            r.big_endian = ident[5] == 2;
+            res = elf_load_symbols(format, &r, &b);
+        }
+    } else if (format->kind == BINARY_KIND_PE) {
+        res = pe_load_symbols(format, &r, &b);
+    } else {
+        res = macho_load_symbols(format, &r, &b);
+    }
+    close(r.fd);
+
+    if (res == FAT_SUCCESS) res = build_symbol_index(format, &b);
+    free(b.symbols);
+    free(b.names);
+    if (res != FAT_SUCCESS) return res;
+    format->symbols_loaded = true;
+    LOG_INFO("Indexed %zu symbols of '%s'", format->symbol_count, format->path);
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Looks up a symbol by name, reading the symbol tables on first use.
+ */
+FatResult binary_format_find_symbol(BinaryFormat* format, const char* name, const BinarySymbol** symbol) {
+    if (!format->symbols_loaded) {
+        FatResult res = load_symbols(format);
+        if (res != FAT_SUCCESS) return res;
+    }
+    if (format->bucket_count == 0 || name[0] == '\0') return FAT_ERROR_FILE_NOT_FOUND;
+
+    size_t slot = hash_name(name) & (format->bucket_count - 1);
+    while (format->buckets[slot] != 0) {
+        const BinarySymbol* candidate = &format->symbols[format->buckets[slot] - 1];
+        if (strcmp(format->names + candidate->name, name) == 0) {
+            *symbol = candidate;
+            return FAT_SUCCESS;
+        }
+        slot = (slot + 1) & (format->bucket_count - 1);
+    }
+    for (size_t i = 0; i < format->symbol_count; i++) {
+        if (strstr(format->names + format->symbols[i].name, name)) {
+            *symbol = &format->symbols[i];
+            return FAT_SUCCESS;
+        }
+    }
+    return FAT_ERROR_FILE_NOT_FOUND;
+}
+
+/**
+ * @brief Returns the heap memory held by the format.
+ */
+size_t binary_format_memory_usage(const BinaryFormat* format) {
+    size_t usage = format->section_count * sizeof(BinarySection);
+    usage += format->symbol_count * sizeof(BinarySymbol);
+    usage += format->names_size;
+    usage += format->bucket_count * sizeof(uint32_t);
+    return usage;
+}
+
+/**
+ * @brief Frees the format.
+ */
+void binary_format_free(BinaryFormat* format) {
+    free(format->path);
+    free(format->sections);
+    free(format->symbols);
+    free(format->names);
+    free(format->buckets);
+    memset(format, 0, sizeof(*format));
+}
@@ -1,83 +1,303 @@
 /**
  * @file hex_viewer.c
  * @author Zuhaitz (original)
- * @brief Implements the binary file hex dump generator.
+ * @brief Implements the binary file hex dump formatter.
  *
- * This file contains the logic for reading a file byte-by-byte and
- * formatting it into a standard hex dump view.
+ * This file contains the logic for turning the bytes of a mapped file into
+ * hex dump rows on demand, using precomputed lookup tables.
  */
 #include "plugins/hex_viewer_api.h"
 #include "utils/logger.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
-#include <errno.h>
+
+/** @brief The two uppercase hex digits of every byte value, back to back. */
+static const char HEX_PAIRS[512] =
+    "000102030405060708090A0B0C0D0E0F"
+    "101112131415161718191A1B1C1D1E1F"
+    "202122232425262728292A2B2C2D2E2F"
+    "303132333435363738393A3B3C3D3E3F"
+    "404142434445464748494A4B4C4D4E4F"
+    "505152535455565758595A5B5C5D5E5F"
+    "606162636465666768696A6B6C6D6E6F"
+    "707172737475767778797A7B7C7D7E7F"
+    "808182838485868788898A8B8C8D8E8F"
+    "909192939495969798999A9B9C9D9E9F"
+    "A0A1A2A3A4A5A6A7A8A9AAABACADAEAF"
+    "B0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+    "C0C1C2C3C4C5C6C7C8C9CACBCCCDCECF"
+    "D0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+    "E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEF"
+    "F0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF";
+
+/** @brief The row widths tried, widest first, when the layout adapts to the pane. */
+static const int FIT_WIDTHS[] = { 32, 16, 8 };
 
 /**
- * @brief Generates a hex dump of a given file's content.
+ * @brief Returns the size of the words decoded by the integer column.
  *
- * @param filepath The path to the binary file to dump.
- * @param dump_list A pointer to a StringList to be populated with the hex dump lines.
- * @return FAT_SUCCESS on success, or an error code on failure.
- */
-FatResult hex_viewer_generate_dump(const char* filepath, StringList* dump_list) {
-    FILE* f = NULL;
-    FatResult result = FAT_SUCCESS;
-    unsigned char buffer[16]; // Process the file in 16-byte chunks.
-    size_t bytes_read;
-    unsigned long offset = 0;
-    char line_buffer[100]; // A buffer large enough for one formatted line.
-
-    f = fopen(filepath, "rb");
-    if (!f) {
-        LOG_INFO("Could not open file '%s' for hex dump: %s", filepath, strerror(errno));
-        return FAT_ERROR_FILE_READ;
+ * Words follow the grouping; ungrouped bytes are decoded as 32-bit words.
+ */
+static int word_size(const HexView* view) {
+    return view->layout.group_size > 1 ? view->layout.group_size : 4;
+}
+
+/**
+ * @brief Returns the decimal digits of the largest unsigned word of a size.
+ */
+static int word_digits(int size) {
+    return size == 2 ? 5 : size == 4 ? 10 : 20;
+}
+
+/**
+ * @brief Computes the length of a full row with a given number of bytes.
+ */
+static size_t full_row_len(const HexView* view, int bytes_per_row) {
+    size_t len = (size_t)view->offset_digits + 2;                           // "OFFSET: "
+    len += (size_t)bytes_per_row * 2 + bytes_per_row / view->layout.group_size; // Hex digits and a space per group
+    len += 2 + (size_t)bytes_per_row;                                       // " |" and the ASCII column
+    if (view->layout.endian != HEX_ENDIAN_NONE) {
+        int words = bytes_per_row / word_size(view);
+        len += 1 + (size_t)words * (1 + word_digits(word_size(view)));      // "|" and " VALUE" per word
     }
+    return len;
+}
 
-    // Read through the file until EOF.
-    while ((bytes_read = fread(buffer, 1, sizeof(buffer), f)) > 0) {
-        int len = 0; // Current position in line_buffer.
+/**
+ * @brief Recomputes the row count, the collapsed holes and the row width after the bytes per row changed.
+ *
+ * A hole is collapsed into the row of its first whole row of zeros; the
+ * partial rows at its edges hold data and are shown as they are.
+ */
+static void apply_layout(HexView* view, int bytes_per_row) {
+    view->bytes_per_row = bytes_per_row;
+    uint64_t rows = ((uint64_t)view->bytes.size + (uint64_t)bytes_per_row - 1) / (uint64_t)bytes_per_row;
+    uint64_t skipped = 0;
+    view->hole_row_count = 0;
+    for (size_t i = 0; view->hole_rows && i < view->bytes.hole_count; i++) {
+        const FileHole* hole = &view->bytes.holes[i];
+        uint64_t first = ((uint64_t)hole->offset + (uint64_t)bytes_per_row - 1) / (uint64_t)bytes_per_row;
+        uint64_t end = ((uint64_t)hole->offset + (uint64_t)hole->length) / (uint64_t)bytes_per_row;
+        if (end < first + 2) continue; // A row of zeros is as short as the row standing for it
 
-        // 1 - Format the offset at the beginning of the line.
-        len += snprintf(line_buffer + len, sizeof(line_buffer) - len, "%08lX: ", offset);
+        HexHoleRow* hole_row = &view->hole_rows[view->hole_row_count++];
+        hole_row->row = (size_t)(first - skipped);
+        hole_row->first_row = first;
+        hole_row->rows = end - first;
+        skipped += hole_row->rows - 1;
+    }
+    view->row_count = (size_t)(rows - skipped);
+    view->row_len = full_row_len(view, bytes_per_row);
+}
 
-        // 2 - Format the hexadecimal representation of the bytes.
-        for (size_t i = 0; i < 16; ++i) {
-            if (i < bytes_read) {
-                len += snprintf(line_buffer + len, sizeof(line_buffer) - len, "%02X ", buffer[i]);
-            } else {
-                // Pad with spaces if the last chunk is less than 16 bytes.
-                len += snprintf(line_buffer + len, sizeof(line_buffer) - len, "   ");
-            }
+/**
+ * @brief Finds the last collapsed hole shown at or before a row, or NULL.
+ */
+static const HexHoleRow* hole_row_at_or_before(const HexView* view, size_t row) {
+    size_t low = 0, high = view->hole_row_count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (view->hole_rows[mid].row <= row) low = mid + 1; else high = mid;
+    }
+    return low > 0 ? &view->hole_rows[low - 1] : NULL;
+}
+
+/**
+ * @brief Returns the row a row would be if no hole were collapsed, and the hole it stands for, if any.
+ */
+static uint64_t uncollapsed_row(const HexView* view, size_t row, const HexHoleRow** hole) {
+    const HexHoleRow* before = hole_row_at_or_before(view, row);
+    *hole = before && before->row == row ? before : NULL;
+    if (!before) return row;
+    if (before->row == row) return before->first_row;
+    return (uint64_t)row + (before->first_row - before->row) + before->rows - 1;
+}
+
+/**
+ * @brief Maps a file for hex viewing.
+ */
+FatResult hex_view_open(HexView* view, const char* filepath, const HexLayout* layout) {
+    memset(view, 0, sizeof(*view));
+    FatResult res = line_index_load(&view->bytes, filepath);
+    if (res != FAT_SUCCESS) {
+        LOG_INFO("Could not open file '%s' for hex dump", filepath);
+        return res;
+    }
+
+    view->layout = *layout;
+    if (layout->collapse_holes && view->bytes.hole_count > 0) {
+        view->hole_rows = malloc(view->bytes.hole_count * sizeof(HexHoleRow));
+        if (!view->hole_rows) LOG_INFO("Could not collapse the holes of '%s'; showing them in full", filepath);
+    }
+    if (view->layout.group_size != 2 && view->layout.group_size != 4 && view->layout.group_size != 8) {
+        view->layout.group_size = 1;
+    }
+    int bytes_per_row = layout->bytes_per_row;
+    if (bytes_per_row != 8 && bytes_per_row != 32) bytes_per_row = 16;
+    if (bytes_per_row < view->layout.group_size) view->layout.group_size = bytes_per_row;
+
+    // Offsets keep eight digits up to 4 GB and grow beyond, up to the full 64 bits.
+    uint64_t last = view->bytes.size > 0 ? (uint64_t)view->bytes.size - 1 : 0;
+    view->offset_digits = 8;
+    while (view->offset_digits < 16 && (last >> (view->offset_digits * 4)) != 0) view->offset_digits++;
+
+    apply_layout(view, bytes_per_row);
+    return FAT_SUCCESS;
+}
+
+/**
+ * @brief Picks the widest row that fits when the layout adapts to the pane.
+ */
+bool hex_view_fit(HexView* view, int width) {
+    if (view->layout.bytes_per_row != 0) return false;
+    int bytes_per_row = FIT_WIDTHS[sizeof(FIT_WIDTHS) / sizeof(FIT_WIDTHS[0]) - 1];
+    for (size_t i = 0; i < sizeof(FIT_WIDTHS) / sizeof(FIT_WIDTHS[0]); i++) {
+        if (FIT_WIDTHS[i] >= view->layout.group_size && full_row_len(view, FIT_WIDTHS[i]) <= (size_t)width) {
+            bytes_per_row = FIT_WIDTHS[i];
+            break;
         }
+    }
+    if (bytes_per_row == view->bytes_per_row) return false;
+    apply_layout(view, bytes_per_row);
+    return true;
+}
+
+/**
+ * @brief Formats a row of the dump.
+ */
+size_t hex_view_format_row(const HexView* view, size_t row, char* out) {
+    if (row >= view->row_count) {
+        out[0] = '\0';
+        return 0;
+    }
+    const HexHoleRow* hole;
+    size_t bytes_per_row = (size_t)view->bytes_per_row;
+    size_t offset = (size_t)uncollapsed_row(view, row, &hole) * bytes_per_row;
+    size_t count = view->bytes.size - offset < bytes_per_row ? view->bytes.size - offset : bytes_per_row;
+    const unsigned char* bytes = (const unsigned char*)view->bytes.data + offset;
+    size_t group_size = (size_t)view->layout.group_size;
+    char* p = out;
 
-        // 3 - Add a separator between the hex and ASCII sections.
-        len += snprintf(line_buffer + len, sizeof(line_buffer) - len, " |");
+    // 1 - The offset, one nibble at a time.
+    for (int shift = (view->offset_digits - 1) * 4; shift >= 0; shift -= 4) {
+        *p++ = HEX_PAIRS[(((uint64_t)offset >> shift) & 0xf) * 2 + 1];
+    }
+    *p++ = ':';
+    *p++ = ' ';
+
+    // A collapsed hole is only its size, in ASCII like every other row.
+    if (hole) {
+        int len = snprintf(p, HEX_ROW_MAX_BYTES - (size_t)(p - out), "... %llu zero bytes ...",
+                           (unsigned long long)(hole->rows * bytes_per_row));
+        return (size_t)(p - out) + (size_t)len;
+    }
 
-        // 4 - Format the ASCII representation of the bytes.
-        for (size_t i = 0; i < bytes_read; ++i) {
-            // Use '.' for non-printable characters.
-            len += snprintf(line_buffer + len, sizeof(line_buffer) - len, "%c", isprint(buffer[i]) ? buffer[i] : '.');
+    // 2 - The hex digits, a space after each group; missing bytes of the last row are blank.
+    for (size_t i = 0; i < bytes_per_row; i++) {
+        if (i < count) {
+            memcpy(p, &HEX_PAIRS[bytes[i] * 2], 2);
+        } else {
+            p[0] = p[1] = ' ';
         }
+        p += 2;
+        if ((i + 1) % group_size == 0) *p++ = ' ';
+    }
+
+    // 3 - The ASCII column, with '.' for anything that is not printable.
+    *p++ = ' ';
+    *p++ = '|';
+    for (size_t i = 0; i < count; i++) {
+        *p++ = bytes[i] >= 0x20 && bytes[i] < 0x7f ? (char)bytes[i] : '.';
+    }
 
-        // Add the fully formatted line to our list.
-        if (StringList_add(dump_list, line_buffer) != FAT_SUCCESS) {
-            result = FAT_ERROR_MEMORY;
-            goto cleanup; // Use goto to ensure file is closed on error.
+    // 4 - The integer column, right-aligned unsigned decimal words.
+    if (view->layout.endian != HEX_ENDIAN_NONE) {
+        for (size_t i = count; i < bytes_per_row; i++) *p++ = ' ';
+        *p++ = '|';
+        size_t word = (size_t)word_size(view);
+        int digits = word_digits((int)word);
+        for (size_t start = 0; start + word <= bytes_per_row; start += word) {
+            *p++ = ' ';
+            char* field = p;
+            memset(field, ' ', (size_t)digits);
+            p += digits;
+            if (start + word > count) continue;
+
+            uint64_t value = 0;
+            for (size_t k = 0; k < word; k++) {
+                unsigned char b = view->layout.endian == HEX_ENDIAN_BIG ? bytes[start + k] : bytes[start + word - 1 - k];
+                value = value << 8 | b;
+            }
+            char* digit = p;
+            do {
+                *--digit = (char)('0' + value % 10);
+                value /= 10;
+            } while (value != 0 && digit > field);
         }
-        offset += bytes_read;
     }
 
-    // Check if the loop ended because of a read error.
-    if (ferror(f)) {
-        LOG_INFO("Error reading from file '%s' during hex dump: %s", filepath, strerror(errno));
-        result = FAT_ERROR_FILE_READ;
+    *p = '\0';
+    return (size_t)(p - out);
+}
+
+/**
+ * @brief Returns the offset of the first byte shown on a row.
+ */
+uint64_t hex_view_row_offset(const HexView* view, size_t row) {
+    const HexHoleRow* hole;
+    return uncollapsed_row(view, row, &hole) * (uint64_t)view->bytes_per_row;
+}
+
+/**
+ * @brief Returns the row showing the byte at an offset.
+ */
+size_t hex_view_offset_row(const HexView* view, uint64_t offset) {
+    uint64_t row = offset / (uint64_t)view->bytes_per_row;
+    size_t low = 0, high = view->hole_row_count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (view->hole_rows[mid].first_row <= row) low = mid + 1; else high = mid;
     }
+    if (low == 0) return (size_t)row;
+    const HexHoleRow* hole = &view->hole_rows[low - 1];
+    if (row < hole->first_row + hole->rows) return hole->row;
+    return (size_t)(row - (hole->first_row - hole->row) - (hole->rows - 1));
+}
 
-cleanup:
-    if (f) {
-        fclose(f);
+/**
+ * @brief Returns the column of a byte within a formatted row.
+ */
+int hex_view_byte_column(const HexView* view, int index, bool ascii) {
+    int column = view->offset_digits + 2;
+    if (ascii) return column + view->bytes_per_row * 2 + view->bytes_per_row / view->layout.group_size + 2 + index;
+    return column + index * 2 + index / view->layout.group_size;
+}
+
+/**
+ * @brief Formats a row into the view's scratch buffer.
+ */
+const char* hex_view_get_row(HexView* view, size_t row, size_t* len) {
+    if (row >= view->row_count) {
+        *len = 0;
+        return NULL;
     }
-    return result;
+    *len = hex_view_format_row(view, row, view->row);
+    return view->row;
+}
+
+/**
+ * @brief Returns the heap memory held by the view.
+ */
+size_t hex_view_memory_usage(const HexView* view) {
+    return line_index_memory_usage(&view->bytes) + view->hole_row_count * sizeof(HexHoleRow);
+}
+
+/**
+ * @brief Unmaps the file.
+ */
+void hex_view_free(HexView* view) {
+    free(view->hole_rows);
+    line_index_free(&view->bytes);
+    memset(view, 0, sizeof(*view));
 }
@@ -24,6 +24,12 @@
 #define MAX_PLUGINS 16
 /** @brief An array to store pointers to the loaded plugin interfaces. */
 static ArchivePlugin* loaded_plugins[MAX_PLUGINS];
+/** @brief The streaming reader of each loaded plugin, or NULL. */
+static ArchiveEntryReader loaded_readers[MAX_PLUGINS];
+/** @brief The recorded-CRC lookup of each loaded plugin, or NULL. */
+static ArchiveEntryCrc loaded_crcs[MAX_PLUGINS];
+/** @brief The functions to read many entries of an open archive, for each loaded plugin; zeroed if it has none. */
+static ArchiveSession loaded_sessions[MAX_PLUGINS];
 /** @brief The current number of loaded plugins. */
 static int num_plugins = 0;
 
@@ -81,6 +87,17 @@ void pm_load_plugins(const char* plugin_dir_path) {
                 FreeLibrary(handle);
                 continue;
             }
+
+            // The streaming reader and the CRC lookup are optional.
+            ArchiveEntryReader reader;
+            *(void**)(&reader) = (void*)GetProcAddress(handle, "plugin_read_entry");
+            ArchiveEntryCrc entry_crc;
+            *(void**)(&entry_crc) = (void*)GetProcAddress(handle, "plugin_entry_crc32");
+            // Reading many entries through one open archive takes all three, or none is used.
+            ArchiveSession session;
+            *(void**)(&session.open) = (void*)GetProcAddress(handle, "plugin_open_archive");
+            *(void**)(&session.read) = (void*)GetProcAddress(handle, "plugin_read_entry_at");
+            *(void**)(&session.close) = (void*)GetProcAddress(handle, "plugin_close_archive");
 #else
             // POSIX-specific library loading
             void* handle = dlopen(full_path, RTLD_LAZY);
@@ -98,6 +115,17 @@ void pm_load_plugins(const char* plugin_dir_path) {
                 dlclose(handle);
                 continue;
             }
+
+            // The streaming reader and the CRC lookup are optional.
+            ArchiveEntryReader reader;
+            *(void**)(&reader) = dlsym(handle, "plugin_read_entry");
+            ArchiveEntryCrc entry_crc;
+            *(void**)(&entry_crc) = dlsym(handle, "plugin_entry_crc32");
+            // Reading many entries through one open archive takes all three, or none is used.
+            ArchiveSession session;
+            *(void**)(&session.open) = dlsym(handle, "plugin_open_archive");
+            *(void**)(&session.read) = dlsym(handle, "plugin_read_entry_at");
+            *(void**)(&session.close) = dlsym(handle, "plugin_close_archive");
 #endif
             // Call the register function to get the plugin's interface struct.
             ArchivePlugin* new_plugin = reg_func();
@@ -113,6 +141,13 @@ void pm_load_plugins(const char* plugin_dir_path) {
             }
             
             loaded_plugins[num_plugins] = new_plugin;
+            loaded_readers[num_plugins] = reader;
+            loaded_crcs[num_plugins] = entry_crc;
+            if (session.open && session.read && session.close) {
+                loaded_sessions[num_plugins] = session;
+            } else {
+                memset(&loaded_sessions[num_plugins], 0, sizeof(ArchiveSession));
+            }
             LOG_INFO("Successfully loaded plugin: %s (from %s)", loaded_plugins[num_plugins]->plugin_name, full_path);
             num_plugins++;
         }
@@ -136,3 +171,51 @@ const ArchivePlugin* pm_get_handler(const char* filepath) {
     // If no plugin claims the file, return NULL.
     return NULL;
 }
+
+/**
+ * @brief Returns the streaming reader a plugin exports, if any.
+ *
+ * @param plugin A plugin returned by `pm_get_handler`.
+ * @return The plugin's reader, or NULL.
+ */
+ArchiveEntryReader pm_get_entry_reader(const ArchivePlugin* plugin) {
+    for (int i = 0; i < num_plugins; i++) {
+        if (loaded_plugins[i] == plugin) {
+            return loaded_readers[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Returns the recorded-CRC lookup a plugin exports, if any.
+ *
+ * @param plugin A plugin returned by `pm_get_handler`.
+ * @return The plugin's lookup, or NULL.
+ */
+ArchiveEntryCrc pm_get_entry_crc(const ArchivePlugin* plugin) {
+    for (int i = 0; i < num_plugins; i++) {
+        if (loaded_plugins[i] == plugin) {
+            return loaded_crcs[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Returns the functions a plugin exports to read many entries through one open archive, if any.
+ *
+ * @param plugin A plugin returned by `pm_get_handler`.
+ * @param session Set to the plugin's functions, or zeroed.
+ * @return True if the plugin exports them.
+ */
+bool pm_get_archive_session(const ArchivePlugin* plugin, ArchiveSession* session) {
+    memset(session, 0, sizeof(*session));
+    for (int i = 0; i < num_plugins; i++) {
+        if (loaded_plugins[i] == plugin) {
+            *session = loaded_sessions[i];
+            return session->open != NULL;
+        }
+    }
+    return false;
+}
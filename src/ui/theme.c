@@ -4,6 +4,7 @@
  * @brief Implements the logic for loading, applying, and discovering UI themes.
  */
 #include "ui/theme.h"
+#include "core/file_source.h"
 #include "utils/logger.h"
 #include "utils/cJSON.h"
 #include <stdio.h>
@@ -52,7 +53,6 @@ static void parse_theme_color(const cJSON* color_obj, ThemeColor* tc) {
  * @brief Loads a theme from a JSON file and creates a Theme struct.
  */
 FatResult theme_load(const char* filepath, Theme** out_theme) {
-    FILE* f = NULL;
     char* buffer = NULL;
     cJSON* json = NULL;
     Theme* theme = NULL;
@@ -60,27 +60,13 @@ FatResult theme_load(const char* filepath, Theme** out_theme) {
 
     *out_theme = NULL;
 
-    f = fopen(filepath, "rb");
-    if (!f) {
-        LOG_INFO("Could not open theme file '%s': %s", filepath, strerror(errno));
-        return FAT_ERROR_THEME_LOAD;
+    // Read in chunks rather than sized by seeking, so a theme may come from a pipe.
+    result = file_source_read_file(filepath, FILE_SOURCE_SETTINGS_LIMIT, &buffer, NULL);
+    if (result != FAT_SUCCESS) {
+        LOG_INFO("Could not read theme file '%s'", filepath);
+        return result == FAT_ERROR_MEMORY ? result : FAT_ERROR_THEME_LOAD;
     }
 
-    fseek(f, 0, SEEK_END);
-    long length = ftell(f);
-    fseek(f, 0, SEEK_SET);
-
-    buffer = malloc(length + 1);
-    if (!buffer) {
-        result = FAT_ERROR_MEMORY;
-        goto cleanup;
-    }
-    
-    if (fread(buffer, 1, length, f) != (size_t)length) {
-        LOG_INFO("Incomplete read of theme file '%s'", filepath);
-    }
-    buffer[length] = '\0';
-
     json = cJSON_Parse(buffer);
     if (!json) {
         LOG_INFO("Error parsing theme file '%s': %s", filepath, cJSON_GetErrorPtr());
@@ -96,7 +82,8 @@ FatResult theme_load(const char* filepath, Theme** out_theme) {
 
     const char* element_names[THEME_ELEMENT_COUNT] = {
         "border", "title", "metadata_label", "line_num", "statusbar",
-        "search_highlight", "help_border", "help_key"
+        "search_highlight", "help_border", "help_key", "diff_removed", "diff_added",
+        "pin_1", "pin_2", "pin_3", "pin_4"
     };
 
     cJSON* name_json = cJSON_GetObjectItemCaseSensitive(json, "name");
@@ -113,12 +100,29 @@ FatResult theme_load(const char* filepath, Theme** out_theme) {
         }
     }
 
+    // Themes written before the diff view existed still get readable hunks.
+    if (theme->colors[THEME_ELEMENT_DIFF_REMOVED].fg == -1 && theme->colors[THEME_ELEMENT_DIFF_REMOVED].bg == -1) {
+        theme->colors[THEME_ELEMENT_DIFF_REMOVED].fg = COLOR_RED;
+    }
+    if (theme->colors[THEME_ELEMENT_DIFF_ADDED].fg == -1 && theme->colors[THEME_ELEMENT_DIFF_ADDED].bg == -1) {
+        theme->colors[THEME_ELEMENT_DIFF_ADDED].fg = COLOR_GREEN;
+    }
+
+    // Likewise for pinned terms, which are told apart by their background.
+    static const short pin_backgrounds[] = { COLOR_CYAN, COLOR_MAGENTA, COLOR_GREEN, COLOR_RED };
+    for (int i = 0; i < 4; i++) {
+        ThemeColor* pin = &theme->colors[THEME_ELEMENT_PIN_1 + i];
+        if (pin->fg == -1 && pin->bg == -1) {
+            pin->fg = COLOR_BLACK;
+            pin->bg = pin_backgrounds[i];
+        }
+    }
+
     *out_theme = theme;
     theme = NULL;
 
 cleanup:
     free(buffer);
-    if (f) fclose(f);
     if (json) cJSON_Delete(json);
     if (theme) theme_free(theme);
     return result;
@@ -10,12 +10,14 @@
 #include "ui/ui.h"
 #include "ui/theme.h"
 #include "core/error.h"
+#include "plugins/hex_viewer_api.h"
 #include "utils/utf8_utils.h"
 #include <string.h>
 #include <ctype.h>
 #include <stdlib.h>
 #include <math.h>
 #include <stdio.h>
+#include <time.h>
 
 /**
  * @brief Color pair definition for window borders.
@@ -49,14 +51,52 @@
  * @brief Color pair definition for help key text.
  */
 #define COLOR_PAIR_HELP_KEY        (THEME_ELEMENT_HELP_KEY + 1)
+/**
+ * @brief Color pair definition for lines only in the left file of a diff.
+ */
+#define COLOR_PAIR_DIFF_REMOVED    (THEME_ELEMENT_DIFF_REMOVED + 1)
+/**
+ * @brief Color pair definition for lines only in the right file of a diff.
+ */
+#define COLOR_PAIR_DIFF_ADDED      (THEME_ELEMENT_DIFF_ADDED + 1)
+/**
+ * @brief Color pair definition for the first pinned term; the next three follow it.
+ */
+#define COLOR_PAIR_PIN_1           (THEME_ELEMENT_PIN_1 + 1)
+/**
+ * @brief The color pair of a pinned term, cycling through the four pin colors.
+ */
+#define COLOR_PAIR_PIN(term)       (COLOR_PAIR_PIN_1 + (int)(term) % 4)
 
 // Private Helper Function Prototypes
 // (Detailed info for these functions will be with their definitions)
 static void draw_metadata_pane(WINDOW* win, const StringList* metadata);
+static void draw_section_list(WINDOW* win, const AppState* state);
 static void draw_content_pane(WINDOW* win, const AppState* state);
 static void draw_statusbar(const AppState *state);
+static void draw_buffer_tabs(WINDOW* win, const AppState* state, int max_x);
+static void draw_diff_pane(WINDOW* win, const AppState* state);
+static void draw_directory_pane(WINDOW* win, const AppState* state);
+static void draw_table_pane(WINDOW* win, const AppState* state);
+static void draw_scrollbar(WINDOW* win, const AppState* state);
 static void print_segment(WINDOW* win, int y, int x, const char* text, int len,
                    bool is_active, bool is_highlight, bool is_current_match);
+static void print_marked_segment(WINDOW* win, int y, int x, const char* text, int len,
+                                 bool is_active, const unsigned char* marks);
+static void draw_pinned_terms(WINDOW* win, const AppState* state);
+static int pinned_terms_height(const AppState* state);
+static void draw_timeline(WINDOW* win, const AppState* state);
+static void draw_byte_map(WINDOW* win, const AppState* state);
+static int byte_map_layout(const AppState* state, int* title_y);
+static void draw_checksums(WINDOW* win, const AppState* state);
+static int info_height(const AppState* state);
+static void format_size(uint64_t size, char* out, size_t out_size);
+
+/** @brief The rows of the timeline's bars; each row resolves eight levels. */
+#define TIMELINE_BAR_ROWS 3
+
+/** @brief The rows the timeline takes: title, separator, bars, time axis and the column at the top line. */
+#define TIMELINE_HEIGHT (TIMELINE_BAR_ROWS + 4)
 
 /**
  * @brief Calculates the number of displayable characters and corresponding bytes for a given screen width.
@@ -117,6 +157,81 @@ static int get_char_len_from_bytes(const char* text, int max_bytes) {
 }
 
 
+/**
+ * @brief Scratch buffer used to null-terminate lines that point into file data.
+ */
+static char* line_buffer = NULL;
+static size_t line_buffer_capacity = 0;
+
+/**
+ * @brief Copies a line that is not null-terminated into the scratch buffer.
+ *
+ * @param line The first byte of the line.
+ * @param len The length of the line in bytes.
+ * @return A null-terminated copy valid until the next call, or "" on failure.
+ */
+static const char* terminate_line(const char* line, size_t len) {
+    if (len + 1 > line_buffer_capacity) {
+        size_t new_capacity = line_buffer_capacity == 0 ? 256 : line_buffer_capacity;
+        while (new_capacity < len + 1) new_capacity *= 2;
+        char* new_buffer = realloc(line_buffer, new_capacity);
+        if (!new_buffer) return "";
+        line_buffer = new_buffer;
+        line_buffer_capacity = new_capacity;
+    }
+    memcpy(line_buffer, line, len);
+    line_buffer[len] = '\0';
+    return line_buffer;
+}
+
+/**
+ * @brief Scratch buffer holding, for each byte of the line being drawn, the pinned term covering it.
+ */
+static unsigned char* pin_marks = NULL;
+static size_t pin_marks_capacity = 0;
+
+/**
+ * @brief Marks the bytes of a line covered by pinned terms.
+ *
+ * @param state A read-only pointer to the current application state.
+ * @param line The null-terminated line.
+ * @return 1 + the index of the pinned term covering each byte, or 0, valid
+ *         until the next call; NULL if no pinned term occurs in the line.
+ */
+static const unsigned char* mark_pinned_terms(const AppState* state, const char* line) {
+    if (state->pins.terms.count == 0) return NULL;
+    size_t len = strlen(line);
+    // Padded so a truncated multi-byte character at the end reads zeros.
+    if (len + 4 > pin_marks_capacity) {
+        size_t new_capacity = pin_marks_capacity == 0 ? 256 : pin_marks_capacity;
+        while (new_capacity < len + 4) new_capacity *= 2;
+        unsigned char* new_marks = realloc(pin_marks, new_capacity);
+        if (!new_marks) return NULL;
+        pin_marks = new_marks;
+        pin_marks_capacity = new_capacity;
+    }
+    memset(pin_marks + len, 0, 4);
+    return multi_match_mark(&state->pins.matcher, line, len, pin_marks) ? pin_marks : NULL;
+}
+
+/**
+ * @brief Returns a line of the current view as a null-terminated string.
+ *
+ * Text lines point straight into the file and are not terminated, so they are
+ * copied into a scratch buffer that is reused for every line drawn.
+ *
+ * @param state A read-only pointer to the current application state.
+ * @param idx The zero-based line index.
+ * @return A null-terminated string valid until the next call, or "" on failure.
+ */
+static const char* get_terminated_line(const AppState* state, size_t idx) {
+    size_t len;
+    const char* line = state_get_line(state, idx, &len);
+    if (!line) return "";
+    if (state->view_mode != VIEW_MODE_NORMAL && state->view_mode != VIEW_MODE_JSON) return line; // Already null-terminated
+    return terminate_line(line, len);
+}
+
 // **Public API Functions**
 
 /**
@@ -145,6 +260,9 @@ void ui_init() {
  */
 void ui_destroy() {
     endwin();
+    free(line_buffer);
+    line_buffer = NULL;
+    line_buffer_capacity = 0;
 }
 
 /**
@@ -158,6 +276,16 @@ void ui_destroy() {
  */
 void ui_draw(const AppState *state) {
     draw_metadata_pane(state->left_pane, &state->metadata);
+    if (state->checksums) draw_checksums(state->left_pane, state);
+    if (state->view_mode == VIEW_MODE_BINARY_HEX && state->hex && state->binary) draw_section_list(state->left_pane, state);
+    if (state->view_mode == VIEW_MODE_BINARY_HEX && state->byte_map) draw_byte_map(state->left_pane, state);
+    if (state->pins.terms.count > 0 && (state->view_mode == VIEW_MODE_NORMAL || state->view_mode == VIEW_MODE_BINARY_HEX ||
+                                        state->view_mode == VIEW_MODE_JSON)) {
+        draw_pinned_terms(state->left_pane, state);
+    }
+    if (state->show_timeline && state->view_mode == VIEW_MODE_NORMAL && !state->archive_grep) {
+        draw_timeline(state->left_pane, state);
+    }
     draw_content_pane(state->right_pane, state);
     draw_statusbar(state);
     doupdate(); // Update the physical screen with all changes
@@ -278,6 +406,13 @@ void ui_show_help(const AppState* state) {
     switch (state->view_mode) {
         case VIEW_MODE_ARCHIVE:     current_mode_str = "archive"; break;
         case VIEW_MODE_BINARY_HEX:  current_mode_str = "binary";  break;
+        case VIEW_MODE_DIFF:
+        case VIEW_MODE_HEX_DIFF:    current_mode_str = "diff";    break;
+        case VIEW_MODE_DIRECTORY:   current_mode_str = "directory"; break;
+        case VIEW_MODE_GREP:        current_mode_str = "grep";    break;
+        case VIEW_MODE_JSON:        current_mode_str = "json";    break;
+        case VIEW_MODE_TABLE:       current_mode_str = "table";   break;
+        case VIEW_MODE_STRINGS:     current_mode_str = "strings"; break;
         default:                    current_mode_str = "normal";  break;
     }
 
@@ -364,13 +499,19 @@ void ui_show_help(const AppState* state) {
 }
 
 
+/** @brief The time spent scanning for matches between checks for the next keystroke. */
+#define SEARCH_INPUT_BUDGET_MS 30
+
 /**
- * @brief Gets search input from the user via the status bar.
+ * @brief Gets search input from the user via the status bar, searching as they type.
  *
  * This function switches the application to search input mode, displays a prompt
- * in the status bar, and captures user input for a search term. It handles
- * backspace, printable characters, and termination by Enter or Escape.
- * The cursor is made visible during input.
+ * in the status bar, and captures user input for a search term. Every keystroke
+ * updates the search: matches are highlighted and the nearest one after the
+ * line the search started from is scrolled to. Lines are scanned in short
+ * slices between keystrokes, so typing never waits for a large file. Enter
+ * keeps the search, and anything left to scan continues in the background;
+ * Escape clears it and returns to where the search started.
  *
  * @param state A pointer to the application state, where the search term will be stored.
  */
@@ -380,38 +521,47 @@ void ui_get_search_input(AppState *state) {
     strncpy(temp_buffer, state->search_term, sizeof(temp_buffer) - 1); // Pre-fill with existing search term
 
     int pos = (int)strlen(temp_buffer); // Current cursor position in the buffer
+    int origin_top_line = state->top_line;
 
     state->mode = MODE_SEARCH_INPUT;
-    ui_draw(state); // Redraw to show search input mode in status bar
-
     curs_set(1); // Show cursor
     keypad(bar, TRUE); // Enable keypad for the status bar window
+    bool term_changed = true;
     int ch;
     while (1) {
-        mvwprintw(bar, 0, 9, "%-s", temp_buffer); // Display current buffer content
-        wclrtoeol(bar); // Clear to end of line
-        wmove(bar, 0, 9 + pos); // Move cursor to current input position
+        if (term_changed) {
+            state_search_update(state, temp_buffer, (size_t)origin_top_line);
+            if (!state->search_term_active) state->top_line = origin_top_line;
+            term_changed = false;
+        }
+        state_search_step(state, SEARCH_INPUT_BUDGET_MS);
+        ui_draw(state); // The status bar shows the term being typed
+        wmove(bar, 0, 10 + pos); // Move cursor to current input position
+        wrefresh(bar);
 
+        // Keep scanning while no key is waiting.
+        wtimeout(bar, state->search_results.is_scanning ? 0 : -1);
         ch = wgetch(bar); // Get character from status bar window
+        if (ch == ERR) continue;
         if (ch == '\n' || ch == KEY_ENTER) break; // Enter key confirms input
         if (ch == 27) { // Escape key cancels input
-            temp_buffer[0] = '\0'; // Clear search term
+            state_clear_search(state);
+            state->top_line = origin_top_line;
             break;
         }
         if (ch == KEY_BACKSPACE || ch == 127 || ch == '\b') { // Handle backspace
-            if (pos > 0) { pos--; temp_buffer[pos] = '\0'; }
+            if (pos > 0) { pos--; temp_buffer[pos] = '\0'; term_changed = true; }
         } else if (isprint(ch) && (size_t)pos < (sizeof(temp_buffer) - 1)) { // Handle printable characters
             temp_buffer[pos] = (char)ch;
             pos++;
             temp_buffer[pos] = '\0';
+            term_changed = true;
         }
     }
+    wtimeout(bar, -1);
     curs_set(0); // Hide cursor
     keypad(bar, FALSE); // Disable keypad for the status bar window
     state->mode = MODE_NORMAL; // Revert to normal mode
-    strncpy(state->search_term, temp_buffer, sizeof(state->search_term) - 1); // Copy input to app state
-    state->search_term[sizeof(state->search_term) - 1] = '\0'; // Ensure null-termination
-    state->search_term_active = (state->search_term[0] != '\0');
 }
 
 /**
@@ -452,6 +602,49 @@ void ui_get_command_input(AppState *state, char* buffer, size_t buffer_size) {
     state->mode = MODE_NORMAL;
 }
 
+/**
+ * @brief Gets a filter expression from the user via the status bar.
+ */
+bool ui_get_filter_input(AppState *state, char* buffer, size_t buffer_size) {
+    WINDOW *bar = state->status_bar;
+    buffer[0] = '\0';
+    if (state->filter) {
+        strncpy(buffer, state->filter->text, buffer_size - 1);
+        buffer[buffer_size - 1] = '\0';
+    }
+    int pos = (int)strlen(buffer);
+
+    state->mode = MODE_FILTER_INPUT;
+    ui_draw(state); // Redraw to show filter input mode
+
+    curs_set(1);
+    keypad(bar, TRUE);
+    bool confirmed = false;
+    int ch;
+    while (1) {
+        mvwprintw(bar, 0, 10, "&%-s", buffer);
+        wclrtoeol(bar);
+        wmove(bar, 0, 11 + pos);
+
+        ch = wgetch(bar);
+        if (ch == '\n' || ch == KEY_ENTER) {
+            confirmed = true;
+            break;
+        }
+        if (ch == 27) break; // Escape keeps the current filter
+        if (ch == KEY_BACKSPACE || ch == 127 || ch == '\b') {
+            if (pos > 0) { pos--; buffer[pos] = '\0'; }
+        } else if (isprint(ch) && (size_t)pos < (buffer_size - 1)) {
+            buffer[pos] = (char)ch;
+            pos++;
+            buffer[pos] = '\0';
+        }
+    }
+    curs_set(0);
+    keypad(bar, FALSE);
+    state->mode = MODE_NORMAL;
+    return confirmed;
+}
 
 /**
  * @brief Gets a line number from the user via the status bar.
@@ -505,6 +698,91 @@ int ui_get_line_input(AppState *state) {
     return -1; // No number entered
 }
 
+/**
+ * @brief Reads a line of text in the status bar after a bracketed label.
+ *
+ * The input starts out as `initial`, if it is not NULL.
+ */
+static bool get_text_input(AppState *state, const char* label, const char* initial, char* buffer, size_t buffer_size) {
+    WINDOW *bar = state->status_bar;
+    buffer[0] = '\0';
+    if (initial) {
+        strncpy(buffer, initial, buffer_size - 1);
+        buffer[buffer_size - 1] = '\0';
+    }
+    int pos = (int)strlen(buffer);
+    int input_x = (int)strlen(label) + 3;
+
+    wbkgd(bar, COLOR_PAIR(COLOR_PAIR_STATUSBAR));
+    werase(bar);
+    wattron(bar, A_BOLD);
+    mvwprintw(bar, 0, 1, "%s", label);
+    wattroff(bar, A_BOLD);
+    wrefresh(bar);
+
+    curs_set(1);
+    keypad(bar, TRUE);
+    bool confirmed = false;
+    int ch;
+    while (1) {
+        mvwprintw(bar, 0, input_x, "%-s", buffer);
+        wclrtoeol(bar);
+        wmove(bar, 0, input_x + pos);
+
+        ch = wgetch(bar);
+        if (ch == '\n' || ch == KEY_ENTER) {
+            confirmed = buffer[0] != '\0';
+            break;
+        }
+        if (ch == 27) break; // Escape cancels
+        if (ch == KEY_BACKSPACE || ch == 127 || ch == '\b') {
+            if (pos > 0) { pos--; buffer[pos] = '\0'; }
+        } else if (isprint(ch) && (size_t)pos < (buffer_size - 1)) {
+            buffer[pos] = (char)ch;
+            pos++;
+            buffer[pos] = '\0';
+        }
+    }
+    curs_set(0);
+    keypad(bar, FALSE);
+    return confirmed;
+}
+
+/**
+ * @brief Gets a column number or name from the user via the status bar.
+ */
+bool ui_get_column_input(AppState *state, char* buffer, size_t buffer_size) {
+    return get_text_input(state, "[GO TO COLUMN]", NULL, buffer, buffer_size);
+}
+
+/**
+ * @brief Gets a symbol name from the user via the status bar.
+ */
+bool ui_get_symbol_input(AppState *state, char* buffer, size_t buffer_size) {
+    return get_text_input(state, "[FIND SYMBOL]", NULL, buffer, buffer_size);
+}
+
+/**
+ * @brief Gets a time to jump to from the user via the status bar.
+ */
+bool ui_get_time_input(AppState *state, char* buffer, size_t buffer_size) {
+    return get_text_input(state, "[GO TO TIME]", NULL, buffer, buffer_size);
+}
+
+/**
+ * @brief Gets a term to pin or unpin from the user via the status bar.
+ */
+bool ui_get_pin_input(AppState *state, char* buffer, size_t buffer_size) {
+    return get_text_input(state, "[PIN]", state->search_term_active ? state->search_term : NULL, buffer, buffer_size);
+}
+
+/**
+ * @brief Gets a term to search the entries of an archive for from the user via the status bar.
+ */
+bool ui_get_grep_input(AppState *state, char* buffer, size_t buffer_size) {
+    return get_text_input(state, "[GREP]", state->archive_grep ? state->archive_grep->term : NULL, buffer, buffer_size);
+}
+
 /**
  * @brief Displays a theme selection menu to the user.
  *
@@ -572,6 +850,151 @@ end_loop:
     return choice;
 }
 
+/**
+ * @brief Displays a modal list of the open buffers and lets the user pick one.
+ */
+int ui_show_buffer_list(const AppState* state) {
+    if (state->buffer_count < 2) {
+        ui_show_message(state, "Only one file is open.");
+        return -1;
+    }
+
+    int height, width; getmaxyx(stdscr, height, width);
+    size_t count = state->buffer_count;
+    int list_h = (int)((count < 10) ? count + 4 : 14);
+    if (list_h > height - 4) list_h = height - 4;
+    int list_w = width > 64 ? 60 : width - 4;
+    int start_y = (height - list_h) / 2;
+    int start_x = (width - list_w) / 2;
+
+    WINDOW* win = newwin(list_h, list_w, start_y, start_x);
+    keypad(win, TRUE);
+    wbkgd(win, COLOR_PAIR(COLOR_PAIR_STATUSBAR));
+    box(win, 0, 0);
+
+    mvwprintw(win, 1, (list_w - 12) / 2, "Open Buffers");
+
+    int visible = list_h - 3; // Rows between the title and the bottom border
+    if (visible < 1) visible = 1;
+    int current_selection = (int)state->active_buffer;
+    int first_row = 0;
+    int choice = -1;
+    int ch;
+
+    while(1) {
+        // Keep the selection inside the visible rows
+        if (current_selection < first_row) first_row = current_selection;
+        if (current_selection >= first_row + visible) first_row = current_selection - visible + 1;
+
+        for (int row = 0; row < visible; row++) {
+            size_t i = (size_t)(first_row + row);
+            wmove(win, row + 2, 1);
+            wclrtoeol(win);
+            if (i >= count) continue;
+
+            const char* status;
+            if (i == state->active_buffer) status = "active";
+            else if (!state->buffers[i].is_loaded) status = "not loaded";
+            else if (state->buffers[i].is_evicted) status = "evicted";
+            else status = "indexed";
+
+            if ((int)i == current_selection) wattron(win, A_REVERSE);
+            mvwprintw(win, row + 2, 2, "%2zu %-*.*s %10s", i + 1, list_w - 19, list_w - 19,
+                      state_buffer_path(state, i), status);
+            if ((int)i == current_selection) wattroff(win, A_REVERSE);
+        }
+        box(win, 0, 0);
+        mvwprintw(win, 1, (list_w - 12) / 2, "Open Buffers");
+        wrefresh(win);
+
+        ch = wgetch(win);
+        switch(ch) {
+            case KEY_UP: current_selection = (current_selection - 1 + (int)count) % (int)count; break;
+            case KEY_DOWN: current_selection = (current_selection + 1) % (int)count; break;
+            case '\n': case KEY_ENTER: choice = current_selection; goto end_loop;
+            case 'q': case 27: choice = -1; goto end_loop;
+        }
+    }
+
+end_loop:
+    delwin(win);
+    touchwin(stdscr);
+    wnoutrefresh(stdscr);
+    doupdate();
+    return choice;
+}
+
+/**
+ * @brief Displays a modal list of the sections and segments of an executable and lets the user pick one.
+ */
+int ui_show_section_list(const AppState* state) {
+    if (!state->hex || !state->binary || state->binary->section_count == 0) {
+        ui_show_message(state, "No sections to list.");
+        return -1;
+    }
+
+    const BinaryFormat* binary = state->binary;
+    int height, width; getmaxyx(stdscr, height, width);
+    size_t count = binary->section_count;
+    int list_h = (int)((count < 16) ? count + 4 : 20);
+    if (list_h > height - 4) list_h = height - 4;
+    int list_w = width > 76 ? 72 : width - 4;
+    int start_y = (height - list_h) / 2;
+    int start_x = (width - list_w) / 2;
+    int title_len = (int)strlen(binary->description);
+
+    WINDOW* win = newwin(list_h, list_w, start_y, start_x);
+    keypad(win, TRUE);
+    wbkgd(win, COLOR_PAIR(COLOR_PAIR_STATUSBAR));
+
+    int visible = list_h - 3; // Rows between the title and the bottom border
+    if (visible < 1) visible = 1;
+    size_t top_line = state_line_count(state) > 0 ? state_line_number(state, (size_t)state->top_line) : 0;
+    int current_selection = binary_format_section_at(binary, hex_view_row_offset(state->hex, top_line));
+    if (current_selection < 0) current_selection = 0;
+    int first_row = 0;
+    int choice = -1;
+    int ch;
+
+    while(1) {
+        // Keep the selection inside the visible rows
+        if (current_selection < first_row) first_row = current_selection;
+        if (current_selection >= first_row + visible) first_row = current_selection - visible + 1;
+
+        for (int row = 0; row < visible; row++) {
+            size_t i = (size_t)(first_row + row);
+            wmove(win, row + 2, 1);
+            wclrtoeol(win);
+            if (i >= count) continue;
+
+            const BinarySection* section = &binary->sections[i];
+            if ((int)i == current_selection) wattron(win, A_REVERSE);
+            mvwprintw(win, row + 2, 2, "%c %-*.*s %10llX %10llX %12llX", section->is_segment ? '*' : ' ',
+                      list_w - 41, list_w - 41, section->name, (unsigned long long)section->offset,
+                      (unsigned long long)section->size, (unsigned long long)section->address);
+            if ((int)i == current_selection) wattroff(win, A_REVERSE);
+        }
+        box(win, 0, 0);
+        mvwprintw(win, 1, title_len < list_w - 4 ? (list_w - title_len) / 2 : 2, "%.*s", list_w - 4, binary->description);
+        wrefresh(win);
+
+        ch = wgetch(win);
+        switch(ch) {
+            case KEY_UP: current_selection = (current_selection - 1 + (int)count) % (int)count; break;
+            case KEY_DOWN: current_selection = (current_selection + 1) % (int)count; break;
+            case '\n': case KEY_ENTER: choice = current_selection; goto end_loop;
+            case 'q': case 27: choice = -1; goto end_loop;
+        }
+    }
+
+end_loop:
+    delwin(win);
+    touchwin(stdscr);
+    wnoutrefresh(stdscr);
+    doupdate();
+    return choice;
+}
+
 /**
  * @brief Helper to print a segment of a line with various attributes.
  *
@@ -601,9 +1024,31 @@ static void print_segment(WINDOW* win, int y, int x, const char* text, int len,
         if (is_current_match) wattron(win, A_BOLD); // Apply bold for current match
     }
 
-    // Pass 'len' directly as the number of characters to print.
-    // ncurses handles UTF-8 characters correctly with mvwaddnstr when given character count.
-    mvwaddnstr(win, y, x, text, len);
+    const char* ptr = text;
+    int chars = 0;
+    while (chars < len && *ptr != '\0' && utf8_char_is_valid(ptr)) {
+        ptr += utf8_char_len(ptr);
+        chars++;
+    }
+    if (chars == len || *ptr == '\0') {
+        // Pass 'len' directly as the number of characters to print.
+        // ncurses handles UTF-8 characters correctly with mvwaddnstr when given character count.
+        mvwaddnstr(win, y, x, text, len);
+    } else {
+        // Text read as UTF-8 may still hold a stray invalid byte; draw each such character as U+FFFD.
+        wmove(win, y, x);
+        ptr = text;
+        for (chars = 0; chars < len && *ptr != '\0'; chars++) {
+            // An invalid character ends at its first bad byte, so what follows it is drawn as it is.
+            int char_len = utf8_char_len(ptr);
+            if (utf8_char_is_valid(ptr)) {
+                waddnstr(win, ptr, char_len);
+            } else {
+                waddstr(win, "\xEF\xBF\xBD");
+            }
+            ptr += char_len;
+        }
+    }
 
     // Turn off attributes in reverse order of application
     if (is_highlight) {
@@ -613,6 +1058,42 @@ static void print_segment(WINDOW* win, int y, int x, const char* text, int len,
     if (is_active) wattroff(win, A_REVERSE);
 }
 
+/**
+ * @brief Prints a segment of a line, coloring the runs covered by pinned terms.
+ *
+ * @param win The ncurses window to print to.
+ * @param y The y-coordinate (row) to start printing.
+ * @param x The x-coordinate (column) to start printing.
+ * @param text The string to print.
+ * @param len The number of characters (not bytes) to print from the text.
+ * @param is_active True if the line is the currently active line (for reverse video).
+ * @param marks The pinned term marks of the bytes of `text`, from `mark_pinned_terms`, or NULL.
+ */
+static void print_marked_segment(WINDOW* win, int y, int x, const char* text, int len,
+                                 bool is_active, const unsigned char* marks) {
+    if (!marks) {
+        print_segment(win, y, x, text, len, is_active, false, false);
+        return;
+    }
+    while (len > 0 && *text != '\0') {
+        // The run of characters covered by the same term, or by none.
+        unsigned char mark = *marks;
+        const char* run = text;
+        int run_chars = 0;
+        while (run_chars < len && *text != '\0' && *marks == mark) {
+            int char_len = utf8_char_len(text);
+            text += char_len;
+            marks += char_len;
+            run_chars++;
+        }
+        if (mark) wattron(win, COLOR_PAIR(COLOR_PAIR_PIN(mark - 1)));
+        print_segment(win, y, x, run, run_chars, is_active, false, false);
+        if (mark) wattroff(win, COLOR_PAIR(COLOR_PAIR_PIN(mark - 1)));
+        x += run_chars;
+        len -= run_chars;
+    }
+}
+
 
 /**
  * @brief Draws the left pane with file metadata, truncating long lines.
@@ -677,6 +1158,393 @@ static void draw_metadata_pane(WINDOW* win, const StringList* metadata) {
     wnoutrefresh(win); // Mark window for refresh
 }
 
+/**
+ * @brief Returns the label of a checksum, with the instructions that compute it when they are accelerated.
+ */
+static void checksum_label(ChecksumKind kind, char* out, size_t out_size) {
+    const char* acceleration = checksum_kind_acceleration(kind);
+    if (acceleration) {
+        snprintf(out, out_size, "%s (%s)", checksum_kind_name(kind), acceleration);
+    } else {
+        snprintf(out, out_size, "%s", checksum_kind_name(kind));
+    }
+}
+
+/**
+ * @brief Returns the rows a checksum takes: one if its digest fits after the label, else the label and the wrapped digest.
+ */
+static int checksum_rows(ChecksumKind kind, int width) {
+    int digits = kind == CHECKSUM_SHA256 ? 64 : kind == CHECKSUM_XXH64 ? 16 : 8;
+    char label[48];
+    checksum_label(kind, label, sizeof(label));
+    if ((int)strlen(label) + 2 + digits <= width || width < 8) return 1;
+    return 1 + (digits + width - 1) / width;
+}
+
+/**
+ * @brief Returns the rows the checksums take below the metadata, the gap after them included.
+ */
+static int checksums_height(const AppState* state) {
+    const Checksums* sums = state->checksums;
+    if (!sums) return 0;
+    int width = getmaxx(state->left_pane) - 4;
+    int rows = 3 + (sums->subject ? 1 : 0);
+    for (size_t i = 0; i < sums->kind_count; i++) rows += checksum_rows(sums->kinds[i], width);
+    return rows;
+}
+
+/**
+ * @brief Returns how far down the metadata and checksums reach, counted like `metadata.count`.
+ */
+static int info_height(const AppState* state) {
+    return (int)state->metadata.count + checksums_height(state);
+}
+
+/**
+ * @brief Draws the checksums of the file below the metadata.
+ *
+ * While the file is hashed the title shows how much of it is done; a digest
+ * too long to follow its label goes on the rows below it. The CRC-32 an
+ * archive records for an entry is drawn with the entry's name.
+ *
+ * @param win The ncurses window to draw to (left pane).
+ * @param state A read-only pointer to the current application state.
+ */
+static void draw_checksums(WINDOW* win, const AppState* state) {
+    const Checksums* sums = state->checksums;
+    int max_y = getmaxy(win), max_w = getmaxx(win);
+    int width = max_w - 4;
+    int y = (int)state->metadata.count + 5;
+    if (width < 8 || y + 2 >= max_y - 1) return;
+
+    wattron(win, A_BOLD | COLOR_PAIR(COLOR_PAIR_TITLE));
+    if (sums->stored) {
+        mvwprintw(win, y, 2, "Recorded in the archive");
+    } else if (!sums->done) {
+        unsigned int percent = sums->size > 0 ? (unsigned int)(sums->progress * 100 / sums->size) : 0;
+        mvwprintw(win, y, 2, "Checksums... %u%%", percent > 100 ? 100 : percent);
+    } else {
+        mvwprintw(win, y, 2, "Checksums");
+    }
+    mvwhline(win, y + 1, 1, ACS_HLINE, max_w - 2);
+    wattroff(win, A_BOLD | COLOR_PAIR(COLOR_PAIR_TITLE));
+    y += 2;
+
+    if (sums->subject) mvwprintw(win, y++, 2, "%.*s", width, sums->subject);
+    bool failed = sums->done && sums->result != FAT_SUCCESS;
+    for (size_t i = 0; i < sums->kind_count && y < max_y - 1; i++) {
+        char label[48];
+        checksum_label(sums->kinds[i], label, sizeof(label));
+        int rows = checksum_rows(sums->kinds[i], width);
+        wattron(win, COLOR_PAIR(COLOR_PAIR_METADATA_LABEL));
+        mvwprintw(win, y, 2, "%.*s:", width - 1, label);
+        wattroff(win, COLOR_PAIR(COLOR_PAIR_METADATA_LABEL));
+
+        const char* value = sums->values[i];
+        if (!sums->done || failed) {
+            wattron(win, A_DIM);
+            wprintw(win, " %s", failed ? "unreadable" : "...");
+            wattroff(win, A_DIM);
+        } else if (rows == 1) {
+            wprintw(win, " %s", value);
+        } else {
+            int length = (int)strlen(value);
+            for (int row = 1; row < rows && y + row < max_y - 1; row++) {
+                int start = (row - 1) * width;
+                if (start < length) mvwprintw(win, y + row, 2, "%.*s", width, value + start);
+            }
+        }
+        y += rows;
+    }
+    wnoutrefresh(win);
+}
+
+/**
+ * @brief Lists the sections and segments of an executable below the metadata.
+ *
+ * The entry holding the offset at the top of the hex view is highlighted, and
+ * the list scrolls to keep it visible.
+ */
+static void draw_section_list(WINDOW* win, const AppState* state) {
+    const BinaryFormat* binary = state->binary;
+    int max_y = getmaxy(win), max_w = getmaxx(win);
+    int title_y = info_height(state) + 5;
+    int first_y = title_y + 2;
+    int map_rows = byte_map_layout(state, NULL);
+    int visible = max_y - 1 - first_y - pinned_terms_height(state) - (map_rows > 0 ? map_rows + 2 : 0);
+    if (visible < 1 || max_w < 16) return;
+
+    wattron(win, A_BOLD | COLOR_PAIR(COLOR_PAIR_TITLE));
+    mvwprintw(win, title_y, 2, "%.*s", max_w - 4, binary->description);
+    mvwhline(win, title_y + 1, 1, ACS_HLINE, max_w - 2);
+    wattroff(win, A_BOLD | COLOR_PAIR(COLOR_PAIR_TITLE));
+
+    size_t top_line = state_line_count(state) > 0 ? state_line_number(state, (size_t)state->top_line) : 0;
+    int current = binary_format_section_at(binary, hex_view_row_offset(state->hex, top_line));
+    size_t first = 0;
+    if (current >= visible) first = (size_t)(current - visible / 2);
+    if (binary->section_count > (size_t)visible && first > binary->section_count - (size_t)visible) {
+        first = binary->section_count - (size_t)visible;
+    }
+
+    int name_w = max_w - 15; // Room for the offset column
+    for (int row = 0; row < visible && first + (size_t)row < binary->section_count; row++) {
+        size_t i = first + (size_t)row;
+        const BinarySection* section = &binary->sections[i];
+        if ((int)i == current) wattron(win, A_REVERSE);
+        if (section->is_segment) wattron(win, A_DIM);
+        mvwprintw(win, first_y + row, 2, "%-*.*s %10llX", name_w, name_w, section->name,
+                  (unsigned long long)section->offset);
+        if (section->is_segment) wattroff(win, A_DIM);
+        if ((int)i == current) wattroff(win, A_REVERSE);
+    }
+    wnoutrefresh(win);
+}
+
+/**
+ * @brief Returns the rows the pinned terms take at the bottom of the left pane.
+ */
+static int pinned_terms_height(const AppState* state) {
+    return state->pins.terms.count > 0 ? (int)state->pins.terms.count + 2 : 0;
+}
+
+/**
+ * @brief Draws the pinned terms in their colors at the bottom of the left pane.
+ *
+ * Each term shows the number of lines containing it, with "..." while the
+ * lines are still being indexed.
+ *
+ * @param win The ncurses window to draw to (left pane).
+ * @param state A read-only pointer to the current application state.
+ */
+static void draw_pinned_terms(WINDOW* win, const AppState* state) {
+    const PinnedTerms* pins = &state->pins;
+    int max_y = getmaxy(win), max_w = getmaxx(win);
+    int title_y = max_y - 1 - pinned_terms_height(state);
+    if (title_y <= info_height(state) + 3 || max_w < 16) return;
+
+    bool indexing = pins->next_line < state_line_count(state);
+    wattron(win, A_BOLD | COLOR_PAIR(COLOR_PAIR_TITLE));
+    mvwprintw(win, title_y, 2, "Pinned%s", indexing ? "..." : "");
+    mvwhline(win, title_y + 1, 1, ACS_HLINE, max_w - 2);
+    wattroff(win, A_BOLD | COLOR_PAIR(COLOR_PAIR_TITLE));
+
+    int term_w = max_w - 18; // Room for the line count
+    for (size_t i = 0; i < pins->terms.count; i++) {
+        int y = title_y + 2 + (int)i;
+        wattron(win, COLOR_PAIR(COLOR_PAIR_PIN(i)));
+        mvwprintw(win, y, 2, "%.*s", term_w, pins->terms.lines[i]);
+        wattroff(win, COLOR_PAIR(COLOR_PAIR_PIN(i)));
+        mvwprintw(win, y, max_w - 15, "%8zu lines", pins->term_lines[i]);
+    }
+    wnoutrefresh(win);
+}
+
+/**
+ * @brief Returns the number of columns the timeline is drawn in, one per stretch of time.
+ */
+int ui_timeline_columns(const AppState *state) {
+    int columns = getmaxx(state->left_pane) - 4;
+    return columns > 1 ? columns : 1;
+}
+
+/**
+ * @brief Works out where the byte map goes in the left pane.
+ *
+ * It fills the space between the metadata and the pinned terms, or the
+ * lower half of it when the sections of an executable are listed above.
+ *
+ * @param state A read-only pointer to the current application state.
+ * @param title_y Receives the row of the map's title, if not NULL.
+ * @return The number of rows of the map, or 0 if it is hidden or does not fit.
+ */
+static int byte_map_layout(const AppState* state, int* title_y) {
+    if (state->hide_byte_map || state->view_mode != VIEW_MODE_BINARY_HEX || !state->hex) return 0;
+    int top = info_height(state) + 5;
+    int bottom = getmaxy(state->left_pane) - 1 - pinned_terms_height(state);
+    int height = bottom - top;
+    if (state->binary) height /= 2;
+    if (height < 4 || getmaxx(state->left_pane) < 24) return 0;
+    if (title_y) *title_y = bottom - height;
+    return height - 2;
+}
+
+/**
+ * @brief Draws the byte map of a file in hex mode in the left pane.
+ *
+ * Each row is an equal stretch of the file: its offset, a bar split by the
+ * share of zero bytes, printable ASCII, other control bytes and bytes with
+ * the high bit set, and its entropy in bits per byte, in bold when the
+ * stretch looks compressed or encrypted. The row holding the top of the
+ * screen has its offset highlighted.
+ *
+ * @param win The ncurses window to draw to (left pane).
+ * @param state A read-only pointer to the current application state.
+ */
+static void draw_byte_map(WINDOW* win, const AppState* state) {
+    static const char* const GLYPHS[4] = { "\u2591", "\u2592", "\u2593", "\u2588" };
+    static const int COLORS[4] = { COLOR_PAIR_LINE_NUM, COLOR_PAIR_DIFF_ADDED, COLOR_PAIR_METADATA_LABEL,
+                                   COLOR_PAIR_DIFF_REMOVED };
+    const ByteMap* map = state->byte_map;
+    int title_y;
+    int rows = byte_map_layout(state, &title_y);
+    int max_w = getmaxx(win);
+    int digits = state->hex->offset_digits;
+    int bar_w = max_w - 4 - digits - 1 - 5; // Offset, space, bar, entropy
+    if (rows < 1 || bar_w < 4 || map->size == 0) return;
+
+    char per_row[16];
+    format_size((uint64_t)byte_map_row_start(map, 1, (size_t)rows), per_row, sizeof(per_row));
+    wattron(win, A_BOLD | COLOR_PAIR(COLOR_PAIR_TITLE));
+    mvwprintw(win, title_y, 2, "Byte Map%s", byte_map_is_running(map) ? "..." : "");
+    mvwprintw(win, title_y, max_w - 2 - (int)strlen(per_row) - 4, "%s/row", per_row);
+    mvwhline(win, title_y + 1, 1, ACS_HLINE, max_w - 2);
+    wattroff(win, A_BOLD | COLOR_PAIR(COLOR_PAIR_TITLE));
+
+    size_t top_row = state_line_count(state) > 0 ? state_line_number(state, (size_t)state->top_line) : 0;
+    uint64_t top_offset = hex_view_row_offset(state->hex, top_row);
+    size_t current = byte_map_row_of(map, (size_t)top_offset, (size_t)rows);
+
+    for (int row = 0; row < rows; row++) {
+        int y = title_y + 2 + row;
+        size_t start = byte_map_row_start(map, (size_t)row, (size_t)rows);
+        size_t end = byte_map_row_start(map, (size_t)row + 1, (size_t)rows);
+        if (end <= start) continue; // More rows than blocks
+        if ((size_t)row == current) wattron(win, A_REVERSE);
+        wattron(win, COLOR_PAIR(COLOR_PAIR_LINE_NUM));
+        mvwprintw(win, y, 2, "%0*llX", digits, (unsigned long long)start);
+        wattroff(win, COLOR_PAIR(COLOR_PAIR_LINE_NUM));
+        if ((size_t)row == current) wattroff(win, A_REVERSE);
+
+        ByteBlock block;
+        byte_map_summarize(map, start, end, &block);
+        if (block.bytes == 0) continue; // Not scanned yet
+
+        // The cells where each class ends: zero, text, control, then high.
+        uint64_t other = block.bytes - block.zero - block.text - block.high;
+        uint64_t shares[4] = { block.zero, block.text, other, block.high };
+        uint64_t cumulative = 0;
+        int x = 0;
+        for (int cls = 0; cls < 4; cls++) {
+            cumulative += shares[cls];
+            int cls_end = (int)((cumulative * (uint64_t)bar_w + block.bytes / 2) / block.bytes);
+            wattron(win, COLOR_PAIR(COLORS[cls]));
+            for (; x < cls_end && x < bar_w; x++) mvwaddstr(win, y, 2 + digits + 1 + x, GLYPHS[cls]);
+            wattroff(win, COLOR_PAIR(COLORS[cls]));
+        }
+
+        bool is_random = byte_map_classify(&block) == BYTE_REGION_RANDOM;
+        if (is_random) wattron(win, A_BOLD);
+        mvwprintw(win, y, max_w - 6, "%4.1f", (double)block.entropy);
+        if (is_random) wattroff(win, A_BOLD);
+    }
+    wnoutrefresh(win);
+}
+
+/**
+ * @brief Formats a duration in whole days, hours or minutes.
+ */
+static void format_duration(int64_t seconds, char* out, size_t out_size) {
+    if (seconds % 86400 == 0) {
+        snprintf(out, out_size, "%lldd", (long long)(seconds / 86400));
+    } else if (seconds % 3600 == 0) {
+        snprintf(out, out_size, "%lldh", (long long)(seconds / 3600));
+    } else {
+        snprintf(out, out_size, "%lldm", (long long)(seconds / 60));
+    }
+}
+
+/**
+ * @brief Formats a time as `MM-DD HH:MM`, short enough for the left pane.
+ */
+static void format_short_time(int64_t time, char* out, size_t out_size) {
+    char full[32];
+    time_format(time, full, sizeof(full));
+    snprintf(out, out_size, "%.11s", full + 5);
+}
+
+/**
+ * @brief Draws the timeline of a log above the pinned terms.
+ *
+ * Each column is a stretch of time, drawn as a bar of the lines stamped in
+ * it, or of the lines matching the search while one is active. The column
+ * holding the line at the top of the screen is highlighted, and the row
+ * below the axis tells when it starts and what it holds.
+ *
+ * @param win The ncurses window to draw to (left pane).
+ * @param state A read-only pointer to the current application state.
+ */
+static void draw_timeline(WINDOW* win, const AppState* state) {
+    static const char* const LEVELS[8] = { "\u2581", "\u2582", "\u2583", "\u2584", "\u2585", "\u2586", "\u2587", "\u2588" };
+    const TimeHistogram* hist = state->histogram;
+    int max_y = getmaxy(win), max_w = getmaxx(win);
+    int title_y = max_y - 1 - pinned_terms_height(state) - TIMELINE_HEIGHT;
+    if (title_y <= info_height(state) + 3 || max_w < 16) return;
+
+    const TimeHistogramCounts* counts = hist ? hist->counts : NULL;
+    size_t columns = (size_t)ui_timeline_columns(state);
+    size_t span = counts ? time_histogram_span(counts, columns) : 1;
+    bool by_match = hist && hist->term_len > 0;
+    char width[24] = ""; // Room for any int64_t and its unit
+    if (counts) format_duration(counts->width * (int64_t)span, width, sizeof(width));
+
+    wattron(win, A_BOLD | COLOR_PAIR(COLOR_PAIR_TITLE));
+    mvwprintw(win, title_y, 2, "Timeline%s", hist && time_histogram_is_running(hist) ? "..." : "");
+    if (counts) mvwprintw(win, title_y, max_w - 2 - (int)strlen(width) - 4, "%s/col", width);
+    mvwhline(win, title_y + 1, 1, ACS_HLINE, max_w - 2);
+    wattroff(win, A_BOLD | COLOR_PAIR(COLOR_PAIR_TITLE));
+    if (!counts || !counts->has_time) {
+        mvwprintw(win, title_y + 2, 2, "%.*s", max_w - 4, hist ? "Waiting for timestamps." : "No timestamps found.");
+        wnoutrefresh(win);
+        return;
+    }
+
+    size_t column_count = (counts->count + span - 1) / span;
+    size_t peak = 0;
+    TimeBucket bucket;
+    for (size_t c = 0; c < column_count; c++) {
+        time_histogram_column(counts, c, span, &bucket);
+        size_t value = by_match ? bucket.matches : bucket.lines;
+        if (value > peak) peak = value;
+    }
+    size_t top = state_line_count(state) > 0 ? state_line_number(state, (size_t)state->top_line) : 0;
+    size_t current = time_histogram_bucket_of(counts, top) / span;
+
+    for (size_t c = 0; c < column_count && c < columns; c++) {
+        time_histogram_column(counts, c, span, &bucket);
+        size_t value = by_match ? bucket.matches : bucket.lines;
+        // Eighths of a row, with any non-empty column at least one eighth high.
+        size_t level = peak ? (size_t)((unsigned long long)value * TIMELINE_BAR_ROWS * 8 / peak) : 0;
+        if (value > 0 && level == 0) level = 1;
+        if (c == current) wattron(win, COLOR_PAIR(COLOR_PAIR_SEARCH_HIGHLIGHT));
+        for (int row = 0; row < TIMELINE_BAR_ROWS; row++) {
+            size_t floor = (size_t)(TIMELINE_BAR_ROWS - 1 - row) * 8;
+            size_t fill = level > floor ? level - floor : 0;
+            mvwaddstr(win, title_y + 2 + row, 2 + (int)c, fill ? LEVELS[(fill > 8 ? 8 : fill) - 1] : " ");
+        }
+        if (c == current) wattroff(win, COLOR_PAIR(COLOR_PAIR_SEARCH_HIGHLIGHT));
+    }
+
+    int axis_y = title_y + 2 + TIMELINE_BAR_ROWS;
+    char first[16], last[16];
+    format_short_time(counts->start, first, sizeof(first));
+    format_short_time(counts->start + (int64_t)(column_count * span) * counts->width, last, sizeof(last));
+    wattron(win, A_DIM);
+    mvwprintw(win, axis_y, 2, "%s", first);
+    if (max_w - 4 >= 2 * (int)strlen(first) + 1) mvwprintw(win, axis_y, max_w - 2 - (int)strlen(last), "%s", last);
+    wattroff(win, A_DIM);
+
+    char when[16];
+    time_histogram_column(counts, current, span, &bucket);
+    format_short_time(counts->start + (int64_t)(current * span) * counts->width, when, sizeof(when));
+    if (by_match) {
+        mvwprintw(win, axis_y + 1, 2, "%.*s %zu/%zu match", max_w - 4, when, bucket.matches, bucket.lines);
+    } else {
+        mvwprintw(win, axis_y + 1, 2, "%.*s %zu lines", max_w - 4, when, bucket.lines);
+    }
+    wnoutrefresh(win);
+}
+
 /**
  * @brief Draws the status bar at the bottom of the screen.
  *
@@ -698,11 +1566,20 @@ static void draw_statusbar(const AppState *state) {
         mvwprintw(win, 0, 1, "[SEARCH]");
     } else if (state->mode == MODE_COMMAND_INPUT) {
         mvwprintw(win, 0, 1, "[COMMAND]");
+    } else if (state->mode == MODE_FILTER_INPUT) {
+        mvwprintw(win, 0, 1, "[FILTER]");
     }
     else {
         switch (state->view_mode) {
             case VIEW_MODE_ARCHIVE: mvwprintw(win, 0, 1, "[ARCHIVE]"); break;
             case VIEW_MODE_BINARY_HEX: mvwprintw(win, 0, 1, "[BINARY]"); break;
+            case VIEW_MODE_DIFF: mvwprintw(win, 0, 1, "[DIFF]"); break;
+            case VIEW_MODE_HEX_DIFF: mvwprintw(win, 0, 1, "[HEX DIFF]"); break;
+            case VIEW_MODE_DIRECTORY: mvwprintw(win, 0, 1, "[DIR]"); break;
+            case VIEW_MODE_GREP: mvwprintw(win, 0, 1, "[GREP]"); break;
+            case VIEW_MODE_JSON: mvwprintw(win, 0, 1, "[JSON]"); break;
+            case VIEW_MODE_TABLE: mvwprintw(win, 0, 1, "[TABLE]"); break;
+            case VIEW_MODE_STRINGS: mvwprintw(win, 0, 1, "[STRINGS]"); break;
             default: mvwprintw(win, 0, 1, "[NORMAL]"); break;
         }
     }
@@ -717,17 +1594,59 @@ static void draw_statusbar(const AppState *state) {
     // Display file path
     mvwprintw(win, 0, 19, "%.*s", width - 40, state->filepath ? state->filepath : "");
 
-    char right_status[64]; // Buffer for right-aligned status text
-    const char* label = (state->view_mode == VIEW_MODE_ARCHIVE) ? "Entry" : "Line";
+    char right_status[128]; // Buffer for right-aligned status text
+    const char* label = (state->view_mode == VIEW_MODE_ARCHIVE || state->view_mode == VIEW_MODE_DIRECTORY) ? "Entry" :
+                        state->view_mode == VIEW_MODE_TABLE ? "Row" :
+                        state->view_mode == VIEW_MODE_GREP ? "Hit" :
+                        state->view_mode == VIEW_MODE_STRINGS ? "String" : "Line";
+
+    // A filtered view counts lines of the original content.
+    size_t line_count = state_line_count(state);
+    size_t shown_line = line_count > 0 ? state_line_number(state, (size_t)state->top_line) + 1 : 0;
+    size_t total_lines = state_total_line_count(state);
+    char filter_status[64] = "";
+    if (state->archive_grep) {
+        const ArchiveGrep* grep = state->archive_grep;
+        if (archive_grep_is_running(grep)) {
+            snprintf(filter_status, sizeof(filter_status), "%zu with hits (%zu/%zu)... | ",
+                     line_count, grep->adopted, grep->entries.count);
+        } else {
+            snprintf(filter_status, sizeof(filter_status), "%zu with hits | ", line_count);
+        }
+    } else if (state->tree_grep) {
+        const TreeGrep* grep = state->tree_grep;
+        snprintf(filter_status, sizeof(filter_status), "%zu files%s%s | ", grep->files_done,
+                 tree_grep_is_running(grep) ? "..." : "", grep->truncated ? ", stopped at the limit" : "");
+    } else if (state->filter) {
+        snprintf(filter_status, sizeof(filter_status), "%zu matching%s | ",
+                 line_count, line_filter_is_running(state->filter) ? "..." : "");
+    } else if (state->view_mode == VIEW_MODE_TABLE && state->table) {
+        // Rows are counted in display order; the gutter shows their line in the file.
+        shown_line = line_count > 0 ? (size_t)state->top_line + 1 : 0;
+        if (table_view_sort_is_running(state->table)) snprintf(filter_status, sizeof(filter_status), "Sorting... | ");
+    }
 
     // Format search match and line/entry info
-    if (state->search_term_active && state->search_results.count > 0) {
-        snprintf(right_status, sizeof(right_status), "Match %zu/%zu | %s %d/%zu",
+    if (state->view_mode == VIEW_MODE_DIFF && state->diff) {
+        DiffProgress progress;
+        diff_get_progress(state->diff, &progress);
+        snprintf(right_status, sizeof(right_status), "%zu hunks -%zu +%zu%s | Row %d/%zu",
+                 progress.hunk_count, progress.lines_removed, progress.lines_added,
+                 progress.is_done ? "" : "...", state->top_line + 1, progress.row_count);
+    } else if (state->view_mode == VIEW_MODE_HEX_DIFF && state->hex_diff) {
+        const HexDiff* diff = state->hex_diff;
+        snprintf(right_status, sizeof(right_status), "%zu differences%s | Row %d/%zu", diff->count,
+                 hex_diff_is_running(diff) ? "..." : "", state->top_line + 1, diff->row_count);
+    } else if (state->search_term_active && state->search_results.count > 0) {
+        snprintf(right_status, sizeof(right_status), "%sMatch %zu/%zu%s | %s %zu/%zu", filter_status,
                  state->search_results.current_match_idx + 1, state->search_results.count,
-                 label, state->top_line + 1, state->content.count);
+                 state->search_results.is_scanning ? "..." : "", label, shown_line, total_lines);
+    } else if (state->search_term_active && state->search_results.is_scanning) {
+        snprintf(right_status, sizeof(right_status), "%sSearching... | %s %zu/%zu",
+                 filter_status, label, shown_line, total_lines);
     } else {
-        snprintf(right_status, sizeof(right_status), "%s %d/%zu",
-                 label, state->top_line + 1, state->content.count);
+        snprintf(right_status, sizeof(right_status), "%s%s %zu/%zu",
+                 filter_status, label, shown_line, total_lines);
     }
     mvwprintw(win, 0, width - (int)strlen(right_status) - 1, "%s", right_status); // Print right-aligned
 
@@ -738,6 +1657,534 @@ static void draw_statusbar(const AppState *state) {
     wnoutrefresh(win); // Mark window for refresh
 }
 
+/**
+ * @brief Draws a scrollbar thumb on the right border of the content pane.
+ *
+ * The thumb is placed by the position of the top line in the original
+ * content, so a filtered view shows where its matches are in the file.
+ * Nothing is drawn when everything fits on screen.
+ *
+ * @param win The ncurses window for the content pane.
+ * @param state A read-only pointer to the current application state.
+ */
+static void draw_scrollbar(WINDOW* win, const AppState* state) {
+    int track = getmaxy(win) - 2;
+    int x = getmaxx(win) - 1;
+    size_t line_count = state_line_count(state);
+    size_t total = state_total_line_count(state);
+    if (track < 1 || total <= 1 || (line_count <= (size_t)track && !state->filter)) return;
+
+    size_t visible = (size_t)track < line_count ? (size_t)track : line_count;
+    int thumb = line_count > 0 ? (int)((size_t)track * visible / line_count) : 1;
+    if (thumb < 1) thumb = 1;
+    // Table rows may be sorted, so their line numbers say nothing about the position.
+    size_t position = line_count == 0 ? 0 :
+                      state->view_mode == VIEW_MODE_TABLE ? (size_t)state->top_line :
+                      state_line_number(state, (size_t)state->top_line);
+    int start = 1 + (int)((double)position / (double)(total - 1) * (track - thumb));
+
+    wattron(win, COLOR_PAIR(COLOR_PAIR_BORDER) | A_REVERSE);
+    for (int y = start; y < start + thumb && y <= track; y++) {
+        mvwaddch(win, y, x, ' ');
+    }
+    wattroff(win, COLOR_PAIR(COLOR_PAIR_BORDER) | A_REVERSE);
+}
+
+/**
+ * @brief Draws one tab per open buffer on the top border of the content pane.
+ *
+ * Nothing is drawn when only one file is open. Tabs that do not fit before
+ * `max_x` are left out.
+ *
+ * @param win The ncurses window for the content pane.
+ * @param state A read-only pointer to the current application state.
+ * @param max_x The first column the tabs must not reach.
+ */
+static void draw_buffer_tabs(WINDOW* win, const AppState* state, int max_x) {
+    if (state->buffer_count < 2) return;
+
+    int x = 2;
+    for (size_t i = 0; i < state->buffer_count; i++) {
+        const char* path = state_buffer_path(state, i);
+        const char* basename = path ? strrchr(path, '/') : NULL;
+        basename = basename ? basename + 1 : (path ? path : "?");
+
+        char tab[64];
+        snprintf(tab, sizeof(tab), " %zu:%s ", i + 1, basename);
+        int tab_len = (int)strlen(tab);
+        if (x + tab_len >= max_x) break;
+
+        bool is_active = (i == state->active_buffer);
+        wattron(win, COLOR_PAIR(COLOR_PAIR_TITLE) | (is_active ? A_BOLD | A_REVERSE : 0));
+        mvwprintw(win, 0, x, "%s", tab);
+        wattroff(win, COLOR_PAIR(COLOR_PAIR_TITLE) | (is_active ? A_BOLD | A_REVERSE : 0));
+        x += tab_len + 1;
+    }
+}
+
+/**
+ * @brief Draws one side of a diff row: the line number and the visible part of the line.
+ *
+ * @param win The ncurses window for the content pane.
+ * @param y The row to draw on.
+ * @param x The first column of this side.
+ * @param width The number of columns this side may use.
+ * @param index The file shown on this side.
+ * @param has_line False if this side has no line on this row (the other file added lines).
+ * @param line_idx The zero-based line to draw.
+ * @param color_pair The color pair used when the row belongs to a hunk.
+ * @param is_change True if the row belongs to a hunk.
+ * @param is_active True if this is the row at the top of the view.
+ * @param left_char The number of characters scrolled off to the left.
+ */
+static void draw_diff_side(WINDOW* win, int y, int x, int width, const LineIndex* index,
+                           bool has_line, size_t line_idx, int color_pair, bool is_change,
+                           bool is_active, int left_char) {
+    int num_width = 2;
+    for (size_t n = index->count; n > 0; n /= 10) num_width++;
+    if (num_width < 5) num_width = 5;
+    if (width <= num_width) return;
+
+    if (!has_line) {
+        wattron(win, COLOR_PAIR(COLOR_PAIR_LINE_NUM));
+        mvwprintw(win, y, x, "%*s", num_width - 1, "~");
+        wattroff(win, COLOR_PAIR(COLOR_PAIR_LINE_NUM));
+        return;
+    }
+
+    if (is_active) wattron(win, A_REVERSE);
+    wattron(win, COLOR_PAIR(COLOR_PAIR_LINE_NUM));
+    mvwprintw(win, y, x, "%*zu ", num_width - 1, line_idx + 1);
+    wattroff(win, COLOR_PAIR(COLOR_PAIR_LINE_NUM));
+    if (is_active) wattroff(win, A_REVERSE);
+
+    size_t len;
+    const char* line = line_index_get(index, line_idx, &len);
+    if (!line) return;
+    const char* text = terminate_line(line, len);
+    for (int skipped = 0; skipped < left_char && *text != '\0'; skipped++) {
+        text += utf8_char_len(text);
+    }
+
+    int bytes = 0;
+    get_display_chars_and_bytes(text, width - num_width, &bytes);
+    if (is_change) wattron(win, COLOR_PAIR(color_pair) | A_BOLD);
+    mvwaddnstr(win, y, x + num_width, text, bytes);
+    if (is_change) wattroff(win, COLOR_PAIR(color_pair) | A_BOLD);
+}
+
+/**
+ * @brief Draws two files side by side, aligned by the background diff.
+ *
+ * Both sides scroll together, vertically by display row and horizontally by
+ * `left_char`. Rows that belong to a hunk are colored, and a `~` marks the
+ * side that has no line on a row.
+ *
+ * @param win The ncurses window for the content pane.
+ * @param state A read-only pointer to the current application state.
+ */
+static void draw_diff_pane(WINDOW* win, const AppState* state) {
+    DiffView* diff = state->diff;
+    int width = getmaxx(win);
+    int height = getmaxy(win);
+    int side_width = (width - 3) / 2;
+    int separator_x = 1 + side_width;
+
+    werase(win);
+    wattron(win, COLOR_PAIR(COLOR_PAIR_BORDER));
+    box(win, 0, 0);
+    mvwvline(win, 1, separator_x, ACS_VLINE, height - 2);
+    mvwaddch(win, 0, separator_x, ACS_TTEE);
+    mvwaddch(win, height - 1, separator_x, ACS_BTEE);
+    wattroff(win, COLOR_PAIR(COLOR_PAIR_BORDER));
+
+    // File names on the top border, one per side
+    const char* names[2] = { diff->path_a, diff->path_b };
+    int title_x[2] = { 2, separator_x + 2 };
+    wattron(win, A_BOLD | COLOR_PAIR(COLOR_PAIR_TITLE));
+    for (int side = 0; side < 2; side++) {
+        const char* basename = strrchr(names[side], '/');
+        basename = basename ? basename + 1 : names[side];
+        mvwprintw(win, 0, title_x[side], " %.*s ", side_width - 4, basename);
+    }
+    wattroff(win, A_BOLD | COLOR_PAIR(COLOR_PAIR_TITLE));
+
+    int visible_rows = height - 2;
+    if (visible_rows < 1 || side_width < 1) {
+        wnoutrefresh(win);
+        return;
+    }
+    DiffRow* rows = malloc((size_t)visible_rows * sizeof(DiffRow));
+    if (!rows) {
+        wnoutrefresh(win);
+        return;
+    }
+
+    size_t count = diff_get_rows(diff, (size_t)state->top_line, (size_t)visible_rows, rows);
+    for (size_t i = 0; i < count; i++) {
+        int y = (int)i + 1;
+        bool is_active = (i == 0);
+        draw_diff_side(win, y, 1, side_width, &diff->a, rows[i].has_a, rows[i].a_line,
+                       COLOR_PAIR_DIFF_REMOVED, rows[i].is_change, is_active, state->left_char);
+        draw_diff_side(win, y, separator_x + 1, width - separator_x - 2, &diff->b, rows[i].has_b, rows[i].b_line,
+                       COLOR_PAIR_DIFF_ADDED, rows[i].is_change, is_active, state->left_char);
+    }
+    free(rows);
+    wnoutrefresh(win);
+}
+
+/**
+ * @brief Draws the part of a hex row between two columns that is not scrolled out of view.
+ */
+static void draw_hex_diff_span(WINDOW* win, int y, int x, int width, const char* text, size_t len,
+                               int column, int length, int left_char) {
+    int start = column - left_char;
+    int end = start + length;
+    if (end > (int)len - left_char) end = (int)len - left_char;
+    if (start < 0) start = 0;
+    if (end > width) end = width;
+    if (start >= end) return;
+    mvwaddnstr(win, y, x + start, text + left_char + start, end - start);
+}
+
+/**
+ * @brief Draws one side of a binary diff row, with the bytes that differ from the other side colored.
+ *
+ * @param win The ncurses window for the content pane.
+ * @param y The row to draw on.
+ * @param x The first column of this side.
+ * @param width The number of columns this side may use.
+ * @param diff The binary diff.
+ * @param view The file shown on this side.
+ * @param row The zero-based row to draw.
+ * @param color_pair The color pair of the differing bytes.
+ * @param is_active True if this is the row at the top of the view.
+ * @param left_char The number of columns scrolled off to the left.
+ */
+static void draw_hex_diff_side(WINDOW* win, int y, int x, int width, const HexDiff* diff, const HexView* view,
+                               size_t row, int color_pair, bool is_active, int left_char) {
+    if (width < 1) return;
+    if (row >= view->row_count) {
+        // The other file is longer.
+        wattron(win, COLOR_PAIR(COLOR_PAIR_LINE_NUM));
+        mvwaddch(win, y, x, '~');
+        wattroff(win, COLOR_PAIR(COLOR_PAIR_LINE_NUM));
+        return;
+    }
+
+    char text[HEX_ROW_MAX_BYTES];
+    size_t len = hex_view_format_row(view, row, text);
+    draw_hex_diff_span(win, y, x, width, text, len, 0, (int)len, left_char);
+    if (is_active) {
+        wattron(win, A_REVERSE);
+        draw_hex_diff_span(win, y, x, width, text, len, 0, view->offset_digits, left_char);
+        wattroff(win, A_REVERSE);
+    }
+
+    // Only the bytes on screen are compared; the ranges are for jumping between them.
+    uint64_t offset = (uint64_t)row * (uint64_t)view->bytes_per_row;
+    wattron(win, COLOR_PAIR(color_pair) | A_BOLD);
+    for (int i = 0; i < view->bytes_per_row && offset + (uint64_t)i < view->bytes.size; i++) {
+        if (!hex_diff_byte_differs(diff, offset + (uint64_t)i)) continue;
+        draw_hex_diff_span(win, y, x, width, text, len, hex_view_byte_column(view, i, false), 2, left_char);
+        draw_hex_diff_span(win, y, x, width, text, len, hex_view_byte_column(view, i, true), 1, left_char);
+    }
+    wattroff(win, COLOR_PAIR(color_pair) | A_BOLD);
+}
+
+/**
+ * @brief Draws two binary files as hex dumps side by side, their differing bytes colored.
+ *
+ * Both sides show the same offsets on each row and scroll together. A `~`
+ * marks the side whose file has ended.
+ *
+ * @param win The ncurses window for the content pane.
+ * @param state A read-only pointer to the current application state.
+ */
+static void draw_hex_diff_pane(WINDOW* win, const AppState* state) {
+    const HexDiff* diff = state->hex_diff;
+    int width = getmaxx(win);
+    int height = getmaxy(win);
+    int side_width = (width - 3) / 2;
+    int separator_x = 1 + side_width;
+
+    werase(win);
+    wattron(win, COLOR_PAIR(COLOR_PAIR_BORDER));
+    box(win, 0, 0);
+    mvwvline(win, 1, separator_x, ACS_VLINE, height - 2);
+    mvwaddch(win, 0, separator_x, ACS_TTEE);
+    mvwaddch(win, height - 1, separator_x, ACS_BTEE);
+    wattroff(win, COLOR_PAIR(COLOR_PAIR_BORDER));
+
+    // File names on the top border, one per side
+    const char* names[2] = { diff->path_a, diff->path_b };
+    int title_x[2] = { 2, separator_x + 2 };
+    wattron(win, A_BOLD | COLOR_PAIR(COLOR_PAIR_TITLE));
+    for (int side = 0; side < 2; side++) {
+        const char* basename = strrchr(names[side], '/');
+        basename = basename ? basename + 1 : names[side];
+        mvwprintw(win, 0, title_x[side], " %.*s ", side_width - 4, basename);
+    }
+    wattroff(win, A_BOLD | COLOR_PAIR(COLOR_PAIR_TITLE));
+
+    for (int i = 0; i < height - 2; i++) {
+        size_t row = (size_t)state->top_line + (size_t)i;
+        if (row >= diff->row_count) break;
+        bool is_active = (i == 0);
+        draw_hex_diff_side(win, i + 1, 1, side_width, diff, &diff->a, row,
+                           COLOR_PAIR_DIFF_REMOVED, is_active, state->left_char);
+        draw_hex_diff_side(win, i + 1, separator_x + 1, width - separator_x - 2, diff, &diff->b, row,
+                           COLOR_PAIR_DIFF_ADDED, is_active, state->left_char);
+    }
+    wnoutrefresh(win);
+}
+
+/**
+ * @brief Formats a byte count as a short human-readable size (e.g. "12.3M").
+ */
+static void format_size(uint64_t size, char* out, size_t out_size) {
+    static const char units[] = "BKMGTP";
+    double value = (double)size;
+    size_t unit = 0;
+    while (value >= 1024.0 && unit + 1 < sizeof(units) - 1) {
+        value /= 1024.0;
+        unit++;
+    }
+    if (unit == 0) {
+        snprintf(out, out_size, "%lu", (unsigned long)size);
+    } else {
+        snprintf(out, out_size, "%.1f%c", value, units[unit]);
+    }
+}
+
+/**
+ * @brief Draws the entries of a directory with their size, date and type.
+ *
+ * Only the rows on screen are stat'ed, and the probe pool is told to sniff
+ * them first. Types that are still being probed show as "...". Entries a
+ * plugin can open are highlighted, and directories end with a '/'.
+ *
+ * @param win The ncurses window for the content pane.
+ * @param state A read-only pointer to the current application state.
+ */
+static void draw_directory_pane(WINDOW* win, const AppState* state) {
+    DirListing* dir = state->dir;
+    int width = getmaxx(win);
+    int height = getmaxy(win);
+
+    werase(win);
+    wattron(win, COLOR_PAIR(COLOR_PAIR_BORDER));
+    box(win, 0, 0);
+    wattroff(win, COLOR_PAIR(COLOR_PAIR_BORDER));
+
+    const char* version_str = FAT_VERSION;
+    int version_len = (int)strlen(version_str);
+    if (width > version_len + 4) {
+        wattron(win, A_BOLD | COLOR_PAIR(COLOR_PAIR_TITLE));
+        mvwprintw(win, 0, width - version_len - 2, " %s ", version_str);
+        wattroff(win, A_BOLD | COLOR_PAIR(COLOR_PAIR_TITLE));
+    }
+    draw_buffer_tabs(win, state, width - version_len - 3);
+
+    int line_num_width = 7;
+    int content_width = width - line_num_width - 1;
+    if (content_width < 1) {
+        wnoutrefresh(win);
+        return;
+    }
+
+    // Size, date and type columns are dropped on narrow panes to keep names readable.
+    const int size_width = 8, date_width = 16, type_width = 28;
+    int details_width = size_width + 1 + date_width + 1 + type_width + 1;
+    bool show_details = content_width >= details_width + 16;
+    int name_width = content_width - (show_details ? details_width : 0);
+
+    dir_listing_prioritize(dir, (size_t)state->top_line);
+
+    for (int y = 1; y < height - 1; y++) {
+        size_t idx = (size_t)state->top_line + (size_t)(y - 1);
+        if (idx >= dir->count) break;
+        bool is_active = (y == 1);
+        dir_listing_stat(dir, idx);
+        DirEntry* entry = &dir->entries[idx];
+
+        char mime[128];
+        const char* handler_name = NULL;
+        bool probed = dir_listing_get_probe(dir, idx, mime, sizeof(mime), &handler_name);
+
+        if (is_active) wattron(win, A_REVERSE);
+        wattron(win, COLOR_PAIR(COLOR_PAIR_LINE_NUM));
+        mvwprintw(win, y, 1, "%*zu ", line_num_width - 2, idx + 1);
+        wattroff(win, COLOR_PAIR(COLOR_PAIR_LINE_NUM));
+
+        // Name, highlighted when a plugin can open it
+        const char* name = terminate_line(entry->name, strlen(entry->name));
+        int name_bytes = 0;
+        int name_chars = get_display_chars_and_bytes(name, name_width - 1, &name_bytes);
+        attr_t name_attr = (entry->type == DIR_ENTRY_DIR) ? A_BOLD :
+                           handler_name ? (A_BOLD | COLOR_PAIR(COLOR_PAIR_TITLE)) : A_NORMAL;
+        wattron(win, name_attr);
+        mvwaddnstr(win, y, line_num_width, name, name_bytes);
+        if (entry->type == DIR_ENTRY_DIR && name_chars < name_width - 1) waddch(win, '/');
+        wattroff(win, name_attr);
+
+        if (show_details) {
+            char size_text[16] = "";
+            char date_text[32] = "";
+            if (entry->stat_failed) {
+                snprintf(size_text, sizeof(size_text), "?");
+            } else if (entry->type == DIR_ENTRY_DIR) {
+                snprintf(size_text, sizeof(size_text), "<DIR>");
+            } else {
+                format_size(entry->size, size_text, sizeof(size_text));
+            }
+            if (!entry->stat_failed) {
+                struct tm* tm = localtime(&entry->mtime);
+                if (tm) strftime(date_text, sizeof(date_text), "%Y-%m-%d %H:%M", tm);
+            }
+
+            char type_text[128];
+            if (!probed) {
+                snprintf(type_text, sizeof(type_text), "...");
+            } else if (handler_name) {
+                snprintf(type_text, sizeof(type_text), "%.100s [archive]", mime[0] ? mime : "unknown");
+            } else {
+                snprintf(type_text, sizeof(type_text), "%s", mime[0] ? mime : "-");
+            }
+
+            int x = line_num_width + name_width;
+            mvwprintw(win, y, x, "%*s %-*s %-*.*s", size_width, size_text, date_width, date_text,
+                      type_width, type_width, type_text);
+        }
+        if (is_active) {
+            // Extend the highlight across the whole row.
+            int cur_x = getcurx(win);
+            if (cur_x < width - 1) mvwhline(win, y, cur_x, ' ', width - 1 - cur_x);
+            wattroff(win, A_REVERSE);
+        }
+    }
+    wnoutrefresh(win);
+}
+
+/**
+ * @brief Draws one row of a table from the first visible column onwards.
+ *
+ * Cells are padded to the sampled width of their column and cut with an
+ * ellipsis when longer. Columns are separated by a vertical line.
+ *
+ * @param win The ncurses window for the content pane.
+ * @param table The table being drawn.
+ * @param y The screen row.
+ * @param line The line of the file to draw.
+ * @param x The first screen column of the cells.
+ * @param max_x The first screen column the cells must not reach.
+ * @param first_column The leftmost column shown.
+ * @param is_header True to mark the sorted column in the header.
+ */
+static void draw_table_row(WINDOW* win, TableView* table, int y, size_t line, int x, int max_x,
+                           size_t first_column, bool is_header) {
+    for (size_t c = first_column; c < table->column_count && x < max_x; c++) {
+        int column_width = table->widths[c] > 0 ? table->widths[c] : 1;
+        if (table->sort_column == (int)c) column_width += 2; // Room for the arrow
+        int cell_width = column_width < max_x - x ? column_width : max_x - x;
+
+        char cell[TABLE_MAX_COLUMN_WIDTH * 4 + 8];
+        size_t len = table_view_cell(table, line, c, cell, TABLE_MAX_COLUMN_WIDTH * 4 + 1);
+        if (is_header && table->sort_column == (int)c) {
+            // Keep the arrow visible by cutting the name rather than the arrow.
+            int name_bytes = 0;
+            get_display_chars_and_bytes(cell, cell_width > 2 ? cell_width - 2 : 0, &name_bytes);
+            len = (size_t)name_bytes;
+            len += (size_t)snprintf(cell + len, sizeof(cell) - len, " %s", table->sort_descending ? "\xe2\x96\xbc" : "\xe2\x96\xb2");
+        }
+
+        int bytes = 0;
+        int chars = get_display_chars_and_bytes(cell, cell_width, &bytes);
+        if ((size_t)bytes < len && cell_width > 1) {
+            // Cut one character short to make room for the ellipsis.
+            chars = get_display_chars_and_bytes(cell, cell_width - 1, &bytes);
+            mvwaddnstr(win, y, x, cell, bytes);
+            waddstr(win, "\xe2\x80\xa6");
+            chars++;
+        } else {
+            mvwaddnstr(win, y, x, cell, bytes);
+        }
+        for (; chars < cell_width; chars++) waddch(win, ' ');
+
+        x += column_width + 1;
+        if (x < max_x) {
+            wattron(win, COLOR_PAIR(COLOR_PAIR_BORDER));
+            mvwaddch(win, y, x, ACS_VLINE);
+            wattroff(win, COLOR_PAIR(COLOR_PAIR_BORDER));
+        }
+        x += 2;
+    }
+}
+
+/**
+ * @brief Draws a CSV or TSV file as aligned columns below a fixed header.
+ *
+ * Only the cells on screen are parsed. The leftmost column shown is
+ * `left_char`, so horizontal scrolling moves one column at a time. Line
+ * numbers refer to the file even when the rows are sorted.
+ *
+ * @param win The ncurses window for the content pane.
+ * @param state A read-only pointer to the current application state.
+ */
+static void draw_table_pane(WINDOW* win, const AppState* state) {
+    TableView* table = state->table;
+    int width = getmaxx(win);
+    int height = getmaxy(win);
+
+    werase(win);
+    wattron(win, COLOR_PAIR(COLOR_PAIR_BORDER));
+    box(win, 0, 0);
+    wattroff(win, COLOR_PAIR(COLOR_PAIR_BORDER));
+
+    const char* version_str = FAT_VERSION;
+    int version_len = (int)strlen(version_str);
+    if (width > version_len + 4) {
+        wattron(win, A_BOLD | COLOR_PAIR(COLOR_PAIR_TITLE));
+        mvwprintw(win, 0, width - version_len - 2, " %s ", version_str);
+        wattroff(win, A_BOLD | COLOR_PAIR(COLOR_PAIR_TITLE));
+    }
+    draw_buffer_tabs(win, state, width - version_len - 3);
+
+    int line_num_width = 7;
+    for (size_t total = table->text.count; total >= 100000; total /= 10) line_num_width++;
+    int max_x = width - 1;
+    if (max_x - line_num_width < 1 || height < 4) {
+        wnoutrefresh(win);
+        return;
+    }
+    size_t first_column = state->left_char > 0 ? (size_t)state->left_char : 0;
+
+    wattron(win, A_BOLD | COLOR_PAIR(COLOR_PAIR_TITLE));
+    draw_table_row(win, table, 1, 0, line_num_width, max_x, first_column, true);
+    wattroff(win, A_BOLD | COLOR_PAIR(COLOR_PAIR_TITLE));
+
+    for (int y = 2; y < height - 1; y++) {
+        size_t row = (size_t)state->top_line + (size_t)(y - 2);
+        if (row >= table->row_count) break;
+        bool is_active = (y == 2);
+        size_t line = table_view_line(table, row);
+
+        if (is_active) wattron(win, A_REVERSE);
+        wattron(win, COLOR_PAIR(COLOR_PAIR_LINE_NUM));
+        mvwprintw(win, y, 1, "%*zu ", line_num_width - 2, line + 1);
+        wattroff(win, COLOR_PAIR(COLOR_PAIR_LINE_NUM));
+        draw_table_row(win, table, y, line, line_num_width, max_x, first_column, false);
+        if (is_active) {
+            // Extend the highlight across the whole row.
+            int cur_x = getcurx(win);
+            if (cur_x < max_x) mvwhline(win, y, cur_x, ' ', max_x - cur_x);
+            wattroff(win, A_REVERSE);
+        }
+    }
+    draw_scrollbar(win, state);
+    wnoutrefresh(win);
+}
+
 /**
  * @brief Draws the main content pane (right side) with UTF-8 and line-wrap awareness.
  *
@@ -755,6 +2202,22 @@ static void draw_statusbar(const AppState *state) {
  * @param state A read-only pointer to the current application state, containing content, scroll, and search info.
  */
 static void draw_content_pane(WINDOW* win, const AppState* state) {
+    if (state->view_mode == VIEW_MODE_DIFF && state->diff) {
+        draw_diff_pane(win, state);
+        return;
+    }
+    if (state->view_mode == VIEW_MODE_HEX_DIFF && state->hex_diff) {
+        draw_hex_diff_pane(win, state);
+        return;
+    }
+    if (state->view_mode == VIEW_MODE_DIRECTORY && state->dir) {
+        draw_directory_pane(win, state);
+        return;
+    }
+    if (state->view_mode == VIEW_MODE_TABLE && state->table) {
+        draw_table_pane(win, state);
+        return;
+    }
     werase(win); // Clear the window
     wattron(win, COLOR_PAIR(COLOR_PAIR_BORDER));
     box(win, 0, 0); // Draw border
@@ -768,9 +2231,12 @@ static void draw_content_pane(WINDOW* win, const AppState* state) {
         mvwprintw(win, 0, width - version_len - 2, " %s ", version_str); // Print version top-right
         wattroff(win, A_BOLD | COLOR_PAIR(COLOR_PAIR_TITLE));
     }
+    draw_buffer_tabs(win, state, width - version_len - 3);
 
     int height = getmaxy(win);
-    int line_num_width = 7; // Fixed width for line numbers (e.g., "12345 ")
+    // Room for the largest line number of the original content, at least "12345 ".
+    int line_num_width = 7;
+    for (size_t total = state_total_line_count(state); total >= 100000; total /= 10) line_num_width++;
     int content_width = width - line_num_width - 1; // Available width for content
     if (content_width < 1) { // Prevent division by zero or negative width
         wnoutrefresh(win);
@@ -779,14 +2245,16 @@ static void draw_content_pane(WINDOW* win, const AppState* state) {
 
     int y = 1; // Starting Y coordinate for content (below border/title)
     // Loop through logical lines of content that are visible on screen
-    for (int line_idx = state->top_line; line_idx < (int)state->content.count && y < height - 1; ) {
+    int line_count = (int)state_line_count(state);
+    for (int line_idx = state->top_line; line_idx < line_count && y < height - 1; ) {
         bool is_active_line = (line_idx == state->top_line); // Check if this is the currently selected line
-        const char* full_line = state->content.lines[line_idx];
+        const char* full_line = get_terminated_line(state, (size_t)line_idx);
+        const unsigned char* marks = mark_pinned_terms(state, full_line);
 
         // Draw line number and initial reverse video if active line
         if (is_active_line) wattron(win, A_REVERSE); // Apply reverse video for active line
         wattron(win, COLOR_PAIR(COLOR_PAIR_LINE_NUM));
-        mvwprintw(win, y, 1, "%*d ", line_num_width - 2, line_idx + 1); // Print line number
+        mvwprintw(win, y, 1, "%*zu ", line_num_width - 2, state_line_number(state, (size_t)line_idx) + 1); // Print line number
         wattroff(win, COLOR_PAIR(COLOR_PAIR_LINE_NUM));
         if (is_active_line) wattroff(win, A_REVERSE); // Turn off reverse video for line number
 
@@ -864,7 +2332,7 @@ static void draw_content_pane(WINDOW* win, const AppState* state) {
                                     chars_to_print_now = (width - 1) - current_screen_col;
                                 }
                                 if (chars_to_print_now > 0) {
-                                    print_segment(win, y, current_screen_col, print_segment_ptr, chars_to_print_now, is_active_line, false, false);
+                                    print_marked_segment(win, y, current_screen_col, print_segment_ptr, chars_to_print_now, is_active_line, marks ? marks + (print_segment_ptr - full_line) : NULL);
                                     current_screen_col += chars_to_print_now;
                                 }
                             }
@@ -895,14 +2363,14 @@ static void draw_content_pane(WINDOW* win, const AppState* state) {
                                 chars_to_print_now = (width - 1) - current_screen_col;
                             }
                             if (chars_to_print_now > 0) {
-                                print_segment(win, y, current_screen_col, print_segment_ptr, chars_to_print_now, is_active_line, false, false);
+                                print_marked_segment(win, y, current_screen_col, print_segment_ptr, chars_to_print_now, is_active_line, marks ? marks + (print_segment_ptr - full_line) : NULL);
                             }
                             break; // Exit inner loop
                         }
                     }
                 } else {
                     // No search or no match, just print the segment
-                    print_segment(win, y, line_num_width, segment_start_ptr, chars_to_take, is_active_line, false, false);
+                    print_marked_segment(win, y, line_num_width, segment_start_ptr, chars_to_take, is_active_line, marks ? marks + (segment_start_ptr - full_line) : NULL);
                 }
 
                 y++; // Move to the next screen line for the next wrapped segment
@@ -962,7 +2430,7 @@ static void draw_content_pane(WINDOW* win, const AppState* state) {
                     int pre_match_bytes = (int)(match - current_print_ptr);
                     int pre_match_chars = get_char_len_from_bytes(current_print_ptr, pre_match_bytes);
                     if (pre_match_chars > 0) {
-                        print_segment(win, y, line_num_width + screen_x, current_print_ptr, pre_match_chars, is_active_line, false, false);
+                        print_marked_segment(win, y, line_num_width + screen_x, current_print_ptr, pre_match_chars, is_active_line, marks ? marks + (current_print_ptr - full_line) : NULL);
                         screen_x += pre_match_chars;
                     }
 
@@ -978,7 +2446,7 @@ static void draw_content_pane(WINDOW* win, const AppState* state) {
                     // No more matches on this line, print the rest
                     int bytes_to_advance = 0;
                     int chars_to_print = get_display_chars_and_bytes(current_print_ptr, content_width - screen_x, &bytes_to_advance);
-                    print_segment(win, y, line_num_width + screen_x, current_print_ptr, chars_to_print, is_active_line, false, false);
+                    print_marked_segment(win, y, line_num_width + screen_x, current_print_ptr, chars_to_print, is_active_line, marks ? marks + (current_print_ptr - full_line) : NULL);
                     break; // End of line
                 }
             }
@@ -987,5 +2455,6 @@ static void draw_content_pane(WINDOW* win, const AppState* state) {
             y++;
         }
     }
+    draw_scrollbar(win, state);
     wnoutrefresh(win); // Mark window for refresh
 }
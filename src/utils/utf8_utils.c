@@ -8,16 +8,22 @@
 /**
  * @brief Calculates the byte length of a UTF-8 character.
  * @param s A pointer to the start of the character.
- * @return The number of bytes (1-4) for the character.
+ * @return The number of bytes (1-4) for the character, cut short at the first byte that does not continue it.
  */
 int utf8_char_len(const char *s) {
     if (!s || *s == '\0') return 0;
     unsigned char c = *s;
+    int len;
     if (c < 0x80) return 1;
-    if ((c & 0xE0) == 0xC0) return 2;
-    if ((c & 0xF0) == 0xE0) return 3;
-    if ((c & 0xF8) == 0xF0) return 4;
-    return 1; // Fallback for invalid byte
+    if ((c & 0xE0) == 0xC0) len = 2;
+    else if ((c & 0xF0) == 0xE0) len = 3;
+    else if ((c & 0xF8) == 0xF0) len = 4;
+    else return 1; // Fallback for invalid byte
+    // A stray lead byte must not swallow the characters after it.
+    for (int i = 1; i < len; i++) {
+        if (((unsigned char)s[i] & 0xC0) != 0x80) return i;
+    }
+    return len;
 }
 
 /**
@@ -35,3 +41,20 @@ int utf8_prev_char_start(const char *s, int current_pos) {
     }
     return pos;
 }
+
+/**
+ * @brief Checks that a UTF-8 character is well formed.
+ * @param s A pointer to the start of the character.
+ * @return true if its utf8_char_len(s) bytes are the whole of a valid, shortest encoding of a code point.
+ */
+bool utf8_char_is_valid(const char *s) {
+    if (!s || *s == '\0') return false;
+    const unsigned char *p = (const unsigned char *)s;
+    if (p[0] < 0x80) return true;
+    int len = (p[0] & 0xE0) == 0xC0 ? 2 : (p[0] & 0xF0) == 0xE0 ? 3 : (p[0] & 0xF8) == 0xF0 ? 4 : 0;
+    if (len == 0 || utf8_char_len(s) != len) return false; // A stray byte, or a character cut short
+    unsigned int cp = p[0] & (0x7F >> len);
+    for (int i = 1; i < len; i++) cp = (cp << 6) | (p[i] & 0x3F);
+    static const unsigned int min[5] = {0, 0, 0x80, 0x800, 0x10000};
+    return cp >= min[len] && cp <= 0x10FFFF && (cp < 0xD800 || cp > 0xDFFF);
+}
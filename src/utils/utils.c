@@ -88,3 +88,19 @@ void cleanup_temp_file_if_exists(const char* path) {
         remove(path);
     }
 }
+
+/**
+ * @brief Finds the first occurrence of a byte string in a buffer that may not be null-terminated.
+ */
+const char* find_bytes(const char* haystack, size_t haystack_len, const char* needle, size_t needle_len) {
+    if (needle_len == 0 || haystack_len < needle_len) return NULL;
+    const char* last = haystack + (haystack_len - needle_len);
+    const char* ptr = haystack;
+    while (ptr <= last) {
+        ptr = memchr(ptr, needle[0], (size_t)(last - ptr) + 1);
+        if (!ptr) return NULL;
+        if (memcmp(ptr, needle, needle_len) == 0) return ptr;
+        ptr++;
+    }
+    return NULL;
+}